@@ -0,0 +1,484 @@
+#include "bench.h"
+
+/**
+ * @fn uint64_t bench_now_ns()
+ * @brief monotonic clock 기준 현재 시각을 ns 단위로 구하는 함수
+ * @return 현재 시각 (ns)
+ */
+uint64_t bench_now_ns(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @fn int bench_cmp_u64( const void *a, const void *b)
+ * @brief qsort 용 uint64_t 비교 함수
+ * @return a < b 이면 음수, 같으면 0, 크면 양수
+ */
+int bench_cmp_u64( const void *a, const void *b){
+    uint64_t x = *( const uint64_t*)a;
+    uint64_t y = *( const uint64_t*)b;
+    return ( x > y) - ( x < y);
+}
+
+/**
+ * @fn uint64_t bench_percentile( uint64_t *samples, int count, double pct)
+ * @brief 측정값 배열을 정렬해서 백분위 값을 구하는 함수
+ * @return 백분위 값
+ * @param samples 측정값 배열 (정렬된다)
+ * @param count 측정값 개수
+ * @param pct 백분위 (0 ~ 100)
+ */
+uint64_t bench_percentile( uint64_t *samples, int count, double pct){
+    int index;
+
+    if( count <= 0){
+        return 0;
+    }
+    qsort( samples, count, sizeof( uint64_t), bench_cmp_u64);
+    index = ( int)( ( pct / 100.0) * ( count - 1));
+    return samples[ index];
+}
+
+/**
+ * @fn int bench_write_full( int fd, const void *buf, int len)
+ * @brief blocking 소켓에 len 바이트를 모두 쓰는 함수
+ * @return 정상이면 NORMAL, 실패하면 NEGATIVE_BYTE
+ */
+int bench_write_full( int fd, const void *buf, int len){
+    int done = 0;
+    int rv;
+
+    while( done < len){
+        if( ( rv = write( fd, ( const char*)buf + done, len - done)) <= 0){
+            if( ( rv < 0) && ( errno == EINTR)){
+                continue;
+            }
+            return NEGATIVE_BYTE;
+        }
+        done += rv;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int bench_read_full( int fd, void *buf, int len)
+ * @brief blocking 소켓에서 len 바이트를 모두 읽는 함수
+ * @return 정상이면 NORMAL, 끊기면 ZERO_BYTE, 실패하면 NEGATIVE_BYTE
+ */
+int bench_read_full( int fd, void *buf, int len){
+    int done = 0;
+    int rv;
+
+    while( done < len){
+        if( ( rv = read( fd, ( char*)buf + done, len - done)) < 0){
+            if( errno == EINTR){
+                continue;
+            }
+            return NEGATIVE_BYTE;
+        }
+        else if( rv == 0){
+            return ZERO_BYTE;
+        }
+        done += rv;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int bench_connect_tcp( const char *ip, int port)
+ * @brief server에 blocking TCP 연결을 맺는 함수 (Nagle 비활성화)
+ * @return 연결된 소켓, 실패하면 SOC_ERR
+ */
+int bench_connect_tcp( const char *ip, int port){
+    struct sockaddr_in addr;
+    int nodelay = 1;
+    int fd;
+
+    if( ( fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0){
+        return SOC_ERR;
+    }
+
+    memset( &addr, 0, sizeof( addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr( ip);
+    addr.sin_port = htons( port);
+    if( connect( fd, ( struct sockaddr*)&addr, sizeof( addr)) < 0){
+        close( fd);
+        return SOC_ERR;
+    }
+    setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof( nodelay));
+    return fd;
+}
+
+/**
+ * @fn int bench_connect_unix( const char *path)
+ * @brief server에 blocking unix domain socket 연결을 맺는 함수
+ * @return 연결된 소켓, 실패하면 SOC_ERR
+ */
+int bench_connect_unix( const char *path){
+    struct sockaddr_un addr;
+    int fd;
+
+    if( ( fd = socket( AF_UNIX, SOCK_STREAM, 0)) < 0){
+        return SOC_ERR;
+    }
+
+    memset( &addr, 0, sizeof( addr));
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, path, sizeof( addr.sun_path) - 1);
+    if( connect( fd, ( struct sockaddr*)&addr, sizeof( addr)) < 0){
+        close( fd);
+        return SOC_ERR;
+    }
+    return fd;
+}
+
+/**
+ * @fn int bench_make_frame( char *frame, int body_len, uint32_t code)
+ * @brief kmp_set_msg()로 body_len 크기의 메시지를 만들어 frame에 직렬화하는 함수
+ * @return 메시지 전체 길이 (헤더 + 바디)
+ * @param frame 메시지를 쓸 버퍼 (sizeof( kmp_t) 이상)
+ * @param body_len 바디 크기 (1 ~ DATA_MAX_LEN - 1)
+ * @param code 명령 코드
+ */
+int bench_make_frame( char *frame, int body_len, uint32_t code){
+    kmp_t msg[ 1];
+    char body[ DATA_MAX_LEN];
+
+    memset( body, 'a', body_len);
+    body[ body_len] = '\0';
+    kmp_set_msg( msg, 1, body, code);
+    memcpy( frame, msg, kmp_get_msg_length( msg));
+    return kmp_get_msg_length( msg);
+}
+
+/**
+ * @fn int bench_echo_run( int *fds, int conn_num, int body_len, int req_num, double *req_per_sec, double *usec_per_round)
+ * @brief conn_num 개의 연결에 요청을 하나씩 보내고 응답을 모두 받는 round를 반복해서 처리량을 구하는 함수
+ * 모든 연결이 동시에 요청 하나씩을 가지고 있으므로 server는 한 번의 epoll_wait 에서 여러 연결을 처리한다
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param fds server에 연결된 blocking 소켓 목록
+ * @param conn_num 연결 수
+ * @param body_len 메시지 바디 크기
+ * @param req_num 보낼 요청 수 (conn_num 단위로 내림)
+ * @param req_per_sec 초당 처리한 요청 수
+ * @param usec_per_round round 하나(모든 연결의 요청-응답)에 걸린 평균 시간 (us)
+ */
+int bench_echo_run( int *fds, int conn_num, int body_len, int req_num, double *req_per_sec, double *usec_per_round){
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    int len = bench_make_frame( frame, body_len, 1);
+    int rounds = req_num / conn_num;
+    uint64_t start, elapsed;
+    int i, j;
+
+    start = bench_now_ns();
+    for( i = 0; i < rounds; i++){
+        for( j = 0; j < conn_num; j++){
+            if( bench_write_full( fds[ j], frame, len) < NORMAL){
+                return SOC_ERR;
+            }
+        }
+        for( j = 0; j < conn_num; j++){
+            if( bench_read_full( fds[ j], reply, len) < NORMAL){
+                return SOC_ERR;
+            }
+        }
+    }
+    elapsed = bench_now_ns() - start;
+
+    *req_per_sec = ( double)rounds * conn_num * 1e9 / elapsed;
+    *usec_per_round = ( double)elapsed / rounds / 1000.0;
+    return NORMAL;
+}
+
+/**
+ * @fn int bench_get_stats( int port, char *out, int cap)
+ * @brief server 에 통계 요청(KMP_CODE_STATS)을 보내고 "key=value ..." 응답 바디를 받는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param port server TCP port
+ * @param out 응답 바디를 저장할 버퍼 (NUL 로 끝난다)
+ * @param cap 버퍼 크기
+ */
+int bench_get_stats( int port, char *out, int cap){
+    char frame[ sizeof( kmp_t)];
+    kmp_hdr_t hdr;
+    int fd, len, rv = SOC_ERR;
+
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, port)) < 0){
+        return SOC_ERR;
+    }
+    len = bench_make_frame( frame, 1, KMP_CODE_STATS);
+    if( ( bench_write_full( fd, frame, len) == NORMAL) && ( bench_read_full( fd, &hdr, sizeof( hdr)) == NORMAL)){
+        len = hdr.length - sizeof( hdr);
+        if( ( len >= 0) && ( len < cap) && ( bench_read_full( fd, out, len) == NORMAL)){
+            out[ len] = '\0';
+            rv = NORMAL;
+        }
+    }
+    close( fd);
+    return rv;
+}
+
+/**
+ * @fn double bench_stats_value( const char *stats, const char *key)
+ * @brief bench_get_stats() 결과에서 key 의 값을 찾는 함수
+ * @return 값, 없으면 -1
+ */
+double bench_stats_value( const char *stats, const char *key){
+    int key_len = strlen( key);
+    const char *p = stats;
+
+    while( ( p = strstr( p, key)) != NULL){
+        if( ( ( p == stats) || ( p[ -1] == ' ')) && ( p[ key_len] == '=')){
+            return atof( &p[ key_len + 1]);
+        }
+        p += key_len;
+    }
+    return -1;
+}
+
+/**
+ * @fn int bench_server_start( bench_server_t *server, const char *bin, int port, const char *unix_path, const char **opts)
+ * @brief 벤치마크 대상 server 프로세스를 띄우고 listen 할 때까지 기다리는 함수
+ * @return 정상이면 NORMAL, 실패하면 OBJECT_ERR
+ * @param server 띄운 프로세스 정보를 저장할 객체
+ * @param bin server 실행 파일 경로
+ * @param port TCP port
+ * @param unix_path unix domain socket 경로 (NULL 이면 TCP만 연다)
+ * @param opts ip 앞에 붙일 server 옵션 목록 (NULL로 끝남, 없으면 NULL)
+ */
+int bench_server_start( bench_server_t *server, const char *bin, int port, const char *unix_path, const char **opts){
+    const char *args[ 32];
+    char port_str[ 16];
+    int fd, retry;
+    int argc = 0;
+
+    snprintf( port_str, sizeof( port_str), "%d", port);
+    server->port = port;
+    server->unix_path[ 0] = '\0';
+    if( unix_path != NULL){
+        strncpy( server->unix_path, unix_path, sizeof( server->unix_path) - 1);
+    }
+
+    if( ( server->pid = fork()) < 0){
+        return OBJECT_ERR;
+    }
+    else if( server->pid == 0){
+        int null_fd = open( "/dev/null", O_WRONLY);
+        if( getenv( "BENCH_SERVER_LOG") == NULL){
+            dup2( null_fd, STDOUT_FILENO);
+        }
+        args[ argc++] = bin;
+        while( ( opts != NULL) && ( *opts != NULL) && ( argc < 27)){
+            args[ argc++] = *opts++;
+        }
+        args[ argc++] = BENCH_SERVER_IP;
+        args[ argc++] = port_str;
+        if( unix_path != NULL){
+            args[ argc++] = unix_path;
+        }
+        args[ argc] = NULL;
+        execv( bin, ( char* const*)args);
+        _exit( 127);
+    }
+
+    for( retry = 0; retry < 200; retry++){
+        usleep( 10000);
+        if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, port)) >= 0){
+            close( fd);
+            if( ( unix_path == NULL) || ( access( unix_path, F_OK) == 0)){
+                return NORMAL;
+            }
+        }
+    }
+
+    bench_server_stop( server);
+    return OBJECT_ERR;
+}
+
+/**
+ * @fn void bench_server_stop( bench_server_t *server)
+ * @brief 벤치마크 대상 server 프로세스를 종료하는 함수
+ * @return void
+ */
+void bench_server_stop( bench_server_t *server){
+    if( server->pid > 0){
+        kill( server->pid, SIGKILL);
+        waitpid( server->pid, NULL, 0);
+        server->pid = 0;
+    }
+    if( server->unix_path[ 0] != '\0'){
+        unlink( server->unix_path);
+    }
+}
+
+/**
+ * @fn uint64_t bench_proc_cpu_ns( pid_t pid)
+ * @brief 프로세스가 지금까지 사용한 CPU 시간(user + system)을 구하는 함수
+ * @return CPU 시간 (ns), 구할 수 없으면 0
+ * @param pid 확인할 프로세스 id
+ */
+uint64_t bench_proc_cpu_ns( pid_t pid){
+    char path[ 64];
+    char buf[ 1024];
+    unsigned long utime, stime;
+    char *p;
+    FILE *fp;
+
+    snprintf( path, sizeof( path), "/proc/%d/stat", ( int)pid);
+    if( ( fp = fopen( path, "r")) == NULL){
+        return 0;
+    }
+    if( fgets( buf, sizeof( buf), fp) == NULL){
+        fclose( fp);
+        return 0;
+    }
+    fclose( fp);
+
+    // comm에 공백이 있을 수 있으므로 마지막 ')' 이후부터 해석한다 (state가 3번째 필드)
+    if( ( p = strrchr( buf, ')')) == NULL){
+        return 0;
+    }
+    if( sscanf( p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2){
+        return 0;
+    }
+    return ( uint64_t)( utime + stime) * ( 1000000000ULL / sysconf( _SC_CLK_TCK));
+}
+
+// ----------------------------------------------------------
+
+static FILE *bench_json_fp = NULL;
+static int bench_json_count = 0;
+
+/**
+ * @fn int bench_json_open( const char *path)
+ * @brief 측정 결과를 기록할 JSON 파일을 여는 함수
+ * 결과 하나가 한 줄을 차지하므로 bench_compare 에서 한 줄씩 읽어서 비교할 수 있다
+ * @return 정상이면 NORMAL, 실패하면 OBJECT_ERR
+ * @param path JSON 파일 경로 (NULL 이면 기록하지 않는다)
+ */
+int bench_json_open( const char *path){
+    if( path == NULL){
+        return NORMAL;
+    }
+    if( ( bench_json_fp = fopen( path, "w")) == NULL){
+        printf("	| ! Bench : Failed to open %s\n", path);
+        return OBJECT_ERR;
+    }
+    bench_json_count = 0;
+    fprintf( bench_json_fp, "{\n  \"results\": [\n");
+    return NORMAL;
+}
+
+/**
+ * @fn void bench_json_add( const char *name, double value, const char *unit, int is_lower_better)
+ * @brief 측정 결과 하나를 JSON 파일에 추가하는 함수
+ * @return void
+ * @param name 측정 항목 이름 (baseline과 비교할 때의 key)
+ * @param value 측정 값
+ * @param unit 단위 (ns/op, req/s 등)
+ * @param is_lower_better 값이 작을수록 좋은 항목이면 1
+ */
+void bench_json_add( const char *name, double value, const char *unit, int is_lower_better){
+    if( bench_json_fp == NULL){
+        return;
+    }
+    fprintf( bench_json_fp, "%s    {\"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\", \"lower_is_better\": %d}",
+            ( bench_json_count > 0) ? ",\n" : "", name, value, unit, is_lower_better);
+    bench_json_count++;
+}
+
+/**
+ * @fn void bench_json_close()
+ * @brief JSON 파일을 마무리하고 닫는 함수
+ * @return void
+ */
+void bench_json_close(){
+    if( bench_json_fp == NULL){
+        return;
+    }
+    fprintf( bench_json_fp, "\n  ]\n}\n");
+    fclose( bench_json_fp);
+    bench_json_fp = NULL;
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn pid_t bench_perf_start( pid_t pid, const char *out_path)
+ * @brief server 프로세스에 perf stat 을 붙여서 cache miss 를 세기 시작하는 함수
+ * @return perf 프로세스 id, 실행할 수 없으면 0
+ * @param pid 측정할 server 프로세스 id
+ * @param out_path perf stat 결과(CSV)를 쓸 파일 경로
+ */
+pid_t bench_perf_start( pid_t pid, const char *out_path){
+    char pid_str[ 16];
+    pid_t perf_pid;
+
+    snprintf( pid_str, sizeof( pid_str), "%d", ( int)pid);
+    unlink( out_path);
+    if( ( perf_pid = fork()) < 0){
+        return 0;
+    }
+    else if( perf_pid == 0){
+        execlp( "perf", "perf", "stat", "-x", ",", "-e", BENCH_PERF_EVENTS, "-o", out_path, "-p", pid_str, ( char*)NULL);
+        _exit( 127);
+    }
+
+    // perf 가 counter를 붙일 시간을 준다
+    usleep( 200000);
+    return perf_pid;
+}
+
+/**
+ * @fn int bench_perf_stop( pid_t perf_pid, const char *out_path, uint64_t msgs)
+ * @brief perf stat 을 끝내고 event 별 값을 메시지 하나당 값으로 출력하는 함수
+ * @return 정상이면 NORMAL, perf를 사용할 수 없으면 NOT_EXIST
+ * @param perf_pid bench_perf_start() 가 돌려준 perf 프로세스 id
+ * @param out_path perf stat 결과 파일 경로
+ * @param msgs 측정 동안 처리한 메시지 수
+ */
+int bench_perf_stop( pid_t perf_pid, const char *out_path, uint64_t msgs){
+    char line[ 256];
+    char event[ 64];
+    char name[ 96];
+    char *unit, *field;
+    double value;
+    int status = 0;
+    int count = 0;
+    FILE *fp;
+
+    if( perf_pid <= 0){
+        return NOT_EXIST;
+    }
+    kill( perf_pid, SIGINT);
+    waitpid( perf_pid, &status, 0);
+    if( ( WIFEXITED( status) && ( WEXITSTATUS( status) == 127)) || ( ( fp = fopen( out_path, "r")) == NULL)){
+        printf("	| ! Bench : perf is not available\n");
+        return NOT_EXIST;
+    }
+
+    // CSV 형식 : 값,단위,event,...  (단위는 비어 있을 수 있고, 지원하지 않는 event 는 값이 <not supported>)
+    while( fgets( line, sizeof( line), fp) != NULL){
+        if( ( ( unit = strchr( line, ',')) == NULL) || ( ( field = strchr( unit + 1, ',')) == NULL)){
+            continue;
+        }
+        if( sscanf( field + 1, "%63[^,\n]", event) != 1){
+            continue;
+        }
+        if( sscanf( line, "%lf,", &value) == 1){
+            snprintf( name, sizeof( name), "perf.%s_per_msg", event);
+            printf("| %-28s | %10.3f |\n", name, value / msgs);
+            bench_json_add( name, value / msgs, "count/msg", 1);
+            count++;
+        }
+        else{
+            printf("| %-28s | %10s |\n", event, "n/a");
+        }
+    }
+    fclose( fp);
+    return ( count > 0) ? NORMAL : NOT_EXIST;
+}
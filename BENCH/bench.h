@@ -0,0 +1,68 @@
+#pragma once
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+
+#define BENCH_SERVER_IP "127.0.0.1"
+#define BENCH_SERVER_PORT 18000
+#define BENCH_UNIX_PATH "/tmp/kmp_bench.sock"
+/// perf stat 으로 세는 event (메시지 하나당 값으로 환산해서 출력한다)
+#define BENCH_PERF_EVENTS "cache-misses,cache-references,L1-dcache-load-misses,instructions"
+
+/// @struct bench_server_t
+/// @brief 벤치마크 동안 띄워 두는 server 프로세스 정보
+typedef struct bench_server_s bench_server_t;
+struct bench_server_s{
+    /// server 프로세스 id
+    pid_t pid;
+    /// TCP port
+    int port;
+    /// unix domain socket 경로 (없으면 빈 문자열)
+    char unix_path[ 108];
+};
+
+uint64_t bench_now_ns();
+int bench_cmp_u64( const void *a, const void *b);
+uint64_t bench_percentile( uint64_t *samples, int count, double pct);
+
+int bench_write_full( int fd, const void *buf, int len);
+int bench_read_full( int fd, void *buf, int len);
+int bench_connect_tcp( const char *ip, int port);
+int bench_connect_unix( const char *path);
+int bench_make_frame( char *frame, int body_len, uint32_t code);
+int bench_echo_run( int *fds, int conn_num, int body_len, int req_num, double *req_per_sec, double *usec_per_round);
+
+int bench_get_stats( int port, char *out, int cap);
+double bench_stats_value( const char *stats, const char *key);
+int bench_server_start( bench_server_t *server, const char *bin, int port, const char *unix_path, const char **opts);
+void bench_server_stop( bench_server_t *server);
+uint64_t bench_proc_cpu_ns( pid_t pid);
+
+int bench_json_open( const char *path);
+void bench_json_add( const char *name, double value, const char *unit, int is_lower_better);
+void bench_json_close();
+
+pid_t bench_perf_start( pid_t pid, const char *out_path);
+int bench_perf_stop( pid_t perf_pid, const char *out_path, uint64_t msgs);
+
+#endif
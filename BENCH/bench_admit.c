@@ -0,0 +1,179 @@
+#include "bench.h"
+
+#define BENCH_ADMIT_PORT ( BENCH_SERVER_PORT + 50)
+#define BENCH_WORK_US "50"
+#define BENCH_FLOOD_APP_ID 1
+#define BENCH_FLOOD_CONN_NUM 32
+#define BENCH_FLOOD_WINDOW 4
+#define BENCH_GOOD_APP_ID 2
+#define BENCH_GOOD_INTERVAL_US 2000
+#define BENCH_RUN_MS 3000
+#define BENCH_BODY_LEN 256
+#define BENCH_SAMPLE_MAX 4096
+
+/**
+ * @fn static int bench_admit_frame( char *frame, uint32_t app_id)
+ * @brief app_id 를 지정한 요청 메시지를 만드는 함수
+ * @return 메시지 길이
+ */
+static int bench_admit_frame( char *frame, uint32_t app_id){
+    int len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+
+    ( ( kmp_hdr_t*)frame)->app_id = app_id;
+    return len;
+}
+
+/**
+ * @fn static int bench_admit_read_reply( int fd, char *reply)
+ * @brief 응답 하나를 읽는 함수 (거절 응답은 헤더만 있다)
+ * @return 정상 응답이면 NORMAL, 거절 응답이면 1, 실패하면 SOC_ERR
+ */
+static int bench_admit_read_reply( int fd, char *reply){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)reply;
+
+    if( bench_read_full( fd, reply, sizeof( kmp_hdr_t)) < NORMAL){
+        return SOC_ERR;
+    }
+    if( ( hdr->length < sizeof( kmp_hdr_t)) || ( hdr->length > sizeof( kmp_t))){
+        return SOC_ERR;
+    }
+    if( ( hdr->length > sizeof( kmp_hdr_t)) && ( bench_read_full( fd, &reply[ sizeof( kmp_hdr_t)], hdr->length - sizeof( kmp_hdr_t)) < NORMAL)){
+        return SOC_ERR;
+    }
+    return ( hdr->code == KMP_CODE_OVERLOAD) ? 1 : NORMAL;
+}
+
+/**
+ * @fn static void bench_admit_flood( int port, int run_ms)
+ * @brief 한 tenant(app_id 1)가 연결 여러 개로 요청을 쉬지 않고 보내는 부하 생성기 (자식 프로세스에서 실행)
+ * @return void
+ */
+static void bench_admit_flood( int port, int run_ms){
+    int fds[ BENCH_FLOOD_CONN_NUM];
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    uint64_t end = bench_now_ns() + ( uint64_t)run_ms * 1000000;
+    uint64_t ok = 0, rejected = 0;
+    int i, j, rv, len;
+
+    for( i = 0; i < BENCH_FLOOD_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, port)) < 0){
+            _exit( 1);
+        }
+    }
+    len = bench_admit_frame( frame, BENCH_FLOOD_APP_ID);
+
+    while( bench_now_ns() < end){
+        for( i = 0; i < BENCH_FLOOD_CONN_NUM; i++){
+            for( j = 0; j < BENCH_FLOOD_WINDOW; j++){
+                bench_write_full( fds[ i], frame, len);
+            }
+        }
+        for( i = 0; i < BENCH_FLOOD_CONN_NUM; i++){
+            for( j = 0; j < BENCH_FLOOD_WINDOW; j++){
+                if( ( rv = bench_admit_read_reply( fds[ i], reply)) < NORMAL){
+                    _exit( 1);
+                }
+                ( rv == NORMAL) ? ok++ : rejected++;
+            }
+        }
+    }
+    printf("	| @ Bench : flood tenant ok %llu, rejected %llu (%.0f req/s served)\n",
+            ( unsigned long long)ok, ( unsigned long long)rejected, ok * 1000.0 / run_ms);
+    _exit( 0);
+}
+
+/**
+ * @fn static int bench_admit_scenario( const char *bin, const char *name, const char **opts, int is_flood)
+ * @brief server 를 띄우고 (선택적으로 flood tenant 와 함께) 정상 tenant 의 요청 지연을 재는 함수
+ * 정상 tenant 는 BENCH_GOOD_INTERVAL_US 마다 요청 하나를 보내고 응답을 기다린다
+ * @return 정상이면 NORMAL, 실패하면 열거형 참고
+ */
+static int bench_admit_scenario( const char *bin, const char *name, const char **opts, int is_flood){
+    static uint64_t samples[ BENCH_SAMPLE_MAX];
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    char stats[ 1024];
+    bench_server_t server;
+    uint64_t start, end, t;
+    int fd, len, rv, count = 0, rejected = 0;
+    pid_t flood_pid = 0;
+
+    if( bench_server_start( &server, bin, BENCH_ADMIT_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return OBJECT_ERR;
+    }
+    if( is_flood && ( ( flood_pid = fork()) == 0)){
+        bench_admit_flood( BENCH_ADMIT_PORT, BENCH_RUN_MS);
+    }
+    // flood 가 연결을 맺고 부하가 쌓일 시간을 준다
+    usleep( 200000);
+
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_ADMIT_PORT)) < 0){
+        rv = SOC_ERR;
+        goto out;
+    }
+    len = bench_admit_frame( frame, BENCH_GOOD_APP_ID);
+    end = bench_now_ns() + ( uint64_t)( BENCH_RUN_MS - 500) * 1000000;
+    while( ( count < BENCH_SAMPLE_MAX) && ( bench_now_ns() < end)){
+        start = bench_now_ns();
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( ( rv = bench_admit_read_reply( fd, reply)) < NORMAL)){
+            close( fd);
+            rv = SOC_ERR;
+            goto out;
+        }
+        t = bench_now_ns() - start;
+        if( rv == NORMAL){
+            samples[ count++] = t;
+        }
+        else{
+            rejected++;
+        }
+        if( t < BENCH_GOOD_INTERVAL_US * 1000){
+            usleep( BENCH_GOOD_INTERVAL_US - t / 1000);
+        }
+    }
+    close( fd);
+
+    printf("| %-22s | %6d | %8d | %9.1f | %9.1f | %9.1f |\n", name, count, rejected,
+            bench_percentile( samples, count, 50) / 1000.0, bench_percentile( samples, count, 99) / 1000.0,
+            bench_percentile( samples, count, 100) / 1000.0);
+    if( bench_get_stats( BENCH_ADMIT_PORT, stats, sizeof( stats)) == NORMAL){
+        printf("	| @ Bench : server stats : %s\n", stats);
+    }
+    rv = NORMAL;
+
+out:
+    if( flood_pid > 0){
+        waitpid( flood_pid, NULL, 0);
+    }
+    bench_server_stop( &server);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief admission control 부하 시험
+ * 요청마다 BENCH_WORK_US 의 처리 비용이 드는 server 에 한 tenant 가 처리량 이상으로 요청을 보낼 때
+ * 다른 tenant 의 지연이 admission control 유무에 따라 어떻게 달라지는지 비교한다
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *plain_opts[] = { "-W", BENCH_WORK_US, NULL};
+    const char *rate_opts[] = { "-W", BENCH_WORK_US, "-L", "2000:200", NULL};
+    const char *admit_opts[] = { "-W", BENCH_WORK_US, "-L", "2000:200", "-A", "2000", NULL};
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    printf("| %-22s | %6s | %8s | %9s | %9s | %9s |\n", "good tenant (us)", "ok", "rejected", "p50", "p99", "max");
+    if( ( bench_admit_scenario( bin, "idle", plain_opts, 0) < NORMAL)
+            || ( bench_admit_scenario( bin, "flood, no admission", plain_opts, 1) < NORMAL)
+            || ( bench_admit_scenario( bin, "flood, -L", rate_opts, 1) < NORMAL)
+            || ( bench_admit_scenario( bin, "flood, -L -A", admit_opts, 1) < NORMAL)){
+        printf("	| ! Bench : admission run failed\n");
+        return UNKNOWN;
+    }
+    return NORMAL;
+}
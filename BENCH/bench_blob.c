@@ -0,0 +1,363 @@
+#include "bench.h"
+#include "../SERVER/blob.h"
+#include "../COMMON/crc32c.h"
+
+#define BENCH_BLOB_PORT ( BENCH_SERVER_PORT + 120)
+/// 처리량을 재는 blob 크기와 크기마다 보내는 바이트 수
+#define BENCH_BLOB_TOTAL ( 512 << 20)
+#define BENCH_BLOB_REQS_MAX 20000
+/// server 가 다시 확인하기를 기다리는 시간 (ms, BLOB_CHECK_MS 보다 길게)
+#define BENCH_BLOB_CHECK_WAIT_MS 1200
+/// 응답 헤더 code 가 바뀌는 echo 와 비교하는 바디 길이 (write 버퍼 한도 안)
+#define BENCH_BLOB_ECHO_LEN 1000
+
+/// @struct bench_blob_file_t
+/// @brief blob 디렉토리에 만드는 파일 하나
+typedef struct bench_blob_file_s bench_blob_file_t;
+struct bench_blob_file_s{
+    const char *name;
+    int size;
+    /// 이 이름을 요청하면 파일 내용을 받아야 하는지 여부 (0 이면 KMP_CODE_UNAVAILABLE)
+    int is_served;
+};
+
+static const bench_blob_file_t bench_blob_files[] = {
+    { "empty", 0, 1},
+    { "small", 100, 1},
+    { "page", 4096, 1},
+    { "64k", 64 << 10, 1},
+    { "1m", 1 << 20, 1},
+    { "max", BLOB_SIZE_MAX, 1},
+    // 헤더 length 에 담을 수 없는 크기
+    { "too_big", BLOB_SIZE_MAX + 1, 0},
+};
+
+/**
+ * @fn static void bench_blob_fill( char *buf, int len, uint32_t seed)
+ * @brief 파일 내용을 seed 로 정해지는 바이트로 채우는 함수 (다른 offset 의 바이트를 보냈으면 달라진다)
+ * @return void
+ */
+static void bench_blob_fill( char *buf, int len, uint32_t seed){
+    uint32_t x = seed * 2654435761u + 1;
+    int i;
+
+    for( i = 0; i < len; i++){
+        x = x * 1664525u + 1013904223u;
+        buf[ i] = ( char)( x >> 24);
+    }
+}
+
+/**
+ * @fn static int bench_blob_write_file( const char *dir, const char *name, const char *buf, int len)
+ * @brief dir/name 파일을 만드는 함수 (임시 파일에 쓰고 rename 하므로 server 는 다 쓴 파일만 본다)
+ * @return 정상이면 NORMAL, 실패하면 FD_ERR
+ */
+static int bench_blob_write_file( const char *dir, const char *name, const char *buf, int len){
+    char tmp[ 512];
+    char path[ 512];
+    int fd, rv;
+
+    snprintf( tmp, sizeof( tmp), "%s/.%s.tmp", dir, name);
+    snprintf( path, sizeof( path), "%s/%s", dir, name);
+    if( ( fd = open( tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0){
+        return FD_ERR;
+    }
+    rv = ( ( len == 0) || ( bench_write_full( fd, buf, len) == NORMAL)) ? NORMAL : FD_ERR;
+    close( fd);
+    if( ( rv == NORMAL) && ( rename( tmp, path) < 0)){
+        rv = FD_ERR;
+    }
+    return rv;
+}
+
+/**
+ * @fn static int bench_blob_request( int fd, const char *name, kmp_hdr_t *hdr, char *body, int cap)
+ * @brief KMP_CODE_BLOB 요청 하나를 보내고 응답을 받는 함수
+ * @return 받은 바디 길이, 실패하면 SOC_ERR (바디가 cap 보다 길면 읽어서 버린다)
+ * @param hdr 받은 응답 헤더
+ * @param body 응답 바디를 받을 버퍼 (NULL 이면 읽어서 버린다)
+ */
+static int bench_blob_request( int fd, const char *name, kmp_hdr_t *hdr, char *body, int cap){
+    char frame[ sizeof( kmp_hdr_t) + 256];
+    char drop[ 65536];
+    kmp_hdr_t *req = ( kmp_hdr_t*)frame;
+    int name_len = strlen( name);
+    int len, off, chunk;
+
+    memset( req, 0, sizeof( kmp_hdr_t));
+    req->version = 1;
+    req->code = KMP_CODE_BLOB;
+    req->length = sizeof( kmp_hdr_t) + name_len;
+    memcpy( &frame[ sizeof( kmp_hdr_t)], name, name_len);
+    if( ( bench_write_full( fd, frame, req->length) < NORMAL) || ( bench_read_full( fd, hdr, sizeof( kmp_hdr_t)) < NORMAL)){
+        return SOC_ERR;
+    }
+    len = hdr->length - sizeof( kmp_hdr_t);
+    if( ( body != NULL) && ( len <= cap)){
+        return ( bench_read_full( fd, body, len) == NORMAL) ? len : SOC_ERR;
+    }
+    for( off = 0; off < len; off += chunk){
+        chunk = ( len - off < ( int)sizeof( drop)) ? len - off : ( int)sizeof( drop);
+        if( bench_read_full( fd, drop, chunk) < NORMAL){
+            return SOC_ERR;
+        }
+    }
+    return len;
+}
+
+/**
+ * @fn static int bench_blob_check( int fd, const char *label, const char *name, const char *expect, int expect_len, char *body)
+ * @brief 이름을 요청해서 expect 와 같은 바디를 받는지 (expect 가 NULL 이면 헤더만 있는 KMP_CODE_UNAVAILABLE 인지) 확인하는 함수
+ * @return 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_blob_check( int fd, const char *label, const char *name, const char *expect, int expect_len, char *body){
+    kmp_hdr_t hdr;
+    int len, ok;
+
+    len = bench_blob_request( fd, name, &hdr, body, BLOB_SIZE_MAX);
+    if( expect != NULL){
+        ok = ( len == expect_len) && ( hdr.code == KMP_CODE_BLOB) && ( memcmp( body, expect, len) == 0);
+    }
+    else{
+        ok = ( len == 0) && ( hdr.code == KMP_CODE_UNAVAILABLE);
+    }
+    printf("| %-28s | %6s | (%s, %d bytes, code 0x%x)\n", label, ok ? "ok" : "FAIL", name, len, ( unsigned)hdr.code);
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static int bench_blob_crc_check( int fd, const char *label, const char *name, const char *expect, int expect_len)
+ * @brief KMP_FLAG_CRC 를 붙인 요청의 응답이 CRC32C trailer 를 달고 오고, 떼어낸 바디가 expect 와 같은지 확인하는 함수
+ * @return 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_blob_crc_check( int fd, const char *label, const char *name, const char *expect, int expect_len){
+    char frame[ sizeof( kmp_hdr_t) + 256 + KMP_CRC_LEN];
+    kmp_hdr_t *req = ( kmp_hdr_t*)frame;
+    kmp_hdr_t hdr;
+    char *reply = NULL;
+    int name_len = strlen( name);
+    int len = SOC_ERR, ok = 0;
+
+    memset( &hdr, 0, sizeof( hdr));
+    memset( req, 0, sizeof( kmp_hdr_t));
+    req->version = 1;
+    req->code = KMP_CODE_BLOB;
+    req->length = sizeof( kmp_hdr_t) + name_len;
+    memcpy( &frame[ sizeof( kmp_hdr_t)], name, name_len);
+    if( ( bench_write_full( fd, frame, crc32c_frame_seal( frame, req->length, sizeof( frame))) == NORMAL)
+            && ( bench_read_full( fd, &hdr, sizeof( hdr)) == NORMAL) && ( ( reply = ( char*)malloc( hdr.length)) != NULL)){
+        memcpy( reply, &hdr, sizeof( hdr));
+        if( bench_read_full( fd, &reply[ sizeof( hdr)], hdr.length - sizeof( hdr)) == NORMAL){
+            len = crc32c_frame_check( reply, hdr.length);
+        }
+        ok = ( hdr.flag & KMP_FLAG_CRC) && ( len == ( int)sizeof( hdr) + expect_len)
+            && ( memcmp( &reply[ sizeof( hdr)], expect, expect_len) == 0);
+    }
+    printf("| %-28s | %6s | (%s, %d bytes, code 0x%x)\n", label, ok ? "ok" : "FAIL", name, len - ( int)sizeof( hdr), ( unsigned)hdr.code);
+    free( reply);
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static int bench_blob_throughput( bench_server_t *server, int fd, const char *name, int size)
+ * @brief 같은 blob 을 반복해서 받아 처리량과 server 가 바이트당 쓰는 CPU 를 재는 함수
+ * @return 정상이면 NORMAL, 실패하면 UNKNOWN
+ */
+static int bench_blob_throughput( bench_server_t *server, int fd, const char *name, int size){
+    kmp_hdr_t hdr;
+    int reqs = ( size > 0) ? BENCH_BLOB_TOTAL / size : BENCH_BLOB_REQS_MAX;
+    uint64_t start, elapsed, cpu;
+    int i;
+
+    if( reqs > BENCH_BLOB_REQS_MAX){
+        reqs = BENCH_BLOB_REQS_MAX;
+    }
+    cpu = bench_proc_cpu_ns( server->pid);
+    start = bench_now_ns();
+    for( i = 0; i < reqs; i++){
+        if( bench_blob_request( fd, name, &hdr, NULL, 0) != size){
+            return UNKNOWN;
+        }
+    }
+    elapsed = bench_now_ns() - start;
+    cpu = bench_proc_cpu_ns( server->pid) - cpu;
+    printf("| %-10s | %10d | %8d | %10.0f | %10.1f | %12.2f |\n", name, size, reqs, reqs / ( elapsed / 1e9),
+            ( double)size * reqs / ( elapsed / 1e9) / ( 1 << 20), ( double)cpu / ( ( double)size * reqs / 1024));
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_blob_echo( bench_server_t *server, int fd)
+ * @brief 비교용으로 write 버퍼에 복사해서 보내는 echo 응답의 처리량을 재는 함수 (응답 바디가 1 KB 이하로 묶인다)
+ * @return 정상이면 NORMAL, 실패하면 UNKNOWN
+ */
+static int bench_blob_echo( bench_server_t *server, int fd){
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    int len = bench_make_frame( frame, BENCH_BLOB_ECHO_LEN, 1);
+    int reqs = BENCH_BLOB_REQS_MAX;
+    uint64_t start, elapsed, cpu;
+    int i;
+
+    cpu = bench_proc_cpu_ns( server->pid);
+    start = bench_now_ns();
+    for( i = 0; i < reqs; i++){
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, len) < NORMAL)){
+            return UNKNOWN;
+        }
+    }
+    elapsed = bench_now_ns() - start;
+    cpu = bench_proc_cpu_ns( server->pid) - cpu;
+    printf("| %-10s | %10d | %8d | %10.0f | %10.1f | %12.2f |\n", "(echo)", BENCH_BLOB_ECHO_LEN, reqs, reqs / ( elapsed / 1e9),
+            ( double)BENCH_BLOB_ECHO_LEN * reqs / ( elapsed / 1e9) / ( 1 << 20), ( double)cpu / ( ( double)BENCH_BLOB_ECHO_LEN * reqs / 1024));
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_blob_run( const char *bin, const char *dir, char **contents, char *body, int is_workers)
+ * @brief server 를 띄우고 blob 응답 내용 / 이름 검사 / fd cache / 파일 교체 / 처리량을 확인하는 함수
+ * @return 모두 맞으면 NORMAL, 아니면 UNKNOWN
+ * @param is_workers worker 2 개로 띄울지 여부 (내용과 이름 검사만 한다)
+ */
+static int bench_blob_run( const char *bin, const char *dir, char **contents, char *body, int is_workers){
+    const char *opts[] = { "-O", dir, is_workers ? "-N" : NULL, "2", NULL};
+    const char *bad_names[] = { "missing", "../etc/passwd", "/etc/passwd", ".hidden", "sub", "sub/x", "too_big"};
+    bench_server_t server;
+    char stats[ 2048];
+    char label[ 64];
+    double opens;
+    int fd, rv = NORMAL;
+    int i;
+
+    if( bench_server_start( &server, bin, BENCH_BLOB_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_BLOB_PORT)) < 0){
+        bench_server_stop( &server);
+        return UNKNOWN;
+    }
+
+    // 파일마다 두 번씩 받는다 (두 번째는 열어 둔 fd 로 보낸다)
+    for( i = 0; i < ( int)( sizeof( bench_blob_files) / sizeof( bench_blob_files[ 0])); i++){
+        if( bench_blob_files[ i].is_served == 0){
+            continue;
+        }
+        snprintf( label, sizeof( label), "blob%s.content", is_workers ? ".workers" : "");
+        if( ( bench_blob_check( fd, label, bench_blob_files[ i].name, contents[ i], bench_blob_files[ i].size, body) < NORMAL)
+                || ( bench_blob_check( fd, label, bench_blob_files[ i].name, contents[ i], bench_blob_files[ i].size, body) < NORMAL)){
+            rv = UNKNOWN;
+        }
+        snprintf( label, sizeof( label), "blob%s.crc", is_workers ? ".workers" : "");
+        if( bench_blob_crc_check( fd, label, bench_blob_files[ i].name, contents[ i], bench_blob_files[ i].size) < NORMAL){
+            rv = UNKNOWN;
+        }
+    }
+    for( i = 0; i < ( int)( sizeof( bad_names) / sizeof( bad_names[ 0])); i++){
+        snprintf( label, sizeof( label), "blob%s.rejected", is_workers ? ".workers" : "");
+        if( bench_blob_check( fd, label, bad_names[ i], NULL, 0, body) < NORMAL){
+            rv = UNKNOWN;
+        }
+    }
+    if( is_workers){
+        close( fd);
+        bench_server_stop( &server);
+        return rv;
+    }
+
+    // 같은 이름은 한 번만 연다 (stats 연결은 다른 요청을 하지 않는다)
+    if( bench_get_stats( BENCH_BLOB_PORT, stats, sizeof( stats)) == NORMAL){
+        opens = bench_stats_value( stats, "blob_opens");
+        printf("| %-28s | %6s | (blob_opens %.0f, blob_hits %.0f, blob_misses %.0f)\n", "blob.fd_cache",
+                ( opens == 6) ? "ok" : "FAIL", opens, bench_stats_value( stats, "blob_hits"), bench_stats_value( stats, "blob_misses"));
+        if( opens != 6){
+            rv = UNKNOWN;
+        }
+    }
+    else{
+        rv = UNKNOWN;
+    }
+
+    // 파일을 바꾸면 확인 간격이 지난 뒤에는 새 내용을 보낸다
+    bench_blob_fill( contents[ 1], bench_blob_files[ 1].size + 50, 99);
+    if( bench_blob_write_file( dir, "small", contents[ 1], bench_blob_files[ 1].size + 50) < NORMAL){
+        rv = UNKNOWN;
+    }
+    usleep( BENCH_BLOB_CHECK_WAIT_MS * 1000);
+    if( bench_blob_check( fd, "blob.replaced", "small", contents[ 1], bench_blob_files[ 1].size + 50, body) < NORMAL){
+        rv = UNKNOWN;
+    }
+
+    if( rv == NORMAL){
+        printf("| %-10s | %10s | %8s | %10s | %10s | %12s |\n", "blob", "bytes", "reqs", "req/s", "MB/s", "srv ns/KB");
+        if( ( bench_blob_echo( &server, fd) < NORMAL)
+                || ( bench_blob_throughput( &server, fd, "page", bench_blob_files[ 2].size) < NORMAL)
+                || ( bench_blob_throughput( &server, fd, "64k", bench_blob_files[ 3].size) < NORMAL)
+                || ( bench_blob_throughput( &server, fd, "1m", bench_blob_files[ 4].size) < NORMAL)
+                || ( bench_blob_throughput( &server, fd, "max", bench_blob_files[ 5].size) < NORMAL)){
+            rv = UNKNOWN;
+        }
+    }
+    close( fd);
+    bench_server_stop( &server);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief KMP_CODE_BLOB 응답 (sendfile) 이 파일 내용을 그대로 보내는지 확인하고 크기별 처리량을 재는 벤치마크
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로 (기본 ../SERVER/server)
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    int file_num = sizeof( bench_blob_files) / sizeof( bench_blob_files[ 0]);
+    char *contents[ sizeof( bench_blob_files) / sizeof( bench_blob_files[ 0])];
+    char dir[ 256];
+    char path[ 512];
+    char *body;
+    int rv = NORMAL;
+    int i;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    snprintf( dir, sizeof( dir), "/tmp/kmp_bench_blob.%d", ( int)getpid());
+    if( ( mkdir( dir, 0755) < 0) || ( ( body = ( char*)malloc( BLOB_SIZE_MAX + 1)) == NULL)){
+        printf("	| ! Bench : Failed to make blob directory (%s)\n", dir);
+        return UNKNOWN;
+    }
+    snprintf( path, sizeof( path), "%s/sub", dir);
+    mkdir( path, 0755);
+    for( i = 0; i < file_num; i++){
+        // "small" 은 나중에 더 길게 바꾼다
+        if( ( contents[ i] = ( char*)malloc( bench_blob_files[ i].size + 64)) == NULL){
+            return UNKNOWN;
+        }
+        bench_blob_fill( contents[ i], bench_blob_files[ i].size, i);
+        if( bench_blob_write_file( dir, bench_blob_files[ i].name, contents[ i], bench_blob_files[ i].size) < NORMAL){
+            printf("	| ! Bench : Failed to write blob (%s)\n", bench_blob_files[ i].name);
+            rv = UNKNOWN;
+        }
+    }
+    snprintf( path, sizeof( path), "%s/.hidden", dir);
+    symlink( "/etc/passwd", path);
+    printf("	| @ Bench : blobs in %s, reply header then sendfile body\n", dir);
+
+    if( ( rv == NORMAL) && ( ( bench_blob_run( bin, dir, contents, body, 1) < NORMAL) || ( bench_blob_run( bin, dir, contents, body, 0) < NORMAL))){
+        rv = UNKNOWN;
+    }
+
+    for( i = 0; i < file_num; i++){
+        snprintf( path, sizeof( path), "%s/%s", dir, bench_blob_files[ i].name);
+        unlink( path);
+        free( contents[ i]);
+    }
+    snprintf( path, sizeof( path), "%s/.hidden", dir);
+    unlink( path);
+    snprintf( path, sizeof( path), "%s/sub", dir);
+    rmdir( path);
+    rmdir( dir);
+    free( body);
+    return rv;
+}
@@ -0,0 +1,200 @@
+#include "bench.h"
+#include <sys/resource.h>
+
+#define BENCH_C1M_PORT ( BENCH_SERVER_PORT + 110)
+/// 목표 연결 수 (fd 한도가 낮으면 한도까지만 연다)
+#define BENCH_C1M_CONN_MAX 1000000
+/// bench 와 server 가 연결 말고 쓰는 fd 수
+#define BENCH_C1M_FD_RESERVE 128
+/// source ip 하나로 여는 최대 연결 수 (ephemeral port 범위보다 작게, 넘으면 127.0.0.x 를 바꾼다)
+#define BENCH_C1M_CONN_PER_IP 25000
+/// 요청 바디 길이
+#define BENCH_C1M_BODY_LEN 64
+/// idle 이 된 뒤 RSS 를 재기 전에 기다리는 시간 (ms)
+#define BENCH_C1M_SETTLE_MS 200
+
+/**
+ * @fn static long bench_c1m_rss_kb( pid_t pid)
+ * @brief 프로세스의 resident memory (VmRSS) 를 구하는 함수
+ * @return RSS (KB), 구할 수 없으면 -1
+ * @param pid 확인할 프로세스 id
+ */
+static long bench_c1m_rss_kb( pid_t pid){
+    char path[ 64];
+    char line[ 256];
+    long rss = -1;
+    FILE *fp;
+
+    snprintf( path, sizeof( path), "/proc/%d/status", ( int)pid);
+    if( ( fp = fopen( path, "r")) == NULL){
+        return -1;
+    }
+    while( fgets( line, sizeof( line), fp) != NULL){
+        if( sscanf( line, "VmRSS: %ld kB", &rss) == 1){
+            break;
+        }
+    }
+    fclose( fp);
+    return rss;
+}
+
+/**
+ * @fn static int bench_c1m_connect( int idx)
+ * @brief 연결 번호에 따라 source ip 를 127.0.0.x 로 바꿔 가며 server 에 연결하는 함수
+ * 목적지가 하나뿐이라 source ip 하나로는 ephemeral port 수 만큼만 열 수 있기 때문이다
+ * @return 연결된 socket, 실패하면 SOC_ERR
+ * @param idx 연결 번호
+ */
+static int bench_c1m_connect( int idx){
+    struct sockaddr_in src, dst;
+    int fd, one = 1;
+
+    if( ( fd = socket( AF_INET, SOCK_STREAM, 0)) < 0){
+        return SOC_ERR;
+    }
+    memset( &src, 0, sizeof( src));
+    src.sin_family = AF_INET;
+    src.sin_addr.s_addr = htonl( INADDR_LOOPBACK + 1 + idx / BENCH_C1M_CONN_PER_IP);
+    memset( &dst, 0, sizeof( dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons( BENCH_C1M_PORT);
+    inet_pton( AF_INET, BENCH_SERVER_IP, &dst.sin_addr);
+
+    // port 는 connect 할 때 4-tuple 기준으로 고른다 (bind 시점에 source ip 마다 port 를 다 쓰지 않는다)
+    setsockopt( fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof( one));
+    setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one));
+    if( ( idx >= BENCH_C1M_CONN_PER_IP) && ( bind( fd, ( struct sockaddr*)&src, sizeof( src)) < 0)){
+        close( fd);
+        return SOC_ERR;
+    }
+    if( connect( fd, ( struct sockaddr*)&dst, sizeof( dst)) < 0){
+        close( fd);
+        return SOC_ERR;
+    }
+    return fd;
+}
+
+/**
+ * @fn static int bench_c1m_idle_check( const char *name, int conn_num)
+ * @brief 모든 연결이 idle 일 때 server 가 송수신 버퍼를 하나도 빌리고 있지 않은지 확인하는 함수
+ * @return 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_c1m_idle_check( const char *name, int conn_num){
+    char stats[ 2048];
+    double conns, used, pooled;
+
+    usleep( BENCH_C1M_SETTLE_MS * 1000);
+    if( bench_get_stats( BENCH_C1M_PORT, stats, sizeof( stats)) < NORMAL){
+        printf("| %-28s | %6s | (no stats)\n", name, "FAIL");
+        return UNKNOWN;
+    }
+    // stats 요청을 보낸 연결 하나는 응답을 받는 중이다
+    conns = bench_stats_value( stats, "conns") - 1;
+    used = bench_stats_value( stats, "bufs_used") - 1;
+    pooled = bench_stats_value( stats, "bufs_pooled");
+    printf("| %-28s | %6s | (conns %.0f, bufs_used %.0f, bufs_pooled %.0f)\n", name,
+            ( ( conns == conn_num) && ( used == 0)) ? "ok" : "FAIL", conns, used, pooled);
+    return ( ( conns == conn_num) && ( used == 0)) ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief 요청 하나씩을 주고받은 뒤 idle 로 남은 연결을 fd 한도까지 열고 server 의 연결당 resident memory 를 재는 벤치마크
+ * 마지막에 모든 연결이 동시에 요청을 하나씩 보내서 버퍼를 빌렸다가 다시 돌려주는지 확인한다
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로 (기본 ../SERVER/server), 연결 수 (기본 fd 한도까지)
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    bench_server_t server;
+    struct rlimit lim;
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    int *fds;
+    int conn_num = BENCH_C1M_CONN_MAX;
+    int len, opened = 0, replies = 0, rv = NORMAL;
+    long rss_base, rss_idle, rss_burst;
+    uint64_t start, elapsed;
+    int i;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    // server 는 fork 로 띄우므로 같은 한도를 물려받는다
+    getrlimit( RLIMIT_NOFILE, &lim);
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit( RLIMIT_NOFILE, &lim);
+    if( ( lim.rlim_cur != RLIM_INFINITY) && ( lim.rlim_cur < ( rlim_t)conn_num + BENCH_C1M_FD_RESERVE)){
+        conn_num = ( int)lim.rlim_cur - BENCH_C1M_FD_RESERVE;
+    }
+    if( ( argc > 2) && ( atoi( argv[ 2]) > 0) && ( atoi( argv[ 2]) < conn_num)){
+        conn_num = atoi( argv[ 2]);
+    }
+    if( ( fds = ( int*)malloc( sizeof( int) * conn_num)) == NULL){
+        return UNKNOWN;
+    }
+
+    if( bench_server_start( &server, bin, BENCH_C1M_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        free( fds);
+        return UNKNOWN;
+    }
+    printf("	| @ Bench : %d idle connections (fd limit %llu, target %d), one %d byte request each\n",
+            conn_num, ( unsigned long long)lim.rlim_cur, BENCH_C1M_CONN_MAX, BENCH_C1M_BODY_LEN);
+    usleep( BENCH_C1M_SETTLE_MS * 1000);
+    rss_base = bench_c1m_rss_kb( server.pid);
+
+    // 연결마다 요청 하나를 주고받아서 버퍼를 한 번씩 빌렸다가 돌려주게 한다
+    len = bench_make_frame( frame, BENCH_C1M_BODY_LEN, 1);
+    start = bench_now_ns();
+    for( opened = 0; opened < conn_num; opened++){
+        if( ( fds[ opened] = bench_c1m_connect( opened)) < 0){
+            printf("	| ! Bench : connect failed after %d connections (errno:%d)\n", opened, errno);
+            rv = UNKNOWN;
+            break;
+        }
+        if( ( bench_write_full( fds[ opened], frame, len) < NORMAL) || ( bench_read_full( fds[ opened], reply, len) < NORMAL)){
+            printf("	| ! Bench : echo failed on connection %d\n", opened);
+            opened++;
+            rv = UNKNOWN;
+            break;
+        }
+    }
+    elapsed = bench_now_ns() - start;
+    if( ( rv == NORMAL) && ( bench_c1m_idle_check( "c1m.idle_after_connect", opened) < NORMAL)){
+        rv = UNKNOWN;
+    }
+    rss_idle = bench_c1m_rss_kb( server.pid);
+
+    // 모든 연결이 동시에 요청을 하나씩 보낸다 (한 loop 안에서 많은 연결이 버퍼를 같이 빌린다)
+    if( rv == NORMAL){
+        for( i = 0; i < opened; i++){
+            bench_write_full( fds[ i], frame, len);
+        }
+        for( i = 0; i < opened; i++){
+            if( bench_read_full( fds[ i], reply, len) == NORMAL){
+                replies++;
+            }
+        }
+        printf("| %-28s | %6s | (%d / %d)\n", "c1m.burst_replies", ( replies == opened) ? "ok" : "FAIL", replies, opened);
+        if( ( replies != opened) || ( bench_c1m_idle_check( "c1m.idle_after_burst", opened) < NORMAL)){
+            rv = UNKNOWN;
+        }
+    }
+    rss_burst = bench_c1m_rss_kb( server.pid);
+
+    if( ( opened > 0) && ( rss_base > 0) && ( rss_idle > 0)){
+        printf("| %-8s | %8s | %10s | %10s | %10s | %12s | %12s |\n", "conns", "conn/s", "base KB", "idle KB", "burst KB", "B/idle conn", "MB at 1M");
+        printf("| %8d | %8.0f | %10ld | %10ld | %10ld | %12.0f | %12.0f |\n", opened, opened / ( elapsed / 1e9),
+                rss_base, rss_idle, rss_burst, ( double)( rss_idle - rss_base) * 1024 / opened,
+                ( double)( rss_idle - rss_base) * 1024 / opened * BENCH_C1M_CONN_MAX / ( 1 << 20));
+    }
+
+    for( i = 0; i < opened; i++){
+        close( fds[ i]);
+    }
+    bench_server_stop( &server);
+    free( fds);
+    return rv;
+}
@@ -0,0 +1,262 @@
+#include "bench.h"
+#include "../COMMON/crc32c.h"
+
+#define BENCH_BACKEND_PORT ( BENCH_SERVER_PORT + 40)
+#define BENCH_CACHE_PORT ( BENCH_SERVER_PORT + 42)
+#define BENCH_NOCACHE_PORT ( BENCH_SERVER_PORT + 43)
+#define BENCH_BACKEND_NUM 2
+#define BENCH_CODE 1
+#define BENCH_CONN_NUM 16
+#define BENCH_REQ_NUM 20000
+#define BENCH_KEY_NUM 64
+#define BENCH_BODY_LEN 256
+#define BENCH_SAME_NUM 32
+#define BENCH_EVICT_KEY_NUM 4000
+#define BENCH_EVICT_BODY_LEN 1000
+#define BENCH_CACHE_MB "1"
+
+/**
+ * @fn static int bench_cache_frame( char *frame, int key, int body_len)
+ * @brief 바디 앞부분에 key 번호를 넣은 메시지를 만드는 함수 (key 가 같으면 같은 요청)
+ * @return 메시지 길이
+ */
+static int bench_cache_frame( char *frame, int key, int body_len){
+    char key_str[ 16];
+    int len = bench_make_frame( frame, body_len, BENCH_CODE);
+
+    snprintf( key_str, sizeof( key_str), "%08d", key);
+    memcpy( &frame[ sizeof( kmp_hdr_t)], key_str, 8);
+    return len;
+}
+
+/**
+ * @fn static int bench_cache_run( int *fds, int conn_num, int key_num, int body_len, int req_num, double *req_per_sec)
+ * @brief 연결마다 요청을 하나씩 보내고 응답을 모두 받는 round를 반복하는 함수 (key 는 0 ~ key_num - 1 을 돈다)
+ * @return 정상이면 NORMAL, 실패하거나 응답이 요청과 다르면 SOC_ERR
+ */
+static int bench_cache_run( int *fds, int conn_num, int key_num, int body_len, int req_num, double *req_per_sec){
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    int rounds = req_num / conn_num;
+    uint64_t start = bench_now_ns();
+    int i, j, len = 0;
+
+    for( i = 0; i < rounds; i++){
+        for( j = 0; j < conn_num; j++){
+            len = bench_cache_frame( frame, ( i * conn_num + j) % key_num, body_len);
+            if( bench_write_full( fds[ j], frame, len) < NORMAL){
+                return SOC_ERR;
+            }
+        }
+        for( j = 0; j < conn_num; j++){
+            if( bench_read_full( fds[ j], reply, len) < NORMAL){
+                return SOC_ERR;
+            }
+            // echo backend 이므로 응답 바디는 요청 key 를 그대로 가지고 있어야 한다
+            bench_cache_frame( frame, ( i * conn_num + j) % key_num, body_len);
+            if( memcmp( &reply[ sizeof( kmp_hdr_t)], &frame[ sizeof( kmp_hdr_t)], len - sizeof( kmp_hdr_t)) != 0){
+                printf("	| ! Bench : reply body mismatch\n");
+                return SOC_ERR;
+            }
+        }
+    }
+    *req_per_sec = ( double)rounds * conn_num * 1e9 / ( bench_now_ns() - start);
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_cache_crc( int fd, int key)
+ * @brief KMP_FLAG_CRC 를 붙인 요청을 보내고 응답이 CRC32C trailer 를 달고 오는지 확인하는 함수 (캐시에서 나간 응답 포함)
+ * @return 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_cache_crc( int fd, int key){
+    char frame[ sizeof( kmp_t) + KMP_CRC_LEN];
+    char reply[ sizeof( kmp_t) + KMP_CRC_LEN];
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)reply;
+    int len = bench_cache_frame( frame, key, BENCH_BODY_LEN);
+
+    len = crc32c_frame_seal( frame, len, sizeof( frame));
+    if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, sizeof( kmp_hdr_t)) < NORMAL)
+            || ( hdr->length != ( uint32_t)len) || ( bench_read_full( fd, &reply[ sizeof( kmp_hdr_t)], len - sizeof( kmp_hdr_t)) < NORMAL)
+            || ( crc32c_frame_check( reply, len) != len - KMP_CRC_LEN)
+            || ( memcmp( &reply[ sizeof( kmp_hdr_t)], &frame[ sizeof( kmp_hdr_t)], len - KMP_CRC_LEN - sizeof( kmp_hdr_t)) != 0)){
+        printf("	| ! Bench : crc reply check failed (key %d)\n", key);
+        return UNKNOWN;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static double bench_backend_requests( bench_server_t *backends)
+ * @brief backend 들이 처리한 요청 수의 합을 구하는 함수
+ * @return 요청 수, 실패하면 -1
+ */
+static double bench_backend_requests( bench_server_t *backends){
+    char stats[ 1024];
+    double sum = 0;
+    int i;
+
+    for( i = 0; i < BENCH_BACKEND_NUM; i++){
+        if( bench_get_stats( backends[ i].port, stats, sizeof( stats)) < NORMAL){
+            return -1;
+        }
+        sum += bench_stats_value( stats, "requests");
+    }
+    return sum;
+}
+
+/**
+ * @fn static int bench_connect_all( int port, int *fds, int num)
+ * @brief server 에 num 개의 연결을 맺는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_connect_all( int port, int *fds, int num){
+    int i;
+
+    for( i = 0; i < num; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, port)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            return SOC_ERR;
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static void bench_close_all( int *fds, int num)
+ * @brief 연결을 모두 닫는 함수
+ */
+static void bench_close_all( int *fds, int num){
+    int i;
+
+    for( i = 0; i < num; i++){
+        close( fds[ i]);
+    }
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief sharding router 의 응답 cache 벤치마크
+ * 1. 작은 key 집합에 대한 요청 처리량 (cache 있는 router / 없는 router)
+ * 2. 처리 중인 같은 요청이 합쳐져서 backend 에 한 번만 가는지
+ * 3. 메모리 한도를 넘는 key 집합에서 오래된 항목이 버려지는지
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *cache_opts[ BENCH_BACKEND_NUM * 2 + 5];
+    const char *nocache_opts[ BENCH_BACKEND_NUM * 2 + 1];
+    char backend_str[ BENCH_BACKEND_NUM][ 32];
+    bench_server_t backends[ BENCH_BACKEND_NUM], router, nocache_router;
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    int fds[ BENCH_SAME_NUM];
+    char stats[ 1024];
+    double cached_req, nocache_req, before, after;
+    int i, len, started = 0;
+    int rv = UNKNOWN;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    for( i = 0; i < BENCH_BACKEND_NUM; i++){
+        snprintf( backend_str[ i], sizeof( backend_str[ i]), "%s:%d", BENCH_SERVER_IP, BENCH_BACKEND_PORT + i);
+        cache_opts[ i * 2] = nocache_opts[ i * 2] = "-R";
+        cache_opts[ i * 2 + 1] = nocache_opts[ i * 2 + 1] = backend_str[ i];
+        if( bench_server_start( &backends[ i], bin, BENCH_BACKEND_PORT + i, NULL, NULL) < NORMAL){
+            printf("	| ! Bench : Failed to start backend server (%s)\n", bin);
+            goto out;
+        }
+        started++;
+    }
+    cache_opts[ BENCH_BACKEND_NUM * 2] = "-K";
+    cache_opts[ BENCH_BACKEND_NUM * 2 + 1] = "1";
+    cache_opts[ BENCH_BACKEND_NUM * 2 + 2] = "-M";
+    cache_opts[ BENCH_BACKEND_NUM * 2 + 3] = BENCH_CACHE_MB;
+    cache_opts[ BENCH_BACKEND_NUM * 2 + 4] = NULL;
+    nocache_opts[ BENCH_BACKEND_NUM * 2] = NULL;
+
+    if( bench_server_start( &router, bin, BENCH_CACHE_PORT, NULL, cache_opts) < NORMAL){
+        printf("	| ! Bench : Failed to start router (%s)\n", bin);
+        goto out;
+    }
+    if( bench_server_start( &nocache_router, bin, BENCH_NOCACHE_PORT, NULL, nocache_opts) < NORMAL){
+        printf("	| ! Bench : Failed to start router (%s)\n", bin);
+        bench_server_stop( &router);
+        goto out;
+    }
+
+    // 1. 처리량
+    if( bench_connect_all( BENCH_NOCACHE_PORT, fds, BENCH_CONN_NUM) < NORMAL){
+        goto stop;
+    }
+    len = bench_cache_run( fds, BENCH_CONN_NUM, BENCH_KEY_NUM, BENCH_BODY_LEN, BENCH_REQ_NUM, &nocache_req);
+    bench_close_all( fds, BENCH_CONN_NUM);
+    if( ( len < NORMAL) || ( bench_connect_all( BENCH_CACHE_PORT, fds, BENCH_CONN_NUM) < NORMAL)){
+        goto stop;
+    }
+    len = bench_cache_run( fds, BENCH_CONN_NUM, BENCH_KEY_NUM, BENCH_BODY_LEN, BENCH_REQ_NUM, &cached_req);
+    if( len == NORMAL){
+        // 같은 key 를 두 번 보내서 backend 를 거친 응답과 캐시에서 나간 응답 모두 trailer 를 확인한다
+        len = bench_cache_crc( fds[ 0], BENCH_KEY_NUM);
+        len = ( len == NORMAL) ? bench_cache_crc( fds[ 0], BENCH_KEY_NUM) : len;
+    }
+    bench_close_all( fds, BENCH_CONN_NUM);
+    if( len < NORMAL){
+        goto stop;
+    }
+    printf("| %-28s | %10s |\n", "cache", "value");
+    printf("| %-28s | %10.0f |\n", "no cache req/s (64 keys)", nocache_req);
+    printf("| %-28s | %10.0f |\n", "cache req/s (64 keys)", cached_req);
+
+    // 2. 같은 요청 BENCH_SAME_NUM 개를 동시에 보낸다
+    if( ( ( before = bench_backend_requests( backends)) < 0) || ( bench_connect_all( BENCH_CACHE_PORT, fds, BENCH_SAME_NUM) < NORMAL)){
+        goto stop;
+    }
+    len = bench_cache_frame( frame, 99999999, BENCH_BODY_LEN);
+    for( i = 0; i < BENCH_SAME_NUM; i++){
+        bench_write_full( fds[ i], frame, len);
+    }
+    for( i = 0; i < BENCH_SAME_NUM; i++){
+        if( bench_read_full( fds[ i], reply, len) < NORMAL){
+            break;
+        }
+    }
+    bench_close_all( fds, BENCH_SAME_NUM);
+    if( ( i < BENCH_SAME_NUM) || ( ( after = bench_backend_requests( backends)) < 0)){
+        printf("	| ! Bench : coalescing run failed\n");
+        goto stop;
+    }
+    printf("| %-28s | %10.0f |\n", "backend runs (32 same req)", after - before);
+
+    // 3. 메모리 한도
+    if( bench_connect_all( BENCH_CACHE_PORT, fds, 1) < NORMAL){
+        goto stop;
+    }
+    len = bench_cache_run( fds, 1, BENCH_EVICT_KEY_NUM, BENCH_EVICT_BODY_LEN, BENCH_EVICT_KEY_NUM, &cached_req);
+    bench_close_all( fds, 1);
+    if( ( len < NORMAL) || ( bench_get_stats( BENCH_CACHE_PORT, stats, sizeof( stats)) < NORMAL)){
+        goto stop;
+    }
+    printf("| %-28s | %10.0f |\n", "evictions (4000 x 1KB keys)", bench_stats_value( stats, "cache_evictions"));
+    printf("| %-28s | %10.0f |\n", "cache bytes", bench_stats_value( stats, "cache_bytes"));
+    printf("| %-28s | %10.0f |\n", "cache limit", bench_stats_value( stats, "cache_limit"));
+    printf("| %-28s | %10.4f |\n", "hit ratio", bench_stats_value( stats, "cache_hit_ratio"));
+    printf("	| @ Bench : router stats : %s\n", stats);
+    rv = NORMAL;
+
+stop:
+    if( rv < NORMAL){
+        printf("	| ! Bench : cache run failed\n");
+    }
+    bench_server_stop( &router);
+    bench_server_stop( &nocache_router);
+out:
+    for( i = 0; i < started; i++){
+        bench_server_stop( &backends[ i]);
+    }
+    return rv;
+}
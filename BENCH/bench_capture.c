@@ -0,0 +1,201 @@
+#include "bench.h"
+
+#define BENCH_PLAIN_PORT ( BENCH_SERVER_PORT + 60)
+#define BENCH_CAPTURE_PORT ( BENCH_SERVER_PORT + 61)
+#define BENCH_REPLAY_PORT ( BENCH_SERVER_PORT + 62)
+#define BENCH_PACED_PORT ( BENCH_SERVER_PORT + 63)
+#define BENCH_CAPTURE_PATH "/tmp/kmp_bench.kcap"
+#define BENCH_PACED_PATH "/tmp/kmp_bench_paced.kcap"
+#define BENCH_PACED_CONN_NUM 8
+#define BENCH_PACED_INTERVAL_US 1000
+#define BENCH_PACED_MS 2000
+#define BENCH_CONN_NUM 16
+#define BENCH_BODY_LEN 256
+#define BENCH_REQ_NUM 40000
+#define BENCH_ROUND_NUM 5
+
+/**
+ * @fn static int bench_capture_echo( bench_server_t *server, double *req_per_sec, uint64_t *cpu_ns)
+ * @brief server 에 BENCH_CONN_NUM 개의 연결을 맺고 echo 처리량과 server 가 쓴 CPU 시간을 재는 함수
+ * 같은 CPU 를 나눠 쓰는 환경에서는 처리량이 흔들리므로 capture 비용은 server CPU 시간으로 비교한다
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_capture_echo( bench_server_t *server, double *req_per_sec, uint64_t *cpu_ns){
+    int fds[ BENCH_CONN_NUM];
+    uint64_t cpu_start;
+    double usec;
+    int i, rv;
+
+    for( i = 0; i < BENCH_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, server->port)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            return SOC_ERR;
+        }
+    }
+    cpu_start = bench_proc_cpu_ns( server->pid);
+    rv = bench_echo_run( fds, BENCH_CONN_NUM, BENCH_BODY_LEN, BENCH_REQ_NUM, req_per_sec, &usec);
+    *cpu_ns += bench_proc_cpu_ns( server->pid) - cpu_start;
+    for( i = 0; i < BENCH_CONN_NUM; i++){
+        close( fds[ i]);
+    }
+    return rv;
+}
+
+/**
+ * @fn static int bench_capture_paced( const char *bin)
+ * @brief 처리 한도보다 낮은 일정한 부하를 capture 하는 함수 (1배 재생이 원래 부하 모양을 따라가는지 보기 위한 것)
+ * 연결마다 요청 하나를 보내고 응답을 받은 뒤 BENCH_PACED_INTERVAL_US 쉬기를 반복한다
+ * @return 정상이면 NORMAL, 실패하면 열거형 참고
+ */
+static int bench_capture_paced( const char *bin){
+    static uint64_t samples[ BENCH_PACED_CONN_NUM * BENCH_PACED_MS];
+    const char *opts[] = { "-T", BENCH_PACED_PATH, NULL};
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    int fds[ BENCH_PACED_CONN_NUM];
+    bench_server_t server;
+    uint64_t start, end;
+    int i, len, count = 0, rv = NORMAL;
+
+    if( bench_server_start( &server, bin, BENCH_PACED_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start capture server (%s)\n", bin);
+        return OBJECT_ERR;
+    }
+    for( i = 0; i < BENCH_PACED_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PACED_PORT)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            bench_server_stop( &server);
+            return SOC_ERR;
+        }
+    }
+
+    len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    end = bench_now_ns() + ( uint64_t)BENCH_PACED_MS * 1000000;
+    while( ( rv == NORMAL) && ( bench_now_ns() < end) && ( count + BENCH_PACED_CONN_NUM <= BENCH_PACED_CONN_NUM * BENCH_PACED_MS)){
+        for( i = 0; i < BENCH_PACED_CONN_NUM; i++){
+            start = bench_now_ns();
+            if( ( bench_write_full( fds[ i], frame, len) < NORMAL) || ( bench_read_full( fds[ i], reply, len) < NORMAL)){
+                rv = SOC_ERR;
+                break;
+            }
+            samples[ count++] = bench_now_ns() - start;
+        }
+        usleep( BENCH_PACED_INTERVAL_US);
+    }
+    for( i = 0; i < BENCH_PACED_CONN_NUM; i++){
+        close( fds[ i]);
+    }
+    bench_server_stop( &server);
+
+    printf("	| @ Bench : paced capture %d frames, original reply p50 %.1f us, p99 %.1f us\n", count,
+            bench_percentile( samples, count, 50) / 1000.0, bench_percentile( samples, count, 99) / 1000.0);
+    return rv;
+}
+
+/**
+ * @fn static int bench_capture_replay( const char *bin, const char *path, const char *speed)
+ * @brief 새로 띄운 server 에 capture 파일을 replay 도구로 재생하는 함수
+ * @return replay 도구가 모든 응답을 받았으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_capture_replay( const char *bin, const char *path, const char *speed){
+    char port_str[ 16];
+    bench_server_t server;
+    pid_t pid;
+    int status = 0;
+
+    if( bench_server_start( &server, bin, BENCH_REPLAY_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return OBJECT_ERR;
+    }
+    snprintf( port_str, sizeof( port_str), "%d", BENCH_REPLAY_PORT);
+    printf("	| @ Bench : replay -s %s %s\n", speed, path);
+    if( ( pid = fork()) == 0){
+        execl( "./replay", "./replay", "-s", speed, path, BENCH_SERVER_IP, port_str, ( char*)NULL);
+        _exit( 127);
+    }
+    waitpid( pid, &status, 0);
+    bench_server_stop( &server);
+    return ( WIFEXITED( status) && ( WEXITSTATUS( status) == 0)) ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief capture 비용과 replay 벤치마크
+ * 1. -T 로 capture 하는 server 와 하지 않는 server 의 echo 처리량 / 요청당 server CPU 시간 비교 (번갈아 잰다)
+ * 2. 1 의 capture 파일을 새 server 에 최대 속도로 재생
+ * 3. 처리 한도보다 낮은 일정한 부하를 capture 해서 1배 속도로 재생 (원래 응답 지연과 비교)
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *capture_opts[] = { "-T", BENCH_CAPTURE_PATH, NULL};
+    bench_server_t plain, capture;
+    double plain_best = 0, capture_best = 0, req;
+    uint64_t plain_cpu = 0, capture_cpu = 0;
+    double plain_ns, capture_ns;
+    char stats[ 1024];
+    int i, rv = UNKNOWN;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    if( bench_server_start( &plain, bin, BENCH_PLAIN_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    if( bench_server_start( &capture, bin, BENCH_CAPTURE_PORT, NULL, capture_opts) < NORMAL){
+        printf("	| ! Bench : Failed to start capture server (%s)\n", bin);
+        bench_server_stop( &plain);
+        return UNKNOWN;
+    }
+
+    for( i = 0; i < BENCH_ROUND_NUM; i++){
+        if( bench_capture_echo( &plain, &req, &plain_cpu) < NORMAL){
+            goto stop;
+        }
+        plain_best = ( req > plain_best) ? req : plain_best;
+        if( bench_capture_echo( &capture, &req, &capture_cpu) < NORMAL){
+            goto stop;
+        }
+        capture_best = ( req > capture_best) ? req : capture_best;
+    }
+    if( bench_get_stats( BENCH_CAPTURE_PORT, stats, sizeof( stats)) < NORMAL){
+        goto stop;
+    }
+
+    plain_ns = ( double)plain_cpu / ( BENCH_ROUND_NUM * BENCH_REQ_NUM);
+    capture_ns = ( double)capture_cpu / ( BENCH_ROUND_NUM * BENCH_REQ_NUM);
+    printf("| %-24s | %14s |\n", "capture", "value");
+    printf("| %-24s | %14.0f |\n", "no capture req/s", plain_best);
+    printf("| %-24s | %14.0f |\n", "capture req/s", capture_best);
+    printf("| %-24s | %14.0f |\n", "no capture cpu ns/req", plain_ns);
+    printf("| %-24s | %14.0f |\n", "capture cpu ns/req", capture_ns);
+    printf("| %-24s | %13.1f%% |\n", "cpu overhead", ( capture_ns - plain_ns) * 100.0 / plain_ns);
+    printf("| %-24s | %14.0f |\n", "captured frames", bench_stats_value( stats, "capture_frames"));
+    printf("| %-24s | %14.0f |\n", "captured bytes", bench_stats_value( stats, "capture_bytes"));
+    rv = NORMAL;
+
+stop:
+    bench_server_stop( &plain);
+    // SIGKILL 로 끝나도 capture 파일은 MAP_SHARED 로 이미 기록되어 있다
+    bench_server_stop( &capture);
+    if( rv < NORMAL){
+        printf("	| ! Bench : capture run failed\n");
+        return UNKNOWN;
+    }
+
+    if( ( bench_capture_replay( bin, BENCH_CAPTURE_PATH, "max") < NORMAL)
+            || ( bench_capture_paced( bin) < NORMAL)
+            || ( bench_capture_replay( bin, BENCH_PACED_PATH, "1") < NORMAL)){
+        printf("	| ! Bench : replay failed\n");
+        rv = UNKNOWN;
+    }
+    unlink( BENCH_CAPTURE_PATH);
+    unlink( BENCH_PACED_PATH);
+    return rv;
+}
@@ -0,0 +1,113 @@
+#include "bench.h"
+
+#define BENCH_RESULT_MAX 256
+#define BENCH_THRESHOLD_PCT 20.0
+
+/// @struct bench_entry_t
+/// @brief JSON 결과 파일의 측정 항목 하나
+typedef struct bench_entry_s bench_entry_t;
+struct bench_entry_s{
+    /// 측정 항목 이름
+    char name[ 64];
+    /// 측정 값
+    double value;
+    /// 단위
+    char unit[ 16];
+    /// 값이 작을수록 좋은 항목인지 여부
+    int is_lower_better;
+};
+
+/**
+ * @fn static int bench_load( const char *path, bench_entry_t *entries)
+ * @brief bench_json_add() 가 기록한 JSON 결과 파일을 읽는 함수 (항목 하나가 한 줄)
+ * @return 읽은 항목 수, 파일을 열 수 없으면 OBJECT_ERR
+ * @param path JSON 파일 경로
+ * @param entries 읽은 항목을 저장할 배열 (BENCH_RESULT_MAX 개)
+ */
+static int bench_load( const char *path, bench_entry_t *entries){
+    char line[ 256];
+    int count = 0;
+    FILE *fp;
+
+    if( ( fp = fopen( path, "r")) == NULL){
+        printf("	| ! Bench : Failed to open %s\n", path);
+        return OBJECT_ERR;
+    }
+
+    while( ( count < BENCH_RESULT_MAX) && ( fgets( line, sizeof( line), fp) != NULL)){
+        if( sscanf( line, " {\"name\": \"%63[^\"]\", \"value\": %lf, \"unit\": \"%15[^\"]\", \"lower_is_better\": %d}",
+                    entries[ count].name, &entries[ count].value, entries[ count].unit, &entries[ count].is_lower_better) == 4){
+            count++;
+        }
+    }
+    fclose( fp);
+    return count;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief 측정 결과를 baseline과 비교해서 threshold 이상 나빠진 항목이 있으면 실패하는 함수
+ * @return 회귀가 없으면 0, 있으면 1, 파일 오류면 UNKNOWN
+ * @param argc 매개변수 개수
+ * @param argv [-t threshold_pct] baseline.json result.json
+ */
+int main( int argc, char **argv){
+    static bench_entry_t base[ BENCH_RESULT_MAX], result[ BENCH_RESULT_MAX];
+    double threshold = BENCH_THRESHOLD_PCT;
+    double change;
+    int base_num, result_num;
+    int regressions = 0;
+    int i, j, opt;
+    const char *status;
+
+    while( ( opt = getopt( argc, argv, "t:")) != -1){
+        if( opt == 't'){
+            threshold = atof( optarg);
+        }
+        else{
+            printf("	| ! need param : [-t threshold_pct] baseline.json result.json\n");
+            return UNKNOWN;
+        }
+    }
+    if( argc - optind != 2){
+        printf("	| ! need param : [-t threshold_pct] baseline.json result.json\n");
+        return UNKNOWN;
+    }
+
+    if( ( ( base_num = bench_load( argv[ optind], base)) < 0) || ( ( result_num = bench_load( argv[ optind + 1], result)) < 0)){
+        return UNKNOWN;
+    }
+
+    printf("| %-28s | %12s | %12s | %8s | %-10s |\n", "name", "baseline", "current", "change", "status");
+    for( i = 0; i < result_num; i++){
+        for( j = 0; j < base_num; j++){
+            if( strcmp( base[ j].name, result[ i].name) == 0){
+                break;
+            }
+        }
+        if( j == base_num){
+            printf("| %-28s | %12s | %12.2f | %8s | %-10s |\n", result[ i].name, "-", result[ i].value, "-", "new");
+            continue;
+        }
+
+        // 양수면 나빠진 것
+        change = ( result[ i].value - base[ j].value) * 100.0 / base[ j].value;
+        if( result[ i].is_lower_better == 0){
+            change = -change;
+        }
+
+        status = "ok";
+        if( change > threshold){
+            status = "REGRESSION";
+            regressions++;
+        }
+        printf("| %-28s | %12.2f | %12.2f | %+7.1f%% | %-10s |\n", result[ i].name, base[ j].value, result[ i].value, change, status);
+    }
+
+    if( regressions > 0){
+        printf("	| ! Bench : %d regression(s) over %.1f%% (%s)\n", regressions, threshold, argv[ optind + 1]);
+        return 1;
+    }
+    printf("	| @ Bench : no regression over %.1f%% (%s)\n", threshold, argv[ optind + 1]);
+    return NORMAL;
+}
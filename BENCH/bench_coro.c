@@ -0,0 +1,206 @@
+#include "bench.h"
+#include "../SERVER/coro.h"
+
+#define BENCH_CORO_PORT ( BENCH_SERVER_PORT + 30)
+#define BENCH_REQ_NUM 20000
+#define BENCH_REPEAT 5
+#define BENCH_CONN_MAX 16
+#define BENCH_SLEEP_CORO_NUM 1000
+#define BENCH_SLEEP_MS 10
+#define BENCH_SLEEP_COUNT 5
+
+/// @struct bench_sleep_ctx_t
+/// @brief sleep_for 측정용 coroutine이 yield 사이에 유지하는 상태
+typedef struct bench_sleep_ctx_s bench_sleep_ctx_t;
+struct bench_sleep_ctx_s{
+    /// 남은 sleep 횟수
+    int count;
+    /// 마지막 awaitable 결과
+    int rv;
+};
+
+/**
+ * @fn static int bench_sleep_body( coro_t *co)
+ * @brief BENCH_SLEEP_MS 씩 BENCH_SLEEP_COUNT 번 자고 끝나는 coroutine
+ */
+static int bench_sleep_body( coro_t *co){
+    bench_sleep_ctx_t *ctx = CORO_LOCALS( co, bench_sleep_ctx_t);
+
+    CORO_BEGIN( co);
+    for( ctx->count = 0; ctx->count < BENCH_SLEEP_COUNT; ctx->count++){
+        CORO_AWAIT( co, ctx->rv, coro_sleep_for( co, BENCH_SLEEP_MS));
+        if( ctx->rv < NORMAL){
+            CORO_EXIT( co, ctx->rv);
+        }
+    }
+    CORO_END( co);
+}
+
+/**
+ * @fn static int bench_coro_sleep()
+ * @brief coroutine BENCH_SLEEP_CORO_NUM 개를 동시에 재우고 모두 끝날 때까지 걸린 시간을 재는 함수
+ * 이상적인 값은 BENCH_SLEEP_MS * BENCH_SLEEP_COUNT 이고, 차이는 timer heap과 scheduler 비용이다
+ * @return 정상이면 NORMAL, 실패하면 OBJECT_ERR
+ */
+static int bench_coro_sleep(){
+    coro_sched_t *sched;
+    uint64_t start;
+    double elapsed_ms;
+    int epoll_fd, i;
+
+    if( ( epoll_fd = epoll_create1( 0)) < 0){
+        return OBJECT_ERR;
+    }
+    if( ( sched = coro_sched_init( epoll_fd)) == NULL){
+        close( epoll_fd);
+        return OBJECT_ERR;
+    }
+
+    start = bench_now_ns();
+    for( i = 0; i < BENCH_SLEEP_CORO_NUM; i++){
+        coro_spawn( sched, -1, bench_sleep_body, NULL);
+    }
+    while( sched->live_num > 0){
+        if( coro_sched_run_once( sched, 1000) < 0){
+            break;
+        }
+    }
+    elapsed_ms = ( double)( bench_now_ns() - start) / 1e6;
+
+    printf("| %-28s | %10.2f | ideal %d ms, %d frames in %d pool chunk(s)\n", "coro.sleep_for.1000coro (ms)", elapsed_ms,
+            BENCH_SLEEP_MS * BENCH_SLEEP_COUNT, BENCH_SLEEP_CORO_NUM, sched->chunk_num);
+    bench_json_add( "coro.sleep_for.1000coro", elapsed_ms, "ms", 1);
+
+    i = sched->live_num;
+    coro_sched_destroy( sched);
+    close( epoll_fd);
+    return ( i == 0) ? NORMAL : OBJECT_ERR;
+}
+
+/**
+ * @fn static int bench_coro_connect( bench_server_t *server, int *fds, int conn_num)
+ * @brief server 에 conn_num 개의 연결을 맺는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_coro_connect( bench_server_t *server, int *fds, int conn_num){
+    int i;
+
+    for( i = 0; i < conn_num; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, server->port)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            return SOC_ERR;
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief callback 상태 기계 server 와 coroutine handler server(-C) 의 echo 처리량을 비교하는 벤치마크
+ * 두 server 를 함께 띄워 두고 같은 부하를 번갈아 걸어서 측정 잡음이 한쪽에만 몰리지 않게 한다
+ * callback 경로는 응답 헤더와 바디를 나눠서 write 하고, coroutine handler는 메시지 하나를 한 번에 write 한다
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv [-o result.json] server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = "../SERVER/server";
+    const char *json_path = NULL;
+    const char *coro_opts[] = { "-C", NULL};
+    int body_lens[] = { 16, 1000};
+    int conn_nums[] = { 1, BENCH_CONN_MAX};
+    int fds[ 2][ BENCH_CONN_MAX];
+    bench_server_t servers[ 2];
+    double req_per_sec, usec_per_round, best[ 2];
+    char name[ 64];
+    int i, j, k, r, opt;
+    int rv = NORMAL;
+
+    while( ( opt = getopt( argc, argv, "o:")) != -1){
+        if( opt == 'o'){
+            json_path = optarg;
+        }
+        else{
+            printf("	| ! need param : [-o result.json] [server_bin]\n");
+            return UNKNOWN;
+        }
+    }
+    if( optind < argc){
+        bin = argv[ optind];
+    }
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    if( bench_json_open( json_path) < NORMAL){
+        return UNKNOWN;
+    }
+
+    printf("| %-28s | %10s |\n", "coro", "value");
+    if( bench_coro_sleep() < NORMAL){
+        printf("	| ! Bench : sleep_for coroutines did not finish\n");
+        bench_json_close();
+        return UNKNOWN;
+    }
+
+    if( bench_server_start( &servers[ 0], bin, BENCH_CORO_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        bench_json_close();
+        return UNKNOWN;
+    }
+    if( bench_server_start( &servers[ 1], bin, BENCH_CORO_PORT + 1, NULL, coro_opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s -C)\n", bin);
+        bench_server_stop( &servers[ 0]);
+        bench_json_close();
+        return UNKNOWN;
+    }
+
+    printf("| %-28s | %10s | %10s | %8s |\n", "echo (body x conns)", "callback", "coroutine", "ratio");
+    for( i = 0; ( rv == NORMAL) && ( i < ( int)( sizeof( conn_nums) / sizeof( int))); i++){
+        if( ( bench_coro_connect( &servers[ 0], fds[ 0], conn_nums[ i]) < NORMAL)){
+            rv = SOC_ERR;
+            break;
+        }
+        if( ( bench_coro_connect( &servers[ 1], fds[ 1], conn_nums[ i]) < NORMAL)){
+            for( k = 0; k < conn_nums[ i]; k++){
+                close( fds[ 0][ k]);
+            }
+            rv = SOC_ERR;
+            break;
+        }
+
+        for( j = 0; ( rv == NORMAL) && ( j < ( int)( sizeof( body_lens) / sizeof( int))); j++){
+            best[ 0] = best[ 1] = 0;
+            for( r = 0; ( rv == NORMAL) && ( r < BENCH_REPEAT * 2); r++){
+                if( ( rv = bench_echo_run( fds[ r % 2], conn_nums[ i], body_lens[ j], BENCH_REQ_NUM, &req_per_sec, &usec_per_round)) < NORMAL){
+                    printf("	| ! Bench : echo run failed (%s)\n", ( r % 2) ? "coroutine" : "callback");
+                    break;
+                }
+                if( req_per_sec > best[ r % 2]){
+                    best[ r % 2] = req_per_sec;
+                }
+            }
+            if( rv < NORMAL){
+                break;
+            }
+
+            snprintf( name, sizeof( name), "%dB.%dconn", body_lens[ j], conn_nums[ i]);
+            printf("| %-28s | %10.0f | %10.0f | %7.1f%% |\n", name, best[ 0], best[ 1], best[ 1] * 100.0 / best[ 0]);
+            snprintf( name, sizeof( name), "coro.callback.%dB.%dconn", body_lens[ j], conn_nums[ i]);
+            bench_json_add( name, best[ 0], "req/s", 0);
+            snprintf( name, sizeof( name), "coro.coroutine.%dB.%dconn", body_lens[ j], conn_nums[ i]);
+            bench_json_add( name, best[ 1], "req/s", 0);
+        }
+
+        for( k = 0; k < conn_nums[ i]; k++){
+            close( fds[ 0][ k]);
+            close( fds[ 1][ k]);
+        }
+    }
+
+    bench_json_close();
+    bench_server_stop( &servers[ 0]);
+    bench_server_stop( &servers[ 1]);
+    return ( rv < NORMAL) ? UNKNOWN : NORMAL;
+}
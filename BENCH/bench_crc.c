@@ -0,0 +1,248 @@
+#include "bench.h"
+#include "../COMMON/crc32c.h"
+#if defined( __x86_64__)
+#include <x86intrin.h>
+#endif
+
+#define BENCH_CRC_PORT ( BENCH_SERVER_PORT + 95)
+/// 측정할 버퍼 크기 중 가장 큰 값
+#define BENCH_CRC_MAX_LEN ( 1 << 20)
+/// 크기마다 측정에 쓰는 바이트 수 (작은 버퍼는 그만큼 여러 번 반복한다)
+#define BENCH_CRC_BYTES ( 256 << 20)
+#define BENCH_CRC_REPEAT 5
+/// 주고 받는 메시지 바디 길이 (trailer 포함 server 버퍼 안에 들어간다) / 메시지 수
+#define BENCH_CRC_BODY_LEN 1000
+#define BENCH_CRC_MSGS 50000
+
+/// @brief 측정 대상 (dst 는 복사하는 방법만 쓴다)
+typedef uint32_t ( *bench_crc_fn)( void *dst, const void *src, size_t len);
+
+static uint32_t bench_crc_hw( void *dst, const void *src, size_t len){
+    ( void)dst;
+    return crc32c_update( 0, src, len);
+}
+
+static uint32_t bench_crc_table( void *dst, const void *src, size_t len){
+    ( void)dst;
+    return crc32c_update_table( 0, src, len);
+}
+
+static uint32_t bench_crc_memcpy( void *dst, const void *src, size_t len){
+    memcpy( dst, src, len);
+    return ( ( const unsigned char*)dst)[ len - 1];
+}
+
+static uint32_t bench_crc_copy( void *dst, const void *src, size_t len){
+    return crc32c_copy( 0, dst, src, len);
+}
+
+/**
+ * @fn static uint64_t bench_crc_ticks()
+ * @brief TSC 값을 읽는 함수 (x86 이 아니면 ns)
+ * @return TSC tick
+ */
+static uint64_t bench_crc_ticks(){
+#if defined( __x86_64__)
+    return __rdtsc();
+#else
+    return bench_now_ns();
+#endif
+}
+
+/**
+ * @fn static int bench_crc_run( const char *name, bench_crc_fn fn, char *dst, const char *src, int len)
+ * @brief len 바이트 버퍼를 BENCH_CRC_BYTES 만큼 반복해서 처리하고 가장 빠른 값을 출력하는 함수
+ * @return 정상이면 NORMAL, 복사하는 방법인데 dst 가 src 와 다르거나 copy+crc 의 값이 틀리면 UNKNOWN
+ */
+static int bench_crc_run( const char *name, bench_crc_fn fn, char *dst, const char *src, int len){
+    uint64_t best_ns = UINT64_MAX, best_ticks = UINT64_MAX;
+    uint64_t start_ns, start_ticks, ns, ticks;
+    uint32_t sink = 0;
+    long iters = BENCH_CRC_BYTES / len;
+    char key[ 64];
+    long i;
+    int r, ok = 1;
+
+    memset( dst, 0, len);
+    for( r = 0; r < BENCH_CRC_REPEAT; r++){
+        start_ns = bench_now_ns();
+        start_ticks = bench_crc_ticks();
+        for( i = 0; i < iters; i++){
+            sink += fn( dst, src, len);
+        }
+        ticks = bench_crc_ticks() - start_ticks;
+        ns = bench_now_ns() - start_ns;
+        if( ns < best_ns){
+            best_ns = ns;
+            best_ticks = ticks;
+        }
+    }
+    // 복사하는 방법은 측정이 끝난 dst 가 src 와 같아야 하고, copy+crc 는 값도 crc32c_update 와 같아야 한다
+    if( ( fn == bench_crc_memcpy) || ( fn == bench_crc_copy)){
+        ok = ( memcmp( dst, src, len) == 0);
+    }
+    if( fn == bench_crc_copy){
+        memset( dst, 0, len);
+        ok = ok && ( fn( dst, src, len) == crc32c_update( 0, src, len)) && ( memcmp( dst, src, len) == 0);
+    }
+    printf("| %-8s | %8d | %10.1f | %8.2f | %7.3f | (%08x)%s\n", name, len, ( double)best_ns / iters,
+            ( double)len * iters / best_ns, ( double)best_ticks / ( ( double)len * iters), sink, ok ? "" : " FAIL");
+    snprintf( key, sizeof( key), "crc.%s.%d", name, len);
+    bench_json_add( key, ( double)len * iters / best_ns, "GB/s", 0);
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static int bench_crc_verify( char *dst, char *src)
+ * @brief 구현끼리 같은 값을 내는지, 나눠서 계산해도 같은지, trailer 가 깨진 메시지를 찾아내는지 확인하는 함수
+ * @return 모두 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_crc_verify( char *dst, char *src){
+    char frame[ sizeof( kmp_t) + KMP_CRC_LEN];
+    uint32_t crc;
+    int ok = 1;
+    int len, off, split, i;
+
+    // 표준 check 값 (RFC 3720)
+    ok = ok && ( crc32c_update( 0, "123456789", 9) == 0xE3069283) && ( crc32c_update_table( 0, "123456789", 9) == 0xE3069283);
+    for( i = 0; i < 2000 && ok; i++){
+        len = rand() % 8192;
+        off = rand() % 64;
+        split = ( len > 0) ? rand() % len : 0;
+        crc = crc32c_update( 0, &src[ off], len);
+        ok = ( crc == crc32c_update_table( 0, &src[ off], len))
+            && ( crc == crc32c_update( crc32c_update( 0, &src[ off], split), &src[ off + split], len - split))
+            && ( crc == crc32c_copy( 0, &dst[ off], &src[ off], len)) && ( memcmp( &dst[ off], &src[ off], len) == 0);
+    }
+    printf("| %-28s | %6s |\n", "crc.impl_match", ok ? "ok" : "FAIL");
+
+    len = bench_make_frame( frame, BENCH_CRC_BODY_LEN, 1);
+    len = crc32c_frame_seal( frame, len, sizeof( frame));
+    ok = ok && ( crc32c_frame_check( frame, len) == len - KMP_CRC_LEN);
+    len = crc32c_frame_seal( frame, len - KMP_CRC_LEN, sizeof( frame));
+    frame[ ( int)sizeof( kmp_hdr_t) + 100] ^= 0x10;
+    ok = ok && ( crc32c_frame_check( frame, len) == BUF_ERR);
+    printf("| %-28s | %6s |\n", "crc.bit_flip_detected", ok ? "ok" : "FAIL");
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static int bench_crc_echo( int fd, int is_crc, double *req_per_sec)
+ * @brief 연결 하나로 BENCH_CRC_MSGS 개의 요청을 하나씩 보내고 응답을 받는 함수 (trailer 가 있으면 응답 trailer 도 검사한다)
+ * @return 정상이면 NORMAL, 응답이 틀리면 UNKNOWN, 소켓이 실패하면 SOC_ERR
+ */
+static int bench_crc_echo( int fd, int is_crc, double *req_per_sec){
+    char frame[ sizeof( kmp_t) + KMP_CRC_LEN];
+    char reply[ sizeof( kmp_t) + KMP_CRC_LEN];
+    uint64_t start;
+    int len, i;
+
+    len = bench_make_frame( frame, is_crc ? BENCH_CRC_BODY_LEN - KMP_CRC_LEN : BENCH_CRC_BODY_LEN, 1);
+    if( is_crc){
+        len = crc32c_frame_seal( frame, len, sizeof( frame));
+    }
+    start = bench_now_ns();
+    for( i = 0; i < BENCH_CRC_MSGS; i++){
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, len) < NORMAL)){
+            return SOC_ERR;
+        }
+        if( is_crc && ( crc32c_frame_check( reply, len) != len - KMP_CRC_LEN)){
+            printf("	| ! Bench : reply CRC32C mismatch\n");
+            return UNKNOWN;
+        }
+    }
+    *req_per_sec = BENCH_CRC_MSGS / ( ( bench_now_ns() - start) / 1e9);
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_crc_server( const char *bin)
+ * @brief server 에 trailer 가 없는 메시지와 있는 메시지를 보내서 처리량을 비교하고, 깨진 메시지를 보내면 연결이 닫히는지 확인하는 함수
+ * @return 정상이면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_crc_server( const char *bin){
+    bench_server_t server;
+    char frame[ sizeof( kmp_t) + KMP_CRC_LEN];
+    char stats[ 2048];
+    double plain, sealed;
+    int fd, len, ok;
+
+    if( bench_server_start( &server, bin, BENCH_CRC_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_CRC_PORT)) < 0){
+        bench_server_stop( &server);
+        return UNKNOWN;
+    }
+    ok = ( bench_crc_echo( fd, 0, &plain) == NORMAL) && ( bench_crc_echo( fd, 1, &sealed) == NORMAL);
+    close( fd);
+    if( ok){
+        printf("| %-28s | %10.0f req/s\n", "server.echo_plain", plain);
+        printf("| %-28s | %10.0f req/s (%+.1f%%)\n", "server.echo_crc", sealed, ( sealed / plain - 1) * 100);
+        bench_json_add( "crc.server.echo_plain", plain, "req/s", 0);
+        bench_json_add( "crc.server.echo_crc", sealed, "req/s", 0);
+    }
+
+    // 바디 한 bit 를 바꾸면 server 는 처리하지 않고 연결을 닫아야 한다
+    if( ok && ( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_CRC_PORT)) >= 0)){
+        len = crc32c_frame_seal( frame, bench_make_frame( frame, 100, 1), sizeof( frame));
+        frame[ len - KMP_CRC_LEN - 1] ^= 0x01;
+        ok = ( bench_write_full( fd, frame, len) == NORMAL) && ( read( fd, frame, sizeof( frame)) <= 0);
+        close( fd);
+        ok = ok && ( bench_get_stats( BENCH_CRC_PORT, stats, sizeof( stats)) == NORMAL)
+            && ( bench_stats_value( stats, "crc_errors") == 1) && ( bench_stats_value( stats, "crc_frames") == BENCH_CRC_MSGS);
+        printf("| %-28s | %6s | (crc_frames=%.0f crc_errors=%.0f)\n", "server.corrupt_closed", ok ? "ok" : "FAIL",
+                bench_stats_value( stats, "crc_frames"), bench_stats_value( stats, "crc_errors"));
+    }
+    bench_server_stop( &server);
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief CRC32C 구현별 처리 속도와 복사하면서 검사하는 비용, server 에서 trailer 를 검사하는 비용을 재는 벤치마크
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로 (기본 ../SERVER/server)
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    int lens[] = { 64, 1024, 65536, BENCH_CRC_MAX_LEN};
+    char *src, *dst;
+    int rv = NORMAL;
+    int i;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    if( ( ( src = ( char*)malloc( BENCH_CRC_MAX_LEN + 64)) == NULL) || ( ( dst = ( char*)malloc( BENCH_CRC_MAX_LEN + 64)) == NULL)){
+        return UNKNOWN;
+    }
+    srand( 1);
+    for( i = 0; i < BENCH_CRC_MAX_LEN + 64; i++){
+        src[ i] = rand();
+    }
+
+    if( bench_crc_verify( dst, src) < NORMAL){
+        rv = UNKNOWN;
+    }
+
+    printf("	| @ Bench : CRC32C (%s), best of %d, %d MB per size, tsc/B is TSC ticks per byte\n",
+            crc32c_impl(), BENCH_CRC_REPEAT, BENCH_CRC_BYTES >> 20);
+    printf("| %-8s | %8s | %10s | %8s | %7s |\n", "impl", "bytes", "ns/op", "GB/s", "tsc/B");
+    for( i = 0; i < 4; i++){
+        if( ( bench_crc_run( crc32c_impl(), bench_crc_hw, dst, src, lens[ i]) < NORMAL)
+                || ( bench_crc_run( "table", bench_crc_table, dst, src, lens[ i]) < NORMAL)
+                || ( bench_crc_run( "memcpy", bench_crc_memcpy, dst, src, lens[ i]) < NORMAL)
+                || ( bench_crc_run( "copy+crc", bench_crc_copy, dst, src, lens[ i]) < NORMAL)){
+            rv = UNKNOWN;
+        }
+    }
+
+    if( bench_crc_server( bin) < NORMAL){
+        rv = UNKNOWN;
+    }
+    free( src);
+    free( dst);
+    return rv;
+}
@@ -0,0 +1,280 @@
+#include "bench.h"
+#include <poll.h>
+#include "../COMMON/crc32c.h"
+#include "../CLIENT/hedge.h"
+
+#define BENCH_DEADLINE_PORT ( BENCH_SERVER_PORT + 125)
+/// 요청 하나의 처리 비용 (us). server 하나가 초당 1000 개 정도만 처리하게 한다
+#define BENCH_WORK_US "1000"
+/// 부하 spike : 연결마다 BENCH_WINDOW 개씩 한꺼번에 보낸다 (처리 용량의 수 배가 쌓인다)
+#define BENCH_CONN_NUM 32
+#define BENCH_WINDOW 4
+/// client 가 기다리는 시간 (ms). 이보다 늦게 온 응답은 쓸모가 없다
+#define BENCH_TIMEOUT_MS 20
+#define BENCH_RUN_MS 3000
+#define BENCH_BODY_LEN 128
+/// deadline 을 켰을 때 goodput 이 이 배수 이상 늘어야 한다
+#define BENCH_GOODPUT_GAIN 2.0
+
+/// @struct bench_deadline_result_t
+/// @brief spike 부하 한 번의 결과
+typedef struct bench_deadline_result_s bench_deadline_result_t;
+struct bench_deadline_result_s{
+    /// timeout 안에 받은 정상 응답 수 / timeout 이 지나서 받은 정상 응답 수 (버려지는 처리) / KMP_CODE_EXPIRED 응답 수
+    uint64_t good;
+    uint64_t late;
+    uint64_t expired;
+    /// 걸린 시간 (ns)
+    uint64_t elapsed_ns;
+};
+
+/**
+ * @fn static int bench_deadline_read_reply( int fd, char *reply)
+ * @brief 응답 하나를 읽는 함수 (KMP_CODE_EXPIRED 응답은 헤더만 있다)
+ * @return 응답 길이, 실패하면 SOC_ERR
+ */
+static int bench_deadline_read_reply( int fd, char *reply){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)reply;
+
+    if( bench_read_full( fd, reply, sizeof( kmp_hdr_t)) < NORMAL){
+        return SOC_ERR;
+    }
+    if( ( hdr->length < sizeof( kmp_hdr_t)) || ( hdr->length > sizeof( kmp_t))){
+        return SOC_ERR;
+    }
+    if( ( hdr->length > sizeof( kmp_hdr_t)) && ( bench_read_full( fd, &reply[ sizeof( kmp_hdr_t)], hdr->length - sizeof( kmp_hdr_t)) < NORMAL)){
+        return SOC_ERR;
+    }
+    return hdr->length;
+}
+
+/**
+ * @fn static int bench_deadline_spike( int is_deadline, bench_deadline_result_t *result)
+ * @brief 연결마다 BENCH_WINDOW 개의 요청을 한꺼번에 보내고 모두 받는 round 를 반복하는 함수
+ * 요청마다 BENCH_TIMEOUT_MS 를 기다린다고 보고, 그 안에 받은 정상 응답만 goodput 으로 센다
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param is_deadline 요청에 deadline extension 을 붙일지 여부
+ * @param result 결과
+ */
+static int bench_deadline_spike( int is_deadline, bench_deadline_result_t *result){
+    char frame[ sizeof( kmp_t)], sframe[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    struct pollfd pfds[ BENCH_CONN_NUM];
+    int fds[ BENCH_CONN_NUM], left[ BENCH_CONN_NUM];
+    uint64_t start, sent, now;
+    int i, j, len, slen, pending, rv = NORMAL;
+
+    memset( result, 0, sizeof( *result));
+    for( i = 0; i < BENCH_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_DEADLINE_PORT)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            return SOC_ERR;
+        }
+    }
+    len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+
+    start = bench_now_ns();
+    while( ( rv == NORMAL) && ( bench_now_ns() - start < ( uint64_t)BENCH_RUN_MS * 1000000)){
+        sent = bench_now_ns();
+        memcpy( sframe, frame, len);
+        slen = len;
+        if( is_deadline){
+            slen = kmp_set_deadline( sframe, len, sizeof( sframe), kmp_now_us() + BENCH_TIMEOUT_MS * 1000);
+        }
+        for( i = 0; i < BENCH_CONN_NUM; i++){
+            for( j = 0; j < BENCH_WINDOW; j++){
+                if( bench_write_full( fds[ i], sframe, slen) < NORMAL){
+                    rv = SOC_ERR;
+                }
+            }
+            pfds[ i].fd = fds[ i];
+            pfds[ i].events = POLLIN;
+            left[ i] = BENCH_WINDOW;
+        }
+        // 응답이 도착한 순서대로 읽어야 도착 시각을 잴 수 있다 (연결 순서로 읽으면 앞 연결을 기다리는 동안 뒤 연결의 응답이 늦게 센다)
+        for( pending = BENCH_CONN_NUM * BENCH_WINDOW; ( pending > 0) && ( rv == NORMAL); ){
+            if( poll( pfds, BENCH_CONN_NUM, 1000) <= 0){
+                rv = SOC_ERR;
+                break;
+            }
+            now = bench_now_ns();
+            for( i = 0; i < BENCH_CONN_NUM; i++){
+                if( ( pfds[ i].fd < 0) || ( ( pfds[ i].revents & ( POLLIN | POLLERR | POLLHUP)) == 0)){
+                    continue;
+                }
+                if( bench_deadline_read_reply( fds[ i], reply) < NORMAL){
+                    rv = SOC_ERR;
+                    break;
+                }
+                if( ( ( kmp_hdr_t*)reply)->code == KMP_CODE_EXPIRED){
+                    result->expired++;
+                }
+                else if( now - sent <= ( uint64_t)BENCH_TIMEOUT_MS * 1000000){
+                    result->good++;
+                }
+                else{
+                    result->late++;
+                }
+                pending--;
+                if( --left[ i] == 0){
+                    pfds[ i].fd = -1;
+                }
+            }
+        }
+    }
+    result->elapsed_ns = bench_now_ns() - start;
+    for( i = 0; i < BENCH_CONN_NUM; i++){
+        close( fds[ i]);
+    }
+    return rv;
+}
+
+/**
+ * @fn static void bench_deadline_print( const char *name, bench_deadline_result_t *result)
+ * @brief spike 부하 결과를 한 줄로 출력하는 함수
+ * @return void
+ */
+static void bench_deadline_print( const char *name, bench_deadline_result_t *result){
+    uint64_t done = result->good + result->late;
+
+    printf("| %-16s | %10.0f | %8llu | %8llu | %8llu | %8.1f |\n", name, result->good * 1e9 / result->elapsed_ns,
+            ( unsigned long long)result->good, ( unsigned long long)result->late, ( unsigned long long)result->expired,
+            ( done > 0) ? 100.0 * result->late / done : 0.0);
+}
+
+/**
+ * @fn static int bench_deadline_check()
+ * @brief deadline extension 이 server 에서 떼어지고, 지난 요청은 처리하지 않고 KMP_CODE_EXPIRED 로 답하는지 확인하는 함수
+ * hedge client 의 per-call timeout / 지난 deadline / CRC32C trailer 와 함께 쓴 deadline / 바디가 늦게 오는 지난 요청 /
+ * stream 이 열린 연결의 지난 보통 요청을 차례로 보낸다
+ * @return 모두 맞으면 NORMAL
+ */
+static int bench_deadline_check(){
+    char frame[ sizeof( kmp_t)], sframe[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    char chunk[ sizeof( kmp_t)];
+    hedge_t *hedge;
+    int fd, len, slen, clen, rv = NORMAL;
+
+    len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+
+    // 1. hedge client 가 timeout 을 deadline 으로 실어 보내도 응답은 원래 요청 그대로다
+    if( ( hedge = hedge_init( 0)) == NULL){
+        return UNKNOWN;
+    }
+    hedge->is_deadline = 1;
+    hedge_add_endpoint( hedge, BENCH_SERVER_IP, BENCH_DEADLINE_PORT);
+    if( ( hedge_request( hedge, frame, len, reply, sizeof( reply), 1000) != len)
+            || ( memcmp( &reply[ sizeof( kmp_hdr_t)], &frame[ sizeof( kmp_hdr_t)], len - sizeof( kmp_hdr_t)) != 0)){
+        printf("	| ! Bench : hedge request with deadline was not echoed\n");
+        rv = UNKNOWN;
+    }
+    hedge_destroy( hedge);
+
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_DEADLINE_PORT)) < 0){
+        return SOC_ERR;
+    }
+    // 2. 이미 지난 deadline 은 헤더만 있는 KMP_CODE_EXPIRED 로 돌아온다
+    memcpy( sframe, frame, len);
+    slen = kmp_set_deadline( sframe, len, sizeof( sframe), kmp_now_us() - 1000);
+    if( ( bench_write_full( fd, sframe, slen) < NORMAL) || ( bench_deadline_read_reply( fd, reply) != sizeof( kmp_hdr_t))
+            || ( ( ( kmp_hdr_t*)reply)->code != KMP_CODE_EXPIRED)){
+        printf("	| ! Bench : expired request was not answered with KMP_CODE_EXPIRED\n");
+        rv = UNKNOWN;
+    }
+    // 3. deadline 뒤에 CRC32C trailer 를 붙여도 trailer 를 검사한 뒤 deadline 을 뗀다
+    memcpy( sframe, frame, len);
+    slen = kmp_set_deadline( sframe, len, sizeof( sframe), kmp_now_us() + 1000000);
+    slen = crc32c_frame_seal( sframe, slen, sizeof( sframe));
+    if( ( bench_write_full( fd, sframe, slen) < NORMAL) || ( ( slen = bench_deadline_read_reply( fd, reply)) < NORMAL)
+            || ( crc32c_frame_check( reply, slen) != len) || ( memcmp( &reply[ sizeof( kmp_hdr_t)], &frame[ sizeof( kmp_hdr_t)], len - sizeof( kmp_hdr_t)) != 0)){
+        printf("	| ! Bench : deadline + CRC32C request was not echoed\n");
+        rv = UNKNOWN;
+    }
+    // 4. 지난 요청은 deadline 까지만 보고 바디를 버린다 (깨진 trailer 도 검사하지 않고 trailer 를 붙인 KMP_CODE_EXPIRED 로 답한다)
+    memcpy( sframe, frame, len);
+    slen = kmp_set_deadline( sframe, len, sizeof( sframe), kmp_now_us() - 1000);
+    slen = crc32c_frame_seal( sframe, slen, sizeof( sframe));
+    sframe[ slen - 1] ^= 0x10;
+    if( ( bench_write_full( fd, sframe, sizeof( kmp_hdr_t) + KMP_DEADLINE_LEN) < NORMAL) || ( usleep( 2000) < 0)
+            || ( bench_write_full( fd, &sframe[ sizeof( kmp_hdr_t) + KMP_DEADLINE_LEN], slen - sizeof( kmp_hdr_t) - KMP_DEADLINE_LEN) < NORMAL)
+            || ( ( slen = bench_deadline_read_reply( fd, reply)) < NORMAL) || ( crc32c_frame_check( reply, slen) != sizeof( kmp_hdr_t))
+            || ( ( ( kmp_hdr_t*)reply)->code != KMP_CODE_EXPIRED) || ( ( ( kmp_hdr_t*)reply)->flag & KMP_FLAG_DEADLINE)){
+        printf("	| ! Bench : expired request with a late body was not answered with KMP_CODE_EXPIRED\n");
+        rv = UNKNOWN;
+    }
+    // 5. stream 이 열려 있어도 그 stream 의 chunk 가 아닌 지난 요청은 거절한다 (stream 은 그대로 끝난다)
+    memcpy( chunk, frame, len);
+    ( ( kmp_hdr_t*)chunk)->end_id = 77;
+    ( ( kmp_hdr_t*)chunk)->flag |= KMP_FLAG_MORE;
+    memcpy( sframe, frame, len);
+    ( ( kmp_hdr_t*)sframe)->end_id = 78;
+    slen = kmp_set_deadline( sframe, len, sizeof( sframe), kmp_now_us() - 1000);
+    clen = len;
+    if( ( bench_write_full( fd, chunk, clen) < NORMAL) || ( bench_write_full( fd, sframe, slen) < NORMAL)
+            || ( bench_deadline_read_reply( fd, reply) != sizeof( kmp_hdr_t)) || ( ( ( kmp_hdr_t*)reply)->code != KMP_CODE_EXPIRED)){
+        printf("	| ! Bench : expired request on a connection with an open stream was not rejected\n");
+        rv = UNKNOWN;
+    }
+    ( ( kmp_hdr_t*)chunk)->flag &= ~KMP_FLAG_MORE;
+    if( ( bench_write_full( fd, chunk, clen) < NORMAL) || ( bench_deadline_read_reply( fd, reply) < NORMAL)
+            || ( ( ( kmp_hdr_t*)reply)->end_id != 77)){
+        printf("	| ! Bench : stream did not end after the expired request\n");
+        rv = UNKNOWN;
+    }
+    close( fd);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief request deadline 시험
+ * 처리 용량보다 훨씬 많은 요청이 한꺼번에 몰릴 때, deadline 이 없으면 server 가 client 가 이미 포기한 요청까지 처리하느라
+ * 모든 요청이 늦어지고, deadline 이 있으면 지난 요청을 싸게 버리고 아직 기다리는 요청만 처리하는지 goodput 으로 비교한다
+ * @return deadline 이 goodput 을 BENCH_GOODPUT_GAIN 배 이상 늘렸으면 NORMAL
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *opts[] = { "-W", BENCH_WORK_US, NULL};
+    bench_deadline_result_t plain, deadline;
+    bench_server_t server;
+    char stats[ 4096];
+    int rv = NORMAL;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    if( bench_server_start( &server, bin, BENCH_DEADLINE_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    if( bench_deadline_check() < NORMAL){
+        rv = UNKNOWN;
+    }
+
+    printf("	| @ Bench : %d conns x %d requests per spike, %s us work per request, client timeout %d ms\n",
+            BENCH_CONN_NUM, BENCH_WINDOW, BENCH_WORK_US, BENCH_TIMEOUT_MS);
+    printf("| %-16s | %10s | %8s | %8s | %8s | %8s |\n", "spike", "goodput/s", "good", "late", "expired", "wasted%");
+    if( ( bench_deadline_spike( 0, &plain) < NORMAL) || ( bench_deadline_spike( 1, &deadline) < NORMAL)){
+        printf("	| ! Bench : spike run failed\n");
+        bench_server_stop( &server);
+        return UNKNOWN;
+    }
+    bench_deadline_print( "no deadline", &plain);
+    bench_deadline_print( "deadline", &deadline);
+
+    if( bench_get_stats( BENCH_DEADLINE_PORT, stats, sizeof( stats)) == NORMAL){
+        printf("	| @ Bench : server deadline_frames %.0f, expired_recv %.0f, expired_run %.0f\n",
+                bench_stats_value( stats, "deadline_frames"), bench_stats_value( stats, "expired_recv"),
+                bench_stats_value( stats, "expired_run"));
+    }
+    bench_server_stop( &server);
+
+    if( deadline.good * plain.elapsed_ns < BENCH_GOODPUT_GAIN * plain.good * deadline.elapsed_ns){
+        printf("	| ! Bench : deadlines did not preserve goodput under the spike\n");
+        rv = UNKNOWN;
+    }
+    return rv;
+}
@@ -0,0 +1,156 @@
+#include "bench.h"
+
+#define BENCH_E2E_PORT ( BENCH_SERVER_PORT + 20)
+#define BENCH_REQ_NUM 20000
+#define BENCH_REPEAT 3
+#define BENCH_CONN_MAX 64
+#define BENCH_PERF_CONN_NUM 16
+#define BENCH_PERF_BODY_LEN 256
+#define BENCH_PERF_ROUNDS 20
+#define BENCH_PERF_PATH "/tmp/kmp_bench_perf.csv"
+
+/**
+ * @fn static int bench_e2e_perf( bench_server_t *server)
+ * @brief server 에 perf stat 을 붙이고 echo 부하를 걸어서 메시지 하나당 cache miss 를 구하는 함수
+ * 연결 table / 버퍼 배치를 바꿨을 때 전후를 비교하기 위한 것이다 (PMU 를 쓸 수 있는 장비에서 실행)
+ * @return 정상이면 NORMAL, 실패하면 열거형 참고
+ * @param server 측정할 server 프로세스
+ */
+static int bench_e2e_perf( bench_server_t *server){
+    int fds[ BENCH_PERF_CONN_NUM];
+    double req_per_sec, usec_per_round;
+    uint64_t msgs = 0;
+    pid_t perf_pid;
+    int i, rv = NORMAL;
+
+    for( i = 0; i < BENCH_PERF_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, server->port)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            return SOC_ERR;
+        }
+    }
+
+    if( ( perf_pid = bench_perf_start( server->pid, BENCH_PERF_PATH)) == 0){
+        rv = NOT_EXIST;
+    }
+    for( i = 0; ( rv == NORMAL) && ( i < BENCH_PERF_ROUNDS); i++){
+        if( ( rv = bench_echo_run( fds, BENCH_PERF_CONN_NUM, BENCH_PERF_BODY_LEN, BENCH_REQ_NUM, &req_per_sec, &usec_per_round)) == NORMAL){
+            msgs += ( BENCH_REQ_NUM / BENCH_PERF_CONN_NUM) * BENCH_PERF_CONN_NUM;
+        }
+    }
+
+    printf("| %-28s | %10s |\n", "perf (256B x 16conn)", "per msg");
+    if( ( rv == NORMAL) && ( ( rv = bench_perf_stop( perf_pid, BENCH_PERF_PATH, msgs)) == NORMAL)){
+        printf("	| @ Bench : %llu msgs measured\n", ( unsigned long long)msgs);
+    }
+
+    for( i = 0; i < BENCH_PERF_CONN_NUM; i++){
+        close( fds[ i]);
+    }
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief 메시지 크기와 연결 수를 바꿔가며 loopback echo 처리량을 측정하는 end-to-end 벤치마크
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv [-o result.json] [-p] server 실행 파일 경로 (-p : perf stat 으로 메시지당 cache miss 측정)
+ */
+int main( int argc, char **argv){
+    const char *bin = "../SERVER/server";
+    const char *json_path = NULL;
+    int body_lens[] = { 16, 256, 1000};
+    int conn_nums[] = { 1, 16, BENCH_CONN_MAX};
+    int fds[ BENCH_CONN_MAX];
+    double req_per_sec, usec_per_round, best_req, best_usec;
+    bench_server_t server;
+    char name[ 64];
+    int i, j, k, r, opt;
+    int is_perf = 0;
+    int rv = NORMAL;
+
+    while( ( opt = getopt( argc, argv, "o:p")) != -1){
+        if( opt == 'o'){
+            json_path = optarg;
+        }
+        else if( opt == 'p'){
+            is_perf = 1;
+        }
+        else{
+            printf("	| ! need param : [-o result.json] [-p] [server_bin]\n");
+            return UNKNOWN;
+        }
+    }
+    if( optind < argc){
+        bin = argv[ optind];
+    }
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    if( bench_server_start( &server, bin, BENCH_E2E_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    if( bench_json_open( json_path) < NORMAL){
+        bench_server_stop( &server);
+        return UNKNOWN;
+    }
+
+    if( is_perf){
+        rv = bench_e2e_perf( &server);
+        goto out;
+    }
+
+    printf("| %-28s | %10s | %12s |\n", "e2e (body x conns)", "req/s", "us/round");
+    for( i = 0; i < ( int)( sizeof( conn_nums) / sizeof( int)); i++){
+        for( k = 0; k < conn_nums[ i]; k++){
+            if( ( fds[ k] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_E2E_PORT)) < 0){
+                printf("	| ! Bench : Failed to connect server\n");
+                while( k-- > 0){
+                    close( fds[ k]);
+                }
+                rv = SOC_ERR;
+                goto out;
+            }
+        }
+
+        for( j = 0; j < ( int)( sizeof( body_lens) / sizeof( int)); j++){
+            // 가장 좋은 값을 기록해서 측정 잡음을 줄인다
+            best_req = 0;
+            best_usec = 0;
+            for( r = 0; r < BENCH_REPEAT; r++){
+                if( bench_echo_run( fds, conn_nums[ i], body_lens[ j], BENCH_REQ_NUM, &req_per_sec, &usec_per_round) < NORMAL){
+                    printf("	| ! Bench : e2e run failed\n");
+                    rv = SOC_ERR;
+                    break;
+                }
+                if( req_per_sec > best_req){
+                    best_req = req_per_sec;
+                    best_usec = usec_per_round;
+                }
+            }
+            if( rv < NORMAL){
+                break;
+            }
+
+            snprintf( name, sizeof( name), "e2e.echo.%dB.%dconn", body_lens[ j], conn_nums[ i]);
+            printf("| %-28s | %10.0f | %12.2f |\n", name, best_req, best_usec);
+            bench_json_add( name, best_req, "req/s", 0);
+        }
+
+        for( k = 0; k < conn_nums[ i]; k++){
+            close( fds[ k]);
+        }
+        if( rv < NORMAL){
+            break;
+        }
+    }
+
+out:
+    bench_json_close();
+    bench_server_stop( &server);
+    return ( rv < NORMAL) ? UNKNOWN : NORMAL;
+}
@@ -0,0 +1,316 @@
+#include "bench.h"
+
+#define BENCH_FLIGHT_PORT ( BENCH_SERVER_PORT + 115)
+/// 처리량 비교에 쓰는 연결 수 / 바디 길이 / 요청 수
+#define BENCH_FLIGHT_CONNS 16
+#define BENCH_FLIGHT_BODY_LEN 64
+#define BENCH_FLIGHT_REQS 320000
+/// dump 검사에서 두 연결이 주고받는 요청 수 (fd 를 구분하기 위해 다르게 한다)
+#define BENCH_FLIGHT_A_MSGS 3
+#define BENCH_FLIGHT_B_MSGS 2
+/// dump 파일을 읽는 버퍼 크기
+#define BENCH_FLIGHT_FILE_MAX ( 1 << 20)
+
+/**
+ * @fn static int bench_flight_request( const char *filter, char *out, int cap)
+ * @brief KMP_CODE_FLIGHT 요청으로 server 가 flight recorder 를 dump 하게 하고 응답 바디를 받는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param filter 요청 바디 (10진수면 그 fd 만 dump 한다)
+ */
+static int bench_flight_request( const char *filter, char *out, int cap){
+    kmp_t msg[ 1];
+    kmp_hdr_t hdr;
+    char body[ 16];
+    int fd, len, rv = SOC_ERR;
+
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_FLIGHT_PORT)) < 0){
+        return SOC_ERR;
+    }
+    // kmp_set_msg 는 바디 끝에 NUL 을 쓰므로 복사해서 넘긴다
+    snprintf( body, sizeof( body), "%s", filter);
+    kmp_set_msg( msg, 1, body, KMP_CODE_FLIGHT);
+    if( ( bench_write_full( fd, msg, kmp_get_msg_length( msg)) == NORMAL) && ( bench_read_full( fd, &hdr, sizeof( hdr)) == NORMAL)){
+        len = hdr.length - sizeof( hdr);
+        if( ( len >= 0) && ( len < cap) && ( bench_read_full( fd, out, len) == NORMAL)){
+            out[ len] = '\0';
+            rv = NORMAL;
+        }
+    }
+    close( fd);
+    return rv;
+}
+
+/**
+ * @fn static int bench_flight_load( const char *path, char *buf, int cap)
+ * @brief dump 파일을 읽는 함수
+ * @return 읽은 바이트 수, 실패하면 FD_ERR
+ */
+static int bench_flight_load( const char *path, char *buf, int cap){
+    int fd, len;
+
+    if( ( fd = open( path, O_RDONLY)) < 0){
+        return FD_ERR;
+    }
+    len = read( fd, buf, cap - 1);
+    close( fd);
+    if( len < 0){
+        return FD_ERR;
+    }
+    buf[ len] = '\0';
+    return len;
+}
+
+/**
+ * @fn static int bench_flight_count( const char *buf, int fd, int conn, const char *ev, int *other_fds)
+ * @brief dump 에서 fd 의 ev event 줄 수를 세는 함수 (주석 줄은 건너뛴다)
+ * @return 줄 수
+ * @param fd 셀 fd (-1 이면 모든 fd)
+ * @param conn 셀 연결 id (-1 이면 모든 연결, 닫힌 연결의 fd 는 다시 쓰이므로 연결을 구분할 때 쓴다)
+ * @param ev 셀 event 이름 (NULL 이면 모든 event)
+ * @param other_fds fd 가 다른 event 줄 수 (NULL 이면 세지 않는다)
+ */
+static int bench_flight_count( const char *buf, int fd, int conn, const char *ev, int *other_fds){
+    const char *line = buf, *next, *p;
+    char ev_key[ 32];
+    char conn_key[ 32];
+    int count = 0, line_fd;
+
+    if( ev != NULL){
+        snprintf( ev_key, sizeof( ev_key), " ev=%s ", ev);
+    }
+    snprintf( conn_key, sizeof( conn_key), " conn=%d ", conn);
+    if( other_fds != NULL){
+        *other_fds = 0;
+    }
+    for( ; *line != '\0'; line = next){
+        next = ( ( p = strchr( line, '\n')) != NULL) ? p + 1 : line + strlen( line);
+        if( ( *line == '#') || ( ( p = strstr( line, " fd=")) == NULL) || ( p > next)){
+            continue;
+        }
+        line_fd = atoi( p + 4);
+        if( ( fd >= 0) && ( line_fd != fd)){
+            if( other_fds != NULL){
+                ( *other_fds)++;
+            }
+            continue;
+        }
+        if( ( conn >= 0) && ( ( ( p = strstr( line, conn_key)) == NULL) || ( p > next))){
+            continue;
+        }
+        if( ( ev == NULL) || ( ( ( p = strstr( line, ev_key)) != NULL) && ( p < next))){
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @fn static int bench_flight_find_fd( const char *buf, int frames, int *conn)
+ * @brief dump 에서 frame event 가 정확히 frames 개인 연결의 fd 를 찾는 함수 (server 쪽 fd 는 bench 가 모른다)
+ * @return fd, 없으면 NOT_EXIST
+ * @param conn 찾은 연결의 id
+ */
+static int bench_flight_find_fd( const char *buf, int frames, int *conn){
+    const char *p = buf, *id;
+    int fd;
+
+    while( ( p = strstr( p, " ev=accept ")) != NULL){
+        const char *line = p;
+        while( ( line > buf) && ( line[ -1] != '\n')){
+            line--;
+        }
+        if( ( ( line = strstr( line, " fd=")) != NULL) && ( line < p) && ( ( id = strstr( line, " conn=")) != NULL) && ( id < p)){
+            fd = atoi( line + 4);
+            *conn = atoi( id + 6);
+            if( bench_flight_count( buf, fd, *conn, "frame", NULL) == frames){
+                return fd;
+            }
+        }
+        p++;
+    }
+    return NOT_EXIST;
+}
+
+/**
+ * @fn static int bench_flight_throughput( const char *bin, const char *name, const char *events, double *req_per_sec)
+ * @brief flight recorder 를 켜고 / 끄고 echo 처리량을 재는 함수
+ * @return 정상이면 NORMAL, 실패하면 UNKNOWN
+ * @param events "-Y" 인자
+ */
+static int bench_flight_throughput( const char *bin, const char *name, const char *events, double *req_per_sec){
+    const char *opts[] = { "-Y", events, NULL};
+    bench_server_t server;
+    int fds[ BENCH_FLIGHT_CONNS];
+    double usec_per_round;
+    int i, rv = NORMAL;
+
+    if( bench_server_start( &server, bin, BENCH_FLIGHT_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    for( i = 0; i < BENCH_FLIGHT_CONNS; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_FLIGHT_PORT)) < 0){
+            rv = UNKNOWN;
+            break;
+        }
+    }
+    if( ( rv == NORMAL) && ( bench_echo_run( fds, BENCH_FLIGHT_CONNS, BENCH_FLIGHT_BODY_LEN, BENCH_FLIGHT_REQS,
+                    req_per_sec, &usec_per_round) < NORMAL)){
+        rv = UNKNOWN;
+    }
+    while( --i >= 0){
+        close( fds[ i]);
+    }
+    bench_server_stop( &server);
+    if( rv == NORMAL){
+        printf("| %-10s | %8s | %12.0f | %10.2f |\n", name, events, *req_per_sec, usec_per_round);
+    }
+    return rv;
+}
+
+/**
+ * @fn static int bench_flight_echo( int fd, int num)
+ * @brief 연결 하나로 echo 요청을 num 번 주고받는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_flight_echo( int fd, int num){
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    int len = bench_make_frame( frame, BENCH_FLIGHT_BODY_LEN, 1);
+    int i;
+
+    for( i = 0; i < num; i++){
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, len) < NORMAL)){
+            return SOC_ERR;
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_flight_dump( const char *bin)
+ * @brief 요청 dump 와 fd filter, SIGUSR2 dump 에 연결 event 가 남는지 확인하는 함수
+ * 연결 A 는 요청 3 개, B 는 2 개를 주고받은 뒤 전체 dump 에서 frame 수로 server 쪽 fd 를 찾고,
+ * A 의 fd 로 filter 한 dump 에 A 의 event 만 있는지, B 를 RST 로 끊은 뒤 SIGUSR2 dump 에 B 의 close 가 있는지 본다
+ * @return 모두 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_flight_dump( const char *bin){
+    static char file[ BENCH_FLIGHT_FILE_MAX];
+    const char *opts[] = { "-Y", "4096:/tmp/kmp_bench_flight", NULL};
+    bench_server_t server;
+    struct linger lin = { 1, 0};
+    char reply[ 1024];
+    char path[ 256];
+    char filter[ 16];
+    int a_fd, b_fd, sa_fd = NOT_EXIST, sb_fd = NOT_EXIST, a_conn = 0, b_conn = 0;
+    int all = 0, only_a = 0, other = 0, frames_a = 0, closes_b = 0, dumped;
+    int rv = NORMAL;
+    uint64_t start, dump_ns = 0;
+
+    if( bench_server_start( &server, bin, BENCH_FLIGHT_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    snprintf( path, sizeof( path), "/tmp/kmp_bench_flight.%d", ( int)server.pid);
+    a_fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_FLIGHT_PORT);
+    b_fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_FLIGHT_PORT);
+    if( ( a_fd < 0) || ( b_fd < 0) || ( bench_flight_echo( a_fd, BENCH_FLIGHT_A_MSGS) < NORMAL)
+            || ( bench_flight_echo( b_fd, BENCH_FLIGHT_B_MSGS) < NORMAL)){
+        rv = UNKNOWN;
+    }
+
+    // 전체 dump 에서 server 쪽 fd 를 찾는다
+    start = bench_now_ns();
+    if( ( rv == NORMAL) && ( bench_flight_request( "*", reply, sizeof( reply)) == NORMAL)){
+        dump_ns = bench_now_ns() - start;
+        if( bench_flight_load( path, file, sizeof( file)) > 0){
+            all = bench_flight_count( file, -1, -1, NULL, NULL);
+            sa_fd = bench_flight_find_fd( file, BENCH_FLIGHT_A_MSGS, &a_conn);
+            sb_fd = bench_flight_find_fd( file, BENCH_FLIGHT_B_MSGS, &b_conn);
+        }
+    }
+    printf("| %-28s | %6s | (%d events, %.0f us, server fds a=%d b=%d)\n", "flight.dump_all",
+            ( ( all > 0) && ( sa_fd >= 0) && ( sb_fd >= 0)) ? "ok" : "FAIL", all, dump_ns / 1000.0, sa_fd, sb_fd);
+    if( ( all == 0) || ( sa_fd < 0) || ( sb_fd < 0)){
+        rv = UNKNOWN;
+    }
+
+    // A 의 fd 만 dump 한다
+    if( rv == NORMAL){
+        snprintf( filter, sizeof( filter), "%d", sa_fd);
+        if( ( bench_flight_request( filter, reply, sizeof( reply)) == NORMAL) && ( bench_flight_load( path, file, sizeof( file)) > 0)){
+            dumped = ( int)bench_stats_value( reply, "flight_dumped");
+            only_a = bench_flight_count( file, -1, -1, NULL, NULL);
+            bench_flight_count( file, sa_fd, -1, NULL, &other);
+            frames_a = bench_flight_count( file, sa_fd, a_conn, "frame", NULL);
+            printf("| %-28s | %6s | (%d events, %d frames, %d of other fds, reply %d)\n", "flight.dump_fd_filter",
+                    ( ( only_a > 0) && ( other == 0) && ( frames_a == BENCH_FLIGHT_A_MSGS) && ( dumped == only_a)) ? "ok" : "FAIL",
+                    only_a, frames_a, other, dumped);
+            if( ( only_a == 0) || ( other != 0) || ( frames_a != BENCH_FLIGHT_A_MSGS) || ( dumped != only_a)){
+                rv = UNKNOWN;
+            }
+        }
+        else{
+            rv = UNKNOWN;
+        }
+    }
+
+    // B 를 RST 로 끊고 signal 로 dump 한다 (연결이 닫힌 이유와 그때 상태가 남아야 한다)
+    if( rv == NORMAL){
+        setsockopt( b_fd, SOL_SOCKET, SO_LINGER, &lin, sizeof( lin));
+        close( b_fd);
+        b_fd = -1;
+        usleep( 50000);
+        unlink( path);
+        kill( server.pid, SIGUSR2);
+        usleep( 50000);
+        if( bench_flight_load( path, file, sizeof( file)) > 0){
+            closes_b = bench_flight_count( file, sb_fd, b_conn, "close", NULL);
+        }
+        printf("| %-28s | %6s | (%d events, close of fd %d: %d)\n", "flight.dump_signal",
+                ( closes_b == 1) ? "ok" : "FAIL", bench_flight_count( file, -1, -1, NULL, NULL), sb_fd, closes_b);
+        if( closes_b != 1){
+            rv = UNKNOWN;
+        }
+    }
+
+    if( a_fd >= 0){
+        close( a_fd);
+    }
+    if( b_fd >= 0){
+        close( b_fd);
+    }
+    bench_server_stop( &server);
+    unlink( path);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief flight recorder 를 켠 server 와 끈 server 의 echo 처리량을 비교하고 dump 를 확인하는 벤치마크
+ * event 하나를 남기는 비용은 bench_micro 의 micro.flight_record 로 잰다
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로 (기본 ../SERVER/server)
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    double off = 0, on = 0;
+    int rv = NORMAL;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    printf("	| @ Bench : %d connections, %d byte echo, %d requests\n", BENCH_FLIGHT_CONNS, BENCH_FLIGHT_BODY_LEN, BENCH_FLIGHT_REQS);
+    printf("| %-10s | %8s | %12s | %10s |\n", "flight", "events", "req/s", "us/round");
+    if( ( bench_flight_throughput( bin, "off", "0", &off) < NORMAL) || ( bench_flight_throughput( bin, "on", "4096", &on) < NORMAL)
+            || ( bench_flight_throughput( bin, "on", "65536", &on) < NORMAL)){
+        rv = UNKNOWN;
+    }
+    if( ( rv == NORMAL) && ( off > 0)){
+        printf("| %-10s | %8s | %11.1f%% |\n", "on vs off", "65536", ( on - off) / off * 100);
+    }
+    if( bench_flight_dump( bin) < NORMAL){
+        rv = UNKNOWN;
+    }
+    return rv;
+}
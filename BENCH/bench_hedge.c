@@ -0,0 +1,203 @@
+#include "bench.h"
+#include "../CLIENT/hedge.h"
+
+#define BENCH_HEDGE_PORT ( BENCH_SERVER_PORT + 70)
+#define BENCH_SERVER_NUM 3
+#define BENCH_BODY_LEN 128
+#define BENCH_RUN_MS 3000
+/// 요청 간격 (us). 닫힌 loop 로 보내면 멈춘 server 에 걸린 요청 하나가 나머지 요청을 미뤄서 tail 이 가려진다
+#define BENCH_INTERVAL_US 500
+/// server 하나를 BENCH_STALL_PERIOD_MS 마다 BENCH_STALL_MS 동안 멈춘다 (GC / 디스크 지연 흉내)
+#define BENCH_STALL_PERIOD_MS 100
+#define BENCH_STALL_MS 20
+#define BENCH_TIMEOUT_MS 1000
+#define BENCH_BUDGET 0.05
+#define BENCH_SAMPLE_MAX ( 1 << 16)
+
+/**
+ * @fn static pid_t bench_hedge_staller( pid_t pid)
+ * @brief server 하나를 주기적으로 SIGSTOP / SIGCONT 하는 프로세스를 띄우는 함수
+ * @return 띄운 프로세스 id, 실패하면 -1
+ */
+static pid_t bench_hedge_staller( pid_t pid){
+    pid_t child;
+
+    if( ( child = fork()) != 0){
+        return child;
+    }
+    while( 1){
+        usleep( ( BENCH_STALL_PERIOD_MS - BENCH_STALL_MS) * 1000);
+        kill( pid, SIGSTOP);
+        usleep( BENCH_STALL_MS * 1000);
+        kill( pid, SIGCONT);
+    }
+    _exit( 0);
+}
+
+/**
+ * @fn static int bench_hedge_round_robin( uint64_t *samples, int *errors)
+ * @brief 연결마다 blocking 으로 하나씩 돌아가며 보내는 기준선을 재는 함수
+ * @return 잰 요청 수
+ */
+static int bench_hedge_round_robin( uint64_t *samples, int *errors){
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    int fds[ BENCH_SERVER_NUM];
+    uint64_t start, sent;
+    int i, len, num = 0;
+
+    for( i = 0; i < BENCH_SERVER_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_HEDGE_PORT + i)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            ( *errors)++;
+            return 0;
+        }
+    }
+    len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    start = bench_now_ns();
+    for( i = 0; ( num < BENCH_SAMPLE_MAX) && ( bench_now_ns() - start < ( uint64_t)BENCH_RUN_MS * 1000000); i = ( i + 1) % BENCH_SERVER_NUM){
+        sent = bench_now_ns();
+        if( ( bench_write_full( fds[ i], frame, len) < NORMAL) || ( bench_read_full( fds[ i], reply, len) < NORMAL)){
+            ( *errors)++;
+            break;
+        }
+        samples[ num++] = bench_now_ns() - sent;
+        usleep( BENCH_INTERVAL_US);
+    }
+    for( i = 0; i < BENCH_SERVER_NUM; i++){
+        close( fds[ i]);
+    }
+    return num;
+}
+
+/**
+ * @fn static int bench_hedge_run( hedge_t *hedge, uint64_t *samples, int *errors)
+ * @brief hedge_request 로 보내면서 요청마다 응답 지연을 재는 함수
+ * @return 잰 요청 수
+ */
+static int bench_hedge_run( hedge_t *hedge, uint64_t *samples, int *errors){
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    uint64_t start, sent;
+    int i, len, num = 0;
+
+    for( i = 0; i < BENCH_SERVER_NUM; i++){
+        hedge_add_endpoint( hedge, BENCH_SERVER_IP, BENCH_HEDGE_PORT + i);
+    }
+    len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    start = bench_now_ns();
+    while( ( num < BENCH_SAMPLE_MAX) && ( bench_now_ns() - start < ( uint64_t)BENCH_RUN_MS * 1000000)){
+        sent = bench_now_ns();
+        if( hedge_request( hedge, frame, len, reply, sizeof( reply), BENCH_TIMEOUT_MS) != len){
+            ( *errors)++;
+            break;
+        }
+        samples[ num++] = bench_now_ns() - sent;
+        usleep( BENCH_INTERVAL_US);
+    }
+    return num;
+}
+
+/**
+ * @fn static void bench_hedge_print( const char *name, uint64_t *samples, int num, hedge_t *hedge)
+ * @brief 응답 지연 분포와 hedge 통계를 한 줄로 출력하는 함수
+ * @return void
+ */
+static void bench_hedge_print( const char *name, uint64_t *samples, int num, hedge_t *hedge){
+    printf("| %-22s | %7d | %8.1f | %8.1f | %8.1f | %8.1f |", name, num,
+            bench_percentile( samples, num, 50) / 1000.0, bench_percentile( samples, num, 99) / 1000.0,
+            bench_percentile( samples, num, 99.9) / 1000.0, bench_percentile( samples, num, 100) / 1000.0);
+    if( ( hedge != NULL) && ( hedge->requests > 0)){
+        printf(" %6.2f | %6llu | %6llu |\n", 100.0 * hedge->hedges / hedge->requests,
+                ( unsigned long long)hedge->hedges_won, ( unsigned long long)hedge->hedges_denied);
+    }
+    else{
+        printf(" %6s | %6s | %6s |\n", "-", "-", "-");
+    }
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief hedged request 시험
+ * server 3 개 중 하나를 주기적으로 멈추고, 돌아가며 보내기 / 지연 기반 선택 / 지연 기반 선택 + hedge 의 응답 지연 분포를 비교한다
+ * @return hedge 가 기준선보다 p99.9 를 줄였으면 NORMAL
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    static uint64_t samples[ BENCH_SAMPLE_MAX];
+    bench_server_t servers[ BENCH_SERVER_NUM];
+    hedge_t *aware, *hedged;
+    uint64_t rr_tail, hedged_tail;
+    int i, num, errors = 0, rv = NORMAL;
+    pid_t staller;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    memset( servers, 0, sizeof( servers));
+
+    for( i = 0; i < BENCH_SERVER_NUM; i++){
+        if( bench_server_start( &servers[ i], bin, BENCH_HEDGE_PORT + i, NULL, NULL) < NORMAL){
+            printf("	| ! Bench : Failed to start server (%s)\n", bin);
+            while( i-- > 0){
+                bench_server_stop( &servers[ i]);
+            }
+            return UNKNOWN;
+        }
+    }
+    if( ( staller = bench_hedge_staller( servers[ 0].pid)) < 0){
+        for( i = 0; i < BENCH_SERVER_NUM; i++){
+            bench_server_stop( &servers[ i]);
+        }
+        return UNKNOWN;
+    }
+    aware = hedge_init( 0);
+    hedged = hedge_init( BENCH_BUDGET);
+
+    printf("	| @ Bench : %d servers, server 1 stalls %d ms every %d ms, request every %d us, hedge budget %.0f%%\n",
+            BENCH_SERVER_NUM, BENCH_STALL_MS, BENCH_STALL_PERIOD_MS, BENCH_INTERVAL_US, BENCH_BUDGET * 100);
+    printf("| %-22s | %7s | %8s | %8s | %8s | %8s | %6s | %6s | %6s |\n",
+            "latency (us)", "count", "p50", "p99", "p99.9", "max", "hedge%", "won", "denied");
+
+    num = bench_hedge_round_robin( samples, &errors);
+    bench_hedge_print( "round robin", samples, num, NULL);
+    rr_tail = bench_percentile( samples, num, 99.9);
+
+    if( ( aware != NULL) && ( hedged != NULL)){
+        num = bench_hedge_run( aware, samples, &errors);
+        bench_hedge_print( "latency aware", samples, num, aware);
+
+        num = bench_hedge_run( hedged, samples, &errors);
+        bench_hedge_print( "latency aware + hedge", samples, num, hedged);
+        hedged_tail = bench_percentile( samples, num, 99.9);
+
+        for( i = 0; i < hedged->ep_num; i++){
+            printf("	| @ Bench : %-16s : ewma %8.1f us, p95 %6u us, sent %6llu, won %6llu, dropped %6llu\n",
+                    hedged->eps[ i].name, hedged->eps[ i].ewma_us, hedged->eps[ i].p95_us,
+                    ( unsigned long long)hedged->eps[ i].sent, ( unsigned long long)hedged->eps[ i].won,
+                    ( unsigned long long)hedged->eps[ i].dropped);
+        }
+        if( hedged_tail >= rr_tail){
+            printf("	| ! Bench : hedging did not cut the tail\n");
+            rv = UNKNOWN;
+        }
+    }
+    else{
+        errors++;
+    }
+
+    kill( staller, SIGKILL);
+    waitpid( staller, NULL, 0);
+    kill( servers[ 0].pid, SIGCONT);
+    hedge_destroy( aware);
+    hedge_destroy( hedged);
+    for( i = 0; i < BENCH_SERVER_NUM; i++){
+        bench_server_stop( &servers[ i]);
+    }
+    if( errors > 0){
+        printf("	| ! Bench : %d request errors\n", errors);
+        rv = UNKNOWN;
+    }
+    return rv;
+}
@@ -0,0 +1,546 @@
+// server.c 를 그대로 포함하므로 server.c 와 같이 맨 앞에 정의한다 (recvmmsg / sendmmsg)
+#define _GNU_SOURCE
+#include "bench.h"
+
+// server의 static 함수(server_transc_clear, server_recv_data, server_send_data)를 직접 측정하기 위해
+// server.c 를 그대로 포함한다. server의 main은 이름만 바꿔서 사용하지 않는다
+#define main server_main
+#include "../SERVER/server.c"
+#undef main
+#include "../COMMON/mempipe.h"
+
+#define BENCH_REPEAT 15
+#define BENCH_ITERS 300000
+#define BENCH_IO_ITERS 20000
+/// 짧은 read / write script 하나로 주고 받는 메시지 수
+#define BENCH_PARTIAL_MSGS 200
+
+/// 컴파일러가 측정 대상 연산을 없애지 않도록 결과를 모으는 변수
+static volatile uint64_t bench_sink = 0;
+
+/// @brief 측정 대상 함수 (iters 번 반복하고 걸린 시간(ns)을 돌려준다)
+typedef uint64_t ( *bench_micro_fn)( void *arg, int iters);
+
+/**
+ * @fn static double bench_micro_run( const char *name, bench_micro_fn fn, void *arg, int iters)
+ * @brief 측정을 BENCH_REPEAT 번 반복해서 가장 빠른 값을 ns/op 로 기록하는 함수
+ * 가장 빠른 값을 쓰면 다른 프로세스나 CPU 주파수 변화의 영향을 덜 받는다
+ * @return ns/op
+ */
+static double bench_micro_run( const char *name, bench_micro_fn fn, void *arg, int iters){
+    uint64_t best = UINT64_MAX;
+    uint64_t elapsed;
+    double ns_per_op;
+    int i;
+
+    // 캐시와 분기 예측을 데운다
+    fn( arg, iters / 10);
+    for( i = 0; i < BENCH_REPEAT; i++){
+        if( ( elapsed = fn( arg, iters)) < best){
+            best = elapsed;
+        }
+    }
+
+    ns_per_op = ( double)best / iters;
+    printf("| %-28s | %10.2f |\n", name, ns_per_op);
+    bench_json_add( name, ns_per_op, "ns/op", 1);
+    return ns_per_op;
+}
+
+/**
+ * @fn static uint64_t bench_kmp_set_msg( void *arg, int iters)
+ * @brief kmp_set_msg() 로 메시지를 만드는 비용
+ */
+static uint64_t bench_kmp_set_msg( void *arg, int iters){
+    char *body = ( char*)arg;
+    kmp_t msg[ 1];
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        kmp_set_msg( msg, 1, body, i);
+        bench_sink += msg->hdr.length;
+    }
+    return bench_now_ns() - start;
+}
+
+/// @struct bench_body_arg_t
+/// @brief 바이너리 메시지 API 측정용 인자 (바디와 길이, 보내는 측정이면 socketpair)
+typedef struct bench_body_arg_s bench_body_arg_t;
+struct bench_body_arg_s{
+    char body[ DATA_MAX_LEN];
+    int len;
+    /// 보내는 쪽 / 받아서 버리는 쪽 소켓
+    int fd;
+    int peer_fd;
+};
+
+/**
+ * @fn static uint64_t bench_kmp_set_body( void *arg, int iters)
+ * @brief kmp_set_body() 로 메시지를 만드는 비용 (바디 길이만큼만 복사한다)
+ */
+static uint64_t bench_kmp_set_body( void *arg, int iters){
+    bench_body_arg_t *b = ( bench_body_arg_t*)arg;
+    kmp_t msg[ 1];
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        bench_sink += kmp_set_body( msg, 1, i, b->body, b->len);
+    }
+    return bench_now_ns() - start;
+}
+
+/**
+ * @fn static uint64_t bench_kmp_iov_init( void *arg, int iters)
+ * @brief kmp_iov_init() 로 메시지를 만드는 비용 (헤더만 만들고 바디는 가리키기만 한다)
+ */
+static uint64_t bench_kmp_iov_init( void *arg, int iters){
+    bench_body_arg_t *b = ( bench_body_arg_t*)arg;
+    kmp_iov_t msg[ 1];
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        bench_sink += kmp_iov_init( msg, 1, i, b->body, b->len);
+    }
+    return bench_now_ns() - start;
+}
+
+/**
+ * @fn static uint64_t bench_send_copy( void *arg, int iters)
+ * @brief kmp_set_msg() 로 만들고 write 한 번으로 보내는 비용 (받는 쪽은 읽어서 버린다)
+ */
+static uint64_t bench_send_copy( void *arg, int iters){
+    bench_body_arg_t *b = ( bench_body_arg_t*)arg;
+    char frame[ sizeof( kmp_t)];
+    kmp_t msg[ 1];
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        kmp_set_msg( msg, 1, b->body, i);
+        bench_write_full( b->fd, msg, kmp_get_msg_length( msg));
+        bench_read_full( b->peer_fd, frame, kmp_get_msg_length( msg));
+    }
+    return bench_now_ns() - start;
+}
+
+/**
+ * @fn static uint64_t bench_send_iov( void *arg, int iters)
+ * @brief kmp_iov_init() 로 만들고 kmp_iov_write() (writev 한 번) 로 보내는 비용 (받는 쪽은 읽어서 버린다)
+ */
+static uint64_t bench_send_iov( void *arg, int iters){
+    bench_body_arg_t *b = ( bench_body_arg_t*)arg;
+    char frame[ sizeof( kmp_t)];
+    kmp_iov_t msg[ 1];
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        kmp_iov_init( msg, 1, i, b->body, b->len);
+        if( kmp_iov_write( b->fd, msg) != 0){
+            return UINT64_MAX;
+        }
+        bench_read_full( b->peer_fd, frame, msg->hdr.length);
+    }
+    return bench_now_ns() - start;
+}
+
+/**
+ * @fn static int bench_iov_check( bench_body_arg_t *b)
+ * @brief kmp_iov 로 보낸 바이트가 kmp_set_msg 로 만든 메시지와 같은지, NUL 이 섞인 바디와
+ * 여러 조각을 붙인 메시지가 그대로 가는지 확인하는 함수
+ * @return 같으면 NORMAL, 다르면 UNKNOWN
+ */
+static int bench_iov_check( bench_body_arg_t *b){
+    char expect[ sizeof( kmp_t)];
+    char frame[ sizeof( kmp_t)];
+    char binary[ 64];
+    kmp_iov_t msg[ 1];
+    kmp_t copy[ 1];
+    int len, ok;
+
+    // 같은 바디면 kmp_set_msg 와 바이트가 같아야 한다
+    len = bench_make_frame( expect, b->len, 1);
+    kmp_iov_init( msg, 1, 1, b->body, b->len);
+    ok = ( kmp_iov_write( b->fd, msg) == 0) && ( bench_read_full( b->peer_fd, frame, len) == NORMAL)
+        && ( memcmp( expect, frame, len) == 0);
+
+    // NUL 이 섞인 바디를 세 조각으로 나눠 붙여도 kmp_set_body 와 같아야 한다
+    for( len = 0; len < ( int)sizeof( binary); len++){
+        binary[ len] = len % 3 ? len : 0;
+    }
+    len = kmp_set_body( copy, 1, 7, binary, sizeof( binary));
+    kmp_iov_init( msg, 1, 7, binary, 10);
+    kmp_iov_add( msg, &binary[ 10], 0);
+    kmp_iov_add( msg, &binary[ 10], sizeof( binary) - 10);
+    ok = ok && ( len == ( int)msg->hdr.length) && ( kmp_iov_write( b->fd, msg) == 0)
+        && ( bench_read_full( b->peer_fd, frame, len) == NORMAL) && ( memcmp( copy, frame, len) == 0);
+
+    printf("| %-28s | %10s |\n", "kmp_iov.same_bytes", ok ? "ok" : "FAIL");
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static uint64_t bench_kmp_decode( void *arg, int iters)
+ * @brief kmp_get_msg_length() 로 헤더의 메시지 길이를 구하는 비용
+ */
+static uint64_t bench_kmp_decode( void *arg, int iters){
+    kmp_t *msg = ( kmp_t*)arg;
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        bench_sink += kmp_get_msg_length( msg);
+        __asm__ __volatile__( "" ::: "memory");
+    }
+    return bench_now_ns() - start;
+}
+
+/**
+ * @fn static uint64_t bench_server_decode( void *arg, int iters)
+ * @brief server 가 수신한 헤더 버퍼에서 메시지 길이를 구하는 비용 (server_transc_get_msg_length)
+ */
+static uint64_t bench_server_decode( void *arg, int iters){
+    transc_t *transc = ( transc_t*)arg;
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        bench_sink += server_transc_get_msg_length( transc);
+        __asm__ __volatile__( "" ::: "memory");
+    }
+    return bench_now_ns() - start;
+}
+
+/**
+ * @fn static uint64_t bench_transc_clear( void *arg, int iters)
+ * @brief 메시지 하나를 처리할 때마다 호출되는 server_transc_clear() 비용
+ */
+static uint64_t bench_transc_clear( void *arg, int iters){
+    transc_t *transc = ( transc_t*)arg;
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        server_transc_clear( transc);
+        bench_sink += transc->length;
+    }
+    return bench_now_ns() - start;
+}
+
+/// @struct bench_flight_arg_t
+/// @brief flight recorder 측정용 인자
+typedef struct bench_flight_arg_s bench_flight_arg_t;
+struct bench_flight_arg_s{
+    flight_t *flight;
+    transc_t *transc;
+};
+
+/**
+ * @fn static uint64_t bench_flight_record( void *arg, int iters)
+ * @brief 읽기 / 쓰기마다 호출되는 flight_record() 비용 (연결 상태 bit 를 만드는 비용 포함)
+ */
+static uint64_t bench_flight_record( void *arg, int iters){
+    bench_flight_arg_t *fa = ( bench_flight_arg_t*)arg;
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        flight_record( fa->flight, FLIGHT_EV_READ, fa->transc->fd, fa->transc->conn_id, server_flight_state( fa->transc),
+                ERRNO_EAGAIN, EAGAIN, i);
+    }
+    bench_sink += fa->flight->head;
+    return bench_now_ns() - start;
+}
+
+/// @struct bench_io_arg_t
+/// @brief recv / send 상태 기계 측정용 인자
+typedef struct bench_io_arg_s bench_io_arg_t;
+struct bench_io_arg_s{
+    /// 측정 대상 연결 (server 쪽 소켓)
+    transc_t *transc;
+    /// client 쪽 소켓
+    int peer_fd;
+    /// 보낼 메시지
+    char frame[ sizeof( kmp_t)];
+    /// 메시지 길이
+    int len;
+};
+
+/**
+ * @fn static uint64_t bench_state_machine( void *arg, int iters)
+ * @brief socketpair 위에서 server_recv_data -> server_send_data -> server_transc_clear 를 한 번 도는 비용
+ * 메시지 하나를 처리하는 server 쪽 경로 전체 (read 2번 + write 2번 + 복사)
+ */
+static uint64_t bench_state_machine( void *arg, int iters){
+    bench_io_arg_t *io = ( bench_io_arg_t*)arg;
+    char reply[ sizeof( kmp_t)];
+    uint64_t start = bench_now_ns();
+    int i, rv;
+
+    for( i = 0; i < iters; i++){
+        bench_write_full( io->peer_fd, io->frame, io->len);
+        while( ( rv = server_recv_data( io->transc, io->transc->fd)) != RECV_COMPLETE){
+            if( ( rv < NORMAL) && ( rv != INTERRUPT)){
+                return UINT64_MAX;
+            }
+        }
+        if( server_send_data( io->transc, io->transc->fd) != NORMAL){
+            return UINT64_MAX;
+        }
+        server_transc_clear( io->transc);
+        bench_read_full( io->peer_fd, reply, io->len);
+    }
+    return bench_now_ns() - start;
+}
+
+/// @struct bench_mem_arg_t
+/// @brief 메모리 pipe 위의 상태 기계 측정용 인자 (server 쪽 연결은 ends[ 0], client 는 ends[ 1])
+typedef struct bench_mem_arg_s bench_mem_arg_t;
+struct bench_mem_arg_s{
+    transc_t *transc;
+    mempipe_t *pipe;
+    char frame[ sizeof( kmp_t)];
+    int len;
+};
+
+/**
+ * @fn static int bench_mem_echo( bench_mem_arg_t *mem, char *reply)
+ * @brief client 끝에서 메시지를 쓰고, server 상태 기계로 받고 응답한 뒤, client 끝에서 응답을 모두 읽는 함수
+ * server 쪽 끝에 script 가 있으면 짧은 read / write 와 EAGAIN 이 섞인다 (server 함수는 될 때까지 다시 부른다)
+ * @return 정상이면 NORMAL, 상태 기계가 실패하면 그 값
+ */
+static int bench_mem_echo( bench_mem_arg_t *mem, char *reply){
+    io_t *client = &mem->pipe->ends[ 1].io;
+    int off, n, rv;
+
+    for( off = 0; off < mem->len; off += n){
+        if( ( n = client->write( client, &mem->frame[ off], mem->len - off)) < 0){
+            return SOC_ERR;
+        }
+    }
+    while( ( rv = server_recv_data( mem->transc, mem->transc->fd)) != RECV_COMPLETE){
+        if( ( rv < NORMAL) && ( rv != INTERRUPT)){
+            return rv;
+        }
+    }
+    while( ( rv = server_send_data( mem->transc, mem->transc->fd)) != NORMAL){
+        if( rv < NORMAL){
+            return rv;
+        }
+    }
+    server_transc_clear( mem->transc);
+    for( off = 0; off < mem->len; off += n){
+        if( ( n = client->read( client, &reply[ off], mem->len - off)) <= 0){
+            return SOC_ERR;
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static uint64_t bench_state_machine_mem( void *arg, int iters)
+ * @brief 메모리 pipe 위에서 server_recv_data -> server_send_data -> server_transc_clear 를 한 번 도는 비용
+ * socketpair 측정과 같은 경로에서 system call 만 뺀 framing / 상태 기계 비용
+ */
+static uint64_t bench_state_machine_mem( void *arg, int iters){
+    bench_mem_arg_t *mem = ( bench_mem_arg_t*)arg;
+    char reply[ sizeof( kmp_t)];
+    uint64_t start = bench_now_ns();
+    int i;
+
+    for( i = 0; i < iters; i++){
+        if( bench_mem_echo( mem, reply) < NORMAL){
+            return UINT64_MAX;
+        }
+    }
+    return bench_now_ns() - start;
+}
+
+/**
+ * @fn static int bench_partial_io( bench_mem_arg_t *mem, const char *name, const int *reads, int read_num, const int *writes, int write_num)
+ * @brief server 쪽 끝의 read / write 를 script 대로 자르면서 메시지 BENCH_PARTIAL_MSGS 개를 주고 받고 응답이 요청과 같은지 확인하는 함수
+ * @return 모두 같으면 NORMAL, 다르거나 상태 기계가 실패하면 UNKNOWN
+ */
+static int bench_partial_io( bench_mem_arg_t *mem, const char *name, const int *reads, int read_num, const int *writes, int write_num){
+    char reply[ sizeof( kmp_t)];
+    mempipe_end_t *end = &mem->pipe->ends[ 0];
+    uint64_t eagains = end->eagains;
+    int i, rv = NORMAL;
+
+    mempipe_script( end, 0, reads, read_num);
+    mempipe_script( end, 1, writes, write_num);
+    for( i = 0; ( i < BENCH_PARTIAL_MSGS) && ( rv == NORMAL); i++){
+        if( ( bench_mem_echo( mem, reply) < NORMAL) || ( memcmp( reply, mem->frame, mem->len) != 0)){
+            rv = UNKNOWN;
+        }
+    }
+    mempipe_script( end, 0, NULL, 0);
+    mempipe_script( end, 1, NULL, 0);
+    printf("| %-28s | %10s | (%d msgs, %llu EAGAIN)\n", name, ( rv == NORMAL) ? "ok" : "FAIL", i,
+            ( unsigned long long)( end->eagains - eagains));
+    return rv;
+}
+
+/**
+ * @fn static int bench_partial_eof( bench_mem_arg_t *mem)
+ * @brief 헤더 일부만 보내고 client 끝을 닫았을 때 상태 기계가 연결 종료(ZERO_BYTE)를 돌려주는지 확인하는 함수
+ * @return 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_partial_eof( bench_mem_arg_t *mem){
+    io_t *client = &mem->pipe->ends[ 1].io;
+    int rv;
+
+    client->write( client, mem->frame, MSG_HEADER_LEN / 2);
+    mempipe_close( &mem->pipe->ends[ 1]);
+    while( ( rv = server_recv_data( mem->transc, mem->transc->fd)) == NOT_RECV);
+    printf("| %-28s | %10s |\n", "partial_io.eof_in_header", ( rv == ZERO_BYTE) ? "ok" : "FAIL");
+    return ( rv == ZERO_BYTE) ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief kmp 메시지 처리와 server 상태 기계의 microbenchmark
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv -o 결과 JSON 파일 경로
+ */
+int main( int argc, char **argv){
+    static transc_t transc[ 1];
+    static transc_buf_t transc_buf[ 1];
+    static bench_io_arg_t io[ 1];
+    static bench_mem_arg_t mem[ 1];
+    static bench_body_arg_t bin[ 1];
+    static bench_flight_arg_t fa[ 1];
+    const int one[] = { 1};
+    const int split[] = { 5, 15, 3, MEMPIPE_EAGAIN, 1000};
+    const int eagain[] = { MEMPIPE_EAGAIN, 7};
+    int rv = NORMAL;
+    const char *json_path = NULL;
+    char name[ 64];
+    char body[ DATA_MAX_LEN];
+    kmp_t msg[ 1];
+    int body_lens[] = { 16, 1000};
+    int fds[ 2];
+    int i, opt;
+
+    while( ( opt = getopt( argc, argv, "o:")) != -1){
+        if( opt == 'o'){
+            json_path = optarg;
+        }
+        else{
+            printf("	| ! need param : [-o result.json]\n");
+            return UNKNOWN;
+        }
+    }
+    if( bench_json_open( json_path) < NORMAL){
+        return UNKNOWN;
+    }
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    printf("| %-28s | %10s |\n", "micro", "ns/op");
+    for( i = 0; i < 2; i++){
+        memset( body, 'a', body_lens[ i]);
+        body[ body_lens[ i]] = '\0';
+        snprintf( name, sizeof( name), "micro.kmp_set_msg.%d", body_lens[ i]);
+        bench_micro_run( name, bench_kmp_set_msg, body, BENCH_ITERS);
+    }
+
+    // 바이너리 API 는 같은 바디를 길이로 받는다 (kmp_set_msg 와 비교)
+    for( i = 0; i < 2; i++){
+        memset( bin->body, 'a', body_lens[ i]);
+        bin->len = body_lens[ i];
+        snprintf( name, sizeof( name), "micro.kmp_set_body.%d", body_lens[ i]);
+        bench_micro_run( name, bench_kmp_set_body, bin, BENCH_ITERS);
+        snprintf( name, sizeof( name), "micro.kmp_iov_init.%d", body_lens[ i]);
+        bench_micro_run( name, bench_kmp_iov_init, bin, BENCH_ITERS);
+    }
+
+    // 만들고 보내는 것까지 : 복사 + write 와 writev
+    if( socketpair( AF_UNIX, SOCK_STREAM, 0, fds) < 0){
+        printf("	| ! Bench : Failed to create socketpair\n");
+        bench_json_close();
+        return UNKNOWN;
+    }
+    bin->fd = fds[ 0];
+    bin->peer_fd = fds[ 1];
+    for( i = 0; i < 2; i++){
+        memset( bin->body, 'a', body_lens[ i]);
+        bin->body[ body_lens[ i]] = '\0';
+        bin->len = body_lens[ i];
+        snprintf( name, sizeof( name), "micro.send_copy.%d", body_lens[ i]);
+        bench_micro_run( name, bench_send_copy, bin, BENCH_IO_ITERS);
+        snprintf( name, sizeof( name), "micro.send_iov.%d", body_lens[ i]);
+        bench_micro_run( name, bench_send_iov, bin, BENCH_IO_ITERS);
+    }
+    if( bench_iov_check( bin) < NORMAL){
+        rv = UNKNOWN;
+    }
+    close( fds[ 0]);
+    close( fds[ 1]);
+
+    kmp_set_msg( msg, 1, body, 1);
+    bench_micro_run( "micro.kmp_decode", bench_kmp_decode, msg, BENCH_ITERS * 10);
+
+    transc->buf = transc_buf;
+    server_transc_clear( transc);
+    memcpy( transc->buf->read_hdr_buf, msg, MSG_HEADER_LEN);
+    bench_micro_run( "micro.server_decode", bench_server_decode, transc, BENCH_ITERS * 10);
+    bench_micro_run( "micro.server_transc_clear", bench_transc_clear, transc, BENCH_ITERS);
+
+    if( ( fa->flight = flight_init( FLIGHT_EVENT_DEFAULT)) != NULL){
+        fa->transc = transc;
+        bench_micro_run( "micro.flight_record", bench_flight_record, fa, BENCH_ITERS * 10);
+        flight_destroy( fa->flight);
+    }
+
+    if( socketpair( AF_UNIX, SOCK_STREAM, 0, fds) < 0){
+        printf("	| ! Bench : Failed to create socketpair\n");
+        bench_json_close();
+        return UNKNOWN;
+    }
+    server_set_fd_nonblock( fds[ 0]);
+    server_transc_clear( transc);
+    transc->fd = fds[ 0];
+    io->transc = transc;
+    io->peer_fd = fds[ 1];
+    for( i = 0; i < 2; i++){
+        io->len = bench_make_frame( io->frame, body_lens[ i], 1);
+        snprintf( name, sizeof( name), "micro.state_machine.%d", body_lens[ i]);
+        bench_micro_run( name, bench_state_machine, io, BENCH_IO_ITERS);
+    }
+    close( fds[ 0]);
+    close( fds[ 1]);
+
+    // 같은 상태 기계를 메모리 pipe 위에서 system call 없이 돌린다
+    if( ( mem->pipe = mempipe_init()) == NULL){
+        bench_json_close();
+        return UNKNOWN;
+    }
+    server_transc_clear( transc);
+    transc->fd = 0;
+    transc->io = &mem->pipe->ends[ 0].io;
+    mem->transc = transc;
+    for( i = 0; i < 2; i++){
+        mem->len = bench_make_frame( mem->frame, body_lens[ i], 1);
+        snprintf( name, sizeof( name), "micro.state_machine_mem.%d", body_lens[ i]);
+        bench_micro_run( name, bench_state_machine_mem, mem, BENCH_ITERS);
+    }
+
+    // 짧은 read / write 와 EAGAIN 이 어디서 끊겨도 메시지가 그대로 돌아오는지 확인한다
+    mem->len = bench_make_frame( mem->frame, body_lens[ 1], 1);
+    if( ( bench_partial_io( mem, "partial_io.read_1byte", one, 1, NULL, 0) < NORMAL)
+            || ( bench_partial_io( mem, "partial_io.write_1byte", NULL, 0, one, 1) < NORMAL)
+            || ( bench_partial_io( mem, "partial_io.header_split", split, 5, NULL, 0) < NORMAL)
+            || ( bench_partial_io( mem, "partial_io.eagain_read", eagain, 2, NULL, 0) < NORMAL)
+            || ( bench_partial_io( mem, "partial_io.eagain_both", eagain, 2, split, 5) < NORMAL)
+            || ( bench_partial_eof( mem) < NORMAL)){
+        rv = UNKNOWN;
+    }
+    mempipe_destroy( mem->pipe);
+
+    bench_json_close();
+    return rv;
+}
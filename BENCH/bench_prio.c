@@ -0,0 +1,139 @@
+#include "bench.h"
+
+#define BENCH_PRIO_PORT ( BENCH_SERVER_PORT + 55)
+#define BENCH_WORK_US "20"
+#define BENCH_BULK_CONN_NUM 16
+#define BENCH_BULK_WINDOW 16
+#define BENCH_BULK_BODY_LEN 1000
+#define BENCH_CTRL_BODY_LEN 16
+#define BENCH_CTRL_INTERVAL_US 2000
+#define BENCH_RUN_MS 3000
+#define BENCH_SAMPLE_MAX 4096
+
+/**
+ * @fn static void bench_prio_bulk( int port, int run_ms)
+ * @brief 연결마다 큰 메시지 여러 개를 pipeline 으로 보내는 bulk 부하 생성기 (자식 프로세스에서 실행)
+ * @return void
+ */
+static void bench_prio_bulk( int port, int run_ms){
+    int fds[ BENCH_BULK_CONN_NUM];
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    uint64_t end = bench_now_ns() + ( uint64_t)run_ms * 1000000;
+    uint64_t done = 0;
+    int i, j, len;
+
+    for( i = 0; i < BENCH_BULK_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, port)) < 0){
+            _exit( 1);
+        }
+    }
+    len = bench_make_frame( frame, BENCH_BULK_BODY_LEN, 1);
+
+    while( bench_now_ns() < end){
+        for( i = 0; i < BENCH_BULK_CONN_NUM; i++){
+            for( j = 0; j < BENCH_BULK_WINDOW; j++){
+                bench_write_full( fds[ i], frame, len);
+            }
+        }
+        for( i = 0; i < BENCH_BULK_CONN_NUM; i++){
+            for( j = 0; j < BENCH_BULK_WINDOW; j++){
+                if( bench_read_full( fds[ i], reply, len) < NORMAL){
+                    _exit( 1);
+                }
+                done++;
+            }
+        }
+    }
+    printf("	| @ Bench : bulk %.0f req/s\n", done * 1000.0 / run_ms);
+    _exit( 0);
+}
+
+/**
+ * @fn static int bench_prio_scenario( const char *bin, const char *name, const char **opts, uint8_t flag)
+ * @brief bulk 부하를 건 server 에 제어 메시지를 주기적으로 보내서 응답 지연을 재는 함수
+ * @return 정상이면 NORMAL, 실패하면 열거형 참고
+ * @param flag 제어 메시지 헤더의 flag (KMP_FLAG_PRIORITY 또는 0)
+ */
+static int bench_prio_scenario( const char *bin, const char *name, const char **opts, uint8_t flag){
+    static uint64_t samples[ BENCH_SAMPLE_MAX];
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    char stats[ 1024];
+    bench_server_t server;
+    uint64_t start, end, t;
+    int fd, len, rv, count = 0;
+    pid_t bulk_pid;
+
+    if( bench_server_start( &server, bin, BENCH_PRIO_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return OBJECT_ERR;
+    }
+    if( ( bulk_pid = fork()) == 0){
+        bench_prio_bulk( BENCH_PRIO_PORT, BENCH_RUN_MS);
+    }
+    // bulk 가 연결을 맺고 queue 가 쌓일 시간을 준다
+    usleep( 200000);
+
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PRIO_PORT)) < 0){
+        rv = SOC_ERR;
+        goto out;
+    }
+    len = bench_make_frame( frame, BENCH_CTRL_BODY_LEN, 2);
+    ( ( kmp_hdr_t*)frame)->flag = flag;
+    end = bench_now_ns() + ( uint64_t)( BENCH_RUN_MS - 500) * 1000000;
+    while( ( count < BENCH_SAMPLE_MAX) && ( bench_now_ns() < end)){
+        start = bench_now_ns();
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, len) < NORMAL)){
+            close( fd);
+            rv = SOC_ERR;
+            goto out;
+        }
+        t = bench_now_ns() - start;
+        samples[ count++] = t;
+        if( t < BENCH_CTRL_INTERVAL_US * 1000){
+            usleep( BENCH_CTRL_INTERVAL_US - t / 1000);
+        }
+    }
+    close( fd);
+
+    printf("| %-24s | %6d | %9.1f | %9.1f | %9.1f |\n", name, count,
+            bench_percentile( samples, count, 50) / 1000.0, bench_percentile( samples, count, 99) / 1000.0,
+            bench_percentile( samples, count, 100) / 1000.0);
+    if( bench_get_stats( BENCH_PRIO_PORT, stats, sizeof( stats)) == NORMAL){
+        printf("	| @ Bench : prio_high=%.0f budget_exhausted=%.0f\n",
+                bench_stats_value( stats, "prio_high"), bench_stats_value( stats, "budget_exhausted"));
+    }
+    rv = NORMAL;
+
+out:
+    waitpid( bulk_pid, NULL, 0);
+    bench_server_stop( &server);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief 우선순위 run queue / 연결별 budget 부하 시험
+ * 요청마다 BENCH_WORK_US 의 처리 비용이 드는 server 에 bulk 연결들이 메시지를 pipeline 으로 쌓을 때
+ * 제어 메시지의 응답 지연을 우선순위 flag 와 budget 에 따라 비교한다
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *budget8_opts[] = { "-W", BENCH_WORK_US, NULL};
+    const char *budget1_opts[] = { "-W", BENCH_WORK_US, "-B", "1", NULL};
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    printf("| %-24s | %6s | %9s | %9s | %9s |\n", "control msg (us)", "count", "p50", "p99", "max");
+    if( ( bench_prio_scenario( bin, "normal, budget 8", budget8_opts, 0) < NORMAL)
+            || ( bench_prio_scenario( bin, "priority, budget 8", budget8_opts, KMP_FLAG_PRIORITY) < NORMAL)
+            || ( bench_prio_scenario( bin, "normal, budget 1", budget1_opts, 0) < NORMAL)
+            || ( bench_prio_scenario( bin, "priority, budget 1", budget1_opts, KMP_FLAG_PRIORITY) < NORMAL)){
+        printf("	| ! Bench : priority run failed\n");
+        return UNKNOWN;
+    }
+    return NORMAL;
+}
@@ -0,0 +1,106 @@
+#include "bench.h"
+
+#define BENCH_PROXY_PORT ( BENCH_SERVER_PORT + 1)
+#define BENCH_TOTAL_MB 256
+#define BENCH_BODY_LEN 1000
+#define BENCH_WINDOW 64
+
+/// @struct bench_result_t
+/// @brief 한 경로(direct / proxy)에 대한 측정 결과
+typedef struct bench_result_s bench_result_t;
+struct bench_result_s{
+    /// 전송에 걸린 시간 (ns)
+    uint64_t elapsed_ns;
+    /// 그 동안 proxy 프로세스가 사용한 CPU 시간 (ns)
+    uint64_t proxy_cpu_ns;
+    /// 보낸 요청 바이트 수 (헤더 포함)
+    uint64_t bytes;
+};
+
+/**
+ * @fn static int bench_stream_run( int fd, pid_t proxy_pid, bench_result_t *result)
+ * @brief BENCH_TOTAL_MB 만큼의 요청을 pipelining 으로 보내고 echo 응답을 모두 받는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param fd server 또는 proxy에 연결된 blocking 소켓
+ * @param proxy_pid CPU 시간을 측정할 proxy 프로세스 (없으면 0)
+ * @param result 측정 결과
+ */
+static int bench_stream_run( int fd, pid_t proxy_pid, bench_result_t *result){
+    static char batch[ sizeof( kmp_t) * BENCH_WINDOW];
+    char frame[ sizeof( kmp_t)];
+    int len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    uint64_t total = ( uint64_t)BENCH_TOTAL_MB * 1024 * 1024;
+    uint64_t start, cpu_start;
+    int j;
+
+    for( j = 0; j < BENCH_WINDOW; j++){
+        memcpy( &batch[ j * len], frame, len);
+    }
+
+    result->bytes = 0;
+    cpu_start = ( proxy_pid > 0) ? bench_proc_cpu_ns( proxy_pid) : 0;
+    start = bench_now_ns();
+    while( result->bytes < total){
+        if( ( bench_write_full( fd, batch, len * BENCH_WINDOW) < NORMAL) || ( bench_read_full( fd, batch, len * BENCH_WINDOW) < NORMAL)){
+            return SOC_ERR;
+        }
+        result->bytes += len * BENCH_WINDOW;
+    }
+    result->elapsed_ns = bench_now_ns() - start;
+    result->proxy_cpu_ns = ( proxy_pid > 0) ? bench_proc_cpu_ns( proxy_pid) - cpu_start : 0;
+    return NORMAL;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief echo server에 직접 보낸 경우와 splice proxy를 거친 경우를 비교해서 GB 당 proxy 비용을 구하는 벤치마크
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *proxy_opts[] = { "-P", BENCH_SERVER_IP ":18000", NULL};
+    bench_server_t upstream, proxy;
+    bench_result_t direct, relayed;
+    double gb, extra_s_per_gb, cpu_s_per_gb;
+    int fd;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    if( bench_server_start( &upstream, bin, BENCH_SERVER_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start upstream server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    if( bench_server_start( &proxy, bin, BENCH_PROXY_PORT, NULL, proxy_opts) < NORMAL){
+        printf("	| ! Bench : Failed to start proxy server (%s)\n", bin);
+        bench_server_stop( &upstream);
+        return UNKNOWN;
+    }
+
+    if( ( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_SERVER_PORT)) < 0) || ( bench_stream_run( fd, 0, &direct) < NORMAL)){
+        printf("	| ! Bench : direct run failed\n");
+        goto out;
+    }
+    close( fd);
+
+    if( ( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PROXY_PORT)) < 0) || ( bench_stream_run( fd, proxy.pid, &relayed) < NORMAL)){
+        printf("	| ! Bench : proxy run failed\n");
+        goto out;
+    }
+    close( fd);
+
+    gb = ( double)direct.bytes / ( 1024.0 * 1024.0 * 1024.0);
+    extra_s_per_gb = ( ( double)relayed.elapsed_ns - ( double)direct.elapsed_ns) / 1e9 / gb;
+    cpu_s_per_gb = ( double)relayed.proxy_cpu_ns / 1e9 / gb;
+
+    printf("| %-8s | %10s | %10s | %14s |\n", "path", "MB/s", "s/GB", "proxy cpu s/GB");
+    printf("| %-8s | %10.2f | %10.3f | %14s |\n", "direct", direct.bytes / ( direct.elapsed_ns / 1e9) / ( 1024.0 * 1024.0), direct.elapsed_ns / 1e9 / gb, "-");
+    printf("| %-8s | %10.2f | %10.3f | %14.3f |\n", "proxy", relayed.bytes / ( relayed.elapsed_ns / 1e9) / ( 1024.0 * 1024.0), relayed.elapsed_ns / 1e9 / gb, cpu_s_per_gb);
+    printf("| proxy overhead : %.3f s/GB wall, %.3f s/GB proxy cpu (body %d bytes, request direction)\n", extra_s_per_gb, cpu_s_per_gb, BENCH_BODY_LEN);
+
+out:
+    bench_server_stop( &proxy);
+    bench_server_stop( &upstream);
+    return NORMAL;
+}
@@ -0,0 +1,339 @@
+#include "bench.h"
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#define BENCH_PUBSUB_PORT ( BENCH_SERVER_PORT + 105)
+/// 구독하는 topic (app_id)
+#define BENCH_PUBSUB_TOPIC 7
+/// 발행 메시지 바디 길이 (앞 8 바이트는 보낸 시각 ns)
+#define BENCH_PUBSUB_BODY_LEN 64
+/// 구독자 수와 곱해서 이만큼 전달되도록 발행 수를 정한다
+#define BENCH_PUBSUB_DELIVERIES 2000000
+/// 발행하는 쪽이 응답을 기다리지 않고 보내는 발행 수
+#define BENCH_PUBSUB_WINDOW 32
+/// 더 받을 것이 없다고 보는 시간 (ms)
+#define BENCH_PUBSUB_IDLE_MS 2000
+#define BENCH_PUBSUB_SAMPLE_MAX 100000
+/// 느린 구독자 시험의 queue 길이 / 발행 수 / 바디 길이 (소켓 버퍼를 넘게 보낸다)
+#define BENCH_PUBSUB_SLOW_QUEUE 64
+#define BENCH_PUBSUB_SLOW_MSGS 20000
+#define BENCH_PUBSUB_SLOW_BODY_LEN 1000
+
+/// @struct bench_pubsub_rx_t
+/// @brief 구독자 소켓을 모두 읽는 thread 의 상태
+/// 첫 구독자와 마지막 구독자는 메시지마다 전달 지연을 재고, 나머지는 받은 바이트만 센다
+typedef struct bench_pubsub_rx_s bench_pubsub_rx_t;
+struct bench_pubsub_rx_s{
+    int *fds;
+    int num;
+    /// 메시지 길이 / 구독자마다 받을 메시지 수
+    int frame_len;
+    int expect;
+    /// 구독자마다 받은 바이트 수
+    uint64_t *bytes;
+    /// 첫 / 마지막 구독자의 전달 지연 (ns)
+    uint64_t *first_lat;
+    uint64_t *last_lat;
+    int first_num;
+    int last_num;
+    /// 모든 메시지를 받은 시각
+    uint64_t done_ns;
+};
+
+/**
+ * @fn static void bench_pubsub_sample( bench_pubsub_rx_t *rx, int idx, const char *buf, int len, uint64_t now)
+ * @brief 첫 / 마지막 구독자가 받은 바이트에서 메시지 시작을 찾아 보낸 시각으로 지연을 기록하는 함수
+ * @return void
+ */
+static void bench_pubsub_sample( bench_pubsub_rx_t *rx, int idx, const char *buf, int len, uint64_t now){
+    uint64_t *lat = ( idx == 0) ? rx->first_lat : rx->last_lat;
+    int *num = ( idx == 0) ? &rx->first_num : &rx->last_num;
+    uint64_t sent;
+    int off;
+
+    // 받은 바이트 수가 메시지 길이의 배수인 곳에서 메시지가 시작한다
+    off = ( rx->frame_len - ( int)( ( rx->bytes[ idx] - len) % rx->frame_len)) % rx->frame_len;
+    for( ; off + ( int)sizeof( kmp_hdr_t) + 8 <= len; off += rx->frame_len){
+        memcpy( &sent, &buf[ off + sizeof( kmp_hdr_t)], 8);
+        if( *num < BENCH_PUBSUB_SAMPLE_MAX){
+            lat[ ( *num)++] = now - sent;
+        }
+    }
+}
+
+/**
+ * @fn static void* bench_pubsub_rx_main( void *arg)
+ * @brief 모든 구독자가 expect 개의 메시지를 받거나 BENCH_PUBSUB_IDLE_MS 동안 아무것도 오지 않을 때까지 읽는 thread
+ * @return NULL
+ */
+static void* bench_pubsub_rx_main( void *arg){
+    bench_pubsub_rx_t *rx = ( bench_pubsub_rx_t*)arg;
+    struct epoll_event ev, events[ 256];
+    char buf[ 65536];
+    uint64_t want = ( uint64_t)rx->expect * rx->frame_len;
+    uint64_t now;
+    int efd, n, len, done = 0, i, idx;
+
+    if( ( efd = epoll_create1( 0)) < 0){
+        return NULL;
+    }
+    for( i = 0; i < rx->num; i++){
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl( efd, EPOLL_CTL_ADD, rx->fds[ i], &ev);
+    }
+    while( done < rx->num){
+        if( ( n = epoll_wait( efd, events, 256, BENCH_PUBSUB_IDLE_MS)) <= 0){
+            break;
+        }
+        now = bench_now_ns();
+        for( i = 0; i < n; i++){
+            idx = events[ i].data.u32;
+            if( ( len = read( rx->fds[ idx], buf, sizeof( buf))) <= 0){
+                epoll_ctl( efd, EPOLL_CTL_DEL, rx->fds[ idx], NULL);
+                done++;
+                continue;
+            }
+            rx->bytes[ idx] += len;
+            if( ( rx->first_lat != NULL) && ( ( idx == 0) || ( idx == rx->num - 1))){
+                bench_pubsub_sample( rx, idx, buf, len, now);
+            }
+            if( rx->bytes[ idx] == want){
+                epoll_ctl( efd, EPOLL_CTL_DEL, rx->fds[ idx], NULL);
+                done++;
+            }
+        }
+    }
+    rx->done_ns = bench_now_ns();
+    close( efd);
+    return NULL;
+}
+
+/**
+ * @fn static int bench_pubsub_subscribe( int fd, uint32_t topic)
+ * @brief 바디가 NUL 하나인 구독 요청(app_id 만 topic)을 보내고 확인 응답을 받는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_pubsub_subscribe( int fd, uint32_t topic){
+    kmp_t msg;
+    char frame[ sizeof( kmp_hdr_t) + 1];
+    int len = kmp_set_body( &msg, 1, KMP_CODE_SUBSCRIBE, "", 1);
+
+    msg.hdr.app_id = topic;
+    memcpy( frame, &msg, len);
+    if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, frame, len) < NORMAL)){
+        return SOC_ERR;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_pubsub_publish( int fd, int msgs, int body_len, uint64_t *deliveries)
+ * @brief 발행 요청을 BENCH_PUBSUB_WINDOW 개씩 보내고 그만큼 응답을 받는 함수 (바디 앞에 보낸 시각을 넣는다)
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param deliveries 응답에 담긴 받은 구독자 수의 합
+ */
+static int bench_pubsub_publish( int fd, int msgs, int body_len, uint64_t *deliveries){
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_hdr_t) + sizeof( uint32_t)];
+    uint64_t now;
+    uint32_t num;
+    int len, i, j, window;
+
+    len = bench_make_frame( frame, body_len, KMP_CODE_PUBLISH);
+    ( ( kmp_hdr_t*)frame)->app_id = BENCH_PUBSUB_TOPIC;
+    *deliveries = 0;
+    for( i = 0; i < msgs; i += window){
+        window = ( msgs - i < BENCH_PUBSUB_WINDOW) ? msgs - i : BENCH_PUBSUB_WINDOW;
+        for( j = 0; j < window; j++){
+            now = bench_now_ns();
+            memcpy( &frame[ sizeof( kmp_hdr_t)], &now, 8);
+            if( bench_write_full( fd, frame, len) < NORMAL){
+                return SOC_ERR;
+            }
+        }
+        for( j = 0; j < window; j++){
+            if( bench_read_full( fd, reply, sizeof( reply)) < NORMAL){
+                return SOC_ERR;
+            }
+            memcpy( &num, &reply[ sizeof( kmp_hdr_t)], sizeof( num));
+            *deliveries += num;
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_pubsub_fanout( const char *bin, int sub_num)
+ * @brief 구독자 sub_num 개에게 발행 메시지를 보내서 전달 처리량과 첫 / 마지막 구독자의 전달 지연을 재는 함수
+ * @return 정상이면 NORMAL, 빠진 메시지가 있거나 실패하면 UNKNOWN
+ */
+static int bench_pubsub_fanout( const char *bin, int sub_num){
+    const char *opts[] = { "-Q", "4096", NULL};
+    bench_pubsub_rx_t rx;
+    bench_server_t server;
+    pthread_t thread;
+    char stats[ 2048];
+    char key[ 64];
+    uint64_t start, deliveries, received = 0;
+    int msgs = BENCH_PUBSUB_DELIVERIES / sub_num;
+    int pub_fd, ok, i;
+
+    if( bench_server_start( &server, bin, BENCH_PUBSUB_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    memset( &rx, 0, sizeof( rx));
+    rx.fds = ( int*)malloc( sizeof( int) * sub_num);
+    rx.bytes = ( uint64_t*)calloc( sub_num, sizeof( uint64_t));
+    rx.first_lat = ( uint64_t*)malloc( sizeof( uint64_t) * BENCH_PUBSUB_SAMPLE_MAX);
+    rx.last_lat = ( uint64_t*)malloc( sizeof( uint64_t) * BENCH_PUBSUB_SAMPLE_MAX);
+    rx.frame_len = sizeof( kmp_hdr_t) + BENCH_PUBSUB_BODY_LEN;
+    rx.expect = msgs;
+
+    ok = ( rx.fds != NULL) && ( rx.bytes != NULL) && ( rx.first_lat != NULL) && ( rx.last_lat != NULL);
+    for( i = 0; ok && ( i < sub_num); i++){
+        if( ( ( rx.fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PUBSUB_PORT)) < 0)
+                || ( bench_pubsub_subscribe( rx.fds[ i], BENCH_PUBSUB_TOPIC) < NORMAL)){
+            printf("	| ! Bench : Failed to subscribe %d/%d\n", i, sub_num);
+            ok = 0;
+        }
+        else{
+            rx.num++;
+        }
+    }
+    ok = ok && ( ( pub_fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PUBSUB_PORT)) >= 0);
+
+    if( ok && ( pthread_create( &thread, NULL, bench_pubsub_rx_main, &rx) == 0)){
+        start = bench_now_ns();
+        ok = ( bench_pubsub_publish( pub_fd, msgs, BENCH_PUBSUB_BODY_LEN, &deliveries) == NORMAL);
+        pthread_join( thread, NULL);
+        close( pub_fd);
+        for( i = 0; i < rx.num; i++){
+            received += rx.bytes[ i] / rx.frame_len;
+        }
+        ok = ok && ( bench_get_stats( BENCH_PUBSUB_PORT, stats, sizeof( stats)) == NORMAL);
+        if( ok){
+            printf("| %6d | %6d | %11.0f | %8.1f | %8.1f | %8.1f | %8.1f | %7.1f | %6.0f |\n", sub_num, msgs,
+                    received / ( ( rx.done_ns - start) / 1e9),
+                    bench_percentile( rx.first_lat, rx.first_num, 50) / 1000.0, bench_percentile( rx.first_lat, rx.first_num, 99) / 1000.0,
+                    bench_percentile( rx.last_lat, rx.last_num, 50) / 1000.0, bench_percentile( rx.last_lat, rx.last_num, 99) / 1000.0,
+                    bench_stats_value( stats, "pubsub_sent") / bench_stats_value( stats, "pubsub_writes"),
+                    bench_stats_value( stats, "pubsub_drops"));
+            snprintf( key, sizeof( key), "pubsub.fanout_%d", sub_num);
+            bench_json_add( key, received / ( ( rx.done_ns - start) / 1e9), "msg/s", 0);
+            if( ( deliveries != ( uint64_t)sub_num * msgs) || ( received != deliveries)){
+                printf("	| ! Bench : %d subscribers, queued %llu, received %llu of %llu\n", sub_num,
+                        ( unsigned long long)deliveries, ( unsigned long long)received, ( unsigned long long)sub_num * msgs);
+                ok = 0;
+            }
+        }
+    }
+    else{
+        ok = 0;
+    }
+
+    for( i = 0; i < rx.num; i++){
+        close( rx.fds[ i]);
+    }
+    free( rx.fds);
+    free( rx.bytes);
+    free( rx.first_lat);
+    free( rx.last_lat);
+    bench_server_stop( &server);
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static int bench_pubsub_slow( const char *bin, int is_close)
+ * @brief 읽지 않는 구독자가 있을 때 다른 구독자는 모든 메시지를 받고, 느린 구독자는 policy 대로 버려지거나 닫히는지 확인하는 함수
+ * @return 맞으면 NORMAL, 아니면 UNKNOWN
+ * @param is_close 1 이면 -Q c:len (연결을 닫는다), 0 이면 -Q len (메시지를 버린다)
+ */
+static int bench_pubsub_slow( const char *bin, int is_close){
+    char queue[ 16];
+    const char *opts[] = { "-Q", queue, NULL};
+    bench_pubsub_rx_t rx;
+    bench_server_t server;
+    pthread_t thread;
+    char stats[ 2048];
+    uint64_t deliveries = 0;
+    int fast_fd, slow_fd, pub_fd, rcvbuf = 4096;
+    int ok;
+
+    snprintf( queue, sizeof( queue), "%s%d", is_close ? "c:" : "", BENCH_PUBSUB_SLOW_QUEUE);
+    if( bench_server_start( &server, bin, BENCH_PUBSUB_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    memset( &rx, 0, sizeof( rx));
+    fast_fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PUBSUB_PORT);
+    slow_fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PUBSUB_PORT);
+    pub_fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_PUBSUB_PORT);
+    ok = ( fast_fd >= 0) && ( slow_fd >= 0) && ( pub_fd >= 0)
+        && ( bench_pubsub_subscribe( fast_fd, BENCH_PUBSUB_TOPIC) == NORMAL) && ( bench_pubsub_subscribe( slow_fd, BENCH_PUBSUB_TOPIC) == NORMAL);
+    if( ok){
+        // 느린 구독자는 받는 창을 작게 두고 읽지 않는다
+        setsockopt( slow_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof( rcvbuf));
+        rx.fds = &fast_fd;
+        rx.num = 1;
+        rx.bytes = &deliveries;
+        rx.frame_len = sizeof( kmp_hdr_t) + BENCH_PUBSUB_SLOW_BODY_LEN;
+        rx.expect = BENCH_PUBSUB_SLOW_MSGS;
+        ok = ( pthread_create( &thread, NULL, bench_pubsub_rx_main, &rx) == 0);
+    }
+    if( ok){
+        uint64_t queued;
+
+        ok = ( bench_pubsub_publish( pub_fd, BENCH_PUBSUB_SLOW_MSGS, BENCH_PUBSUB_SLOW_BODY_LEN, &queued) == NORMAL);
+        pthread_join( thread, NULL);
+        ok = ok && ( bench_get_stats( BENCH_PUBSUB_PORT, stats, sizeof( stats)) == NORMAL);
+        ok = ok && ( deliveries == ( uint64_t)BENCH_PUBSUB_SLOW_MSGS * rx.frame_len);
+        if( is_close){
+            ok = ok && ( bench_stats_value( stats, "pubsub_slow_closes") == 1) && ( bench_stats_value( stats, "pubsub_drops") == 0);
+        }
+        else{
+            ok = ok && ( bench_stats_value( stats, "pubsub_slow_closes") == 0) && ( bench_stats_value( stats, "pubsub_drops") > 0)
+                && ( bench_stats_value( stats, "pubsub_subs") == 2);
+        }
+        printf("| %-28s | %6s | (fast got %llu/%d, drops=%.0f slow_closes=%.0f subs=%.0f)\n",
+                is_close ? "pubsub.slow_closed" : "pubsub.slow_dropped", ok ? "ok" : "FAIL",
+                ( unsigned long long)deliveries / rx.frame_len, BENCH_PUBSUB_SLOW_MSGS, bench_stats_value( stats, "pubsub_drops"),
+                bench_stats_value( stats, "pubsub_slow_closes"), bench_stats_value( stats, "pubsub_subs"));
+    }
+    close( fast_fd);
+    close( slow_fd);
+    close( pub_fd);
+    bench_server_stop( &server);
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief 발행 메시지 하나를 구독자 여러 개에게 나눠 보내는 처리량과 지연, 느린 구독자 처리를 재는 벤치마크
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로 (기본 ../SERVER/server)
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    int subs[] = { 10, 100, 1000, 10000};
+    int rv = NORMAL;
+    int i;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    printf("	| @ Bench : %d byte publishes to one topic, %d in flight, latency is publish -> read on the first / last subscriber\n",
+            BENCH_PUBSUB_BODY_LEN, BENCH_PUBSUB_WINDOW);
+    printf("| %6s | %6s | %11s | %8s | %8s | %8s | %8s | %7s | %6s |\n", "subs", "msgs", "deliver/s",
+            "1st p50", "1st p99", "last p50", "last p99", "msg/wv", "drops");
+    for( i = 0; i < 4; i++){
+        if( bench_pubsub_fanout( bin, subs[ i]) < NORMAL){
+            rv = UNKNOWN;
+        }
+    }
+    if( ( bench_pubsub_slow( bin, 0) < NORMAL) || ( bench_pubsub_slow( bin, 1) < NORMAL)){
+        rv = UNKNOWN;
+    }
+    return rv;
+}
@@ -0,0 +1,194 @@
+#include "bench.h"
+
+#define BENCH_RESTART_PORT ( BENCH_SERVER_PORT + 65)
+#define BENCH_HANDOFF_PATH "/tmp/kmp_bench_handoff.sock"
+#define BENCH_CONN_NUM 32
+#define BENCH_BODY_LEN 256
+#define BENCH_RUN_MS 4000
+#define BENCH_RESTART_NUM 2
+/// 교체를 시작하는 시각 (ms)
+#define BENCH_RESTART_AT_MS( n) ( 1000 + ( n) * 1500)
+/// 이전 server 가 끝난 뒤에도 교체 구간으로 보는 시간 (ms)
+#define BENCH_SETTLE_MS 100
+#define BENCH_EXIT_WAIT_MS 5000
+#define BENCH_SAMPLE_MAX ( 1 << 20)
+
+/**
+ * @fn static int bench_restart_spawn( bench_server_t *server, const char *bin)
+ * @brief -U 로 새 server 를 띄우고 기다리지 않고 돌아오는 함수
+ * bench_server_start 는 port 가 열릴 때까지 기다리는데, 교체 중에는 port 가 이미 열려 있고 부하를 멈추면 안 된다
+ * @return 정상이면 NORMAL, 실패하면 OBJECT_ERR
+ */
+static int bench_restart_spawn( bench_server_t *server, const char *bin){
+    char port_str[ 16];
+
+    snprintf( port_str, sizeof( port_str), "%d", BENCH_RESTART_PORT);
+    server->port = BENCH_RESTART_PORT;
+    server->unix_path[ 0] = '\0';
+    if( ( server->pid = fork()) < 0){
+        return OBJECT_ERR;
+    }
+    else if( server->pid == 0){
+        int null_fd = open( "/dev/null", O_WRONLY);
+        if( getenv( "BENCH_SERVER_LOG") == NULL){
+            dup2( null_fd, STDOUT_FILENO);
+        }
+        execl( bin, bin, "-U", BENCH_HANDOFF_PATH, BENCH_SERVER_IP, port_str, ( char*)NULL);
+        _exit( 127);
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_restart_echo( const char *frame, char *reply, int len)
+ * @brief 새 연결 하나로 요청 하나를 보내고 응답을 받는 함수 (교체 중에 연결 요청이 거절되지 않는지 본다)
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_restart_echo( const char *frame, char *reply, int len){
+    int fd, rv = NORMAL;
+
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_RESTART_PORT)) < 0){
+        return SOC_ERR;
+    }
+    if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, len) < NORMAL)){
+        rv = SOC_ERR;
+    }
+    close( fd);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief 무중단 재시작 부하 시험
+ * BENCH_CONN_NUM 개의 연결로 echo 를 계속 보내면서 (매 round 새 연결도 하나 맺는다) -U 로 새 server 를 띄워
+ * 이전 server 가 listener 와 idle 연결을 넘기고 스스로 끝나는지, 그 동안 연결 오류나 지연이 튀는지 확인한다
+ * @return 연결 오류 없이 모든 교체가 끝났으면 NORMAL
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *opts[] = { "-U", BENCH_HANDOFF_PATH, NULL};
+    static uint64_t steady[ BENCH_SAMPLE_MAX], restart[ BENCH_SAMPLE_MAX];
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    bench_server_t servers[ BENCH_RESTART_NUM + 1];
+    uint64_t start, now, round_start, exit_ms[ BENCH_RESTART_NUM];
+    uint64_t spawn_ns = 0, settle_ns = 0;
+    double handoff_conns[ BENCH_RESTART_NUM] = { 0};
+    int fds[ BENCH_CONN_NUM];
+    int steady_num = 0, restart_num = 0, errors = 0, new_conns = 0, new_conn_errors = 0;
+    int cur = 0, status, i, len, rv = NORMAL;
+    char stats[ 1024];
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    memset( servers, 0, sizeof( servers));
+
+    if( bench_server_start( &servers[ 0], bin, BENCH_RESTART_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    // server 가 handoff 경로를 열 때까지 기다린다
+    for( i = 0; ( i < 200) && ( access( BENCH_HANDOFF_PATH, F_OK) != 0); i++){
+        usleep( 10000);
+    }
+    for( i = 0; i < BENCH_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_RESTART_PORT)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            bench_server_stop( &servers[ 0]);
+            return UNKNOWN;
+        }
+    }
+
+    len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    start = bench_now_ns();
+    while( ( ( now = bench_now_ns()) - start < ( uint64_t)BENCH_RUN_MS * 1000000) && ( errors == 0)){
+        // 다음 server 를 띄운다
+        if( ( cur < BENCH_RESTART_NUM) && ( spawn_ns == 0) && ( now - start >= ( uint64_t)BENCH_RESTART_AT_MS( cur) * 1000000)){
+            if( bench_restart_spawn( &servers[ cur + 1], bin) < NORMAL){
+                errors++;
+                break;
+            }
+            spawn_ns = now;
+        }
+        // 이전 server 가 스스로 끝났는지 확인한다
+        if( spawn_ns != 0){
+            if( waitpid( servers[ cur].pid, &status, WNOHANG) == servers[ cur].pid){
+                servers[ cur].pid = 0;
+                exit_ms[ cur] = ( now - spawn_ns) / 1000000;
+                if( ( WIFEXITED( status) == 0) || ( WEXITSTATUS( status) != 0)){
+                    printf("	| ! Bench : old server exited abnormally (status:%d)\n", status);
+                    errors++;
+                }
+                settle_ns = now + ( uint64_t)BENCH_SETTLE_MS * 1000000;
+                spawn_ns = 0;
+                cur++;
+            }
+            else if( now - spawn_ns > ( uint64_t)BENCH_EXIT_WAIT_MS * 1000000){
+                printf("	| ! Bench : old server did not exit\n");
+                errors++;
+                break;
+            }
+        }
+        if( ( settle_ns != 0) && ( now > settle_ns)){
+            settle_ns = 0;
+            if( bench_get_stats( BENCH_RESTART_PORT, stats, sizeof( stats)) == NORMAL){
+                handoff_conns[ cur - 1] = bench_stats_value( stats, "handoff_conns");
+            }
+        }
+
+        round_start = bench_now_ns();
+        for( i = 0; i < BENCH_CONN_NUM; i++){
+            if( bench_write_full( fds[ i], frame, len) < NORMAL){
+                errors++;
+            }
+        }
+        for( i = 0; ( i < BENCH_CONN_NUM) && ( errors == 0); i++){
+            if( bench_read_full( fds[ i], reply, len) < NORMAL){
+                errors++;
+                break;
+            }
+            now = bench_now_ns() - round_start;
+            if( ( spawn_ns != 0) || ( settle_ns != 0)){
+                if( restart_num < BENCH_SAMPLE_MAX){
+                    restart[ restart_num++] = now;
+                }
+            }
+            else if( steady_num < BENCH_SAMPLE_MAX){
+                steady[ steady_num++] = now;
+            }
+        }
+        new_conns++;
+        if( bench_restart_echo( frame, reply, len) < NORMAL){
+            new_conn_errors++;
+        }
+    }
+    for( i = 0; i < BENCH_CONN_NUM; i++){
+        close( fds[ i]);
+    }
+    for( i = 0; i <= BENCH_RESTART_NUM; i++){
+        bench_server_stop( &servers[ i]);
+    }
+    unlink( BENCH_HANDOFF_PATH);
+
+    printf("| %-24s | %8s | %9s | %9s | %9s |\n", "echo latency (us)", "count", "p50", "p99", "max");
+    printf("| %-24s | %8d | %9.1f | %9.1f | %9.1f |\n", "steady", steady_num,
+            bench_percentile( steady, steady_num, 50) / 1000.0, bench_percentile( steady, steady_num, 99) / 1000.0,
+            bench_percentile( steady, steady_num, 100) / 1000.0);
+    printf("| %-24s | %8d | %9.1f | %9.1f | %9.1f |\n", "during restart", restart_num,
+            bench_percentile( restart, restart_num, 50) / 1000.0, bench_percentile( restart, restart_num, 99) / 1000.0,
+            bench_percentile( restart, restart_num, 100) / 1000.0);
+    for( i = 0; i < cur; i++){
+        printf("	| @ Bench : restart %d : old server exited after %llu ms, %.0f connections handed over\n",
+                i + 1, ( unsigned long long)exit_ms[ i], handoff_conns[ i]);
+    }
+    printf("	| @ Bench : connection errors %d, new connections %d (failed %d)\n", errors, new_conns, new_conn_errors);
+
+    if( ( errors > 0) || ( new_conn_errors > 0) || ( cur < BENCH_RESTART_NUM)){
+        printf("	| ! Bench : hot restart failed\n");
+        rv = UNKNOWN;
+    }
+    return rv;
+}
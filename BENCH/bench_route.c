@@ -0,0 +1,221 @@
+#include "bench.h"
+#include "../SERVER/route.h"
+
+#define BENCH_ROUTER_PORT ( BENCH_SERVER_PORT + 10)
+#define BENCH_BACKEND_NUM 3
+#define BENCH_KEY_NUM 100000
+#define BENCH_REQ_NUM 60000
+#define BENCH_BODY_LEN 64
+#define BENCH_WINDOW 32
+
+/**
+ * @fn static void bench_route_reply( void *arg, void *owner, const char *frame, int len)
+ * @brief ring 분포만 확인하므로 응답 callback은 사용하지 않는다
+ */
+static void bench_route_reply( void *arg, void *owner, const char *frame, int len){
+    ( void)arg;
+    ( void)owner;
+    ( void)frame;
+    ( void)len;
+}
+
+/**
+ * @fn static void bench_route_map( route_t *route, int *map, int *load)
+ * @brief BENCH_KEY_NUM 개의 app_id가 어느 backend에 배정되는지 구하는 함수
+ * @return void
+ * @param route routing 객체
+ * @param map app_id 별 backend index
+ * @param load backend 별 배정된 app_id 수
+ */
+static void bench_route_map( route_t *route, int *map, int *load){
+    uint32_t app_id;
+
+    memset( load, 0, sizeof( int) * ROUTE_BACKEND_MAX);
+    for( app_id = 0; app_id < BENCH_KEY_NUM; app_id++){
+        map[ app_id] = route_lookup( route, app_id);
+        load[ map[ app_id]]++;
+    }
+}
+
+/**
+ * @fn static void bench_route_print( const char *name, int *before, int *after, int *load, int backend_num, double expected)
+ * @brief ring 변경 전후로 backend가 바뀐 app_id 비율과 backend 별 부하를 출력하는 함수
+ * @return void
+ */
+static void bench_route_print( const char *name, int *before, int *after, int *load, int backend_num, double expected){
+    int moved = 0;
+    int i, min = BENCH_KEY_NUM, max = 0;
+
+    for( i = 0; i < BENCH_KEY_NUM; i++){
+        moved += ( before[ i] != after[ i]);
+    }
+    for( i = 0; i < backend_num; i++){
+        if( load[ i] == 0){
+            continue;
+        }
+        min = ( load[ i] < min) ? load[ i] : min;
+        max = ( load[ i] > max) ? load[ i] : max;
+    }
+    printf("| %-16s | %8.2f%% | %8.2f%% | %6d | %6d |\n", name, moved * 100.0 / BENCH_KEY_NUM, expected * 100.0, min, max);
+}
+
+/**
+ * @fn static void bench_route_remap()
+ * @brief backend 추가 / 제거 시 다시 배정되는 app_id 비율을 구하는 함수 (이상적인 값은 1/N)
+ * @return void
+ */
+static void bench_route_remap(){
+    static int base[ BENCH_KEY_NUM], added[ BENCH_KEY_NUM], removed[ BENCH_KEY_NUM];
+    struct sockaddr_in addr;
+    int load[ ROUTE_BACKEND_MAX];
+    route_t *route = route_init( -1, bench_route_reply, NULL);
+    int i;
+
+    if( route == NULL){
+        return;
+    }
+
+    memset( &addr, 0, sizeof( addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr( "10.0.0.1");
+    for( i = 0; i < 4; i++){
+        addr.sin_port = htons( 9000 + i);
+        route_add_backend( route, &addr);
+    }
+    bench_route_map( route, base, load);
+    printf("| %-16s | %9s | %9s | %6s | %6s |\n", "ring change", "remapped", "ideal", "min", "max");
+    bench_route_print( "4 backends", base, base, load, 4, 0.0);
+
+    addr.sin_port = htons( 9004);
+    route_add_backend( route, &addr);
+    bench_route_map( route, added, load);
+    bench_route_print( "add 1 (4->5)", base, added, load, 5, 1.0 / 5);
+
+    route_remove_backend( route, 4);
+    route_remove_backend( route, 0);
+    bench_route_map( route, removed, load);
+    bench_route_print( "remove 1 (4->3)", base, removed, load, 4, 1.0 / 4);
+
+    route_destroy( route);
+}
+
+/**
+ * @fn static int bench_route_run( int fd, int count, bench_server_t *victim, int *ok, int *unavailable)
+ * @brief router로 app_id가 다른 요청을 pipelining 으로 보내고 응답을 검증하는 함수
+ * victim이 있으면 절반을 보낸 뒤에 그 backend를 종료해서 장애 시 동작을 확인한다
+ * @return 정상이면 NORMAL, 응답이 잘못되면 BUF_ERR
+ */
+static int bench_route_run( int fd, int count, bench_server_t *victim, int *ok, int *unavailable){
+    static char batch[ sizeof( kmp_t) * BENCH_WINDOW];
+    char frame[ sizeof( kmp_t)];
+    int len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    kmp_hdr_t *hdr;
+    int sent, j;
+
+    *ok = 0;
+    *unavailable = 0;
+    for( sent = 0; sent < count; sent += BENCH_WINDOW){
+        if( ( victim != NULL) && ( sent >= count / 2) && ( victim->pid > 0)){
+            bench_server_stop( victim);
+        }
+
+        for( j = 0; j < BENCH_WINDOW; j++){
+            hdr = ( kmp_hdr_t*)frame;
+            hdr->app_id = sent + j;
+            hdr->hop_id = j;
+            memcpy( &batch[ j * len], frame, len);
+        }
+        if( bench_write_full( fd, batch, len * BENCH_WINDOW) < NORMAL){
+            return SOC_ERR;
+        }
+
+        // 한 연결의 응답은 요청 순서대로 온다
+        for( j = 0; j < BENCH_WINDOW; j++){
+            if( bench_read_full( fd, batch, ROUTE_HDR_LEN) < NORMAL){
+                return SOC_ERR;
+            }
+            hdr = ( kmp_hdr_t*)batch;
+            if( ( hdr->app_id != ( uint32_t)( sent + j)) || ( hdr->hop_id != ( uint32_t)j)){
+                printf("	| ! Bench : wrong reply (app_id:%u hop_id:%u)\n", hdr->app_id, hdr->hop_id);
+                return BUF_ERR;
+            }
+            if( hdr->code == KMP_CODE_UNAVAILABLE){
+                ( *unavailable)++;
+                continue;
+            }
+            if( ( hdr->length != ( uint32_t)len) || ( bench_read_full( fd, &batch[ ROUTE_HDR_LEN], len - ROUTE_HDR_LEN) < NORMAL)){
+                return BUF_ERR;
+            }
+            ( *ok)++;
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief app_id sharding 벤치마크
+ * 1. backend 추가 / 제거 시 다시 배정되는 app_id 비율
+ * 2. backend 3개 + router 구성에서 처리량과 backend 하나가 죽었을 때의 실패 응답 수
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *router_opts[ BENCH_BACKEND_NUM * 2 + 1];
+    char backend_str[ BENCH_BACKEND_NUM][ 32];
+    bench_server_t backends[ BENCH_BACKEND_NUM], router;
+    uint64_t start, elapsed;
+    int fd, i, ok, unavailable;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    bench_route_remap();
+
+    for( i = 0; i < BENCH_BACKEND_NUM; i++){
+        snprintf( backend_str[ i], sizeof( backend_str[ i]), "%s:%d", BENCH_SERVER_IP, BENCH_SERVER_PORT + i);
+        router_opts[ i * 2] = "-R";
+        router_opts[ i * 2 + 1] = backend_str[ i];
+        if( bench_server_start( &backends[ i], bin, BENCH_SERVER_PORT + i, NULL, NULL) < NORMAL){
+            printf("	| ! Bench : Failed to start backend server (%s)\n", bin);
+            while( i-- > 0){
+                bench_server_stop( &backends[ i]);
+            }
+            return UNKNOWN;
+        }
+    }
+    router_opts[ BENCH_BACKEND_NUM * 2] = NULL;
+    if( bench_server_start( &router, bin, BENCH_ROUTER_PORT, NULL, router_opts) < NORMAL){
+        printf("	| ! Bench : Failed to start router (%s)\n", bin);
+        goto out;
+    }
+
+    printf("| %-16s | %9s | %9s | %11s |\n", "path", "req/s", "ok", "unavailable");
+    if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_ROUTER_PORT)) < 0){
+        goto out;
+    }
+    start = bench_now_ns();
+    if( bench_route_run( fd, BENCH_REQ_NUM, NULL, &ok, &unavailable) < NORMAL){
+        printf("	| ! Bench : routed run failed\n");
+        close( fd);
+        goto out;
+    }
+    elapsed = bench_now_ns() - start;
+    printf("| %-16s | %9.0f | %9d | %11d |\n", "3 backends", BENCH_REQ_NUM / ( elapsed / 1e9), ok, unavailable);
+
+    if( bench_route_run( fd, BENCH_REQ_NUM, &backends[ 1], &ok, &unavailable) < NORMAL){
+        printf("	| ! Bench : failover run failed\n");
+        close( fd);
+        goto out;
+    }
+    printf("| %-16s | %9s | %9d | %11d |\n", "kill 1 mid-run", "-", ok, unavailable);
+    close( fd);
+
+out:
+    bench_server_stop( &router);
+    for( i = 0; i < BENCH_BACKEND_NUM; i++){
+        bench_server_stop( &backends[ i]);
+    }
+    return NORMAL;
+}
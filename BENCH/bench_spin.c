@@ -0,0 +1,100 @@
+#include "bench.h"
+
+#define BENCH_SPIN_PORT ( BENCH_SERVER_PORT + 75)
+#define BENCH_BODY_LEN 64
+#define BENCH_PHASE_MS 2000
+/// 응답을 받고 다음 요청까지 쉬는 시간 (us). 짧은 간격은 spin 안에 다음 요청이 오고, 긴 간격은 오지 않는다
+#define BENCH_DENSE_US 50
+#define BENCH_SPARSE_US 2000
+#define BENCH_SAMPLE_MAX ( 1 << 16)
+
+/// @struct bench_spin_mode_t
+/// @brief 비교할 server 설정
+typedef struct bench_spin_mode_s bench_spin_mode_t;
+struct bench_spin_mode_s{
+    const char *name;
+    const char *opts[ 3];
+};
+
+/**
+ * @fn static int bench_spin_phase( int fd, pid_t pid, const char *mode, const char *phase, int think_us)
+ * @brief 요청 하나를 보내고 응답을 받은 뒤 think_us 쉬기를 반복하며 왕복 지연과 server CPU 사용률을 재는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_spin_phase( int fd, pid_t pid, const char *mode, const char *phase, int think_us){
+    static uint64_t samples[ BENCH_SAMPLE_MAX];
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    char stats[ 1024];
+    uint64_t start, end, sent, cpu;
+    int len, num = 0;
+
+    len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    cpu = bench_proc_cpu_ns( pid);
+    start = bench_now_ns();
+    end = start + ( uint64_t)BENCH_PHASE_MS * 1000000;
+    while( ( num < BENCH_SAMPLE_MAX) && ( bench_now_ns() < end)){
+        sent = bench_now_ns();
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, len) < NORMAL)){
+            return SOC_ERR;
+        }
+        samples[ num++] = bench_now_ns() - sent;
+        usleep( think_us);
+    }
+    cpu = bench_proc_cpu_ns( pid) - cpu;
+    end = bench_now_ns();
+
+    stats[ 0] = '\0';
+    bench_get_stats( BENCH_SPIN_PORT, stats, sizeof( stats));
+    // spin 하지 않는 server 는 spin_budget_us 가 없으므로 0 으로 출력한다
+    printf("| %-10s | %-7s | %7d | %8.1f | %8.1f | %8.1f | %12.1f | %9.0f |\n", mode, phase, num,
+            bench_percentile( samples, num, 50) / 1000.0, bench_percentile( samples, num, 99) / 1000.0,
+            100.0 * cpu / ( end - start), ( double)cpu / num / 1000.0,
+            ( bench_stats_value( stats, "spin_budget_us") > 0) ? bench_stats_value( stats, "spin_budget_us") : 0);
+    return NORMAL;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief busy-poll 시험
+ * 잠드는 server / 항상 정해진 시간 spin 하는 server / 이벤트 간격에 맞춰 spin 시간을 조절하는 server 에
+ * 촘촘한 요청과 드문 요청을 차례로 보내서 왕복 지연과 server CPU 사용량을 비교한다
+ * @return 정상이면 NORMAL
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    static bench_spin_mode_t modes[] = {
+        { "blocking", { NULL}},
+        { "fixed", { "-S", "200", NULL}},
+        { "adaptive", { "-S", "a:200", NULL}},
+    };
+    bench_server_t server;
+    int i, fd, rv = NORMAL;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    printf("	| @ Bench : dense = %d us between requests, sparse = %d us, spin up to 200 us\n", BENCH_DENSE_US, BENCH_SPARSE_US);
+    printf("| %-10s | %-7s | %7s | %8s | %8s | %8s | %12s | %9s |\n",
+            "mode", "load", "count", "p50 us", "p99 us", "cpu %", "cpu us / req", "spin us");
+    for( i = 0; ( i < ( int)( sizeof( modes) / sizeof( modes[ 0]))) && ( rv == NORMAL); i++){
+        if( bench_server_start( &server, bin, BENCH_SPIN_PORT, NULL, modes[ i].opts) < NORMAL){
+            printf("	| ! Bench : Failed to start server (%s)\n", bin);
+            return UNKNOWN;
+        }
+        if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_SPIN_PORT)) < 0){
+            rv = UNKNOWN;
+        }
+        else{
+            if( ( bench_spin_phase( fd, server.pid, modes[ i].name, "dense", BENCH_DENSE_US) < NORMAL)
+                    || ( bench_spin_phase( fd, server.pid, modes[ i].name, "sparse", BENCH_SPARSE_US) < NORMAL)){
+                printf("	| ! Bench : request failed (%s)\n", modes[ i].name);
+                rv = UNKNOWN;
+            }
+            close( fd);
+        }
+        bench_server_stop( &server);
+    }
+    return rv;
+}
@@ -0,0 +1,276 @@
+#include "bench.h"
+#include "../COMMON/stream.h"
+#include <poll.h>
+
+#define BENCH_STREAM_PORT ( BENCH_SERVER_PORT + 90)
+/// 큰 바디 하나의 길이와 개수
+#define BENCH_BULK_LEN ( 16 << 20)
+#define BENCH_BULK_NUM 4
+/// 작은 요청 바디 길이 / 큰 바디 없이 재는 작은 요청 수
+#define BENCH_SMALL_LEN 256
+#define BENCH_SMALL_NUM 2000
+/// 작은 요청의 stream id 는 0 이고 큰 바디는 1 부터 쓴다
+#define BENCH_BULK_ID_BASE 1
+/// 한 번에 write 하는 최대 바이트 수
+#define BENCH_WBUF_LEN ( 64 << 10)
+#define BENCH_RBUF_LEN ( 64 << 10)
+
+/// 큰 바디를 보내는 방법
+enum BENCH_STREAM_MODE{
+    /// 큰 바디 없이 작은 요청만 보낸다
+    BENCH_STREAM_SMALL = 0,
+    /// 큰 바디를 하나씩 끝까지 보내고 작은 요청은 그 사이에만 보낸다 (16 MB frame 하나를 보내는 것과 같다)
+    BENCH_STREAM_MONOLITHIC,
+    /// 큰 바디를 모두 stream 으로 동시에 열고 chunk 와 작은 요청을 섞어 보낸다
+    BENCH_STREAM_INTERLEAVE
+};
+
+/// @struct bench_stream_t
+/// @brief 연결 하나에서 작은 요청 하나와 큰 바디 여러 개를 같이 보내는 상태
+typedef struct bench_stream_s bench_stream_t;
+struct bench_stream_s{
+    int fd;
+    int mode;
+    stream_tx_t txs[ BENCH_BULK_NUM];
+    int tx_num;
+    /// 응답을 받은 큰 바디 수
+    int tx_ended;
+    /// monolithic 모드에서 보내고 있는 큰 바디
+    int tx_cur;
+    /// 다음 chunk 를 만들 큰 바디 (interleave 모드에서 돌아가며 고른다)
+    int tx_next;
+    char small[ sizeof( kmp_t)];
+    int small_len;
+    /// 작은 요청을 보내려고 한 시각 (0 이면 응답을 기다리지 않는다)
+    uint64_t small_start;
+    int small_queued;
+    uint64_t *samples;
+    int sample_num;
+    int sample_cap;
+    char wbuf[ BENCH_WBUF_LEN];
+    int wlen;
+    int woff;
+    char rbuf[ BENCH_RBUF_LEN];
+    int rlen;
+    uint64_t credits;
+};
+
+/**
+ * @fn static void bench_stream_fill( bench_stream_t *bs)
+ * @brief write 버퍼를 채우는 함수. 기다리는 작은 요청이 있으면 먼저 넣고, 나머지는 큰 바디의 chunk 를 창 안에서 넣는다
+ * monolithic 모드는 지금 큰 바디를 다 넣어야 작은 요청을 넣는다
+ * @return void
+ */
+static void bench_stream_fill( bench_stream_t *bs){
+    stream_tx_t *tx;
+    int len, i, idle;
+
+    if( bs->woff == bs->wlen){
+        bs->woff = bs->wlen = 0;
+    }
+    while( bs->wlen + ( int)sizeof( kmp_t) <= BENCH_WBUF_LEN){
+        if( ( bs->small_start != 0) && ( bs->small_queued == 0)
+                && ( ( bs->mode != BENCH_STREAM_MONOLITHIC) || ( bs->tx_cur == bs->tx_num) || ( bs->txs[ bs->tx_cur].sent == 0))){
+            memcpy( &bs->wbuf[ bs->wlen], bs->small, bs->small_len);
+            bs->wlen += bs->small_len;
+            bs->small_queued = 1;
+            continue;
+        }
+        if( bs->mode == BENCH_STREAM_MONOLITHIC){
+            if( bs->tx_cur == bs->tx_num){
+                break;
+            }
+            tx = &bs->txs[ bs->tx_cur];
+            if( ( len = stream_tx_next( tx, &bs->wbuf[ bs->wlen])) == 0){
+                break;
+            }
+            bs->wlen += len;
+            if( stream_tx_done( tx)){
+                // 기다리던 작은 요청은 다음 큰 바디를 시작하기 전에 들어간다
+                bs->tx_cur++;
+            }
+            continue;
+        }
+        for( i = 0, idle = 1; i < bs->tx_num; i++){
+            tx = &bs->txs[ bs->tx_next];
+            bs->tx_next = ( bs->tx_next + 1) % bs->tx_num;
+            if( ( len = stream_tx_next( tx, &bs->wbuf[ bs->wlen])) > 0){
+                bs->wlen += len;
+                idle = 0;
+                break;
+            }
+        }
+        if( idle){
+            break;
+        }
+    }
+}
+
+/**
+ * @fn static int bench_stream_read( bench_stream_t *bs)
+ * @brief 받은 응답을 처리하는 함수 (credit 은 창을 늘리고, stream 응답은 큰 바디를 끝내고, 나머지는 작은 요청의 응답이다)
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_stream_read( bench_stream_t *bs){
+    kmp_hdr_t *hdr;
+    int n, off = 0, id;
+
+    if( ( n = read( bs->fd, &bs->rbuf[ bs->rlen], BENCH_RBUF_LEN - bs->rlen)) <= 0){
+        return ( ( n < 0) && ( errno == EAGAIN)) ? NORMAL : SOC_ERR;
+    }
+    bs->rlen += n;
+    while( bs->rlen - off >= ( int)sizeof( kmp_hdr_t)){
+        hdr = ( kmp_hdr_t*)&bs->rbuf[ off];
+        if( bs->rlen - off < ( int)hdr->length){
+            break;
+        }
+        id = ( int)hdr->end_id - BENCH_BULK_ID_BASE;
+        if( hdr->code == KMP_CODE_CREDIT){
+            stream_tx_credit( &bs->txs[ id], ( uint32_t)stream_reply_value( &bs->rbuf[ off]));
+            bs->credits++;
+        }
+        else if( ( id >= 0) && ( id < bs->tx_num)){
+            if( stream_reply_value( &bs->rbuf[ off]) != bs->txs[ id].len){
+                printf("	| ! Bench : stream %d ended with %llu bytes\n", id, ( unsigned long long)stream_reply_value( &bs->rbuf[ off]));
+                return SOC_ERR;
+            }
+            bs->tx_ended++;
+        }
+        else{
+            if( bs->sample_num < bs->sample_cap){
+                bs->samples[ bs->sample_num++] = bench_now_ns() - bs->small_start;
+            }
+            bs->small_start = 0;
+            bs->small_queued = 0;
+        }
+        off += hdr->length;
+    }
+    memmove( bs->rbuf, &bs->rbuf[ off], bs->rlen - off);
+    bs->rlen -= off;
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_stream_run( bench_stream_t *bs, uint64_t *elapsed)
+ * @brief 큰 바디를 모두 보내고 응답을 받을 때까지 (큰 바디가 없으면 작은 요청 BENCH_SMALL_NUM 개) 작은 요청을 하나씩 계속 보내는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param bs 준비된 상태
+ * @param elapsed 걸린 시간 (ns)
+ */
+static int bench_stream_run( bench_stream_t *bs, uint64_t *elapsed){
+    struct pollfd pfd;
+    uint64_t start = bench_now_ns();
+    int n;
+
+    pfd.fd = bs->fd;
+    while( ( bs->tx_num > 0) ? ( ( bs->tx_ended < bs->tx_num) || ( bs->small_start != 0)) : ( bs->sample_num < BENCH_SMALL_NUM)){
+        if( ( bs->small_start == 0) && ( ( bs->tx_ended < bs->tx_num) || ( bs->tx_num == 0))){
+            bs->small_start = bench_now_ns();
+        }
+        bench_stream_fill( bs);
+        pfd.events = POLLIN | ( ( bs->woff < bs->wlen) ? POLLOUT : 0);
+        if( poll( &pfd, 1, 1000) <= 0){
+            printf("	| ! Bench : no progress for 1 second\n");
+            return SOC_ERR;
+        }
+        if( ( pfd.revents & POLLOUT) && ( bs->woff < bs->wlen)){
+            if( ( ( n = write( bs->fd, &bs->wbuf[ bs->woff], bs->wlen - bs->woff)) < 0) && ( errno != EAGAIN)){
+                return SOC_ERR;
+            }
+            bs->woff += ( n > 0) ? n : 0;
+        }
+        if( ( pfd.revents & ( POLLIN | POLLERR | POLLHUP)) && ( bench_stream_read( bs) < NORMAL)){
+            return SOC_ERR;
+        }
+    }
+    *elapsed = bench_now_ns() - start;
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_stream_mode( int mode, const char *name, const char *bulk)
+ * @brief 연결 하나에서 한 가지 방법으로 재고 작은 요청 지연과 큰 바디 처리량을 출력하는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_stream_mode( int mode, const char *name, const char *bulk){
+    bench_stream_t *bs;
+    uint64_t elapsed, p50, p99;
+    int i, rv;
+
+    if( ( bs = ( bench_stream_t*)calloc( 1, sizeof( bench_stream_t))) == NULL){
+        return SOC_ERR;
+    }
+    bs->mode = mode;
+    bs->sample_cap = BENCH_SMALL_NUM * 100;
+    if( ( bs->samples = ( uint64_t*)malloc( sizeof( uint64_t) * bs->sample_cap)) == NULL){
+        free( bs);
+        return SOC_ERR;
+    }
+    if( ( bs->fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_STREAM_PORT)) < 0){
+        free( bs->samples);
+        free( bs);
+        return SOC_ERR;
+    }
+    fcntl( bs->fd, F_SETFL, fcntl( bs->fd, F_GETFL) | O_NONBLOCK);
+    bs->small_len = bench_make_frame( bs->small, BENCH_SMALL_LEN, 1);
+    if( mode != BENCH_STREAM_SMALL){
+        bs->tx_num = BENCH_BULK_NUM;
+        for( i = 0; i < BENCH_BULK_NUM; i++){
+            stream_tx_init( &bs->txs[ i], BENCH_BULK_ID_BASE + i, 1, bulk, BENCH_BULK_LEN);
+        }
+    }
+
+    if( ( rv = bench_stream_run( bs, &elapsed)) == NORMAL){
+        p50 = bench_percentile( bs->samples, bs->sample_num, 50);
+        p99 = bench_percentile( bs->samples, bs->sample_num, 99);
+        printf("| %-18s | %7d | %9.1f | %9.1f | %10.1f | %9.1f | %7llu |\n", name, bs->sample_num, p50 / 1000.0, p99 / 1000.0,
+                bench_percentile( bs->samples, bs->sample_num, 100) / 1000.0,
+                ( double)bs->tx_num * BENCH_BULK_LEN / ( 1 << 20) * 1e9 / elapsed, ( unsigned long long)bs->credits);
+    }
+    close( bs->fd);
+    free( bs->samples);
+    free( bs);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief stream 다중화 시험
+ * 연결 하나에서 작은 요청을 하나씩 계속 보내면서 16 MB 바디 BENCH_BULK_NUM 개를 같이 보낼 때 작은 요청의 지연을 비교한다
+ * monolithic 은 큰 바디 하나를 끝까지 보낸 뒤에야 작은 요청을 보내고 (16 MB frame 하나와 같다),
+ * interleave 는 큰 바디를 모두 stream 으로 열어 창(STREAM_WINDOW) 안에서 chunk 를 작은 요청과 섞어 보낸다
+ * @return 정상이면 NORMAL
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    bench_server_t server;
+    char *bulk;
+    int rv = NORMAL;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    if( ( bulk = ( char*)malloc( BENCH_BULK_LEN)) == NULL){
+        return UNKNOWN;
+    }
+    memset( bulk, 'b', BENCH_BULK_LEN);
+
+    if( bench_server_start( &server, bin, BENCH_STREAM_PORT, NULL, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        free( bulk);
+        return UNKNOWN;
+    }
+    printf("	| @ Bench : one connection, %d byte requests one at a time, %d bodies of %d MB, chunk %d, window %d KB\n",
+            BENCH_SMALL_LEN, BENCH_BULK_NUM, BENCH_BULK_LEN >> 20, STREAM_CHUNK_LEN, STREAM_WINDOW >> 10);
+    printf("| %-18s | %7s | %9s | %9s | %10s | %9s | %7s |\n", "bulk", "small", "p50 us", "p99 us", "max us", "bulk MB/s", "credits");
+    if( ( bench_stream_mode( BENCH_STREAM_SMALL, "none", bulk) < NORMAL)
+            || ( bench_stream_mode( BENCH_STREAM_MONOLITHIC, "monolithic", bulk) < NORMAL)
+            || ( bench_stream_mode( BENCH_STREAM_INTERLEAVE, "interleaved", bulk) < NORMAL)){
+        printf("	| ! Bench : run failed\n");
+        rv = UNKNOWN;
+    }
+    bench_server_stop( &server);
+    free( bulk);
+    return rv;
+}
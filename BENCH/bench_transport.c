@@ -0,0 +1,208 @@
+#include "bench.h"
+#include "../COMMON/shm_ring.h"
+
+#define BENCH_ROUND_TRIPS 20000
+#define BENCH_WINDOW 32
+#define BENCH_SHM_SPIN 20000
+
+/// @struct bench_result_t
+/// @brief 전송로 하나에 대한 측정 결과
+typedef struct bench_result_s bench_result_t;
+struct bench_result_s{
+    /// round trip 지연 p50 (ns)
+    uint64_t p50;
+    /// round trip 지연 p99 (ns)
+    uint64_t p99;
+    /// pipelining 했을 때 초당 메시지 수
+    double msgs_per_sec;
+    /// pipelining 했을 때 초당 바이트 수 (MB/s)
+    double mb_per_sec;
+};
+
+static uint64_t samples[ BENCH_ROUND_TRIPS];
+
+/**
+ * @fn static int bench_socket_run( int fd, int body_len, bench_result_t *result)
+ * @brief TCP 또는 UDS 소켓으로 echo round trip 지연과 처리량을 측정하는 함수
+ * @return 정상이면 NORMAL, 실패하면 열거형 참고
+ * @param fd server에 연결된 blocking 소켓
+ * @param body_len 메시지 바디 크기
+ * @param result 측정 결과
+ */
+static int bench_socket_run( int fd, int body_len, bench_result_t *result){
+    char frame[ sizeof( kmp_t)];
+    char batch[ sizeof( kmp_t) * BENCH_WINDOW];
+    int len = bench_make_frame( frame, body_len, 1);
+    uint64_t start;
+    int i, j;
+
+    // 1. 메시지 하나씩 주고 받는 round trip 지연
+    for( i = 0; i < BENCH_ROUND_TRIPS; i++){
+        start = bench_now_ns();
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, batch, len) < NORMAL)){
+            return SOC_ERR;
+        }
+        samples[ i] = bench_now_ns() - start;
+    }
+    result->p99 = bench_percentile( samples, BENCH_ROUND_TRIPS, 99.0);
+    result->p50 = bench_percentile( samples, BENCH_ROUND_TRIPS, 50.0);
+
+    // 2. BENCH_WINDOW 개씩 pipelining 했을 때 처리량
+    for( j = 0; j < BENCH_WINDOW; j++){
+        memcpy( &batch[ j * len], frame, len);
+    }
+    start = bench_now_ns();
+    for( i = 0; i < BENCH_ROUND_TRIPS; i += BENCH_WINDOW){
+        if( ( bench_write_full( fd, batch, len * BENCH_WINDOW) < NORMAL) || ( bench_read_full( fd, batch, len * BENCH_WINDOW) < NORMAL)){
+            return SOC_ERR;
+        }
+    }
+    result->msgs_per_sec = ( double)i * 1e9 / ( bench_now_ns() - start);
+    result->mb_per_sec = result->msgs_per_sec * len / ( 1024.0 * 1024.0);
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_shm_run( shm_chan_t *chan, int body_len, bench_result_t *result)
+ * @brief shared memory ring으로 echo round trip 지연과 처리량을 측정하는 함수
+ * @return 정상이면 NORMAL, 실패하면 열거형 참고
+ * @param chan UDS로 협상한 shared memory 전송로
+ * @param body_len 메시지 바디 크기
+ * @param result 측정 결과
+ */
+static int bench_shm_run( shm_chan_t *chan, int body_len, bench_result_t *result){
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    int len = bench_make_frame( frame, body_len, 1);
+    uint64_t start;
+    int i, j;
+
+    for( i = 0; i < BENCH_ROUND_TRIPS; i++){
+        start = bench_now_ns();
+        if( shm_ring_push( chan->req, chan->req_efd, frame, len) < NORMAL){
+            return BUF_ERR;
+        }
+        if( ( shm_ring_wait( chan->rsp, chan->rsp_efd, BENCH_SHM_SPIN) < NORMAL) || ( shm_ring_pop( chan->rsp, reply, sizeof( reply)) != len)){
+            return BUF_ERR;
+        }
+        samples[ i] = bench_now_ns() - start;
+    }
+    result->p99 = bench_percentile( samples, BENCH_ROUND_TRIPS, 99.0);
+    result->p50 = bench_percentile( samples, BENCH_ROUND_TRIPS, 50.0);
+
+    start = bench_now_ns();
+    for( i = 0; i < BENCH_ROUND_TRIPS; i += BENCH_WINDOW){
+        for( j = 0; j < BENCH_WINDOW; j++){
+            if( shm_ring_push( chan->req, chan->req_efd, frame, len) < NORMAL){
+                return BUF_ERR;
+            }
+        }
+        for( j = 0; j < BENCH_WINDOW; j++){
+            if( ( shm_ring_wait( chan->rsp, chan->rsp_efd, BENCH_SHM_SPIN) < NORMAL) || ( shm_ring_pop( chan->rsp, reply, sizeof( reply)) != len)){
+                return BUF_ERR;
+            }
+        }
+    }
+    result->msgs_per_sec = ( double)i * 1e9 / ( bench_now_ns() - start);
+    result->mb_per_sec = result->msgs_per_sec * len / ( 1024.0 * 1024.0);
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_shm_corrupt()
+ * @brief 생산자가 발행한 바이트보다 긴 길이를 헤더에 쓴 메시지를 shm_ring_pop 이 꺼내지 않는지 확인하는 함수
+ * @return 맞으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_shm_corrupt(){
+    char frame[ sizeof( kmp_t)];
+    char buf[ sizeof( kmp_t)];
+    shm_chan_t *chan;
+    kmp_hdr_t *hdr;
+    uint32_t tail;
+    int len, ok;
+
+    if( ( chan = shm_chan_create( SHM_RING_SIZE)) == NULL){
+        return UNKNOWN;
+    }
+    len = bench_make_frame( frame, 100, 1);
+    shm_ring_push( chan->req, chan->req_efd, frame, len);
+    hdr = ( kmp_hdr_t*)chan->req->data;
+    tail = chan->req->tail;
+
+    // 길이만 늘리면 아직 쓰지 않은 바이트까지 읽게 되므로 BUF_ERR 이고 tail 은 그대로다
+    hdr->length = len + 100;
+    ok = ( shm_ring_pop( chan->req, buf, sizeof( buf)) == BUF_ERR) && ( chan->req->tail == tail);
+    hdr->length = len;
+    ok = ok && ( shm_ring_pop( chan->req, buf, sizeof( buf)) == len) && ( memcmp( buf, frame, len) == 0)
+        && ( shm_ring_free_bytes( chan->req) == SHM_RING_SIZE);
+    shm_chan_destroy( chan);
+    printf("| %-28s | %6s |\n", "shm.length_past_head", ok ? "ok" : "FAIL");
+    return ok ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static void bench_print( const char *name, int body_len, bench_result_t *result)
+ * @brief 측정 결과 한 줄을 출력하는 함수
+ * @return void
+ */
+static void bench_print( const char *name, int body_len, bench_result_t *result){
+    printf("| %-8s | %6d | %10.2f | %10.2f | %12.0f | %10.2f |\n", name, body_len,
+            result->p50 / 1000.0, result->p99 / 1000.0, result->msgs_per_sec, result->mb_per_sec);
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief TCP loopback, UDS, shared memory ring 전송로를 비교하는 벤치마크
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    static const int body_lens[] = { 16, 256, 1000};
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    bench_server_t server;
+    bench_result_t result;
+    shm_chan_t *chan;
+    int tcp_fd, unix_fd, shm_fd;
+    int rv = NORMAL;
+    int i;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    if( bench_server_start( &server, bin, BENCH_SERVER_PORT, BENCH_UNIX_PATH, NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+
+    tcp_fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_SERVER_PORT);
+    unix_fd = bench_connect_unix( BENCH_UNIX_PATH);
+    shm_fd = bench_connect_unix( BENCH_UNIX_PATH);
+    if( ( tcp_fd < 0) || ( unix_fd < 0) || ( shm_fd < 0) || ( ( chan = shm_chan_request( shm_fd)) == NULL)){
+        printf("	| ! Bench : Failed to connect server\n");
+        bench_server_stop( &server);
+        return UNKNOWN;
+    }
+
+    printf("| %-8s | %6s | %10s | %10s | %12s | %10s |\n", "path", "body", "p50(us)", "p99(us)", "msg/s", "MB/s");
+    for( i = 0; i < ( int)( sizeof( body_lens) / sizeof( body_lens[ 0])); i++){
+        if( bench_socket_run( tcp_fd, body_lens[ i], &result) == NORMAL){
+            bench_print( "tcp", body_lens[ i], &result);
+        }
+        if( bench_socket_run( unix_fd, body_lens[ i], &result) == NORMAL){
+            bench_print( "uds", body_lens[ i], &result);
+        }
+        if( bench_shm_run( chan, body_lens[ i], &result) == NORMAL){
+            bench_print( "shm", body_lens[ i], &result);
+        }
+    }
+
+    shm_chan_destroy( chan);
+    close( shm_fd);
+    close( unix_fd);
+    close( tcp_fd);
+    bench_server_stop( &server);
+    if( bench_shm_corrupt() < NORMAL){
+        rv = UNKNOWN;
+    }
+    return rv;
+}
@@ -0,0 +1,169 @@
+// recvmmsg / sendmmsg (COMMON/udp.h)
+#define _GNU_SOURCE
+#include "bench.h"
+#include "../COMMON/udp.h"
+#include <poll.h>
+#include <sched.h>
+
+#define BENCH_UDP_TCP_PORT ( BENCH_SERVER_PORT + 80)
+#define BENCH_UDP_PORT ( BENCH_SERVER_PORT + 81)
+#define BENCH_TCP_CONN_NUM 16
+#define BENCH_REQ_NUM 200000
+/// 응답을 기다리는 최대 시간 (ms). 지나면 남은 datagram 은 잃어버린 것으로 센다
+#define BENCH_LOSS_MS 100
+
+/**
+ * @fn static void bench_udp_print( const char *name, int body_len, uint64_t msgs, uint64_t lost, uint64_t wall_ns, uint64_t cpu_ns)
+ * @brief 처리량 한 줄을 출력하는 함수 (core 당 처리량은 server 가 쓴 CPU 시간으로 나눈 값이다)
+ * @return void
+ */
+static void bench_udp_print( const char *name, int body_len, uint64_t msgs, uint64_t lost, uint64_t wall_ns, uint64_t cpu_ns){
+    printf("| %-16s | %5d | %8llu | %11.0f | %12.0f | %12.0f | %7llu |\n", name, body_len, ( unsigned long long)msgs,
+            msgs * 1e9 / wall_ns, ( cpu_ns > 0) ? msgs * 1e9 / cpu_ns : 0.0, ( double)cpu_ns / msgs,
+            ( unsigned long long)lost);
+}
+
+/**
+ * @fn static int bench_udp_tcp( pid_t pid, int body_len)
+ * @brief 연결 BENCH_TCP_CONN_NUM 개로 요청을 하나씩 동시에 보내고 응답을 받는 TCP 기준선을 재는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_udp_tcp( pid_t pid, int body_len){
+    int fds[ BENCH_TCP_CONN_NUM];
+    double req_per_sec, usec_per_round;
+    uint64_t start, cpu;
+    int i, rv;
+
+    for( i = 0; i < BENCH_TCP_CONN_NUM; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_UDP_TCP_PORT)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            return SOC_ERR;
+        }
+    }
+    cpu = bench_proc_cpu_ns( pid);
+    start = bench_now_ns();
+    rv = bench_echo_run( fds, BENCH_TCP_CONN_NUM, body_len, BENCH_REQ_NUM, &req_per_sec, &usec_per_round);
+    if( rv == NORMAL){
+        bench_udp_print( "tcp echo", body_len, BENCH_REQ_NUM, 0, bench_now_ns() - start, bench_proc_cpu_ns( pid) - cpu);
+    }
+    for( i = 0; i < BENCH_TCP_CONN_NUM; i++){
+        close( fds[ i]);
+    }
+    return rv;
+}
+
+/**
+ * @fn static int bench_udp_echo( pid_t pid, int body_len, int no_reply)
+ * @brief UDP_BATCH_MAX 개의 datagram 을 sendmmsg 한 번으로 보내고 (no_reply 가 아니면) 응답을 recvmmsg 로 모두 받는 round 를 반복하는 함수
+ * no_reply 면 KMP_FLAG_NO_REPLY 를 붙여 보내기만 하고, 처리한 수는 server 통계로 센다
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int bench_udp_echo( pid_t pid, int body_len, int no_reply){
+    char frame[ sizeof( kmp_t)], stats[ 1024];
+    struct sockaddr_in to;
+    struct pollfd pfd;
+    uint64_t start, cpu, requests, msgs = 0, lost = 0;
+    int len, i, n, got, rv = NORMAL;
+    udp_t *udp;
+
+    if( ( udp = udp_open( NULL, 0)) == NULL){
+        return SOC_ERR;
+    }
+    memset( &to, 0, sizeof( to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = inet_addr( BENCH_SERVER_IP);
+    to.sin_port = htons( BENCH_UDP_PORT);
+    len = bench_make_frame( frame, body_len, 1);
+    if( no_reply){
+        ( ( kmp_hdr_t*)frame)->flag |= KMP_FLAG_NO_REPLY;
+    }
+    pfd.fd = udp->fd;
+    pfd.events = POLLIN;
+
+    bench_get_stats( BENCH_UDP_TCP_PORT, stats, sizeof( stats));
+    requests = bench_stats_value( stats, "requests");
+    cpu = bench_proc_cpu_ns( pid);
+    start = bench_now_ns();
+    while( msgs + lost < BENCH_REQ_NUM){
+        for( i = 0; i < UDP_BATCH_MAX; i++){
+            udp_send( udp, frame, len, &to);
+        }
+        if( udp_flush( udp) < NORMAL){
+            rv = SOC_ERR;
+            break;
+        }
+        if( no_reply){
+            msgs += UDP_BATCH_MAX;
+            // 1 core 에서 server 가 받을 틈을 준다 (보내기만 하면 수신 버퍼가 넘쳐서 버려진다)
+            sched_yield();
+            continue;
+        }
+        for( got = 0; got < UDP_BATCH_MAX; got += n){
+            if( poll( &pfd, 1, BENCH_LOSS_MS) <= 0){
+                break;
+            }
+            if( ( n = udp_recv( udp)) < NORMAL){
+                rv = SOC_ERR;
+                break;
+            }
+        }
+        msgs += got;
+        lost += UDP_BATCH_MAX - got;
+    }
+    if( no_reply){
+        // server 가 받은 datagram 을 모두 처리할 때까지 기다린 뒤 처리한 수를 센다
+        usleep( 100000);
+        bench_get_stats( BENCH_UDP_TCP_PORT, stats, sizeof( stats));
+        requests = bench_stats_value( stats, "requests") - requests;
+        lost = msgs - requests;
+        msgs = requests;
+    }
+    if( rv == NORMAL){
+        bench_udp_print( no_reply ? "udp fire&forget" : "udp echo", body_len, msgs, lost, bench_now_ns() - start,
+                bench_proc_cpu_ns( pid) - cpu);
+    }
+    udp_close( udp);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief UDP datagram 전송로 시험
+ * 같은 바디 크기에서 TCP echo / UDP echo (recvmmsg + sendmmsg) / UDP fire-and-forget 의 처리량과
+ * server CPU 1 core 당 처리량을 비교한다
+ * @return 정상이면 NORMAL
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const int body_lens[] = { 64, 512, 1000};
+    char udp_port[ 16];
+    const char *opts[] = { "-D", udp_port, NULL};
+    bench_server_t server;
+    int i, rv = NORMAL;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    snprintf( udp_port, sizeof( udp_port), "%d", BENCH_UDP_PORT);
+
+    if( bench_server_start( &server, bin, BENCH_UDP_TCP_PORT, NULL, opts) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    printf("	| @ Bench : %d requests per run, tcp %d connections, udp batch %d datagrams\n",
+            BENCH_REQ_NUM, BENCH_TCP_CONN_NUM, UDP_BATCH_MAX);
+    printf("| %-16s | %5s | %8s | %11s | %12s | %12s | %7s |\n",
+            "transport", "body", "msgs", "msg/s", "msg/s / core", "cpu ns / msg", "lost");
+    for( i = 0; ( i < ( int)( sizeof( body_lens) / sizeof( body_lens[ 0]))) && ( rv == NORMAL); i++){
+        if( ( bench_udp_tcp( server.pid, body_lens[ i]) < NORMAL) || ( bench_udp_echo( server.pid, body_lens[ i], 0) < NORMAL)
+                || ( bench_udp_echo( server.pid, body_lens[ i], 1) < NORMAL)){
+            printf("	| ! Bench : run failed (body %d)\n", body_lens[ i]);
+            rv = UNKNOWN;
+        }
+    }
+    bench_server_stop( &server);
+    return rv;
+}
@@ -0,0 +1,309 @@
+#include "bench.h"
+#include "../SERVER/wal.h"
+
+#define BENCH_WAL_PORT ( BENCH_SERVER_PORT + 100)
+#define BENCH_WAL_DIR "/tmp/kmp_bench_wal"
+/// 요청 바디 길이
+#define BENCH_WAL_BODY_LEN 256
+/// 설정 하나를 재는 시간 (ms)
+#define BENCH_WAL_RUN_MS 1500
+#define BENCH_WAL_ROUND_MAX 200000
+#define BENCH_WAL_CONN_MAX 64
+/// crash 검사에서 연결마다 보내는 요청 수
+#define BENCH_WAL_CRASH_CONNS 16
+#define BENCH_WAL_CRASH_MSGS 100
+/// segment 교체 검사 : 연결 수, 요청 바디 길이, 채울 segment 수, 최대 시간 (ms)
+#define BENCH_WAL_ROLL_CONNS 64
+#define BENCH_WAL_ROLL_BODY_LEN 1000
+#define BENCH_WAL_ROLL_SEGMENTS 2
+#define BENCH_WAL_ROLL_MS 30000
+
+/// @struct bench_wal_check_t
+/// @brief crash 뒤 log 에서 찾은 요청 (app_id 는 연결 번호, end_id 는 연결 안의 순서)
+typedef struct bench_wal_check_s bench_wal_check_t;
+struct bench_wal_check_s{
+    char found[ BENCH_WAL_CRASH_CONNS][ BENCH_WAL_CRASH_MSGS];
+};
+
+/**
+ * @fn static int bench_wal_count( void *arg, const char *frame, int len)
+ * @brief wal_scan 이 돌려준 record 수를 세는 함수
+ * @return NORMAL
+ */
+static int bench_wal_count( void *arg, const char *frame, int len){
+    ( void)frame;
+    ( void)len;
+    ( *( int*)arg)++;
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_wal_found( void *arg, const char *frame, int len)
+ * @brief wal_scan 이 돌려준 record 를 표시하는 함수
+ * @return NORMAL
+ */
+static int bench_wal_found( void *arg, const char *frame, int len){
+    bench_wal_check_t *check = ( bench_wal_check_t*)arg;
+    const kmp_hdr_t *hdr = ( const kmp_hdr_t*)frame;
+
+    if( ( len >= ( int)sizeof( kmp_hdr_t)) && ( hdr->app_id < BENCH_WAL_CRASH_CONNS) && ( hdr->end_id < BENCH_WAL_CRASH_MSGS)){
+        check->found[ hdr->app_id][ hdr->end_id] = 1;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_wal_start( bench_server_t *server, const char *bin, const char *window)
+ * @brief 빈 log directory 로 server 를 띄우는 함수
+ * @return 정상이면 NORMAL, 실패하면 UNKNOWN
+ * @param window "-G" 인자 (NULL 이면 log 없이 띄운다)
+ */
+static int bench_wal_start( bench_server_t *server, const char *bin, const char *window){
+    const char *opts[] = { "-G", window, NULL};
+
+    system( "rm -rf " BENCH_WAL_DIR);
+    if( bench_server_start( server, bin, BENCH_WAL_PORT, NULL, ( window != NULL) ? opts : NULL) < NORMAL){
+        printf("	| ! Bench : Failed to start server (%s)\n", bin);
+        return UNKNOWN;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_wal_run( const char *bin, const char *name, int window_us, int conn_num)
+ * @brief 연결 conn_num 개가 요청을 하나씩 보내고 ack 를 모두 받는 round 를 BENCH_WAL_RUN_MS 동안 반복하는 함수
+ * 한 round 의 요청은 같은 event loop 에서 log 에 쓰이므로 fdatasync 한 번에 같이 내려간다 (batch 크기 = 연결 수)
+ * @return 정상이면 NORMAL, 실패하면 UNKNOWN
+ * @param window_us sync 전에 더 모으는 시간 (음수면 log 없이 바로 응답)
+ */
+static int bench_wal_run( const char *bin, const char *name, int window_us, int conn_num){
+    static uint64_t samples[ BENCH_WAL_ROUND_MAX];
+    bench_server_t server;
+    char window[ 64 + sizeof( BENCH_WAL_DIR)];
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    char stats[ 2048];
+    int fds[ BENCH_WAL_CONN_MAX];
+    uint64_t start, round_start, elapsed;
+    double p50, p99;
+    int len, rounds = 0, rv = NORMAL;
+    int i;
+
+    snprintf( window, sizeof( window), "%s:%d", BENCH_WAL_DIR, window_us);
+    if( bench_wal_start( &server, bin, ( window_us >= 0) ? window : NULL) < NORMAL){
+        return UNKNOWN;
+    }
+    for( i = 0; i < conn_num; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_WAL_PORT)) < 0){
+            conn_num = i;
+            rv = UNKNOWN;
+            break;
+        }
+    }
+
+    len = bench_make_frame( frame, BENCH_WAL_BODY_LEN, 1);
+    start = bench_now_ns();
+    while( ( rv == NORMAL) && ( rounds < BENCH_WAL_ROUND_MAX) && ( bench_now_ns() - start < BENCH_WAL_RUN_MS * 1000000ULL)){
+        round_start = bench_now_ns();
+        for( i = 0; i < conn_num; i++){
+            if( bench_write_full( fds[ i], frame, len) < NORMAL){
+                rv = UNKNOWN;
+            }
+        }
+        for( i = 0; i < conn_num; i++){
+            if( bench_read_full( fds[ i], reply, len) < NORMAL){
+                rv = UNKNOWN;
+            }
+        }
+        samples[ rounds++] = bench_now_ns() - round_start;
+    }
+    elapsed = bench_now_ns() - start;
+    if( ( rv == NORMAL) && ( bench_get_stats( BENCH_WAL_PORT, stats, sizeof( stats)) < NORMAL)){
+        rv = UNKNOWN;
+    }
+    for( i = 0; i < conn_num; i++){
+        close( fds[ i]);
+    }
+    bench_server_stop( &server);
+    if( rv < NORMAL){
+        printf("	| ! Bench : %s failed\n", name);
+        return rv;
+    }
+
+    p50 = bench_percentile( samples, rounds, 50) / 1000.0;
+    p99 = bench_percentile( samples, rounds, 99) / 1000.0;
+    printf("| %-10s | %5d | %6d | %10.0f | %9.1f | %9.1f | %8.2f | %9.1f |\n", name, conn_num, ( window_us < 0) ? 0 : window_us,
+            ( double)rounds * conn_num / ( elapsed / 1e9), p50, p99,
+            bench_stats_value( stats, "wal_batch_avg"), bench_stats_value( stats, "wal_sync_us"));
+    return NORMAL;
+}
+
+/**
+ * @fn static int bench_wal_crash( const char *bin)
+ * @brief ack 를 받은 요청이 server 를 SIGKILL 로 죽인 뒤에도 log 에 모두 남아 있는지 확인하는 함수
+ * @return 모두 있으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_wal_crash( const char *bin){
+    static bench_wal_check_t check;
+    bench_server_t server;
+    char window[ 64 + sizeof( BENCH_WAL_DIR)];
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    int fds[ BENCH_WAL_CRASH_CONNS];
+    int acked = 0, missing = 0, records;
+    int len, i, j;
+
+    snprintf( window, sizeof( window), "%s:%d", BENCH_WAL_DIR, 0);
+    if( bench_wal_start( &server, bin, window) < NORMAL){
+        return UNKNOWN;
+    }
+    for( i = 0; i < BENCH_WAL_CRASH_CONNS; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_WAL_PORT)) < 0){
+            bench_server_stop( &server);
+            return UNKNOWN;
+        }
+    }
+    len = bench_make_frame( frame, BENCH_WAL_BODY_LEN, 1);
+    for( j = 0; j < BENCH_WAL_CRASH_MSGS; j++){
+        for( i = 0; i < BENCH_WAL_CRASH_CONNS; i++){
+            ( ( kmp_hdr_t*)frame)->app_id = i;
+            ( ( kmp_hdr_t*)frame)->end_id = j;
+            bench_write_full( fds[ i], frame, len);
+        }
+        for( i = 0; i < BENCH_WAL_CRASH_CONNS; i++){
+            if( bench_read_full( fds[ i], reply, len) == NORMAL){
+                acked++;
+            }
+        }
+    }
+    // ack 를 받은 뒤 바로 죽인다 (bench_server_stop 은 SIGKILL 이다)
+    bench_server_stop( &server);
+    for( i = 0; i < BENCH_WAL_CRASH_CONNS; i++){
+        close( fds[ i]);
+    }
+
+    records = wal_scan( BENCH_WAL_DIR, bench_wal_found, &check);
+    for( i = 0; i < BENCH_WAL_CRASH_CONNS; i++){
+        for( j = 0; j < BENCH_WAL_CRASH_MSGS; j++){
+            missing += ( check.found[ i][ j] == 0);
+        }
+    }
+    printf("| %-28s | %6s | (acked %d, records %d, missing %d)\n", "wal.acked_after_kill",
+            ( ( acked == BENCH_WAL_CRASH_CONNS * BENCH_WAL_CRASH_MSGS) && ( missing == 0)) ? "ok" : "FAIL", acked, records, missing);
+    system( "rm -rf " BENCH_WAL_DIR);
+    return ( ( acked == BENCH_WAL_CRASH_CONNS * BENCH_WAL_CRASH_MSGS) && ( missing == 0)) ? NORMAL : UNKNOWN;
+}
+
+/**
+ * @fn static int bench_wal_rollover( const char *bin)
+ * @brief segment 를 BENCH_WAL_ROLL_SEGMENTS 개 넘게 채우는 동안 ack 를 받은 요청이 모두 log 에 있는지 확인하는 함수
+ * 다음 segment 가 아직 준비되지 않아 KMP_CODE_OVERLOAD 로 거절된 요청은 log 에 없어야 하므로 ack 로 세지 않는다
+ * @return 모두 있으면 NORMAL, 아니면 UNKNOWN
+ */
+static int bench_wal_rollover( const char *bin){
+    bench_server_t server;
+    char window[ 64 + sizeof( BENCH_WAL_DIR)];
+    char frame[ sizeof( kmp_t)];
+    char reply[ sizeof( kmp_t)];
+    char stats[ 2048];
+    int fds[ BENCH_WAL_ROLL_CONNS];
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)reply;
+    uint64_t start;
+    double segments = 0;
+    int acked = 0, rejected = 0, records = 0;
+    int len, i, rounds, rv = NORMAL;
+
+    snprintf( window, sizeof( window), "%s:%d", BENCH_WAL_DIR, 0);
+    if( bench_wal_start( &server, bin, window) < NORMAL){
+        return UNKNOWN;
+    }
+    for( i = 0; i < BENCH_WAL_ROLL_CONNS; i++){
+        if( ( fds[ i] = bench_connect_tcp( BENCH_SERVER_IP, BENCH_WAL_PORT)) < 0){
+            while( i-- > 0){
+                close( fds[ i]);
+            }
+            bench_server_stop( &server);
+            return UNKNOWN;
+        }
+    }
+    stats[ 0] = '\0';
+    len = bench_make_frame( frame, BENCH_WAL_ROLL_BODY_LEN, 1);
+    start = bench_now_ns();
+    for( rounds = 0; ( rv == NORMAL) && ( segments <= BENCH_WAL_ROLL_SEGMENTS); rounds++){
+        for( i = 0; i < BENCH_WAL_ROLL_CONNS; i++){
+            if( bench_write_full( fds[ i], frame, len) < NORMAL){
+                rv = UNKNOWN;
+            }
+        }
+        for( i = 0; ( rv == NORMAL) && ( i < BENCH_WAL_ROLL_CONNS); i++){
+            if( ( bench_read_full( fds[ i], reply, sizeof( kmp_hdr_t)) < NORMAL) || ( hdr->length > sizeof( reply))
+                    || ( bench_read_full( fds[ i], &reply[ sizeof( kmp_hdr_t)], hdr->length - sizeof( kmp_hdr_t)) < NORMAL)){
+                rv = UNKNOWN;
+            }
+            else if( hdr->code == KMP_CODE_OVERLOAD){
+                rejected++;
+            }
+            else{
+                acked++;
+            }
+        }
+        if( ( rv == NORMAL) && ( rounds % 100 == 0)){
+            if( bench_get_stats( BENCH_WAL_PORT, stats, sizeof( stats)) < NORMAL){
+                rv = UNKNOWN;
+            }
+            segments = bench_stats_value( stats, "wal_segments");
+            if( bench_now_ns() - start > BENCH_WAL_ROLL_MS * 1000000ULL){
+                break;
+            }
+        }
+    }
+    bench_server_stop( &server);
+    for( i = 0; i < BENCH_WAL_ROLL_CONNS; i++){
+        close( fds[ i]);
+    }
+
+    wal_scan( BENCH_WAL_DIR, bench_wal_count, &records);
+    rv = ( rv == NORMAL) && ( segments > BENCH_WAL_ROLL_SEGMENTS) && ( records == acked) ? NORMAL : UNKNOWN;
+    printf("| %-28s | %6s | (segments %.0f, acked %d, overload %d, records %d, stalls %.0f)\n", "wal.rollover",
+            ( rv == NORMAL) ? "ok" : "FAIL", segments, acked, rejected, records, bench_stats_value( stats, "wal_stalls"));
+    system( "rm -rf " BENCH_WAL_DIR);
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief write-ahead log 를 켠 server 의 ack 처리량과 지연을 batch 크기(연결 수)와 sync window 별로 재는 벤치마크
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로 (기본 ../SERVER/server)
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    int conns[] = { 1, 4, 16, 64};
+    int windows[] = { 200, 1000};
+    int rv = NORMAL;
+    int i;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    printf("	| @ Bench : %d byte requests, closed loop rounds of one request per connection, log in %s\n",
+            BENCH_WAL_BODY_LEN, BENCH_WAL_DIR);
+    printf("| %-10s | %5s | %6s | %10s | %9s | %9s | %8s | %9s |\n", "log", "conns", "win us", "acked/s", "p50 us", "p99 us", "batch", "sync us");
+    for( i = 0; i < 4; i++){
+        if( ( bench_wal_run( bin, "off", -1, conns[ i]) < NORMAL) || ( bench_wal_run( bin, "fdatasync", 0, conns[ i]) < NORMAL)){
+            rv = UNKNOWN;
+        }
+    }
+    for( i = 0; i < 2; i++){
+        if( ( bench_wal_run( bin, "window", windows[ i], 1) < NORMAL) || ( bench_wal_run( bin, "window", windows[ i], 64) < NORMAL)){
+            rv = UNKNOWN;
+        }
+    }
+    if( bench_wal_crash( bin) < NORMAL){
+        rv = UNKNOWN;
+    }
+    if( bench_wal_rollover( bin) < NORMAL){
+        rv = UNKNOWN;
+    }
+    return rv;
+}
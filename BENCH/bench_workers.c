@@ -0,0 +1,162 @@
+#include "bench.h"
+
+#define BENCH_WORKERS_PORT ( BENCH_SERVER_PORT + 85)
+#define BENCH_WORKER_NUM 4
+/// 순서대로 여는 연결 수. BENCH_KEEP_EVERY 번째마다 하나씩 남기고 나머지는 요청 하나만 보내고 닫는다
+#define BENCH_CONN_NUM 256
+#define BENCH_KEEP_EVERY 4
+#define BENCH_ROUND_NUM 4000
+#define BENCH_BODY_LEN 256
+
+/**
+ * @fn static int bench_workers_churn( int *keep)
+ * @brief 오래 가는 연결과 바로 닫히는 연결이 섞인 부하를 만드는 함수
+ * 짧은 연결은 echo 하나를 받고 닫으므로 worker 마다 남는 연결 수는 분배 방법에 따라 달라진다
+ * @return 남긴 연결 수, 실패하면 SOC_ERR
+ * @param keep 남긴 연결을 저장할 배열 (BENCH_CONN_NUM / BENCH_KEEP_EVERY 개)
+ */
+static int bench_workers_churn( int *keep){
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    int len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    int i, fd, keep_num = 0;
+
+    for( i = 0; i < BENCH_CONN_NUM; i++){
+        if( ( fd = bench_connect_tcp( BENCH_SERVER_IP, BENCH_WORKERS_PORT)) < 0){
+            break;
+        }
+        if( ( bench_write_full( fd, frame, len) < NORMAL) || ( bench_read_full( fd, reply, len) < NORMAL)){
+            close( fd);
+            break;
+        }
+        if( i % BENCH_KEEP_EVERY == 0){
+            keep[ keep_num++] = fd;
+        }
+        else{
+            close( fd);
+        }
+    }
+    if( i < BENCH_CONN_NUM){
+        while( keep_num-- > 0){
+            close( keep[ keep_num]);
+        }
+        return SOC_ERR;
+    }
+    // 닫은 연결을 worker 가 모두 정리할 시간을 준다
+    usleep( 50000);
+    return keep_num;
+}
+
+/**
+ * @fn static int bench_workers_run( pid_t pid, const char *name)
+ * @brief 남긴 연결로 모든 연결이 요청 하나씩을 보내는 round 를 반복하고 worker 별 연결 수 / 처리량 치우침을 출력하는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param pid server 프로세스
+ * @param name 분배 방법 이름
+ */
+static int bench_workers_run( pid_t pid, const char *name){
+    int keep[ BENCH_CONN_NUM / BENCH_KEEP_EVERY];
+    char frame[ sizeof( kmp_t)], reply[ sizeof( kmp_t)];
+    char stats[ 2048], key[ 32];
+    uint64_t *rounds, start, round_start, cpu;
+    double before[ BENCH_WORKER_NUM], conns, reqs, reqs_max = 0, reqs_sum = 0;
+    int len = bench_make_frame( frame, BENCH_BODY_LEN, 1);
+    int keep_num, i, j, rv = NORMAL;
+
+    if( ( keep_num = bench_workers_churn( keep)) < NORMAL){
+        return SOC_ERR;
+    }
+    if( ( rounds = ( uint64_t*)malloc( sizeof( uint64_t) * BENCH_ROUND_NUM)) == NULL){
+        rv = SOC_ERR;
+        goto out;
+    }
+    bench_get_stats( BENCH_WORKERS_PORT, stats, sizeof( stats));
+    for( i = 0; i < BENCH_WORKER_NUM; i++){
+        snprintf( key, sizeof( key), "w%d_requests", i);
+        before[ i] = bench_stats_value( stats, key);
+    }
+
+    cpu = bench_proc_cpu_ns( pid);
+    start = bench_now_ns();
+    for( i = 0; ( i < BENCH_ROUND_NUM) && ( rv == NORMAL); i++){
+        round_start = bench_now_ns();
+        for( j = 0; j < keep_num; j++){
+            if( bench_write_full( keep[ j], frame, len) < NORMAL){
+                rv = SOC_ERR;
+            }
+        }
+        for( j = 0; ( j < keep_num) && ( rv == NORMAL); j++){
+            if( bench_read_full( keep[ j], reply, len) < NORMAL){
+                rv = SOC_ERR;
+            }
+        }
+        rounds[ i] = bench_now_ns() - round_start;
+    }
+    if( rv != NORMAL){
+        free( rounds);
+        goto out;
+    }
+    start = bench_now_ns() - start;
+    cpu = bench_proc_cpu_ns( pid) - cpu;
+
+    bench_get_stats( BENCH_WORKERS_PORT, stats, sizeof( stats));
+    printf("| %-22s |", name);
+    for( i = 0; i < BENCH_WORKER_NUM; i++){
+        snprintf( key, sizeof( key), "w%d_conns", i);
+        conns = bench_stats_value( stats, key);
+        snprintf( key, sizeof( key), "w%d_requests", i);
+        reqs = bench_stats_value( stats, key) - before[ i];
+        reqs_max = ( reqs > reqs_max) ? reqs : reqs_max;
+        reqs_sum += reqs;
+        printf(" %3.0f", conns);
+    }
+    printf(" | %8.2f | %9.0f | %8.1f | %8.1f | %7.1f |\n",
+            ( reqs_sum > 0) ? reqs_max / ( reqs_sum / BENCH_WORKER_NUM) : 0.0,
+            ( double)BENCH_ROUND_NUM * keep_num * 1e9 / start,
+            bench_percentile( rounds, BENCH_ROUND_NUM, 50) / 1000.0, bench_percentile( rounds, BENCH_ROUND_NUM, 99) / 1000.0,
+            ( double)cpu / ( ( double)BENCH_ROUND_NUM * keep_num));
+    free( rounds);
+out:
+    for( i = 0; i < keep_num; i++){
+        close( keep[ i]);
+    }
+    return rv;
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief worker 분배 방법 시험
+ * 오래 가는 연결 사이에 바로 닫히는 연결이 섞인 부하를 만든 뒤, acceptor 가 연결 수가 가장 적은 worker 에 넘기는 방법과
+ * worker 마다 SO_REUSEPORT listener 를 열어 kernel hash 로 나누는 방법의 worker 별 연결 수 / 처리량 치우침을 비교한다
+ * (max/mean 은 가장 바쁜 worker 의 처리 수를 평균으로 나눈 값으로, 1 이면 고르게 나뉜 것이다)
+ * @return 정상이면 NORMAL
+ * @param argc 매개변수 개수
+ * @param argv server 실행 파일 경로
+ */
+int main( int argc, char **argv){
+    const char *bin = ( argc > 1) ? argv[ 1] : "../SERVER/server";
+    const char *modes[][ 2] = { { "4", "least-loaded acceptor"}, { "r:4", "SO_REUSEPORT"}};
+    const char *opts[] = { "-N", NULL, NULL};
+    bench_server_t server;
+    int i, rv = NORMAL;
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+
+    printf("	| @ Bench : %d workers, %d connections opened in order, every %d-th kept, %d rounds of %d bytes\n",
+            BENCH_WORKER_NUM, BENCH_CONN_NUM, BENCH_KEEP_EVERY, BENCH_ROUND_NUM, BENCH_BODY_LEN);
+    printf("| %-22s | %-15s | %8s | %9s | %8s | %8s | %7s |\n",
+            "dispatch", "conns / worker", "max/mean", "req/s", "p50 us", "p99 us", "cpu ns");
+    for( i = 0; ( i < ( int)( sizeof( modes) / sizeof( modes[ 0]))) && ( rv == NORMAL); i++){
+        opts[ 1] = modes[ i][ 0];
+        if( bench_server_start( &server, bin, BENCH_WORKERS_PORT, NULL, opts) < NORMAL){
+            printf("	| ! Bench : Failed to start server (%s)\n", bin);
+            return UNKNOWN;
+        }
+        if( bench_workers_run( server.pid, modes[ i][ 1]) < NORMAL){
+            printf("	| ! Bench : run failed (%s)\n", modes[ i][ 1]);
+            rv = UNKNOWN;
+        }
+        bench_server_stop( &server);
+    }
+    return rv;
+}
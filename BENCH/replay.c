@@ -0,0 +1,397 @@
+#include "bench.h"
+#include "../COMMON/capture.h"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+/// 연결 하나에서 응답을 기다리는 최대 요청 수 (넘으면 응답이 올 때까지 보내지 않는다)
+#define REPLAY_INFLIGHT_MAX 1024
+/// 응답 지연 표본 최대 수
+#define REPLAY_SAMPLE_MAX ( 1 << 20)
+/// 다 보낸 뒤 응답을 기다리는 최대 시간 (응답이 하나도 오지 않는 시간 기준, ms)
+#define REPLAY_DRAIN_MS 3000
+#define REPLAY_EVENT_MAX 256
+/// 보낼 시각까지 이만큼만 남았으면 기다리지 않고 보낸다 (ns)
+#define REPLAY_SLACK_NS 50000
+/// 보내는 도중 응답을 읽는 간격 (ns)
+#define REPLAY_POLL_NS 50000
+
+/// @struct replay_conn_t
+/// @brief capture 의 연결 id 하나를 재생하는 TCP 연결
+typedef struct replay_conn_s replay_conn_t;
+struct replay_conn_s{
+    /// 소켓 (아직 연결하지 않았으면 -1, server 가 끊었으면 -2)
+    int fd;
+    /// 받고 있는 응답 헤더
+    char hdr[ sizeof( kmp_hdr_t)];
+    /// 받은 응답 헤더 bytes
+    int hdr_got;
+    /// 받아야 하는 응답 바디 bytes
+    int body_left;
+    /// 보낸 요청 수
+    uint64_t sent;
+    /// 받은 응답 수
+    uint64_t recv;
+    /// 응답을 기다리는 요청을 보낸 시각 (sent % REPLAY_INFLIGHT_MAX 순서)
+    uint64_t send_ns[ REPLAY_INFLIGHT_MAX];
+};
+
+/// @struct replay_t
+/// @brief 재생 상태
+typedef struct replay_s replay_t;
+struct replay_s{
+    /// 응답을 기다리는 epoll
+    int epoll_fd;
+    /// 재생 대상 server 주소
+    const char *ip;
+    int port;
+    /// capture 연결 id 로 찾는 연결 (0 ~ conn_max)
+    replay_conn_t *conns;
+    uint32_t conn_max;
+    /// 맺은 연결 수
+    int conn_num;
+    /// server 가 끊은 연결로 보내지 못한 요청 수
+    uint64_t dropped;
+    /// 받은 응답 수
+    uint64_t replies;
+    /// 응답 지연 표본 (ns)
+    uint64_t *samples;
+    int sample_num;
+    /// 마지막으로 응답을 읽은 시각 (ns)
+    uint64_t poll_ns;
+    /// 다음 요청을 보낼 시각에 깨우는 timerfd (epoll data.ptr 는 NULL)
+    int timer_fd;
+    /// timerfd 가 울렸는지 여부
+    int is_timer_fired;
+};
+
+/**
+ * @fn static replay_conn_t* replay_conn_get( replay_t *replay, uint32_t conn_id)
+ * @brief capture 연결 id 에 해당하는 연결을 찾고, 처음 보는 id 면 server 에 새로 연결하는 함수
+ * @return 연결, 연결하지 못했거나 server 가 끊은 연결이면 NULL
+ */
+static replay_conn_t* replay_conn_get( replay_t *replay, uint32_t conn_id){
+    replay_conn_t *conn = &replay->conns[ conn_id];
+    struct epoll_event ev;
+
+    if( conn->fd == -1){
+        if( ( conn->fd = bench_connect_tcp( replay->ip, replay->port)) < 0){
+            printf("	| ! Replay : Failed to connect %s:%d\n", replay->ip, replay->port);
+            conn->fd = -2;
+            return NULL;
+        }
+        fcntl( conn->fd, F_SETFL, fcntl( conn->fd, F_GETFL, 0) | O_NONBLOCK);
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        epoll_ctl( replay->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev);
+        replay->conn_num++;
+    }
+    return ( conn->fd >= 0) ? conn : NULL;
+}
+
+/**
+ * @fn static void replay_conn_close( replay_t *replay, replay_conn_t *conn)
+ * @brief server 가 끊은 연결을 닫는 함수 (이후 이 연결로 보낼 요청은 버린다)
+ * @return void
+ */
+static void replay_conn_close( replay_t *replay, replay_conn_t *conn){
+    epoll_ctl( replay->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close( conn->fd);
+    conn->fd = -2;
+}
+
+/**
+ * @fn static void replay_conn_read( replay_t *replay, replay_conn_t *conn)
+ * @brief 연결에 도착한 응답을 모두 읽고, 응답이 끝날 때마다 요청을 보낸 시각과 비교해서 지연을 남기는 함수
+ * @return void
+ */
+static void replay_conn_read( replay_t *replay, replay_conn_t *conn){
+    char buf[ 65536];
+    uint64_t now;
+    int len, pos, n;
+
+    while( ( len = read( conn->fd, buf, sizeof( buf))) > 0){
+        now = bench_now_ns();
+        pos = 0;
+        while( pos < len){
+            if( conn->hdr_got < ( int)sizeof( kmp_hdr_t)){
+                n = ( ( int)sizeof( kmp_hdr_t) - conn->hdr_got < len - pos) ? ( int)sizeof( kmp_hdr_t) - conn->hdr_got : len - pos;
+                memcpy( &conn->hdr[ conn->hdr_got], &buf[ pos], n);
+                conn->hdr_got += n;
+                pos += n;
+                if( conn->hdr_got < ( int)sizeof( kmp_hdr_t)){
+                    break;
+                }
+                conn->body_left = ( ( kmp_hdr_t*)conn->hdr)->length - sizeof( kmp_hdr_t);
+            }
+            n = ( conn->body_left < len - pos) ? conn->body_left : len - pos;
+            conn->body_left -= n;
+            pos += n;
+            if( conn->body_left == 0){
+                // 응답은 요청 순서대로 온다
+                if( replay->sample_num < REPLAY_SAMPLE_MAX){
+                    replay->samples[ replay->sample_num++] = now - conn->send_ns[ conn->recv % REPLAY_INFLIGHT_MAX];
+                }
+                conn->recv++;
+                replay->replies++;
+                conn->hdr_got = 0;
+            }
+        }
+    }
+    if( ( len == 0) || ( ( errno != EAGAIN) && ( errno != EWOULDBLOCK) && ( errno != EINTR))){
+        printf("	| ! Replay : server closed connection (fd:%d)\n", conn->fd);
+        replay_conn_close( replay, conn);
+    }
+}
+
+/**
+ * @fn static int replay_poll( replay_t *replay, int timeout_ms)
+ * @brief 응답이 도착한 연결을 읽는 함수
+ * @return 읽은 연결 수
+ */
+static int replay_poll( replay_t *replay, int timeout_ms){
+    struct epoll_event events[ REPLAY_EVENT_MAX];
+    uint64_t expired;
+    int i, num;
+
+    num = epoll_wait( replay->epoll_fd, events, REPLAY_EVENT_MAX, timeout_ms);
+    replay->poll_ns = bench_now_ns();
+    if( num < 0){
+        return 0;
+    }
+    for( i = 0; i < num; i++){
+        if( events[ i].data.ptr == NULL){
+            read( replay->timer_fd, &expired, sizeof( expired));
+            replay->is_timer_fired = 1;
+        }
+        else if( ( ( replay_conn_t*)events[ i].data.ptr)->fd >= 0){
+            replay_conn_read( replay, ( replay_conn_t*)events[ i].data.ptr);
+        }
+    }
+    return num;
+}
+
+/**
+ * @fn static int replay_send( replay_t *replay, replay_conn_t *conn, const char *frame, uint32_t len)
+ * @brief 요청 하나를 보내는 함수
+ * 송신 버퍼가 차거나 응답을 기다리는 요청이 많으면 응답을 읽으면서 기다린다 (server 와 서로 막히지 않게)
+ * @return 정상이면 NORMAL, server 가 연결을 끊었으면 SOC_ERR
+ */
+static int replay_send( replay_t *replay, replay_conn_t *conn, const char *frame, uint32_t len){
+    uint32_t off = 0;
+    int rv;
+
+    while( ( conn->fd >= 0) && ( conn->sent - conn->recv >= REPLAY_INFLIGHT_MAX)){
+        replay_poll( replay, 1);
+    }
+    if( conn->fd < 0){
+        return SOC_ERR;
+    }
+
+    conn->send_ns[ conn->sent % REPLAY_INFLIGHT_MAX] = bench_now_ns();
+    while( off < len){
+        if( ( rv = write( conn->fd, &frame[ off], len - off)) > 0){
+            off += rv;
+            continue;
+        }
+        if( ( rv < 0) && ( ( errno == EAGAIN) || ( errno == EWOULDBLOCK) || ( errno == EINTR))){
+            replay_poll( replay, 1);
+            if( conn->fd >= 0){
+                continue;
+            }
+        }
+        return SOC_ERR;
+    }
+    conn->sent++;
+    return NORMAL;
+}
+
+/**
+ * @fn static int replay_has_pending( replay_t *replay)
+ * @brief 아직 응답을 받지 못한 요청이 있는 열린 연결이 있는지 확인하는 함수
+ * @return 있으면 1, 없으면 0
+ */
+static int replay_has_pending( replay_t *replay){
+    uint32_t i;
+
+    for( i = 0; i <= replay->conn_max; i++){
+        if( ( replay->conns[ i].fd >= 0) && ( replay->conns[ i].recv < replay->conns[ i].sent)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn static void replay_wait_until( replay_t *replay, uint64_t target_ns)
+ * @brief 다음 요청을 보낼 시각까지 응답을 읽으면서 기다리는 함수
+ * epoll_wait 의 timeout 은 ms 단위이므로 timerfd 를 epoll 에 함께 걸어서 us 단위로 깨어난다
+ * REPLAY_SLACK_NS 안에 보낼 요청은 기다리지 않는다 (바쁘게 기다리면 같은 CPU 의 server 가 밀려서 부하 모양이 바뀐다)
+ * @return void
+ */
+static void replay_wait_until( replay_t *replay, uint64_t target_ns){
+    struct itimerspec its;
+
+    if( bench_now_ns() + REPLAY_SLACK_NS >= target_ns){
+        return;
+    }
+    memset( &its, 0, sizeof( its));
+    its.it_value.tv_sec = target_ns / 1000000000;
+    its.it_value.tv_nsec = target_ns % 1000000000;
+    replay->is_timer_fired = 0;
+    timerfd_settime( replay->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    while( ( replay->is_timer_fired == 0) && ( bench_now_ns() < target_ns)){
+        replay_poll( replay, 1000);
+    }
+}
+
+/**
+ * @fn int main( int argc, char **argv)
+ * @brief server 가 -T 로 남긴 capture 파일을 server 에 다시 보내는 재생 도구
+ * capture 의 연결 id 마다 TCP 연결을 하나씩 맺고, 연결 안에서는 capture 순서대로 보낸다
+ * 속도는 capture 시각 기준 1배 (기본), N배 (-s N), 최대 속도 (-s max) 중에서 고른다
+ * @return int
+ * @param argc 매개변수 개수
+ * @param argv [-s speed|max] [-o result.json] capture_path ip port
+ */
+int main( int argc, char **argv){
+    replay_t replay;
+    struct epoll_event timer_ev;
+    capture_reader_t *reader;
+    const capture_rec_t *rec;
+    const char *json_path = NULL;
+    replay_conn_t *conn;
+    double speed = 1.0;
+    uint64_t frames = 0, sent = 0, skipped = 0, last_ts = 0;
+    uint64_t start, send_end, end, last_reply;
+    double req_per_sec;
+    uint32_t i;
+    int opt, rv = NORMAL;
+
+    while( ( opt = getopt( argc, argv, "s:o:")) != -1){
+        if( opt == 's'){
+            // 0 은 기다리지 않고 최대 속도로 보낸다
+            speed = ( strcmp( optarg, "max") == 0) ? 0 : atof( optarg);
+            if( speed < 0){
+                speed = 1.0;
+            }
+        }
+        else if( opt == 'o'){
+            json_path = optarg;
+        }
+        else{
+            printf("	| ! need param : [-s speed|max] [-o result.json] capture_path ip port\n");
+            return UNKNOWN;
+        }
+    }
+    if( argc - optind != 3){
+        printf("	| ! need param : [-s speed|max] [-o result.json] capture_path ip port\n");
+        return UNKNOWN;
+    }
+
+    signal( SIGPIPE, SIG_IGN);
+    setvbuf( stdout, NULL, _IOLBF, 0);
+    if( ( reader = capture_reader_open( argv[ optind])) == NULL){
+        return UNKNOWN;
+    }
+
+    // 연결 id 범위와 메시지 수를 먼저 센다
+    memset( &replay, 0, sizeof( replay));
+    while( ( rec = capture_reader_next( reader)) != NULL){
+        if( rec->conn_id > replay.conn_max){
+            replay.conn_max = rec->conn_id;
+        }
+        last_ts = rec->ts_ns;
+        frames++;
+    }
+    capture_reader_rewind( reader);
+
+    replay.ip = argv[ optind + 1];
+    replay.port = atoi( argv[ optind + 2]);
+    replay.epoll_fd = epoll_create1( 0);
+    replay.timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK);
+    replay.conns = ( replay_conn_t*)calloc( replay.conn_max + 1, sizeof( replay_conn_t));
+    replay.samples = ( uint64_t*)malloc( sizeof( uint64_t) * REPLAY_SAMPLE_MAX);
+    timer_ev.events = EPOLLIN;
+    timer_ev.data.ptr = NULL;
+    if( ( replay.epoll_fd < 0) || ( replay.timer_fd < 0) || ( replay.conns == NULL) || ( replay.samples == NULL)
+            || ( epoll_ctl( replay.epoll_fd, EPOLL_CTL_ADD, replay.timer_fd, &timer_ev) < 0)){
+        printf("	| ! Replay : Failed to allocate memory\n");
+        capture_reader_close( reader);
+        return UNKNOWN;
+    }
+    for( i = 0; i <= replay.conn_max; i++){
+        replay.conns[ i].fd = -1;
+    }
+
+    start = bench_now_ns();
+    while( ( rec = capture_reader_next( reader)) != NULL){
+        // 전송로 협상 메시지는 UDS 연결에서만 의미가 있다
+        if( ( ( const kmp_hdr_t*)( rec + 1))->code == KMP_CODE_SHM_OPEN){
+            skipped++;
+            continue;
+        }
+        if( speed > 0){
+            replay_wait_until( &replay, start + ( uint64_t)( rec->ts_ns / speed));
+        }
+        // 쉬지 않고 보내는 구간에서도 응답을 제때 읽어야 지연이 부풀지 않는다
+        if( bench_now_ns() - replay.poll_ns > REPLAY_POLL_NS){
+            replay_poll( &replay, 0);
+        }
+        if( ( ( conn = replay_conn_get( &replay, rec->conn_id)) == NULL)
+                || ( replay_send( &replay, conn, ( const char*)( rec + 1), rec->len) < NORMAL)){
+            replay.dropped++;
+            continue;
+        }
+        sent++;
+    }
+    send_end = bench_now_ns();
+
+    // 남은 응답을 기다린다
+    last_reply = send_end;
+    while( ( replay.replies < sent) && replay_has_pending( &replay)
+            && ( bench_now_ns() - last_reply < ( uint64_t)REPLAY_DRAIN_MS * 1000000)){
+        if( replay_poll( &replay, 10) > 0){
+            last_reply = bench_now_ns();
+        }
+    }
+    end = bench_now_ns();
+    rv = ( replay.replies == sent) ? NORMAL : SOC_ERR;
+
+    req_per_sec = ( send_end > start) ? sent * 1e9 / ( send_end - start) : 0;
+    printf("| %-24s | %14s |\n", "replay", "value");
+    printf("| %-24s | %14llu |\n", "frames in capture", ( unsigned long long)frames);
+    printf("| %-24s | %14llu |\n", "sent", ( unsigned long long)sent);
+    printf("| %-24s | %14llu |\n", "replies", ( unsigned long long)replay.replies);
+    printf("| %-24s | %14llu |\n", "dropped / skipped", ( unsigned long long)( replay.dropped + skipped));
+    printf("| %-24s | %14d |\n", "connections", replay.conn_num);
+    printf("| %-24s | %14.1f |\n", "capture span (ms)", last_ts / 1e6);
+    printf("| %-24s | %14.1f |\n", "send span (ms)", ( send_end - start) / 1e6);
+    printf("| %-24s | %14.1f |\n", "total (ms)", ( end - start) / 1e6);
+    printf("| %-24s | %14.0f |\n", "send req/s", req_per_sec);
+    printf("| %-24s | %14.1f |\n", "reply p50 (us)", bench_percentile( replay.samples, replay.sample_num, 50) / 1000.0);
+    printf("| %-24s | %14.1f |\n", "reply p99 (us)", bench_percentile( replay.samples, replay.sample_num, 99) / 1000.0);
+
+    if( ( json_path != NULL) && ( bench_json_open( json_path) == NORMAL)){
+        bench_json_add( "replay.req_per_sec", req_per_sec, "req/s", 0);
+        bench_json_add( "replay.reply_p50", bench_percentile( replay.samples, replay.sample_num, 50) / 1000.0, "us", 1);
+        bench_json_add( "replay.reply_p99", bench_percentile( replay.samples, replay.sample_num, 99) / 1000.0, "us", 1);
+        bench_json_close();
+    }
+
+    for( i = 0; i <= replay.conn_max; i++){
+        if( replay.conns[ i].fd >= 0){
+            close( replay.conns[ i].fd);
+        }
+    }
+    close( replay.timer_fd);
+    close( replay.epoll_fd);
+    free( replay.conns);
+    free( replay.samples);
+    capture_reader_close( reader);
+    if( rv < NORMAL){
+        printf("	| ! Replay : %llu of %llu requests got no reply\n", ( unsigned long long)( sent - replay.replies), ( unsigned long long)sent);
+        return UNKNOWN;
+    }
+    return NORMAL;
+}
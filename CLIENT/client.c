@@ -1,5 +1,5 @@
 #include "client.h"
-#include "kmp.h"
+#include "../COMMON/kmp.h"
 
 static int is_finish = false;
 static int is_error = false;
@@ -49,7 +49,7 @@ static int client_check_fd( int fd){
  * @fn client_t* client_init( char **argv)
  * @brief client 객체를 생성하고 초기화하는 함수
  * @return 생성된 client 객체
- * @param argv 서버의 ip / port 정보
+ * @param argv 서버의 ip / port 정보 (ip 대신 "unix:경로"를 주면 unix domain socket으로 접속)
  */
 client_t* client_init( char **argv){
     int rv;
@@ -60,30 +60,39 @@ client_t* client_init( char **argv){
         return NULL;
     }
 
+    client->is_unix = ( strncmp( argv[1], CLIENT_UNIX_PREFIX, strlen( CLIENT_UNIX_PREFIX)) == 0);
+
     // 소켓 생성 
-    if( ( client->fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP)) == -1){
+    if( ( client->fd = socket( client->is_unix ? AF_UNIX : AF_INET, SOCK_STREAM, 0)) == -1){
         printf("	| ! Client : Failed to open socket\n");
         free( client);
         return NULL;
     }
 
-
-    int addr_len;
-    int server_fd;
-    struct hostent *server_host = gethostbyname( argv[1]);
-
-    if( server_host == NULL){
-        printf("	| ! Client : gethostbyname error ( struct hostent)\n");
-        close( client->fd);
-        free( client);
-        return NULL;
+    if( client->is_unix){
+        // 같은 호스트의 server는 loopback 대신 unix domain socket으로 접속한다
+        const char *path = argv[1] + strlen( CLIENT_UNIX_PREFIX);
+        memset( &client->server_unix_addr, 0, sizeof( client->server_unix_addr));
+        client->server_unix_addr.sun_family = AF_UNIX;
+        strncpy( client->server_unix_addr.sun_path, path, sizeof( client->server_unix_addr.sun_path) - 1);
     }
+    else{
+        int addr_len;
+        struct hostent *server_host = gethostbyname( argv[1]);
+
+        if( server_host == NULL){
+            printf("	| ! Client : gethostbyname error ( struct hostent)\n");
+            close( client->fd);
+            free( client);
+            return NULL;
+        }
 
-    addr_len = sizeof( client->server_addr);
-    memset( &client->server_addr, 0, addr_len);
-    client->server_addr.sin_family = AF_INET;
-    memcpy( &client->server_addr.sin_addr, server_host->h_addr, server_host->h_length);
-    client->server_addr.sin_port = htons( atoi( argv[2]));
+        addr_len = sizeof( client->server_addr);
+        memset( &client->server_addr, 0, addr_len);
+        client->server_addr.sin_family = AF_INET;
+        memcpy( &client->server_addr.sin_addr, server_host->h_addr, server_host->h_length);
+        client->server_addr.sin_port = htons( atoi( argv[2]));
+    }
 
     // 소켓 옵션 설정 
     int reuse = 1;
@@ -169,7 +178,7 @@ int client_process_data( client_t *client){
     while( 1){
         memset( msg, '\0', BUF_MAX_LEN);
         // epoll_wait 시작 
-        event_count = epoll_wait( client->epoll_handle_fd, client->events, BUF_MAX_LEN, TIMEOUT);
+        event_count = epoll_wait( client->epoll_handle_fd, client->events, CLIENT_EVENT_MAX, TIMEOUT);
         if( event_count < 0){
             printf("	| ! Client : epoll_wait error\n");
             break;
@@ -199,7 +208,7 @@ int client_process_data( client_t *client){
                     kmp_t send_msg[ 1];
                     kmp_set_msg( send_msg, 1, send_buf, 1);
                     kmp_print_msg( send_msg);
-                    if( ( send_bytes = write( client->fd, send_msg, sizeof(send_msg))) <= 0){
+                    if( ( send_bytes = write( client->fd, send_msg, kmp_get_msg_length( send_msg))) <= 0){
                         printf("	| ! Client : Failed to send msg (bytes:%d) (errno:%d)\n", send_bytes, errno);
                        break;
                     }
@@ -242,7 +251,7 @@ int client_conn( client_t *client){
 
     int i, rv, event_count = 0;
     while( 1){
-        event_count = epoll_wait( client->epoll_handle_fd, client->events, BUF_MAX_LEN, TIMEOUT);
+        event_count = epoll_wait( client->epoll_handle_fd, client->events, CLIENT_EVENT_MAX, TIMEOUT);
         if( event_count < 0){
             printf("    | ! Client : epoll_wait error\n");
             return -1;
@@ -253,7 +262,12 @@ int client_conn( client_t *client){
 
         for( i = 0; i < event_count; i++){
             if( client->events[ i].data.fd == client->fd){
-                rv = connect( client->fd, ( struct sockaddr*)( &client->server_addr), sizeof( struct sockaddr));
+                if( client->is_unix){
+                    rv = connect( client->fd, ( struct sockaddr*)( &client->server_unix_addr), sizeof( client->server_unix_addr));
+                }
+                else{
+                    rv = connect( client->fd, ( struct sockaddr*)( &client->server_addr), sizeof( struct sockaddr));
+                }
                 if( rv < 0 ){
                     if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK) || ( errno == EINPROGRESS)){
                         printf("    | @ Client : EAGAIN\n");
@@ -297,7 +311,7 @@ int client_conn( client_t *client){
  */
 int main( int argc, char **argv){
     if( argc != 3){
-        printf("	| ! need param : server_ip server_port\n");
+        printf("	| ! need param : server_ip server_port (or unix:path 0)\n");
         return -1;
     }
 
@@ -15,11 +15,16 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
+#include <sys/un.h>
 
 #include "../COMMON/common.h"
 
 #define BUF_MAX_LEN 1024
 #define TIMEOUT 10000
+/// client 가 epoll 에 등록하는 소켓은 하나뿐이므로 한 번에 받는 이벤트도 하나면 된다
+#define CLIENT_EVENT_MAX 1
+/// server 주소가 이 접두사로 시작하면 AF_UNIX 경로로 접속한다
+#define CLIENT_UNIX_PREFIX "unix:"
 
 /// @struct client_t
 /// @brief server로 요청을 보내서 응답을 받기 위한 구조체 
@@ -31,10 +36,14 @@ int fd;
 	struct sockaddr_in addr;
         /// server socket address
         struct sockaddr_in server_addr;
+	/// server unix domain socket address ("unix:" 경로로 접속할 때 사용)
+	struct sockaddr_un server_unix_addr;
+	/// unix domain socket으로 접속하는지 여부
+	int is_unix;
 	/// client epoll handle file descriptor
 	int epoll_handle_fd;
-	/// client epoll event management structure
-	struct epoll_event events[ BUF_MAX_LEN];
+	/// client epoll event management structure (CLIENT_EVENT_MAX 개)
+	struct epoll_event events[ CLIENT_EVENT_MAX];
 };
 
 client_t* client_init();
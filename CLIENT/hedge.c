@@ -0,0 +1,442 @@
+#include "hedge.h"
+
+/**
+ * @fn static uint64_t hedge_now_ns()
+ * @brief monotonic clock 기준 현재 시각을 ns 단위로 구하는 함수
+ * @return 현재 시각 (ns)
+ */
+static uint64_t hedge_now_ns(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @fn static int hedge_cmp_u32( const void *a, const void *b)
+ * @brief qsort 비교 함수
+ */
+static int hedge_cmp_u32( const void *a, const void *b){
+    uint32_t x = *( const uint32_t*)a, y = *( const uint32_t*)b;
+    return ( x > y) - ( x < y);
+}
+
+/**
+ * @fn static int hedge_connect( hedge_t *hedge, hedge_ep_t *ep)
+ * @brief endpoint 에 연결하고 epoll 에 등록하는 함수 (실패하면 HEDGE_RETRY_MS 뒤에 다시 시도한다)
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int hedge_connect( hedge_t *hedge, hedge_ep_t *ep){
+    struct epoll_event ev;
+    int nodelay = 1;
+    int fd;
+
+    ep->retry_ms = hedge_now_ns() / 1000000 + HEDGE_RETRY_MS;
+    if( ( fd = socket( ep->addr.ss_family, SOCK_STREAM, 0)) < 0){
+        return SOC_ERR;
+    }
+    // 같은 호스트 / 가까운 server 를 가정하므로 연결은 blocking 으로 맺는다
+    if( connect( fd, ( struct sockaddr*)&ep->addr, ep->addr_len) < 0){
+        close( fd);
+        return SOC_ERR;
+    }
+    if( ep->addr.ss_family == AF_INET){
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof( nodelay));
+    }
+    fcntl( fd, F_SETFL, fcntl( fd, F_GETFL, 0) | O_NONBLOCK);
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = ep;
+    if( epoll_ctl( hedge->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0){
+        close( fd);
+        return SOC_ERR;
+    }
+    ep->fd = fd;
+    ep->inflight_head = 0;
+    ep->inflight_num = 0;
+    ep->rlen = 0;
+    return NORMAL;
+}
+
+/**
+ * @fn static void hedge_disconnect( hedge_ep_t *ep)
+ * @brief 끊기거나 stream 이 깨진 endpoint 의 연결을 닫는 함수 (기다리던 응답은 모두 버린다)
+ * @return void
+ */
+static void hedge_disconnect( hedge_ep_t *ep){
+    printf("    | ! Hedge : endpoint %s disconnected\n", ep->name);
+    close( ep->fd);
+    ep->fd = -1;
+    ep->inflight_num = 0;
+    ep->rlen = 0;
+    ep->retry_ms = hedge_now_ns() / 1000000 + HEDGE_RETRY_MS;
+}
+
+/**
+ * @fn static void hedge_record( hedge_ep_t *ep, uint32_t usec, uint64_t now)
+ * @brief 응답 지연 표본 하나로 EWMA 와 p95 를 갱신하는 함수
+ * p95 는 HEDGE_P95_EVERY 개마다 최근 HEDGE_WINDOW 개 표본을 정렬해서 구한다
+ * @return void
+ */
+static void hedge_record( hedge_ep_t *ep, uint32_t usec, uint64_t now){
+    uint32_t sorted[ HEDGE_WINDOW];
+
+    ep->last_ns = now;
+    ep->ewma_us = ( ep->sample_num == 0) ? usec : ep->ewma_us + HEDGE_EWMA_ALPHA * ( usec - ep->ewma_us);
+    ep->samples[ ep->sample_pos] = usec;
+    ep->sample_pos = ( ep->sample_pos + 1) % HEDGE_WINDOW;
+    if( ep->sample_num < HEDGE_WINDOW){
+        ep->sample_num++;
+    }
+    if( ep->sample_pos % HEDGE_P95_EVERY == 0){
+        memcpy( sorted, ep->samples, sizeof( uint32_t) * ep->sample_num);
+        qsort( sorted, ep->sample_num, sizeof( uint32_t), hedge_cmp_u32);
+        ep->p95_us = sorted[ ( ep->sample_num * 95 - 1) / 100];
+    }
+}
+
+/**
+ * @fn static double hedge_score( hedge_ep_t *ep, uint64_t now)
+ * @brief endpoint 의 예상 응답 지연을 구하는 함수 (작을수록 먼저 고른다)
+ * 멈춘 endpoint 는 응답이 오지 않아 EWMA 가 갱신되지 않으므로 가장 오래 기다린 요청의 경과 시간을 같이 본다
+ * 고르지 않아서 표본이 없는 동안에는 EWMA 가 HEDGE_DECAY_MS 에 걸쳐 줄어들어 다시 시험된다 (표본이 없는 endpoint 는 0)
+ * @return 예상 응답 지연 (us), 보낼 수 없으면 음수
+ */
+static double hedge_score( hedge_ep_t *ep, uint64_t now){
+    double score, age_us;
+
+    if( ( ep->fd < 0) || ( ep->inflight_num == HEDGE_INFLIGHT_MAX)){
+        return -1;
+    }
+    score = ep->ewma_us * HEDGE_DECAY_MS / ( HEDGE_DECAY_MS + ( now - ep->last_ns) / 1000000.0);
+    if( ep->inflight_num > 0){
+        age_us = ( now - ep->inflight_ns[ ep->inflight_head]) / 1000.0;
+        if( age_us > score){
+            return age_us;
+        }
+    }
+    return score;
+}
+
+/**
+ * @fn static hedge_ep_t* hedge_pick( hedge_t *hedge, hedge_ep_t *exclude)
+ * @brief 예상 응답 지연이 가장 작은 endpoint 를 고르는 함수 (끊긴 endpoint 는 재시도 시각이 지났으면 다시 연결한다)
+ * @return 고른 endpoint, 보낼 수 있는 endpoint 가 없으면 NULL
+ * @param exclude 제외할 endpoint (없으면 NULL)
+ */
+static hedge_ep_t* hedge_pick( hedge_t *hedge, hedge_ep_t *exclude){
+    uint64_t now = hedge_now_ns();
+    hedge_ep_t *best = NULL, *ep;
+    double best_score = 0, score;
+    int i;
+
+    for( i = 0; i < hedge->ep_num; i++){
+        ep = &hedge->eps[ i];
+        if( ep == exclude){
+            continue;
+        }
+        if( ( ep->fd < 0) && ( now / 1000000 >= ep->retry_ms)){
+            hedge_connect( hedge, ep);
+        }
+        if( ( score = hedge_score( ep, now)) < 0){
+            continue;
+        }
+        if( ( best == NULL) || ( score < best_score)){
+            best = ep;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+/**
+ * @fn static int hedge_send( hedge_ep_t *ep, const char *frame, int len)
+ * @brief endpoint 로 요청을 보내고 응답 대기 FIFO 에 넣는 함수
+ * 요청은 소켓 송신 버퍼보다 훨씬 작으므로 다 보내지 못하면 stream 이 깨진 것으로 보고 연결을 닫는다
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int hedge_send( hedge_ep_t *ep, const char *frame, int len){
+    int tail;
+
+    if( write( ep->fd, frame, len) != len){
+        hedge_disconnect( ep);
+        return SOC_ERR;
+    }
+    tail = ( ep->inflight_head + ep->inflight_num) % HEDGE_INFLIGHT_MAX;
+    ep->inflight_ns[ tail] = hedge_now_ns();
+    ep->inflight_num++;
+    ep->sent++;
+    return NORMAL;
+}
+
+/**
+ * @fn static int hedge_read( hedge_ep_t *ep, uint32_t hop_id, char *reply, int cap)
+ * @brief endpoint 에서 도착한 응답을 모두 읽어 지연 통계를 갱신하는 함수
+ * hop_id 가 지금 요청과 같은 응답만 reply 에 복사하고, 이미 다른 endpoint 가 답한 이전 요청의 응답은 버린다
+ * @return 지금 요청의 응답 길이, 없으면 0, 연결이 끊겼으면 SOC_ERR
+ */
+static int hedge_read( hedge_ep_t *ep, uint32_t hop_id, char *reply, int cap){
+    uint64_t now;
+    uint32_t flen;
+    int n, found = 0;
+
+    while( 1){
+        if( ( n = read( ep->fd, &ep->rbuf[ ep->rlen], sizeof( ep->rbuf) - ep->rlen)) <= 0){
+            if( ( n < 0) && ( ( errno == EAGAIN) || ( errno == EWOULDBLOCK))){
+                break;
+            }
+            hedge_disconnect( ep);
+            return SOC_ERR;
+        }
+        ep->rlen += n;
+
+        now = hedge_now_ns();
+        while( ep->rlen >= ( int)sizeof( kmp_hdr_t)){
+            flen = ( ( kmp_hdr_t*)ep->rbuf)->length;
+            if( ( flen < sizeof( kmp_hdr_t)) || ( flen > sizeof( ep->rbuf)) || ( ep->inflight_num == 0)){
+                hedge_disconnect( ep);
+                return SOC_ERR;
+            }
+            if( ( uint32_t)ep->rlen < flen){
+                break;
+            }
+
+            hedge_record( ep, ( uint32_t)( ( now - ep->inflight_ns[ ep->inflight_head]) / 1000), now);
+            ep->inflight_head = ( ep->inflight_head + 1) % HEDGE_INFLIGHT_MAX;
+            ep->inflight_num--;
+            if( ( found == 0) && ( ( ( kmp_hdr_t*)ep->rbuf)->hop_id == hop_id) && ( ( int)flen <= cap)){
+                memcpy( reply, ep->rbuf, flen);
+                found = flen;
+                ep->won++;
+            }
+            else{
+                ep->dropped++;
+            }
+            ep->rlen -= flen;
+            memmove( ep->rbuf, &ep->rbuf[ flen], ep->rlen);
+        }
+    }
+    return found;
+}
+
+/**
+ * @fn static void hedge_arm( hedge_t *hedge, uint64_t at_ns)
+ * @brief at_ns (monotonic) 에 timerfd 가 울리도록 거는 함수
+ * @return void
+ */
+static void hedge_arm( hedge_t *hedge, uint64_t at_ns){
+    struct itimerspec its;
+
+    memset( &its, 0, sizeof( its));
+    its.it_value.tv_sec = at_ns / 1000000000;
+    its.it_value.tv_nsec = at_ns % 1000000000;
+    timerfd_settime( hedge->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/**
+ * @fn hedge_t* hedge_init( double budget_ratio)
+ * @brief hedging client 객체를 생성하는 함수
+ * @return 생성된 객체, 실패하면 NULL
+ * @param budget_ratio 요청 대비 hedge 로 더 보낼 수 있는 비율 (예: 0.05 이면 요청 100 개당 hedge 5 개, 0 이면 hedge 하지 않는다)
+ */
+hedge_t* hedge_init( double budget_ratio){
+    hedge_t *hedge = ( hedge_t*)calloc( 1, sizeof( hedge_t));
+    struct epoll_event ev;
+
+    if( hedge == NULL){
+        printf("    | ! Hedge : Failed to allocate memory\n");
+        return NULL;
+    }
+    hedge->budget_ratio = budget_ratio;
+    hedge->epoll_fd = epoll_create1( 0);
+    hedge->timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if( ( hedge->epoll_fd < 0) || ( hedge->timer_fd < 0) || ( epoll_ctl( hedge->epoll_fd, EPOLL_CTL_ADD, hedge->timer_fd, &ev) < 0)){
+        printf("    | ! Hedge : Failed to create epoll / timer\n");
+        hedge_destroy( hedge);
+        return NULL;
+    }
+    return hedge;
+}
+
+/**
+ * @fn void hedge_destroy( hedge_t *hedge)
+ * @brief hedging client 객체를 해제하는 함수
+ * @return void
+ * @param hedge hedging client (NULL 이면 아무 것도 하지 않는다)
+ */
+void hedge_destroy( hedge_t *hedge){
+    int i;
+
+    if( hedge == NULL){
+        return;
+    }
+    for( i = 0; i < hedge->ep_num; i++){
+        if( hedge->eps[ i].fd >= 0){
+            close( hedge->eps[ i].fd);
+        }
+    }
+    if( hedge->timer_fd >= 0){
+        close( hedge->timer_fd);
+    }
+    if( hedge->epoll_fd >= 0){
+        close( hedge->epoll_fd);
+    }
+    free( hedge);
+}
+
+/**
+ * @fn int hedge_add_endpoint( hedge_t *hedge, const char *host, int port)
+ * @brief server endpoint 를 추가하고 연결하는 함수 (지금 연결하지 못해도 나중에 다시 시도한다)
+ * @return 정상이면 NORMAL, 주소가 잘못되었거나 자리가 없으면 열거형 참고
+ * @param hedge hedging client
+ * @param host server 호스트 이름 / ip (또는 "unix:경로")
+ * @param port server port (unix 경로면 무시)
+ */
+int hedge_add_endpoint( hedge_t *hedge, const char *host, int port){
+    hedge_ep_t *ep;
+    struct hostent *server_host;
+    struct sockaddr_in *in;
+    struct sockaddr_un *un;
+
+    if( hedge->ep_num == HEDGE_ENDPOINT_MAX){
+        printf("    | ! Hedge : too many endpoints (max %d)\n", HEDGE_ENDPOINT_MAX);
+        return BUF_ERR;
+    }
+    ep = &hedge->eps[ hedge->ep_num];
+    memset( ep, 0, sizeof( hedge_ep_t));
+    ep->fd = -1;
+
+    if( strncmp( host, HEDGE_UNIX_PREFIX, strlen( HEDGE_UNIX_PREFIX)) == 0){
+        un = ( struct sockaddr_un*)&ep->addr;
+        un->sun_family = AF_UNIX;
+        strncpy( un->sun_path, host + strlen( HEDGE_UNIX_PREFIX), sizeof( un->sun_path) - 1);
+        ep->addr_len = sizeof( struct sockaddr_un);
+        snprintf( ep->name, sizeof( ep->name), "%s", host);
+    }
+    else{
+        if( ( server_host = gethostbyname( host)) == NULL){
+            printf("    | ! Hedge : gethostbyname error (%s)\n", host);
+            return HOST_ERR;
+        }
+        in = ( struct sockaddr_in*)&ep->addr;
+        in->sin_family = AF_INET;
+        memcpy( &in->sin_addr, server_host->h_addr, server_host->h_length);
+        in->sin_port = htons( port);
+        ep->addr_len = sizeof( struct sockaddr_in);
+        snprintf( ep->name, sizeof( ep->name), "%s:%d", host, port);
+    }
+    hedge->ep_num++;
+
+    if( hedge_connect( hedge, ep) < NORMAL){
+        printf("    | ! Hedge : Failed to connect to %s (retry later)\n", ep->name);
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int hedge_request( hedge_t *hedge, char *frame, int len, char *reply, int cap, int timeout_ms)
+ * @brief 요청 하나를 보내고 가장 먼저 도착한 응답을 받는 함수
+ * 예상 응답 지연이 가장 작은 endpoint 로 보내고, 그 endpoint 의 p95 안에 응답이 없으면 두 번째 endpoint 로 한 번 더 보낸다
+ * hedge 는 budget 이 있을 때만 보내므로 추가 부하는 요청의 budget_ratio 배를 넘지 않는다 (연결이 끊겨서 다시 보내는 것은 제외)
+ * 두 응답은 같은 hop_id 를 가지며 늦게 온 응답은 다음 요청을 기다리는 동안 버려진다
+ * is_deadline 이 켜져 있으면 지금 + timeout_ms 를 deadline extension 으로 붙인 복사본을 보낸다 (hedge 도 같은 deadline 이다)
+ * 자리가 없거나 이미 CRC32C trailer 가 붙은 메시지는 그대로 보낸다. server 가 deadline 이 지나서 버린 요청의 응답 코드는 KMP_CODE_EXPIRED 다
+ * @return 응답 길이, timeout 이면 INTERRUPT, 보낼 endpoint 가 없으면 SOC_ERR
+ * @param hedge hedging client
+ * @param frame 보낼 kmp 메시지 (헤더의 hop_id 를 덮어쓴다)
+ * @param len 메시지 길이
+ * @param reply 응답을 저장할 버퍼
+ * @param cap 버퍼 크기
+ * @param timeout_ms 응답을 기다리는 최대 시간 (ms)
+ */
+int hedge_request( hedge_t *hedge, char *frame, int len, char *reply, int cap, int timeout_ms){
+    struct epoll_event events[ HEDGE_ENDPOINT_MAX + 1];
+    char deadline_frame[ sizeof( kmp_t)];
+    hedge_ep_t *primary, *secondary = NULL, *ep;
+    uint64_t now, hedge_at, deadline;
+    uint32_t hop_id, delay_us;
+    uint64_t expired;
+    int i, n, rv, is_hedged = 0;
+
+    if( ( hop_id = ++hedge->hop_seq) == 0){
+        hop_id = ++hedge->hop_seq;
+    }
+    ( ( kmp_hdr_t*)frame)->hop_id = hop_id;
+    if( hedge->is_deadline && ( timeout_ms > 0) && ( len <= ( int)sizeof( deadline_frame))){
+        memcpy( deadline_frame, frame, len);
+        if( ( rv = kmp_set_deadline( deadline_frame, len, sizeof( deadline_frame), kmp_now_us() + ( uint64_t)timeout_ms * 1000)) > 0){
+            frame = deadline_frame;
+            len = rv;
+        }
+    }
+    hedge->requests++;
+    if( ( hedge->budget += hedge->budget_ratio) > HEDGE_BUDGET_BURST){
+        hedge->budget = HEDGE_BUDGET_BURST;
+    }
+
+    while( 1){
+        if( ( primary = hedge_pick( hedge, NULL)) == NULL){
+            return SOC_ERR;
+        }
+        if( hedge_send( primary, frame, len) == NORMAL){
+            break;
+        }
+    }
+    now = hedge_now_ns();
+    delay_us = ( primary->sample_num >= HEDGE_P95_EVERY) ? primary->p95_us : HEDGE_DELAY_INIT_US;
+    hedge_at = now + ( uint64_t)( ( delay_us > HEDGE_DELAY_MIN_US) ? delay_us : HEDGE_DELAY_MIN_US) * 1000;
+    deadline = now + ( uint64_t)timeout_ms * 1000000;
+    if( ( hedge->budget_ratio <= 0) || ( hedge->ep_num < 2)){
+        is_hedged = 1;
+    }
+    hedge_arm( hedge, ( is_hedged || ( hedge_at > deadline)) ? deadline : hedge_at);
+
+    while( 1){
+        n = epoll_wait( hedge->epoll_fd, events, HEDGE_ENDPOINT_MAX + 1, timeout_ms);
+        if( ( n < 0) && ( errno != EINTR)){
+            return SOC_ERR;
+        }
+        for( i = 0; i < n; i++){
+            if( ( ep = ( hedge_ep_t*)events[ i].data.ptr) == NULL){
+                read( hedge->timer_fd, &expired, sizeof( expired));
+                continue;
+            }
+            if( ep->fd < 0){
+                continue;
+            }
+            if( ( rv = hedge_read( ep, hop_id, reply, cap)) > 0){
+                if( ep == secondary){
+                    hedge->hedges_won++;
+                }
+                return rv;
+            }
+            if( ( rv < 0) && ( primary->fd < 0) && ( ( secondary == NULL) || ( secondary->fd < 0))){
+                // 보낸 곳이 모두 끊겼으면 budget 과 상관없이 다른 endpoint 로 다시 보낸다
+                if( ( ( primary = hedge_pick( hedge, NULL)) == NULL) || ( hedge_send( primary, frame, len) < NORMAL)){
+                    return SOC_ERR;
+                }
+                secondary = NULL;
+            }
+        }
+
+        now = hedge_now_ns();
+        if( now >= deadline){
+            return INTERRUPT;
+        }
+        if( ( is_hedged == 0) && ( now >= hedge_at)){
+            is_hedged = 1;
+            if( hedge->budget < 1){
+                hedge->hedges_denied++;
+            }
+            else if( ( ( secondary = hedge_pick( hedge, primary)) != NULL) && ( hedge_send( secondary, frame, len) == NORMAL)){
+                hedge->budget -= 1;
+                hedge->hedges++;
+            }
+            else{
+                secondary = NULL;
+            }
+            hedge_arm( hedge, deadline);
+        }
+    }
+}
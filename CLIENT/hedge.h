@@ -0,0 +1,116 @@
+#pragma once
+#ifndef __HEDGE_H__
+#define __HEDGE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+
+/// 등록할 수 있는 최대 server endpoint 수
+#define HEDGE_ENDPOINT_MAX 8
+/// endpoint 하나에 응답을 기다리는 최대 요청 수 (hedge 로 버려진 요청 포함)
+#define HEDGE_INFLIGHT_MAX 64
+/// p95 를 구하는 최근 응답 지연 표본 수
+#define HEDGE_WINDOW 128
+/// p95 를 다시 구하는 표본 간격
+#define HEDGE_P95_EVERY 16
+/// 지연 EWMA 의 새 표본 가중치
+#define HEDGE_EWMA_ALPHA 0.2
+/// 표본이 없는 동안 EWMA 를 줄이는 시간 상수 (ms). 한 번 느렸던 endpoint 도 시간이 지나면 다시 시험된다
+#define HEDGE_DECAY_MS 100
+/// 표본이 모이기 전 hedge 대기 시간 / 대기 시간 하한 (us)
+#define HEDGE_DELAY_INIT_US 10000
+#define HEDGE_DELAY_MIN_US 50
+/// hedge budget 이 쌓일 수 있는 최대 요청 수 (순간적으로 허용하는 hedge 수)
+#define HEDGE_BUDGET_BURST 10
+/// 끊긴 endpoint 에 다시 연결을 시도하는 간격 (ms)
+#define HEDGE_RETRY_MS 1000
+/// server 주소가 이 접두사로 시작하면 AF_UNIX 경로로 접속한다
+#define HEDGE_UNIX_PREFIX "unix:"
+
+/// @struct hedge_ep_t
+/// @brief server endpoint 하나의 연결과 응답 지연 통계
+/// 연결 하나에서 server 는 요청을 받은 순서대로 응답하므로 보낸 시각은 FIFO 로 충분하다
+typedef struct hedge_ep_s hedge_ep_t;
+struct hedge_ep_s{
+    /// endpoint 에 연결된 소켓 (끊겼으면 -1)
+    int fd;
+    /// 접속 주소
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    /// 표시용 주소 문자열
+    char name[ 64];
+    /// 다음 연결 시도 시각 (ms)
+    uint64_t retry_ms;
+    /// 응답을 기다리는 요청의 보낸 시각 (ns, FIFO)
+    uint64_t inflight_ns[ HEDGE_INFLIGHT_MAX];
+    int inflight_head;
+    int inflight_num;
+    /// 다 받지 못한 응답 메시지
+    char rbuf[ sizeof( kmp_t)];
+    int rlen;
+    /// 응답 지연 EWMA (us, 표본이 없으면 0)
+    double ewma_us;
+    /// 마지막 표본 시각 (ns)
+    uint64_t last_ns;
+    /// 최근 응답 지연 표본 (us, ring)
+    uint32_t samples[ HEDGE_WINDOW];
+    int sample_num;
+    int sample_pos;
+    /// 최근 표본의 p95 (us, 표본이 없으면 0)
+    uint32_t p95_us;
+    /// 보낸 요청 수 / 먼저 도착해서 쓰인 응답 수 / 늦게 도착해서 버린 응답 수
+    uint64_t sent;
+    uint64_t won;
+    uint64_t dropped;
+};
+
+/// @struct hedge_t
+/// @brief 여러 server endpoint 중 가장 빠른 곳으로 요청을 보내고, p95 안에 응답이 없으면 두 번째 endpoint 로 한 번 더 보내는 client
+typedef struct hedge_s hedge_t;
+struct hedge_s{
+    /// endpoint 목록
+    hedge_ep_t eps[ HEDGE_ENDPOINT_MAX];
+    int ep_num;
+    /// 응답 / hedge timer 를 기다리는 epoll 인스턴스
+    int epoll_fd;
+    /// hedge 를 보낼 시각에 깨우는 timerfd (us 단위 대기)
+    int timer_fd;
+    /// 요청 하나가 쌓는 hedge budget (0 이면 hedge 하지 않는다)
+    double budget_ratio;
+    /// 남은 hedge budget (1 이상이면 hedge 를 보낼 수 있다)
+    double budget;
+    /// 요청에 timeout_ms 를 deadline extension (KMP_FLAG_DEADLINE) 으로 실어 보낼지 여부 (기본 0)
+    /// 켜면 server 는 timeout 이 지난 요청을 처리하지 않고 KMP_CODE_EXPIRED 로 답한다
+    int is_deadline;
+    /// 마지막으로 발급한 hop_id
+    uint32_t hop_seq;
+    /// 보낸 요청 수 / 보낸 hedge 수 / budget 이 없어서 보내지 못한 hedge 수 / hedge 가 먼저 응답한 수
+    uint64_t requests;
+    uint64_t hedges;
+    uint64_t hedges_denied;
+    uint64_t hedges_won;
+};
+
+hedge_t* hedge_init( double budget_ratio);
+void hedge_destroy( hedge_t *hedge);
+int hedge_add_endpoint( hedge_t *hedge, const char *host, int port);
+int hedge_request( hedge_t *hedge, char *frame, int len, char *reply, int cap, int timeout_ms);
+
+#endif
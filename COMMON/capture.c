@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+#include "capture.h"
+
+/**
+ * @fn uint64_t capture_now_ns()
+ * @brief monotonic clock 기준 현재 시각을 ns 단위로 구하는 함수
+ * @return 현재 시각 (ns)
+ */
+uint64_t capture_now_ns(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @fn static int capture_grow( capture_t *cap, size_t need)
+ * @brief 파일과 mmap 영역을 need bytes 이상 쓸 수 있게 CAPTURE_GROW_LEN 단위로 늘리는 함수
+ * @return 정상이면 NORMAL, 실패하면 OBJECT_ERR
+ * @param cap capture 객체
+ * @param need 더 써야 하는 크기
+ */
+static int capture_grow( capture_t *cap, size_t need){
+    size_t new_len = cap->map_len;
+    char *map;
+
+    while( new_len < cap->off + need){
+        new_len += CAPTURE_GROW_LEN;
+    }
+    // sparse 로 늘리면 disk 가 찼을 때 mmap 쓰기가 SIGBUS 로 죽으므로 block 을 미리 잡는다
+    if( ( errno = posix_fallocate( cap->fd, cap->map_len, new_len - cap->map_len)) != 0){
+        printf("    | ! Capture : Failed to grow file (errno:%d)\n", errno);
+        return OBJECT_ERR;
+    }
+    if( cap->map == NULL){
+        map = ( char*)mmap( NULL, new_len, PROT_READ | PROT_WRITE, MAP_SHARED, cap->fd, 0);
+    }
+    else{
+        map = ( char*)mremap( cap->map, cap->map_len, new_len, MREMAP_MAYMOVE);
+    }
+    if( map == MAP_FAILED){
+        printf("    | ! Capture : Failed to map file (errno:%d)\n", errno);
+        return OBJECT_ERR;
+    }
+    cap->map = map;
+    cap->map_len = new_len;
+    return NORMAL;
+}
+
+/**
+ * @fn capture_t* capture_open( const char *path)
+ * @brief capture 파일을 새로 만들고 파일 헤더를 쓰는 함수 (같은 이름의 파일은 덮어쓴다)
+ * @return 생성된 객체, 실패하면 NULL
+ * @param path capture 파일 경로
+ */
+capture_t* capture_open( const char *path){
+    capture_t *cap = ( capture_t*)calloc( 1, sizeof( capture_t));
+    capture_file_hdr_t *hdr;
+    struct timespec ts;
+
+    if( cap == NULL){
+        printf("    | ! Capture : Failed to allocate memory\n");
+        return NULL;
+    }
+    if( ( cap->fd = open( path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0){
+        printf("    | ! Capture : Failed to open %s (errno:%d)\n", path, errno);
+        free( cap);
+        return NULL;
+    }
+    if( capture_grow( cap, sizeof( capture_file_hdr_t)) < NORMAL){
+        close( cap->fd);
+        free( cap);
+        return NULL;
+    }
+
+    clock_gettime( CLOCK_REALTIME, &ts);
+    hdr = ( capture_file_hdr_t*)cap->map;
+    memcpy( hdr->magic, CAPTURE_MAGIC, sizeof( hdr->magic));
+    hdr->version = CAPTURE_VERSION;
+    hdr->hdr_len = sizeof( capture_file_hdr_t);
+    hdr->start_ns = ( uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    cap->off = sizeof( capture_file_hdr_t);
+    cap->start_ns = capture_now_ns();
+    return cap;
+}
+
+/**
+ * @fn void capture_close( capture_t *cap)
+ * @brief 파일을 쓴 크기로 줄이고 닫는 함수
+ * @return void
+ * @param cap capture 객체 (NULL 이면 아무 것도 하지 않는다)
+ */
+void capture_close( capture_t *cap){
+    if( cap == NULL){
+        return;
+    }
+    if( cap->map != NULL){
+        munmap( cap->map, cap->map_len);
+        if( ftruncate( cap->fd, cap->off) < 0){
+            printf("    | ! Capture : Failed to truncate file (errno:%d)\n", errno);
+        }
+    }
+    close( cap->fd);
+    free( cap);
+}
+
+/**
+ * @fn int capture_record( capture_t *cap, uint32_t conn_id, const void *hdr, uint32_t hdr_len, const void *body, uint32_t body_len)
+ * @brief 받은 메시지 하나를 capture 파일 끝에 붙이는 함수
+ * 헤더와 바디가 따로 있는 버퍼(transc_buf_t)에서 바로 복사하도록 두 부분으로 받는다
+ * record 헤더는 메시지를 다 복사한 뒤에 len 을 마지막으로 써서, 읽는 쪽이 반쯤 쓰인 record 를 보지 않게 한다
+ * @return 정상이면 NORMAL, 파일을 늘리지 못했으면 OBJECT_ERR (이후 기록은 모두 버린다)
+ * @param cap capture 객체
+ * @param conn_id 메시지를 받은 연결의 id
+ * @param hdr 메시지 헤더
+ * @param hdr_len 헤더 길이
+ * @param body 메시지 바디
+ * @param body_len 바디 길이
+ */
+int capture_record( capture_t *cap, uint32_t conn_id, const void *hdr, uint32_t hdr_len, const void *body, uint32_t body_len){
+    uint32_t len = hdr_len + body_len;
+    size_t rec_len = ( sizeof( capture_rec_t) + len + CAPTURE_ALIGN - 1) & ~( ( size_t)CAPTURE_ALIGN - 1);
+    capture_rec_t *rec;
+    char *data;
+
+    if( cap->is_failed){
+        return OBJECT_ERR;
+    }
+    // 끝 표시(len 0 인 record 헤더)가 들어갈 자리를 남긴다
+    if( ( cap->off + rec_len + sizeof( capture_rec_t) > cap->map_len)
+            && ( capture_grow( cap, rec_len + sizeof( capture_rec_t)) < NORMAL)){
+        cap->is_failed = 1;
+        return OBJECT_ERR;
+    }
+
+    rec = ( capture_rec_t*)&cap->map[ cap->off];
+    data = ( char*)( rec + 1);
+    memcpy( data, hdr, hdr_len);
+    memcpy( &data[ hdr_len], body, body_len);
+    rec->ts_ns = capture_now_ns() - cap->start_ns;
+    rec->conn_id = conn_id;
+    __atomic_store_n( &rec->len, len, __ATOMIC_RELEASE);
+
+    cap->off += rec_len;
+    cap->frames++;
+    cap->bytes += len;
+    return NORMAL;
+}
+
+/**
+ * @fn capture_reader_t* capture_reader_open( const char *path)
+ * @brief capture 파일을 읽기 전용으로 mmap 하고 파일 헤더를 확인하는 함수
+ * @return 생성된 reader, 실패하면 NULL
+ * @param path capture 파일 경로
+ */
+capture_reader_t* capture_reader_open( const char *path){
+    capture_reader_t *reader = ( capture_reader_t*)calloc( 1, sizeof( capture_reader_t));
+    struct stat st;
+
+    if( reader == NULL){
+        printf("    | ! Capture : Failed to allocate memory\n");
+        return NULL;
+    }
+    if( ( reader->fd = open( path, O_RDONLY)) < 0){
+        printf("    | ! Capture : Failed to open %s (errno:%d)\n", path, errno);
+        free( reader);
+        return NULL;
+    }
+    if( ( fstat( reader->fd, &st) < 0) || ( ( size_t)st.st_size < sizeof( capture_file_hdr_t))){
+        printf("    | ! Capture : %s is not a capture file\n", path);
+        close( reader->fd);
+        free( reader);
+        return NULL;
+    }
+    reader->map_len = st.st_size;
+    if( ( reader->map = ( const char*)mmap( NULL, reader->map_len, PROT_READ, MAP_SHARED, reader->fd, 0)) == MAP_FAILED){
+        printf("    | ! Capture : Failed to map %s (errno:%d)\n", path, errno);
+        close( reader->fd);
+        free( reader);
+        return NULL;
+    }
+    // 앞에서부터 한 번만 읽는다
+    madvise( ( void*)reader->map, reader->map_len, MADV_SEQUENTIAL);
+
+    reader->hdr = ( const capture_file_hdr_t*)reader->map;
+    if( ( memcmp( reader->hdr->magic, CAPTURE_MAGIC, sizeof( reader->hdr->magic)) != 0)
+            || ( reader->hdr->version != CAPTURE_VERSION) || ( reader->hdr->hdr_len > reader->map_len)){
+        printf("    | ! Capture : %s is not a capture file (version %u)\n", path, reader->hdr->version);
+        capture_reader_close( reader);
+        return NULL;
+    }
+    reader->off = reader->hdr->hdr_len;
+    return reader;
+}
+
+/**
+ * @fn void capture_reader_close( capture_reader_t *reader)
+ * @brief reader 를 닫는 함수
+ * @return void
+ * @param reader capture reader (NULL 이면 아무 것도 하지 않는다)
+ */
+void capture_reader_close( capture_reader_t *reader){
+    if( reader == NULL){
+        return;
+    }
+    munmap( ( void*)reader->map, reader->map_len);
+    close( reader->fd);
+    free( reader);
+}
+
+/**
+ * @fn const capture_rec_t* capture_reader_next( capture_reader_t *reader)
+ * @brief 다음 record 를 돌려주는 함수 (메시지는 record 바로 뒤에 있다)
+ * @return record, 파일 끝이거나 잘린 record 면 NULL
+ * @param reader capture reader
+ */
+const capture_rec_t* capture_reader_next( capture_reader_t *reader){
+    const capture_rec_t *rec;
+    size_t rec_len;
+
+    if( reader->off + sizeof( capture_rec_t) > reader->map_len){
+        return NULL;
+    }
+    rec = ( const capture_rec_t*)&reader->map[ reader->off];
+    rec_len = ( sizeof( capture_rec_t) + rec->len + CAPTURE_ALIGN - 1) & ~( ( size_t)CAPTURE_ALIGN - 1);
+    if( ( rec->len == 0) || ( reader->off + rec_len > reader->map_len)){
+        return NULL;
+    }
+    reader->off += rec_len;
+    return rec;
+}
+
+/**
+ * @fn void capture_reader_rewind( capture_reader_t *reader)
+ * @brief 첫 record 부터 다시 읽도록 되돌리는 함수
+ * @return void
+ * @param reader capture reader
+ */
+void capture_reader_rewind( capture_reader_t *reader){
+    reader->off = reader->hdr->hdr_len;
+}
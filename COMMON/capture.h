@@ -0,0 +1,103 @@
+#pragma once
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common.h"
+
+/// capture 파일 맨 앞의 식별 문자열 (8 bytes)
+#define CAPTURE_MAGIC "KMPCAP01"
+#define CAPTURE_VERSION 1
+/// 파일과 mmap 영역을 한 번에 늘리는 크기
+#define CAPTURE_GROW_LEN ( 64 << 20)
+/// record 시작 위치 정렬 단위
+#define CAPTURE_ALIGN 8
+
+/// @struct capture_file_hdr_t
+/// @brief capture 파일 헤더 (32 bytes)
+typedef struct capture_file_hdr_s capture_file_hdr_t;
+struct capture_file_hdr_s{
+    /// CAPTURE_MAGIC
+    char magic[ 8];
+    /// 파일 형식 버전
+    uint32_t version;
+    /// 이 헤더의 크기 (첫 record 위치)
+    uint32_t hdr_len;
+    /// capture 를 시작한 시각 (CLOCK_REALTIME, ns)
+    uint64_t start_ns;
+    uint64_t reserved;
+};
+
+/// @struct capture_rec_t
+/// @brief 받은 kmp 메시지 하나의 record (16 bytes). 바로 뒤에 메시지(헤더 + 바디)가 오고 CAPTURE_ALIGN 으로 채운다
+/// 쓰지 않은 영역은 0 이므로 len 이 0 인 record 가 끝이다 (정상 종료 없이 프로세스가 죽은 파일도 읽을 수 있다)
+typedef struct capture_rec_s capture_rec_t;
+struct capture_rec_s{
+    /// capture 시작부터 메시지를 다 받을 때까지 걸린 시간 (CLOCK_MONOTONIC, ns)
+    uint64_t ts_ns;
+    /// 메시지를 받은 연결의 id (server 안에서 연결마다 다르다)
+    uint32_t conn_id;
+    /// 메시지 길이 (헤더 + 바디)
+    uint32_t len;
+};
+
+/// @struct capture_t
+/// @brief 받은 메시지를 append-only 로 기록하는 mmap 된 capture 파일
+typedef struct capture_s capture_t;
+struct capture_s{
+    /// capture 파일
+    int fd;
+    /// mmap 시작 주소
+    char *map;
+    /// mmap 된 크기 (= 파일 크기)
+    size_t map_len;
+    /// 다음 record 를 쓸 위치
+    size_t off;
+    /// capture 시작 시각 (CLOCK_MONOTONIC, ns)
+    uint64_t start_ns;
+    /// 파일을 늘리지 못해서 더 이상 기록하지 않는지 여부
+    int is_failed;
+    /// 기록한 메시지 수
+    uint64_t frames;
+    /// 기록한 메시지 bytes
+    uint64_t bytes;
+};
+
+/// @struct capture_reader_t
+/// @brief capture 파일을 처음부터 순서대로 읽는 reader
+typedef struct capture_reader_s capture_reader_t;
+struct capture_reader_s{
+    /// capture 파일
+    int fd;
+    /// mmap 시작 주소 (읽기 전용)
+    const char *map;
+    /// 파일 크기
+    size_t map_len;
+    /// 다음 record 위치
+    size_t off;
+    /// 파일 헤더
+    const capture_file_hdr_t *hdr;
+};
+
+uint64_t capture_now_ns();
+capture_t* capture_open( const char *path);
+void capture_close( capture_t *cap);
+int capture_record( capture_t *cap, uint32_t conn_id, const void *hdr, uint32_t hdr_len, const void *body, uint32_t body_len);
+
+capture_reader_t* capture_reader_open( const char *path);
+void capture_reader_close( capture_reader_t *reader);
+const capture_rec_t* capture_reader_next( capture_reader_t *reader);
+void capture_reader_rewind( capture_reader_t *reader);
+
+#endif
@@ -7,6 +7,13 @@
 #include <stdlib.h>
 #include <errno.h>
 
+/// 메시지마다 찍히는 로그는 KMP_QUIET로 빌드하면 제거된다 (벤치마크용)
+#ifdef KMP_QUIET
+#define TRACE_PRINT(...) do{ }while( 0)
+#else
+#define TRACE_PRINT(...) printf( __VA_ARGS__)
+#endif
+
 enum ERROR{
 	RECV_COMPLETE = 3,
 	NOT_RECV = 2,
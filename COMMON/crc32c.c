@@ -0,0 +1,327 @@
+#include "crc32c.h"
+
+#if defined( __x86_64__)
+#include <nmmintrin.h>
+#endif
+
+/// CRC32C (Castagnoli) 다항식 (bit 순서를 뒤집은 값)
+#define CRC32C_POLY 0x82F63B78
+
+/// @brief 앞뒤 반전 없이 crc 상태를 바이트 만큼 진행하는 함수
+typedef uint32_t ( *crc32c_raw_fn)( uint32_t crc, const unsigned char *p, size_t len);
+
+/// slicing-by-8 table (table[ k][ b] 는 바이트 b 뒤에 0 바이트가 k 개 있을 때의 crc)
+static uint32_t crc32c_table[ 8][ 256];
+/// CRC32C_BLOCK 개의 0 바이트만큼 crc 상태를 미는 table (바이트 자리마다 하나)
+static uint32_t crc32c_shift_table[ 4][ 256];
+/// 이 CPU 에서 쓰는 구현
+static crc32c_raw_fn crc32c_raw;
+
+/**
+ * @fn static uint32_t crc32c_raw_table( uint32_t crc, const unsigned char *p, size_t len)
+ * @brief table 로 8 바이트씩 계산하는 구현 (SSE4.2 가 없는 CPU)
+ * @return 진행한 crc 상태
+ */
+static uint32_t crc32c_raw_table( uint32_t crc, const unsigned char *p, size_t len){
+    uint64_t w;
+
+    while( ( len > 0) && ( ( uintptr_t)p & 7)){
+        crc = crc32c_table[ 0][ ( crc ^ *p++) & 0xff] ^ ( crc >> 8);
+        len--;
+    }
+    while( len >= 8){
+        memcpy( &w, p, 8);
+        w ^= crc;
+        crc = crc32c_table[ 7][ w & 0xff] ^ crc32c_table[ 6][ ( w >> 8) & 0xff]
+            ^ crc32c_table[ 5][ ( w >> 16) & 0xff] ^ crc32c_table[ 4][ ( w >> 24) & 0xff]
+            ^ crc32c_table[ 3][ ( w >> 32) & 0xff] ^ crc32c_table[ 2][ ( w >> 40) & 0xff]
+            ^ crc32c_table[ 1][ ( w >> 48) & 0xff] ^ crc32c_table[ 0][ w >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while( len > 0){
+        crc = crc32c_table[ 0][ ( crc ^ *p++) & 0xff] ^ ( crc >> 8);
+        len--;
+    }
+    return crc;
+}
+
+/**
+ * @fn static uint32_t crc32c_shift( uint32_t crc)
+ * @brief crc 상태 뒤에 0 바이트 CRC32C_BLOCK 개를 더 계산한 값을 구하는 함수 (갈래를 합칠 때 쓴다)
+ * @return 민 crc 상태
+ */
+static uint32_t crc32c_shift( uint32_t crc){
+    return crc32c_shift_table[ 0][ crc & 0xff] ^ crc32c_shift_table[ 1][ ( crc >> 8) & 0xff]
+        ^ crc32c_shift_table[ 2][ ( crc >> 16) & 0xff] ^ crc32c_shift_table[ 3][ crc >> 24];
+}
+
+#if defined( __x86_64__)
+/**
+ * @fn static uint32_t crc32c_raw_hw( uint32_t crc, const unsigned char *p, size_t len)
+ * @brief SSE4.2 crc32 명령으로 계산하는 구현
+ * 명령 하나는 지연이 3 cycle 이라 한 갈래로는 8 바이트 / 3 cycle 이 한계다. 긴 버퍼는 CRC32C_BLOCK 세 개를
+ * 따로 계산해서 지연을 겹치고, crc 가 선형이라는 점을 이용해 앞 갈래를 뒤로 밀어서 합친다
+ * @return 진행한 crc 상태
+ */
+__attribute__(( target( "sse4.2")))
+static uint32_t crc32c_raw_hw( uint32_t crc, const unsigned char *p, size_t len){
+    uint64_t c0, c1, c2, w0, w1, w2;
+    int i;
+
+    while( len >= CRC32C_BLOCK * 3){
+        c0 = crc;
+        c1 = 0;
+        c2 = 0;
+        for( i = 0; i < CRC32C_BLOCK; i += 8){
+            memcpy( &w0, &p[ i], 8);
+            memcpy( &w1, &p[ CRC32C_BLOCK + i], 8);
+            memcpy( &w2, &p[ CRC32C_BLOCK * 2 + i], 8);
+            c0 = _mm_crc32_u64( c0, w0);
+            c1 = _mm_crc32_u64( c1, w1);
+            c2 = _mm_crc32_u64( c2, w2);
+        }
+        crc = crc32c_shift( crc32c_shift( ( uint32_t)c0) ^ ( uint32_t)c1) ^ ( uint32_t)c2;
+        p += CRC32C_BLOCK * 3;
+        len -= CRC32C_BLOCK * 3;
+    }
+
+    c0 = crc;
+    while( len >= 8){
+        memcpy( &w0, p, 8);
+        c0 = _mm_crc32_u64( c0, w0);
+        p += 8;
+        len -= 8;
+    }
+    crc = ( uint32_t)c0;
+    while( len > 0){
+        crc = _mm_crc32_u8( crc, *p++);
+        len--;
+    }
+    return crc;
+}
+#endif
+
+/**
+ * @fn static void crc32c_init()
+ * @brief table 을 만들고 CPU 에 맞는 구현을 고르는 함수 (프로그램이 시작할 때 한 번 불린다)
+ * @return void
+ */
+__attribute__(( constructor))
+static void crc32c_init(){
+    unsigned char zeros[ CRC32C_BLOCK] = { 0};
+    uint32_t crc;
+    int i, j;
+
+    for( i = 0; i < 256; i++){
+        crc = i;
+        for( j = 0; j < 8; j++){
+            crc = ( crc & 1) ? ( crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[ 0][ i] = crc;
+    }
+    for( i = 0; i < 256; i++){
+        for( j = 1; j < 8; j++){
+            crc32c_table[ j][ i] = ( crc32c_table[ j - 1][ i] >> 8) ^ crc32c_table[ 0][ crc32c_table[ j - 1][ i] & 0xff];
+        }
+    }
+    for( j = 0; j < 4; j++){
+        for( i = 0; i < 256; i++){
+            crc32c_shift_table[ j][ i] = crc32c_raw_table( ( uint32_t)i << ( 8 * j), zeros, sizeof( zeros));
+        }
+    }
+
+    crc32c_raw = crc32c_raw_table;
+#if defined( __x86_64__)
+    if( __builtin_cpu_supports( "sse4.2")){
+        crc32c_raw = crc32c_raw_hw;
+    }
+#endif
+}
+
+/**
+ * @fn uint32_t crc32c_update( uint32_t crc, const void *buf, size_t len)
+ * @brief CRC32C 를 이어서 계산하는 함수 (처음에는 crc 0 으로 부르고, 나눠진 버퍼는 앞의 결과를 넘긴다)
+ * @return 지금까지의 CRC32C
+ * @param crc 앞 버퍼까지의 CRC32C
+ * @param buf 버퍼
+ * @param len 바이트 수
+ */
+uint32_t crc32c_update( uint32_t crc, const void *buf, size_t len){
+    return ~crc32c_raw( ~crc, ( const unsigned char*)buf, len);
+}
+
+/**
+ * @fn uint32_t crc32c_update_table( uint32_t crc, const void *buf, size_t len)
+ * @brief crc32c_update 와 같은 값을 CPU 와 상관 없이 table 로 계산하는 함수 (비교 / 검증용)
+ * @return 지금까지의 CRC32C
+ * @param crc 앞 버퍼까지의 CRC32C
+ * @param buf 버퍼
+ * @param len 바이트 수
+ */
+uint32_t crc32c_update_table( uint32_t crc, const void *buf, size_t len){
+    return ~crc32c_raw_table( ~crc, ( const unsigned char*)buf, len);
+}
+
+/**
+ * @fn uint32_t crc32c_copy( uint32_t crc, void *dst, const void *src, size_t len)
+ * @brief 복사하면서 CRC32C 를 이어서 계산하는 함수
+ * CRC32C_COPY_CHUNK 씩 복사하고 방금 쓴 chunk 를 L1 cache 에서 다시 읽으므로 src 는 메모리에서 한 번만 읽는다
+ * @return 지금까지의 CRC32C
+ * @param crc 앞 버퍼까지의 CRC32C
+ * @param dst 복사할 곳
+ * @param src 복사할 바이트 (dst 와 겹치면 안 된다)
+ * @param len 바이트 수
+ */
+uint32_t crc32c_copy( uint32_t crc, void *dst, const void *src, size_t len){
+    unsigned char *d = ( unsigned char*)dst;
+    const unsigned char *s = ( const unsigned char*)src;
+    size_t n;
+
+    crc = ~crc;
+    while( len > 0){
+        n = ( len < CRC32C_COPY_CHUNK) ? len : CRC32C_COPY_CHUNK;
+        memcpy( d, s, n);
+        crc = crc32c_raw( crc, d, n);
+        d += n;
+        s += n;
+        len -= n;
+    }
+    return ~crc;
+}
+
+/**
+ * @fn static uint32_t crc32c_gf2_times( const uint32_t *mat, uint32_t vec)
+ * @brief GF(2) 위의 32x32 행렬과 vector 를 곱하는 함수 (crc32c_combine 에서 0 바이트를 미는 연산)
+ * @return 곱한 vector
+ */
+static uint32_t crc32c_gf2_times( const uint32_t *mat, uint32_t vec){
+    uint32_t sum = 0;
+
+    while( vec != 0){
+        if( vec & 1){
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+/**
+ * @fn static void crc32c_gf2_square( uint32_t *square, const uint32_t *mat)
+ * @brief 행렬을 제곱하는 함수 (미는 0 bit 수를 두 배로 만든다)
+ * @return void
+ */
+static void crc32c_gf2_square( uint32_t *square, const uint32_t *mat){
+    int i;
+
+    for( i = 0; i < 32; i++){
+        square[ i] = crc32c_gf2_times( mat, mat[ i]);
+    }
+}
+
+/**
+ * @fn uint32_t crc32c_combine( uint32_t crc1, uint32_t crc2, size_t len2)
+ * @brief 따로 계산한 두 버퍼의 CRC32C 로 이어 붙인 버퍼의 CRC32C 를 구하는 함수 (두 번째 버퍼를 다시 읽지 않는다)
+ * crc 가 선형이므로 crc1 을 len2 바이트의 0 만큼 민 뒤 crc2 와 더한다. 미는 행렬을 제곱해 가므로 O(log len2) 이다
+ * @return 앞 버퍼 + 뒤 버퍼의 CRC32C
+ * @param crc1 앞 버퍼의 CRC32C
+ * @param crc2 뒤 버퍼의 CRC32C (crc 0 에서 시작해서 계산한 값)
+ * @param len2 뒤 버퍼 바이트 수
+ */
+uint32_t crc32c_combine( uint32_t crc1, uint32_t crc2, size_t len2){
+    uint32_t even[ 32], odd[ 32], row;
+    int i;
+
+    if( len2 == 0){
+        return crc1;
+    }
+    // 0 bit 하나를 미는 행렬
+    odd[ 0] = CRC32C_POLY;
+    for( i = 1, row = 1; i < 32; i++, row <<= 1){
+        odd[ i] = row;
+    }
+    // 0 bit 2 개, 4 개를 미는 행렬. 아래 loop 의 첫 제곱이 0 바이트 하나(8 bit)다
+    crc32c_gf2_square( even, odd);
+    crc32c_gf2_square( odd, even);
+    do{
+        crc32c_gf2_square( even, odd);
+        if( len2 & 1){
+            crc1 = crc32c_gf2_times( even, crc1);
+        }
+        if( ( len2 >>= 1) == 0){
+            break;
+        }
+        crc32c_gf2_square( odd, even);
+        if( len2 & 1){
+            crc1 = crc32c_gf2_times( odd, crc1);
+        }
+        len2 >>= 1;
+    }while( len2 != 0);
+    return crc1 ^ crc2;
+}
+
+/**
+ * @fn const char* crc32c_impl()
+ * @brief 이 CPU 에서 쓰는 구현 이름을 구하는 함수
+ * @return "sse4.2" 또는 "table"
+ */
+const char* crc32c_impl(){
+#if defined( __x86_64__)
+    if( crc32c_raw == crc32c_raw_hw){
+        return "sse4.2";
+    }
+#endif
+    return "table";
+}
+
+/**
+ * @fn int crc32c_frame_seal( char *frame, int len, int cap)
+ * @brief 메시지 뒤에 CRC32C trailer 를 붙이는 함수
+ * 헤더에 KMP_FLAG_CRC 를 켜고 length 에 trailer 를 더한 뒤, 헤더 + 바디의 CRC32C 를 little endian 4 바이트로 붙인다
+ * @return trailer 를 붙인 메시지 길이, 버퍼가 모자라거나 이미 붙어 있으면 BUF_ERR
+ * @param frame 메시지 (헤더 + 바디)
+ * @param len 메시지 길이
+ * @param cap frame 버퍼 크기
+ */
+int crc32c_frame_seal( char *frame, int len, int cap){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)frame;
+    uint32_t crc;
+
+    if( ( len + KMP_CRC_LEN > cap) || ( hdr->flag & KMP_FLAG_CRC)){
+        return BUF_ERR;
+    }
+    hdr->flag |= KMP_FLAG_CRC;
+    hdr->length = len + KMP_CRC_LEN;
+    crc = crc32c_update( 0, frame, len);
+    memcpy( &frame[ len], &crc, KMP_CRC_LEN);
+    return len + KMP_CRC_LEN;
+}
+
+/**
+ * @fn int crc32c_frame_check( char *frame, int len)
+ * @brief KMP_FLAG_CRC 가 있는 메시지의 trailer 를 검사하고 떼어내는 함수 (flag 를 끄고 length 를 줄인다)
+ * @return trailer 를 뗀 메시지 길이 (flag 가 없으면 len 그대로), 맞지 않으면 BUF_ERR
+ * @param frame 받은 메시지
+ * @param len 받은 메시지 길이 (trailer 포함)
+ */
+int crc32c_frame_check( char *frame, int len){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)frame;
+    uint32_t crc;
+
+    if( ( hdr->flag & KMP_FLAG_CRC) == 0){
+        return len;
+    }
+    if( len < ( int)sizeof( kmp_hdr_t) + KMP_CRC_LEN){
+        return BUF_ERR;
+    }
+    len -= KMP_CRC_LEN;
+    memcpy( &crc, &frame[ len], KMP_CRC_LEN);
+    if( crc != crc32c_update( 0, frame, len)){
+        return BUF_ERR;
+    }
+    hdr->flag &= ~KMP_FLAG_CRC;
+    hdr->length = len;
+    return len;
+}
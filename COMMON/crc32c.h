@@ -0,0 +1,26 @@
+#pragma once
+#ifndef __CRC32C_H__
+#define __CRC32C_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "kmp.h"
+
+/// 3 갈래로 나눠 계산하는 block 크기 (바이트). crc32 명령의 지연(3 cycle) 동안 다른 두 갈래를 계산한다
+#define CRC32C_BLOCK 256
+/// crc32c_copy 가 한 번에 복사하고 검사하는 크기 (L1 cache 안에서 다시 읽는다)
+#define CRC32C_COPY_CHUNK ( CRC32C_BLOCK * 3 * 4)
+
+uint32_t crc32c_update( uint32_t crc, const void *buf, size_t len);
+uint32_t crc32c_update_table( uint32_t crc, const void *buf, size_t len);
+uint32_t crc32c_copy( uint32_t crc, void *dst, const void *src, size_t len);
+uint32_t crc32c_combine( uint32_t crc1, uint32_t crc2, size_t len2);
+const char* crc32c_impl();
+int crc32c_frame_seal( char *frame, int len, int cap);
+int crc32c_frame_check( char *frame, int len);
+
+#endif
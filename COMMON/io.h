@@ -0,0 +1,19 @@
+#pragma once
+#ifndef __IO_H__
+#define __IO_H__
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/// @struct io_t
+/// @brief 연결의 바이트 stream 을 읽고 쓰는 방법. 연결에 없으면(NULL) fd 에 read / write 를 그대로 부른다
+/// 구현은 이 구조체를 첫 번째 멤버로 두고, read / write 와 같이 실패하면 -1 을 돌려주고 errno(EAGAIN 등)를 남긴다
+typedef struct io_s io_t;
+struct io_s{
+    /// 최대 len 바이트를 읽는다. 읽은 바이트 수, 상대가 닫았으면 0, 실패하면 -1
+    ssize_t ( *read)( io_t *io, void *buf, size_t len);
+    /// 최대 len 바이트를 쓴다. 쓴 바이트 수, 실패하면 -1
+    ssize_t ( *write)( io_t *io, const void *buf, size_t len);
+};
+
+#endif
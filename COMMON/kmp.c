@@ -0,0 +1,270 @@
+#include "kmp.h"
+
+/**
+ * @fn kmp_t* kmp-init()
+ * @brief 프로토콜 메시지 객체를 생성하고 초기화하기 위한 함수
+ * @return 프로토콜 메시지 객체
+ */
+kmp_t* kmp_init(){
+    kmp_t* msg = ( kmp_t*)malloc(sizeof( kmp_t));
+    memset( msg->data, 0, sizeof( msg->data));
+    return msg;
+}
+
+/**
+ * @fn void kmp_destroy( kmp_t *msg)
+ * @brief 프로토콜 메시지 객체를 삭제하기 위한 함수
+ * @return void
+ * @param msg 삭제할 프로토콜 객체
+ */
+void kmp_destroy( kmp_t* msg){
+    if( msg->data){
+        free( msg->data);
+    }
+    free( msg);
+}
+
+int kmp_get_msg_length( kmp_t *msg){
+    return msg->hdr.length;
+}
+
+/**
+ * @fn char* kmp_get_dta( kmp_t* msg)
+ * @brief 프로토콜 메시지 바디의 데이터를 구하는 함수이다
+ * @return 메시지 바디의 데이터(문자열)
+ * @param msg 알고자 하는 데이터의 메시지 객체 
+ */
+char* kmp_get_data( kmp_t* msg){
+    return msg->data;
+}
+
+/**
+ * @fn int kmp_set_msg( kmp_t *msg, uint32_t version, char *data, uint32_t code)
+ * @brief 프로토콜 메시지의 헤더와 바디를 지정하는 함수
+ * @return 성공 여부(1 : success, -1 : fail)
+ * @param msg 설정하려고 하는 메시지 객체
+ * @param version 설정하려고 하는 메시지의 version
+ * @param data 설정하려고 하는 메시지 데이터
+ * @param code 설정하려고 하는 메시지 명령 코드
+ */
+int kmp_set_msg( kmp_t* msg, uint8_t version, char *data, uint32_t code){
+    if( data != NULL){
+        int len = strlen( data);
+
+        msg->hdr.version = version;
+        msg->hdr.length = len + sizeof( msg->hdr);
+        msg->hdr.flag = 0;
+        msg->hdr.code = code;
+        msg->hdr.app_id = 0;
+        msg->hdr.hop_id = 0;
+        msg->hdr.end_id = 0;
+
+        memset( msg->data, 0, DATA_MAX_LEN);
+        data[ len] = '\0';
+        memcpy( msg->data, data, len);
+        return 1;
+    }
+    return -1;
+}
+
+/**
+ * @fn void kmp_print_msg( kmp_t *msg)
+ * @brief 프로토콜 메시지 전체를 출력하는 함수
+ * @return void
+ * @param msg 출력하려는 메시지의 객체
+ */
+void kmp_print_msg( kmp_t *msg){
+    if( msg == NULL){
+        printf("    | ! Kmp : msg null\n");
+        return 0;
+    }
+
+    printf("---- msg header ----\n");
+    printf("| msg version : %d\n", msg->hdr.version);
+    printf("| msg length : %d\n", msg->hdr.length);
+    printf("| msg flag : %d\n", msg->hdr.flag);
+    printf("| msg code : %d\n", msg->hdr.code);
+    printf("| msg app_id : %d\n", msg->hdr.app_id);
+    printf("| msg hop_id : %d\n", msg->hdr.hop_id);
+    printf("| msg end_id : %d\n", msg->hdr.end_id);
+
+    printf("---- msg body ----\n");
+    printf("| msg data : %s\n\n", msg->data);
+}
+
+/**
+ * @fn void kmp_set_hdr( kmp_hdr_t *hdr, uint8_t version, uint32_t code, uint32_t body_len)
+ * @brief 헤더를 그 자리에서 채우는 함수 (flag / app_id / hop_id / end_id 는 0, 필요하면 호출한 쪽이 바꾼다)
+ * @return void
+ * @param hdr 채울 헤더
+ * @param version 메시지 version
+ * @param code 명령 코드
+ * @param body_len 바디 길이 (바이트)
+ */
+void kmp_set_hdr( kmp_hdr_t *hdr, uint8_t version, uint32_t code, uint32_t body_len){
+    hdr->version = version;
+    hdr->length = sizeof( kmp_hdr_t) + body_len;
+    hdr->flag = 0;
+    hdr->code = code;
+    hdr->app_id = 0;
+    hdr->hop_id = 0;
+    hdr->end_id = 0;
+}
+
+/**
+ * @fn int kmp_set_body( kmp_t *msg, uint8_t version, uint32_t code, const void *body, uint32_t len)
+ * @brief kmp_set_msg 의 바이너리 버전. 길이를 받으므로 바디에 NUL 이 있어도 되고, 바디 길이만큼만 복사한다
+ * (data 전체를 지우거나 호출한 쪽 버퍼에 NUL 을 쓰지 않는다)
+ * @return 메시지 길이 (헤더 + 바디), 바디가 data 보다 길면 -1
+ * @param msg 설정할 메시지 객체
+ * @param version 메시지 version
+ * @param code 명령 코드
+ * @param body 바디 (len 이 0 이면 NULL 이어도 된다)
+ * @param len 바디 길이 (DATA_MAX_LEN 이하)
+ */
+int kmp_set_body( kmp_t *msg, uint8_t version, uint32_t code, const void *body, uint32_t len){
+    if( len > DATA_MAX_LEN){
+        return -1;
+    }
+    kmp_set_hdr( &msg->hdr, version, code, len);
+    if( len > 0){
+        memcpy( msg->data, body, len);
+    }
+    return msg->hdr.length;
+}
+
+/**
+ * @fn int kmp_iov_init( kmp_iov_t *msg, uint8_t version, uint32_t code, const void *body, uint32_t len)
+ * @brief 헤더를 만들고 호출한 쪽 바디 버퍼를 복사하지 않고 가리키는 메시지를 준비하는 함수
+ * 바디는 kmp_iov_write 로 다 보낼 때까지 유지해야 한다. 조각이 더 있으면 kmp_iov_add 로 붙인다
+ * @return 메시지 길이 (헤더 + 바디), 너무 길면 -1
+ * @param msg 준비할 메시지
+ * @param version 메시지 version
+ * @param code 명령 코드
+ * @param body 첫 바디 조각 (len 이 0 이면 붙이지 않는다)
+ * @param len 첫 바디 조각 길이
+ */
+int kmp_iov_init( kmp_iov_t *msg, uint8_t version, uint32_t code, const void *body, uint32_t len){
+    kmp_set_hdr( &msg->hdr, version, code, 0);
+    msg->iov[ 0].iov_base = &msg->hdr;
+    msg->iov[ 0].iov_len = sizeof( kmp_hdr_t);
+    msg->iov_num = 1;
+    msg->iov_pos = 0;
+    if( len == 0){
+        return msg->hdr.length;
+    }
+    return kmp_iov_add( msg, body, len);
+}
+
+/**
+ * @fn int kmp_iov_add( kmp_iov_t *msg, const void *body, uint32_t len)
+ * @brief 바디 조각 하나를 복사하지 않고 뒤에 붙이는 함수 (헤더 length 도 늘린다)
+ * @return 메시지 길이 (헤더 + 바디), 조각이 너무 많거나 메시지가 KMP_MSG_MAX_LEN 을 넘으면 -1
+ * @param msg 메시지
+ * @param body 바디 조각
+ * @param len 바디 조각 길이
+ */
+int kmp_iov_add( kmp_iov_t *msg, const void *body, uint32_t len){
+    if( ( msg->iov_num > KMP_IOV_MAX) || ( ( uint64_t)msg->hdr.length + len > KMP_MSG_MAX_LEN)){
+        return -1;
+    }
+    msg->iov[ msg->iov_num].iov_base = ( void*)body;
+    msg->iov[ msg->iov_num].iov_len = len;
+    msg->iov_num++;
+    msg->hdr.length += len;
+    return msg->hdr.length;
+}
+
+/**
+ * @fn int kmp_iov_write( int fd, kmp_iov_t *msg)
+ * @brief 헤더와 바디 조각을 writev 로 모아서 보내는 함수. 다 보내지 못하면 보낸 만큼 iov 를 당겨 두고 다시 부르면 이어서 보낸다
+ * @return 남은 바이트 수 (0 이면 다 보냈다), 실패하면 -1 (non-blocking 소켓이 가득 차면 errno 가 EAGAIN 이고 상태는 그대로다)
+ * @param fd 보낼 file descriptor
+ * @param msg 메시지
+ */
+int kmp_iov_write( int fd, kmp_iov_t *msg){
+    ssize_t n;
+    int left = 0, i;
+
+    while( msg->iov_pos < msg->iov_num){
+        if( ( n = writev( fd, &msg->iov[ msg->iov_pos], msg->iov_num - msg->iov_pos)) < 0){
+            if( errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        while( ( msg->iov_pos < msg->iov_num) && ( ( size_t)n >= msg->iov[ msg->iov_pos].iov_len)){
+            n -= msg->iov[ msg->iov_pos].iov_len;
+            msg->iov_pos++;
+        }
+        if( n > 0){
+            msg->iov[ msg->iov_pos].iov_base = ( char*)msg->iov[ msg->iov_pos].iov_base + n;
+            msg->iov[ msg->iov_pos].iov_len -= n;
+        }
+    }
+    for( i = msg->iov_pos; i < msg->iov_num; i++){
+        left += msg->iov[ i].iov_len;
+    }
+    return left;
+}
+
+/**
+ * @fn uint64_t kmp_now_us()
+ * @brief deadline 을 정하고 비교하는 현재 시각을 구하는 함수 (CLOCK_REALTIME, vDSO 라 system call 을 하지 않는다)
+ * @return 현재 시각 (us)
+ */
+uint64_t kmp_now_us(){
+    struct timespec ts;
+    clock_gettime( CLOCK_REALTIME, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @fn int kmp_set_deadline( char *frame, int len, int cap, uint64_t deadline_us)
+ * @brief 메시지 헤더 뒤에 deadline extension 을 끼워 넣는 함수 (바디를 KMP_DEADLINE_LEN 만큼 뒤로 민다)
+ * 헤더에 KMP_FLAG_DEADLINE 을 켜고 length 를 늘린다. CRC32C trailer 는 이 다음에 붙여야 extension 도 덮는다
+ * @return extension 을 넣은 메시지 길이, 버퍼가 모자라거나 이미 extension / trailer 가 있으면 -1
+ * @param frame 메시지 (헤더 + 바디)
+ * @param len 메시지 길이
+ * @param cap frame 버퍼 크기
+ * @param deadline_us 이 시각 (kmp_now_us 기준) 이 지나면 처리하지 않아도 되는 요청이다
+ */
+int kmp_set_deadline( char *frame, int len, int cap, uint64_t deadline_us){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)frame;
+
+    if( ( len + KMP_DEADLINE_LEN > cap) || ( len + KMP_DEADLINE_LEN > KMP_MSG_MAX_LEN) || ( hdr->flag & ( KMP_FLAG_DEADLINE | KMP_FLAG_CRC))){
+        return -1;
+    }
+    memmove( &frame[ sizeof( kmp_hdr_t) + KMP_DEADLINE_LEN], &frame[ sizeof( kmp_hdr_t)], len - sizeof( kmp_hdr_t));
+    memcpy( &frame[ sizeof( kmp_hdr_t)], &deadline_us, KMP_DEADLINE_LEN);
+    hdr->flag |= KMP_FLAG_DEADLINE;
+    hdr->length = len + KMP_DEADLINE_LEN;
+    return len + KMP_DEADLINE_LEN;
+}
+
+/**
+ * @fn int kmp_take_deadline( char *frame, int len, uint64_t *deadline_us)
+ * @brief KMP_FLAG_DEADLINE 이 있는 메시지에서 deadline extension 을 읽고 떼어내는 함수 (flag 를 끄고 length 를 줄인다)
+ * 처리하는 쪽은 extension 이 없는 보통 메시지를 본다. CRC32C trailer 는 먼저 떼어내야 한다
+ * @return extension 을 뗀 메시지 길이 (flag 가 없으면 len 그대로, deadline 은 0), 바디가 extension 보다 짧으면 -1
+ * @param frame 받은 메시지
+ * @param len 받은 메시지 길이
+ * @param deadline_us 읽은 deadline 을 저장할 변수
+ */
+int kmp_take_deadline( char *frame, int len, uint64_t *deadline_us){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)frame;
+
+    *deadline_us = 0;
+    if( ( hdr->flag & KMP_FLAG_DEADLINE) == 0){
+        return len;
+    }
+    if( len < ( int)sizeof( kmp_hdr_t) + KMP_DEADLINE_LEN){
+        return -1;
+    }
+    memcpy( deadline_us, &frame[ sizeof( kmp_hdr_t)], KMP_DEADLINE_LEN);
+    len -= KMP_DEADLINE_LEN;
+    memmove( &frame[ sizeof( kmp_hdr_t)], &frame[ sizeof( kmp_hdr_t) + KMP_DEADLINE_LEN], len - sizeof( kmp_hdr_t));
+    hdr->flag &= ~KMP_FLAG_DEADLINE;
+    hdr->length = len;
+    return len;
+}
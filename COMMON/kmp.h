@@ -0,0 +1,124 @@
+#pragma once
+
+#ifndef __KMP_H__
+#define __KMP_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+
+#define DATA_MAX_LEN 1024
+/// 헤더의 24 bit length 로 나타낼 수 있는 최대 메시지 길이 (헤더 + 바디)
+#define KMP_MSG_MAX_LEN 0xFFFFFF
+/// kmp_iov_t 하나에 붙일 수 있는 최대 바디 조각 수
+#define KMP_IOV_MAX 8
+
+/// 내부 제어용으로 예약된 명령 코드 (0xFFFF00 ~ 0xFFFFFF)
+#define KMP_CODE_RESERVED 0xFFFF00
+/// UDS 연결 위에서 shared memory ring 전송로를 협상하기 위한 명령 코드
+#define KMP_CODE_SHM_OPEN ( KMP_CODE_RESERVED + 1)
+/// 요청을 처리할 upstream backend가 없을 때 돌려주는 응답 코드 (헤더만 있는 메시지)
+#define KMP_CODE_UNAVAILABLE ( KMP_CODE_RESERVED + 2)
+/// server 통계를 요청하는 명령 코드 (응답 바디는 "key=value" 를 공백으로 이은 문자열)
+#define KMP_CODE_STATS ( KMP_CODE_RESERVED + 3)
+/// admission control 이 요청을 거절할 때 돌려주는 응답 코드 (헤더만 있는 메시지)
+#define KMP_CODE_OVERLOAD ( KMP_CODE_RESERVED + 4)
+/// stream 을 받는 쪽이 보내는 창 증가 메시지 (end_id 는 stream id, 바디는 늘릴 바이트 수 uint32)
+#define KMP_CODE_CREDIT ( KMP_CODE_RESERVED + 5)
+/// topic 구독 요청 (app_id 와 바디의 첫 NUL 앞까지(최대 32 바이트) 가 topic 이다. 바디가 NUL 로 시작하면 app_id 만 본다. 요청을 그대로 돌려준다)
+#define KMP_CODE_SUBSCRIBE ( KMP_CODE_RESERVED + 6)
+/// topic 구독 해지 요청 (구독할 때와 같은 app_id / 바디, 요청을 그대로 돌려준다)
+#define KMP_CODE_UNSUBSCRIBE ( KMP_CODE_RESERVED + 7)
+/// 발행 요청 (app_id 가 같고 바디가 topic 바디로 시작하는 구독자에게 메시지를 그대로 보낸다. 응답 바디는 받은 구독자 수 uint32)
+#define KMP_CODE_PUBLISH ( KMP_CODE_RESERVED + 8)
+/// server 의 flight recorder 를 dump 파일에 쓰게 하는 요청 (바디가 10진수면 그 fd 의 event 만 쓴다. 응답 바디는 "flight_path=<경로> flight_dumped=<event 수>")
+#define KMP_CODE_FLIGHT ( KMP_CODE_RESERVED + 9)
+/// server 의 blob 디렉토리에 있는 파일을 읽는 요청 (바디는 파일 이름. 응답 바디는 파일 내용, 없으면 헤더만 있는 KMP_CODE_UNAVAILABLE)
+#define KMP_CODE_BLOB ( KMP_CODE_RESERVED + 10)
+/// KMP_FLAG_DEADLINE 요청의 deadline 이 처리 전에 지났을 때 돌려주는 응답 코드 (헤더만 있는 메시지, 처리하지 않았으므로 다시 보내도 된다)
+#define KMP_CODE_EXPIRED ( KMP_CODE_RESERVED + 11)
+
+/// hdr.flag : 먼저 처리해야 하는 제어 메시지 (server 는 bulk 메시지보다 앞서 처리한다)
+#define KMP_FLAG_PRIORITY 0x01
+/// hdr.flag : 응답이 필요 없는 telemetry 메시지 (UDP 로 받은 메시지는 처리만 하고 응답하지 않는다, TCP 에서는 무시한다)
+#define KMP_FLAG_NO_REPLY 0x02
+/// hdr.flag : end_id 를 stream id 로 쓰는 stream 의 chunk 이고 같은 stream 의 chunk 가 더 온다 (마지막 chunk 에는 없다)
+#define KMP_FLAG_MORE 0x04
+/// hdr.flag : 바디 뒤에 헤더 + 바디의 CRC32C 가 KMP_CRC_LEN 바이트 붙어 있다 (length 에 포함, COMMON/crc32c.h)
+#define KMP_FLAG_CRC 0x08
+/// CRC32C trailer 길이
+#define KMP_CRC_LEN 4
+/// hdr.flag : 헤더 바로 뒤 (바디 앞) 에 요청의 deadline 이 KMP_DEADLINE_LEN 바이트 붙어 있다 (length 에 포함)
+/// 값은 CLOCK_REALTIME 기준 절대 시각 (us, little endian) 이라 hedge / 재전송해도 그대로 쓴다 (host 간 시계는 맞춰져 있어야 한다)
+#define KMP_FLAG_DEADLINE 0x10
+/// deadline extension 길이
+#define KMP_DEADLINE_LEN 8
+
+typedef unsigned short ushort;
+
+/// @struct kmp_hdr_t
+/// @brief 통신을 위한 프로토콜 헤더 구조체, 총 20바이트  
+typedef struct kmp_hdr_s kmp_hdr_t;
+struct kmp_hdr_s{
+    /// message protocol version
+    uint8_t version; // 1 byte
+    /// message header + body length
+    uint32_t length:24; // 3bytes
+    /// message flag
+    uint8_t flag; // 1byte
+    /// message command code
+    uint32_t code:24; // 3bytes
+    /// message application id
+    uint32_t app_id; // 4bytes
+    /// message hop-by-hop identifier
+    uint32_t hop_id; // 4bytes
+    /// message end-to-end identifier
+    uint32_t end_id; // 4bytes
+};
+
+/// @struct kmp_t
+/// @brief 통신을 위한 프로토콜 구조체 
+typedef struct kmp_s kmp_t;
+struct kmp_s{
+    /// message header
+    kmp_hdr_t hdr;
+    /// message data
+    char data[ DATA_MAX_LEN];
+};
+
+/// @struct kmp_iov_t
+/// @brief 헤더는 안에서 만들고 바디는 호출한 쪽 버퍼를 가리키기만 하는 메시지 (바이너리 바디, 복사 없음)
+/// iov[ 0] 이 hdr 이고 iov[ 1 ~] 이 바디 조각이다. kmp_iov_write 가 writev 한 번으로 보내고 보낸 만큼 iov 를 당긴다
+typedef struct kmp_iov_s kmp_iov_t;
+struct kmp_iov_s{
+    /// 메시지 헤더 (length 는 바디 조각을 붙일 때마다 늘어난다)
+    kmp_hdr_t hdr;
+    /// 헤더 + 바디 조각
+    struct iovec iov[ KMP_IOV_MAX + 1];
+    /// iov 수 / 아직 다 보내지 않은 첫 iov
+    int iov_num;
+    int iov_pos;
+};
+
+kmp_t* kmp_init();
+void kmp_destroy( kmp_t *msg);
+int kmp_get_msg_length( kmp_t *msg);
+char* kmp_get_data( kmp_t *msg);
+int kmp_set_msg( kmp_t *msg, uint8_t version, char *data, uint32_t code);
+void kmp_print_msg( kmp_t *msg);
+void kmp_set_hdr( kmp_hdr_t *hdr, uint8_t version, uint32_t code, uint32_t body_len);
+int kmp_set_body( kmp_t *msg, uint8_t version, uint32_t code, const void *body, uint32_t len);
+int kmp_iov_init( kmp_iov_t *msg, uint8_t version, uint32_t code, const void *body, uint32_t len);
+int kmp_iov_add( kmp_iov_t *msg, const void *body, uint32_t len);
+int kmp_iov_write( int fd, kmp_iov_t *msg);
+uint64_t kmp_now_us();
+int kmp_set_deadline( char *frame, int len, int cap, uint64_t deadline_us);
+int kmp_take_deadline( char *frame, int len, uint64_t *deadline_us);
+
+#endif
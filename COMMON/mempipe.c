@@ -0,0 +1,159 @@
+#include "mempipe.h"
+
+/**
+ * @fn mempipe_t* mempipe_init()
+ * @brief 메모리 duplex pipe 를 만드는 함수. ends[ 0] 이 쓴 바이트는 ends[ 1] 이 읽고, 반대도 같다
+ * @return 생성된 객체, 실패하면 NULL
+ */
+mempipe_t* mempipe_init(){
+    mempipe_t *pipe;
+    int i;
+
+    if( ( pipe = ( mempipe_t*)calloc( 1, sizeof( mempipe_t))) == NULL){
+        printf("    | ! Mempipe : Failed to allocate memory\n");
+        return NULL;
+    }
+    for( i = 0; i < 2; i++){
+        pipe->ends[ i].io.read = mempipe_read;
+        pipe->ends[ i].io.write = mempipe_write;
+        pipe->ends[ i].rx = &pipe->rings[ i];
+        pipe->ends[ i].tx = &pipe->rings[ 1 - i];
+    }
+    return pipe;
+}
+
+/**
+ * @fn void mempipe_destroy( mempipe_t *pipe)
+ * @brief 메모리 duplex pipe 를 해제하는 함수
+ * @return void
+ * @param pipe pipe 객체 (NULL 이면 아무 것도 하지 않는다)
+ */
+void mempipe_destroy( mempipe_t *pipe){
+    free( pipe);
+}
+
+/**
+ * @fn void mempipe_script( mempipe_end_t *end, int is_write, const int *steps, int num)
+ * @brief 한 쪽 끝의 read 나 write 에 적용할 script 를 정하는 함수
+ * 호출마다 단계를 하나씩 쓰고, 양수면 그 호출에서 옮기는 바이트 수를 그 값 이하로 줄이고 MEMPIPE_EAGAIN 이면 EAGAIN 을 돌려준다
+ * @return void
+ * @param end pipe 의 한 쪽 끝
+ * @param is_write 1 이면 write, 0 이면 read 에 적용한다
+ * @param steps 단계 목록 (num 이 0 이면 script 를 지운다)
+ * @param num 단계 수 (MEMPIPE_SCRIPT_MAX 까지)
+ */
+void mempipe_script( mempipe_end_t *end, int is_write, const int *steps, int num){
+    mempipe_script_t *script = is_write ? &end->write_script : &end->read_script;
+
+    script->num = ( num > MEMPIPE_SCRIPT_MAX) ? MEMPIPE_SCRIPT_MAX : num;
+    script->pos = 0;
+    memcpy( script->steps, steps, sizeof( int) * script->num);
+}
+
+/**
+ * @fn void mempipe_close( mempipe_end_t *end)
+ * @brief 한 쪽 끝을 닫는 함수 (상대는 남은 바이트를 다 읽으면 0 을 읽고, 이 끝에 쓰면 EPIPE 다)
+ * @return void
+ * @param end 닫을 끝
+ */
+void mempipe_close( mempipe_end_t *end){
+    end->tx->is_writer_closed = 1;
+    end->rx->is_reader_closed = 1;
+}
+
+/**
+ * @fn static size_t mempipe_script_next( mempipe_script_t *script, size_t len)
+ * @brief script 의 다음 단계를 적용한 이번 호출의 최대 바이트 수를 구하는 함수
+ * @return 옮길 수 있는 최대 바이트 수 (0 이면 EAGAIN)
+ */
+static size_t mempipe_script_next( mempipe_script_t *script, size_t len){
+    int step;
+
+    if( script->num == 0){
+        return len;
+    }
+    step = script->steps[ script->pos];
+    script->pos = ( script->pos + 1) % script->num;
+    return ( ( size_t)step < len) ? ( size_t)step : len;
+}
+
+/**
+ * @fn ssize_t mempipe_read( io_t *io, void *buf, size_t len)
+ * @brief 상대가 쓴 바이트를 읽는 함수 (io_t read)
+ * @return 읽은 바이트 수, 상대가 닫고 남은 바이트가 없으면 0, 읽을 바이트가 없거나 script 가 막으면 -1 (errno EAGAIN)
+ * @param io pipe 의 한 쪽 끝 (mempipe_end_t)
+ * @param buf 읽은 바이트를 저장할 버퍼
+ * @param len 최대 바이트 수
+ */
+ssize_t mempipe_read( io_t *io, void *buf, size_t len){
+    mempipe_end_t *end = ( mempipe_end_t*)io;
+    mempipe_ring_t *ring = end->rx;
+    uint32_t avail = ring->tail - ring->head;
+    uint32_t pos, first;
+    size_t n;
+
+    end->reads++;
+    if( ( avail == 0) && ring->is_writer_closed){
+        return 0;
+    }
+    n = mempipe_script_next( &end->read_script, len);
+    n = ( n < avail) ? n : avail;
+    if( n == 0){
+        end->eagains++;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    pos = ring->head & ( MEMPIPE_BUF_LEN - 1);
+    first = MEMPIPE_BUF_LEN - pos;
+    if( n <= first){
+        memcpy( buf, &ring->buf[ pos], n);
+    }
+    else{
+        memcpy( buf, &ring->buf[ pos], first);
+        memcpy( ( char*)buf + first, ring->buf, n - first);
+    }
+    ring->head += n;
+    return n;
+}
+
+/**
+ * @fn ssize_t mempipe_write( io_t *io, const void *buf, size_t len)
+ * @brief 상대가 읽을 바이트를 쓰는 함수 (io_t write)
+ * @return 쓴 바이트 수, 버퍼가 가득 찼거나 script 가 막으면 -1 (errno EAGAIN), 상대가 닫았으면 -1 (errno EPIPE)
+ * @param io pipe 의 한 쪽 끝 (mempipe_end_t)
+ * @param buf 쓸 바이트
+ * @param len 바이트 수
+ */
+ssize_t mempipe_write( io_t *io, const void *buf, size_t len){
+    mempipe_end_t *end = ( mempipe_end_t*)io;
+    mempipe_ring_t *ring = end->tx;
+    uint32_t space = MEMPIPE_BUF_LEN - ( ring->tail - ring->head);
+    uint32_t pos, first;
+    size_t n;
+
+    end->writes++;
+    if( ring->is_reader_closed){
+        errno = EPIPE;
+        return -1;
+    }
+    n = mempipe_script_next( &end->write_script, len);
+    n = ( n < space) ? n : space;
+    if( n == 0){
+        end->eagains++;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    pos = ring->tail & ( MEMPIPE_BUF_LEN - 1);
+    first = MEMPIPE_BUF_LEN - pos;
+    if( n <= first){
+        memcpy( &ring->buf[ pos], buf, n);
+    }
+    else{
+        memcpy( &ring->buf[ pos], buf, first);
+        memcpy( ring->buf, ( const char*)buf + first, n - first);
+    }
+    ring->tail += n;
+    return n;
+}
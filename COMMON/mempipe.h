@@ -0,0 +1,77 @@
+#pragma once
+#ifndef __MEMPIPE_H__
+#define __MEMPIPE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "common.h"
+#include "io.h"
+
+/// 방향 하나의 버퍼 크기 (2의 거듭제곱). 가득 차면 write 는 EAGAIN 이다
+#define MEMPIPE_BUF_LEN ( 64 << 10)
+/// read / write 마다 돌아가며 적용하는 최대 script 단계 수
+#define MEMPIPE_SCRIPT_MAX 32
+/// script 단계 : 이번 호출은 아무 것도 옮기지 않고 EAGAIN 을 돌려준다 (양수면 이번 호출에서 옮기는 최대 바이트 수)
+#define MEMPIPE_EAGAIN 0
+
+/// @struct mempipe_ring_t
+/// @brief 한 방향의 byte 버퍼 (한 쪽 끝이 쓰고 다른 쪽 끝이 읽는다, 같은 thread 에서만 쓴다)
+typedef struct mempipe_ring_s mempipe_ring_t;
+struct mempipe_ring_s{
+    char buf[ MEMPIPE_BUF_LEN];
+    /// 다음에 읽을 / 쓸 위치 (계속 늘어나고 버퍼 위치는 MEMPIPE_BUF_LEN 으로 나눈 나머지)
+    uint32_t head;
+    uint32_t tail;
+    /// 쓰는 쪽이 닫았으면 남은 바이트를 다 읽은 뒤 read 가 0 이다
+    int is_writer_closed;
+    /// 읽는 쪽이 닫았으면 write 가 EPIPE 다
+    int is_reader_closed;
+};
+
+/// @struct mempipe_script_t
+/// @brief read 나 write 호출마다 차례로 적용하는 단계 (끝나면 처음부터 다시, 단계가 없으면 제한하지 않는다)
+typedef struct mempipe_script_s mempipe_script_t;
+struct mempipe_script_s{
+    int steps[ MEMPIPE_SCRIPT_MAX];
+    int num;
+    int pos;
+};
+
+/// @struct mempipe_end_t
+/// @brief 메모리 duplex pipe 의 한 쪽 끝. io_t 로 연결에 붙인다
+typedef struct mempipe_end_s mempipe_end_t;
+struct mempipe_end_s{
+    /// read / write 방법 (첫 번째 멤버)
+    io_t io;
+    /// 이 끝이 읽는 방향 / 쓰는 방향
+    mempipe_ring_t *rx;
+    mempipe_ring_t *tx;
+    /// 짧은 read / write 와 EAGAIN 을 만드는 script
+    mempipe_script_t read_script;
+    mempipe_script_t write_script;
+    /// 호출 수 / script 나 버퍼 상태 때문에 EAGAIN 을 돌려준 수
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t eagains;
+};
+
+/// @struct mempipe_t
+/// @brief 커널 없이 두 끝을 잇는 메모리 duplex pipe (socketpair 대신 상태 기계를 그대로 시험하고 측정한다)
+typedef struct mempipe_s mempipe_t;
+struct mempipe_s{
+    mempipe_ring_t rings[ 2];
+    mempipe_end_t ends[ 2];
+};
+
+mempipe_t* mempipe_init();
+void mempipe_destroy( mempipe_t *pipe);
+void mempipe_script( mempipe_end_t *end, int is_write, const int *steps, int num);
+void mempipe_close( mempipe_end_t *end);
+ssize_t mempipe_read( io_t *io, void *buf, size_t len);
+ssize_t mempipe_write( io_t *io, const void *buf, size_t len);
+
+#endif
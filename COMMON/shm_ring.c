@@ -0,0 +1,448 @@
+// memfd_create
+#define _GNU_SOURCE
+#include "shm_ring.h"
+#include "kmp.h"
+
+#include <fcntl.h>
+
+/**
+ * @fn static size_t shm_ring_bytes( uint32_t ring_size)
+ * @brief ring 하나가 차지하는 shared memory 크기를 구하는 함수
+ * @return ring 구조체 + 데이터 영역 크기 (cache line 정렬)
+ * @param ring_size ring 데이터 영역 크기
+ */
+static size_t shm_ring_bytes( uint32_t ring_size){
+    size_t bytes = sizeof( shm_ring_t) + ring_size;
+    return ( bytes + SHM_CACHE_LINE - 1) & ~( ( size_t)SHM_CACHE_LINE - 1);
+}
+
+/**
+ * @fn static void shm_ring_copy_out( shm_ring_t *ring, uint32_t pos, void *dst, uint32_t len)
+ * @brief ring의 끝에서 잘린 데이터를 고려해서 ring 밖으로 복사하는 함수
+ * @return void
+ * @param ring 읽을 ring
+ * @param pos 읽기 시작 위치 (mask 되지 않은 값)
+ * @param dst 복사 받을 버퍼
+ * @param len 복사할 크기
+ */
+static void shm_ring_copy_out( shm_ring_t *ring, uint32_t pos, void *dst, uint32_t len){
+    uint32_t index = pos & ( ring->size - 1);
+    uint32_t first = ring->size - index;
+
+    if( first >= len){
+        memcpy( dst, &ring->data[ index], len);
+    }
+    else{
+        memcpy( dst, &ring->data[ index], first);
+        memcpy( ( char*)dst + first, ring->data, len - first);
+    }
+}
+
+/**
+ * @fn static void shm_ring_copy_in( shm_ring_t *ring, uint32_t pos, const void *src, uint32_t len)
+ * @brief ring의 끝을 넘어가면 처음으로 돌아가서 ring 안으로 복사하는 함수
+ * @return void
+ * @param ring 쓸 ring
+ * @param pos 쓰기 시작 위치 (mask 되지 않은 값)
+ * @param src 복사할 데이터
+ * @param len 복사할 크기
+ */
+static void shm_ring_copy_in( shm_ring_t *ring, uint32_t pos, const void *src, uint32_t len){
+    uint32_t index = pos & ( ring->size - 1);
+    uint32_t first = ring->size - index;
+
+    if( first >= len){
+        memcpy( &ring->data[ index], src, len);
+    }
+    else{
+        memcpy( &ring->data[ index], src, first);
+        memcpy( ring->data, ( const char*)src + first, len - first);
+    }
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn int shm_ring_is_empty( shm_ring_t *ring)
+ * @brief ring에 읽을 메시지가 없는지 확인하는 함수 (소비자 측에서 호출)
+ * @return 비어 있으면 1, 아니면 0
+ * @param ring 확인할 ring
+ */
+int shm_ring_is_empty( shm_ring_t *ring){
+    return __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE) == ring->tail;
+}
+
+/**
+ * @fn uint32_t shm_ring_free_bytes( shm_ring_t *ring)
+ * @brief ring에 더 쓸 수 있는 크기를 구하는 함수 (생산자 측에서 호출)
+ * @return 남은 크기
+ * @param ring 확인할 ring
+ */
+uint32_t shm_ring_free_bytes( shm_ring_t *ring){
+    return ring->size - ( ring->head - __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * @fn uint32_t shm_ring_peek_length( shm_ring_t *ring)
+ * @brief ring 맨 앞 메시지의 헤더만 읽어서 메시지 길이를 구하는 함수
+ * @return 메시지 길이, 비어 있으면 0
+ * @param ring 확인할 ring
+ */
+uint32_t shm_ring_peek_length( shm_ring_t *ring){
+    kmp_hdr_t hdr;
+
+    if( shm_ring_is_empty( ring)){
+        return 0;
+    }
+    shm_ring_copy_out( ring, ring->tail, &hdr, sizeof( hdr));
+    return hdr.length;
+}
+
+/**
+ * @fn int shm_ring_push( shm_ring_t *ring, int efd, const void *frame, uint32_t len)
+ * @brief ring에 kmp 메시지 하나를 쓰고, 소비자가 대기 중이면 eventfd로 깨우는 함수
+ * @return 성공하면 NORMAL, 공간이 부족하면 BUF_ERR
+ * @param ring 쓸 ring
+ * @param efd 소비자를 깨우기 위한 eventfd
+ * @param frame 쓸 메시지 (헤더 + 바디)
+ * @param len 메시지 길이
+ */
+int shm_ring_push( shm_ring_t *ring, int efd, const void *frame, uint32_t len){
+    if( shm_ring_free_bytes( ring) < len){
+        return BUF_ERR;
+    }
+
+    shm_ring_copy_in( ring, ring->head, frame, len);
+    __atomic_store_n( &ring->head, ring->head + len, __ATOMIC_SEQ_CST);
+
+    // 소비자가 잠들기로 했다면 한 번만 깨운다
+    if( __atomic_exchange_n( &ring->waiting, 0, __ATOMIC_SEQ_CST) != 0){
+        eventfd_write( efd, 1);
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int shm_ring_pop( shm_ring_t *ring, void *buf, uint32_t buf_len)
+ * @brief ring에서 kmp 메시지 하나를 꺼내는 함수
+ * head 와 메시지 길이는 생산자가 쓸 수 있는 shared memory 에 있으므로 믿지 않는다.
+ * 생산자가 발행한 바이트(head - tail)보다 긴 메시지는 아직 쓰지 않았거나 지난 데이터를 읽게 되고 tail 이 head 를 넘어가므로 꺼내지 않는다
+ * @return 꺼낸 메시지 길이, 비어 있으면 0, 버퍼가 작거나 메시지가 깨졌으면 BUF_ERR
+ * @param ring 읽을 ring
+ * @param buf 메시지를 받을 버퍼
+ * @param buf_len 버퍼 크기
+ */
+int shm_ring_pop( shm_ring_t *ring, void *buf, uint32_t buf_len){
+    uint32_t avail = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+    uint32_t len;
+    kmp_hdr_t hdr;
+
+    if( avail == 0){
+        return 0;
+    }
+    if( ( avail < sizeof( kmp_hdr_t)) || ( avail > ring->size)){
+        return BUF_ERR;
+    }
+    shm_ring_copy_out( ring, ring->tail, &hdr, sizeof( hdr));
+    len = hdr.length;
+    if( ( len < sizeof( kmp_hdr_t)) || ( len > buf_len) || ( len > avail)){
+        return BUF_ERR;
+    }
+
+    shm_ring_copy_out( ring, ring->tail, buf, len);
+    __atomic_store_n( &ring->tail, ring->tail + len, __ATOMIC_RELEASE);
+    return ( int)len;
+}
+
+/**
+ * @fn int shm_ring_sleep( shm_ring_t *ring)
+ * @brief 소비자가 eventfd에서 잠들기 전에 호출해서 대기 상태를 알리는 함수
+ * @return 잠들어도 되면 1, 그 사이에 메시지가 들어왔으면 0
+ * @param ring 대기할 ring
+ */
+int shm_ring_sleep( shm_ring_t *ring){
+    __atomic_store_n( &ring->waiting, 1, __ATOMIC_SEQ_CST);
+    if( shm_ring_is_empty( ring) == 0){
+        __atomic_store_n( &ring->waiting, 0, __ATOMIC_SEQ_CST);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @fn int shm_ring_wait( shm_ring_t *ring, int efd, int spin)
+ * @brief ring에 메시지가 들어올 때까지 잠깐 spin 한 뒤 eventfd에서 대기하는 함수
+ * @return 정상이면 NORMAL, eventfd 에러면 FD_ERR
+ * @param ring 대기할 ring
+ * @param efd 생산자가 신호를 보내는 eventfd (blocking)
+ * @param spin eventfd로 잠들기 전에 확인할 횟수
+ */
+int shm_ring_wait( shm_ring_t *ring, int efd, int spin){
+    eventfd_t value;
+
+    while( shm_ring_is_empty( ring)){
+        if( spin > 0){
+            spin--;
+            SHM_CPU_RELAX();
+            continue;
+        }
+        if( shm_ring_sleep( ring) == 0){
+            break;
+        }
+        if( eventfd_read( efd, &value) < 0){
+            if( errno == EINTR){
+                continue;
+            }
+            return FD_ERR;
+        }
+    }
+    return NORMAL;
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn static shm_chan_t* shm_chan_map( int fds[ SHM_CHAN_FD_NUM], size_t map_len)
+ * @brief memfd를 mmap 해서 shm_chan_t 객체를 만드는 함수
+ * @return 생성된 전송로 객체, 실패하면 NULL
+ * @param fds memfd, req eventfd, rsp eventfd
+ * @param map_len mmap 할 전체 크기
+ */
+static shm_chan_t* shm_chan_map( int fds[ SHM_CHAN_FD_NUM], size_t map_len){
+    shm_chan_t *chan = ( shm_chan_t*)malloc( sizeof( shm_chan_t));
+    if( chan == NULL){
+        printf("    | ! Shm : Failed to allocate memory\n");
+        return NULL;
+    }
+
+    chan->base = mmap( NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fds[ 0], 0);
+    if( chan->base == MAP_FAILED){
+        printf("    | ! Shm : mmap error (errno:%d)\n", errno);
+        free( chan);
+        return NULL;
+    }
+
+    chan->mem_fd = fds[ 0];
+    chan->req_efd = fds[ 1];
+    chan->rsp_efd = fds[ 2];
+    chan->map_len = map_len;
+    chan->req = ( shm_ring_t*)chan->base;
+    chan->rsp = ( shm_ring_t*)( ( char*)chan->base + map_len / 2);
+    return chan;
+}
+
+/**
+ * @fn shm_chan_t* shm_chan_create( uint32_t ring_size)
+ * @brief server 측에서 shared memory 전송로를 새로 만드는 함수
+ * @return 생성된 전송로 객체, 실패하면 NULL
+ * @param ring_size 한 방향 ring 데이터 영역 크기 (2의 거듭제곱)
+ */
+shm_chan_t* shm_chan_create( uint32_t ring_size){
+    static uint32_t seq = 0;
+    int fds[ SHM_CHAN_FD_NUM] = { -1, -1, -1};
+    char name[ 64];
+    size_t ring_bytes = shm_ring_bytes( ring_size);
+    shm_chan_t *chan;
+
+    if( ( ring_size == 0) || ( ( ring_size & ( ring_size - 1)) != 0)){
+        printf("    | ! Shm : ring size must be a power of 2 (size:%u)\n", ring_size);
+        return NULL;
+    }
+
+    // 이름이 없는 memfd 라 fd 로만 공유되고, 마지막 fd 가 닫히면 사라진다 (/dev/shm 에 남지 않는다)
+    snprintf( name, sizeof( name), "kmp_shm_%d_%u", getpid(), __atomic_fetch_add( &seq, 1, __ATOMIC_RELAXED));
+    if( ( fds[ 0] = memfd_create( name, MFD_CLOEXEC)) < 0){
+        printf("    | ! Shm : memfd_create error (errno:%d)\n", errno);
+        return NULL;
+    }
+
+    if( ftruncate( fds[ 0], ring_bytes * 2) < 0){
+        printf("    | ! Shm : ftruncate error (errno:%d)\n", errno);
+        close( fds[ 0]);
+        return NULL;
+    }
+
+    fds[ 1] = eventfd( 0, 0);
+    fds[ 2] = eventfd( 0, 0);
+    if( ( fds[ 1] < 0) || ( fds[ 2] < 0)){
+        printf("    | ! Shm : eventfd error (errno:%d)\n", errno);
+        close( fds[ 0]);
+        if( fds[ 1] >= 0) close( fds[ 1]);
+        if( fds[ 2] >= 0) close( fds[ 2]);
+        return NULL;
+    }
+
+    if( ( chan = shm_chan_map( fds, ring_bytes * 2)) == NULL){
+        close( fds[ 0]);
+        close( fds[ 1]);
+        close( fds[ 2]);
+        return NULL;
+    }
+
+    memset( chan->base, 0, sizeof( shm_ring_t));
+    memset( chan->rsp, 0, sizeof( shm_ring_t));
+    chan->req->size = ring_size;
+    chan->rsp->size = ring_size;
+    return chan;
+}
+
+/**
+ * @fn shm_chan_t* shm_chan_attach( int fds[ SHM_CHAN_FD_NUM])
+ * @brief client 측에서 server로부터 전달 받은 fd로 전송로에 연결하는 함수
+ * @return 연결된 전송로 객체, 실패하면 NULL
+ * @param fds server가 SCM_RIGHTS로 보낸 memfd, req eventfd, rsp eventfd
+ */
+shm_chan_t* shm_chan_attach( int fds[ SHM_CHAN_FD_NUM]){
+    struct stat st;
+    shm_chan_t *chan;
+
+    if( fstat( fds[ 0], &st) < 0){
+        printf("    | ! Shm : fstat error (errno:%d)\n", errno);
+        return NULL;
+    }
+
+    if( ( chan = shm_chan_map( fds, ( size_t)st.st_size)) == NULL){
+        return NULL;
+    }
+
+    if( shm_ring_bytes( chan->req->size) * 2 != chan->map_len){
+        printf("    | ! Shm : ring size mismatch\n");
+        munmap( chan->base, chan->map_len);
+        free( chan);
+        return NULL;
+    }
+    return chan;
+}
+
+/**
+ * @fn void shm_chan_destroy( shm_chan_t *chan)
+ * @brief shared memory 전송로를 해제하는 함수
+ * @return void
+ * @param chan 해제할 전송로 객체
+ */
+void shm_chan_destroy( shm_chan_t *chan){
+    if( chan == NULL){
+        return;
+    }
+    munmap( chan->base, chan->map_len);
+    close( chan->mem_fd);
+    close( chan->req_efd);
+    close( chan->rsp_efd);
+    free( chan);
+}
+
+/**
+ * @fn int shm_chan_send_fds( int sock_fd, shm_chan_t *chan, const void *buf, int buf_len)
+ * @brief UDS 연결로 응답 메시지와 함께 전송로의 fd들을 SCM_RIGHTS로 보내는 함수
+ * @return 보낸 바이트 수, 실패하면 SOC_ERR
+ * @param sock_fd AF_UNIX 소켓
+ * @param chan 보낼 전송로 객체
+ * @param buf 함께 보낼 kmp 메시지
+ * @param buf_len 메시지 길이
+ */
+int shm_chan_send_fds( int sock_fd, shm_chan_t *chan, const void *buf, int buf_len){
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[ CMSG_SPACE( sizeof( int) * SHM_CHAN_FD_NUM)];
+    int fds[ SHM_CHAN_FD_NUM] = { chan->mem_fd, chan->req_efd, chan->rsp_efd};
+    int rv;
+
+    memset( &msg, 0, sizeof( msg));
+    memset( control, 0, sizeof( control));
+    iov.iov_base = ( void*)buf;
+    iov.iov_len = buf_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof( control);
+
+    cmsg = CMSG_FIRSTHDR( &msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN( sizeof( fds));
+    memcpy( CMSG_DATA( cmsg), fds, sizeof( fds));
+
+    if( ( rv = sendmsg( sock_fd, &msg, MSG_NOSIGNAL)) < 0){
+        printf("    | ! Shm : sendmsg error (errno:%d) (fd:%d)\n", errno, sock_fd);
+        return SOC_ERR;
+    }
+    return rv;
+}
+
+/**
+ * @fn int shm_chan_recv_fds( int sock_fd, int fds[ SHM_CHAN_FD_NUM], void *buf, int buf_len)
+ * @brief UDS 연결에서 응답 메시지와 SCM_RIGHTS로 전달된 fd들을 받는 함수
+ * @return 받은 바이트 수, 실패하면 SOC_ERR
+ * @param sock_fd AF_UNIX 소켓
+ * @param fds 전달 받은 fd를 저장할 배열
+ * @param buf 함께 받은 kmp 메시지를 저장할 버퍼
+ * @param buf_len 버퍼 크기
+ */
+int shm_chan_recv_fds( int sock_fd, int fds[ SHM_CHAN_FD_NUM], void *buf, int buf_len){
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[ CMSG_SPACE( sizeof( int) * SHM_CHAN_FD_NUM)];
+    int rv;
+
+    memset( &msg, 0, sizeof( msg));
+    iov.iov_base = buf;
+    iov.iov_len = buf_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof( control);
+
+    if( ( rv = recvmsg( sock_fd, &msg, MSG_CMSG_CLOEXEC)) <= 0){
+        printf("    | ! Shm : recvmsg error (errno:%d) (fd:%d)\n", errno, sock_fd);
+        return SOC_ERR;
+    }
+
+    cmsg = CMSG_FIRSTHDR( &msg);
+    if( ( cmsg == NULL) || ( cmsg->cmsg_type != SCM_RIGHTS) || ( cmsg->cmsg_len != CMSG_LEN( sizeof( int) * SHM_CHAN_FD_NUM))){
+        printf("    | ! Shm : no fds in reply (fd:%d)\n", sock_fd);
+        return SOC_ERR;
+    }
+    memcpy( fds, CMSG_DATA( cmsg), sizeof( int) * SHM_CHAN_FD_NUM);
+    return rv;
+}
+
+/**
+ * @fn shm_chan_t* shm_chan_request( int sock_fd)
+ * @brief client 측에서 UDS 연결로 KMP_CODE_SHM_OPEN을 보내 전송로를 협상하는 함수
+ * 협상이 끝날 때까지 blocking 되며, 이후 UDS 연결은 전송로의 수명을 나타내므로 열어 두어야 한다
+ * @return 연결된 전송로 객체, 실패하면 NULL
+ * @param sock_fd server에 연결된 AF_UNIX 소켓 (blocking)
+ */
+shm_chan_t* shm_chan_request( int sock_fd){
+    char frame[ sizeof( kmp_hdr_t) + 4];
+    char reply[ sizeof( frame)];
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)frame;
+    int fds[ SHM_CHAN_FD_NUM];
+    shm_chan_t *chan;
+    int i;
+
+    memset( frame, 0, sizeof( frame));
+    hdr->version = 1;
+    hdr->length = sizeof( frame);
+    hdr->code = KMP_CODE_SHM_OPEN;
+    memcpy( &frame[ sizeof( kmp_hdr_t)], "shm", 4);
+
+    if( write( sock_fd, frame, sizeof( frame)) != sizeof( frame)){
+        printf("    | ! Shm : Failed to send shm open request (fd:%d)\n", sock_fd);
+        return NULL;
+    }
+
+    if( shm_chan_recv_fds( sock_fd, fds, reply, sizeof( reply)) != sizeof( reply)){
+        return NULL;
+    }
+
+    if( ( chan = shm_chan_attach( fds)) == NULL){
+        for( i = 0; i < SHM_CHAN_FD_NUM; i++){
+            close( fds[ i]);
+        }
+        return NULL;
+    }
+    return chan;
+}
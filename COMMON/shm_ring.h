@@ -0,0 +1,83 @@
+#pragma once
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
+#include "common.h"
+
+/// 한 방향 ring의 기본 데이터 영역 크기 (2의 거듭제곱이어야 한다)
+#define SHM_RING_SIZE ( 1 << 20)
+/// SCM_RIGHTS로 전달하는 file descriptor 개수 (memfd, req eventfd, rsp eventfd)
+#define SHM_CHAN_FD_NUM 3
+#define SHM_CACHE_LINE 64
+
+#if defined( __x86_64__) || defined( __i386__)
+#define SHM_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define SHM_CPU_RELAX() do{ }while( 0)
+#endif
+
+/// @struct shm_ring_t
+/// @brief 단일 생산자 / 단일 소비자(SPSC) 방식의 shared memory byte ring
+/// kmp 메시지(헤더 + 바디)를 그대로 이어 붙여서 저장한다
+typedef struct shm_ring_s shm_ring_t;
+struct shm_ring_s{
+    /// 생산자가 다음에 쓸 위치 (단조 증가, size로 mask)
+    uint32_t head __attribute__( ( aligned( SHM_CACHE_LINE)));
+    /// 소비자가 다음에 읽을 위치 (단조 증가, size로 mask)
+    uint32_t tail __attribute__( ( aligned( SHM_CACHE_LINE)));
+    /// 소비자가 eventfd에서 대기 중인지 여부
+    uint32_t waiting __attribute__( ( aligned( SHM_CACHE_LINE)));
+    /// 데이터 영역 크기
+    uint32_t size __attribute__( ( aligned( SHM_CACHE_LINE)));
+    /// 데이터 영역
+    char data[] __attribute__( ( aligned( SHM_CACHE_LINE)));
+};
+
+/// @struct shm_chan_t
+/// @brief client <-> server 양방향 shared memory 전송로
+typedef struct shm_chan_s shm_chan_t;
+struct shm_chan_s{
+    /// ring 두 개를 담고 있는 memfd
+    int mem_fd;
+    /// client -> server 방향 알림용 eventfd
+    int req_efd;
+    /// server -> client 방향 알림용 eventfd
+    int rsp_efd;
+    /// mmap 된 전체 크기
+    size_t map_len;
+    /// mmap 시작 주소
+    void *base;
+    /// client -> server ring
+    shm_ring_t *req;
+    /// server -> client ring
+    shm_ring_t *rsp;
+};
+
+shm_chan_t* shm_chan_create( uint32_t ring_size);
+shm_chan_t* shm_chan_attach( int fds[ SHM_CHAN_FD_NUM]);
+void shm_chan_destroy( shm_chan_t *chan);
+int shm_chan_send_fds( int sock_fd, shm_chan_t *chan, const void *buf, int buf_len);
+int shm_chan_recv_fds( int sock_fd, int fds[ SHM_CHAN_FD_NUM], void *buf, int buf_len);
+shm_chan_t* shm_chan_request( int sock_fd);
+
+int shm_ring_push( shm_ring_t *ring, int efd, const void *frame, uint32_t len);
+int shm_ring_pop( shm_ring_t *ring, void *buf, uint32_t buf_len);
+int shm_ring_is_empty( shm_ring_t *ring);
+uint32_t shm_ring_free_bytes( shm_ring_t *ring);
+uint32_t shm_ring_peek_length( shm_ring_t *ring);
+int shm_ring_wait( shm_ring_t *ring, int efd, int spin);
+int shm_ring_sleep( shm_ring_t *ring);
+
+#endif
@@ -0,0 +1,233 @@
+#include "stream.h"
+
+/**
+ * @fn stream_tab_t* stream_tab_init()
+ * @brief 연결 하나의 stream 목록을 만드는 함수
+ * @return 생성된 객체, 실패하면 NULL
+ */
+stream_tab_t* stream_tab_init(){
+    stream_tab_t *tab;
+
+    if( ( tab = ( stream_tab_t*)calloc( 1, sizeof( stream_tab_t))) == NULL){
+        printf("    | ! Stream : Failed to allocate memory\n");
+        return NULL;
+    }
+    return tab;
+}
+
+/**
+ * @fn void stream_tab_destroy( stream_tab_t *tab)
+ * @brief stream 목록을 해제하는 함수 (열려 있던 stream 은 버린다)
+ * @return void
+ * @param tab stream 목록 (NULL 이면 아무 것도 하지 않는다)
+ */
+void stream_tab_destroy( stream_tab_t *tab){
+    free( tab);
+}
+
+/**
+ * @fn static stream_rx_t* stream_rx_find( const stream_tab_t *tab, uint32_t id)
+ * @brief 열려 있는 stream 중에서 id 의 stream 을 찾는 함수
+ * @return stream, 없으면 NULL
+ */
+static stream_rx_t* stream_rx_find( const stream_tab_t *tab, uint32_t id){
+    int i;
+
+    for( i = 0; i < tab->num; i++){
+        if( tab->rx[ i].id == id){
+            return ( stream_rx_t*)&tab->rx[ i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn int stream_rx_is_chunk( const stream_tab_t *tab, const kmp_hdr_t *hdr)
+ * @brief 받은 frame 이 stream 의 chunk 인지 stream 상태를 바꾸지 않고 확인하는 함수 (stream_rx_recv 가 STREAM_MSG 가 아닌 것을 돌려줄 frame)
+ * @return chunk 이면 1, 보통 메시지이면 0
+ * @param tab 연결의 stream 목록 (NULL 이면 열린 stream 이 없다)
+ * @param hdr 받은 frame 의 헤더
+ */
+int stream_rx_is_chunk( const stream_tab_t *tab, const kmp_hdr_t *hdr){
+    if( hdr->flag & KMP_FLAG_MORE){
+        return 1;
+    }
+    return ( tab != NULL) && ( stream_rx_find( tab, hdr->end_id) != NULL);
+}
+
+/**
+ * @fn int stream_rx_recv( stream_tab_t *tab, const kmp_hdr_t *hdr, uint64_t *val)
+ * @brief 받은 frame 이 stream 의 chunk 인지 확인하고 stream 상태를 갱신하는 함수
+ * KMP_FLAG_MORE 가 있으면 end_id 의 stream 을 (없으면 새로 열어서) 이어 받고, 없으면 열려 있는 stream 의 마지막 chunk 다
+ * 둘 다 아니면 stream 과 상관 없는 보통 메시지다
+ * @return STREAM_RV, stream 이 너무 많으면 OBJECT_ERR, 보낸 쪽이 창을 어겼으면 BUF_ERR
+ * @param tab 연결의 stream 목록
+ * @param hdr 받은 frame 의 헤더 (length 는 헤더 + 바디)
+ * @param val STREAM_CREDIT 이면 돌려줄 바이트 수, STREAM_END 이면 stream 으로 받은 전체 바이트 수
+ */
+int stream_rx_recv( stream_tab_t *tab, const kmp_hdr_t *hdr, uint64_t *val){
+    uint32_t body_len = hdr->length - sizeof( kmp_hdr_t);
+    stream_rx_t *rx = stream_rx_find( tab, hdr->end_id);
+
+    if( rx == NULL){
+        if( ( hdr->flag & KMP_FLAG_MORE) == 0){
+            return STREAM_MSG;
+        }
+        if( tab->num == STREAM_MAX){
+            printf("    | ! Stream : too many streams (max:%d, end_id:%u)\n", STREAM_MAX, hdr->end_id);
+            return OBJECT_ERR;
+        }
+        rx = &tab->rx[ tab->num++];
+        rx->id = hdr->end_id;
+        rx->pending = 0;
+        rx->bytes = 0;
+    }
+
+    rx->bytes += body_len;
+    rx->pending += body_len;
+    if( rx->pending > STREAM_WINDOW){
+        printf("    | ! Stream : flow control window exceeded (end_id:%u, pending:%u)\n", rx->id, rx->pending);
+        return BUF_ERR;
+    }
+
+    if( ( hdr->flag & KMP_FLAG_MORE) == 0){
+        *val = rx->bytes;
+        // 목록 순서는 상관 없으므로 마지막 stream 으로 채운다
+        *rx = tab->rx[ --tab->num];
+        return STREAM_END;
+    }
+    if( rx->pending >= STREAM_CREDIT_THRESHOLD){
+        *val = rx->pending;
+        rx->pending = 0;
+        return STREAM_CREDIT;
+    }
+    return STREAM_CHUNK;
+}
+
+/**
+ * @fn void stream_tx_init( stream_tx_t *tx, uint32_t id, uint32_t code, const char *data, uint64_t len)
+ * @brief 보낼 stream 을 준비하는 함수 (창은 STREAM_WINDOW 로 시작한다)
+ * app_id / hop_id 는 0 이고 필요하면 호출한 쪽이 바꾼다
+ * @return void
+ * @param tx stream 객체
+ * @param id stream id (같은 연결에서 열려 있는 다른 stream 이나 보통 메시지의 end_id 와 겹치면 안 된다)
+ * @param code 명령 코드
+ * @param data 보낼 바디 (다 보낼 때까지 유지해야 한다)
+ * @param len 바디 길이
+ */
+void stream_tx_init( stream_tx_t *tx, uint32_t id, uint32_t code, const char *data, uint64_t len){
+    memset( tx, 0, sizeof( stream_tx_t));
+    tx->id = id;
+    tx->code = code;
+    tx->data = data;
+    tx->len = len;
+    tx->credit = STREAM_WINDOW;
+}
+
+/**
+ * @fn int stream_tx_next( stream_tx_t *tx, char *frame)
+ * @brief 창 안에서 보낼 수 있는 다음 chunk 를 frame 에 만드는 함수
+ * 남은 창이 chunk 하나보다 작으면 만들지 않는다 (작은 chunk 를 여러 번 보내지 않도록 credit 을 기다린다)
+ * @return frame 길이, 다 보냈거나 창이 모자라면 0
+ * @param tx stream 객체
+ * @param frame chunk 를 쓸 버퍼 (sizeof( kmp_t) 이상)
+ */
+int stream_tx_next( stream_tx_t *tx, char *frame){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)frame;
+    uint32_t len;
+
+    if( tx->sent == tx->len){
+        return 0;
+    }
+    len = ( tx->len - tx->sent < STREAM_CHUNK_LEN) ? ( uint32_t)( tx->len - tx->sent) : STREAM_CHUNK_LEN;
+    if( tx->credit < len){
+        return 0;
+    }
+
+    memset( hdr, 0, sizeof( kmp_hdr_t));
+    hdr->version = 1;
+    hdr->length = sizeof( kmp_hdr_t) + len;
+    hdr->code = tx->code;
+    hdr->app_id = tx->app_id;
+    hdr->hop_id = tx->hop_id;
+    hdr->end_id = tx->id;
+    memcpy( &frame[ sizeof( kmp_hdr_t)], &tx->data[ tx->sent], len);
+    tx->sent += len;
+    tx->credit -= len;
+    if( tx->sent < tx->len){
+        hdr->flag = KMP_FLAG_MORE;
+    }
+    return sizeof( kmp_hdr_t) + len;
+}
+
+/**
+ * @fn void stream_tx_credit( stream_tx_t *tx, uint32_t inc)
+ * @brief 받는 쪽이 보낸 KMP_CODE_CREDIT 만큼 창을 늘리는 함수
+ * @return void
+ * @param tx stream 객체
+ * @param inc 늘릴 바이트 수
+ */
+void stream_tx_credit( stream_tx_t *tx, uint32_t inc){
+    tx->credit += inc;
+}
+
+/**
+ * @fn int stream_tx_done( stream_tx_t *tx)
+ * @brief stream 의 chunk 를 모두 보냈는지 확인하는 함수
+ * @return 다 보냈으면 1, 아니면 0
+ * @param tx stream 객체
+ */
+int stream_tx_done( stream_tx_t *tx){
+    return tx->sent == tx->len;
+}
+
+/**
+ * @fn int stream_make_credit( char *frame, const kmp_hdr_t *hdr, uint32_t inc)
+ * @brief 받은 chunk 의 stream 에 창 증가(KMP_CODE_CREDIT) 메시지를 만드는 함수
+ * @return frame 길이
+ * @param frame 메시지를 쓸 버퍼
+ * @param hdr 받은 chunk 의 헤더 (end_id / app_id / hop_id 를 그대로 쓴다)
+ * @param inc 늘릴 바이트 수
+ */
+int stream_make_credit( char *frame, const kmp_hdr_t *hdr, uint32_t inc){
+    memcpy( frame, hdr, sizeof( kmp_hdr_t));
+    ( ( kmp_hdr_t*)frame)->length = sizeof( kmp_hdr_t) + sizeof( inc);
+    ( ( kmp_hdr_t*)frame)->code = KMP_CODE_CREDIT;
+    ( ( kmp_hdr_t*)frame)->flag = 0;
+    memcpy( &frame[ sizeof( kmp_hdr_t)], &inc, sizeof( inc));
+    return sizeof( kmp_hdr_t) + sizeof( inc);
+}
+
+/**
+ * @fn int stream_make_end( char *frame, const kmp_hdr_t *hdr, uint64_t bytes)
+ * @brief 닫힌 stream 의 응답(마지막 chunk 의 헤더 + 받은 전체 바이트 수 uint64)을 만드는 함수
+ * @return frame 길이
+ * @param frame 메시지를 쓸 버퍼
+ * @param hdr 마지막 chunk 의 헤더
+ * @param bytes stream 으로 받은 전체 바이트 수
+ */
+int stream_make_end( char *frame, const kmp_hdr_t *hdr, uint64_t bytes){
+    memcpy( frame, hdr, sizeof( kmp_hdr_t));
+    ( ( kmp_hdr_t*)frame)->length = sizeof( kmp_hdr_t) + sizeof( bytes);
+    ( ( kmp_hdr_t*)frame)->flag = 0;
+    memcpy( &frame[ sizeof( kmp_hdr_t)], &bytes, sizeof( bytes));
+    return sizeof( kmp_hdr_t) + sizeof( bytes);
+}
+
+/**
+ * @fn uint64_t stream_reply_value( const char *frame)
+ * @brief KMP_CODE_CREDIT 의 증가량이나 stream 응답의 전체 바이트 수를 읽는 함수
+ * @return 바디의 값
+ * @param frame stream_make_credit / stream_make_end 로 만든 메시지
+ */
+uint64_t stream_reply_value( const char *frame){
+    uint32_t inc;
+    uint64_t bytes;
+
+    if( ( ( const kmp_hdr_t*)frame)->length == sizeof( kmp_hdr_t) + sizeof( inc)){
+        memcpy( &inc, &frame[ sizeof( kmp_hdr_t)], sizeof( inc));
+        return inc;
+    }
+    memcpy( &bytes, &frame[ sizeof( kmp_hdr_t)], sizeof( bytes));
+    return bytes;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "kmp.h"
+
+/// 연결 하나에서 동시에 열 수 있는 최대 stream 수
+#define STREAM_MAX 16
+/// stream 마다 받는 쪽이 credit 없이 받아 줄 수 있는 최대 바디 바이트 수 (처음 창 크기)
+#define STREAM_WINDOW ( 64 << 10)
+/// 받는 쪽은 아직 돌려주지 않은 바이트가 창의 절반을 넘으면 credit 을 보낸다
+#define STREAM_CREDIT_THRESHOLD ( STREAM_WINDOW / 2)
+/// chunk 하나의 최대 바디 길이
+#define STREAM_CHUNK_LEN DATA_MAX_LEN
+
+/// stream_rx_recv 결과 (받은 frame 을 어떻게 처리했는지)
+enum STREAM_RV{
+    /// stream 에 속하지 않는 보통 메시지 (평소대로 처리하고 응답한다)
+    STREAM_MSG = 0,
+    /// stream 의 chunk 를 받았고 응답하지 않는다
+    STREAM_CHUNK,
+    /// stream 의 chunk 를 받았고 KMP_CODE_CREDIT 으로 창을 늘려 줘야 한다
+    STREAM_CREDIT,
+    /// stream 의 마지막 chunk 를 받았고 stream 이 닫혔다 (받은 전체 바이트 수로 응답한다)
+    STREAM_END
+};
+
+/// @struct stream_rx_t
+/// @brief 받는 쪽에서 열려 있는 stream 하나의 상태 (바디는 chunk 를 처리한 뒤 남기지 않는다)
+typedef struct stream_rx_s stream_rx_t;
+struct stream_rx_s{
+    /// stream id (첫 chunk 의 end_id)
+    uint32_t id;
+    /// 받았지만 아직 credit 으로 돌려주지 않은 바이트 수 (STREAM_WINDOW 를 넘으면 보낸 쪽이 창을 어긴 것이다)
+    uint32_t pending;
+    /// 지금까지 받은 바디 바이트 수
+    uint64_t bytes;
+};
+
+/// @struct stream_tab_t
+/// @brief 연결 하나에서 열려 있는 stream 목록 (첫 chunk 를 받을 때 만든다)
+typedef struct stream_tab_s stream_tab_t;
+struct stream_tab_s{
+    /// 열려 있는 stream 수
+    int num;
+    stream_rx_t rx[ STREAM_MAX];
+};
+
+/// @struct stream_tx_t
+/// @brief 보내는 쪽의 stream 하나. 큰 바디를 STREAM_CHUNK_LEN 이하의 chunk 로 나누고 창 안에서만 보낸다
+/// 마지막이 아닌 chunk 에는 KMP_FLAG_MORE 를 붙이고, 모든 chunk 는 같은 end_id(stream id) 를 쓴다
+typedef struct stream_tx_s stream_tx_t;
+struct stream_tx_s{
+    /// stream id (end_id)
+    uint32_t id;
+    /// 명령 코드 / app_id / hop_id (모든 chunk 가 같은 값을 쓴다)
+    uint32_t code;
+    uint32_t app_id;
+    uint32_t hop_id;
+    /// 보낼 바디 (보내는 동안 호출한 쪽이 가지고 있는다)
+    const char *data;
+    /// 바디 전체 길이 / 보낸 바이트 수
+    uint64_t len;
+    uint64_t sent;
+    /// 받는 쪽이 더 받아 줄 수 있는 바이트 수
+    uint32_t credit;
+};
+
+stream_tab_t* stream_tab_init();
+void stream_tab_destroy( stream_tab_t *tab);
+int stream_rx_is_chunk( const stream_tab_t *tab, const kmp_hdr_t *hdr);
+int stream_rx_recv( stream_tab_t *tab, const kmp_hdr_t *hdr, uint64_t *val);
+void stream_tx_init( stream_tx_t *tx, uint32_t id, uint32_t code, const char *data, uint64_t len);
+int stream_tx_next( stream_tx_t *tx, char *frame);
+void stream_tx_credit( stream_tx_t *tx, uint32_t inc);
+int stream_tx_done( stream_tx_t *tx);
+int stream_make_credit( char *frame, const kmp_hdr_t *hdr, uint32_t inc);
+int stream_make_end( char *frame, const kmp_hdr_t *hdr, uint64_t bytes);
+uint64_t stream_reply_value( const char *frame);
+
+#endif
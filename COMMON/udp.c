@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+#include "udp.h"
+
+/**
+ * @fn udp_t* udp_open( const char *ip, int port)
+ * @brief UDP 소켓을 열고 batch 버퍼를 준비하는 함수 (non-blocking)
+ * @return 생성된 객체, 실패하면 NULL
+ * @param ip bind 할 주소 (NULL 이면 bind 하지 않는다, 보내기만 하는 client)
+ * @param port bind 할 port
+ */
+udp_t* udp_open( const char *ip, int port){
+    struct sockaddr_in addr;
+    int buf_len = UDP_SOCK_BUF_LEN;
+    udp_t *udp;
+    int i;
+
+    if( ( udp = ( udp_t*)calloc( 1, sizeof( udp_t))) == NULL){
+        printf("    | ! UDP : Failed to allocate memory\n");
+        return NULL;
+    }
+    if( ( udp->fd = socket( AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0){
+        printf("    | ! UDP : Failed to open socket (errno:%d)\n", errno);
+        free( udp);
+        return NULL;
+    }
+    setsockopt( udp->fd, SOL_SOCKET, SO_RCVBUF, &buf_len, sizeof( buf_len));
+    setsockopt( udp->fd, SOL_SOCKET, SO_SNDBUF, &buf_len, sizeof( buf_len));
+
+    if( ip != NULL){
+        memset( &addr, 0, sizeof( addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr( ip);
+        addr.sin_port = htons( port);
+        if( bind( udp->fd, ( struct sockaddr*)&addr, sizeof( addr)) < 0){
+            printf("    | ! UDP : Failed to bind %s:%d (errno:%d)\n", ip, port, errno);
+            udp_close( udp);
+            return NULL;
+        }
+    }
+
+    // 받는 쪽 mmsghdr 는 매번 같은 버퍼를 가리키므로 한 번만 채운다 (msg_namelen 만 recvmmsg 가 바꾼다)
+    for( i = 0; i < UDP_BATCH_MAX; i++){
+        udp->riovs[ i].iov_base = udp->rbufs[ i];
+        udp->riovs[ i].iov_len = UDP_FRAME_MAX;
+        udp->rmsgs[ i].msg_hdr.msg_iov = &udp->riovs[ i];
+        udp->rmsgs[ i].msg_hdr.msg_iovlen = 1;
+        udp->rmsgs[ i].msg_hdr.msg_name = &udp->raddrs[ i];
+        udp->siovs[ i].iov_base = udp->sbufs[ i];
+        udp->smsgs[ i].msg_hdr.msg_iov = &udp->siovs[ i];
+        udp->smsgs[ i].msg_hdr.msg_iovlen = 1;
+        udp->smsgs[ i].msg_hdr.msg_name = &udp->saddrs[ i];
+        udp->smsgs[ i].msg_hdr.msg_namelen = sizeof( struct sockaddr_in);
+    }
+    return udp;
+}
+
+/**
+ * @fn void udp_close( udp_t *udp)
+ * @brief UDP 소켓을 닫고 객체를 해제하는 함수 (보내지 않은 datagram 은 버린다)
+ * @return void
+ * @param udp UDP 객체 (NULL 이면 아무 것도 하지 않는다)
+ */
+void udp_close( udp_t *udp){
+    if( udp == NULL){
+        return;
+    }
+    if( udp->fd >= 0){
+        close( udp->fd);
+    }
+    free( udp);
+}
+
+/**
+ * @fn int udp_recv( udp_t *udp)
+ * @brief recvmmsg 한 번으로 도착한 datagram 을 최대 UDP_BATCH_MAX 개 받는 함수
+ * @return 받은 datagram 수 (없으면 0), 실패하면 SOC_ERR
+ * @param udp UDP 객체 (받은 datagram 은 rbufs / rmsgs / raddrs 에 있다)
+ */
+int udp_recv( udp_t *udp){
+    int i, n;
+
+    for( i = 0; i < UDP_BATCH_MAX; i++){
+        udp->rmsgs[ i].msg_hdr.msg_namelen = sizeof( struct sockaddr_in);
+    }
+    if( ( n = recvmmsg( udp->fd, udp->rmsgs, UDP_BATCH_MAX, MSG_DONTWAIT, NULL)) < 0){
+        if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK) || ( errno == EINTR)){
+            return 0;
+        }
+        printf("    | ! UDP : recvmmsg error (errno:%d)\n", errno);
+        return SOC_ERR;
+    }
+    udp->recv_calls++;
+    udp->recv_datagrams += n;
+    return n;
+}
+
+/**
+ * @fn int udp_frame_check( udp_t *udp, int i)
+ * @brief 받은 i 번째 datagram 이 kmp 메시지 하나와 정확히 맞는지 확인하는 함수
+ * datagram 은 잘리거나 합쳐지지 않으므로 헤더의 길이가 datagram 길이와 다르면 버린다
+ * @return 메시지 길이, 맞지 않으면 BUF_ERR
+ * @param udp UDP 객체
+ * @param i udp_recv 로 받은 datagram 순서
+ */
+int udp_frame_check( udp_t *udp, int i){
+    int len = udp->rmsgs[ i].msg_len;
+
+    if( ( len < ( int)sizeof( kmp_hdr_t)) || ( udp->rmsgs[ i].msg_hdr.msg_flags & MSG_TRUNC)
+            || ( ( ( kmp_hdr_t*)udp->rbufs[ i])->length != ( uint32_t)len)){
+        udp->malformed++;
+        return BUF_ERR;
+    }
+    return len;
+}
+
+/**
+ * @fn int udp_send( udp_t *udp, const void *frame, int len, const struct sockaddr_in *to)
+ * @brief 보낼 datagram 하나를 batch 에 쌓는 함수 (batch 가 차면 udp_flush 로 보낸다)
+ * @return 정상이면 NORMAL, 메시지가 너무 길면 BUF_ERR, 보내다 실패하면 SOC_ERR
+ * @param udp UDP 객체
+ * @param frame 보낼 kmp 메시지
+ * @param len 메시지 길이 (UDP_FRAME_MAX 이하)
+ * @param to 받을 주소
+ */
+int udp_send( udp_t *udp, const void *frame, int len, const struct sockaddr_in *to){
+    if( ( len <= 0) || ( len > UDP_FRAME_MAX)){
+        return BUF_ERR;
+    }
+    if( ( udp->send_num == UDP_BATCH_MAX) && ( udp_flush( udp) < NORMAL)){
+        return SOC_ERR;
+    }
+    memcpy( udp->sbufs[ udp->send_num], frame, len);
+    udp->siovs[ udp->send_num].iov_len = len;
+    udp->saddrs[ udp->send_num] = *to;
+    udp->send_num++;
+    return NORMAL;
+}
+
+/**
+ * @fn int udp_flush( udp_t *udp)
+ * @brief 쌓아 둔 datagram 을 sendmmsg 로 보내는 함수
+ * 송신 버퍼가 차서 보내지 못한 datagram 은 다시 시도하지 않고 버린다 (UDP 는 손실을 허용한다)
+ * @return 보낸 datagram 수, 실패하면 SOC_ERR
+ * @param udp UDP 객체
+ */
+int udp_flush( udp_t *udp){
+    int sent = 0, n;
+
+    while( sent < udp->send_num){
+        if( ( n = sendmmsg( udp->fd, &udp->smsgs[ sent], udp->send_num - sent, MSG_DONTWAIT)) < 0){
+            if( errno == EINTR){
+                continue;
+            }
+            if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK) || ( errno == ENOBUFS)){
+                break;
+            }
+            printf("    | ! UDP : sendmmsg error (errno:%d)\n", errno);
+            udp->send_num = 0;
+            return SOC_ERR;
+        }
+        udp->send_calls++;
+        sent += n;
+    }
+    udp->sent_datagrams += sent;
+    udp->send_drops += udp->send_num - sent;
+    udp->send_num = 0;
+    return sent;
+}
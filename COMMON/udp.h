@@ -0,0 +1,66 @@
+#pragma once
+#ifndef __UDP_H__
+#define __UDP_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "common.h"
+#include "kmp.h"
+
+/// recvmmsg / sendmmsg 한 번에 주고 받는 최대 datagram 수
+#define UDP_BATCH_MAX 64
+/// datagram 하나에 들어가는 최대 kmp 메시지 길이 (메시지 하나가 datagram 하나다)
+#define UDP_FRAME_MAX ( ( int)sizeof( kmp_t))
+/// 소켓 송수신 버퍼 크기 (batch 사이에 쌓이는 datagram 이 버려지지 않게 넉넉히 잡는다)
+#define UDP_SOCK_BUF_LEN ( 4 << 20)
+
+/// @struct udp_t
+/// @brief kmp 메시지를 datagram 하나에 하나씩 batch 로 주고 받는 UDP 소켓
+/// server 와 client 가 같이 쓰며, server 에서는 epoll data.ptr 가 직접 가리킨다
+/// struct mmsghdr 를 쓰므로 이 헤더를 include 하는 파일은 맨 앞에 _GNU_SOURCE 를 정의해야 한다
+typedef struct udp_s udp_t;
+struct udp_s{
+    /// epoll 이벤트 종류 (사용하는 쪽에서 정한다, 첫 번째 멤버)
+    int type;
+    /// UDP 소켓
+    int fd;
+    /// 받은 datagram (udp_recv 가 채운다, i 번째 길이는 rmsgs[ i].msg_len)
+    struct mmsghdr rmsgs[ UDP_BATCH_MAX];
+    struct iovec riovs[ UDP_BATCH_MAX];
+    struct sockaddr_in raddrs[ UDP_BATCH_MAX];
+    char rbufs[ UDP_BATCH_MAX][ UDP_FRAME_MAX];
+    /// 보낼 datagram (udp_send 로 쌓고 udp_flush 로 보낸다)
+    struct mmsghdr smsgs[ UDP_BATCH_MAX];
+    struct iovec siovs[ UDP_BATCH_MAX];
+    struct sockaddr_in saddrs[ UDP_BATCH_MAX];
+    char sbufs[ UDP_BATCH_MAX][ UDP_FRAME_MAX];
+    int send_num;
+    /// 받은 / 보낸 datagram 수
+    uint64_t recv_datagrams;
+    uint64_t sent_datagrams;
+    /// recvmmsg / sendmmsg 호출 수
+    uint64_t recv_calls;
+    uint64_t send_calls;
+    /// 길이가 맞지 않아 버린 datagram 수 / 송신 버퍼가 차서 버린 datagram 수
+    uint64_t malformed;
+    uint64_t send_drops;
+};
+
+udp_t* udp_open( const char *ip, int port);
+void udp_close( udp_t *udp);
+int udp_recv( udp_t *udp);
+int udp_frame_check( udp_t *udp, int i);
+int udp_send( udp_t *udp, const void *frame, int len, const struct sockaddr_in *to);
+int udp_flush( udp_t *udp);
+
+#endif
@@ -0,0 +1,160 @@
+#include "admit.h"
+
+/**
+ * @fn uint64_t admit_now_us()
+ * @brief monotonic clock 기준 현재 시각을 us 단위로 구하는 함수
+ * @return 현재 시각 (us)
+ */
+uint64_t admit_now_us(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @fn static admit_bucket_t* admit_get_bucket( admit_t *admit, uint32_t app_id, uint64_t now)
+ * @brief app_id 의 token bucket 을 찾는 함수 (처음 보는 app_id 면 가득 찬 bucket 을 만든다)
+ * @return token bucket
+ */
+static admit_bucket_t* admit_get_bucket( admit_t *admit, uint32_t app_id, uint64_t now){
+    uint32_t h = app_id * 0x9E3779B1U;
+    admit_bucket_t *bucket;
+    int i;
+
+    h ^= h >> 16;
+    for( i = 0; i < ADMIT_PROBE_MAX; i++){
+        bucket = &admit->buckets[ ( h + i) & ( ADMIT_APP_MAX - 1)];
+        if( bucket->is_used && ( bucket->app_id == app_id)){
+            return bucket;
+        }
+        if( bucket->is_used == 0){
+            break;
+        }
+    }
+    if( i == ADMIT_PROBE_MAX){
+        bucket = &admit->buckets[ h & ( ADMIT_APP_MAX - 1)];
+    }
+
+    bucket->is_used = 1;
+    bucket->app_id = app_id;
+    bucket->tokens = admit->burst;
+    bucket->last_us = now;
+    return bucket;
+}
+
+/**
+ * @fn admit_t* admit_init( double rate, double burst, uint64_t target_us)
+ * @brief admission control 객체를 생성하는 함수
+ * @return 생성된 객체, 실패하면 NULL
+ * @param rate app_id 하나에 허용하는 초당 요청 수 (0이면 제한 없음)
+ * @param burst token bucket 크기 (0이면 rate 의 1/10, 최소 1)
+ * @param target_us 목표 queueing delay (us, 0이면 전역 한도 없음)
+ */
+admit_t* admit_init( double rate, double burst, uint64_t target_us){
+    admit_t *admit = ( admit_t*)calloc( 1, sizeof( admit_t));
+
+    if( admit == NULL){
+        printf("    | ! Admit : Failed to allocate memory\n");
+        return NULL;
+    }
+    admit->rate = rate;
+    admit->burst = ( burst > 0) ? burst : ( ( rate / 10 > 1) ? rate / 10 : 1);
+    admit->target_us = target_us;
+    admit->limit = ADMIT_LIMIT_INIT;
+    return admit;
+}
+
+/**
+ * @fn void admit_destroy( admit_t *admit)
+ * @brief admission control 객체를 해제하는 함수
+ * @return void
+ */
+void admit_destroy( admit_t *admit){
+    free( admit);
+}
+
+/**
+ * @fn int admit_check( admit_t *admit, uint32_t app_id, int outstanding)
+ * @brief 헤더를 받은 요청을 처리할지 정하는 함수 (거절하면 바디는 처리하지 않고 바로 거절 응답을 보낸다)
+ * @return ADMIT_OK / ADMIT_REJECT_RATE / ADMIT_REJECT_LOAD
+ * @param admit admission control 객체
+ * @param app_id 요청의 app_id
+ * @param outstanding 이전 batch 에서 받아들였지만 아직 응답하지 않은 요청 수 (upstream 대기 등)
+ */
+int admit_check( admit_t *admit, uint32_t app_id, int outstanding){
+    admit_bucket_t *bucket;
+    uint64_t now;
+    int concurrency;
+
+    if( admit->rate > 0){
+        now = admit_now_us();
+        bucket = admit_get_bucket( admit, app_id, now);
+        bucket->tokens += ( double)( now - bucket->last_us) * admit->rate / 1e6;
+        if( bucket->tokens > admit->burst){
+            bucket->tokens = admit->burst;
+        }
+        bucket->last_us = now;
+        if( bucket->tokens < 1){
+            admit->rejected_rate++;
+            return ADMIT_REJECT_RATE;
+        }
+        bucket->tokens -= 1;
+    }
+
+    if( admit->target_us > 0){
+        concurrency = outstanding + admit->batch_admitted;
+        if( concurrency >= admit->limit){
+            admit->rejected_load++;
+            return ADMIT_REJECT_LOAD;
+        }
+        if( concurrency + 1 > admit->batch_peak){
+            admit->batch_peak = concurrency + 1;
+        }
+    }
+
+    admit->batch_admitted++;
+    admit->admitted++;
+    return ADMIT_OK;
+}
+
+/**
+ * @fn void admit_batch_begin( admit_t *admit)
+ * @brief epoll_wait 가 이벤트를 돌려준 직후에 호출하는 함수
+ * @return void
+ */
+void admit_batch_begin( admit_t *admit){
+    admit->batch_start_us = admit_now_us();
+    admit->batch_admitted = 0;
+    admit->batch_peak = 0;
+}
+
+/**
+ * @fn void admit_batch_end( admit_t *admit)
+ * @brief batch 처리가 끝난 뒤 queueing delay 를 갱신하고 전역 한도를 조절하는 함수 (AIMD)
+ * batch 처리 시간은 이번 batch 에서 준비된 소켓이 처리를 기다린 최대 시간이다
+ * 평균이 목표를 넘으면 한도를 10% 줄이고, 한도까지 쓴 batch 가 목표 안에 끝나면 1 늘린다
+ * @return void
+ */
+void admit_batch_end( admit_t *admit){
+    uint64_t now, batch_us;
+
+    if( admit->target_us == 0){
+        return;
+    }
+    now = admit_now_us();
+    batch_us = now - admit->batch_start_us;
+    admit->delay_us = ( admit->delay_us * 7 + batch_us) / 8;
+
+    if( admit->delay_us > admit->target_us){
+        if( now - admit->last_decrease_us >= ADMIT_DECREASE_US){
+            admit->limit = admit->limit * 9 / 10;
+            if( admit->limit < ADMIT_LIMIT_MIN){
+                admit->limit = ADMIT_LIMIT_MIN;
+            }
+            admit->last_decrease_us = now;
+        }
+    }
+    else if( ( admit->batch_peak >= admit->limit) && ( admit->limit < ADMIT_LIMIT_MAX)){
+        admit->limit++;
+    }
+}
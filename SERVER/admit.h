@@ -0,0 +1,87 @@
+#pragma once
+#ifndef __ADMIT_H__
+#define __ADMIT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../COMMON/common.h"
+
+/// token bucket 을 유지하는 app_id 수 (2의 거듭제곱)
+#define ADMIT_APP_MAX 4096
+/// 빈 자리를 찾을 때 확인하는 최대 slot 수 (모두 차 있으면 첫 slot을 다른 app_id에 넘긴다)
+#define ADMIT_PROBE_MAX 8
+/// 전역 동시 처리 한도의 최소 / 최대 / 시작 값
+#define ADMIT_LIMIT_MIN 4
+#define ADMIT_LIMIT_MAX 4096
+#define ADMIT_LIMIT_INIT 64
+/// 한도를 줄인 뒤 다시 줄이기까지 기다리는 시간 (us)
+#define ADMIT_DECREASE_US 10000
+
+/// admit_check() 결과
+enum ADMIT_RESULT{
+    /// 처리한다
+    ADMIT_OK = 0,
+    /// app_id 의 token bucket 이 비었다
+    ADMIT_REJECT_RATE,
+    /// 전역 동시 처리 한도를 넘었다
+    ADMIT_REJECT_LOAD
+};
+
+/// @struct admit_bucket_t
+/// @brief app_id 하나의 token bucket
+typedef struct admit_bucket_s admit_bucket_t;
+struct admit_bucket_s{
+    /// app_id
+    uint32_t app_id;
+    /// 사용 중인 slot 인지 여부
+    int is_used;
+    /// 남은 token 수
+    double tokens;
+    /// 마지막으로 token 을 채운 시각 (us)
+    uint64_t last_us;
+};
+
+/// @struct admit_t
+/// @brief app_id 별 처리율 제한과 queueing delay 에 맞춰 움직이는 전역 동시 처리 한도
+typedef struct admit_s admit_t;
+struct admit_s{
+    /// app_id 하나에 허용하는 초당 요청 수 (0이면 제한 없음)
+    double rate;
+    /// token bucket 크기 (순간적으로 허용하는 요청 수)
+    double burst;
+    /// app_id 별 token bucket
+    admit_bucket_t buckets[ ADMIT_APP_MAX];
+    /// 목표 queueing delay (us, 0이면 전역 한도 없음)
+    uint64_t target_us;
+    /// 현재 전역 동시 처리 한도
+    int limit;
+    /// 이번 event loop batch 에서 받아들인 요청 수
+    int batch_admitted;
+    /// 이번 batch 중 동시 처리 수의 최대값
+    int batch_peak;
+    /// 이번 batch 가 시작된 시각 (us)
+    uint64_t batch_start_us;
+    /// batch 처리 시간의 지수 이동 평균 (us, queueing delay 추정값)
+    uint64_t delay_us;
+    /// 마지막으로 한도를 줄인 시각 (us)
+    uint64_t last_decrease_us;
+    /// 받아들인 요청 수
+    uint64_t admitted;
+    /// 처리율 제한으로 거절한 요청 수
+    uint64_t rejected_rate;
+    /// 전역 한도로 거절한 요청 수
+    uint64_t rejected_load;
+};
+
+admit_t* admit_init( double rate, double burst, uint64_t target_us);
+void admit_destroy( admit_t *admit);
+uint64_t admit_now_us();
+int admit_check( admit_t *admit, uint32_t app_id, int outstanding);
+void admit_batch_begin( admit_t *admit);
+void admit_batch_end( admit_t *admit);
+
+#endif
@@ -0,0 +1,315 @@
+#include "blob.h"
+
+/**
+ * @fn static uint64_t blob_hash( const char *name, int name_len)
+ * @brief blob 이름의 64 bit hash 를 구하는 함수 (FNV-1a + murmur3 fmix64)
+ * @return hash 값
+ */
+static uint64_t blob_hash( const char *name, int name_len){
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+
+    for( i = 0; i < name_len; i++){
+        h ^= ( uint8_t)name[ i];
+        h *= 1099511628211ULL;
+    }
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * @fn static uint64_t blob_now_ms()
+ * @brief metadata 확인 간격을 재는 현재 시각을 구하는 함수 (coarse clock 이라 system call 을 하지 않는다)
+ * @return 현재 시각 (ms)
+ */
+static uint64_t blob_now_ms(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC_COARSE, &ts);
+    return ( uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @fn static int blob_name_check( const char *name, int name_len)
+ * @brief 요청 바디가 blob 디렉토리 안의 파일 이름인지 확인하는 함수
+ * '/' 가 있거나 '.' 으로 시작하는 이름 ("..", 숨김 파일) 과 NUL 이 섞인 이름은 받지 않는다
+ * @return 맞으면 NORMAL, 아니면 NOT_EXIST
+ */
+static int blob_name_check( const char *name, int name_len){
+    if( ( name_len <= 0) || ( name_len > BLOB_NAME_MAX) || ( name[ 0] == '.')){
+        return NOT_EXIST;
+    }
+    if( ( memchr( name, '/', name_len) != NULL) || ( memchr( name, '\0', name_len) != NULL)){
+        return NOT_EXIST;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static void blob_lru_unlink( blob_tab_t *tab, blob_t *blob)
+ * @brief blob 을 LRU 목록에서 빼는 함수
+ */
+static void blob_lru_unlink( blob_tab_t *tab, blob_t *blob){
+    if( blob->lru_prev != NULL){
+        blob->lru_prev->lru_next = blob->lru_next;
+    }
+    else{
+        tab->lru_head = blob->lru_next;
+    }
+    if( blob->lru_next != NULL){
+        blob->lru_next->lru_prev = blob->lru_prev;
+    }
+    else{
+        tab->lru_tail = blob->lru_prev;
+    }
+}
+
+/**
+ * @fn static void blob_lru_push( blob_tab_t *tab, blob_t *blob)
+ * @brief blob 을 LRU 목록 맨 앞에 넣는 함수
+ */
+static void blob_lru_push( blob_tab_t *tab, blob_t *blob){
+    blob->lru_prev = NULL;
+    blob->lru_next = tab->lru_head;
+    if( tab->lru_head != NULL){
+        tab->lru_head->lru_prev = blob;
+    }
+    tab->lru_head = blob;
+    if( tab->lru_tail == NULL){
+        tab->lru_tail = blob;
+    }
+}
+
+/**
+ * @fn static void blob_remove( blob_tab_t *tab, blob_t *blob)
+ * @brief blob 을 hash / LRU 에서 빼고 table 의 참조를 놓는 함수 (보내는 중인 응답은 참조 수로 남는다)
+ */
+static void blob_remove( blob_tab_t *tab, blob_t *blob){
+    blob_t **link = &tab->buckets[ blob->hash & ( BLOB_BUCKET_NUM - 1)];
+
+    while( *link != NULL){
+        if( *link == blob){
+            *link = blob->hash_next;
+            break;
+        }
+        link = &( *link)->hash_next;
+    }
+    blob_lru_unlink( tab, blob);
+    tab->num--;
+    blob_put( blob);
+}
+
+/**
+ * @fn static blob_t* blob_open( blob_tab_t *tab, uint64_t hash, const char *name, int name_len)
+ * @brief blob 파일을 열어서 table 에 넣는 함수 (최대 수를 넘으면 가장 오래 쓰지 않은 blob 을 닫는다)
+ * 일반 파일만 열고 symbolic link 는 따라가지 않는다
+ * @return blob, 열 수 없으면 NULL
+ */
+static blob_t* blob_open( blob_tab_t *tab, uint64_t hash, const char *name, int name_len){
+    char path[ BLOB_NAME_MAX + 1];
+    struct stat st;
+    blob_t *blob;
+    int fd;
+
+    memcpy( path, name, name_len);
+    path[ name_len] = '\0';
+    if( ( fd = openat( tab->dir_fd, path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK)) < 0){
+        return NULL;
+    }
+    if( ( fstat( fd, &st) < 0) || !S_ISREG( st.st_mode) || ( st.st_size > BLOB_SIZE_MAX)){
+        close( fd);
+        return NULL;
+    }
+    if( ( blob = ( blob_t*)malloc( sizeof( blob_t) + name_len)) == NULL){
+        printf("    | ! Blob : Failed to allocate memory\n");
+        close( fd);
+        return NULL;
+    }
+    blob->refcnt = 1;
+    blob->fd = fd;
+    blob->size = ( int)st.st_size;
+    blob->is_crc = 0;
+    blob->dev = st.st_dev;
+    blob->ino = st.st_ino;
+    blob->mtime = st.st_mtim;
+    blob->checked_ms = blob_now_ms();
+    blob->hash = hash;
+    blob->name_len = name_len;
+    memcpy( blob->name, name, name_len);
+
+    blob->hash_next = tab->buckets[ hash & ( BLOB_BUCKET_NUM - 1)];
+    tab->buckets[ hash & ( BLOB_BUCKET_NUM - 1)] = blob;
+    blob_lru_push( tab, blob);
+    tab->num++;
+    tab->opens++;
+    if( tab->num > tab->max){
+        blob_remove( tab, tab->lru_tail);
+    }
+    return blob;
+}
+
+/**
+ * @fn static int blob_is_stale( blob_tab_t *tab, blob_t *blob)
+ * @brief 열어 둔 blob 의 파일이 바뀌었는지 BLOB_CHECK_MS 마다 한 번 확인하는 함수
+ * 같은 이름에 다른 파일을 옮겨 놓았거나 (rename) 파일을 고쳤거나 지웠으면 바뀐 것이다
+ * @return 바뀌었으면 1, 아니면 0
+ */
+static int blob_is_stale( blob_tab_t *tab, blob_t *blob){
+    char path[ BLOB_NAME_MAX + 1];
+    struct stat st;
+    uint64_t now = blob_now_ms();
+
+    if( now - blob->checked_ms < BLOB_CHECK_MS){
+        return 0;
+    }
+    memcpy( path, blob->name, blob->name_len);
+    path[ blob->name_len] = '\0';
+    if( fstatat( tab->dir_fd, path, &st, AT_SYMLINK_NOFOLLOW) < 0){
+        return 1;
+    }
+    if( ( st.st_dev != blob->dev) || ( st.st_ino != blob->ino) || ( st.st_size != blob->size)
+            || ( st.st_mtim.tv_sec != blob->mtime.tv_sec) || ( st.st_mtim.tv_nsec != blob->mtime.tv_nsec)){
+        return 1;
+    }
+    blob->checked_ms = now;
+    return 0;
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn blob_tab_t* blob_tab_init( const char *dir, int max)
+ * @brief blob 디렉토리를 열고 blob 목록을 만드는 함수
+ * @return 생성된 객체, 실패하면 NULL
+ * @param dir blob 디렉토리
+ * @param max 열어 두는 최대 blob 수
+ */
+blob_tab_t* blob_tab_init( const char *dir, int max){
+    blob_tab_t *tab;
+
+    if( ( max <= 0) || ( max > BLOB_OPEN_MAX)){
+        printf("    | ! Blob : open blob count must be 1 ~ %d (%d)\n", BLOB_OPEN_MAX, max);
+        return NULL;
+    }
+    if( ( tab = ( blob_tab_t*)calloc( 1, sizeof( blob_tab_t))) == NULL){
+        printf("    | ! Blob : Failed to allocate memory\n");
+        return NULL;
+    }
+    if( ( tab->dir_fd = open( dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0){
+        printf("    | ! Blob : Failed to open directory (%s) (errno:%d)\n", dir, errno);
+        free( tab);
+        return NULL;
+    }
+    snprintf( tab->dir, sizeof( tab->dir), "%s", dir);
+    tab->max = max;
+    return tab;
+}
+
+/**
+ * @fn void blob_tab_destroy( blob_tab_t *tab)
+ * @brief 열어 둔 blob 을 모두 닫고 blob 목록을 해제하는 함수 (보내는 중인 blob 은 그 연결이 놓을 때 닫힌다)
+ * @return void
+ * @param tab blob 목록 (NULL 이면 아무 것도 하지 않는다)
+ */
+void blob_tab_destroy( blob_tab_t *tab){
+    if( tab == NULL){
+        return;
+    }
+    while( tab->lru_head != NULL){
+        blob_remove( tab, tab->lru_head);
+    }
+    close( tab->dir_fd);
+    free( tab);
+}
+
+/**
+ * @fn blob_t* blob_get( blob_tab_t *tab, const char *name, int name_len)
+ * @brief 이름으로 blob 을 찾는 함수. 열어 둔 fd 가 있으면 그대로 쓰고, 없거나 파일이 바뀌었으면 새로 연다
+ * @return 참조 하나를 늘린 blob (다 보내면 blob_put 으로 놓는다), 없거나 보낼 수 없는 이름이면 NULL
+ * @param tab blob 목록
+ * @param name 요청 바디 (NUL 로 끝나지 않아도 된다)
+ * @param name_len 이름 길이
+ */
+blob_t* blob_get( blob_tab_t *tab, const char *name, int name_len){
+    blob_t *blob;
+    uint64_t hash;
+
+    if( blob_name_check( name, name_len) < NORMAL){
+        tab->misses++;
+        return NULL;
+    }
+    hash = blob_hash( name, name_len);
+    for( blob = tab->buckets[ hash & ( BLOB_BUCKET_NUM - 1)]; blob != NULL; blob = blob->hash_next){
+        if( ( blob->hash == hash) && ( blob->name_len == name_len) && ( memcmp( blob->name, name, name_len) == 0)){
+            break;
+        }
+    }
+    if( ( blob != NULL) && blob_is_stale( tab, blob)){
+        blob_remove( tab, blob);
+        blob = NULL;
+    }
+    if( blob != NULL){
+        tab->hits++;
+        blob_lru_unlink( tab, blob);
+        blob_lru_push( tab, blob);
+    }
+    else if( ( blob = blob_open( tab, hash, name, name_len)) == NULL){
+        tab->misses++;
+        return NULL;
+    }
+    blob->refcnt++;
+    return blob;
+}
+
+/**
+ * @fn void blob_put( blob_t *blob)
+ * @brief blob 의 참조를 하나 놓는 함수 (마지막 참조면 파일을 닫고 해제한다)
+ * @return void
+ * @param blob 놓을 blob
+ */
+void blob_put( blob_t *blob){
+    if( --blob->refcnt == 0){
+        close( blob->fd);
+        free( blob);
+    }
+}
+
+/**
+ * @fn int blob_crc( blob_t *blob, uint32_t *crc)
+ * @brief blob 파일 내용의 CRC32C 를 구하는 함수 (처음 한 번만 파일을 읽고 이후에는 저장한 값을 쓴다)
+ * 응답의 trailer 는 헤더의 CRC32C 와 이 값을 crc32c_combine 으로 합쳐서 만들므로 보낼 때 파일을 다시 읽지 않는다
+ * @return 정상이면 NORMAL, 파일을 끝까지 읽지 못하면 FD_ERR
+ * @param blob blob
+ * @param crc 파일 내용의 CRC32C 를 저장할 변수
+ */
+int blob_crc( blob_t *blob, uint32_t *crc){
+    char buf[ BLOB_CRC_CHUNK];
+    uint32_t value = 0;
+    ssize_t n;
+    int offset = 0;
+
+    if( blob->is_crc == 0){
+        while( offset < blob->size){
+            n = pread( blob->fd, buf, ( blob->size - offset < BLOB_CRC_CHUNK) ? blob->size - offset : BLOB_CRC_CHUNK, offset);
+            if( n < 0){
+                if( errno == EINTR){
+                    continue;
+                }
+                return FD_ERR;
+            }
+            if( n == 0){
+                return FD_ERR;
+            }
+            value = crc32c_update( value, buf, n);
+            offset += n;
+        }
+        blob->crc = value;
+        blob->is_crc = 1;
+    }
+    *crc = blob->crc;
+    return NORMAL;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#ifndef __BLOB_H__
+#define __BLOB_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+#include "../COMMON/crc32c.h"
+
+/// blob 이름 (요청 바디) 의 최대 길이
+#define BLOB_NAME_MAX 255
+/// 이름 hash bucket 수 (2의 거듭제곱)
+#define BLOB_BUCKET_NUM 1024
+/// event loop 하나가 열어 두는 기본 최대 blob 수 (-O dir[:num])
+#define BLOB_OPEN_DEFAULT 256
+#define BLOB_OPEN_MAX 65536
+/// 열어 둔 blob 의 파일이 바뀌었는지 다시 확인하는 간격 (ms)
+#define BLOB_CHECK_MS 1000
+/// 응답 하나에 담을 수 있는 최대 파일 크기 (헤더 length 가 24 bit 다. CRC32C trailer 를 붙일 자리를 남긴다)
+#define BLOB_SIZE_MAX ( 0xFFFFFF - ( int)sizeof( kmp_hdr_t) - KMP_CRC_LEN)
+/// 파일 내용의 CRC32C 를 계산할 때 한 번에 읽는 크기
+#define BLOB_CRC_CHUNK 65536
+
+/// @struct blob_t
+/// @brief 열어 둔 blob 파일 하나와 그 metadata. 보내는 중인 연결마다 참조를 늘리므로
+/// 파일이 바뀌거나 LRU 에서 밀려나도 보내던 응답은 처음 연 파일로 끝까지 나간다
+typedef struct blob_s blob_t;
+struct blob_s{
+    /// 참조 수 (table 에 들어 있으면 1 + 보내는 중인 연결 수)
+    int refcnt;
+    /// 열어 둔 파일 (sendfile 로 보낸다)
+    int fd;
+    /// 파일 크기 (연 시점)
+    int size;
+    /// 바뀌었는지 비교하는 파일 metadata
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    /// 파일 내용의 CRC32C 와 계산했는지 여부 (KMP_FLAG_CRC 요청을 처음 받을 때 한 번 계산한다)
+    uint32_t crc;
+    int is_crc;
+    /// 마지막으로 metadata 를 확인한 시각 (ms)
+    uint64_t checked_ms;
+    /// 이름 hash / 같은 bucket 의 다음 blob
+    uint64_t hash;
+    blob_t *hash_next;
+    /// LRU 목록 (앞쪽이 최근에 쓴 blob)
+    blob_t *lru_prev;
+    blob_t *lru_next;
+    /// 이름
+    int name_len;
+    char name[];
+};
+
+/// @struct blob_tab_t
+/// @brief event loop 하나가 blob 디렉토리에서 열어 둔 blob 목록 (fd / metadata cache)
+typedef struct blob_tab_s blob_tab_t;
+struct blob_tab_s{
+    /// blob 디렉토리 (openat 의 기준, 이름에 '/' 를 받지 않으므로 밖으로 나갈 수 없다)
+    int dir_fd;
+    char dir[ PATH_MAX];
+    /// 열어 두는 최대 blob 수
+    int max;
+    /// 이름 hash
+    blob_t *buckets[ BLOB_BUCKET_NUM];
+    /// LRU 의 처음 / 마지막 blob
+    blob_t *lru_head;
+    blob_t *lru_tail;
+    /// 열어 둔 blob 수
+    int num;
+    /// 열어 둔 fd 로 보낸 요청 수 / 파일을 새로 연 수 / 없거나 보낼 수 없는 이름 요청 수 / 보낸 파일 바이트 수
+    uint64_t hits;
+    uint64_t opens;
+    uint64_t misses;
+    uint64_t bytes;
+};
+
+blob_tab_t* blob_tab_init( const char *dir, int max);
+void blob_tab_destroy( blob_tab_t *tab);
+blob_t* blob_get( blob_tab_t *tab, const char *name, int name_len);
+void blob_put( blob_t *blob);
+int blob_crc( blob_t *blob, uint32_t *crc);
+
+#endif
@@ -0,0 +1,359 @@
+#include "cache.h"
+
+/**
+ * @fn static uint64_t cache_hash( uint32_t code, uint32_t app_id, const char *body, int body_len)
+ * @brief (code, app_id, body) key 의 64 bit hash 를 구하는 함수 (FNV-1a + murmur3 fmix64)
+ * @return hash 값
+ */
+static uint64_t cache_hash( uint32_t code, uint32_t app_id, const char *body, int body_len){
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+
+    for( i = 0; i < body_len; i++){
+        h ^= ( uint8_t)body[ i];
+        h *= 1099511628211ULL;
+    }
+    h ^= ( ( ( uint64_t)code << 32) | app_id) * 0x9E3779B97F4A7C15ULL;
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * @fn static cache_shard_t* cache_get_shard( cache_t *cache, uint64_t hash)
+ * @brief key hash 상위 비트로 shard 를 고르는 함수 (하위 비트는 bucket에 쓴다)
+ */
+static cache_shard_t* cache_get_shard( cache_t *cache, uint64_t hash){
+    return &cache->shards[ ( hash >> 48) % CACHE_SHARD_NUM];
+}
+
+/**
+ * @fn static void cache_lru_unlink( cache_shard_t *shard, cache_entry_t *entry)
+ * @brief LRU 목록에서 항목을 빼는 함수
+ */
+static void cache_lru_unlink( cache_shard_t *shard, cache_entry_t *entry){
+    if( entry->lru_prev != NULL){
+        entry->lru_prev->lru_next = entry->lru_next;
+    }
+    else{
+        shard->lru_head = entry->lru_next;
+    }
+    if( entry->lru_next != NULL){
+        entry->lru_next->lru_prev = entry->lru_prev;
+    }
+    else{
+        shard->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+/**
+ * @fn static void cache_lru_push( cache_shard_t *shard, cache_entry_t *entry)
+ * @brief 항목을 LRU 목록의 맨 앞(가장 최근)에 넣는 함수
+ */
+static void cache_lru_push( cache_shard_t *shard, cache_entry_t *entry){
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if( shard->lru_head != NULL){
+        shard->lru_head->lru_prev = entry;
+    }
+    shard->lru_head = entry;
+    if( shard->lru_tail == NULL){
+        shard->lru_tail = entry;
+    }
+}
+
+/**
+ * @fn static void cache_entry_free( cache_shard_t *shard, cache_entry_t *entry)
+ * @brief 항목을 hash / LRU 에서 빼고 해제하는 함수 (보내는 중인 응답은 참조 수로 남는다)
+ */
+static void cache_entry_free( cache_shard_t *shard, cache_entry_t *entry){
+    cache_entry_t **link = &shard->buckets[ entry->hash & ( CACHE_BUCKET_NUM - 1)];
+
+    while( *link != NULL){
+        if( *link == entry){
+            *link = entry->hash_next;
+            break;
+        }
+        link = &( *link)->hash_next;
+    }
+    if( entry->val != NULL){
+        cache_lru_unlink( shard, entry);
+        cache_val_put( entry->val);
+    }
+
+    shard->bytes -= entry->mem;
+    shard->entry_num--;
+    free( entry->waiters);
+    free( entry);
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn cache_t* cache_init( size_t mem_limit)
+ * @brief 응답 cache 를 생성하는 함수
+ * @return 생성된 cache, 실패하면 NULL
+ * @param mem_limit 전체 메모리 한도 (bytes, shard 에 똑같이 나눈다)
+ */
+cache_t* cache_init( size_t mem_limit){
+    cache_t *cache = ( cache_t*)calloc( 1, sizeof( cache_t));
+    int i;
+
+    if( cache == NULL){
+        printf("    | ! Cache : Failed to allocate memory\n");
+        return NULL;
+    }
+    for( i = 0; i < CACHE_SHARD_NUM; i++){
+        cache->shards[ i].limit = mem_limit / CACHE_SHARD_NUM;
+    }
+    return cache;
+}
+
+/**
+ * @fn void cache_destroy( cache_t *cache)
+ * @brief cache 의 모든 항목을 해제하는 함수
+ * @return void
+ */
+void cache_destroy( cache_t *cache){
+    cache_entry_t *entry;
+    int i, j;
+
+    if( cache == NULL){
+        return;
+    }
+    for( i = 0; i < CACHE_SHARD_NUM; i++){
+        for( j = 0; j < CACHE_BUCKET_NUM; j++){
+            while( ( entry = cache->shards[ i].buckets[ j]) != NULL){
+                cache_entry_free( &cache->shards[ i], entry);
+            }
+        }
+    }
+    free( cache);
+}
+
+/**
+ * @fn int cache_add_code( cache_t *cache, uint32_t code)
+ * @brief 응답이 바디에만 의존하는 (멱등) code 를 cache 대상으로 등록하는 함수
+ * @return 정상이면 NORMAL, 목록이 가득 찼으면 BUF_ERR
+ */
+int cache_add_code( cache_t *cache, uint32_t code){
+    if( cache->code_num >= CACHE_CODE_MAX){
+        return BUF_ERR;
+    }
+    cache->codes[ cache->code_num++] = code;
+    return NORMAL;
+}
+
+/**
+ * @fn int cache_is_cacheable( cache_t *cache, uint32_t code)
+ * @brief code 가 cache 대상인지 확인하는 함수
+ * @return cache 대상이면 1, 아니면 0
+ */
+int cache_is_cacheable( cache_t *cache, uint32_t code){
+    int i;
+
+    for( i = 0; i < cache->code_num; i++){
+        if( cache->codes[ i] == code){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn int cache_lookup( cache_t *cache, const kmp_hdr_t *hdr, const char *body, int body_len, void *owner, cache_entry_t **entry, cache_val_t **val)
+ * @brief 요청에 대한 cache 된 응답을 찾는 함수
+ * 없으면 처리 중 항목을 만들고, 같은 요청이 처리 중이면 owner를 waiter로 등록해서 handler가 한 번만 실행되게 한다
+ * @return CACHE_HIT / CACHE_PENDING / CACHE_MISS, 메모리가 없으면 OBJECT_ERR
+ * @param cache cache 객체
+ * @param hdr 요청 헤더
+ * @param body 요청 바디
+ * @param body_len 요청 바디 길이
+ * @param owner 응답을 기다릴 객체 (MISS, PENDING 이면 waiter로 등록된다)
+ * @param entry 찾은 (또는 만든) 항목
+ * @param val HIT 이면 응답 (참조 수가 하나 늘어나 있으므로 다 보낸 뒤 cache_val_put 한다)
+ */
+int cache_lookup( cache_t *cache, const kmp_hdr_t *hdr, const char *body, int body_len, void *owner, cache_entry_t **entry, cache_val_t **val){
+    uint64_t hash = cache_hash( hdr->code, hdr->app_id, body, body_len);
+    cache_shard_t *shard = cache_get_shard( cache, hash);
+    cache_entry_t *cur;
+    void **waiters;
+
+    for( cur = shard->buckets[ hash & ( CACHE_BUCKET_NUM - 1)]; cur != NULL; cur = cur->hash_next){
+        if( ( cur->hash == hash) && ( cur->code == hdr->code) && ( cur->app_id == hdr->app_id)
+                && ( cur->body_len == body_len) && ( memcmp( cur->body, body, body_len) == 0)){
+            break;
+        }
+    }
+
+    if( cur != NULL){
+        *entry = cur;
+        if( cur->val != NULL){
+            cache_lru_unlink( shard, cur);
+            cache_lru_push( shard, cur);
+            cur->val->refcnt++;
+            *val = cur->val;
+            cache->hits++;
+            return CACHE_HIT;
+        }
+
+        if( cur->waiter_num == cur->waiter_cap){
+            if( ( waiters = ( void**)realloc( cur->waiters, sizeof( void*) * cur->waiter_cap * 2)) == NULL){
+                return OBJECT_ERR;
+            }
+            cur->waiters = waiters;
+            cur->waiter_cap *= 2;
+        }
+        cur->waiters[ cur->waiter_num++] = owner;
+        cache->coalesced++;
+        return CACHE_PENDING;
+    }
+
+    if( ( cur = ( cache_entry_t*)malloc( sizeof( cache_entry_t) + body_len)) == NULL){
+        return OBJECT_ERR;
+    }
+    if( ( cur->waiters = ( void**)malloc( sizeof( void*) * 4)) == NULL){
+        free( cur);
+        return OBJECT_ERR;
+    }
+    cur->ev_type = CACHE_EV_ENTRY;
+    cur->route_hop_id = 0;
+    cur->lru_prev = NULL;
+    cur->lru_next = NULL;
+    cur->hash = hash;
+    cur->code = hdr->code;
+    cur->app_id = hdr->app_id;
+    cur->mem = sizeof( cache_entry_t) + body_len;
+    cur->val = NULL;
+    cur->waiters[ 0] = owner;
+    cur->waiter_num = 1;
+    cur->waiter_cap = 4;
+    cur->body_len = body_len;
+    memcpy( cur->body, body, body_len);
+
+    cur->hash_next = shard->buckets[ hash & ( CACHE_BUCKET_NUM - 1)];
+    shard->buckets[ hash & ( CACHE_BUCKET_NUM - 1)] = cur;
+    shard->bytes += cur->mem;
+    shard->entry_num++;
+    cache->misses++;
+
+    *entry = cur;
+    return CACHE_MISS;
+}
+
+/**
+ * @fn void cache_remove_waiter( cache_entry_t *entry, void *owner)
+ * @brief 응답을 기다리던 연결이 끊겼을 때 waiter 목록에서 빼는 함수 (처리 중인 요청은 계속 진행된다)
+ * @return void
+ */
+void cache_remove_waiter( cache_entry_t *entry, void *owner){
+    int i;
+
+    for( i = 0; i < entry->waiter_num; i++){
+        if( entry->waiters[ i] == owner){
+            entry->waiters[ i] = entry->waiters[ --entry->waiter_num];
+            return;
+        }
+    }
+}
+
+/**
+ * @fn void** cache_take_waiters( cache_entry_t *entry, int *num)
+ * @brief 처리 중 항목의 waiter 목록을 꺼내는 함수 (응답을 나눠 주는 동안 항목이 해제되어도 되게 한다)
+ * @return waiter 목록 (호출한 쪽이 free 한다), 메모리가 없으면 NULL
+ * @param entry 처리 중 항목
+ * @param num waiter 수
+ */
+void** cache_take_waiters( cache_entry_t *entry, int *num){
+    void **waiters = entry->waiters;
+
+    *num = entry->waiter_num;
+    entry->waiters = NULL;
+    entry->waiter_num = 0;
+    entry->waiter_cap = 0;
+    return waiters;
+}
+
+/**
+ * @fn cache_val_t* cache_fill( cache_t *cache, cache_entry_t *entry, const char *frame, int len)
+ * @brief 처리 중 항목에 handler 응답을 채우는 함수
+ * 실패 응답(KMP_CODE_UNAVAILABLE)은 저장하지 않고 항목을 지운다. 메모리 한도를 넘으면 오래된 항목부터 버린다
+ * 이 함수가 끝나면 entry 는 해제되었을 수 있다
+ * @return 저장된 응답 (참조 수가 하나 늘어나 있다), 저장하지 않았으면 NULL
+ * @param cache cache 객체
+ * @param entry cache_lookup 이 CACHE_MISS 로 돌려준 항목
+ * @param frame 응답 메시지
+ * @param len 응답 메시지 길이
+ */
+cache_val_t* cache_fill( cache_t *cache, cache_entry_t *entry, const char *frame, int len){
+    cache_shard_t *shard = cache_get_shard( cache, entry->hash);
+    cache_val_t *val;
+    int mem;
+
+    if( ( len < CACHE_HDR_LEN) || ( ( ( const kmp_hdr_t*)frame)->code == KMP_CODE_UNAVAILABLE)
+            || ( ( val = ( cache_val_t*)malloc( sizeof( cache_val_t) + len)) == NULL)){
+        cache_entry_free( shard, entry);
+        return NULL;
+    }
+    val->refcnt = 2;
+    val->len = len;
+    memcpy( val->data, frame, len);
+
+    mem = sizeof( cache_val_t) + len;
+    entry->val = val;
+    entry->mem += mem;
+    shard->bytes += mem;
+    cache_lru_push( shard, entry);
+
+    while( ( shard->bytes > shard->limit) && ( shard->lru_tail != NULL)){
+        cache_entry_free( shard, shard->lru_tail);
+        cache->evictions++;
+    }
+    return val;
+}
+
+/**
+ * @fn void cache_val_put( cache_val_t *val)
+ * @brief 응답의 참조를 하나 놓는 함수 (마지막 참조면 해제한다)
+ * @return void
+ */
+void cache_val_put( cache_val_t *val){
+    if( --val->refcnt == 0){
+        free( val);
+    }
+}
+
+/**
+ * @fn size_t cache_mem_bytes( cache_t *cache)
+ * @brief cache 가 사용 중인 메모리를 구하는 함수
+ * @return bytes
+ */
+size_t cache_mem_bytes( cache_t *cache){
+    size_t bytes = 0;
+    int i;
+
+    for( i = 0; i < CACHE_SHARD_NUM; i++){
+        bytes += cache->shards[ i].bytes;
+    }
+    return bytes;
+}
+
+/**
+ * @fn int cache_entry_num( cache_t *cache)
+ * @brief cache 항목 수를 구하는 함수 (처리 중 포함)
+ * @return 항목 수
+ */
+int cache_entry_num( cache_t *cache){
+    int i, num = 0;
+
+    for( i = 0; i < CACHE_SHARD_NUM; i++){
+        num += cache->shards[ i].entry_num;
+    }
+    return num;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+
+#define CACHE_HDR_LEN 20
+/// 독립된 LRU를 가지는 shard 수 (key hash 상위 비트로 고른다)
+#define CACHE_SHARD_NUM 16
+/// shard 하나의 hash bucket 수 (2의 거듭제곱)
+#define CACHE_BUCKET_NUM 4096
+/// cache 대상으로 지정할 수 있는 최대 code 수
+#define CACHE_CODE_MAX 16
+/// 기본 메모리 한도 (bytes, shard 마다 1/CACHE_SHARD_NUM 씩)
+#define CACHE_MEM_DEFAULT ( 64 << 20)
+/// route_forward 의 owner 로 넘긴 cache entry를 구분하기 위한 종류 값 (cache_entry_t 의 첫 번째 멤버)
+#define CACHE_EV_ENTRY 7
+
+/// cache_lookup() 결과
+enum CACHE_RESULT{
+    /// 처음 보는 요청. 호출한 쪽이 handler로 보내고 cache_fill() 로 결과를 채운다
+    CACHE_MISS = 0,
+    /// cache 된 응답이 있다
+    CACHE_HIT,
+    /// 같은 요청이 이미 처리 중이다. owner는 waiter로 등록되었다
+    CACHE_PENDING
+};
+
+/// @struct cache_val_t
+/// @brief cache 된 응답 메시지 (헤더 + 바디). 참조 수가 0이 되면 해제된다
+/// hit 응답은 이 버퍼를 복사하지 않고 그대로 write 한다
+typedef struct cache_val_s cache_val_t;
+struct cache_val_s{
+    /// 참조 수 (cache 자신 + 보내는 중인 연결 수)
+    int refcnt;
+    /// 메시지 길이
+    int len;
+    /// 메시지
+    char data[];
+};
+
+/// @struct cache_entry_t
+/// @brief (code, app_id, body) 하나에 대한 cache 항목. 응답이 오기 전에는 waiter 목록을 가진다
+typedef struct cache_entry_s cache_entry_t;
+struct cache_entry_s{
+    /// 종류 (CACHE_EV_ENTRY, route 응답 owner 구분용)
+    int ev_type;
+    /// handler(upstream)로 보낸 요청의 hop_id
+    uint32_t route_hop_id;
+    /// 같은 bucket의 다음 항목
+    cache_entry_t *hash_next;
+    /// LRU 목록 (응답이 채워진 항목만 들어 있다)
+    cache_entry_t *lru_prev;
+    cache_entry_t *lru_next;
+    /// key hash
+    uint64_t hash;
+    /// 요청 code
+    uint32_t code;
+    /// 요청 app_id
+    uint32_t app_id;
+    /// 메모리 사용량 계산에 들어간 크기
+    int mem;
+    /// cache 된 응답 (처리 중이면 NULL)
+    cache_val_t *val;
+    /// 응답을 기다리는 owner 목록
+    void **waiters;
+    /// waiter 수
+    int waiter_num;
+    /// waiter 목록 할당 크기
+    int waiter_cap;
+    /// 요청 바디 길이
+    int body_len;
+    /// 요청 바디 (hash 충돌 확인용)
+    char body[];
+};
+
+/// @struct cache_shard_t
+/// @brief 메모리 한도와 LRU 를 따로 가지는 cache 조각
+typedef struct cache_shard_s cache_shard_t;
+struct cache_shard_s{
+    /// hash bucket
+    cache_entry_t *buckets[ CACHE_BUCKET_NUM];
+    /// 가장 최근에 사용한 항목
+    cache_entry_t *lru_head;
+    /// 가장 오래 전에 사용한 항목 (먼저 버린다)
+    cache_entry_t *lru_tail;
+    /// 사용 중인 메모리
+    size_t bytes;
+    /// 메모리 한도
+    size_t limit;
+    /// 항목 수 (처리 중 포함)
+    int entry_num;
+};
+
+/// @struct cache_t
+/// @brief 멱등(idempotent) code 의 응답 cache
+typedef struct cache_s cache_t;
+struct cache_s{
+    /// cache 대상 code 목록
+    uint32_t codes[ CACHE_CODE_MAX];
+    /// cache 대상 code 수
+    int code_num;
+    /// hit 수
+    uint64_t hits;
+    /// miss 수 (handler로 보낸 요청)
+    uint64_t misses;
+    /// 처리 중인 같은 요청에 합쳐진 수
+    uint64_t coalesced;
+    /// 메모리 한도 때문에 버린 항목 수
+    uint64_t evictions;
+    /// shard 목록
+    cache_shard_t shards[ CACHE_SHARD_NUM];
+};
+
+cache_t* cache_init( size_t mem_limit);
+void cache_destroy( cache_t *cache);
+int cache_add_code( cache_t *cache, uint32_t code);
+int cache_is_cacheable( cache_t *cache, uint32_t code);
+int cache_lookup( cache_t *cache, const kmp_hdr_t *hdr, const char *body, int body_len, void *owner, cache_entry_t **entry, cache_val_t **val);
+void cache_remove_waiter( cache_entry_t *entry, void *owner);
+void** cache_take_waiters( cache_entry_t *entry, int *num);
+cache_val_t* cache_fill( cache_t *cache, cache_entry_t *entry, const char *frame, int len);
+void cache_val_put( cache_val_t *val);
+size_t cache_mem_bytes( cache_t *cache);
+int cache_entry_num( cache_t *cache);
+
+#endif
@@ -0,0 +1,448 @@
+#include "coro.h"
+
+/**
+ * @fn static uint64_t coro_now_ms()
+ * @brief monotonic clock 기준 현재 시각을 ms 단위로 구하는 함수
+ * @return 현재 시각 (ms)
+ */
+static uint64_t coro_now_ms(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ----------------------------------------------------------
+// timer heap
+
+/**
+ * @fn static void coro_heap_swap( coro_sched_t *sched, int a, int b)
+ * @brief heap 의 두 항목을 바꾸고 heap_index 를 갱신하는 함수
+ */
+static void coro_heap_swap( coro_sched_t *sched, int a, int b){
+    coro_t *tmp = sched->heap[ a];
+
+    sched->heap[ a] = sched->heap[ b];
+    sched->heap[ b] = tmp;
+    sched->heap[ a]->heap_index = a;
+    sched->heap[ b]->heap_index = b;
+}
+
+/**
+ * @fn static void coro_heap_fix( coro_sched_t *sched, int index)
+ * @brief index 위치의 항목을 위 / 아래로 옮겨서 heap 순서를 맞추는 함수
+ */
+static void coro_heap_fix( coro_sched_t *sched, int index){
+    int parent, child;
+
+    while( index > 0){
+        parent = ( index - 1) / 2;
+        if( sched->heap[ parent]->wake_ms <= sched->heap[ index]->wake_ms){
+            break;
+        }
+        coro_heap_swap( sched, parent, index);
+        index = parent;
+    }
+
+    while( ( child = index * 2 + 1) < sched->heap_num){
+        if( ( child + 1 < sched->heap_num) && ( sched->heap[ child + 1]->wake_ms < sched->heap[ child]->wake_ms)){
+            child++;
+        }
+        if( sched->heap[ index]->wake_ms <= sched->heap[ child]->wake_ms){
+            break;
+        }
+        coro_heap_swap( sched, index, child);
+        index = child;
+    }
+}
+
+/**
+ * @fn static int coro_heap_push( coro_sched_t *sched, coro_t *co)
+ * @brief sleep_for 중인 coroutine을 timer heap 에 넣는 함수
+ * @return 정상이면 NORMAL, 메모리가 부족하면 OBJECT_ERR
+ */
+static int coro_heap_push( coro_sched_t *sched, coro_t *co){
+    coro_t **heap;
+    int cap;
+
+    if( sched->heap_num == sched->heap_cap){
+        cap = ( sched->heap_cap == 0) ? 64 : sched->heap_cap * 2;
+        if( ( heap = ( coro_t**)realloc( sched->heap, sizeof( coro_t*) * cap)) == NULL){
+            return OBJECT_ERR;
+        }
+        sched->heap = heap;
+        sched->heap_cap = cap;
+    }
+
+    co->heap_index = sched->heap_num;
+    sched->heap[ sched->heap_num++] = co;
+    coro_heap_fix( sched, co->heap_index);
+    return NORMAL;
+}
+
+/**
+ * @fn static void coro_heap_remove( coro_sched_t *sched, coro_t *co)
+ * @brief timer heap 에서 coroutine을 빼는 함수
+ */
+static void coro_heap_remove( coro_sched_t *sched, coro_t *co){
+    int index = co->heap_index;
+
+    if( index < 0){
+        return;
+    }
+    co->heap_index = -1;
+    if( --sched->heap_num == index){
+        return;
+    }
+    sched->heap[ index] = sched->heap[ sched->heap_num];
+    sched->heap[ index]->heap_index = index;
+    coro_heap_fix( sched, index);
+}
+
+// ----------------------------------------------------------
+// frame pool
+
+/**
+ * @fn static coro_t* coro_alloc( coro_sched_t *sched)
+ * @brief pool 에서 coroutine frame 하나를 꺼내는 함수 (비어 있으면 chunk 하나를 더 할당한다)
+ * @return frame, 할당할 수 없으면 NULL
+ */
+static coro_t* coro_alloc( coro_sched_t *sched){
+    coro_t *chunk, *co;
+    int i;
+
+    if( sched->free_list == NULL){
+        if( sched->chunk_num >= CORO_CHUNK_NUM){
+            return NULL;
+        }
+        if( posix_memalign( ( void**)&chunk, 64, sizeof( coro_t) * CORO_CHUNK_LEN) != 0){
+            return NULL;
+        }
+        for( i = 0; i < CORO_CHUNK_LEN; i++){
+            chunk[ i].fn = NULL;
+            chunk[ i].next_free = ( i + 1 < CORO_CHUNK_LEN) ? &chunk[ i + 1] : NULL;
+        }
+        sched->chunks[ sched->chunk_num++] = chunk;
+        sched->free_list = chunk;
+    }
+
+    co = sched->free_list;
+    sched->free_list = co->next_free;
+    return co;
+}
+
+/**
+ * @fn static void coro_free( coro_sched_t *sched, coro_t *co)
+ * @brief 끝난 coroutine의 fd 를 닫고 frame 을 pool 에 돌려주는 함수
+ */
+static void coro_free( coro_sched_t *sched, coro_t *co){
+    if( co->fd >= 0){
+        epoll_ctl( sched->epoll_fd, EPOLL_CTL_DEL, co->fd, NULL);
+        close( co->fd);
+        co->fd = -1;
+    }
+    coro_heap_remove( sched, co);
+
+    // 같은 epoll_wait 결과에 남아 있는 이 frame 의 이벤트는 fn == NULL 로 무시된다
+    co->fn = NULL;
+    co->next_free = sched->free_list;
+    sched->free_list = co;
+    sched->live_num--;
+}
+
+/**
+ * @fn static int coro_wait_io( coro_t *co, uint32_t events)
+ * @brief coroutine이 기다릴 fd 이벤트를 epoll 에 등록하는 함수
+ * @return CORO_WAIT, epoll 등록에 실패하면 OBJECT_ERR
+ */
+static int coro_wait_io( coro_t *co, uint32_t events){
+    struct epoll_event co_event;
+
+    if( co->events != events){
+        co_event.events = events;
+        co_event.data.ptr = co;
+        if( epoll_ctl( co->sched->epoll_fd, EPOLL_CTL_MOD, co->fd, &co_event) < 0){
+            return OBJECT_ERR;
+        }
+        co->events = events;
+    }
+    return CORO_WAIT;
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn coro_sched_t* coro_sched_init( int epoll_fd)
+ * @brief coroutine scheduler를 생성하는 함수
+ * @return 생성된 scheduler, 실패하면 NULL
+ * @param epoll_fd coroutine fd 를 등록할 epoll 인스턴스 (server 의 event loop 와 공유)
+ */
+coro_sched_t* coro_sched_init( int epoll_fd){
+    coro_sched_t *sched = ( coro_sched_t*)calloc( 1, sizeof( coro_sched_t));
+
+    if( sched == NULL){
+        printf("    | ! Coro : Failed to allocate memory\n");
+        return NULL;
+    }
+    sched->epoll_fd = epoll_fd;
+    return sched;
+}
+
+/**
+ * @fn void coro_sched_destroy( coro_sched_t *sched)
+ * @brief 실행 중인 coroutine을 모두 끝내고 scheduler를 해제하는 함수
+ * @return void
+ */
+void coro_sched_destroy( coro_sched_t *sched){
+    int i, j;
+
+    if( sched == NULL){
+        return;
+    }
+    for( i = 0; i < sched->chunk_num; i++){
+        for( j = 0; j < CORO_CHUNK_LEN; j++){
+            if( sched->chunks[ i][ j].fn != NULL){
+                coro_free( sched, &sched->chunks[ i][ j]);
+            }
+        }
+        free( sched->chunks[ i]);
+    }
+    free( sched->heap);
+    free( sched);
+}
+
+/**
+ * @fn coro_t* coro_spawn( coro_sched_t *sched, int fd, coro_fn fn, void *arg)
+ * @brief coroutine을 만들고 처음 yield 할 때까지 실행하는 함수
+ * fd 는 coroutine이 소유하고, coroutine이 끝나면 닫힌다
+ * @return 실행 중인 coroutine (바로 끝났으면 NULL)
+ * @param sched scheduler
+ * @param fd coroutine이 사용할 non-blocking 소켓 (없으면 -1)
+ * @param fn coroutine 본문
+ * @param arg 사용자 인자
+ */
+coro_t* coro_spawn( coro_sched_t *sched, int fd, coro_fn fn, void *arg){
+    struct epoll_event co_event;
+    coro_t *co;
+
+    if( ( co = coro_alloc( sched)) == NULL){
+        printf("    | ! Coro : Failed to allocate coroutine frame\n");
+        if( fd >= 0){
+            close( fd);
+        }
+        return NULL;
+    }
+
+    co->ev_type = CORO_EV_TYPE;
+    co->fd = fd;
+    co->events = 0;
+    co->line = 0;
+    co->io_off = 0;
+    co->io_len = 0;
+    co->heap_index = -1;
+    co->wake_ms = 0;
+    co->fn = fn;
+    co->arg = arg;
+    co->sched = sched;
+    sched->live_num++;
+
+    if( fd >= 0){
+        // 관찰 이벤트는 awaitable 이 정한다
+        co_event.events = 0;
+        co_event.data.ptr = co;
+        if( epoll_ctl( sched->epoll_fd, EPOLL_CTL_ADD, fd, &co_event) < 0){
+            printf("    | ! Coro : Failed to add epoll event (fd:%d)\n", fd);
+            coro_free( sched, co);
+            return NULL;
+        }
+    }
+
+    coro_resume( sched, co, 0);
+    return ( co->fn != NULL) ? co : NULL;
+}
+
+/**
+ * @fn void coro_resume( coro_sched_t *sched, coro_t *co, uint32_t events)
+ * @brief 멈춰 있는 coroutine을 다음 yield 까지 실행하는 함수 (끝나면 pool 에 돌려준다)
+ * @return void
+ * @param sched scheduler
+ * @param co 재개할 coroutine
+ * @param events 발생한 epoll 이벤트 (timer 로 깨어나면 0)
+ */
+void coro_resume( coro_sched_t *sched, coro_t *co, uint32_t events){
+    if( co->fn == NULL){
+        return;
+    }
+    // sleep_for 중에는 fd 이벤트로 깨우지 않는다
+    if( ( events != 0) && ( co->wake_ms != 0)){
+        return;
+    }
+
+    if( co->fn( co) != CORO_WAIT){
+        coro_free( sched, co);
+    }
+}
+
+/**
+ * @fn int coro_sched_next_timeout( coro_sched_t *sched, int max_ms)
+ * @brief 가장 먼저 깨어날 coroutine까지 남은 시간을 구하는 함수 (epoll_wait timeout 용)
+ * @return 남은 시간 (ms), 자고 있는 coroutine이 없으면 max_ms
+ */
+int coro_sched_next_timeout( coro_sched_t *sched, int max_ms){
+    uint64_t now;
+
+    if( sched->heap_num == 0){
+        return max_ms;
+    }
+    now = coro_now_ms();
+    if( sched->heap[ 0]->wake_ms <= now){
+        return 0;
+    }
+    return ( sched->heap[ 0]->wake_ms - now < ( uint64_t)max_ms) ? ( int)( sched->heap[ 0]->wake_ms - now) : max_ms;
+}
+
+/**
+ * @fn void coro_sched_run_timers( coro_sched_t *sched)
+ * @brief 깨어날 시각이 지난 coroutine을 모두 재개하는 함수
+ * @return void
+ */
+void coro_sched_run_timers( coro_sched_t *sched){
+    uint64_t now;
+    coro_t *co;
+
+    if( sched->heap_num == 0){
+        return;
+    }
+    now = coro_now_ms();
+    while( ( sched->heap_num > 0) && ( sched->heap[ 0]->wake_ms <= now)){
+        co = sched->heap[ 0];
+        coro_heap_remove( sched, co);
+        coro_resume( sched, co, 0);
+    }
+}
+
+/**
+ * @fn int coro_sched_run_once( coro_sched_t *sched, int max_ms)
+ * @brief epoll 인스턴스를 scheduler 혼자 사용할 때의 event loop 한 번
+ * (server 에서는 server_conn() 의 loop 가 coro_resume / coro_sched_run_timers 를 직접 호출한다)
+ * @return 처리한 이벤트 수, epoll_wait 에러면 SOC_ERR
+ */
+int coro_sched_run_once( coro_sched_t *sched, int max_ms){
+    struct epoll_event events[ 256];
+    int i, count;
+
+    count = epoll_wait( sched->epoll_fd, events, 256, coro_sched_next_timeout( sched, max_ms));
+    if( count < 0){
+        return ( errno == EINTR) ? 0 : SOC_ERR;
+    }
+    for( i = 0; i < count; i++){
+        coro_resume( sched, ( coro_t*)events[ i].data.ptr, events[ i].events);
+    }
+    coro_sched_run_timers( sched);
+    return count;
+}
+
+// ----------------------------------------------------------
+// awaitable
+
+/**
+ * @fn int coro_read_frame( coro_t *co, char *buf, int cap)
+ * @brief kmp 메시지 하나(헤더 + 바디)를 읽는 awaitable
+ * 소켓에 데이터가 부족하면 EPOLLIN 을 걸고 CORO_WAIT 를 반환한다 (CORO_AWAIT 가 다시 호출한다)
+ * @return 메시지 길이, 아직이면 CORO_WAIT, 실패하면 열거형 참고
+ * @param co 현재 coroutine
+ * @param buf 메시지를 담을 버퍼 (yield 사이에 유지되어야 하므로 CORO_LOCALS 안에 둔다)
+ * @param cap 버퍼 크기
+ */
+int coro_read_frame( coro_t *co, char *buf, int cap){
+    int need, rv, len;
+
+    while( 1){
+        need = ( co->io_off < CORO_HDR_LEN) ? CORO_HDR_LEN - co->io_off : co->io_len - co->io_off;
+        if( ( rv = read( co->fd, &buf[ co->io_off], need)) < 0){
+            if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                return coro_wait_io( co, EPOLLIN);
+            }
+            else if( errno == EINTR){
+                continue;
+            }
+            return NEGATIVE_BYTE;
+        }
+        else if( rv == 0){
+            return ZERO_BYTE;
+        }
+        co->io_off += rv;
+
+        if( co->io_off == CORO_HDR_LEN){
+            len = ( ( kmp_hdr_t*)buf)->length;
+            if( ( len < CORO_HDR_LEN) || ( len > cap)){
+                printf("    | ! Coro : wrong msg length (len:%d) (fd:%d)\n", len, co->fd);
+                return BUF_ERR;
+            }
+            co->io_len = len;
+        }
+
+        if( ( co->io_off >= CORO_HDR_LEN) && ( co->io_off == co->io_len)){
+            len = co->io_len;
+            co->io_off = 0;
+            co->io_len = 0;
+            return len;
+        }
+    }
+}
+
+/**
+ * @fn int coro_write_frame( coro_t *co, const char *buf, int len)
+ * @brief 메시지를 모두 보내는 awaitable (소켓 송신 버퍼가 가득 차면 EPOLLOUT 을 걸고 멈춘다)
+ * @return 정상이면 NORMAL, 아직이면 CORO_WAIT, 실패하면 NEGATIVE_BYTE
+ * @param co 현재 coroutine
+ * @param buf 보낼 메시지 (yield 사이에 유지되어야 한다)
+ * @param len 메시지 길이
+ */
+int coro_write_frame( coro_t *co, const char *buf, int len){
+    int rv;
+
+    while( co->io_off < len){
+        if( ( rv = write( co->fd, &buf[ co->io_off], len - co->io_off)) < 0){
+            if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                return coro_wait_io( co, EPOLLOUT);
+            }
+            else if( errno == EINTR){
+                continue;
+            }
+            return NEGATIVE_BYTE;
+        }
+        co->io_off += rv;
+    }
+    co->io_off = 0;
+    return NORMAL;
+}
+
+/**
+ * @fn int coro_sleep_for( coro_t *co, int ms)
+ * @brief ms 동안 coroutine을 멈추는 awaitable (자는 동안 fd 이벤트는 관찰하지 않는다)
+ * @return 깨어나면 NORMAL, 아직이면 CORO_WAIT, timer 등록에 실패하면 열거형 참고
+ * @param co 현재 coroutine
+ * @param ms 멈출 시간 (ms)
+ */
+int coro_sleep_for( coro_t *co, int ms){
+    int rv;
+
+    if( co->wake_ms == 0){
+        co->wake_ms = coro_now_ms() + ms;
+        if( ( co->fd >= 0) && ( ( rv = coro_wait_io( co, 0)) != CORO_WAIT)){
+            co->wake_ms = 0;
+            return rv;
+        }
+        if( coro_heap_push( co->sched, co) < NORMAL){
+            co->wake_ms = 0;
+            return OBJECT_ERR;
+        }
+        return CORO_WAIT;
+    }
+
+    if( co->heap_index >= 0){
+        return CORO_WAIT;
+    }
+    co->wake_ms = 0;
+    return NORMAL;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef __CORO_H__
+#define __CORO_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+
+#define CORO_HDR_LEN 20
+/// epoll data.ptr 로 등록된 coroutine을 구분하기 위한 종류 값 (coro_t 의 첫 번째 멤버)
+#define CORO_EV_TYPE 6
+/// coroutine 하나가 yield 사이에 유지할 수 있는 지역 상태 크기
+#define CORO_LOCALS_LEN 2048
+/// pool 에서 한 번에 할당하는 frame 수
+#define CORO_CHUNK_LEN 256
+/// pool chunk 최대 수 (frame 1M 개까지)
+#define CORO_CHUNK_NUM 4096
+
+/// awaitable 이 아직 끝나지 않아서 coroutine이 멈춰야 함을 뜻하는 반환 값
+#define CORO_WAIT ERRNO_EAGAIN
+/// coroutine이 정상적으로 끝났음을 뜻하는 반환 값
+#define CORO_DONE NORMAL
+
+/**
+ * coroutine 본문 작성용 macro (stackless, switch 기반)
+ * yield 사이에 유지해야 하는 값은 C 지역 변수가 아니라 CORO_LOCALS() 에 둔다
+ * CORO_AWAIT 는 한 줄에 하나만 쓴다 (재개 위치로 __LINE__ 을 사용한다. 처음에는 재개 label 로 흘러 들어가므로 fallthrough 로 표시한다)
+ *
+ *   CORO_BEGIN( co);
+ *   while( 1){
+ *       CORO_AWAIT( co, ctx->len, coro_read_frame( co, ctx->frame, sizeof( ctx->frame)));
+ *       ...
+ *   }
+ *   CORO_END( co);
+ */
+#define CORO_BEGIN( co) switch( ( co)->line){ case 0:
+#define CORO_AWAIT( co, rv, expr) \
+    do{ \
+        ( co)->line = __LINE__; __attribute__(( fallthrough)); case __LINE__: \
+        if( ( ( rv) = ( expr)) == CORO_WAIT){ \
+            return CORO_WAIT; \
+        } \
+    }while( 0)
+#define CORO_EXIT( co, rv) do{ ( co)->line = -1; return ( rv); }while( 0)
+#define CORO_END( co) } ( co)->line = -1; return CORO_DONE
+#define CORO_LOCALS( co, type) ( ( type*)( co)->locals)
+
+typedef struct coro_s coro_t;
+typedef struct coro_sched_s coro_sched_t;
+
+/// @brief coroutine 본문. CORO_WAIT 를 반환하면 멈추고, 그 외의 값이면 끝난다
+typedef int ( *coro_fn)( coro_t *co);
+
+/// @struct coro_t
+/// @brief coroutine frame. scheduler의 pool 에서 할당되고 epoll data.ptr 가 직접 가리킨다
+struct coro_s{
+    /// epoll 이벤트 종류 (CORO_EV_TYPE)
+    int ev_type;
+    /// coroutine이 소유한 file descriptor (없으면 -1)
+    int fd;
+    /// epoll에 등록된 관찰 이벤트
+    uint32_t events;
+    /// 재개 위치 (CORO_BEGIN 의 switch case)
+    int line;
+    /// 진행 중인 read_frame / write_frame 의 처리 바이트 수
+    int io_off;
+    /// 진행 중인 read_frame / write_frame 의 메시지 길이
+    int io_len;
+    /// timer heap 위치 (없으면 -1)
+    int heap_index;
+    /// sleep_for 가 깨어날 시각 (ms, 0이면 자고 있지 않다)
+    uint64_t wake_ms;
+    /// coroutine 본문 (pool 에 반환되면 NULL)
+    coro_fn fn;
+    /// 사용자 인자
+    void *arg;
+    /// 소속 scheduler
+    coro_sched_t *sched;
+    /// pool free list
+    coro_t *next_free;
+    /// yield 사이에 유지되는 지역 상태
+    uint64_t locals[ CORO_LOCALS_LEN / sizeof( uint64_t)];
+};
+
+/// @struct coro_sched_t
+/// @brief event loop thread 하나에 하나씩 두는 coroutine scheduler (thread 간 공유하지 않으므로 lock이 없다)
+struct coro_sched_s{
+    /// coroutine fd 를 등록할 epoll 인스턴스
+    int epoll_fd;
+    /// 실행 중인 coroutine 수
+    int live_num;
+    /// 할당된 pool chunk 수
+    int chunk_num;
+    /// pool chunk 목록
+    coro_t *chunks[ CORO_CHUNK_NUM];
+    /// 사용 가능한 frame 목록
+    coro_t *free_list;
+    /// sleep_for 중인 coroutine의 min heap (wake_ms 기준)
+    coro_t **heap;
+    /// heap 에 들어 있는 수
+    int heap_num;
+    /// heap 할당 크기
+    int heap_cap;
+};
+
+coro_sched_t* coro_sched_init( int epoll_fd);
+void coro_sched_destroy( coro_sched_t *sched);
+coro_t* coro_spawn( coro_sched_t *sched, int fd, coro_fn fn, void *arg);
+void coro_resume( coro_sched_t *sched, coro_t *co, uint32_t events);
+int coro_sched_next_timeout( coro_sched_t *sched, int max_ms);
+void coro_sched_run_timers( coro_sched_t *sched);
+int coro_sched_run_once( coro_sched_t *sched, int max_ms);
+
+int coro_read_frame( coro_t *co, char *buf, int cap);
+int coro_write_frame( coro_t *co, const char *buf, int len);
+int coro_sleep_for( coro_t *co, int ms);
+
+#endif
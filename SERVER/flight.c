@@ -0,0 +1,257 @@
+#include "flight.h"
+
+/// 기록 중인 event loop 의 ring (dump 가 모두 읽는다)
+static flight_t *flight_loops[ FLIGHT_LOOP_MAX];
+static int flight_loop_num = 0;
+/// 처음 ring 을 만들 때의 시각 (dump 할 때의 시각과 같이 TSC 를 ns 로 바꾼다)
+static uint64_t flight_ts0 = 0;
+static uint64_t flight_ns0 = 0;
+/// dump 파일 경로 (signal handler 에서 쓰므로 미리 만들어 둔다)
+static char flight_path[ PATH_MAX];
+
+/// dump 에 쓰는 event 이름 (FLIGHT_EV 순서)
+static const char *flight_ev_names[ FLIGHT_EV_NUM] = { "?", "accept", "read", "frame", "write", "epoll", "close"};
+/// dump 에 쓰는 상태 bit 글자 (FLIGHT_STATE 의 bit 순서)
+static const char flight_st_chars[] = "HBhbWQMO";
+
+/**
+ * @fn static uint64_t flight_now_ns()
+ * @brief monotonic clock 기준 현재 시각을 ns 단위로 구하는 함수 (signal handler 에서 불러도 된다)
+ * @return 현재 시각 (ns)
+ */
+static uint64_t flight_now_ns(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @fn flight_t* flight_init( int cap)
+ * @brief event loop 하나의 event ring 을 만들고 dump 목록에 넣는 함수
+ * @return 생성된 객체, 실패하면 NULL
+ * @param cap 기억할 event 수 (2의 거듭제곱으로 올린다, FLIGHT_EVENT_MAX 이하)
+ */
+flight_t* flight_init( int cap){
+    flight_t *flight;
+    int size = 1;
+    int loop;
+
+    if( ( cap <= 0) || ( cap > FLIGHT_EVENT_MAX)){
+        printf("    | ! Flight : event count must be 1 ~ %d (%d)\n", FLIGHT_EVENT_MAX, cap);
+        return NULL;
+    }
+    while( size < cap){
+        size <<= 1;
+    }
+    if( ( loop = __atomic_fetch_add( &flight_loop_num, 1, __ATOMIC_ACQ_REL)) >= FLIGHT_LOOP_MAX){
+        printf("    | ! Flight : too many event loops (max %d)\n", FLIGHT_LOOP_MAX);
+        return NULL;
+    }
+    if( ( flight = ( flight_t*)calloc( 1, sizeof( flight_t))) == NULL){
+        printf("    | ! Flight : Failed to allocate memory\n");
+        return NULL;
+    }
+    // 0 으로 채워 둬야 아직 쓰지 않은 slot 을 dump 가 건너뛴다
+    if( ( flight->ring = ( flight_ev_t*)calloc( size, sizeof( flight_ev_t))) == NULL){
+        printf("    | ! Flight : Failed to allocate memory\n");
+        free( flight);
+        return NULL;
+    }
+    flight->cap = size;
+    flight->mask = size - 1;
+    flight->loop = loop;
+    if( loop == 0){
+        flight_ns0 = flight_now_ns();
+        flight_ts0 = flight_now();
+    }
+    flight_tick( flight);
+    if( flight_path[ 0] == '\0'){
+        flight_set_path( FLIGHT_PATH_DEFAULT);
+    }
+    __atomic_store_n( &flight_loops[ loop], flight, __ATOMIC_RELEASE);
+    return flight;
+}
+
+/**
+ * @fn void flight_destroy( flight_t *flight)
+ * @brief event ring 을 dump 목록에서 빼고 해제하는 함수
+ * @return void
+ * @param flight event ring (NULL 이면 아무 것도 하지 않는다)
+ */
+void flight_destroy( flight_t *flight){
+    if( flight == NULL){
+        return;
+    }
+    __atomic_store_n( &flight_loops[ flight->loop], NULL, __ATOMIC_RELEASE);
+    free( flight->ring);
+    free( flight);
+}
+
+/**
+ * @fn void flight_set_path( const char *prefix)
+ * @brief dump 파일 경로를 정하는 함수 (prefix 뒤에 ".<pid>" 를 붙인다)
+ * @return void
+ * @param prefix 경로 앞부분
+ */
+void flight_set_path( const char *prefix){
+    snprintf( flight_path, sizeof( flight_path), "%s.%d", prefix, ( int)getpid());
+}
+
+/**
+ * @fn const char* flight_get_path()
+ * @brief dump 파일 경로를 구하는 함수
+ * @return 경로
+ */
+const char* flight_get_path(){
+    return flight_path;
+}
+
+/**
+ * @fn static void flight_put_str( char *line, int *len, const char *str)
+ * @brief line 뒤에 문자열을 붙이는 함수 (stdio 를 쓰지 않으므로 signal handler 에서 불러도 된다)
+ * @return void
+ */
+static void flight_put_str( char *line, int *len, const char *str){
+    while( *str != '\0'){
+        line[ ( *len)++] = *str++;
+    }
+}
+
+/**
+ * @fn static void flight_put_int( char *line, int *len, int64_t val)
+ * @brief line 뒤에 10진수를 붙이는 함수 (signal handler 에서 불러도 된다)
+ * @return void
+ */
+static void flight_put_int( char *line, int *len, int64_t val){
+    char digits[ 24];
+    uint64_t u = ( val < 0) ? ( uint64_t)( -val) : ( uint64_t)val;
+    int n = 0;
+
+    if( val < 0){
+        line[ ( *len)++] = '-';
+    }
+    do{
+        digits[ n++] = '0' + ( u % 10);
+        u /= 10;
+    } while( u > 0);
+    while( n > 0){
+        line[ ( *len)++] = digits[ --n];
+    }
+}
+
+/**
+ * @fn static int flight_format( char *line, const flight_ev_t *ev, int loop, double ns_per_ts)
+ * @brief event 하나를 dump 의 한 줄로 만드는 함수
+ * "<monotonic ns> loop=<n> fd=<fd> conn=<id> ev=<종류> rv=<결과> errno=<errno> aux=<값> state=<상태 글자>"
+ * @return 줄 길이
+ */
+static int flight_format( char *line, const flight_ev_t *ev, int loop, double ns_per_ts){
+    int len = 0;
+    int i;
+
+    flight_put_int( line, &len, ( int64_t)( flight_ns0 + ( int64_t)( ev->ts - flight_ts0) * ns_per_ts));
+    flight_put_str( line, &len, " loop=");
+    flight_put_int( line, &len, loop);
+    flight_put_str( line, &len, " fd=");
+    flight_put_int( line, &len, ev->fd);
+    flight_put_str( line, &len, " conn=");
+    flight_put_int( line, &len, ev->conn_id);
+    flight_put_str( line, &len, " ev=");
+    flight_put_str( line, &len, flight_ev_names[ ( ev->type < FLIGHT_EV_NUM) ? ev->type : 0]);
+    flight_put_str( line, &len, " rv=");
+    flight_put_int( line, &len, ev->rv);
+    flight_put_str( line, &len, " errno=");
+    flight_put_int( line, &len, ev->err);
+    flight_put_str( line, &len, " aux=");
+    flight_put_int( line, &len, ev->aux);
+    flight_put_str( line, &len, " state=");
+    if( ev->state == 0){
+        line[ len++] = '-';
+    }
+    for( i = 0; i < 8; i++){
+        if( ev->state & ( 1 << i)){
+            line[ len++] = flight_st_chars[ i];
+        }
+    }
+    line[ len++] = '\n';
+    return len;
+}
+
+/**
+ * @fn int flight_dump_all( int fd_filter)
+ * @brief 모든 event loop 의 ring 을 오래된 event 부터 dump 파일에 쓰는 함수
+ * malloc / stdio 없이 open / write 만 쓰므로 signal handler 에서 불러도 되고, 기록 중인 ring 도 lock 없이 읽는다
+ * (읽는 동안 덮어쓴 slot 은 앞뒤 seq 가 달라서 빠진다)
+ * @return 쓴 event 수, 파일을 열거나 쓰지 못하면 FD_ERR
+ * @param fd_filter 이 fd 의 event 만 쓴다 (FLIGHT_FD_ALL 이면 모두)
+ */
+int flight_dump_all( int fd_filter){
+    char out[ 8192];
+    flight_ev_t ev;
+    flight_t *flight;
+    uint64_t head, seq, ts_now, ns_now;
+    double ns_per_ts = 1.0;
+    int saved_errno = errno;
+    int fd, len = 0, written = 0;
+    int i, loop_num;
+
+    if( ( fd = open( flight_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0){
+        errno = saved_errno;
+        return FD_ERR;
+    }
+    ns_now = flight_now_ns();
+    ts_now = flight_now();
+    if( ts_now > flight_ts0){
+        ns_per_ts = ( double)( ns_now - flight_ns0) / ( ts_now - flight_ts0);
+    }
+
+    flight_put_str( out, &len, "# kmp flight recorder pid=");
+    flight_put_int( out, &len, getpid());
+    flight_put_str( out, &len, " now_ns=");
+    flight_put_int( out, &len, ( int64_t)ns_now);
+    flight_put_str( out, &len, " fd=");
+    if( fd_filter == FLIGHT_FD_ALL){
+        flight_put_str( out, &len, "all");
+    }
+    else{
+        flight_put_int( out, &len, fd_filter);
+    }
+    out[ len++] = '\n';
+
+    loop_num = __atomic_load_n( &flight_loop_num, __ATOMIC_ACQUIRE);
+    for( i = 0; ( i < loop_num) && ( i < FLIGHT_LOOP_MAX); i++){
+        if( ( flight = __atomic_load_n( &flight_loops[ i], __ATOMIC_ACQUIRE)) == NULL){
+            continue;
+        }
+        head = __atomic_load_n( &flight->head, __ATOMIC_ACQUIRE);
+        for( seq = ( head > ( uint64_t)flight->cap) ? head - flight->cap : 0; seq < head; seq++){
+            flight_ev_t *slot = &flight->ring[ seq & flight->mask];
+            uint32_t before = __atomic_load_n( &slot->seq, __ATOMIC_ACQUIRE);
+
+            memcpy( &ev, slot, sizeof( ev));
+            __atomic_thread_fence( __ATOMIC_ACQUIRE);
+            if( ( before != ( uint32_t)( seq + 1)) || ( __atomic_load_n( &slot->seq, __ATOMIC_RELAXED) != before)){
+                continue;
+            }
+            if( ( fd_filter != FLIGHT_FD_ALL) && ( ev.fd != fd_filter)){
+                continue;
+            }
+            if( len > ( int)sizeof( out) - 256){
+                if( write( fd, out, len) != len){
+                    close( fd);
+                    errno = saved_errno;
+                    return FD_ERR;
+                }
+                len = 0;
+            }
+            len += flight_format( &out[ len], &ev, i, ns_per_ts);
+            written++;
+        }
+    }
+    if( ( len > 0) && ( write( fd, out, len) != len)){
+        written = FD_ERR;
+    }
+    close( fd);
+    errno = saved_errno;
+    return written;
+}
@@ -0,0 +1,173 @@
+#pragma once
+#ifndef __FLIGHT_H__
+#define __FLIGHT_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#if defined( __x86_64__) || defined( __i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../COMMON/common.h"
+
+/// event loop 하나가 기억하는 기본 event 수 (-Y, 2의 거듭제곱으로 올린다)
+#define FLIGHT_EVENT_DEFAULT 4096
+#define FLIGHT_EVENT_MAX ( 1 << 20)
+/// 한 프로세스에서 기록하는 최대 event loop 수
+#define FLIGHT_LOOP_MAX 64
+/// dump 파일 경로 기본값 (뒤에 ".<pid>" 가 붙는다)
+#define FLIGHT_PATH_DEFAULT "/tmp/kmp_flight"
+/// dump 에서 모든 fd 를 쓴다는 filter 값
+#define FLIGHT_FD_ALL -1
+
+/// event 종류
+enum FLIGHT_EV{
+    /// 연결을 받았다 (rv : UDS 연결이면 1)
+    FLIGHT_EV_ACCEPT = 1,
+    /// 메시지를 읽었다 (rv : server_recv_data 결과, aux : 지금까지 받은 바이트 수)
+    FLIGHT_EV_READ,
+    /// 메시지 하나를 다 받았다 (rv : 메시지 길이, aux : code)
+    FLIGHT_EV_FRAME,
+    /// 응답을 썼다 (rv : server_send_data 결과, aux : 지금까지 보낸 바이트 수)
+    FLIGHT_EV_WRITE,
+    /// epoll 관찰 이벤트를 바꿨다 (rv : 결과, aux : 새 이벤트)
+    FLIGHT_EV_EPOLL,
+    /// 연결을 닫았다 (aux : 받다 만 바이트 수)
+    FLIGHT_EV_CLOSE,
+    FLIGHT_EV_NUM
+};
+
+/// event 에 남기는 연결 상태 bit (dump 에서는 글자 하나씩으로 나온다)
+enum FLIGHT_STATE{
+    /// H : 헤더를 다 받았다
+    FLIGHT_ST_RECV_HDR = 0x01,
+    /// B : 바디를 다 받았다
+    FLIGHT_ST_RECV_BODY = 0x02,
+    /// h : 응답 헤더를 다 보냈다
+    FLIGHT_ST_SEND_HDR = 0x04,
+    /// b : 응답 바디를 다 보냈다
+    FLIGHT_ST_SEND_BODY = 0x08,
+    /// W : upstream / cache / log 응답을 기다린다
+    FLIGHT_ST_WAIT = 0x10,
+    /// Q : run queue 에 있다
+    FLIGHT_ST_QUEUED = 0x20,
+    /// M : 송수신 버퍼를 빌리고 있다
+    FLIGHT_ST_BUF = 0x40,
+    /// O : EPOLLOUT 을 기다린다
+    FLIGHT_ST_OUT = 0x80
+};
+
+/// @struct flight_ev_t
+/// @brief ring 에 남기는 event 하나 (cache line 의 절반)
+typedef struct flight_ev_s flight_ev_t;
+struct flight_ev_s{
+    /// 이 slot 에 쓴 event 번호 + 1 의 하위 32 bit (쓰는 중이면 0, dump 가 덮어쓰는 중인 slot 을 거른다)
+    uint32_t seq;
+    /// 연결 file descriptor
+    int32_t fd;
+    /// 기록한 event loop 가 깨어난 시각 (TSC, x86 이 아니면 CLOCK_MONOTONIC ns)
+    uint64_t ts;
+    /// 연결 id
+    uint32_t conn_id;
+    /// system call / 상태 기계의 결과 (event 종류마다 다르다)
+    int32_t rv;
+    /// 결과와 같이 남기는 값 (바이트 수, code, 이벤트)
+    uint32_t aux;
+    /// errno (실패나 EAGAIN 이 아니면 0)
+    int16_t err;
+    /// event 종류 (FLIGHT_EV)
+    uint8_t type;
+    /// 기록할 때의 연결 상태 bit (server 가 정한다)
+    uint8_t state;
+};
+
+/// @struct flight_t
+/// @brief event loop 하나의 최근 event ring. 쓰는 쪽은 그 event loop 하나뿐이라 lock 없이 덮어쓰고,
+/// dump 는 다른 thread 나 signal handler 에서 slot 의 seq 로 다 쓴 event 만 골라 읽는다
+typedef struct flight_s flight_t;
+struct flight_s{
+    /// ring (cap 개, cap 은 2의 거듭제곱)
+    flight_ev_t *ring;
+    uint32_t mask;
+    int cap;
+    /// 다음에 쓸 event 번호 (지금까지 기록한 event 수)
+    uint64_t head;
+    /// event loop 가 마지막으로 깨어난 시각 (flight_tick, 같은 loop 에서 기록한 event 가 같이 쓴다)
+    uint64_t now;
+    /// dump 에 나오는 event loop 번호
+    int loop;
+};
+
+/**
+ * @fn static inline uint64_t flight_now()
+ * @brief event 시각을 구하는 함수 (x86 이면 rdtsc, dump 할 때 ns 로 바꾼다)
+ * @return 현재 시각
+ */
+static inline uint64_t flight_now(){
+#if defined( __x86_64__) || defined( __i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/**
+ * @fn static inline void flight_tick( flight_t *flight)
+ * @brief event loop 가 깨어날 때마다 event 에 남길 시각을 갱신하는 함수
+ * 시각을 event 마다 읽지 않고 loop 마다 한 번만 읽는다 (가상 머신에서는 rdtsc 도 수십 ns 가 걸린다).
+ * 같은 loop 안의 순서는 event 번호로 알 수 있다
+ * @return void
+ * @param flight event ring (NULL 이면 아무 것도 하지 않는다)
+ */
+static inline void flight_tick( flight_t *flight){
+    if( flight != NULL){
+        flight->now = flight_now();
+    }
+}
+
+/**
+ * @fn static inline void flight_record( flight_t *flight, int type, int fd, uint32_t conn_id, int state, int rv, int err, uint32_t aux)
+ * @brief event 하나를 ring 에 남기는 함수 (가장 오래된 event 를 덮어쓴다)
+ * slot 의 seq 를 0 으로 지운 뒤 내용을 쓰고 마지막에 seq 를 채운다 (dump 는 앞뒤 seq 가 같은 slot 만 쓴다)
+ * @return void
+ * @param flight event ring (NULL 이면 기록하지 않는다)
+ */
+static inline void flight_record( flight_t *flight, int type, int fd, uint32_t conn_id, int state, int rv, int err, uint32_t aux){
+    flight_ev_t *ev;
+    uint64_t seq;
+
+    if( flight == NULL){
+        return;
+    }
+    seq = flight->head;
+    ev = &flight->ring[ seq & flight->mask];
+    __atomic_store_n( &ev->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence( __ATOMIC_RELEASE);
+    ev->fd = fd;
+    ev->ts = flight->now;
+    ev->conn_id = conn_id;
+    ev->rv = rv;
+    ev->aux = aux;
+    ev->err = ( int16_t)err;
+    ev->type = ( uint8_t)type;
+    ev->state = ( uint8_t)state;
+    __atomic_store_n( &ev->seq, ( uint32_t)( seq + 1), __ATOMIC_RELEASE);
+    __atomic_store_n( &flight->head, seq + 1, __ATOMIC_RELEASE);
+}
+
+flight_t* flight_init( int cap);
+void flight_destroy( flight_t *flight);
+void flight_set_path( const char *prefix);
+const char* flight_get_path();
+int flight_dump_all( int fd_filter);
+
+#endif
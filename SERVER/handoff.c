@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+#include "handoff.h"
+#include <stddef.h>
+
+/**
+ * @fn uint64_t handoff_now_ms()
+ * @brief monotonic clock 기준 현재 시각을 ms 단위로 구하는 함수
+ * @return 현재 시각 (ms)
+ */
+uint64_t handoff_now_ms(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @fn static void handoff_set_timeout( int fd)
+ * @brief 상대 프로세스가 멈춰도 server 가 영원히 막히지 않게 송수신 timeout 을 거는 함수
+ * @return void
+ */
+static void handoff_set_timeout( int fd){
+    struct timeval tv;
+
+    tv.tv_sec = HANDOFF_RECV_TIMEOUT_MS / 1000;
+    tv.tv_usec = ( HANDOFF_RECV_TIMEOUT_MS % 1000) * 1000;
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof( tv));
+    setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof( tv));
+}
+
+/**
+ * @fn handoff_t* handoff_init( const char *path)
+ * @brief handoff 객체를 생성하는 함수 (소켓은 handoff_listen / handoff_connect 에서 연다)
+ * @return 생성된 객체, 실패하면 NULL
+ * @param path handoff UDS 경로
+ */
+handoff_t* handoff_init( const char *path){
+    handoff_t *handoff;
+
+    if( strlen( path) >= sizeof( handoff->addr.sun_path)){
+        printf("    | ! Handoff : path is too long (%s)\n", path);
+        return NULL;
+    }
+    if( ( handoff = ( handoff_t*)calloc( 1, sizeof( handoff_t))) == NULL){
+        printf("    | ! Handoff : Failed to allocate memory\n");
+        return NULL;
+    }
+    handoff->type = HANDOFF_EV_TYPE;
+    handoff->fd = -1;
+    handoff->state = HANDOFF_STATE_NONE;
+    handoff->addr.sun_family = AF_UNIX;
+    strncpy( handoff->addr.sun_path, path, sizeof( handoff->addr.sun_path) - 1);
+    return handoff;
+}
+
+/**
+ * @fn void handoff_destroy( handoff_t *handoff)
+ * @brief handoff 객체를 해제하는 함수
+ * 경로를 듣고 있던 프로세스만 경로를 지운다 (넘겨 준 프로세스가 지우면 새 프로세스의 경로가 사라진다)
+ * @return void
+ * @param handoff handoff 객체 (NULL 이면 아무 것도 하지 않는다)
+ */
+void handoff_destroy( handoff_t *handoff){
+    if( handoff == NULL){
+        return;
+    }
+    if( handoff->fd >= 0){
+        close( handoff->fd);
+        if( handoff->state == HANDOFF_STATE_LISTEN){
+            unlink( handoff->addr.sun_path);
+        }
+    }
+    free( handoff);
+}
+
+/**
+ * @fn int handoff_listen( handoff_t *handoff)
+ * @brief 경로에서 다음 프로세스의 연결을 기다리도록 listener 를 여는 함수 (남아 있는 경로는 지운다)
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param handoff handoff 객체
+ */
+int handoff_listen( handoff_t *handoff){
+    int fd;
+
+    if( ( fd = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0){
+        printf("    | ! Handoff : Failed to open socket (errno:%d)\n", errno);
+        return SOC_ERR;
+    }
+    unlink( handoff->addr.sun_path);
+    if( ( bind( fd, ( struct sockaddr*)&handoff->addr, sizeof( handoff->addr)) < 0) || ( listen( fd, 1) < 0)){
+        printf("    | ! Handoff : Failed to listen on %s (errno:%d)\n", handoff->addr.sun_path, errno);
+        close( fd);
+        return SOC_ERR;
+    }
+    handoff->fd = fd;
+    handoff->state = HANDOFF_STATE_LISTEN;
+    return NORMAL;
+}
+
+/**
+ * @fn int handoff_accept( handoff_t *handoff)
+ * @brief 다음 프로세스의 연결을 받고 listener 를 닫는 함수 (경로는 다음 프로세스가 다시 연다)
+ * @return 정상이면 NORMAL, 아직 연결이 없으면 INTERRUPT, 실패하면 SOC_ERR
+ * @param handoff HANDOFF_STATE_LISTEN 상태의 handoff 객체
+ */
+int handoff_accept( handoff_t *handoff){
+    int fd;
+
+    if( ( fd = accept4( handoff->fd, NULL, NULL, SOCK_CLOEXEC)) < 0){
+        if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+            return INTERRUPT;
+        }
+        printf("    | ! Handoff : accept error (errno:%d)\n", errno);
+        return SOC_ERR;
+    }
+    handoff_set_timeout( fd);
+    close( handoff->fd);
+    handoff->fd = fd;
+    handoff->state = HANDOFF_STATE_SEND;
+    handoff->start_ms = handoff_now_ms();
+    return NORMAL;
+}
+
+/**
+ * @fn int handoff_connect( handoff_t *handoff)
+ * @brief 경로에서 기다리는 실행 중인 프로세스에 연결하는 함수
+ * @return 연결했으면 NORMAL, 기다리는 프로세스가 없으면 SOC_ERR
+ * @param handoff handoff 객체
+ */
+int handoff_connect( handoff_t *handoff){
+    int fd;
+
+    if( ( fd = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0){
+        printf("    | ! Handoff : Failed to open socket (errno:%d)\n", errno);
+        return SOC_ERR;
+    }
+    if( connect( fd, ( struct sockaddr*)&handoff->addr, sizeof( handoff->addr)) < 0){
+        close( fd);
+        return SOC_ERR;
+    }
+    handoff_set_timeout( fd);
+    handoff->fd = fd;
+    handoff->state = HANDOFF_STATE_RECV;
+    handoff->start_ms = handoff_now_ms();
+    return NORMAL;
+}
+
+/**
+ * @fn int handoff_send( handoff_t *handoff, int type, uint32_t conn_seq, const int *fds, const handoff_conn_t *conns, int num)
+ * @brief fd 들과 연결 상태를 메시지 하나로 보내는 함수 (fd 는 SCM_RIGHTS 로 복제되므로 보낸 뒤 닫아도 된다)
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ * @param handoff 상대 프로세스와 연결된 handoff 객체
+ * @param type 메시지 종류 (HANDOFF_MSG)
+ * @param conn_seq 마지막으로 발급한 연결 id
+ * @param fds 보낼 fd 목록 (num 개, HANDOFF_FD_MAX 이하)
+ * @param conns fd 별 연결 상태 (NULL 이면 비워서 보낸다)
+ * @param num fd 수
+ */
+int handoff_send( handoff_t *handoff, int type, uint32_t conn_seq, const int *fds, const handoff_conn_t *conns, int num){
+    char control[ CMSG_SPACE( sizeof( int) * HANDOFF_FD_MAX)];
+    struct cmsghdr *cmsg;
+    handoff_msg_t hmsg;
+    struct msghdr msg;
+    struct iovec iov;
+
+    if( ( num < 0) || ( num > HANDOFF_FD_MAX)){
+        return SOC_ERR;
+    }
+    memset( &hmsg, 0, offsetof( handoff_msg_t, conns));
+    hmsg.type = type;
+    hmsg.num = num;
+    hmsg.conn_seq = conn_seq;
+    if( conns != NULL){
+        memcpy( hmsg.conns, conns, sizeof( handoff_conn_t) * num);
+    }
+    else{
+        memset( hmsg.conns, 0, sizeof( handoff_conn_t) * num);
+    }
+
+    memset( &msg, 0, sizeof( msg));
+    iov.iov_base = &hmsg;
+    iov.iov_len = offsetof( handoff_msg_t, conns) + sizeof( handoff_conn_t) * num;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if( num > 0){
+        memset( control, 0, sizeof( control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE( sizeof( int) * num);
+        cmsg = CMSG_FIRSTHDR( &msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN( sizeof( int) * num);
+        memcpy( CMSG_DATA( cmsg), fds, sizeof( int) * num);
+    }
+
+    if( sendmsg( handoff->fd, &msg, MSG_NOSIGNAL) < 0){
+        printf("    | ! Handoff : sendmsg error (errno:%d)\n", errno);
+        return SOC_ERR;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int handoff_recv( handoff_t *handoff, handoff_msg_t *msg, int *fds)
+ * @brief 메시지 하나와 같이 온 fd 들을 받는 함수
+ * @return 받은 fd 수, 상대가 끊었거나 메시지가 깨졌으면 SOC_ERR
+ * @param handoff 상대 프로세스와 연결된 handoff 객체
+ * @param msg 받은 메시지를 저장할 버퍼
+ * @param fds 받은 fd 를 저장할 배열 (HANDOFF_FD_MAX 개)
+ */
+int handoff_recv( handoff_t *handoff, handoff_msg_t *msg, int *fds){
+    char control[ CMSG_SPACE( sizeof( int) * HANDOFF_FD_MAX)];
+    struct cmsghdr *cmsg;
+    struct msghdr mh;
+    struct iovec iov;
+    int rv, num = 0, i;
+
+    memset( &mh, 0, sizeof( mh));
+    iov.iov_base = msg;
+    iov.iov_len = sizeof( handoff_msg_t);
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof( control);
+
+    if( ( rv = recvmsg( handoff->fd, &mh, MSG_CMSG_CLOEXEC)) <= 0){
+        if( rv < 0){
+            printf("    | ! Handoff : recvmsg error (errno:%d)\n", errno);
+        }
+        return SOC_ERR;
+    }
+    if( ( cmsg = CMSG_FIRSTHDR( &mh)) != NULL){
+        if( ( cmsg->cmsg_level == SOL_SOCKET) && ( cmsg->cmsg_type == SCM_RIGHTS)){
+            num = ( cmsg->cmsg_len - CMSG_LEN( 0)) / sizeof( int);
+            memcpy( fds, CMSG_DATA( cmsg), sizeof( int) * num);
+        }
+    }
+
+    if( ( ( size_t)rv < offsetof( handoff_msg_t, conns)) || ( mh.msg_flags & ( MSG_TRUNC | MSG_CTRUNC))
+            || ( msg->num != ( uint32_t)num) || ( ( size_t)rv != offsetof( handoff_msg_t, conns) + sizeof( handoff_conn_t) * num)){
+        printf("    | ! Handoff : broken message (len:%d) (fds:%d)\n", rv, num);
+        for( i = 0; i < num; i++){
+            close( fds[ i]);
+        }
+        return SOC_ERR;
+    }
+    return num;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#ifndef __HANDOFF_H__
+#define __HANDOFF_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <sys/un.h>
+
+#include "../COMMON/common.h"
+
+/// epoll 이벤트 종류 (handoff_t 의 첫 번째 멤버, server 의 다른 이벤트 종류와 겹치지 않는다)
+#define HANDOFF_EV_TYPE 8
+/// 메시지 하나로 넘기는 최대 fd 수 (SCM_MAX_FD 253 보다 작게)
+#define HANDOFF_FD_MAX 64
+/// 새 프로세스가 listener 를 받을 때까지 기다리는 최대 시간 (ms)
+#define HANDOFF_RECV_TIMEOUT_MS 5000
+/// 이전 프로세스가 바쁜 연결이 끝나기를 기다리는 최대 시간 (ms). 지나면 남은 연결을 닫고 끝낸다
+#define HANDOFF_DRAIN_MS 30000
+/// 넘겨 주는 동안 idle 이 된 연결을 확인하는 주기 (ms)
+#define HANDOFF_TICK_MS 10
+
+/// handoff 메시지 종류
+enum HANDOFF_MSG{
+    /// listener (TCP, 있으면 UDS) 와 마지막 연결 id
+    HANDOFF_MSG_LISTEN = 1,
+    /// idle client 연결들
+    HANDOFF_MSG_CONN,
+    /// 넘길 연결이 더 없다 (이전 프로세스는 곧 끝난다)
+    HANDOFF_MSG_DONE
+};
+
+/// handoff 객체 상태
+enum HANDOFF_STATE{
+    /// 아무 것도 하지 않는다
+    HANDOFF_STATE_NONE = 0,
+    /// 경로에서 다음 프로세스의 연결을 기다린다
+    HANDOFF_STATE_LISTEN,
+    /// (이전 프로세스) listener 를 넘겼고 idle 이 된 연결을 넘기는 중이다
+    HANDOFF_STATE_SEND,
+    /// (새 프로세스) 이전 프로세스가 넘기는 연결을 받는 중이다
+    HANDOFF_STATE_RECV,
+    /// (이전 프로세스) 모두 넘겼으므로 끝내야 한다
+    HANDOFF_STATE_DONE
+};
+
+/// @struct handoff_conn_t
+/// @brief fd 와 같이 넘기는 연결 하나의 상태
+typedef struct handoff_conn_s handoff_conn_t;
+struct handoff_conn_s{
+    /// capture 파일에 남기는 연결 id (새 프로세스에서도 그대로 쓴다)
+    uint32_t conn_id;
+    /// AF_UNIX listener 로 들어온 연결인지 여부
+    uint8_t is_unix;
+    uint8_t reserved[ 3];
+};
+
+/// @struct handoff_msg_t
+/// @brief UDS(SOCK_SEQPACKET) 로 주고 받는 handoff 메시지. fd 는 SCM_RIGHTS 로 conns 와 같은 순서로 붙는다
+typedef struct handoff_msg_s handoff_msg_t;
+struct handoff_msg_s{
+    /// 메시지 종류 (HANDOFF_MSG)
+    uint32_t type;
+    /// 붙어 있는 fd 수
+    uint32_t num;
+    /// 이전 프로세스가 마지막으로 발급한 연결 id
+    uint32_t conn_seq;
+    uint32_t reserved;
+    /// fd 별 연결 상태 (HANDOFF_MSG_CONN)
+    handoff_conn_t conns[ HANDOFF_FD_MAX];
+};
+
+/// @struct handoff_t
+/// @brief 실행 중인 프로세스와 새 프로세스 사이에서 listener / 연결을 넘기는 UDS 끝점
+/// epoll data.ptr 가 직접 가리킨다
+typedef struct handoff_s handoff_t;
+struct handoff_s{
+    /// epoll 이벤트 종류 (HANDOFF_EV_TYPE)
+    int type;
+    /// 상태에 따라 경로의 listener 또는 상대 프로세스와의 연결 (없으면 -1)
+    int fd;
+    /// 상태 (HANDOFF_STATE)
+    int state;
+    /// handoff UDS 경로
+    struct sockaddr_un addr;
+    /// 연결을 넘기기 시작한 시각 (ms)
+    uint64_t start_ms;
+    /// 넘기거나 넘겨 받은 연결 수
+    uint64_t conns;
+};
+
+uint64_t handoff_now_ms();
+handoff_t* handoff_init( const char *path);
+void handoff_destroy( handoff_t *handoff);
+int handoff_listen( handoff_t *handoff);
+int handoff_accept( handoff_t *handoff);
+int handoff_connect( handoff_t *handoff);
+int handoff_send( handoff_t *handoff, int type, uint32_t conn_seq, const int *fds, const handoff_conn_t *conns, int num);
+int handoff_recv( handoff_t *handoff, handoff_msg_t *msg, int *fds);
+
+#endif
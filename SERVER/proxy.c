@@ -0,0 +1,319 @@
+#define _GNU_SOURCE
+#include "proxy.h"
+
+/**
+ * @fn static int proxy_dir_init( proxy_dir_t *dir, int src_fd, int dst_fd)
+ * @brief 한 방향 중계 상태를 초기화하고 splice 용 pipe를 만드는 함수
+ * @return 정상이면 NORMAL, 실패하면 FD_ERR
+ * @param dir 초기화할 중계 상태
+ * @param src_fd 읽는 쪽 소켓
+ * @param dst_fd 쓰는 쪽 소켓
+ */
+static int proxy_dir_init( proxy_dir_t *dir, int src_fd, int dst_fd){
+    memset( dir, 0, sizeof( proxy_dir_t));
+    dir->src_fd = src_fd;
+    dir->dst_fd = dst_fd;
+    dir->state = PROXY_HDR_RECV;
+
+    if( pipe2( dir->pipe_fd, O_NONBLOCK | O_CLOEXEC) < 0){
+        printf("    | ! Proxy : pipe error (errno:%d)\n", errno);
+        dir->pipe_fd[ 0] = -1;
+        dir->pipe_fd[ 1] = -1;
+        return FD_ERR;
+    }
+    // 실패해도 기본 크기(64KB)로 동작한다
+    fcntl( dir->pipe_fd[ 1], F_SETPIPE_SZ, PROXY_PIPE_SIZE);
+    return NORMAL;
+}
+
+/**
+ * @fn static void proxy_dir_close( proxy_dir_t *dir)
+ * @brief 한 방향 중계에 사용한 pipe를 닫는 함수
+ * @return void
+ * @param dir 닫을 중계 상태
+ */
+static void proxy_dir_close( proxy_dir_t *dir){
+    if( dir->pipe_fd[ 0] >= 0){
+        close( dir->pipe_fd[ 0]);
+    }
+    if( dir->pipe_fd[ 1] >= 0){
+        close( dir->pipe_fd[ 1]);
+    }
+}
+
+/**
+ * @fn static int proxy_dir_pump( proxy_dir_t *dir)
+ * @brief 한 방향으로 메시지를 더 이상 진행할 수 없을 때까지 중계하는 함수
+ * 헤더 20바이트만 user space로 읽어서 길이를 구하고, 바디는 src -> pipe -> dst 로 splice 한다
+ * @return 진행할 수 없으면 NORMAL, src가 끊기면 ZERO_BYTE, 그 외 에러는 열거형 참고
+ * @param dir 중계할 방향
+ */
+static int proxy_dir_pump( proxy_dir_t *dir){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)dir->hdr_buf;
+    ssize_t rv;
+
+    dir->is_wait_out = 0;
+    while( 1){
+        if( dir->state == PROXY_HDR_RECV){
+            rv = read( dir->src_fd, &dir->hdr_buf[ dir->hdr_recv], PROXY_HDR_LEN - dir->hdr_recv);
+            if( rv < 0){
+                if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                    return NORMAL;
+                }
+                else if( errno == EINTR){
+                    continue;
+                }
+                printf("    | ! Proxy : read error (errno:%d) (in recv msg header) (fd:%d)\n", errno, dir->src_fd);
+                return NEGATIVE_BYTE;
+            }
+            else if( rv == 0){
+                return ZERO_BYTE;
+            }
+
+            dir->hdr_recv += rv;
+            if( dir->hdr_recv < PROXY_HDR_LEN){
+                continue;
+            }
+
+            if( hdr->length < PROXY_HDR_LEN){
+                printf("    | ! Proxy : wrong msg length (len:%d) (fd:%d)\n", hdr->length, dir->src_fd);
+                return BUF_ERR;
+            }
+            dir->body_left = hdr->length - PROXY_HDR_LEN;
+            dir->hdr_sent = 0;
+            dir->state = PROXY_HDR_SEND;
+        }
+        else if( dir->state == PROXY_HDR_SEND){
+            rv = write( dir->dst_fd, &dir->hdr_buf[ dir->hdr_sent], PROXY_HDR_LEN - dir->hdr_sent);
+            if( rv < 0){
+                if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                    dir->is_wait_out = 1;
+                    return NORMAL;
+                }
+                else if( errno == EINTR){
+                    continue;
+                }
+                printf("    | ! Proxy : write error (errno:%d) (in send msg header) (fd:%d)\n", errno, dir->dst_fd);
+                return NEGATIVE_BYTE;
+            }
+
+            dir->hdr_sent += rv;
+            if( dir->hdr_sent < PROXY_HDR_LEN){
+                continue;
+            }
+            dir->state = PROXY_BODY;
+        }
+        else{
+            // 1. src -> pipe
+            if( dir->body_left > 0){
+                rv = splice( dir->src_fd, NULL, dir->pipe_fd[ 1], NULL, dir->body_left, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if( rv > 0){
+                    dir->body_left -= rv;
+                    dir->pipe_bytes += rv;
+                }
+                else if( rv == 0){
+                    return ZERO_BYTE;
+                }
+                else if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                    // src가 비었거나 pipe가 가득 찼다. pipe도 비어 있으면 src를 기다린다
+                    if( dir->pipe_bytes == 0){
+                        return NORMAL;
+                    }
+                }
+                else if( errno != EINTR){
+                    printf("    | ! Proxy : splice error (errno:%d) (src:%d)\n", errno, dir->src_fd);
+                    return NEGATIVE_BYTE;
+                }
+            }
+
+            // 2. pipe -> dst
+            if( dir->pipe_bytes > 0){
+                rv = splice( dir->pipe_fd[ 0], NULL, dir->dst_fd, NULL, dir->pipe_bytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if( rv > 0){
+                    dir->pipe_bytes -= rv;
+                    dir->body_bytes += rv;
+                }
+                else if( ( rv < 0) && ( ( errno == EAGAIN) || ( errno == EWOULDBLOCK))){
+                    dir->is_wait_out = 1;
+                    return NORMAL;
+                }
+                else if( ( rv == 0) || ( errno != EINTR)){
+                    printf("    | ! Proxy : splice error (errno:%d) (dst:%d)\n", errno, dir->dst_fd);
+                    return NEGATIVE_BYTE;
+                }
+            }
+
+            if( ( dir->body_left == 0) && ( dir->pipe_bytes == 0)){
+                dir->msgs++;
+                dir->hdr_recv = 0;
+                dir->state = PROXY_HDR_RECV;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn proxy_t* proxy_init( int client_fd, struct sockaddr_in *upstream_addr)
+ * @brief client 연결 하나에 대한 upstream 연결(non-blocking connect)과 pipe를 만드는 함수
+ * @return 생성된 proxy 객체, 실패하면 NULL
+ * @param client_fd accept 된 client 소켓 (non-blocking)
+ * @param upstream_addr upstream kmp server 주소
+ */
+proxy_t* proxy_init( int client_fd, struct sockaddr_in *upstream_addr){
+    proxy_t *proxy = ( proxy_t*)malloc( sizeof( proxy_t));
+    int nodelay = 1;
+
+    if( proxy == NULL){
+        printf("    | ! Proxy : Failed to allocate memory\n");
+        return NULL;
+    }
+
+    proxy->client_fd = client_fd;
+    proxy->is_connected = 0;
+    proxy->client_events = 0;
+    proxy->upstream_events = 0;
+    if( ( proxy->upstream_fd = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP)) < 0){
+        printf("    | ! Proxy : Failed to open upstream socket\n");
+        free( proxy);
+        return NULL;
+    }
+    setsockopt( proxy->upstream_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof( nodelay));
+
+    proxy->req.pipe_fd[ 0] = proxy->req.pipe_fd[ 1] = -1;
+    proxy->rsp.pipe_fd[ 0] = proxy->rsp.pipe_fd[ 1] = -1;
+    if( ( proxy_dir_init( &proxy->req, client_fd, proxy->upstream_fd) < NORMAL)
+            || ( proxy_dir_init( &proxy->rsp, proxy->upstream_fd, client_fd) < NORMAL)){
+        proxy_destroy( proxy);
+        return NULL;
+    }
+
+    if( connect( proxy->upstream_fd, ( struct sockaddr*)upstream_addr, sizeof( struct sockaddr_in)) == 0){
+        proxy->is_connected = 1;
+    }
+    else if( errno != EINPROGRESS){
+        printf("    | ! Proxy : Failed to connect upstream (errno:%d)\n", errno);
+        proxy_destroy( proxy);
+        return NULL;
+    }
+    return proxy;
+}
+
+/**
+ * @fn void proxy_destroy( proxy_t *proxy)
+ * @brief upstream 소켓과 pipe를 닫고 proxy 객체를 해제하는 함수 (client 소켓은 닫지 않는다)
+ * @return void
+ * @param proxy 해제할 proxy 객체
+ */
+void proxy_destroy( proxy_t *proxy){
+    if( proxy == NULL){
+        return;
+    }
+    TRACE_PRINT("    | @ Proxy : relayed req %llu msgs / %llu bytes, rsp %llu msgs / %llu bytes (fd:%d)\n",
+            ( unsigned long long)proxy->req.msgs, ( unsigned long long)proxy->req.body_bytes,
+            ( unsigned long long)proxy->rsp.msgs, ( unsigned long long)proxy->rsp.body_bytes, proxy->client_fd);
+    proxy_dir_close( &proxy->req);
+    proxy_dir_close( &proxy->rsp);
+    close( proxy->upstream_fd);
+    free( proxy);
+}
+
+/**
+ * @fn uint32_t proxy_get_events( proxy_t *proxy, int fd)
+ * @brief 중계 상태에 맞게 client / upstream 소켓이 관찰해야 할 epoll 이벤트를 구하는 함수
+ * dst가 막힌 방향은 src 읽기를 멈춰서 level-triggered epoll이 헛돌지 않게 한다
+ * @return epoll 이벤트 (EPOLLIN, EPOLLOUT)
+ * @param proxy proxy 객체
+ * @param fd client_fd 또는 upstream_fd
+ */
+uint32_t proxy_get_events( proxy_t *proxy, int fd){
+    proxy_dir_t *in_dir = ( fd == proxy->client_fd) ? &proxy->req : &proxy->rsp;
+    proxy_dir_t *out_dir = ( fd == proxy->client_fd) ? &proxy->rsp : &proxy->req;
+    uint32_t events = 0;
+
+    if( proxy->is_connected == 0){
+        return ( fd == proxy->upstream_fd) ? EPOLLOUT : 0;
+    }
+
+    if( in_dir->is_wait_out == 0){
+        events |= EPOLLIN;
+    }
+    if( out_dir->is_wait_out == 1){
+        events |= EPOLLOUT;
+    }
+    return events;
+}
+
+/**
+ * @fn int proxy_process( proxy_t *proxy, int event_fd, uint32_t events)
+ * @brief client 또는 upstream 소켓에서 발생한 epoll 이벤트를 처리하는 함수
+ * @return 정상이면 NORMAL, NORMAL 미만이면 연결 전체를 닫아야 한다
+ * @param proxy proxy 객체
+ * @param event_fd 이벤트가 발생한 소켓
+ * @param events 발생한 epoll 이벤트
+ */
+int proxy_process( proxy_t *proxy, int event_fd, uint32_t events){
+    int error = 0;
+    socklen_t err_len = sizeof( error);
+    int rv;
+
+    if( proxy->is_connected == 0){
+        if( event_fd != proxy->upstream_fd){
+            return ( events & ( EPOLLHUP | EPOLLERR)) ? ZERO_BYTE : NORMAL;
+        }
+        if( ( getsockopt( proxy->upstream_fd, SOL_SOCKET, SO_ERROR, &error, &err_len) < 0) || ( error != 0)){
+            printf("    | ! Proxy : Failed to connect upstream (errno:%d)\n", error);
+            return SOC_ERR;
+        }
+        proxy->is_connected = 1;
+        TRACE_PRINT("    | @ Proxy : upstream connected (fd:%d)\n", proxy->upstream_fd);
+    }
+
+    if( events & ( EPOLLHUP | EPOLLERR)){
+        events |= EPOLLIN | EPOLLOUT;
+    }
+
+    // client가 읽을 수 있거나 upstream이 쓸 수 있으면 요청 방향을 진행
+    if( ( ( event_fd == proxy->client_fd) && ( events & EPOLLIN))
+            || ( ( event_fd == proxy->upstream_fd) && ( events & EPOLLOUT))){
+        if( ( rv = proxy_dir_pump( &proxy->req)) < NORMAL){
+            return rv;
+        }
+    }
+
+    // upstream이 읽을 수 있거나 client가 쓸 수 있으면 응답 방향을 진행
+    if( ( ( event_fd == proxy->upstream_fd) && ( events & EPOLLIN))
+            || ( ( event_fd == proxy->client_fd) && ( events & EPOLLOUT))){
+        if( ( rv = proxy_dir_pump( &proxy->rsp)) < NORMAL){
+            return rv;
+        }
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn int proxy_parse_addr( const char *str, struct sockaddr_in *addr)
+ * @brief "ip:port" 형식의 upstream 주소를 해석하는 함수
+ * @return 정상이면 NORMAL, 형식이 잘못되면 HOST_ERR
+ * @param str 해석할 문자열
+ * @param addr 해석 결과를 저장할 주소
+ */
+int proxy_parse_addr( const char *str, struct sockaddr_in *addr){
+    char ip[ 64];
+    const char *colon = strrchr( str, ':');
+
+    if( ( colon == NULL) || ( ( size_t)( colon - str) >= sizeof( ip))){
+        return HOST_ERR;
+    }
+    memcpy( ip, str, colon - str);
+    ip[ colon - str] = '\0';
+
+    memset( addr, 0, sizeof( struct sockaddr_in));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons( atoi( colon + 1));
+    if( inet_pton( AF_INET, ip, &addr->sin_addr) != 1){
+        return HOST_ERR;
+    }
+    return NORMAL;
+}
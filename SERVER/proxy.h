@@ -0,0 +1,93 @@
+#pragma once
+#ifndef __PROXY_H__
+#define __PROXY_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+
+#define PROXY_HDR_LEN 20
+/// splice에 사용하는 pipe 크기 (커널이 허용하지 않으면 기본값 사용)
+#define PROXY_PIPE_SIZE ( 1 << 18)
+
+/// @enum PROXY_STATE
+/// @brief 한 방향 중계의 진행 상태
+enum PROXY_STATE{
+    /// src에서 헤더 수신 중
+    PROXY_HDR_RECV = 0,
+    /// dst로 헤더 송신 중
+    PROXY_HDR_SEND = 1,
+    /// src -> pipe -> dst 로 바디 splice 중
+    PROXY_BODY = 2
+};
+
+/// @struct proxy_dir_t
+/// @brief 한 방향(client -> upstream 또는 upstream -> client) 중계 상태
+typedef struct proxy_dir_s proxy_dir_t;
+struct proxy_dir_s{
+    /// 읽는 쪽 소켓
+    int src_fd;
+    /// 쓰는 쪽 소켓
+    int dst_fd;
+    /// splice 용 pipe (0 : read, 1 : write)
+    int pipe_fd[ 2];
+    /// 진행 상태 (PROXY_STATE)
+    int state;
+    /// 수신한 헤더 바이트 수
+    int hdr_recv;
+    /// 송신한 헤더 바이트 수
+    int hdr_sent;
+    /// src에서 아직 pipe로 옮기지 않은 바디 바이트 수
+    uint32_t body_left;
+    /// pipe에 들어 있는 (dst로 아직 보내지 않은) 바이트 수
+    uint32_t pipe_bytes;
+    /// dst 송신 버퍼가 가득 차서 EPOLLOUT을 기다리는지 여부
+    int is_wait_out;
+    /// 중계한 메시지 수
+    uint64_t msgs;
+    /// 중계한 바디 바이트 수
+    uint64_t body_bytes;
+    /// 헤더만 decode 하기 위한 버퍼
+    char hdr_buf[ PROXY_HDR_LEN];
+};
+
+/// @struct proxy_t
+/// @brief client 연결 하나를 upstream kmp server로 zero copy 중계하기 위한 구조체
+typedef struct proxy_s proxy_t;
+struct proxy_s{
+    /// client 소켓
+    int client_fd;
+    /// upstream 소켓
+    int upstream_fd;
+    /// upstream 연결 완료 여부
+    int is_connected;
+    /// client 소켓에 등록된 epoll 이벤트
+    uint32_t client_events;
+    /// upstream 소켓에 등록된 epoll 이벤트
+    uint32_t upstream_events;
+    /// client -> upstream
+    proxy_dir_t req;
+    /// upstream -> client
+    proxy_dir_t rsp;
+};
+
+proxy_t* proxy_init( int client_fd, struct sockaddr_in *upstream_addr);
+void proxy_destroy( proxy_t *proxy);
+int proxy_process( proxy_t *proxy, int event_fd, uint32_t events);
+uint32_t proxy_get_events( proxy_t *proxy, int fd);
+int proxy_parse_addr( const char *str, struct sockaddr_in *addr);
+
+#endif
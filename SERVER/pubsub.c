@@ -0,0 +1,478 @@
+#include "pubsub.h"
+
+/**
+ * @fn static uint64_t pubsub_hash( uint32_t app_id, const char *prefix, int prefix_len)
+ * @brief (app_id, prefix) topic key 의 64 bit hash 를 구하는 함수 (FNV-1a + murmur3 fmix64)
+ * @return hash 값
+ */
+static uint64_t pubsub_hash( uint32_t app_id, const char *prefix, int prefix_len){
+    uint64_t h = 14695981039346656037ULL;
+    int i;
+
+    for( i = 0; i < prefix_len; i++){
+        h ^= ( uint8_t)prefix[ i];
+        h *= 1099511628211ULL;
+    }
+    h ^= ( ( ( uint64_t)prefix_len << 32) | app_id) * 0x9E3779B97F4A7C15ULL;
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * @fn static pubsub_topic_t* pubsub_topic_find( pubsub_t *pubsub, uint64_t hash, uint32_t app_id, const char *prefix, int prefix_len)
+ * @brief topic 을 찾는 함수
+ * @return topic, 없으면 NULL
+ */
+static pubsub_topic_t* pubsub_topic_find( pubsub_t *pubsub, uint64_t hash, uint32_t app_id, const char *prefix, int prefix_len){
+    pubsub_topic_t *topic;
+
+    for( topic = pubsub->buckets[ hash & ( PUBSUB_BUCKET_NUM - 1)]; topic != NULL; topic = topic->hash_next){
+        if( ( topic->hash == hash) && ( topic->app_id == app_id) && ( topic->prefix_len == prefix_len)
+                && ( memcmp( topic->prefix, prefix, prefix_len) == 0)){
+            return topic;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn static void pubsub_topic_free( pubsub_t *pubsub, pubsub_topic_t *topic)
+ * @brief 구독자가 없는 topic 을 hash 에서 빼고 해제하는 함수
+ */
+static void pubsub_topic_free( pubsub_t *pubsub, pubsub_topic_t *topic){
+    pubsub_topic_t **link = &pubsub->buckets[ topic->hash & ( PUBSUB_BUCKET_NUM - 1)];
+
+    while( *link != NULL){
+        if( *link == topic){
+            *link = topic->hash_next;
+            break;
+        }
+        link = &( *link)->hash_next;
+    }
+    if( --pubsub->prefix_cnt[ topic->prefix_len] == 0){
+        pubsub->prefix_lens &= ~( 1ULL << topic->prefix_len);
+    }
+    pubsub->topic_num--;
+    free( topic->subs);
+    free( topic);
+}
+
+/**
+ * @fn static void pubsub_sub_unlink( pubsub_t *pubsub, pubsub_sub_t *sub, int i)
+ * @brief 연결의 i 번째 구독을 topic 구독자 목록에서 빼는 함수
+ * 목록의 마지막 구독자를 빈 자리로 옮기고, 옮긴 구독자가 기억하는 위치도 고친다
+ */
+static void pubsub_sub_unlink( pubsub_t *pubsub, pubsub_sub_t *sub, int i){
+    pubsub_topic_t *topic = sub->topics[ i];
+    int idx = sub->topic_idx[ i];
+    pubsub_sub_t *moved;
+    int j;
+
+    moved = topic->subs[ --topic->sub_num];
+    topic->subs[ idx] = moved;
+    for( j = 0; j < moved->topic_num; j++){
+        if( moved->topics[ j] == topic){
+            moved->topic_idx[ j] = idx;
+            break;
+        }
+    }
+    sub->topics[ i] = sub->topics[ --sub->topic_num];
+    sub->topic_idx[ i] = sub->topic_idx[ sub->topic_num];
+    if( topic->sub_num == 0){
+        pubsub_topic_free( pubsub, topic);
+    }
+}
+
+/**
+ * @fn static void pubsub_msg_put( pubsub_msg_t *msg)
+ * @brief 메시지의 참조를 하나 놓는 함수 (마지막 참조면 해제한다)
+ */
+static void pubsub_msg_put( pubsub_msg_t *msg){
+    if( --msg->refcnt == 0){
+        free( msg);
+    }
+}
+
+/**
+ * @fn static int pubsub_sub_grow( pubsub_sub_t *sub, int max)
+ * @brief 가득 찬 연결 queue 를 두 배로 늘리는 함수 (ring 을 펴서 head 를 0 으로 옮긴다)
+ * @return 늘렸으면 NORMAL, 이미 최대 크기거나 메모리가 없으면 BUF_ERR
+ */
+static int pubsub_sub_grow( pubsub_sub_t *sub, int max){
+    pubsub_msg_t **queue;
+    int cap = ( sub->cap == 0) ? PUBSUB_QUEUE_INIT : sub->cap * 2;
+    int i;
+
+    if( sub->cap >= max){
+        return BUF_ERR;
+    }
+    if( cap > max){
+        cap = max;
+    }
+    if( ( queue = ( pubsub_msg_t**)malloc( sizeof( pubsub_msg_t*) * cap)) == NULL){
+        return BUF_ERR;
+    }
+    for( i = 0; i < sub->num; i++){
+        queue[ i] = sub->queue[ ( sub->head + i) % sub->cap];
+    }
+    free( sub->queue);
+    sub->queue = queue;
+    sub->head = 0;
+    sub->cap = cap;
+    return NORMAL;
+}
+
+/**
+ * @fn static void pubsub_sub_enqueue( pubsub_t *pubsub, pubsub_sub_t *sub, pubsub_msg_t *msg)
+ * @brief 구독자 queue 에 메시지 참조를 넣고 ready 목록에 올리는 함수 (queue 가 넘치면 policy 를 따른다)
+ */
+static void pubsub_sub_enqueue( pubsub_t *pubsub, pubsub_sub_t *sub, pubsub_msg_t *msg){
+    if( ( sub->pub_seq == pubsub->pub_seq) || sub->is_slow){
+        return;
+    }
+    sub->pub_seq = pubsub->pub_seq;
+    if( ( sub->num == sub->cap) && ( pubsub_sub_grow( sub, pubsub->queue_len) < NORMAL)){
+        if( pubsub->policy == PUBSUB_POLICY_CLOSE){
+            sub->is_slow = 1;
+            pubsub_ready_push( pubsub, sub);
+        }
+        else{
+            pubsub->drops++;
+        }
+        return;
+    }
+    msg->refcnt++;
+    sub->queue[ ( sub->head + sub->num) % sub->cap] = msg;
+    sub->num++;
+    pubsub->queued++;
+    pubsub->deliveries++;
+    pubsub_ready_push( pubsub, sub);
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn pubsub_t* pubsub_init( int queue_len, int policy)
+ * @brief topic 목록을 생성하는 함수
+ * @return 생성된 pubsub, 실패하면 NULL
+ * @param queue_len 연결마다 쌓아 두는 최대 메시지 수
+ * @param policy queue 가 가득 찼을 때의 처리 (PUBSUB_POLICY)
+ */
+pubsub_t* pubsub_init( int queue_len, int policy){
+    pubsub_t *pubsub = ( pubsub_t*)calloc( 1, sizeof( pubsub_t));
+
+    if( pubsub == NULL){
+        printf("    | ! Pubsub : Failed to allocate memory\n");
+        return NULL;
+    }
+    pubsub->queue_len = ( queue_len > 0) ? queue_len : PUBSUB_QUEUE_DEFAULT;
+    pubsub->policy = policy;
+    return pubsub;
+}
+
+/**
+ * @fn void pubsub_destroy( pubsub_t *pubsub)
+ * @brief 남은 topic 을 해제하는 함수 (연결의 구독 상태는 연결을 닫을 때 pubsub_sub_destroy 로 먼저 해제한다)
+ * @return void
+ * @param pubsub 해제할 pubsub
+ */
+void pubsub_destroy( pubsub_t *pubsub){
+    pubsub_topic_t *topic;
+    int i;
+
+    if( pubsub == NULL){
+        return;
+    }
+    // 닫힌 연결의 구독 상태는 ready 목록에서 꺼내면서 해제된다
+    while( pubsub_ready_pop( pubsub) != NULL){
+    }
+    for( i = 0; i < PUBSUB_BUCKET_NUM; i++){
+        while( ( topic = pubsub->buckets[ i]) != NULL){
+            pubsub->buckets[ i] = topic->hash_next;
+            free( topic->subs);
+            free( topic);
+        }
+    }
+    free( pubsub);
+}
+
+/**
+ * @fn pubsub_sub_t* pubsub_sub_init( pubsub_t *pubsub, void *owner)
+ * @brief 연결의 구독 상태를 만드는 함수 (queue 는 첫 메시지를 넣을 때 할당한다)
+ * @return 구독 상태, 메모리가 없으면 NULL
+ * @param pubsub topic 목록
+ * @param owner 구독하는 연결
+ */
+pubsub_sub_t* pubsub_sub_init( pubsub_t *pubsub, void *owner){
+    pubsub_sub_t *sub = ( pubsub_sub_t*)calloc( 1, sizeof( pubsub_sub_t));
+
+    if( sub == NULL){
+        printf("    | ! Pubsub : Failed to allocate memory\n");
+        return NULL;
+    }
+    sub->owner = owner;
+    pubsub->sub_num++;
+    return sub;
+}
+
+/**
+ * @fn void pubsub_sub_destroy( pubsub_t *pubsub, pubsub_sub_t *sub)
+ * @brief 닫히는 연결의 구독을 모두 풀고 queue 의 참조를 놓는 함수
+ * ready 목록에 들어 있으면 owner 만 지우고 목록에서 꺼낼 때 해제한다
+ * @return void
+ * @param pubsub topic 목록
+ * @param sub 연결의 구독 상태
+ */
+void pubsub_sub_destroy( pubsub_t *pubsub, pubsub_sub_t *sub){
+    while( sub->topic_num > 0){
+        pubsub_sub_unlink( pubsub, sub, sub->topic_num - 1);
+    }
+    pubsub->queued -= sub->num;
+    while( sub->num > 0){
+        pubsub_msg_put( sub->queue[ sub->head]);
+        sub->head = ( sub->head + 1) % sub->cap;
+        sub->num--;
+    }
+    free( sub->queue);
+    sub->queue = NULL;
+    sub->cap = 0;
+    sub->owner = NULL;
+    pubsub->sub_num--;
+    if( sub->is_ready == 0){
+        free( sub);
+    }
+}
+
+/**
+ * @fn int pubsub_subscribe( pubsub_t *pubsub, pubsub_sub_t *sub, uint32_t app_id, const char *prefix, int prefix_len)
+ * @brief 연결을 topic 의 구독자로 등록하는 함수 (topic 이 없으면 만든다, 이미 구독했으면 아무것도 하지 않는다)
+ * @return 정상이면 NORMAL, prefix 가 길거나 구독이 너무 많으면 BUF_ERR, 메모리가 없으면 OBJECT_ERR
+ * @param pubsub topic 목록
+ * @param sub 연결의 구독 상태
+ * @param app_id topic app_id
+ * @param prefix 발행 메시지 바디가 시작해야 하는 바이트
+ * @param prefix_len prefix 길이 (0 이면 app_id 만 본다)
+ */
+int pubsub_subscribe( pubsub_t *pubsub, pubsub_sub_t *sub, uint32_t app_id, const char *prefix, int prefix_len){
+    uint64_t hash = pubsub_hash( app_id, prefix, prefix_len);
+    pubsub_topic_t *topic;
+    pubsub_sub_t **subs;
+    int i, cap;
+
+    if( ( prefix_len < 0) || ( prefix_len > PUBSUB_PREFIX_MAX)){
+        return BUF_ERR;
+    }
+    if( ( topic = pubsub_topic_find( pubsub, hash, app_id, prefix, prefix_len)) != NULL){
+        for( i = 0; i < sub->topic_num; i++){
+            if( sub->topics[ i] == topic){
+                return NORMAL;
+            }
+        }
+    }
+    if( sub->topic_num == PUBSUB_CONN_TOPIC_MAX){
+        return BUF_ERR;
+    }
+
+    if( topic == NULL){
+        if( ( topic = ( pubsub_topic_t*)calloc( 1, sizeof( pubsub_topic_t))) == NULL){
+            return OBJECT_ERR;
+        }
+        topic->hash = hash;
+        topic->app_id = app_id;
+        topic->prefix_len = prefix_len;
+        memcpy( topic->prefix, prefix, prefix_len);
+        topic->hash_next = pubsub->buckets[ hash & ( PUBSUB_BUCKET_NUM - 1)];
+        pubsub->buckets[ hash & ( PUBSUB_BUCKET_NUM - 1)] = topic;
+        pubsub->prefix_cnt[ prefix_len]++;
+        pubsub->prefix_lens |= 1ULL << prefix_len;
+        pubsub->topic_num++;
+    }
+    if( topic->sub_num == topic->sub_cap){
+        cap = ( topic->sub_cap == 0) ? 4 : topic->sub_cap * 2;
+        if( ( subs = ( pubsub_sub_t**)realloc( topic->subs, sizeof( pubsub_sub_t*) * cap)) == NULL){
+            if( topic->sub_num == 0){
+                pubsub_topic_free( pubsub, topic);
+            }
+            return OBJECT_ERR;
+        }
+        topic->subs = subs;
+        topic->sub_cap = cap;
+    }
+    sub->topics[ sub->topic_num] = topic;
+    sub->topic_idx[ sub->topic_num] = topic->sub_num;
+    sub->topic_num++;
+    topic->subs[ topic->sub_num++] = sub;
+    return NORMAL;
+}
+
+/**
+ * @fn int pubsub_unsubscribe( pubsub_t *pubsub, pubsub_sub_t *sub, uint32_t app_id, const char *prefix, int prefix_len)
+ * @brief 연결을 topic 의 구독자에서 빼는 함수 (이미 queue 에 들어간 메시지는 그대로 보낸다)
+ * @return 정상이면 NORMAL, 구독하지 않은 topic 이면 NOT_EXIST
+ * @param pubsub topic 목록
+ * @param sub 연결의 구독 상태
+ * @param app_id topic app_id
+ * @param prefix topic prefix
+ * @param prefix_len prefix 길이
+ */
+int pubsub_unsubscribe( pubsub_t *pubsub, pubsub_sub_t *sub, uint32_t app_id, const char *prefix, int prefix_len){
+    int i;
+
+    for( i = 0; i < sub->topic_num; i++){
+        if( ( sub->topics[ i]->app_id == app_id) && ( sub->topics[ i]->prefix_len == prefix_len)
+                && ( memcmp( sub->topics[ i]->prefix, prefix, prefix_len) == 0)){
+            pubsub_sub_unlink( pubsub, sub, i);
+            return NORMAL;
+        }
+    }
+    return NOT_EXIST;
+}
+
+/**
+ * @fn int pubsub_publish( pubsub_t *pubsub, const char *hdr, int hdr_len, const char *body, int body_len)
+ * @brief 메시지를 한 번 복사하고 app_id 가 같고 바디가 prefix 로 시작하는 topic 의 모든 구독자 queue 에 참조를 넣는 함수
+ * 구독이 있는 prefix 길이만 hash 로 찾으므로 topic 수와 상관 없이 길이 종류만큼만 찾는다
+ * @return 메시지를 넣은 구독자 수, 메모리가 없으면 OBJECT_ERR
+ * @param pubsub topic 목록
+ * @param hdr 메시지 헤더 (app_id 가 topic 이다)
+ * @param hdr_len 헤더 길이
+ * @param body 메시지 바디
+ * @param body_len 바디 길이
+ */
+int pubsub_publish( pubsub_t *pubsub, const char *hdr, int hdr_len, const char *body, int body_len){
+    uint32_t app_id = ( ( const kmp_hdr_t*)hdr)->app_id;
+    uint64_t deliveries = pubsub->deliveries;
+    uint64_t lens = pubsub->prefix_lens;
+    pubsub_topic_t *topic;
+    pubsub_msg_t *msg;
+    int len, i;
+
+    pubsub->publishes++;
+    if( lens == 0){
+        return 0;
+    }
+    if( ( msg = ( pubsub_msg_t*)malloc( sizeof( pubsub_msg_t) + hdr_len + body_len)) == NULL){
+        return OBJECT_ERR;
+    }
+    msg->refcnt = 1;
+    msg->len = hdr_len + body_len;
+    memcpy( msg->data, hdr, hdr_len);
+    memcpy( &msg->data[ hdr_len], body, body_len);
+    pubsub->pub_seq++;
+
+    while( lens != 0){
+        len = __builtin_ctzll( lens);
+        lens &= lens - 1;
+        if( len > body_len){
+            break;
+        }
+        if( ( topic = pubsub_topic_find( pubsub, pubsub_hash( app_id, body, len), app_id, body, len)) == NULL){
+            continue;
+        }
+        for( i = 0; i < topic->sub_num; i++){
+            pubsub_sub_enqueue( pubsub, topic->subs[ i], msg);
+        }
+    }
+    pubsub_msg_put( msg);
+    return ( int)( pubsub->deliveries - deliveries);
+}
+
+/**
+ * @fn void pubsub_ready_push( pubsub_t *pubsub, pubsub_sub_t *sub)
+ * @brief 보낼 메시지가 있는 연결을 ready 목록 맨 뒤에 넣는 함수 (이미 있으면 그대로 둔다)
+ * @return void
+ * @param pubsub topic 목록
+ * @param sub 연결의 구독 상태
+ */
+void pubsub_ready_push( pubsub_t *pubsub, pubsub_sub_t *sub){
+    if( sub->is_ready){
+        return;
+    }
+    sub->is_ready = 1;
+    sub->ready_next = NULL;
+    if( pubsub->ready_tail == NULL){
+        pubsub->ready_head = sub;
+    }
+    else{
+        pubsub->ready_tail->ready_next = sub;
+    }
+    pubsub->ready_tail = sub;
+}
+
+/**
+ * @fn pubsub_sub_t* pubsub_ready_pop( pubsub_t *pubsub)
+ * @brief ready 목록의 맨 앞 연결을 꺼내는 함수 (그 사이 닫힌 연결은 해제하고 건너뛴다)
+ * @return 보낼 메시지가 있는 연결의 구독 상태, 목록이 비었으면 NULL
+ * @param pubsub topic 목록
+ */
+pubsub_sub_t* pubsub_ready_pop( pubsub_t *pubsub){
+    pubsub_sub_t *sub;
+
+    while( ( sub = pubsub->ready_head) != NULL){
+        if( ( pubsub->ready_head = sub->ready_next) == NULL){
+            pubsub->ready_tail = NULL;
+        }
+        sub->is_ready = 0;
+        if( sub->owner != NULL){
+            return sub;
+        }
+        free( sub);
+    }
+    return NULL;
+}
+
+/**
+ * @fn int pubsub_sub_write( pubsub_t *pubsub, pubsub_sub_t *sub, int fd)
+ * @brief 연결 queue 의 메시지를 writev 로 최대 PUBSUB_IOV_MAX 개씩 보내는 함수 (소켓이 가득 차거나 queue 가 빌 때까지)
+ * 다 보낸 메시지의 참조를 놓고, 보내다 만 메시지는 off 부터 이어서 보낸다
+ * @return queue 에 남은 메시지 수 (0 이면 다 보냈다), 소켓이 실패하면 NEGATIVE_BYTE
+ * @param pubsub topic 목록
+ * @param sub 연결의 구독 상태
+ * @param fd 연결 file descriptor
+ */
+int pubsub_sub_write( pubsub_t *pubsub, pubsub_sub_t *sub, int fd){
+    struct iovec iov[ PUBSUB_IOV_MAX];
+    pubsub_msg_t *msg;
+    ssize_t write_bytes, want;
+    int i, num;
+
+    while( sub->num > 0){
+        num = ( sub->num < PUBSUB_IOV_MAX) ? sub->num : PUBSUB_IOV_MAX;
+        want = 0;
+        for( i = 0; i < num; i++){
+            msg = sub->queue[ ( sub->head + i) % sub->cap];
+            iov[ i].iov_base = ( i == 0) ? &msg->data[ sub->off] : msg->data;
+            iov[ i].iov_len = ( i == 0) ? msg->len - sub->off : msg->len;
+            want += iov[ i].iov_len;
+        }
+        if( ( write_bytes = writev( fd, iov, num)) < 0){
+            if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                return sub->num;
+            }
+            return NEGATIVE_BYTE;
+        }
+        pubsub->writes++;
+        // 덜 보냈으면 소켓 송신 버퍼가 가득 찬 것이다
+        want -= write_bytes;
+
+        write_bytes += sub->off;
+        while( ( sub->num > 0) && ( write_bytes >= sub->queue[ sub->head]->len)){
+            write_bytes -= sub->queue[ sub->head]->len;
+            pubsub_msg_put( sub->queue[ sub->head]);
+            sub->head = ( sub->head + 1) % sub->cap;
+            sub->num--;
+            pubsub->queued--;
+            pubsub->sent++;
+        }
+        sub->off = ( int)write_bytes;
+        if( want > 0){
+            return sub->num;
+        }
+    }
+    return 0;
+}
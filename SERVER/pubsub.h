@@ -0,0 +1,136 @@
+#pragma once
+#ifndef __PUBSUB_H__
+#define __PUBSUB_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+
+/// topic 으로 쓰는 바디 앞부분의 최대 길이
+#define PUBSUB_PREFIX_MAX 32
+/// topic hash bucket 수 (2의 거듭제곱)
+#define PUBSUB_BUCKET_NUM 4096
+/// 연결 하나가 구독할 수 있는 최대 topic 수
+#define PUBSUB_CONN_TOPIC_MAX 16
+/// 연결마다 보내지 못하고 쌓아 두는 기본 최대 메시지 수 (-Q)
+#define PUBSUB_QUEUE_DEFAULT 1024
+/// 연결 queue 의 처음 크기 (넘치면 최대 크기까지 두 배씩 늘린다)
+#define PUBSUB_QUEUE_INIT 8
+/// writev 한 번에 보내는 최대 메시지 수
+#define PUBSUB_IOV_MAX 64
+
+/// queue 가 가득 찬 느린 구독자를 다루는 방법
+enum PUBSUB_POLICY{
+    /// 새 메시지를 그 구독자에게만 보내지 않는다 (다른 구독자와 연결은 그대로)
+    PUBSUB_POLICY_DROP = 0,
+    /// 그 구독자의 연결을 닫는다 (받은 메시지에 빠진 것이 없다는 것을 보장한다)
+    PUBSUB_POLICY_CLOSE
+};
+
+typedef struct pubsub_topic_s pubsub_topic_t;
+
+/// @struct pubsub_msg_t
+/// @brief 발행된 메시지 (헤더 + 바디). 구독자 queue 마다 참조만 늘리고, 참조 수가 0이 되면 해제된다
+typedef struct pubsub_msg_s pubsub_msg_t;
+struct pubsub_msg_s{
+    /// 참조 수 (발행하는 동안 + 이 메시지를 아직 다 보내지 않은 구독자 수)
+    int refcnt;
+    /// 메시지 길이
+    int len;
+    /// 메시지
+    char data[];
+};
+
+/// @struct pubsub_sub_t
+/// @brief 연결 하나의 구독 목록과 보낼 메시지 queue (첫 구독 요청을 받을 때 만든다)
+typedef struct pubsub_sub_s pubsub_sub_t;
+struct pubsub_sub_s{
+    /// 구독한 연결 (닫혔으면 NULL, ready 목록에서 꺼낼 때 해제한다)
+    void *owner;
+    /// 구독한 topic 과 그 topic 의 구독자 목록 안에서의 위치
+    pubsub_topic_t *topics[ PUBSUB_CONN_TOPIC_MAX];
+    int topic_idx[ PUBSUB_CONN_TOPIC_MAX];
+    int topic_num;
+    /// 보낼 메시지 ring (head 부터 num 개)
+    pubsub_msg_t **queue;
+    int head;
+    int num;
+    int cap;
+    /// queue[ head] 에서 이미 보낸 바이트 수 (0 이 아니면 메시지 중간이라 응답을 끼워 넣을 수 없다)
+    int off;
+    /// 마지막으로 받은 발행 번호 (겹치는 topic 을 여러 개 구독해도 한 번만 받는다)
+    uint64_t pub_seq;
+    /// ready 목록에 들어 있는지 여부 / 다음 항목
+    int is_ready;
+    pubsub_sub_t *ready_next;
+    /// PUBSUB_POLICY_CLOSE 에서 queue 가 넘쳐서 닫아야 하는 연결인지 여부
+    int is_slow;
+};
+
+/// @struct pubsub_topic_t
+/// @brief (app_id, 바디 앞부분) 으로 정해지는 topic 하나와 구독자 목록 (구독자가 없어지면 해제한다)
+struct pubsub_topic_s{
+    /// 같은 bucket 의 다음 topic
+    pubsub_topic_t *hash_next;
+    uint64_t hash;
+    uint32_t app_id;
+    /// 발행 메시지 바디가 이 바이트로 시작해야 받는다 (길이 0 이면 app_id 만 본다)
+    int prefix_len;
+    char prefix[ PUBSUB_PREFIX_MAX];
+    /// 구독자 목록
+    pubsub_sub_t **subs;
+    int sub_num;
+    int sub_cap;
+};
+
+/// @struct pubsub_t
+/// @brief event loop 하나의 topic 목록. 발행 메시지는 한 번만 복사해서 모든 구독자 queue 에 참조로 넣고,
+/// 메시지가 쌓인 구독자는 ready 목록에 모아 event loop 가 한 번 돌 때마다 writev 로 보낸다
+typedef struct pubsub_s pubsub_t;
+struct pubsub_s{
+    /// topic hash bucket
+    pubsub_topic_t *buckets[ PUBSUB_BUCKET_NUM];
+    /// bit L : prefix 길이가 L 인 topic 이 있다 / 길이별 topic 수
+    uint64_t prefix_lens;
+    int prefix_cnt[ PUBSUB_PREFIX_MAX + 1];
+    /// 연결 queue 최대 크기 / 가득 찼을 때의 처리 (PUBSUB_POLICY)
+    int queue_len;
+    int policy;
+    /// 보낼 메시지가 있는 연결 목록 (먼저 들어온 순서)
+    pubsub_sub_t *ready_head;
+    pubsub_sub_t *ready_tail;
+    /// 마지막 발행 번호
+    uint64_t pub_seq;
+
+    /// 통계 : topic 수, 구독 상태가 있는 연결 수, 발행 수, queue 에 넣은 수, 다 보낸 수, 넘쳐서 버린 수,
+    /// 넘쳐서 닫은 연결 수, writev 횟수, 지금 queue 에 있는 메시지 수
+    int topic_num;
+    int sub_num;
+    uint64_t publishes;
+    uint64_t deliveries;
+    uint64_t sent;
+    uint64_t drops;
+    uint64_t slow_closes;
+    uint64_t writes;
+    uint64_t queued;
+};
+
+pubsub_t* pubsub_init( int queue_len, int policy);
+void pubsub_destroy( pubsub_t *pubsub);
+pubsub_sub_t* pubsub_sub_init( pubsub_t *pubsub, void *owner);
+void pubsub_sub_destroy( pubsub_t *pubsub, pubsub_sub_t *sub);
+int pubsub_subscribe( pubsub_t *pubsub, pubsub_sub_t *sub, uint32_t app_id, const char *prefix, int prefix_len);
+int pubsub_unsubscribe( pubsub_t *pubsub, pubsub_sub_t *sub, uint32_t app_id, const char *prefix, int prefix_len);
+int pubsub_publish( pubsub_t *pubsub, const char *hdr, int hdr_len, const char *body, int body_len);
+void pubsub_ready_push( pubsub_t *pubsub, pubsub_sub_t *sub);
+pubsub_sub_t* pubsub_ready_pop( pubsub_t *pubsub);
+int pubsub_sub_write( pubsub_t *pubsub, pubsub_sub_t *sub, int fd);
+
+#endif
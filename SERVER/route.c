@@ -0,0 +1,633 @@
+#include "route.h"
+
+/**
+ * @fn uint64_t route_now_ms()
+ * @brief monotonic clock 기준 현재 시각을 ms 단위로 구하는 함수
+ * @return 현재 시각 (ms)
+ */
+uint64_t route_now_ms(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @fn static uint32_t route_mix32( uint32_t h)
+ * @brief hash 값을 고르게 퍼뜨리기 위한 함수 (murmur3 finalizer)
+ * @return 섞인 hash 값
+ * @param h 입력 값
+ */
+static uint32_t route_mix32( uint32_t h){
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @fn static uint32_t route_hash_str( const char *str)
+ * @brief 가상 노드 이름의 hash 값을 구하는 함수 (FNV-1a + finalizer)
+ * @return hash 값
+ * @param str 가상 노드 이름
+ */
+static uint32_t route_hash_str( const char *str){
+    uint32_t h = 2166136261u;
+
+    while( *str != '\0'){
+        h ^= ( uint8_t)*str++;
+        h *= 16777619u;
+    }
+    return route_mix32( h);
+}
+
+/**
+ * @fn static int route_cmp_point( const void *a, const void *b)
+ * @brief qsort 용 가상 노드 비교 함수
+ * @return hash 값 비교 결과
+ */
+static int route_cmp_point( const void *a, const void *b){
+    const route_point_t *x = ( const route_point_t*)a;
+    const route_point_t *y = ( const route_point_t*)b;
+
+    if( x->hash != y->hash){
+        return ( x->hash > y->hash) ? 1 : -1;
+    }
+    return x->backend - y->backend;
+}
+
+/**
+ * @fn static void route_build_ring( route_t *route)
+ * @brief 제거되지 않은 backend 들의 가상 노드로 hash ring을 다시 만드는 함수
+ * 가상 노드 위치는 backend 주소로만 정해지므로 backend가 추가 / 제거되어도 나머지 노드는 움직이지 않는다
+ * @return void
+ * @param route routing 객체
+ */
+static void route_build_ring( route_t *route){
+    route_backend_t *backend;
+    char name[ 64];
+    int i, v;
+
+    route->point_num = 0;
+    for( i = 0; i < route->backend_num; i++){
+        backend = &route->backends[ i];
+        if( backend->is_removed){
+            continue;
+        }
+        for( v = 0; v < ROUTE_VNODES; v++){
+            snprintf( name, sizeof( name), "%s:%d#%d", inet_ntoa( backend->addr.sin_addr), ntohs( backend->addr.sin_port), v);
+            route->points[ route->point_num].hash = route_hash_str( name);
+            route->points[ route->point_num].backend = i;
+            route->point_num++;
+        }
+    }
+    qsort( route->points, route->point_num, sizeof( route_point_t), route_cmp_point);
+}
+
+/**
+ * @fn static int route_backend_is_up( route_backend_t *backend, uint64_t now)
+ * @brief backend에 요청을 보내도 되는지 확인하는 함수
+ * down 시간이 지나면 다시 요청을 보내 보고, 성공하면 정상으로 돌아온다 (half-open)
+ * @return 보내도 되면 1, 아니면 0
+ */
+static int route_backend_is_up( route_backend_t *backend, uint64_t now){
+    return ( backend->is_removed == 0) && ( ( backend->down_until == 0) || ( now >= backend->down_until));
+}
+
+/**
+ * @fn static void route_backend_fail( route_backend_t *backend)
+ * @brief backend의 실패를 기록하고, 연속 실패가 많으면 down 처리하는 함수 (passive health check)
+ * @return void
+ */
+static void route_backend_fail( route_backend_t *backend){
+    backend->fail_count++;
+    if( backend->fail_count >= ROUTE_FAIL_MAX){
+        if( ( backend->down_until == 0) || ( route_now_ms() >= backend->down_until)){
+            printf("    | ! Route : backend %s:%d is down (fail:%d)\n", inet_ntoa( backend->addr.sin_addr), ntohs( backend->addr.sin_port), backend->fail_count);
+        }
+        backend->down_until = route_now_ms() + ROUTE_DOWN_MS;
+    }
+}
+
+/**
+ * @fn static void route_backend_ok( route_backend_t *backend)
+ * @brief backend 응답 성공을 기록하는 함수
+ * @return void
+ */
+static void route_backend_ok( route_backend_t *backend){
+    if( backend->down_until != 0){
+        printf("    | @ Route : backend %s:%d is up\n", inet_ntoa( backend->addr.sin_addr), ntohs( backend->addr.sin_port));
+    }
+    backend->fail_count = 0;
+    backend->down_until = 0;
+}
+
+/**
+ * @fn static void route_pending_reply( route_t *route, route_pending_t *pending, const char *frame, int len)
+ * @brief 대기 중인 요청을 끝내고 owner 에게 응답을 전달하는 함수
+ * frame이 NULL 이면 원래 헤더로 KMP_CODE_UNAVAILABLE 응답을 만들어 전달한다
+ * @return void
+ */
+static void route_pending_reply( route_t *route, route_pending_t *pending, const char *frame, int len){
+    char fail_frame[ ROUTE_HDR_LEN];
+    void *owner = pending->owner;
+
+    if( frame == NULL){
+        kmp_hdr_t *hdr = ( kmp_hdr_t*)fail_frame;
+        memcpy( fail_frame, pending->hdr, ROUTE_HDR_LEN);
+        hdr->hop_id = pending->orig_hop_id;
+        hdr->code = KMP_CODE_UNAVAILABLE;
+        hdr->length = ROUTE_HDR_LEN;
+        frame = fail_frame;
+        len = ROUTE_HDR_LEN;
+    }
+
+    pending->hop_id = 0;
+    pending->owner = NULL;
+    pending->conn = NULL;
+    route->pending_num--;
+
+    if( owner != NULL){
+        route->on_reply( route->arg, owner, frame, len);
+    }
+}
+
+/**
+ * @fn static void route_conn_set_events( route_t *route, route_conn_t *conn)
+ * @brief 연결 상태에 맞게 epoll 관찰 이벤트를 갱신하는 함수
+ * @return void
+ */
+static void route_conn_set_events( route_t *route, route_conn_t *conn){
+    struct epoll_event conn_event;
+    uint32_t events = EPOLLIN;
+
+    if( ( conn->is_connected == 0) || ( conn->out_off < conn->out_len)){
+        events |= EPOLLOUT;
+    }
+    if( events == conn->events){
+        return;
+    }
+
+    conn_event.events = events;
+    conn_event.data.ptr = conn;
+    epoll_ctl( route->epoll_fd, EPOLL_CTL_MOD, conn->fd, &conn_event);
+    conn->events = events;
+}
+
+/**
+ * @fn static void route_conn_close( route_t *route, route_conn_t *conn)
+ * @brief upstream 연결을 닫고, 이 연결로 보낸 요청은 모두 실패 처리하는 함수
+ * @return void
+ */
+static void route_conn_close( route_t *route, route_conn_t *conn){
+    int i;
+
+    if( conn->fd < 0){
+        return;
+    }
+
+    epoll_ctl( route->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close( conn->fd);
+    conn->fd = -1;
+    conn->is_connected = 0;
+    conn->events = 0;
+    conn->out_len = 0;
+    conn->out_off = 0;
+    conn->in_len = 0;
+    route_backend_fail( conn->backend);
+
+    if( route->pending_num > 0){
+        for( i = 0; i < ROUTE_PENDING_MAX; i++){
+            if( ( route->pending[ i].hop_id != 0) && ( route->pending[ i].conn == conn)){
+                route_pending_reply( route, &route->pending[ i], NULL, 0);
+            }
+        }
+    }
+}
+
+/**
+ * @fn static int route_conn_open( route_t *route, route_conn_t *conn)
+ * @brief backend로 non-blocking 연결을 시작하고 epoll에 등록하는 함수
+ * @return 정상이면 NORMAL, 실패하면 SOC_ERR
+ */
+static int route_conn_open( route_t *route, route_conn_t *conn){
+    struct epoll_event conn_event;
+    int nodelay = 1;
+
+    if( ( conn->fd = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP)) < 0){
+        printf("    | ! Route : Failed to open upstream socket\n");
+        return SOC_ERR;
+    }
+    setsockopt( conn->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof( nodelay));
+
+    conn->is_connected = 0;
+    if( connect( conn->fd, ( struct sockaddr*)&conn->backend->addr, sizeof( struct sockaddr_in)) == 0){
+        conn->is_connected = 1;
+    }
+    else if( errno != EINPROGRESS){
+        close( conn->fd);
+        conn->fd = -1;
+        route_backend_fail( conn->backend);
+        return SOC_ERR;
+    }
+
+    conn->events = EPOLLIN | EPOLLOUT;
+    conn_event.events = conn->events;
+    conn_event.data.ptr = conn;
+    if( epoll_ctl( route->epoll_fd, EPOLL_CTL_ADD, conn->fd, &conn_event) < 0){
+        printf("    | ! Route : Failed to add epoll upstream event\n");
+        close( conn->fd);
+        conn->fd = -1;
+        return SOC_ERR;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int route_conn_flush( route_conn_t *conn)
+ * @brief 쌓여 있는 요청을 upstream 소켓이 받을 수 있는 만큼 보내는 함수
+ * @return 정상이면 NORMAL, 실패하면 NEGATIVE_BYTE
+ */
+static int route_conn_flush( route_conn_t *conn){
+    ssize_t rv;
+
+    while( conn->out_off < conn->out_len){
+        rv = write( conn->fd, &conn->out_buf[ conn->out_off], conn->out_len - conn->out_off);
+        if( rv < 0){
+            if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                return NORMAL;
+            }
+            else if( errno == EINTR){
+                continue;
+            }
+            return NEGATIVE_BYTE;
+        }
+        conn->out_off += rv;
+    }
+    conn->out_off = 0;
+    conn->out_len = 0;
+    return NORMAL;
+}
+
+/**
+ * @fn static int route_conn_append( route_conn_t *conn, const char *frame, int len, uint32_t hop_id)
+ * @brief 보낼 요청을 연결의 송신 queue 뒤에 붙이는 함수 (hop_id 는 routing 용으로 바꾼다)
+ * @return 정상이면 NORMAL, 메모리가 부족하면 OBJECT_ERR
+ */
+static int route_conn_append( route_conn_t *conn, const char *frame, int len, uint32_t hop_id){
+    char *buf;
+    int cap;
+
+    if( conn->out_len + len > conn->out_cap){
+        cap = ( conn->out_cap == 0) ? 4096 : conn->out_cap;
+        while( cap < conn->out_len + len){
+            cap *= 2;
+        }
+        if( ( buf = ( char*)realloc( conn->out_buf, cap)) == NULL){
+            return OBJECT_ERR;
+        }
+        conn->out_buf = buf;
+        conn->out_cap = cap;
+    }
+
+    memcpy( &conn->out_buf[ conn->out_len], frame, len);
+    ( ( kmp_hdr_t*)&conn->out_buf[ conn->out_len])->hop_id = hop_id;
+    conn->out_len += len;
+    return NORMAL;
+}
+
+/**
+ * @fn static int route_conn_recv( route_t *route, route_conn_t *conn)
+ * @brief upstream 응답을 읽어서 hop_id 로 대기 중인 요청을 찾아 전달하는 함수
+ * @return 정상이면 NORMAL, 연결이 끊기거나 잘못된 메시지면 NORMAL 미만
+ */
+static int route_conn_recv( route_t *route, route_conn_t *conn){
+    route_pending_t *pending;
+    kmp_hdr_t *hdr;
+    ssize_t rv;
+    int offset;
+    uint32_t len;
+
+    while( 1){
+        rv = read( conn->fd, &conn->in_buf[ conn->in_len], ROUTE_IN_BUF_LEN - conn->in_len);
+        if( rv < 0){
+            if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+                return NORMAL;
+            }
+            else if( errno == EINTR){
+                continue;
+            }
+            return NEGATIVE_BYTE;
+        }
+        else if( rv == 0){
+            return ZERO_BYTE;
+        }
+        conn->in_len += rv;
+
+        // 완성된 응답을 모두 전달한다
+        offset = 0;
+        while( conn->in_len - offset >= ROUTE_HDR_LEN){
+            hdr = ( kmp_hdr_t*)&conn->in_buf[ offset];
+            len = hdr->length;
+            if( ( len < ROUTE_HDR_LEN) || ( len > ROUTE_IN_BUF_LEN)){
+                printf("    | ! Route : wrong msg length from upstream (len:%u) (fd:%d)\n", len, conn->fd);
+                return BUF_ERR;
+            }
+            if( ( uint32_t)( conn->in_len - offset) < len){
+                break;
+            }
+
+            // 이 연결로 보낸 요청의 응답만 받는다 (다른 backend 의 요청을 끝내지 못하게 한다)
+            pending = &route->pending[ hdr->hop_id & ( ROUTE_PENDING_MAX - 1)];
+            if( ( hdr->hop_id != 0) && ( pending->hop_id == hdr->hop_id) && ( pending->conn == conn)){
+                hdr->hop_id = pending->orig_hop_id;
+                route_backend_ok( conn->backend);
+                route_pending_reply( route, pending, &conn->in_buf[ offset], len);
+            }
+            offset += len;
+        }
+
+        if( offset > 0){
+            memmove( conn->in_buf, &conn->in_buf[ offset], conn->in_len - offset);
+            conn->in_len -= offset;
+        }
+    }
+}
+
+// ----------------------------------------------------------
+
+/**
+ * @fn route_t* route_init( int epoll_fd, route_reply_fn on_reply, void *arg)
+ * @brief routing 객체를 생성하는 함수
+ * @return 생성된 routing 객체, 실패하면 NULL
+ * @param epoll_fd upstream 연결을 등록할 server의 epoll 인스턴스
+ * @param on_reply upstream 응답을 client에게 전달할 callback
+ * @param arg callback 인자
+ */
+route_t* route_init( int epoll_fd, route_reply_fn on_reply, void *arg){
+    route_t *route = ( route_t*)calloc( 1, sizeof( route_t));
+
+    if( route == NULL){
+        printf("    | ! Route : Failed to allocate memory\n");
+        return NULL;
+    }
+    route->epoll_fd = epoll_fd;
+    route->on_reply = on_reply;
+    route->arg = arg;
+    route->next_hop_id = 1;
+    return route;
+}
+
+/**
+ * @fn void route_destroy( route_t *route)
+ * @brief upstream 연결을 모두 닫고 routing 객체를 해제하는 함수
+ * @return void
+ */
+void route_destroy( route_t *route){
+    int i, j;
+
+    if( route == NULL){
+        return;
+    }
+    for( i = 0; i < route->backend_num; i++){
+        for( j = 0; j < ROUTE_POOL_SIZE; j++){
+            route_conn_close( route, &route->backends[ i].conns[ j]);
+            free( route->backends[ i].conns[ j].out_buf);
+        }
+    }
+    free( route);
+}
+
+/**
+ * @fn int route_add_backend( route_t *route, struct sockaddr_in *addr)
+ * @brief backend를 추가하고 hash ring을 다시 만드는 함수
+ * @return 추가된 backend index, 더 추가할 수 없으면 BUF_ERR
+ * @param route routing 객체
+ * @param addr backend 주소
+ */
+int route_add_backend( route_t *route, struct sockaddr_in *addr){
+    route_backend_t *backend;
+    int i;
+
+    if( route->backend_num >= ROUTE_BACKEND_MAX){
+        return BUF_ERR;
+    }
+
+    backend = &route->backends[ route->backend_num];
+    memset( backend, 0, sizeof( route_backend_t));
+    backend->addr = *addr;
+    for( i = 0; i < ROUTE_POOL_SIZE; i++){
+        backend->conns[ i].ev_type = ROUTE_EV_CONN;
+        backend->conns[ i].fd = -1;
+        backend->conns[ i].backend = backend;
+    }
+
+    route->backend_num++;
+    route_build_ring( route);
+    printf("    | @ Route : add backend %s:%d\n", inet_ntoa( addr->sin_addr), ntohs( addr->sin_port));
+    return route->backend_num - 1;
+}
+
+/**
+ * @fn int route_remove_backend( route_t *route, int index)
+ * @brief backend를 hash ring에서 빼는 함수 (이 backend의 key만 다른 backend로 옮겨간다)
+ * @return 정상이면 NORMAL, 없는 backend면 NOT_EXIST
+ * @param route routing 객체
+ * @param index 제거할 backend index
+ */
+int route_remove_backend( route_t *route, int index){
+    int i;
+
+    if( ( index < 0) || ( index >= route->backend_num) || route->backends[ index].is_removed){
+        return NOT_EXIST;
+    }
+
+    route->backends[ index].is_removed = 1;
+    for( i = 0; i < ROUTE_POOL_SIZE; i++){
+        route_conn_close( route, &route->backends[ index].conns[ i]);
+    }
+    route_build_ring( route);
+    return NORMAL;
+}
+
+/**
+ * @fn int route_lookup( route_t *route, uint32_t app_id)
+ * @brief app_id 를 담당하는 backend를 hash ring에서 찾는 함수
+ * 담당 backend가 down 이면 ring의 다음 backend로 넘어간다
+ * @return backend index, 사용할 수 있는 backend가 없으면 NOT_EXIST
+ * @param route routing 객체
+ * @param app_id 메시지 헤더의 app_id
+ */
+int route_lookup( route_t *route, uint32_t app_id){
+    uint32_t hash = route_mix32( app_id);
+    uint64_t now = route_now_ms();
+    int low = 0;
+    int high = route->point_num;
+    int mid, i, backend;
+
+    if( route->point_num == 0){
+        return NOT_EXIST;
+    }
+
+    // hash 이상인 첫 번째 가상 노드
+    while( low < high){
+        mid = ( low + high) / 2;
+        if( route->points[ mid].hash < hash){
+            low = mid + 1;
+        }
+        else{
+            high = mid;
+        }
+    }
+
+    for( i = 0; i < route->point_num; i++){
+        backend = route->points[ ( low + i) % route->point_num].backend;
+        if( route_backend_is_up( &route->backends[ backend], now)){
+            return backend;
+        }
+    }
+    return NOT_EXIST;
+}
+
+/**
+ * @fn int route_forward( route_t *route, const char *frame, int len, void *owner, uint32_t *hop_id)
+ * @brief client 요청을 app_id 담당 backend의 영구 연결로 보내는 함수
+ * 응답은 route_process() 에서 hop_id 로 찾아서 on_reply callback 으로 전달된다
+ * @return 정상이면 NORMAL, backend가 없으면 NOT_EXIST, 그 외 열거형 참고
+ * @param route routing 객체
+ * @param frame client 요청 메시지 (헤더 + 바디)
+ * @param len 메시지 길이
+ * @param owner 응답을 받을 객체
+ * @param hop_id 할당된 hop_id (route_cancel 에 사용)
+ */
+int route_forward( route_t *route, const char *frame, int len, void *owner, uint32_t *hop_id){
+    const kmp_hdr_t *hdr = ( const kmp_hdr_t*)frame;
+    route_pending_t *pending;
+    route_backend_t *backend;
+    route_conn_t *conn;
+    int index;
+
+    if( ( index = route_lookup( route, hdr->app_id)) < 0){
+        return NOT_EXIST;
+    }
+    backend = &route->backends[ index];
+    conn = &backend->conns[ backend->next_conn];
+    backend->next_conn = ( backend->next_conn + 1) % ROUTE_POOL_SIZE;
+
+    if( ( conn->fd < 0) && ( route_conn_open( route, conn) < NORMAL)){
+        return SOC_ERR;
+    }
+
+    if( route->next_hop_id == 0){
+        route->next_hop_id = 1;
+    }
+    pending = &route->pending[ route->next_hop_id & ( ROUTE_PENDING_MAX - 1)];
+    if( pending->hop_id != 0){
+        printf("    | ! Route : too many pending requests\n");
+        return BUF_ERR;
+    }
+
+    if( route_conn_append( conn, frame, len, route->next_hop_id) < NORMAL){
+        return OBJECT_ERR;
+    }
+
+    pending->hop_id = route->next_hop_id++;
+    pending->orig_hop_id = hdr->hop_id;
+    pending->owner = owner;
+    pending->conn = conn;
+    pending->start_ms = route_now_ms();
+    memcpy( pending->hdr, frame, ROUTE_HDR_LEN);
+    route->pending_num++;
+    backend->requests++;
+    *hop_id = pending->hop_id;
+
+    // 송신 에러는 여기서 닫지 않고 남은 데이터로 EPOLLOUT 을 걸어 route_process() 에서 처리한다
+    // (여기서 실패 응답을 보내면 호출한 쪽의 연결이 callback 안에서 닫힐 수 있다)
+    if( conn->is_connected){
+        route_conn_flush( conn);
+        route_conn_set_events( route, conn);
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn void route_cancel( route_t *route, uint32_t hop_id)
+ * @brief client가 끊겼을 때 대기 중인 요청의 owner를 지워서 응답이 버려지게 하는 함수
+ * @return void
+ */
+void route_cancel( route_t *route, uint32_t hop_id){
+    route_pending_t *pending = &route->pending[ hop_id & ( ROUTE_PENDING_MAX - 1)];
+
+    if( ( hop_id != 0) && ( pending->hop_id == hop_id)){
+        pending->owner = NULL;
+    }
+}
+
+/**
+ * @fn int route_process( route_t *route, route_conn_t *conn, uint32_t events)
+ * @brief upstream 연결의 epoll 이벤트(연결 완료, 송신 가능, 응답 수신)를 처리하는 함수
+ * 연결 에러는 내부에서 실패 응답과 backend 실패로 처리한다
+ * @return NORMAL
+ */
+int route_process( route_t *route, route_conn_t *conn, uint32_t events){
+    int error = 0;
+    socklen_t err_len = sizeof( error);
+
+    // 같은 epoll_wait 결과 안에서 먼저 닫힌 연결
+    if( conn->fd < 0){
+        return NORMAL;
+    }
+
+    if( conn->is_connected == 0){
+        if( ( getsockopt( conn->fd, SOL_SOCKET, SO_ERROR, &error, &err_len) < 0) || ( error != 0)){
+            printf("    | ! Route : Failed to connect backend %s:%d (errno:%d)\n",
+                    inet_ntoa( conn->backend->addr.sin_addr), ntohs( conn->backend->addr.sin_port), error);
+            route_conn_close( route, conn);
+            return NORMAL;
+        }
+        if( ( events & EPOLLOUT) == 0){
+            return NORMAL;
+        }
+        conn->is_connected = 1;
+    }
+
+    if( ( events & ( EPOLLOUT | EPOLLHUP | EPOLLERR)) && ( route_conn_flush( conn) < NORMAL)){
+        route_conn_close( route, conn);
+        return NORMAL;
+    }
+
+    if( ( events & ( EPOLLIN | EPOLLHUP | EPOLLERR)) && ( route_conn_recv( route, conn) < NORMAL)){
+        route_conn_close( route, conn);
+        return NORMAL;
+    }
+
+    route_conn_set_events( route, conn);
+    return NORMAL;
+}
+
+/**
+ * @fn void route_check_timeouts( route_t *route)
+ * @brief ROUTE_TIMEOUT_MS 동안 응답이 없는 요청을 실패 처리하는 함수
+ * @return void
+ */
+void route_check_timeouts( route_t *route){
+    uint64_t now;
+    int i;
+
+    if( route->pending_num == 0){
+        return;
+    }
+    now = route_now_ms();
+    if( now - route->last_tick_ms < ROUTE_TICK_MS){
+        return;
+    }
+    route->last_tick_ms = now;
+
+    for( i = 0; i < ROUTE_PENDING_MAX; i++){
+        if( ( route->pending[ i].hop_id != 0) && ( now - route->pending[ i].start_ms >= ROUTE_TIMEOUT_MS)){
+            route_backend_fail( route->pending[ i].conn->backend);
+            route_pending_reply( route, &route->pending[ i], NULL, 0);
+        }
+    }
+}
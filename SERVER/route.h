@@ -0,0 +1,164 @@
+#pragma once
+#ifndef __ROUTE_H__
+#define __ROUTE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+
+#define ROUTE_HDR_LEN 20
+/// 등록할 수 있는 최대 backend 수
+#define ROUTE_BACKEND_MAX 16
+/// backend 하나가 hash ring에 차지하는 가상 노드 수
+#define ROUTE_VNODES 160
+/// backend 하나에 유지하는 영구 연결 수
+#define ROUTE_POOL_SIZE 2
+/// 동시에 처리 중일 수 있는 요청 수 (2의 거듭제곱)
+#define ROUTE_PENDING_MAX 65536
+/// upstream 응답 수신 버퍼 크기
+#define ROUTE_IN_BUF_LEN ( 1 << 16)
+/// 연속 실패가 이 횟수에 도달하면 backend를 down 처리한다
+#define ROUTE_FAIL_MAX 3
+/// down 처리된 backend에 다시 요청을 보내 보기까지의 시간 (ms)
+#define ROUTE_DOWN_MS 5000
+/// upstream 응답을 기다리는 최대 시간 (ms)
+#define ROUTE_TIMEOUT_MS 3000
+/// 응답 대기 요청이 있을 때 timeout을 확인하는 주기 (ms)
+#define ROUTE_TICK_MS 100
+/// epoll data.ptr 로 등록된 upstream 연결을 구분하기 위한 종류 값 (route_conn_t 의 첫 번째 멤버)
+#define ROUTE_EV_CONN 5
+
+typedef struct route_backend_s route_backend_t;
+
+/// @struct route_conn_t
+/// @brief backend로 향하는 영구 연결 하나. 여러 client 요청이 hop_id로 구분되어 함께 사용한다
+typedef struct route_conn_s route_conn_t;
+struct route_conn_s{
+    /// epoll 이벤트 종류 (ROUTE_EV_CONN)
+    int ev_type;
+    /// upstream 소켓 (연결 전이면 -1)
+    int fd;
+    /// 연결 완료 여부
+    int is_connected;
+    /// epoll에 등록된 이벤트
+    uint32_t events;
+    /// 이 연결이 속한 backend
+    route_backend_t *backend;
+    /// 아직 보내지 못한 요청 데이터
+    char *out_buf;
+    /// out_buf 에 들어 있는 데이터 크기
+    int out_len;
+    /// out_buf 중 이미 보낸 크기
+    int out_off;
+    /// out_buf 할당 크기
+    int out_cap;
+    /// in_buf 에 들어 있는 데이터 크기
+    int in_len;
+    /// 수신 중인 응답 데이터 (여러 메시지가 이어져 있을 수 있다)
+    char in_buf[ ROUTE_IN_BUF_LEN];
+};
+
+/// @struct route_backend_t
+/// @brief upstream kmp server 하나
+struct route_backend_s{
+    /// backend 주소
+    struct sockaddr_in addr;
+    /// ring 에서 제외되었는지 여부
+    int is_removed;
+    /// 연속 실패 횟수 (passive health check)
+    int fail_count;
+    /// down 상태가 풀리는 시각 (ms, 0이면 정상)
+    uint64_t down_until;
+    /// 다음에 사용할 연결 index (round robin)
+    int next_conn;
+    /// 중계한 요청 수
+    uint64_t requests;
+    /// 영구 연결 pool
+    route_conn_t conns[ ROUTE_POOL_SIZE];
+};
+
+/// @struct route_point_t
+/// @brief hash ring 위의 가상 노드
+typedef struct route_point_s route_point_t;
+struct route_point_s{
+    /// ring 위치
+    uint32_t hash;
+    /// backend index
+    int backend;
+};
+
+/// @struct route_pending_t
+/// @brief upstream 응답을 기다리는 요청
+typedef struct route_pending_s route_pending_t;
+struct route_pending_s{
+    /// upstream으로 보낸 hop_id (0이면 빈 슬롯)
+    uint32_t hop_id;
+    /// 요청을 보낸 client의 원래 hop_id
+    uint32_t orig_hop_id;
+    /// 응답을 받을 객체 (server의 transc_t, 취소되면 NULL)
+    void *owner;
+    /// 요청을 보낸 연결
+    route_conn_t *conn;
+    /// 요청을 보낸 시각 (ms)
+    uint64_t start_ms;
+    /// 실패 응답을 만들기 위한 원래 헤더
+    char hdr[ ROUTE_HDR_LEN];
+};
+
+/// @brief upstream 응답(또는 실패 응답)을 owner에게 전달하는 callback
+typedef void ( *route_reply_fn)( void *arg, void *owner, const char *frame, int len);
+
+/// @struct route_t
+/// @brief app_id 를 consistent hashing 으로 backend에 분배하는 routing 계층
+typedef struct route_s route_t;
+struct route_s{
+    /// server의 epoll 인스턴스
+    int epoll_fd;
+    /// 응답 전달 callback
+    route_reply_fn on_reply;
+    /// callback 인자 (server 객체)
+    void *arg;
+    /// 등록된 backend 수 (제거된 것 포함)
+    int backend_num;
+    /// backend 목록
+    route_backend_t backends[ ROUTE_BACKEND_MAX];
+    /// ring 위의 가상 노드 수
+    int point_num;
+    /// hash 값으로 정렬된 가상 노드
+    route_point_t points[ ROUTE_BACKEND_MAX * ROUTE_VNODES];
+    /// 다음에 할당할 hop_id
+    uint32_t next_hop_id;
+    /// 응답 대기 중인 요청 수
+    int pending_num;
+    /// 마지막으로 timeout 을 확인한 시각 (ms)
+    uint64_t last_tick_ms;
+    /// 응답 대기 요청 (hop_id & ( ROUTE_PENDING_MAX - 1) 로 index)
+    route_pending_t pending[ ROUTE_PENDING_MAX];
+};
+
+route_t* route_init( int epoll_fd, route_reply_fn on_reply, void *arg);
+void route_destroy( route_t *route);
+int route_add_backend( route_t *route, struct sockaddr_in *addr);
+int route_remove_backend( route_t *route, int index);
+int route_lookup( route_t *route, uint32_t app_id);
+int route_forward( route_t *route, const char *frame, int len, void *owner, uint32_t *hop_id);
+void route_cancel( route_t *route, uint32_t hop_id);
+int route_process( route_t *route, route_conn_t *conn, uint32_t events);
+void route_check_timeouts( route_t *route);
+uint64_t route_now_ms();
+
+#endif
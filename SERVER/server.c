@@ -1,3 +1,5 @@
+// recvmmsg / sendmmsg (COMMON/udp.h)
+#define _GNU_SOURCE
 #include "server.h"
 
 // ----------------------------------------------------------
@@ -9,7 +11,8 @@ static int is_error = false;
 
 /**
  * @fn static void server_transc_clear( transc_t *transc)
- * @brief transc 구조체 객체를 초기화하는 함수
+ * @brief 다음 메시지를 받을 수 있게 transc 구조체 객체의 송수신 상태를 초기화하는 함수
+ * 버퍼는 길이만큼만 다시 쓰이므로 지우지 않는다 (메시지마다 2KB를 건드리지 않는다)
  * @return void
  * @param transc 초기화하기 위한 transc_t 구조체 변수
  */
@@ -21,11 +24,80 @@ static void server_transc_clear( transc_t *transc){
     transc->length = 0;
     transc->recv_bytes = 0;
     transc->send_bytes = 0;
-    memset( transc->read_hdr_buf, '\0', MSG_HEADER_LEN);
-    memset( transc->read_body_buf, '\0', BUF_MAX_LEN);
-    memset( transc->write_hdr_buf, '\0', MSG_HEADER_LEN);
-    memset( transc->write_body_buf, '\0', BUF_MAX_LEN);
+    transc->is_reply_ready = 0;
+    transc->is_wait_reply = 0;
+    transc->is_crc = 0;
+    transc->is_crc_trailer = 0;
+    transc->is_discard = 0;
+    transc->deadline_us = 0;
     transc->data = NULL;
+    if( transc->reply_val != NULL){
+        cache_val_put( transc->reply_val);
+        transc->reply_val = NULL;
+    }
+    if( transc->blob != NULL){
+        blob_put( transc->blob);
+        transc->blob = NULL;
+    }
+}
+
+/**
+ * @fn static inline int server_flight_state( transc_t *transc)
+ * @brief flight recorder 에 남길 연결 상태 bit 를 만드는 함수
+ * @return FLIGHT_STATE bit
+ * @param transc 상태를 남길 연결
+ */
+static inline int server_flight_state( transc_t *transc){
+    return transc->is_recv_header | ( transc->is_recv_body << 1) | ( transc->is_send_header << 2) | ( transc->is_send_body << 3)
+        | ( transc->is_wait_reply << 4) | ( transc->is_queued << 5) | ( ( transc->buf != NULL) << 6) | ( ( ( transc->events & EPOLLOUT) != 0) << 7);
+}
+
+/**
+ * @fn static int server_buf_get( server_t *server, transc_t *transc)
+ * @brief 메시지를 받기 시작하는 연결에 송수신 버퍼를 빌려 주는 함수
+ * pool 에 돌려받은 버퍼가 있으면 그것을 쓰고, 없을 때만 새로 할당한다
+ * @return 정상이면 NORMAL, 할당하지 못하면 OBJECT_ERR
+ * @param server 버퍼 pool 을 가지고 있는 server 객체
+ * @param transc 버퍼가 필요한 연결
+ */
+static int server_buf_get( server_t *server, transc_t *transc){
+    transc_buf_t *buf;
+
+    if( ( buf = server->buf_pool) != NULL){
+        server->buf_pool = buf->pool_next;
+        server->buf_pool_num--;
+    }
+    else if( ( buf = ( transc_buf_t*)malloc( sizeof( transc_buf_t))) == NULL){
+        printf("	| ! Server : Failed to allocate memory\n");
+        return OBJECT_ERR;
+    }
+    transc->buf = buf;
+    server->buf_used++;
+    return NORMAL;
+}
+
+/**
+ * @fn static void server_buf_put( server_t *server, transc_t *transc)
+ * @brief 연결이 빌려 간 송수신 버퍼를 pool 에 돌려주는 함수 (pool 이 가득 차면 해제한다)
+ * @return void
+ * @param server 버퍼 pool 을 가지고 있는 server 객체
+ * @param transc 버퍼를 돌려줄 연결
+ */
+static void server_buf_put( server_t *server, transc_t *transc){
+    transc_buf_t *buf = transc->buf;
+
+    if( buf == NULL){
+        return;
+    }
+    transc->buf = NULL;
+    server->buf_used--;
+    if( server->buf_pool_num >= TRANSC_BUF_POOL_MAX){
+        free( buf);
+        return;
+    }
+    buf->pool_next = server->buf_pool;
+    server->buf_pool = buf;
+    server->buf_pool_num++;
 }
 
 /**
@@ -36,7 +108,7 @@ static void server_transc_clear( transc_t *transc){
  */
 static uint32_t server_transc_get_msg_length( transc_t *transc){
     // if header is NULL
-    if( ( strlen( transc->read_hdr_buf) == 0)){
+    if( ( strlen( transc->buf->read_hdr_buf) == 0)){
         return -1;
     }
 
@@ -45,7 +117,7 @@ static uint32_t server_transc_get_msg_length( transc_t *transc){
     // char형의 uint8_t 포인터로의 형변환
     // uint8_t -> 8bit 크기의 int형 자료형. char형과 크기가 같다. 
     //
-    uint8_t *data = ( uint8_t*)( transc->read_hdr_buf);
+    uint8_t *data = ( uint8_t*)( transc->buf->read_hdr_buf);
 
     // Big endian
     //    uint32_t msg_len_b = ( ( ( int)( data[ 1])) << 16) + ( ( ( int)( data[ 2])) << 8) + data[ 3];
@@ -54,14 +126,58 @@ static uint32_t server_transc_get_msg_length( transc_t *transc){
     uint32_t msg_len_l = ( ( ( int)( data[ 3])) << 16) + ( ( ( int)( data[ 2])) << 8) + data[ 1]; 
 
     //    printf("msg_len_b : %d\n", msg_len_b);
-    printf("msg_len_l : %d\n", msg_len_l);
+    TRACE_PRINT("msg_len_l : %d\n", msg_len_l);
 
-    int i;
-    for( i = 0; i < 20; i++){
-        printf("%d = %d\n", i, ( uint8_t)data[i]);
+    return msg_len_l;
+}
+
+/**
+ * @fn static ssize_t server_io_read( transc_t *transc, int fd, void *buf, size_t len)
+ * @brief 연결에서 바이트를 읽는 함수 (연결에 io_t 가 있으면 그것으로, 없으면 fd 에서 read 로 읽는다)
+ * @return read 와 같다 (실패하면 -1 과 errno)
+ */
+static ssize_t server_io_read( transc_t *transc, int fd, void *buf, size_t len){
+    if( transc->io != NULL){
+        return transc->io->read( transc->io, buf, len);
     }
+    return read( fd, buf, len);
+}
 
-    return msg_len_l;
+/**
+ * @fn static ssize_t server_io_write( transc_t *transc, int fd, const void *buf, size_t len)
+ * @brief 연결에 바이트를 쓰는 함수 (연결에 io_t 가 있으면 그것으로, 없으면 fd 에 write 로 쓴다)
+ * @return write 와 같다 (실패하면 -1 과 errno)
+ */
+static ssize_t server_io_write( transc_t *transc, int fd, const void *buf, size_t len){
+    if( transc->io != NULL){
+        return transc->io->write( transc->io, buf, len);
+    }
+    return write( fd, buf, len);
+}
+
+/**
+ * @fn static ssize_t server_io_sendfile( transc_t *transc, int fd, int in_fd, off_t off, size_t len)
+ * @brief 파일의 off 부터 len 바이트를 연결에 쓰는 함수
+ * fd 에 바로 쓰면 sendfile 로 page cache 에서 소켓으로 넘기므로 파일 바이트가 user 공간을 거치지 않는다
+ * (연결에 io_t 가 있으면 송신 버퍼로 pread 해서 io_t 로 쓴다)
+ * @return write 와 같다 (파일이 그 사이에 줄어서 더 읽을 것이 없으면 -1 과 EIO)
+ */
+static ssize_t server_io_sendfile( transc_t *transc, int fd, int in_fd, off_t off, size_t len){
+    ssize_t bytes;
+
+    if( transc->io != NULL){
+        if( ( bytes = pread( in_fd, transc->buf->write_body_buf, ( len < BUF_MAX_LEN) ? len : BUF_MAX_LEN, off)) > 0){
+            bytes = transc->io->write( transc->io, transc->buf->write_body_buf, bytes);
+        }
+    }
+    else{
+        bytes = sendfile( fd, in_fd, &off, len);
+    }
+    if( bytes == 0){
+        errno = EIO;
+        return -1;
+    }
+    return bytes;
 }
 
 /**
@@ -87,12 +203,14 @@ static int server_recv_data( transc_t *transc, int fd){
     // 1. read로 헤더 크기만큼 먼저 수신하기 
     // 헤더와 바디 모두 수신받지 않았을 때 read()를 진행한다. 
     if( ( transc->is_recv_header == 0) && ( transc->is_recv_body == 0)){ // recv header
-        memset( transc->read_hdr_buf, '\0', MSG_HEADER_LEN);
-        recv_bytes = read( fd, temp_read_hdr_buf, MSG_HEADER_LEN - ( transc->recv_bytes));
+        if( transc->recv_bytes == 0){
+            memset( transc->buf->read_hdr_buf, '\0', MSG_HEADER_LEN);
+        }
+        recv_bytes = server_io_read( transc, fd, temp_read_hdr_buf, MSG_HEADER_LEN - ( transc->recv_bytes));
         // 에러 처리 
         if( recv_bytes < 0){
             if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
-                printf("    | @ Server : EAGAIN\n");
+                TRACE_PRINT("    | @ Server : EAGAIN\n");
                 return ERRNO_EAGAIN;
             }
             else if( errno == EINTR){
@@ -106,29 +224,49 @@ static int server_recv_data( transc_t *transc, int fd){
         }
         // 파일 없음 
         else if( recv_bytes == 0){
-            perror(" read error ");
             printf("    | ! Server : read 0 byte (in recv msg header) (fd:%d)\n", fd);
             return ZERO_BYTE;
         }
         // read 성공 시 trnasc->read_hdr_buf에 헤더 저장 
         else{
-            printf(" recv_bytes : %d", recv_bytes);
-            memcpy( &transc->read_hdr_buf[ transc->recv_bytes], temp_read_hdr_buf, recv_bytes);
+            TRACE_PRINT(" recv_bytes : %d", recv_bytes);
+            memcpy( &transc->buf->read_hdr_buf[ transc->recv_bytes], temp_read_hdr_buf, recv_bytes);
             transc->recv_bytes += recv_bytes;
 
             if( transc->recv_bytes == MSG_HEADER_LEN){
                 // 서버가 헤더를 모두 수신하면, 헤더를 해독해서 메시지 길이를 구한다
                 transc->length = server_transc_get_msg_length( transc);
                 body_len = transc->length - MSG_HEADER_LEN;
-                printf("    | @ Server : msg body len : %d\n", body_len);
+                TRACE_PRINT("    | @ Server : msg body len : %d\n", body_len);
                 if( body_len <= 0){
                     printf("    | ! Server : msg body length is 0 (in recv msg header) (fd:%d)\n", fd);
                     return BUF_ERR;
                 }
+                if( body_len > BUF_MAX_LEN){
+                    printf("    | ! Server : msg body is too long (len:%d) (in recv msg header) (fd:%d)\n", body_len, fd);
+                    return BUF_ERR;
+                }
+                // trailer 는 바디 길이에 들어 있다. 헤더는 여기서, 바디는 복사하면서 CRC32C 를 계산한다
+                if( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->flag & KMP_FLAG_CRC){
+                    if( body_len <= KMP_CRC_LEN){
+                        printf("    | ! Server : msg body has only CRC32C trailer (len:%d) (in recv msg header) (fd:%d)\n", body_len, fd);
+                        return BUF_ERR;
+                    }
+                    transc->is_crc = 1;
+                    transc->crc = crc32c_update( 0, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+                }
+                // deadline extension 은 바디 맨 앞에 있다. 그 8 바이트를 받으면 바로 읽고 (server_deadline_peek), 떼는 것은 다 받은 뒤다 (server_deadline_take)
+                if( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->flag & KMP_FLAG_DEADLINE){
+                    if( body_len <= KMP_DEADLINE_LEN + ( ( transc->is_crc == 1) ? KMP_CRC_LEN : 0)){
+                        printf("    | ! Server : msg body has only deadline extension (len:%d) (in recv msg header) (fd:%d)\n", body_len, fd);
+                        return BUF_ERR;
+                    }
+                }
+                transc->is_recv_header = 1;
             }
             else{
-                printf("    | ! Server : recv overflow error (in recv msg header) (fd:%d)\n", fd);
-                return BUF_ERR;
+                // 헤더 일부만 수신됨. 나머지는 다음 이벤트에서 받는다
+                return NOT_RECV;
             }
         }
     }
@@ -141,10 +279,10 @@ static int server_recv_data( transc_t *transc, int fd){
     if( ( transc->is_recv_header == 1) && ( transc->is_recv_body == 0)){ // If success to recv header, then recv body
         // The transc->recv_bytes is MSG_HEADER_LEN (20)
         // 즉 메시지 바디 길이만큼 read()한다. 
-        recv_bytes = read( fd, temp_read_body_buf, transc->length - ( transc->recv_bytes));
+        recv_bytes = server_io_read( transc, fd, temp_read_body_buf, transc->length - ( transc->recv_bytes));
         if( recv_bytes < 0){
             if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
-                printf("    | @ Server : EAGAIN\n");
+                TRACE_PRINT("    | @ Server : EAGAIN\n");
                 return (ERRNO_EAGAIN);
             }
             else if( errno == EINTR){
@@ -162,7 +300,19 @@ static int server_recv_data( transc_t *transc, int fd){
         }
         else{
             body_index = transc->recv_bytes - MSG_HEADER_LEN;
-            memcpy( &transc->read_body_buf[ body_index], temp_read_body_buf, recv_bytes);
+            body_len = transc->length - MSG_HEADER_LEN - KMP_CRC_LEN;
+            if( transc->is_discard == 1){
+                // 이미 지난 요청이다. 다음 메시지 경계까지 읽기만 하고 버퍼에 담거나 CRC32C 를 계산하지 않는다
+            }
+            else if( ( transc->is_crc == 1) && ( body_index < body_len)){
+                // trailer 앞까지는 복사하면서 CRC32C 를 이어서 계산한다 (바디를 한 번만 읽는다)
+                body_len = ( recv_bytes < body_len - body_index) ? recv_bytes : body_len - body_index;
+                transc->crc = crc32c_copy( transc->crc, &transc->buf->read_body_buf[ body_index], temp_read_body_buf, body_len);
+                memcpy( &transc->buf->read_body_buf[ body_index + body_len], &temp_read_body_buf[ body_len], recv_bytes - body_len);
+            }
+            else{
+                memcpy( &transc->buf->read_body_buf[ body_index], temp_read_body_buf, recv_bytes);
+            }
             transc->recv_bytes += recv_bytes;
 
             if( transc->recv_bytes == transc->length){
@@ -173,10 +323,51 @@ static int server_recv_data( transc_t *transc, int fd){
 
 
     if( ( ( transc->is_recv_header == 1) && ( transc->is_recv_body == 1))){
-        printf("    | @ Server : Recv the msg (bytes : %d) (fd : %d)\n", transc->recv_bytes, fd);
+        TRACE_PRINT("    | @ Server : Recv the msg (bytes : %d) (fd : %d)\n", transc->recv_bytes, fd);
+        return RECV_COMPLETE;
     }
 
-    return NORMAL;
+    return NOT_RECV;
+}
+
+/**
+ * @fn static void server_crc_seal( transc_t *transc)
+ * @brief CRC32C trailer 가 있던 요청의 응답에 trailer 를 붙이는 함수 (응답을 보내기 시작할 때 한 번 부른다)
+ * echo 응답은 write 버퍼로 먼저 복사하고 trailer 도 write 버퍼 바디 뒤에 쓴다
+ * cache 버퍼를 그대로 보내는 응답, blob 응답, write 버퍼에 자리가 없는 응답은 trailer 를 transc->crc 에 두고 바디 다음에 따로 보낸다
+ * (blob 은 파일을 다시 읽지 않도록 헤더의 CRC32C 와 blob_crc 를 합친다)
+ * @return void
+ * @param transc 응답을 보낼 연결
+ */
+static void server_crc_seal( transc_t *transc){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)transc->buf->write_hdr_buf;
+    int body_len = transc->length - MSG_HEADER_LEN;
+    uint32_t crc;
+
+    transc->is_crc = 0;
+    if( transc->is_reply_ready == 0){
+        memcpy( transc->buf->write_hdr_buf, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+        memcpy( transc->buf->write_body_buf, transc->buf->read_body_buf, body_len);
+        transc->is_reply_ready = 1;
+    }
+    hdr->flag |= KMP_FLAG_CRC;
+    hdr->length = transc->length + KMP_CRC_LEN;
+    crc = crc32c_update( 0, hdr, MSG_HEADER_LEN);
+    if( transc->blob != NULL){
+        // server_blob_reply 가 이미 계산해 두었다
+        crc = crc32c_combine( crc, transc->blob->crc, body_len);
+    }
+    else{
+        crc = crc32c_update( crc, ( transc->reply_val != NULL) ? &transc->reply_val->data[ MSG_HEADER_LEN] : transc->buf->write_body_buf, body_len);
+    }
+    if( ( transc->reply_val != NULL) || ( transc->blob != NULL) || ( body_len + KMP_CRC_LEN > BUF_MAX_LEN)){
+        transc->crc = crc;
+        transc->is_crc_trailer = 1;
+    }
+    else{
+        memcpy( &transc->buf->write_body_buf[ body_len], &crc, KMP_CRC_LEN);
+    }
+    transc->length += KMP_CRC_LEN;
 }
 
 /**
@@ -195,41 +386,49 @@ static int server_send_data( transc_t *transc, int fd){
     int write_bytes = 0;
     int body_len = 0;
     int body_index = 0;
+    int data_len = 0;
+    const char *body;
 
     // 1. Send header with write() function
     // 보낸 헤더가 없을 시 받은 헤더 그대로 보낸다. 
     if( ( transc->is_send_header == 0) && ( transc->is_send_body == 0)){
-        if( transc->send_bytes < MSG_HEADER_LEN){
-            memset( transc->write_hdr_buf, '\0', MSG_HEADER_LEN);
-
-            if( transc->send_bytes == 0){
-                memcpy( transc->write_hdr_buf, transc->read_hdr_buf, MSG_HEADER_LEN);
-            }
-            else if( transc->send_bytes > 0){
-                memcpy( &transc->write_hdr_buf[ transc->send_bytes], &transc->read_hdr_buf[ transc->send_bytes], MSG_HEADER_LEN - transc->send_bytes);
-            }
-            else{
-                printf("    | ! Server : unknown error, transc->send_bytes is negative in server_send_data (fd:%d)\n", fd);
-                return UNKNOWN;
-            }
+        if( ( transc->send_bytes == 0) && ( transc->is_crc == 1)){
+            server_crc_seal( transc);
         }
-        else{
-            printf("    | ! Server : transc->send_bytes error, send_bytes is over than MSG_HEADER_LEN but header not sended in server_send_data (fd:%d)\n", fd);
+        if( ( transc->send_bytes == 0) && ( transc->is_reply_ready == 0)){
+            memcpy( transc->buf->write_hdr_buf, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+        }
+        else if( ( transc->send_bytes < 0) || ( transc->send_bytes >= MSG_HEADER_LEN)){
+            printf("    | ! Server : transc->send_bytes error (bytes:%d) but header not sended in server_send_data (fd:%d)\n", transc->send_bytes, fd);
             return UNKNOWN;
         }
 
-        if( ( write_bytes = write( fd, transc->write_hdr_buf, MSG_HEADER_LEN - transc->send_bytes)) <= 0){
-            printf("    | ! Server : Failed to write msg (fd:%d)\n", fd);
+        if( ( transc->blob != NULL) && ( transc->io == NULL) && ( transc->length > MSG_HEADER_LEN)){
+            // blob 응답은 헤더를 바로 내보내지 않고 이어서 sendfile 로 보내는 파일 바이트와 같은 segment 에 싣는다
+            write_bytes = send( fd, &transc->buf->write_hdr_buf[ transc->send_bytes], MSG_HEADER_LEN - transc->send_bytes, MSG_MORE);
+        }
+        else{
+            write_bytes = server_io_write( transc, fd, &transc->buf->write_hdr_buf[ transc->send_bytes], MSG_HEADER_LEN - transc->send_bytes);
+        }
+        if( write_bytes <= 0){
             if( errno == EAGAIN || errno == EWOULDBLOCK){
                 return ERRNO_EAGAIN;
             }
+            printf("    | ! Server : Failed to write msg (fd:%d)\n", fd);
             return NEGATIVE_BYTE;
         }
 
         transc->send_bytes += write_bytes;
         if( transc->send_bytes == MSG_HEADER_LEN){
             transc->is_send_header = 1;
-            transc->recv_bytes -= write_bytes;
+            // 헤더만 있는 응답 (KMP_CODE_UNAVAILABLE 등)
+            if( transc->length == MSG_HEADER_LEN){
+                transc->is_send_body = 1;
+                return NORMAL;
+            }
+        }
+        else{
+            return ERRNO_EAGAIN;
         }
     }
     else if( ( transc->is_send_header == 0) && ( transc->is_send_body == 1)){
@@ -240,46 +439,49 @@ static int server_send_data( transc_t *transc, int fd){
     // 2. Send body with write() function
     if( ( transc->is_send_header == 1) && ( transc->is_send_body == 0)){
         body_len = transc->length - MSG_HEADER_LEN;
+        body_index = transc->send_bytes - MSG_HEADER_LEN;
         // 메시지 검사
-        if( transc->send_bytes < transc->length){
-            memset( transc->write_body_buf, '\0', body_len);
+        if( ( body_index == 0) && ( transc->is_reply_ready == 0)){
+            memcpy( transc->buf->write_body_buf, transc->buf->read_body_buf, body_len);
+        }
+        else if( ( body_index < 0) || ( body_index >= body_len)){
+            printf("    | ! Server : transc->send_bytes error (bytes:%d) in server_send_data (fd:%d)\n", transc->send_bytes, fd);
+            return UNKNOWN;
+        }
 
-            if( transc->send_bytes == MSG_HEADER_LEN){
-                memcpy( transc->write_body_buf, transc->read_body_buf, body_len);
+        // cache hit 응답은 cache 된 버퍼를 복사하지 않고 그대로 보내고, blob 응답은 파일에서 바로 보낸다
+        // 따로 보내는 trailer 가 있으면 바디를 다 보낸 뒤 이어서 보낸다 (소켓이 가득 차면 다음 EPOLLOUT 에서 이어간다)
+        data_len = body_len - ( ( transc->is_crc_trailer == 1) ? KMP_CRC_LEN : 0);
+        body = ( transc->reply_val != NULL) ? &transc->reply_val->data[ MSG_HEADER_LEN] : transc->buf->write_body_buf;
+        while( transc->send_bytes < transc->length){
+            body_index = transc->send_bytes - MSG_HEADER_LEN;
+            if( body_index >= data_len){
+                write_bytes = server_io_write( transc, fd, &( ( const char*)&transc->crc)[ body_index - data_len], body_len - body_index);
             }
-            else if( transc->send_bytes > MSG_HEADER_LEN){
-                body_index = transc->send_bytes - MSG_HEADER_LEN;
-                memcpy( &transc->write_body_buf[ body_index], &transc->read_body_buf[ body_index], body_len - transc->send_bytes);
+            else if( transc->blob != NULL){
+                write_bytes = server_io_sendfile( transc, fd, transc->blob->fd, body_index, data_len - body_index);
             }
             else{
-                printf("    | ! Server : unknown error, transc->send_bytes is negative in server_send_data (fd:%d)\n", fd);
-                return UNKNOWN;
+                write_bytes = server_io_write( transc, fd, &body[ body_index], data_len - body_index);
             }
-        }
-        else{
-            printf("    | ! Server : transc->send_bytes error, send_bytes is over MSG_HEADER_LEN but header not sent in server_send_data (fd:%d)\n", fd);
-            return UNKNOWN;
-        }
+            if( write_bytes <= 0){
+                if( errno == EAGAIN || errno == EWOULDBLOCK){
+                    return ERRNO_EAGAIN;
+                }
 
-        if( ( write_bytes = write( fd, transc->write_body_buf, transc->recv_bytes)) <= 0){
-            if( errno == EAGAIN || errno == EWOULDBLOCK){
-                return ERRNO_EAGAIN;
+                printf("    | ! Server : Failed to write msg\n");
+                return NEGATIVE_BYTE;
             }
-
-            printf("    | ! Server : Failed to write msg\n");
-            return NEGATIVE_BYTE;
-        }
-        else{
-            transc->recv_bytes -= write_bytes;
             transc->send_bytes += write_bytes;
-
-            if( transc->recv_bytes == 0){
-                transc->is_send_body = 1;
+            if( ( transc->send_bytes < transc->length) && ( transc->send_bytes - MSG_HEADER_LEN != data_len)){
+                // 짧게 써졌으면 소켓이 가득 찬 것이다
+                return ERRNO_EAGAIN;
             }
         }
+        transc->is_send_body = 1;
 
         if( ( transc->is_send_header == 1) && ( transc->is_send_body == 1)){
-            printf("    | @ Server : Send the msg (bytes : %d) (fd : %d)\n", transc->send_bytes, fd);
+            TRACE_PRINT("    | @ Server : Send the msg (bytes : %d) (fd : %d)\n", transc->send_bytes, fd);
         }
     }
 
@@ -324,159 +526,1939 @@ static int server_check_fd( int fd){
 }
 
 /**
- * @fn static int server_process_data( server_t *server, int fd)
- * @brief Server가 Client로 데이터를 보낼 때, Server에서 메시지 송수신을 처리하기 위한 함수 
- * @return 열거형 참고 
- * @param server 서버의 정보를 담고 있는 server_t 구조체 객체
- * @param fd 연결된 client file descriptor
+ * @fn static int server_epoll_mod( server_t *server, transc_t *transc, uint32_t events)
+ * @brief client file descriptor의 epoll 관찰 이벤트를 바꾸는 함수
+ * @return 정상이면 NORMAL, 실패하면 OBJECT_ERR
+ * @param server epoll 인스턴스를 가지고 있는 server 객체
+ * @param transc 이벤트를 바꿀 연결
+ * @param events 새로 관찰할 이벤트 (EPOLLIN, EPOLLOUT)
  */
-static int server_process_data( server_t* server, int fd){
-    int i, event_count = 0;
-    int read_rv = 0;
-    int send_rv = 0;
-    transc_t transc[ 1];
+static int server_epoll_mod( server_t *server, transc_t *transc, uint32_t events){
+    struct epoll_event client_event;
 
-    printf("    | @ Server : waiting...\n");
-    while( 1){
-        if( ( server_check_fd( fd) == FD_ERR)){
-            printf("    | @ Server : connection is ended (client:%d <-> server)\n", fd);
-            break;
-        }
+    if( transc->events == events){
+        return NORMAL;
+    }
 
-        if( ( transc->is_send_header == 1) && ( transc->is_send_body == 1)){
-            server_transc_clear( transc);
-        }
+    client_event.events = events;
+    client_event.data.ptr = transc;
+    if( ( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_MOD, transc->fd, &client_event)) < 0){
+        flight_record( server->flight, FLIGHT_EV_EPOLL, transc->fd, transc->conn_id, server_flight_state( transc), OBJECT_ERR, errno, events);
+        printf("    | ! Server : Failed to modify epoll client event (fd:%d)\n", transc->fd);
+        return OBJECT_ERR;
+    }
+    transc->events = events;
+    flight_record( server->flight, FLIGHT_EV_EPOLL, transc->fd, transc->conn_id, server_flight_state( transc), NORMAL, 0, events);
+    return NORMAL;
+}
 
-        event_count = epoll_wait( server->epoll_handle_fd, server->events, BUF_MAX_LEN, TIMEOUT);
-        if( event_count < 0){
-            printf("    | ! Server : epoll_wait error\n");
-            break;
+/**
+ * @fn static transc_t* server_transc_get( server_t *server, int fd)
+ * @brief 연결 table에서 fd 자리의 slot을 구하는 함수 (chunk가 없으면 할당한다)
+ * slot 주소는 server가 끝날 때까지 바뀌지 않으므로 epoll data.ptr 로 등록할 수 있다
+ * @return fd 자리의 slot, fd가 범위를 벗어나거나 메모리가 없으면 NULL
+ * @param server 연결 table을 가지고 있는 server 객체
+ * @param fd client file descriptor
+ */
+static transc_t* server_transc_get( server_t *server, int fd){
+    transc_t *chunk;
+    int i;
+
+    if( ( fd < 0) || ( fd >= TRANSC_CHUNK_LEN * TRANSC_CHUNK_NUM)){
+        return NULL;
+    }
+
+    if( ( chunk = server->transc_table[ fd / TRANSC_CHUNK_LEN]) == NULL){
+        if( posix_memalign( ( void**)&chunk, 64, sizeof( transc_t) * TRANSC_CHUNK_LEN) != 0){
+            return NULL;
         }
-        else if( event_count == 0){
-            printf("    | ! Server : epoll_wait timeout\n");
-            continue;
+        for( i = 0; i < TRANSC_CHUNK_LEN; i++){
+            chunk[ i].fd = -1;
+            chunk[ i].reply_val = NULL;
+            chunk[ i].cache_wait = NULL;
+            chunk[ i].streams = NULL;
+            chunk[ i].io = NULL;
+            chunk[ i].sub = NULL;
+            chunk[ i].blob = NULL;
+            chunk[ i].is_queued = 0;
         }
+        server->transc_table[ fd / TRANSC_CHUNK_LEN] = chunk;
+    }
+    return &chunk[ fd % TRANSC_CHUNK_LEN];
+}
 
-        for( i = 0; i < event_count; i++){
-            if( server->events[ i].data.fd == server->fd){
-            }
-            else if ( server->events[ i].data.fd == fd){
-                if( transc->is_recv_header == 0 && transc->is_recv_body == 0){
-                    read_rv = server_recv_data( transc, fd);
-                    if( read_rv <= ZERO_BYTE){
-                        printf("    | ! Server : disconnected\n");
-                        printf("    | ! Server : socket closed\n");
-                        close( fd);
-                    }
-                }
+/**
+ * @fn static void server_run_push( server_t *server, transc_t *transc)
+ * @brief 메시지를 다 받은 연결을 헤더 flag 의 우선순위에 맞는 run queue 맨 뒤에 넣는 함수
+ * @return void
+ * @param server run queue 를 가지고 있는 server 객체
+ * @param transc 메시지를 다 받은 연결
+ */
+static void server_run_push( server_t *server, transc_t *transc){
+    int prio = ( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->flag & KMP_FLAG_PRIORITY) ? SERVER_PRIO_HIGH : SERVER_PRIO_NORMAL;
+
+    transc->is_queued = 1;
+    transc->prio = prio;
+    transc->run_next = NULL;
+    if( server->run_tail[ prio] == NULL){
+        server->run_head[ prio] = transc;
+    }
+    else{
+        server->run_tail[ prio]->run_next = transc;
+    }
+    server->run_tail[ prio] = transc;
+}
 
-                if( transc->is_recv_header = 1 && transc->is_recv_body == 0){
-                    read_rv = server_recv_data( transc, fd);
-                    if( read_rv <= ZERO_BYTE){
-                        printf("    | ! Server : disconnected\n");
-                        printf("    | ! Server : socket closed\n");
-                        close( fd);
-                    }
-                }
+/**
+ * @fn static transc_t* server_run_pop( server_t *server)
+ * @brief 우선순위가 가장 높은 비어 있지 않은 run queue 의 맨 앞 연결을 꺼내는 함수
+ * @return 처리할 연결, 모든 run queue 가 비었으면 NULL
+ * @param server run queue 를 가지고 있는 server 객체
+ */
+static transc_t* server_run_pop( server_t *server){
+    transc_t *transc;
+    int prio;
+
+    for( prio = 0; prio < SERVER_PRIO_NUM; prio++){
+        if( ( transc = server->run_head[ prio]) != NULL){
+            if( ( server->run_head[ prio] = transc->run_next) == NULL){
+                server->run_tail[ prio] = NULL;
+            }
+            transc->is_queued = 0;
+            return transc;
+        }
+    }
+    return NULL;
+}
 
-                if( ( transc->is_recv_header == 1) && ( transc->is_recv_body == 1)){
-                    if( ( send_rv = server_send_data( transc, fd)) <= ZERO_BYTE){
-                        printf("    | ! Server : Failed to send msg (fd:%d)\n", fd);
-                    }
-                }
+/**
+ * @fn static void server_run_unlink( server_t *server, transc_t *transc)
+ * @brief 닫히는 연결을 run queue 에서 빼는 함수 (처리 전에 닫히는 경우는 드물어서 queue 를 훑는다)
+ * @return void
+ * @param server run queue 를 가지고 있는 server 객체
+ * @param transc run queue 에 들어 있는 연결
+ */
+static void server_run_unlink( server_t *server, transc_t *transc){
+    transc_t **link = &server->run_head[ transc->prio];
+    transc_t *prev = NULL;
 
-                if( ( transc->is_send_header == 1) && (transc->is_send_body == 0)){
-                    if( ( send_rv = server_send_data( transc, fd)) <= ZERO_BYTE){
-                        printf("   | ! Server : Failed to send msg (fd:%d)\n", fd);
-                    }
-                }
-            }
+    while( ( *link != NULL) && ( *link != transc)){
+        prev = *link;
+        link = &( *link)->run_next;
+    }
+    if( *link == transc){
+        *link = transc->run_next;
+        if( server->run_tail[ transc->prio] == transc){
+            server->run_tail[ transc->prio] = prev;
         }
     }
+    transc->is_queued = 0;
+}
+
+/**
+ * @fn static void server_transc_remove( server_t *server, transc_t *transc)
+ * @brief 연결을 목록에서 빼고 소켓과 shared memory 전송로를 닫는 함수
+ * @return void
+ * @param server 연결 목록을 가지고 있는 server 객체
+ * @param transc 닫을 연결
+ */
+static void server_transc_remove( server_t *server, transc_t *transc){
+    // 닫게 만든 실패의 errno 와 그때의 상태를 남긴다
+    flight_record( server->flight, FLIGHT_EV_CLOSE, transc->fd, transc->conn_id, server_flight_state( transc), 0, errno, transc->recv_bytes);
+    epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_DEL, transc->fd, NULL);
+    if( transc->is_queued){
+        server_run_unlink( server, transc);
+    }
+    if( transc->cache_wait != NULL){
+        // 같은 요청의 처리는 계속되고 응답은 cache 에 남는다
+        cache_remove_waiter( transc->cache_wait, transc);
+        transc->cache_wait = NULL;
+    }
+    else if( transc->is_wait_reply && ( server->route != NULL)){
+        // 늦게 도착한 upstream 응답은 버려진다
+        route_cancel( server->route, transc->route_hop_id);
+    }
+    else if( transc->is_wait_reply && ( server->wal != NULL)){
+        // record 는 log 에 남고 응답만 보내지 않는다
+        wal_cancel( server->wal, transc);
+    }
+    if( transc->reply_val != NULL){
+        cache_val_put( transc->reply_val);
+        transc->reply_val = NULL;
+    }
+    if( transc->blob != NULL){
+        blob_put( transc->blob);
+        transc->blob = NULL;
+    }
+    if( transc->shm != NULL){
+        epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_DEL, transc->shm->req_efd, NULL);
+        shm_chan_destroy( transc->shm);
+    }
+    if( transc->proxy != NULL){
+        epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_DEL, transc->proxy->upstream_fd, NULL);
+        proxy_destroy( transc->proxy);
+    }
+    stream_tab_destroy( transc->streams);
+    if( transc->sub != NULL){
+        // queue 에 남은 발행 메시지는 참조만 놓는다
+        pubsub_sub_destroy( server->pubsub, transc->sub);
+        transc->sub = NULL;
+    }
+    close( transc->fd);
+    printf("    | @ Server : socket closed (fd:%d)\n", transc->fd);
+    server_buf_put( server, transc);
+    transc->shm = NULL;
+    transc->proxy = NULL;
+    transc->streams = NULL;
+    // 같은 epoll_wait 결과에 남아 있는 이 slot의 이벤트는 무시된다
+    transc->fd = -1;
+    server->transc_num--;
+    if( server->worker != NULL){
+        worker_conn_done( server->worker);
+    }
+}
+
+/**
+ * @fn static int server_shm_open( server_t *server, transc_t *transc)
+ * @brief UDS 연결에서 shared memory 전송로 협상 요청(KMP_CODE_SHM_OPEN)을 처리하는 함수
+ * 요청 메시지를 그대로 응답하면서 memfd와 eventfd 두 개를 SCM_RIGHTS로 넘긴다
+ * @return 열거형 참고
+ * @param server epoll 인스턴스를 가지고 있는 server 객체
+ * @param transc 요청을 보낸 UDS 연결
+ */
+static int server_shm_open( server_t *server, transc_t *transc){
+    char frame[ MSG_HEADER_LEN + BUF_MAX_LEN];
+    struct epoll_event shm_event;
+    shm_chan_t *chan;
+
+    if( ( transc->is_unix == 0) || ( transc->shm != NULL)){
+        printf("    | ! Server : shm open is only allowed once on unix socket (fd:%d)\n", transc->fd);
+        return BUF_ERR;
+    }
+
+    if( ( chan = shm_chan_create( SHM_RING_SIZE)) == NULL){
+        printf("    | ! Server : Failed to create shm channel (fd:%d)\n", transc->fd);
+        return OBJECT_ERR;
+    }
+
+    memcpy( frame, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+    memcpy( &frame[ MSG_HEADER_LEN], transc->buf->read_body_buf, transc->length - MSG_HEADER_LEN);
+    if( shm_chan_send_fds( transc->fd, chan, frame, transc->length) != transc->length){
+        shm_chan_destroy( chan);
+        return SOC_ERR;
+    }
+
+    transc->sub_ev.type = SERVER_EV_SHM;
+    transc->sub_ev.fd = chan->req_efd;
+    transc->sub_ev.transc = transc;
+    shm_event.events = EPOLLIN;
+    shm_event.data.ptr = &transc->sub_ev;
+    if( ( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, chan->req_efd, &shm_event)) < 0){
+        printf("    | ! Server : Failed to add epoll shm event (fd:%d)\n", transc->fd);
+        shm_chan_destroy( chan);
+        return OBJECT_ERR;
+    }
 
+    // client가 첫 메시지를 넣으면 eventfd로 깨우도록 대기 상태로 시작한다
+    shm_ring_sleep( chan->req);
+    transc->shm = chan;
+    server_transc_clear( transc);
+    printf("    | @ Server : shm channel opened (fd:%d) (efd:%d)\n", transc->fd, chan->req_efd);
     return NORMAL;
 }
 
 /**
- * @fn static void* server_detect_finish( void *data)
- * @brief Server에서 사용하는 메모리를 해제하기 위한 함수
- * @return None
- * @param data Thread 매개변수, 현재 사용되는(할당된) Server 객체
+ * @fn static int server_shm_process( server_t *server, transc_t *transc)
+ * @brief shared memory 전송로의 요청 ring에 쌓인 메시지를 처리해서 응답 ring에 넣는 함수
+ * @return 열거형 참고
+ * @param server server 객체
+ * @param transc shared memory 전송로를 가지고 있는 연결
  */
-static void* server_detect_finish( void *data){
-    server_t *server = ( server_t*)( data);
+static int server_shm_process( server_t *server, transc_t *transc){
+    shm_chan_t *chan = transc->shm;
+    char frame[ MSG_HEADER_LEN + BUF_MAX_LEN];
+    eventfd_t value;
+    uint32_t len;
+    int rv;
+
+    eventfd_read( chan->req_efd, &value);
 
     while( 1){
-        if( is_error == true){
-            break;
+        while( ( len = shm_ring_peek_length( chan->req)) > 0){
+            // 길이는 client 가 쓴 값이다. frame 보다 길면 응답 ring 이 비기를 기다려도 소용 없으므로 바로 끊는다
+            if( len > sizeof( frame)){
+                printf("    | ! Server : broken msg in shm ring (len:%u) (fd:%d)\n", len, transc->fd);
+                return BUF_ERR;
+            }
+            if( shm_ring_free_bytes( chan->rsp) < len){
+                // 응답 ring이 가득 찼으면 다음 loop에서 다시 시도하도록 스스로 깨운다
+                eventfd_write( chan->req_efd, 1);
+                return NORMAL;
+            }
+
+            if( ( rv = shm_ring_pop( chan->req, frame, sizeof( frame))) <= 0){
+                printf("    | ! Server : broken msg in shm ring (len:%u) (fd:%d)\n", len, transc->fd);
+                return BUF_ERR;
+            }
+            if( server->capture != NULL){
+                capture_record( server->capture, transc->conn_id, frame, MSG_HEADER_LEN, &frame[ MSG_HEADER_LEN], rv - MSG_HEADER_LEN);
+            }
+            shm_ring_push( chan->rsp, chan->rsp_efd, frame, rv);
+            server->requests++;
         }
 
-        if( is_finish == true){
-            server_destroy( server);
-            is_error = true;
+        if( shm_ring_sleep( chan->req) == 1){
             break;
         }
     }
-}   
-
-// -----------------------------------------------------------------------------------
+    return NORMAL;
+}
 
 /**
- * @fn server_t* server_init( char **argv)
- * @brief server 객체를 생성하고 초기화하는 함수
- * @return 생성된 server 객체
- * @param **argv IP와 PORT 정보
+ * @fn static int server_proxy_process( server_t *server, transc_t *transc, int event_fd, uint32_t events)
+ * @brief proxy 모드 연결의 client / upstream 이벤트를 중계하고 epoll 관찰 이벤트를 갱신하는 함수
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server epoll 인스턴스를 가지고 있는 server 객체
+ * @param transc proxy 상태를 가지고 있는 연결
+ * @param event_fd 이벤트가 발생한 소켓 (client 또는 upstream)
+ * @param events 발생한 epoll 이벤트
  */
-server_t* server_init( char **argv){
+static int server_proxy_process( server_t *server, transc_t *transc, int event_fd, uint32_t events){
+    proxy_t *proxy = transc->proxy;
+    struct epoll_event proxy_event;
+    uint32_t client_events, upstream_events;
     int rv;
-    server_t *server = ( server_t*)malloc( sizeof( server_t));
-
-    if( server == NULL){
-        printf("	| ! Server : Failed to allocate memory\n");
-        return NULL;
-    }
-
-    memset( &server->addr, 0, sizeof( struct sockaddr));
-    server->addr.sin_family = AF_INET;
-    server->addr.sin_addr.s_addr = inet_addr( argv[1]);
-    // inet_aton이 inet_addr보다 명확한 에러 리턴을 갖고 있어서 리눅스 매뉴얼 페이지에서는 inet_addr 대체 함수로 권장하고 있다. 다만 inet_addr과 달리 inet_aton은 POSIX.1-2001에 포함되어있지 않다.
-    server->addr.sin_port = htons( atoi( argv[2]));
 
-    if( ( server->fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0){
-        printf("	| ! Server : Failed to open socket\n");
-        free( server);
-        return NULL;
+    if( ( rv = proxy_process( proxy, event_fd, events)) < NORMAL){
+        return rv;
     }
 
-    int reuse = 1;
-    // 소켓 세부 설정
-    // 이미 사용중인 주소나 포트에 대해서도 바인드 허용 
-    if( setsockopt( server->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof( reuse))){
-        printf("	| ! Server : Failed to set the socket's option\n");
-        free( server);
-        return NULL;
+    client_events = proxy_get_events( proxy, proxy->client_fd);
+    if( client_events != proxy->client_events){
+        proxy_event.events = client_events;
+        proxy_event.data.ptr = transc;
+        if( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_MOD, proxy->client_fd, &proxy_event) < 0){
+            printf("    | ! Server : Failed to modify epoll proxy client event (fd:%d)\n", proxy->client_fd);
+            return OBJECT_ERR;
+        }
+        proxy->client_events = client_events;
     }
 
-    // 소켓 bind
-    if( bind( server->fd, ( struct sockaddr*)( &server->addr), sizeof( server->addr)) < 0){
-        printf("	| ! Server : Failed to bind socket\n");
-        if( ( close( server->fd) < 0)){
-            printf("	| ! Server : close error\n");
-            return UNKNOWN;
+    upstream_events = proxy_get_events( proxy, proxy->upstream_fd);
+    if( upstream_events != proxy->upstream_events){
+        proxy_event.events = upstream_events;
+        proxy_event.data.ptr = &transc->sub_ev;
+        if( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_MOD, proxy->upstream_fd, &proxy_event) < 0){
+            printf("    | ! Server : Failed to modify epoll proxy upstream event (fd:%d)\n", proxy->upstream_fd);
+            return OBJECT_ERR;
         }
-        free( server);
-        return NULL;
+        proxy->upstream_events = upstream_events;
     }
+    return NORMAL;
+}
 
-    // 소켓 listen
-    if( listen( server->fd, MSG_QUEUE_NUM) < 0){
-        printf("	| ! Server : listen error\n");
-        if( ( close( server->fd) < 0)){
-            printf("	| ! Server : close error\n");
-            return UNKNOWN;
+/**
+ * @fn static int server_send_reply( server_t *server, transc_t *transc)
+ * @brief 응답을 보내고, 다 보내면 다음 요청을 받을 수 있게 연결 상태를 초기화하는 함수
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server epoll 인스턴스를 가지고 있는 server 객체
+ * @param transc 응답을 보낼 연결
+ */
+static int server_send_reply( server_t *server, transc_t *transc){
+    int send_rv;
+
+    // 발행 메시지를 보내다 말았으면 그 메시지를 다 보낸 뒤에 응답을 시작한다 (메시지 중간에 끼워 넣지 않는다)
+    if( ( transc->sub != NULL) && ( transc->sub->off > 0) && ( transc->send_bytes == 0)){
+        if( pubsub_sub_write( server->pubsub, transc->sub, transc->fd) < NORMAL){
+            return NEGATIVE_BYTE;
+        }
+        if( transc->sub->off > 0){
+            return server_epoll_mod( server, transc, EPOLLIN | EPOLLOUT);
         }
-        free( server);
-        return NULL;
+    }
+
+    send_rv = server_send_data( transc, transc->fd);
+    flight_record( server->flight, FLIGHT_EV_WRITE, transc->fd, transc->conn_id, server_flight_state( transc), send_rv,
+            ( ( send_rv == ERRNO_EAGAIN) || ( send_rv < NORMAL)) ? errno : 0, transc->send_bytes);
+    if( send_rv == ERRNO_EAGAIN){
+        // 소켓 송신 버퍼가 비면 이어서 보낸다
+        return server_epoll_mod( server, transc, EPOLLIN | EPOLLOUT);
+    }
+    else if( send_rv < NORMAL){
+        printf("    | ! Server : Failed to send msg (fd:%d)\n", transc->fd);
+        return send_rv;
+    }
+
+    server_transc_clear( transc);
+    if( ( transc->sub != NULL) && ( transc->sub->num > 0)){
+        // 응답을 보내는 동안 쌓인 발행 메시지는 이번 loop 끝에서 보낸다
+        pubsub_ready_push( server->pubsub, transc->sub);
+    }
+    return server_epoll_mod( server, transc, EPOLLIN);
+}
+
+/**
+ * @fn static void server_set_reply( transc_t *transc, const char *frame, int len)
+ * @brief 보낼 응답 메시지를 write 버퍼에 채우는 함수 (server_send_data 의 echo 복사를 대신한다)
+ * @return void
+ * @param transc 응답을 보낼 연결
+ * @param frame 응답 메시지 (헤더 + 바디)
+ * @param len 응답 메시지 길이
+ */
+static void server_set_reply( transc_t *transc, const char *frame, int len){
+    memcpy( transc->buf->write_hdr_buf, frame, MSG_HEADER_LEN);
+    memcpy( transc->buf->write_body_buf, &frame[ MSG_HEADER_LEN], len - MSG_HEADER_LEN);
+    transc->length = len;
+    transc->is_reply_ready = 1;
+}
+
+/**
+ * @fn static void server_set_reply_val( transc_t *transc, cache_val_t *val)
+ * @brief cache 된 응답을 보내도록 설정하는 함수
+ * 헤더만 복사해서 hop_id 를 요청한 client 의 값으로 바꾸고, 바디는 cache 버퍼를 그대로 보낸다
+ * @return void
+ * @param transc 응답을 보낼 연결
+ * @param val cache 된 응답 (참조 하나를 넘겨 받는다. server_transc_clear 에서 놓는다)
+ */
+static void server_set_reply_val( transc_t *transc, cache_val_t *val){
+    memcpy( transc->buf->write_hdr_buf, val->data, MSG_HEADER_LEN);
+    ( ( kmp_hdr_t*)transc->buf->write_hdr_buf)->hop_id = ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->hop_id;
+    transc->length = val->len;
+    transc->is_reply_ready = 1;
+    transc->reply_val = val;
+}
+
+/**
+ * @fn static void server_cache_reply( server_t *server, cache_entry_t *entry, const char *frame, int len)
+ * @brief 합쳐진 요청의 upstream 응답을 cache 에 채우고 기다리던 client 모두에게 보내는 함수
+ * @return void
+ * @param server cache 를 가지고 있는 server 객체
+ * @param entry 처리 중이던 cache 항목
+ * @param frame upstream 응답 메시지
+ * @param len 응답 메시지 길이
+ */
+static void server_cache_reply( server_t *server, cache_entry_t *entry, const char *frame, int len){
+    cache_val_t *val;
+    transc_t *transc;
+    void **waiters;
+    int i, num;
+
+    // 응답을 보내다가 연결이 닫혀도 waiter 목록이 바뀌지 않게 먼저 꺼낸다
+    waiters = cache_take_waiters( entry, &num);
+    val = cache_fill( server->cache, entry, frame, len);
+
+    for( i = 0; i < num; i++){
+        transc = ( transc_t*)waiters[ i];
+        transc->cache_wait = NULL;
+        transc->is_wait_reply = 0;
+        if( val != NULL){
+            val->refcnt++;
+            server_set_reply_val( transc, val);
+        }
+        else{
+            server_set_reply( transc, frame, len);
+            ( ( kmp_hdr_t*)transc->buf->write_hdr_buf)->hop_id = ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->hop_id;
+        }
+        if( server_send_reply( server, transc) < NORMAL){
+            server_transc_remove( server, transc);
+        }
+    }
+
+    if( val != NULL){
+        cache_val_put( val);
+    }
+    free( waiters);
+}
+
+/**
+ * @fn static void server_route_reply( void *arg, void *owner, const char *frame, int len)
+ * @brief upstream backend의 응답을 요청한 client에게 보내는 함수 (route_t 응답 callback)
+ * @return void
+ * @param arg server 객체
+ * @param owner 요청을 보낸 client 연결
+ * @param frame hop_id 가 원래 값으로 돌아온 응답 메시지
+ * @param len 응답 메시지 길이
+ */
+static void server_route_reply( void *arg, void *owner, const char *frame, int len){
+    server_t *server = ( server_t*)arg;
+    transc_t *transc = ( transc_t*)owner;
+
+    if( transc->type == SERVER_EV_CACHE){
+        char fail_frame[ MSG_HEADER_LEN];
+        if( len > MSG_HEADER_LEN + BUF_MAX_LEN){
+            printf("    | ! Server : upstream reply is too long (len:%d)\n", len);
+            // 기다리던 client 에게는 실패 응답을 보낸다
+            memcpy( fail_frame, frame, MSG_HEADER_LEN);
+            ( ( kmp_hdr_t*)fail_frame)->code = KMP_CODE_UNAVAILABLE;
+            ( ( kmp_hdr_t*)fail_frame)->length = MSG_HEADER_LEN;
+            frame = fail_frame;
+            len = MSG_HEADER_LEN;
+        }
+        server_cache_reply( server, ( cache_entry_t*)owner, frame, len);
+        return;
+    }
+
+    if( ( len < MSG_HEADER_LEN) || ( len > MSG_HEADER_LEN + BUF_MAX_LEN)){
+        printf("    | ! Server : upstream reply is too long (len:%d) (fd:%d)\n", len, transc->fd);
+        server_transc_remove( server, transc);
+        return;
+    }
+
+    transc->is_wait_reply = 0;
+    server_set_reply( transc, frame, len);
+    if( server_send_reply( server, transc) < NORMAL){
+        server_transc_remove( server, transc);
+    }
+}
+
+/**
+ * @fn static int server_route_forward( server_t *server, transc_t *transc)
+ * @brief routing 모드에서 받은 요청을 app_id 담당 backend로 보내고 응답을 기다리게 하는 함수
+ * cache 대상 code 면 cache 된 응답을 바로 보내거나, 처리 중인 같은 요청의 응답을 기다리게 한다
+ * backend가 없으면 바로 KMP_CODE_UNAVAILABLE 응답을 보낸다
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server routing 계층을 가지고 있는 server 객체
+ * @param transc 요청을 받은 client 연결
+ */
+static int server_route_forward( server_t *server, transc_t *transc){
+    char frame[ MSG_HEADER_LEN + BUF_MAX_LEN];
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)frame;
+    cache_entry_t *entry = NULL;
+    cache_val_t *val;
+    uint32_t *hop_id = &transc->route_hop_id;
+    void *owner = transc;
+    int rv, num;
+
+    if( ( server->cache != NULL) && cache_is_cacheable( server->cache, ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code)){
+        rv = cache_lookup( server->cache, ( kmp_hdr_t*)transc->buf->read_hdr_buf, transc->buf->read_body_buf,
+                transc->length - MSG_HEADER_LEN, transc, &entry, &val);
+        if( rv == CACHE_HIT){
+            server_set_reply_val( transc, val);
+            return server_send_reply( server, transc);
+        }
+        else if( rv == CACHE_PENDING){
+            transc->cache_wait = entry;
+            transc->is_wait_reply = 1;
+            return server_epoll_mod( server, transc, 0);
+        }
+        else if( rv == CACHE_MISS){
+            // 응답은 cache 항목이 받아서 기다리는 client 모두에게 나눠 준다
+            owner = entry;
+            hop_id = &entry->route_hop_id;
+        }
+        // 메모리가 없으면 cache 없이 보낸다
+    }
+
+    memcpy( frame, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+    memcpy( &frame[ MSG_HEADER_LEN], transc->buf->read_body_buf, transc->length - MSG_HEADER_LEN);
+
+    if( route_forward( server->route, frame, transc->length, owner, hop_id) < NORMAL){
+        hdr->code = KMP_CODE_UNAVAILABLE;
+        hdr->length = MSG_HEADER_LEN;
+        if( owner != transc){
+            // 같은 loop 안이므로 waiter는 이 연결 하나뿐이다. 실패 응답은 저장되지 않고 항목이 지워진다
+            free( cache_take_waiters( entry, &num));
+            cache_fill( server->cache, entry, frame, MSG_HEADER_LEN);
+        }
+        server_set_reply( transc, frame, MSG_HEADER_LEN);
+        return server_send_reply( server, transc);
+    }
+
+    // 응답이 올 때까지 이 연결의 다음 요청은 읽지 않는다
+    if( owner != transc){
+        transc->cache_wait = entry;
+    }
+    transc->is_wait_reply = 1;
+    return server_epoll_mod( server, transc, 0);
+}
+
+/**
+ * @fn static int server_stats_format( server_t *server, char *body, int cap)
+ * @brief 통계를 "key=value ..." 문자열로 만드는 함수
+ * @return 문자열 길이
+ * @param server 통계를 가지고 있는 server 객체
+ * @param body 문자열을 저장할 버퍼
+ * @param cap 버퍼 크기
+ */
+static int server_stats_format( server_t *server, char *body, int cap){
+    cache_t *cache = server->cache;
+    server_t *peer;
+    worker_t *worker;
+    uint64_t lookups;
+    int len, i;
+
+    len = snprintf( body, cap, "requests=%llu conns=%d bufs_used=%d bufs_pooled=%d prio_high=%llu budget_exhausted=%llu",
+            ( unsigned long long)server->requests, server->transc_num, server->buf_used, server->buf_pool_num,
+            ( unsigned long long)server->prio_high, ( unsigned long long)server->budget_exhausted);
+    if( cache != NULL){
+        lookups = cache->hits + cache->misses + cache->coalesced;
+        len += snprintf( &body[ len], cap - len,
+                " cache_hits=%llu cache_misses=%llu cache_coalesced=%llu cache_evictions=%llu cache_hit_ratio=%.4f"
+                " cache_entries=%d cache_bytes=%zu cache_limit=%zu",
+                ( unsigned long long)cache->hits, ( unsigned long long)cache->misses,
+                ( unsigned long long)cache->coalesced, ( unsigned long long)cache->evictions,
+                ( lookups > 0) ? ( double)cache->hits / lookups : 0.0,
+                cache_entry_num( cache), cache_mem_bytes( cache), cache->shards[ 0].limit * CACHE_SHARD_NUM);
+    }
+    if( server->capture != NULL){
+        len += snprintf( &body[ len], cap - len, " capture_frames=%llu capture_bytes=%llu",
+                ( unsigned long long)server->capture->frames, ( unsigned long long)server->capture->bytes);
+    }
+    if( server->handoff != NULL){
+        len += snprintf( &body[ len], cap - len, " handoff_conns=%llu",
+                ( unsigned long long)server->handoff->conns);
+    }
+    if( server->spin != NULL){
+        len += snprintf( &body[ len], cap - len, " spin_budget_us=%u spin_hits=%llu spin_misses=%llu spin_us=%llu spin_gap_us=%.1f",
+                server->spin->budget_us, ( unsigned long long)server->spin->hits, ( unsigned long long)server->spin->misses,
+                ( unsigned long long)server->spin->spin_ns / 1000, server->spin->gap_us);
+    }
+    if( server->admit != NULL){
+        len += snprintf( &body[ len], cap - len,
+                " admit_admitted=%llu admit_rejected_rate=%llu admit_rejected_load=%llu admit_limit=%d admit_delay_us=%llu",
+                ( unsigned long long)server->admit->admitted, ( unsigned long long)server->admit->rejected_rate,
+                ( unsigned long long)server->admit->rejected_load, server->admit->limit, ( unsigned long long)server->admit->delay_us);
+    }
+    if( server->stream_chunks > 0){
+        len += snprintf( &body[ len], cap - len, " stream_chunks=%llu stream_credits=%llu stream_ends=%llu stream_errors=%llu",
+                ( unsigned long long)server->stream_chunks, ( unsigned long long)server->stream_credits,
+                ( unsigned long long)server->stream_ends, ( unsigned long long)server->stream_errors);
+    }
+    if( ( server->crc_frames > 0) || ( server->crc_errors > 0)){
+        len += snprintf( &body[ len], cap - len, " crc_frames=%llu crc_errors=%llu crc_impl=%s",
+                ( unsigned long long)server->crc_frames, ( unsigned long long)server->crc_errors, crc32c_impl());
+    }
+    if( server->deadline_frames > 0){
+        len += snprintf( &body[ len], cap - len, " deadline_frames=%llu expired_recv=%llu expired_run=%llu",
+                ( unsigned long long)server->deadline_frames, ( unsigned long long)server->expired_recv,
+                ( unsigned long long)server->expired_run);
+    }
+    if( server->wal != NULL){
+        // sync thread 가 바꾸는 값은 lock 없이 읽는다 (통계라 한 batch 어긋나도 된다)
+        len += snprintf( &body[ len], cap - len,
+                " wal_records=%llu wal_bytes=%llu wal_syncs=%llu wal_batch_avg=%.2f wal_batch_max=%llu wal_sync_us=%.1f wal_segments=%llu wal_stalls=%llu wal_waiting=%d",
+                ( unsigned long long)server->wal->records, ( unsigned long long)server->wal->bytes,
+                ( unsigned long long)server->wal->syncs,
+                ( server->wal->syncs > 0) ? ( double)server->wal->synced / server->wal->syncs : 0.0,
+                ( unsigned long long)server->wal->batch_max,
+                ( server->wal->syncs > 0) ? ( double)server->wal->sync_ns / server->wal->syncs / 1000 : 0.0,
+                ( unsigned long long)server->wal->segments, ( unsigned long long)server->wal->stalls, server->wal->wait_num);
+    }
+    if( server->flight != NULL){
+        len += snprintf( &body[ len], cap - len, " flight_events=%llu", ( unsigned long long)server->flight->head);
+    }
+    if( server->blob != NULL){
+        len += snprintf( &body[ len], cap - len, " blob_open=%d blob_hits=%llu blob_opens=%llu blob_misses=%llu blob_bytes=%llu",
+                server->blob->num, ( unsigned long long)server->blob->hits, ( unsigned long long)server->blob->opens,
+                ( unsigned long long)server->blob->misses, ( unsigned long long)server->blob->bytes);
+    }
+    if( server->pubsub != NULL){
+        len += snprintf( &body[ len], cap - len,
+                " pubsub_topics=%d pubsub_subs=%d pubsub_publishes=%llu pubsub_deliveries=%llu pubsub_sent=%llu pubsub_writes=%llu"
+                " pubsub_queued=%llu pubsub_drops=%llu pubsub_slow_closes=%llu",
+                server->pubsub->topic_num, server->pubsub->sub_num, ( unsigned long long)server->pubsub->publishes,
+                ( unsigned long long)server->pubsub->deliveries, ( unsigned long long)server->pubsub->sent,
+                ( unsigned long long)server->pubsub->writes, ( unsigned long long)server->pubsub->queued,
+                ( unsigned long long)server->pubsub->drops, ( unsigned long long)server->pubsub->slow_closes);
+    }
+    if( server->pool != NULL){
+        len += snprintf( &body[ len], cap - len, " workers=%d worker_queue_full=%llu", server->pool->num,
+                ( unsigned long long)server->pool->queue_full);
+        // worker 가 16 개여도 버퍼를 넘지 않도록 남은 공간이 있을 때만 붙인다
+        for( i = 0; ( i < server->pool->num) && ( len < cap); i++){
+            worker = server->pool->workers[ i];
+            // 다른 worker 의 값은 그 worker 만 바꾸므로 atomic 으로 읽기만 한다
+            peer = ( server_t*)__atomic_load_n( &worker->server, __ATOMIC_ACQUIRE);
+            len += snprintf( &body[ len], cap - len, " w%d_conns=%d w%d_dispatched=%llu w%d_requests=%llu",
+                    i, __atomic_load_n( &worker->conns, __ATOMIC_RELAXED),
+                    i, ( unsigned long long)__atomic_load_n( &worker->dispatched, __ATOMIC_RELAXED),
+                    i, ( peer != NULL) ? ( unsigned long long)__atomic_load_n( &peer->requests, __ATOMIC_RELAXED) : 0ULL);
+        }
+    }
+    if( server->udp != NULL){
+        len += snprintf( &body[ len], cap - len,
+                " udp_datagrams=%llu udp_recv_calls=%llu udp_sent=%llu udp_send_calls=%llu udp_malformed=%llu udp_send_drops=%llu",
+                ( unsigned long long)server->udp->recv_datagrams, ( unsigned long long)server->udp->recv_calls,
+                ( unsigned long long)server->udp->sent_datagrams, ( unsigned long long)server->udp->send_calls,
+                ( unsigned long long)server->udp->malformed, ( unsigned long long)server->udp->send_drops);
+    }
+    // 잘렸으면 snprintf 는 쓰려던 길이를 돌려준다
+    return ( len < cap) ? len : cap - 1;
+}
+
+/**
+ * @fn static int server_stats_reply( server_t *server, transc_t *transc)
+ * @brief 통계 요청(KMP_CODE_STATS)에 "key=value ..." 바디로 응답하는 함수
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server 통계를 가지고 있는 server 객체
+ * @param transc 요청을 받은 연결
+ */
+static int server_stats_reply( server_t *server, transc_t *transc){
+    char frame[ MSG_HEADER_LEN + BUF_MAX_LEN];
+    int len;
+
+    len = server_stats_format( server, &frame[ MSG_HEADER_LEN], BUF_MAX_LEN);
+    memcpy( frame, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+    ( ( kmp_hdr_t*)frame)->length = MSG_HEADER_LEN + len;
+    server_set_reply( transc, frame, MSG_HEADER_LEN + len);
+    return server_send_reply( server, transc);
+}
+
+/**
+ * @fn static int server_flight_reply( server_t *server, transc_t *transc)
+ * @brief KMP_CODE_FLIGHT 요청에 모든 event loop 의 flight recorder 를 dump 파일에 쓰고 경로와 event 수로 응답하는 함수
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server server 객체
+ * @param transc 요청을 받은 연결 (바디가 10진수면 그 fd 의 event 만 쓴다)
+ */
+static int server_flight_reply( server_t *server, transc_t *transc){
+    char frame[ MSG_HEADER_LEN + BUF_MAX_LEN];
+    char filter[ 16];
+    int fd_filter = FLIGHT_FD_ALL;
+    int len, num;
+
+    len = transc->length - MSG_HEADER_LEN;
+    len = ( len < ( int)sizeof( filter) - 1) ? len : ( int)sizeof( filter) - 1;
+    memcpy( filter, transc->buf->read_body_buf, len);
+    filter[ len] = '\0';
+    if( ( filter[ 0] >= '0') && ( filter[ 0] <= '9')){
+        fd_filter = atoi( filter);
+    }
+
+    num = ( server->flight != NULL) ? flight_dump_all( fd_filter) : NOT_EXIST;
+    len = snprintf( &frame[ MSG_HEADER_LEN], BUF_MAX_LEN, "flight_path=%s flight_dumped=%d",
+            ( server->flight != NULL) ? flight_get_path() : "none", num);
+    memcpy( frame, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+    ( ( kmp_hdr_t*)frame)->length = MSG_HEADER_LEN + len;
+    server_set_reply( transc, frame, MSG_HEADER_LEN + len);
+    return server_send_reply( server, transc);
+}
+
+/**
+ * @fn static int server_blob_reply( server_t *server, transc_t *transc)
+ * @brief KMP_CODE_BLOB 요청에 blob 디렉토리의 파일을 바디로 응답하는 함수
+ * 헤더만 write 버퍼에 만들고 바디는 열어 둔 파일에서 sendfile 로 보내므로 응답 크기가 송신 버퍼 크기에 묶이지 않는다
+ * 이름이 없거나 보낼 수 없는 파일이면 헤더만 있는 KMP_CODE_UNAVAILABLE 로 응답한다
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server blob 목록을 가지고 있는 server 객체
+ * @param transc 요청을 받은 연결 (바디가 파일 이름)
+ */
+static int server_blob_reply( server_t *server, transc_t *transc){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)transc->buf->write_hdr_buf;
+    uint32_t crc;
+
+    memcpy( hdr, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+    if( ( transc->blob = blob_get( server->blob, transc->buf->read_body_buf, transc->length - MSG_HEADER_LEN)) == NULL){
+        hdr->code = KMP_CODE_UNAVAILABLE;
+        transc->length = MSG_HEADER_LEN;
+    }
+    else if( ( transc->is_crc == 1) && ( blob_crc( transc->blob, &crc) < NORMAL)){
+        // trailer 를 만들 수 없으면 검사하지 않은 내용을 보내지 않는다
+        blob_put( transc->blob);
+        transc->blob = NULL;
+        hdr->code = KMP_CODE_UNAVAILABLE;
+        transc->length = MSG_HEADER_LEN;
+    }
+    else{
+        transc->length = MSG_HEADER_LEN + transc->blob->size;
+        server->blob->bytes += transc->blob->size;
+    }
+    hdr->length = transc->length;
+    transc->is_reply_ready = 1;
+    return server_send_reply( server, transc);
+}
+
+/**
+ * @fn static int server_reject_reply( server_t *server, transc_t *transc, uint32_t code)
+ * @brief 처리하지 않기로 한 요청에 바디를 처리하지 않고 헤더만 있는 응답을 보내는 함수
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server server 객체
+ * @param transc 요청을 받은 연결
+ * @param code 응답 코드 (admission control 이 거절하거나 log 의 다음 segment 가 없으면 KMP_CODE_OVERLOAD, deadline 이 지났으면 KMP_CODE_EXPIRED)
+ */
+static int server_reject_reply( server_t *server, transc_t *transc, uint32_t code){
+    char frame[ MSG_HEADER_LEN];
+
+    memcpy( frame, transc->buf->read_hdr_buf, MSG_HEADER_LEN);
+    ( ( kmp_hdr_t*)frame)->code = code;
+    ( ( kmp_hdr_t*)frame)->length = MSG_HEADER_LEN;
+    server_set_reply( transc, frame, MSG_HEADER_LEN);
+    return server_send_reply( server, transc);
+}
+
+/**
+ * @fn static int server_stream_recv( server_t *server, transc_t *transc, uint64_t *val)
+ * @brief 받은 메시지를 연결의 stream 목록에 넘기는 함수 (stream 목록은 첫 chunk 를 받을 때 만든다)
+ * @return STREAM_RV, 실패하면 NORMAL 미만 (stream 이 너무 많거나 창을 어긴 연결은 닫는다)
+ * @param server server 객체
+ * @param transc 메시지를 받은 연결
+ * @param val stream_rx_recv 참고
+ */
+static int server_stream_recv( server_t *server, transc_t *transc, uint64_t *val){
+    int rv;
+
+    if( ( transc->streams == NULL) && ( ( transc->streams = stream_tab_init()) == NULL)){
+        return OBJECT_ERR;
+    }
+    if( ( rv = stream_rx_recv( transc->streams, ( kmp_hdr_t*)transc->buf->read_hdr_buf, val)) < NORMAL){
+        server->stream_errors++;
+    }
+    return rv;
+}
+
+/**
+ * @fn static int server_stream_reply( server_t *server, transc_t *transc, int result, uint64_t val)
+ * @brief stream chunk 를 처리한 결과에 따라 응답하는 함수
+ * 보통 chunk 는 응답 없이 다음 메시지를 받고, 창의 절반 이상을 받았으면 KMP_CODE_CREDIT 을,
+ * 마지막 chunk 면 받은 전체 바이트 수를 보낸다 (chunk 의 바디는 받는 즉시 처리가 끝나므로 바로 창을 돌려준다)
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server server 객체
+ * @param transc chunk 를 받은 연결
+ * @param result server_stream_recv 결과
+ * @param val server_stream_recv 가 돌려준 값
+ */
+static int server_stream_reply( server_t *server, transc_t *transc, int result, uint64_t val){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)transc->buf->read_hdr_buf;
+    char frame[ MSG_HEADER_LEN + sizeof( uint64_t)];
+
+    server->stream_chunks++;
+    if( result == STREAM_CHUNK){
+        server_transc_clear( transc);
+        return NORMAL;
+    }
+    if( result == STREAM_CREDIT){
+        server->stream_credits++;
+        server_set_reply( transc, frame, stream_make_credit( frame, hdr, ( uint32_t)val));
+        return server_send_reply( server, transc);
+    }
+    server->stream_ends++;
+    server->requests++;
+    server_set_reply( transc, frame, stream_make_end( frame, hdr, val));
+    return server_send_reply( server, transc);
+}
+
+/**
+ * @fn static void server_simulate_work( int work_us)
+ * @brief 부하 시험에서 요청 처리 비용을 흉내 내기 위해 work_us 동안 CPU 를 쓰는 함수 (-W)
+ * @return void
+ */
+static void server_simulate_work( int work_us){
+    uint64_t end = admit_now_us() + work_us;
+
+    while( admit_now_us() < end){
+        __asm__ __volatile__( "" ::: "memory");
+    }
+}
+
+/**
+ * @fn static int server_crc_check( server_t *server, transc_t *transc)
+ * @brief 다 받은 메시지의 CRC32C trailer 를 받으면서 계산한 값과 비교하고 떼어내는 함수
+ * 처리하는 쪽은 trailer 가 없는 보통 메시지를 본다 (is_crc 는 남겨서 응답에 다시 붙인다)
+ * @return 맞으면 NORMAL, 다르면 BUF_ERR (길이가 깨졌으면 다음 메시지 경계도 믿을 수 없으므로 연결을 닫는다)
+ * @param server server 객체
+ * @param transc 메시지를 받은 연결
+ */
+static int server_crc_check( server_t *server, transc_t *transc){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)transc->buf->read_hdr_buf;
+    int body_len = transc->length - MSG_HEADER_LEN - KMP_CRC_LEN;
+    uint32_t crc;
+
+    memcpy( &crc, &transc->buf->read_body_buf[ body_len], KMP_CRC_LEN);
+    if( crc != transc->crc){
+        server->crc_errors++;
+        printf("    | ! Server : CRC32C mismatch (recv:%08x, calc:%08x) (fd:%d)\n", crc, transc->crc, transc->fd);
+        return BUF_ERR;
+    }
+    server->crc_frames++;
+    hdr->flag &= ~KMP_FLAG_CRC;
+    hdr->length = transc->length = MSG_HEADER_LEN + body_len;
+    return NORMAL;
+}
+
+/**
+ * @fn static void server_deadline_take( server_t *server, transc_t *transc)
+ * @brief 다 받은 메시지의 deadline extension 을 transc->deadline_us 로 옮기고 떼어내는 함수 (CRC32C trailer 를 뗀 뒤에 부른다)
+ * 처리하는 쪽은 extension 이 없는 보통 메시지를 보고, 응답에도 붙이지 않는다
+ * @return void
+ * @param server server 객체
+ * @param transc 메시지를 받은 연결
+ */
+static void server_deadline_take( server_t *server, transc_t *transc){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)transc->buf->read_hdr_buf;
+    int body_len = transc->length - MSG_HEADER_LEN - KMP_DEADLINE_LEN;
+
+    server->deadline_frames++;
+    memcpy( &transc->deadline_us, transc->buf->read_body_buf, KMP_DEADLINE_LEN);
+    memmove( transc->buf->read_body_buf, &transc->buf->read_body_buf[ KMP_DEADLINE_LEN], body_len);
+    hdr->flag &= ~KMP_FLAG_DEADLINE;
+    hdr->length = transc->length = MSG_HEADER_LEN + body_len;
+}
+
+/**
+ * @fn static void server_deadline_peek( transc_t *transc)
+ * @brief 바디 맨 앞의 deadline extension 을 받았으면 바로 읽고, 이미 지났으면 남은 바디를 버리도록 표시하는 함수
+ * 지난 요청의 바디를 버퍼에 담고 CRC32C 를 계산하는 비용을 아낀다. stream 의 chunk 는 버리면 stream 이 깨지므로 끝까지 받는다
+ * @return void
+ * @param transc 메시지를 받고 있는 연결
+ */
+static void server_deadline_peek( transc_t *transc){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)transc->buf->read_hdr_buf;
+
+    if( ( transc->is_recv_header == 0) || ( ( hdr->flag & KMP_FLAG_DEADLINE) == 0) || ( transc->deadline_us != 0)
+            || ( transc->recv_bytes < MSG_HEADER_LEN + KMP_DEADLINE_LEN)){
+        return;
+    }
+    memcpy( &transc->deadline_us, transc->buf->read_body_buf, KMP_DEADLINE_LEN);
+    if( ( stream_rx_is_chunk( transc->streams, hdr) == 0) && ( kmp_now_us() > transc->deadline_us)){
+        transc->is_discard = 1;
+    }
+}
+
+/**
+ * @fn static int server_recv_frame( server_t *server, transc_t *transc)
+ * @brief client 연결에서 메시지를 받고, 다 받으면 run queue 에 넣는 함수 (처리는 server_run_drain 에서 한다)
+ * 보내다 만 응답이 있으면 이어서 보낸다
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server 서버의 정보를 담고 있는 server_t 구조체 객체
+ * @param transc 이벤트가 발생한 client 연결
+ */
+static int server_recv_frame( server_t* server, transc_t *transc){
+    int fd = transc->fd;
+    int read_rv = 0;
+
+    if( transc->is_wait_reply || transc->is_queued){
+        return NORMAL;
+    }
+
+    if( ( transc->is_recv_header == 1) && ( transc->is_recv_body == 1)){
+        return server_send_reply( server, transc);
+    }
+
+    if( ( transc->buf == NULL) && ( server_buf_get( server, transc) < NORMAL)){
+        return OBJECT_ERR;
+    }
+    read_rv = server_recv_data( transc, fd);
+    flight_record( server->flight, FLIGHT_EV_READ, fd, transc->conn_id, server_flight_state( transc), read_rv,
+            ( ( read_rv == ERRNO_EAGAIN) || ( read_rv == NEGATIVE_BYTE) || ( read_rv == INTERRUPT)) ? errno : 0, transc->recv_bytes);
+    if( read_rv == INTERRUPT){
+        return NORMAL;
+    }
+    if( ( read_rv == ERRNO_EAGAIN) && ( transc->recv_bytes == 0) && ( transc->is_recv_header == 0)){
+        // 메시지 경계에서 더 읽을 것이 없으면 idle 이므로 버퍼를 돌려준다 (다음 메시지가 오면 다시 빌린다)
+        server_buf_put( server, transc);
+        return NORMAL;
+    }
+    if( read_rv < NORMAL){
+        printf("    | ! Server : disconnected (fd:%d)\n", fd);
+        return read_rv;
+    }
+    server_deadline_peek( transc);
+    if( read_rv == RECV_COMPLETE){
+        flight_record( server->flight, FLIGHT_EV_FRAME, fd, transc->conn_id, server_flight_state( transc), transc->length, 0,
+                ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code);
+        if( transc->is_discard == 1){
+            // 바디는 버렸으므로 trailer 는 검사하지 않는다. 응답에는 extension 없이 (요청에 있었으면) trailer 만 붙인다
+            ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->flag &= ~( KMP_FLAG_DEADLINE | KMP_FLAG_CRC);
+            server->deadline_frames++;
+            server->expired_recv++;
+            return server_reject_reply( server, transc, KMP_CODE_EXPIRED);
+        }
+        if( ( transc->is_crc == 1) && ( ( read_rv = server_crc_check( server, transc)) < NORMAL)){
+            return read_rv;
+        }
+        if( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->flag & KMP_FLAG_DEADLINE){
+            server_deadline_take( server, transc);
+        }
+        if( server->capture != NULL){
+            capture_record( server->capture, transc->conn_id, transc->buf->read_hdr_buf, MSG_HEADER_LEN,
+                    transc->buf->read_body_buf, transc->length - MSG_HEADER_LEN);
+        }
+        // 바디를 받는 동안 지난 요청도 run queue 에 넣지 않고 바로 답한다 (stream chunk 는 stream 이 깨지므로 처리한다)
+        if( ( transc->deadline_us != 0) && ( stream_rx_is_chunk( transc->streams, ( kmp_hdr_t*)transc->buf->read_hdr_buf) == 0)
+                && ( kmp_now_us() > transc->deadline_us)){
+            server->expired_recv++;
+            return server_reject_reply( server, transc, KMP_CODE_EXPIRED);
+        }
+        server_run_push( server, transc);
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static int server_wal_append( server_t *server, transc_t *transc)
+ * @brief durable code 의 메시지를 write-ahead log 에 쓰고 내려갈 때까지 응답을 미루는 함수
+ * 응답을 기다리는 동안 이 연결의 다음 요청은 읽지 않는다 (응답 순서가 record 순서와 같다)
+ * segment 가 찼는데 sync thread 가 다음 segment 를 아직 준비하지 못했으면 쓰지 않고 KMP_CODE_OVERLOAD 로 거절한다
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server wal 을 가지고 있는 server 객체
+ * @param transc 메시지를 받은 연결
+ */
+static int server_wal_append( server_t *server, transc_t *transc){
+    int rv;
+
+    if( ( rv = wal_append( server->wal, transc->buf->read_hdr_buf, MSG_HEADER_LEN, transc->buf->read_body_buf,
+                    transc->length - MSG_HEADER_LEN, transc)) < NORMAL){
+        return rv;
+    }
+    if( rv == ERRNO_EAGAIN){
+        return server_reject_reply( server, transc, KMP_CODE_OVERLOAD);
+    }
+    transc->is_wait_reply = 1;
+    return server_epoll_mod( server, transc, 0);
+}
+
+/**
+ * @fn static void server_wal_done( server_t *server)
+ * @brief sync thread 가 record 를 내렸을 때 기다리던 연결에 응답을 보내는 함수 (echo 응답이 곧 ack 다)
+ * fdatasync 가 실패했으면 durable 하다고 답할 수 없으므로 기다리던 연결을 모두 닫는다
+ * @return void
+ * @param server wal 을 가지고 있는 server 객체
+ */
+static void server_wal_done( server_t *server){
+    transc_t *transc;
+    uint64_t synced;
+    int is_failed;
+
+    synced = wal_done( server->wal, &is_failed);
+    if( is_failed){
+        synced = UINT64_MAX;
+    }
+    while( ( transc = ( transc_t*)wal_pop_done( server->wal, synced)) != NULL){
+        transc->is_wait_reply = 0;
+        if( is_failed || ( server_send_reply( server, transc) < NORMAL)){
+            server_transc_remove( server, transc);
+        }
+    }
+}
+
+/**
+ * @fn static int server_pubsub_request( server_t *server, transc_t *transc)
+ * @brief 구독 / 구독 해지 / 발행 요청을 처리하는 함수
+ * 발행 메시지는 한 번만 복사해서 구독자 queue 에 참조로 넣고, 실제로 보내는 것은 loop 끝의 server_pubsub_flush 다
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server topic 목록을 가지고 있는 server 객체
+ * @param transc 요청을 받은 연결
+ */
+static int server_pubsub_request( server_t *server, transc_t *transc){
+    kmp_hdr_t *hdr = ( kmp_hdr_t*)transc->buf->read_hdr_buf;
+    int body_len = transc->length - MSG_HEADER_LEN;
+    char frame[ MSG_HEADER_LEN + sizeof( uint32_t)];
+    uint32_t num;
+    int rv;
+
+    if( hdr->code == KMP_CODE_PUBLISH){
+        if( ( rv = pubsub_publish( server->pubsub, transc->buf->read_hdr_buf, MSG_HEADER_LEN, transc->buf->read_body_buf, body_len)) < NORMAL){
+            return rv;
+        }
+        num = rv;
+        memcpy( frame, hdr, MSG_HEADER_LEN);
+        ( ( kmp_hdr_t*)frame)->length = sizeof( frame);
+        memcpy( &frame[ MSG_HEADER_LEN], &num, sizeof( num));
+        server_set_reply( transc, frame, sizeof( frame));
+        return server_send_reply( server, transc);
+    }
+
+    if( ( transc->sub == NULL) && ( ( transc->sub = pubsub_sub_init( server->pubsub, transc)) == NULL)){
+        return OBJECT_ERR;
+    }
+    // 바디는 비울 수 없으므로 topic prefix 는 첫 NUL 앞까지다
+    body_len = strnlen( transc->buf->read_body_buf, body_len);
+    if( hdr->code == KMP_CODE_SUBSCRIBE){
+        if( ( rv = pubsub_subscribe( server->pubsub, transc->sub, hdr->app_id, transc->buf->read_body_buf, body_len)) < NORMAL){
+            printf("    | ! Server : Failed to subscribe (topics:%d, prefix:%d bytes) (fd:%d)\n", transc->sub->topic_num, body_len, transc->fd);
+            return rv;
+        }
+    }
+    else{
+        pubsub_unsubscribe( server->pubsub, transc->sub, hdr->app_id, transc->buf->read_body_buf, body_len);
+    }
+    return server_send_reply( server, transc);
+}
+
+/**
+ * @fn static void server_pubsub_flush( server_t *server)
+ * @brief 이번 loop 에서 발행 메시지가 쌓인 구독자마다 queue 를 writev 로 보내는 함수
+ * 여러 발행이 한 loop 에 들어오면 구독자마다 writev 한 번으로 같이 나간다. 다 못 보낸 연결은 EPOLLOUT 을 기다리고,
+ * 응답을 보내는 중인 연결은 응답을 다 보낸 뒤 server_send_reply 가 다시 넣는다
+ * PUBSUB_POLICY_CLOSE 에서 queue 가 넘친 연결은 여기서 닫는다
+ * @return void
+ * @param server topic 목록을 가지고 있는 server 객체
+ */
+static void server_pubsub_flush( server_t *server){
+    pubsub_sub_t *sub;
+    transc_t *transc;
+    int rv;
+
+    while( ( sub = pubsub_ready_pop( server->pubsub)) != NULL){
+        transc = ( transc_t*)sub->owner;
+        if( sub->is_slow){
+            server->pubsub->slow_closes++;
+            printf("    | ! Server : subscriber too slow, closing (queue:%d) (fd:%d)\n", sub->num, transc->fd);
+            server_transc_remove( server, transc);
+            continue;
+        }
+        if( transc->send_bytes > 0){
+            continue;
+        }
+        if( ( rv = pubsub_sub_write( server->pubsub, sub, transc->fd)) < NORMAL){
+            server_transc_remove( server, transc);
+            continue;
+        }
+        // 남은 메시지나 보내지 못한 응답이 있으면 소켓이 비었을 때 깨어난다
+        if( server_epoll_mod( server, transc, ( ( rv > 0) || ( transc->is_recv_body == 1)) ? EPOLLIN | EPOLLOUT : EPOLLIN) < NORMAL){
+            server_transc_remove( server, transc);
+        }
+    }
+}
+
+/**
+ * @fn static int server_process_data( server_t *server, transc_t *transc)
+ * @brief 다 받은 메시지를 처리하고 응답을 보내는 함수
+ * @return 열거형 참고 (NORMAL 미만이면 연결을 닫아야 한다)
+ * @param server 서버의 정보를 담고 있는 server_t 구조체 객체
+ * @param transc run queue 에서 꺼낸 client 연결
+ */
+static int server_process_data( server_t* server, transc_t *transc){
+    uint64_t val;
+    int rv;
+
+    if( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code == KMP_CODE_SHM_OPEN){
+        return server_shm_open( server, transc);
+    }
+    if( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code == KMP_CODE_STATS){
+        return server_stats_reply( server, transc);
+    }
+    if( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code == KMP_CODE_FLIGHT){
+        return server_flight_reply( server, transc);
+    }
+    // stream 은 이 server 에서 끝난다 (chunk 마다 거절하거나 backend 로 넘기면 stream 이 깨진다)
+    if( stream_rx_is_chunk( transc->streams, ( kmp_hdr_t*)transc->buf->read_hdr_buf)){
+        if( ( rv = server_stream_recv( server, transc, &val)) < NORMAL){
+            return rv;
+        }
+        if( rv != STREAM_MSG){
+            return server_stream_reply( server, transc, rv, val);
+        }
+    }
+    // run queue 에서 기다리는 동안 deadline 이 지났으면 처리하지 않는다 (client 는 이미 포기했다)
+    if( ( transc->deadline_us != 0) && ( kmp_now_us() > transc->deadline_us)){
+        server->expired_run++;
+        return server_reject_reply( server, transc, KMP_CODE_EXPIRED);
+    }
+    // 거절은 헤더만 보고 정한다 (바디는 stream 에서 비우기 위해 읽었을 뿐 처리하지 않는다)
+    if( ( server->admit != NULL) && ( admit_check( server->admit, ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->app_id,
+                    ( server->route != NULL) ? server->route->pending_num : 0) != ADMIT_OK)){
+        return server_reject_reply( server, transc, KMP_CODE_OVERLOAD);
+    }
+    server->requests++;
+
+    if( ( server->blob != NULL) && ( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code == KMP_CODE_BLOB)){
+        return server_blob_reply( server, transc);
+    }
+    if( ( server->pubsub != NULL) && ( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code >= KMP_CODE_SUBSCRIBE)
+            && ( ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code <= KMP_CODE_PUBLISH)){
+        return server_pubsub_request( server, transc);
+    }
+    if( server->route != NULL){
+        return server_route_forward( server, transc);
+    }
+    if( server->work_us > 0){
+        server_simulate_work( server->work_us);
+    }
+    if( ( server->wal != NULL) && wal_is_durable( server->wal, ( ( kmp_hdr_t*)transc->buf->read_hdr_buf)->code)){
+        return server_wal_append( server, transc);
+    }
+
+    return server_send_reply( server, transc);
+}
+
+/**
+ * @fn static void server_run_drain( server_t *server)
+ * @brief epoll 이벤트를 모두 받은 뒤 run queue 의 메시지를 처리하는 함수
+ * high run queue 를 항상 먼저 비우므로 제어 메시지는 bulk 메시지 뒤에서 기다리지 않는다
+ * 응답을 다 보낸 연결은 budget 이 남아 있으면 다음 메시지를 받아서 run queue 맨 뒤로 다시 들어가고,
+ * budget 을 다 쓰면 남은 메시지는 소켓에 둔 채 다음 loop 로 넘긴다 (level-triggered 라 다시 깨어난다)
+ * @return void
+ * @param server run queue 를 가지고 있는 server 객체
+ */
+static void server_run_drain( server_t *server){
+    transc_t *transc;
+    int rv;
+
+    while( ( transc = server_run_pop( server)) != NULL){
+        if( transc->prio == SERVER_PRIO_HIGH){
+            server->prio_high++;
+        }
+        if( ( rv = server_process_data( server, transc)) < NORMAL){
+            server_transc_remove( server, transc);
+            continue;
+        }
+
+        // upstream 응답을 기다리거나 응답을 보내는 중이거나 shm 으로 옮겨간 연결
+        if( ( transc->is_recv_header == 1) || ( transc->shm != NULL)){
+            continue;
+        }
+        if( --transc->budget == 0){
+            server->budget_exhausted++;
+            continue;
+        }
+        if( ( rv = server_recv_frame( server, transc)) < NORMAL){
+            server_transc_remove( server, transc);
+        }
+    }
+}
+
+/**
+ * @fn static void server_udp_process( server_t *server)
+ * @brief UDP 소켓에 도착한 datagram 을 recvmmsg 한 번으로 받아 처리하고 응답을 sendmmsg 로 모아 보내는 함수
+ * datagram 하나가 완결된 메시지이므로 연결 상태나 run queue 없이 TCP 와 같은 순서(통계 / admission control / 처리)로 바로 처리한다
+ * KMP_FLAG_NO_REPLY 가 있는 메시지는 응답하지 않는다. 남은 datagram 은 level-triggered 라 다음 loop 에서 받는다
+ * @return void
+ * @param server UDP 소켓을 가지고 있는 server 객체
+ */
+static void server_udp_process( server_t *server){
+    char body[ BUF_MAX_LEN];
+    udp_t *udp = server->udp;
+    kmp_hdr_t *hdr;
+    uint64_t deadline_us;
+    int i, n, len, is_crc;
+
+    if( ( n = udp_recv( udp)) <= 0){
+        return;
+    }
+    for( i = 0; i < n; i++){
+        if( ( len = udp_frame_check( udp, i)) < NORMAL){
+            continue;
+        }
+        hdr = ( kmp_hdr_t*)udp->rbufs[ i];
+        is_crc = hdr->flag & KMP_FLAG_CRC;
+        if( is_crc){
+            if( ( len = crc32c_frame_check( udp->rbufs[ i], len)) < NORMAL){
+                server->crc_errors++;
+                udp->malformed++;
+                continue;
+            }
+            server->crc_frames++;
+        }
+        if( hdr->flag & KMP_FLAG_DEADLINE){
+            if( ( len = kmp_take_deadline( udp->rbufs[ i], len, &deadline_us)) < NORMAL){
+                udp->malformed++;
+                continue;
+            }
+            server->deadline_frames++;
+        }
+        else{
+            deadline_us = 0;
+        }
+        if( server->capture != NULL){
+            // datagram 은 연결이 없으므로 연결 id 0 으로 남긴다
+            capture_record( server->capture, 0, udp->rbufs[ i], MSG_HEADER_LEN, &udp->rbufs[ i][ MSG_HEADER_LEN], len - MSG_HEADER_LEN);
+        }
+
+        if( hdr->code == KMP_CODE_STATS){
+            len = MSG_HEADER_LEN + server_stats_format( server, body, sizeof( body));
+            memcpy( &udp->rbufs[ i][ MSG_HEADER_LEN], body, len - MSG_HEADER_LEN);
+            hdr->length = len;
+        }
+        else if( hdr->code == KMP_CODE_SHM_OPEN){
+            // shared memory 협상은 UDS 연결에서만 한다
+            udp->malformed++;
+            continue;
+        }
+        else if( ( deadline_us != 0) && ( kmp_now_us() > deadline_us)){
+            server->expired_recv++;
+            hdr->code = KMP_CODE_EXPIRED;
+            hdr->length = len = MSG_HEADER_LEN;
+        }
+        else if( ( server->admit != NULL) && ( admit_check( server->admit, hdr->app_id, 0) != ADMIT_OK)){
+            hdr->code = KMP_CODE_OVERLOAD;
+            hdr->length = len = MSG_HEADER_LEN;
+        }
+        else{
+            server->requests++;
+            if( server->work_us > 0){
+                server_simulate_work( server->work_us);
+            }
+        }
+
+        if( ( hdr->flag & KMP_FLAG_NO_REPLY) == 0){
+            if( is_crc){
+                len = crc32c_frame_seal( udp->rbufs[ i], len, UDP_FRAME_MAX);
+            }
+            udp_send( udp, udp->rbufs[ i], len, &udp->raddrs[ i]);
+        }
+    }
+    udp_flush( udp);
+}
+
+/// @struct server_coro_ctx_t
+/// @brief coroutine echo handler가 yield 사이에 유지하는 상태 (coro_t 의 locals 에 들어간다)
+typedef struct server_coro_ctx_s server_coro_ctx_t;
+struct server_coro_ctx_s{
+    /// 읽은 메시지 길이
+    int len;
+    /// 마지막 awaitable 결과
+    int rv;
+    /// capture 파일에 남기는 연결 id
+    uint32_t conn_id;
+    /// 수신한 메시지 (그대로 돌려보낸다)
+    char frame[ MSG_HEADER_LEN + BUF_MAX_LEN];
+};
+
+/**
+ * @fn static int server_coro_echo( coro_t *co)
+ * @brief coroutine 모드(-C)의 연결 handler. server_process_data() 의 상태 기계와 같은 echo 를 순서대로 작성한다
+ * @return CORO_WAIT 이면 멈춤, 그 외에는 연결 종료
+ * @param co 연결 하나를 맡은 coroutine
+ */
+static int server_coro_echo( coro_t *co){
+    server_coro_ctx_t *ctx = CORO_LOCALS( co, server_coro_ctx_t);
+    server_t *server = ( server_t*)co->arg;
+
+    CORO_BEGIN( co);
+    ctx->conn_id = ++server->conn_seq;
+    while( 1){
+        CORO_AWAIT( co, ctx->len, coro_read_frame( co, ctx->frame, sizeof( ctx->frame)));
+        if( ctx->len < NORMAL){
+            printf("    | ! Server : disconnected (fd:%d)\n", co->fd);
+            CORO_EXIT( co, ctx->len);
+        }
+        if( server->capture != NULL){
+            capture_record( server->capture, ctx->conn_id, ctx->frame, MSG_HEADER_LEN, &ctx->frame[ MSG_HEADER_LEN], ctx->len - MSG_HEADER_LEN);
+        }
+        server->requests++;
+
+        CORO_AWAIT( co, ctx->rv, coro_write_frame( co, ctx->frame, ctx->len));
+        if( ctx->rv < NORMAL){
+            CORO_EXIT( co, ctx->rv);
+        }
+    }
+    CORO_END( co);
+}
+
+/**
+ * @fn static int server_add_client( server_t *server, int client_fd, int is_unix, uint32_t conn_id)
+ * @brief 연결된 client 소켓을 연결 table 과 epoll 에 등록하는 함수
+ * accept 한 연결과 이전 프로세스에게서 넘겨 받은 연결이 같은 경로로 들어온다
+ * @return 열거형 참고 (실패하면 소켓은 닫혀 있다)
+ * @param server 연결을 관리하는 server 객체
+ * @param client_fd client file descriptor
+ * @param is_unix AF_UNIX listener로 들어온 연결인지 여부
+ * @param conn_id 연결 id (0 이면 새로 발급한다)
+ */
+static int server_add_client( server_t *server, int client_fd, int is_unix, uint32_t conn_id){
+    struct epoll_event client_event;
+    transc_t *transc;
+    int rv;
+
+    rv = server_set_fd_nonblock( client_fd);
+    if( rv < NORMAL){
+        close( client_fd);
+        return FD_ERR;
+    }
+
+    if( server->coro != NULL){
+        if( is_unix == 0){
+            int nodelay = 1;
+            setsockopt( client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof( nodelay));
+        }
+        // 연결은 coroutine이 소유하고, 끝나면 coroutine이 닫는다
+        coro_spawn( server->coro, client_fd, server_coro_echo, server);
+        return NORMAL;
+    }
+
+    if( ( transc = server_transc_get( server, client_fd)) == NULL){
+        printf("	| ! Server : Failed to get connection slot (fd:%d)\n", client_fd);
+        close( client_fd);
+        return OBJECT_ERR;
+    }
+    // 송수신 버퍼는 첫 메시지를 받기 시작할 때 빌린다
+    transc->buf = NULL;
+    transc->reply_val = NULL;
+    transc->blob = NULL;
+    transc->cache_wait = NULL;
+    server_transc_clear( transc);
+    transc->type = SERVER_EV_CLIENT;
+    transc->fd = client_fd;
+    transc->is_unix = is_unix;
+    transc->events = EPOLLIN;
+
+    if( transc->is_unix == 0){
+        // 헤더와 바디를 나눠서 write 하므로 Nagle + delayed ACK로 응답이 지연되지 않게 한다
+        int nodelay = 1;
+        setsockopt( client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof( nodelay));
+    }
+    transc->shm = NULL;
+    transc->proxy = NULL;
+    transc->streams = NULL;
+    transc->io = NULL;
+    transc->sub = NULL;
+    transc->route_hop_id = 0;
+    transc->is_queued = 0;
+    transc->budget = 0;
+    transc->conn_id = ( conn_id != 0) ? conn_id : ++server->conn_seq;
+
+    if( server->is_proxy){
+        // proxy 모드에서는 client마다 upstream 연결을 하나씩 맺는다
+        if( ( transc->proxy = proxy_init( client_fd, &server->upstream_addr)) == NULL){
+            close( client_fd);
+            transc->fd = -1;
+            return NORMAL;
+        }
+        transc->events = transc->proxy->client_events = proxy_get_events( transc->proxy, client_fd);
+        transc->proxy->upstream_events = proxy_get_events( transc->proxy, transc->proxy->upstream_fd);
+
+        transc->sub_ev.type = SERVER_EV_UPSTREAM;
+        transc->sub_ev.fd = transc->proxy->upstream_fd;
+        transc->sub_ev.transc = transc;
+        client_event.events = transc->proxy->upstream_events;
+        client_event.data.ptr = &transc->sub_ev;
+        if( ( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, transc->proxy->upstream_fd, &client_event)) < 0){
+            printf("	| ! Server : Failed to add epoll upstream event\n");
+            proxy_destroy( transc->proxy);
+            close( client_fd);
+            transc->fd = -1;
+            return OBJECT_ERR;
+        }
+    }
+
+    client_event.events = transc->events;
+    client_event.data.ptr = transc;
+    if( ( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, client_fd, &client_event)) < 0){
+        printf("	| ! Server : Failed to add epoll client event\n");
+        if( transc->proxy != NULL){
+            epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_DEL, transc->proxy->upstream_fd, NULL);
+            proxy_destroy( transc->proxy);
+        }
+        close( client_fd);
+        transc->fd = -1;
+        return OBJECT_ERR;
+    }
+
+    server->transc_num++;
+    flight_record( server->flight, FLIGHT_EV_ACCEPT, client_fd, transc->conn_id, 0, is_unix, 0, 0);
+    return NORMAL;
+}
+
+/**
+ * @fn static int server_accept( server_t *server, int listen_fd)
+ * @brief TCP 또는 UDS listener에서 새 연결을 받아 epoll에 등록하는 함수
+ * @return 열거형 참고
+ * @param server 연결을 관리하는 server 객체
+ * @param listen_fd 이벤트가 발생한 listener file descriptor
+ */
+static int server_accept( server_t *server, int listen_fd){
+    int rv;
+    struct sockaddr_storage client_addr;
+    socklen_t client_addr_len = sizeof( client_addr);
+
+    int client_fd = accept( listen_fd, ( struct sockaddr*)( &client_addr), &client_addr_len);
+    if( client_fd < 0){
+        if( ( errno == EAGAIN) || ( errno == EWOULDBLOCK)){
+            return NORMAL;
+        }
+        printf("	| @ Server : accept error!\n");
+        return FD_ERR;
+    }
+
+    printf("    | @ Server : accept success! (fd:%d)\n", client_fd);
+
+    if( ( ( rv = server_add_client( server, client_fd, listen_fd == server->unix_fd, 0)) == NORMAL) && ( server->worker != NULL)){
+        // SO_REUSEPORT 모드의 worker 는 연결을 직접 받는다
+        worker_conn_add( server->worker);
+    }
+    return rv;
+}
+
+/**
+ * @fn static int server_handoff_watch( server_t *server)
+ * @brief handoff 객체의 현재 fd (경로 listener 또는 상대 프로세스와의 연결) 를 epoll 에 등록하는 함수
+ * @return 정상이면 NORMAL, 실패하면 OBJECT_ERR
+ * @param server handoff 객체를 가지고 있는 server 객체
+ */
+static int server_handoff_watch( server_t *server){
+    struct epoll_event handoff_event;
+
+    handoff_event.events = EPOLLIN;
+    handoff_event.data.ptr = server->handoff;
+    if( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->handoff->fd, &handoff_event) < 0){
+        printf("	| ! Server : Failed to add epoll handoff event\n");
+        return OBJECT_ERR;
+    }
+    return NORMAL;
+}
+
+/**
+ * @fn static void server_handoff_relisten( server_t *server)
+ * @brief 연결을 다 넘겨 받았거나 넘겨 주다 실패했을 때 다음 교체를 위해 handoff 경로를 다시 여는 함수
+ * @return void
+ * @param server handoff 객체를 가지고 있는 server 객체
+ */
+static void server_handoff_relisten( server_t *server){
+    // close 하면 epoll 에서도 빠진다
+    close( server->handoff->fd);
+    server->handoff->fd = -1;
+    server->handoff->state = HANDOFF_STATE_NONE;
+    if( ( handoff_listen( server->handoff) < NORMAL) || ( server_handoff_watch( server) < NORMAL)){
+        printf("	| ! Server : hot restart is disabled (%s)\n", server->handoff->addr.sun_path);
+    }
+}
+
+/**
+ * @fn static void server_handoff_abort( server_t *server)
+ * @brief 새 프로세스가 죽거나 응답하지 않을 때 listener 를 다시 받아서 계속 서비스하는 함수
+ * 이미 넘긴 연결은 새 프로세스와 함께 사라진다
+ * @return void
+ * @param server listener 를 넘기던 server 객체
+ */
+static void server_handoff_abort( server_t *server){
+    struct epoll_event server_event;
+
+    printf("	| ! Server : hot restart aborted, serving again\n");
+    // 이미 등록되어 있으면 EEXIST 로 실패할 뿐이다
+    server_event.events = EPOLLIN;
+    server_event.data.ptr = &server->listen_ev;
+    epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->fd, &server_event);
+    if( server->unix_fd >= 0){
+        server_event.data.ptr = &server->unix_listen_ev;
+        epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->unix_fd, &server_event);
+    }
+    server_handoff_relisten( server);
+}
+
+/**
+ * @fn static void server_handoff_start( server_t *server)
+ * @brief handoff 경로로 새 프로세스가 연결하면 listener 를 넘기고 더 이상 accept 하지 않는 함수
+ * 두 프로세스가 같은 listen 소켓을 가지므로 accept 를 멈춘 뒤 들어오는 연결 요청은 backlog 에서 새 프로세스가 꺼낸다
+ * @return void
+ * @param server 실행 중인 server 객체
+ */
+static void server_handoff_start( server_t *server){
+    int fds[ 2];
+    int num = 0, rv;
+
+    if( ( rv = handoff_accept( server->handoff)) != NORMAL){
+        if( rv < NORMAL){
+            server_handoff_relisten( server);
+        }
+        return;
+    }
+    if( server_handoff_watch( server) < NORMAL){
+        server_handoff_relisten( server);
+        return;
+    }
+
+    fds[ num++] = server->fd;
+    if( server->unix_fd >= 0){
+        fds[ num++] = server->unix_fd;
+    }
+    if( handoff_send( server->handoff, HANDOFF_MSG_LISTEN, server->conn_seq, fds, NULL, num) < NORMAL){
+        server_handoff_relisten( server);
+        return;
+    }
+    epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_DEL, server->fd, NULL);
+    if( server->unix_fd >= 0){
+        epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_DEL, server->unix_fd, NULL);
+    }
+    printf("	| @ Server : handed listeners over to the new server, draining %d connections\n", server->transc_num);
+}
+
+/**
+ * @fn static int server_transc_is_idle( transc_t *transc)
+ * @brief 연결을 다른 프로세스로 넘길 수 있는지 확인하는 함수
+ * 메시지를 받다 말았거나 처리 / 응답 중인 연결, shared memory / proxy 연결, 받는 중인 stream 이 있는 연결은 이 프로세스에 상태가 있으므로 넘기지 않는다
+ * 소켓 수신 버퍼에 아직 읽지 않은 메시지는 소켓과 같이 넘어간다
+ * @return 넘길 수 있으면 1, 아니면 0
+ * @param transc 확인할 연결
+ */
+static int server_transc_is_idle( transc_t *transc){
+    return ( transc->recv_bytes == 0) && ( transc->is_recv_header == 0) && ( transc->is_queued == 0)
+        && ( transc->is_wait_reply == 0) && ( transc->cache_wait == NULL) && ( transc->reply_val == NULL) && ( transc->blob == NULL)
+        && ( transc->shm == NULL) && ( transc->proxy == NULL) && ( ( transc->streams == NULL) || ( transc->streams->num == 0));
+}
+
+/**
+ * @fn static int server_handoff_flush( server_t *server, int *fds, handoff_conn_t *conns, transc_t **transcs, int num)
+ * @brief 모아 둔 idle 연결들을 새 프로세스로 보내고 이 프로세스의 소켓은 닫는 함수
+ * @return 정상이면 NORMAL, 보내지 못했으면 SOC_ERR (연결은 그대로 남는다)
+ */
+static int server_handoff_flush( server_t *server, int *fds, handoff_conn_t *conns, transc_t **transcs, int num){
+    int i;
+
+    if( num == 0){
+        return NORMAL;
+    }
+    if( handoff_send( server->handoff, HANDOFF_MSG_CONN, server->conn_seq, fds, conns, num) < NORMAL){
+        return SOC_ERR;
+    }
+    for( i = 0; i < num; i++){
+        server_transc_remove( server, transcs[ i]);
+    }
+    server->handoff->conns += num;
+    return NORMAL;
+}
+
+/**
+ * @fn static void server_handoff_conns( server_t *server)
+ * @brief listener 를 넘긴 뒤 idle 연결을 새 프로세스로 넘기고, 모두 넘겼으면 끝낼 상태로 바꾸는 함수
+ * 바쁜 연결은 응답을 다 보내서 idle 이 되면 다음 loop 에서 넘긴다 (HANDOFF_DRAIN_MS 가 지나면 남은 연결은 닫는다)
+ * @return void
+ * @param server listener 를 넘긴 server 객체
+ */
+static void server_handoff_conns( server_t *server){
+    int fds[ HANDOFF_FD_MAX];
+    handoff_conn_t conns[ HANDOFF_FD_MAX];
+    transc_t *transcs[ HANDOFF_FD_MAX];
+    transc_t *transc;
+    int i, j, num = 0;
+
+    for( i = 0; ( i < TRANSC_CHUNK_NUM) && ( server->transc_num > 0); i++){
+        if( server->transc_table[ i] == NULL){
+            continue;
+        }
+        for( j = 0; j < TRANSC_CHUNK_LEN; j++){
+            transc = &server->transc_table[ i][ j];
+            if( ( transc->fd < 0) || ( server_transc_is_idle( transc) == 0)){
+                continue;
+            }
+            fds[ num] = transc->fd;
+            conns[ num].conn_id = transc->conn_id;
+            conns[ num].is_unix = transc->is_unix;
+            memset( conns[ num].reserved, 0, sizeof( conns[ num].reserved));
+            transcs[ num++] = transc;
+            if( num == HANDOFF_FD_MAX){
+                if( server_handoff_flush( server, fds, conns, transcs, num) < NORMAL){
+                    server_handoff_abort( server);
+                    return;
+                }
+                num = 0;
+            }
+        }
+    }
+    if( server_handoff_flush( server, fds, conns, transcs, num) < NORMAL){
+        server_handoff_abort( server);
+        return;
+    }
+
+    if( ( server->transc_num > 0) || ( ( server->coro != NULL) && ( server->coro->live_num > 0))){
+        if( handoff_now_ms() - server->handoff->start_ms < HANDOFF_DRAIN_MS){
+            return;
+        }
+        printf("	| ! Server : drain timeout, closing %d busy connections\n", server->transc_num);
+    }
+    handoff_send( server->handoff, HANDOFF_MSG_DONE, server->conn_seq, NULL, NULL, 0);
+    server->handoff->state = HANDOFF_STATE_DONE;
+    printf("	| @ Server : handed %llu connections over in %llu ms\n",
+            ( unsigned long long)server->handoff->conns, ( unsigned long long)( handoff_now_ms() - server->handoff->start_ms));
+}
+
+/**
+ * @fn static void server_handoff_recv( server_t *server)
+ * @brief 이전 프로세스가 넘겨 준 연결을 받아서 등록하는 함수
+ * 이전 프로세스가 끝나면 다음 교체를 위해 handoff 경로를 다시 연다
+ * @return void
+ * @param server 새 server 객체
+ */
+static void server_handoff_recv( server_t *server){
+    handoff_t *handoff = server->handoff;
+    int fds[ HANDOFF_FD_MAX];
+    handoff_msg_t msg;
+    int i, num;
+
+    if( ( ( num = handoff_recv( handoff, &msg, fds)) < 0) || ( msg.type == HANDOFF_MSG_DONE)){
+        printf("	| @ Server : took over %llu connections in %llu ms\n",
+                ( unsigned long long)handoff->conns, ( unsigned long long)( handoff_now_ms() - handoff->start_ms));
+        server_handoff_relisten( server);
+        return;
+    }
+    for( i = 0; i < num; i++){
+        if( msg.type != HANDOFF_MSG_CONN){
+            close( fds[ i]);
+            continue;
+        }
+        if( server_add_client( server, fds[ i], msg.conns[ i].is_unix, msg.conns[ i].conn_id) == NORMAL){
+            handoff->conns++;
+        }
+    }
+}
+
+/**
+ * @fn static void server_handoff_process( server_t *server)
+ * @brief handoff fd 의 epoll 이벤트를 상태에 따라 처리하는 함수
+ * @return void
+ * @param server handoff 객체를 가지고 있는 server 객체
+ */
+static void server_handoff_process( server_t *server){
+    if( server->handoff->state == HANDOFF_STATE_LISTEN){
+        server_handoff_start( server);
+    }
+    else if( server->handoff->state == HANDOFF_STATE_RECV){
+        server_handoff_recv( server);
+    }
+    else if( server->handoff->state == HANDOFF_STATE_SEND){
+        // 새 프로세스는 보내는 것이 없으므로 이벤트는 연결이 끊겼다는 뜻이다
+        server_handoff_abort( server);
+    }
+}
+
+/**
+ * @fn static void server_worker_adopt( server_t *server)
+ * @brief acceptor 가 이 worker 의 queue 에 넣은 연결을 모두 꺼내서 event loop 에 등록하는 함수
+ * @return void
+ * @param server worker 의 event loop 객체
+ */
+static void server_worker_adopt( server_t *server){
+    uint64_t count;
+    int fd;
+
+    if( read( server->worker->efd, &count, sizeof( count)) < 0){
+        // 값이 없으면 이미 다른 wakeup 에서 비웠다
+        return;
+    }
+    while( ( fd = worker_pop( server->worker)) >= 0){
+        if( server_add_client( server, fd, 0, 0) < NORMAL){
+            worker_conn_done( server->worker);
+        }
+    }
+}
+
+/**
+ * @fn static int server_listen_reuseport( struct sockaddr_in *addr)
+ * @brief SO_REUSEPORT 를 켠 TCP listener 를 여는 함수 (같은 주소에 worker 마다 하나씩 열면 kernel 이 연결을 나눈다)
+ * @return non-blocking listener, 실패하면 SOC_ERR
+ * @param addr bind 할 주소
+ */
+static int server_listen_reuseport( struct sockaddr_in *addr){
+    int fd, reuse = 1;
+
+    if( ( fd = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP)) < 0){
+        printf("	| ! Server : Failed to open socket\n");
+        return SOC_ERR;
+    }
+    if( ( setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof( reuse)) < 0)
+            || ( setsockopt( fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof( reuse)) < 0)
+            || ( bind( fd, ( struct sockaddr*)addr, sizeof( struct sockaddr_in)) < 0) || ( listen( fd, MSG_QUEUE_NUM) < 0)){
+        printf("	| ! Server : Failed to listen with SO_REUSEPORT (errno:%d)\n", errno);
+        close( fd);
+        return SOC_ERR;
+    }
+    return fd;
+}
+
+/**
+ * @fn static server_t* server_worker_init( server_t *parent, worker_t *worker)
+ * @brief worker 하나가 돌릴 event loop 객체를 만드는 함수
+ * 설정(-W, -B, -S)은 parent 를 따르고 연결 table / epoll / 통계는 worker 마다 따로 가진다
+ * acceptor 모드에서는 eventfd 를, SO_REUSEPORT 모드에서는 자기 listener 를 epoll 에 등록한다
+ * @return 생성된 객체, 실패하면 NULL
+ * @param parent 옵션을 적용한 main server 객체
+ * @param worker 이 event loop 를 돌릴 worker
+ */
+static server_t* server_worker_init( server_t *parent, worker_t *worker){
+    struct epoll_event event;
+    server_t *server;
+
+    if( ( server = ( server_t*)calloc( 1, sizeof( server_t))) == NULL){
+        printf("	| ! Server : Failed to allocate memory\n");
+        return NULL;
+    }
+    server->fd = -1;
+    server->unix_fd = -1;
+    server->addr = parent->addr;
+    server->work_us = parent->work_us;
+    server->budget = parent->budget;
+    server->pool = parent->pool;
+    server->worker = worker;
+
+    if( ( parent->spin != NULL) && ( ( server->spin = spin_init( parent->spin->mode, parent->spin->max_us)) == NULL)){
+        free( server);
+        return NULL;
+    }
+    if( ( parent->flight != NULL) && ( ( server->flight = flight_init( parent->flight->cap)) == NULL)){
+        spin_destroy( server->spin);
+        free( server);
+        return NULL;
+    }
+    // 열어 둔 blob fd 와 LRU 는 event loop 마다 따로 가진다 (lock 없이 참조 수를 센다)
+    if( ( parent->blob != NULL) && ( ( server->blob = blob_tab_init( parent->blob->dir, parent->blob->max)) == NULL)){
+        flight_destroy( server->flight);
+        spin_destroy( server->spin);
+        free( server);
+        return NULL;
+    }
+    if( ( server->epoll_handle_fd = epoll_create1( EPOLL_CLOEXEC)) < 0){
+        printf("	| ! Server : Failed to create epoll handle fd\n");
+        blob_tab_destroy( server->blob);
+        flight_destroy( server->flight);
+        spin_destroy( server->spin);
+        free( server);
+        return NULL;
+    }
+    if( ( server->events = ( struct epoll_event*)malloc( sizeof( struct epoll_event) * SERVER_EVENT_MAX)) == NULL){
+        printf("	| ! Server : Failed to allocate memory\n");
+        close( server->epoll_handle_fd);
+        blob_tab_destroy( server->blob);
+        flight_destroy( server->flight);
+        spin_destroy( server->spin);
+        free( server);
+        return NULL;
+    }
+
+    event.events = EPOLLIN;
+    if( parent->pool->mode == WORKER_MODE_REUSEPORT){
+        if( ( server->fd = server_listen_reuseport( &server->addr)) < 0){
+            close( server->epoll_handle_fd);
+            free( server->events);
+            blob_tab_destroy( server->blob);
+            flight_destroy( server->flight);
+            spin_destroy( server->spin);
+            free( server);
+            return NULL;
+        }
+        server->listen_ev.type = SERVER_EV_LISTEN;
+        server->listen_ev.fd = server->fd;
+        server->listen_ev.transc = NULL;
+        event.data.ptr = &server->listen_ev;
+        epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->fd, &event);
+    }
+    else{
+        event.data.ptr = worker;
+        epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, worker->efd, &event);
+    }
+    // 다른 worker 가 통계를 모을 때 읽는다
+    __atomic_store_n( &worker->server, server, __ATOMIC_RELEASE);
+    return server;
+}
+
+/**
+ * @fn static void* server_worker_main( void *data)
+ * @brief worker thread 의 main 함수. 자기 event loop 를 계속 돌린다
+ * @return NULL
+ * @param data worker 의 event loop 객체
+ */
+static void* server_worker_main( void *data){
+    server_t *server = ( server_t*)data;
+
+    while( 1){
+        server_conn( server);
+    }
+    return NULL;
+}
+
+/**
+ * @fn static void server_flight_signal( int signo)
+ * @brief SIGUSR2 를 받으면 모든 event loop 의 flight recorder 를 dump 파일에 쓰는 signal handler
+ * event loop 가 멈춰 있어도 쓸 수 있도록 handler 안에서 바로 쓴다 (flight_dump_all 은 open / write 만 쓴다)
+ * @return void
+ * @param signo signal 번호
+ */
+static void server_flight_signal( int signo){
+    ( void)signo;
+    flight_dump_all( FLIGHT_FD_ALL);
+}
+
+/**
+ * @fn static void* server_detect_finish( void *data)
+ * @brief Server에서 사용하는 메모리를 해제하기 위한 함수
+ * @return None
+ * @param data Thread 매개변수, 현재 사용되는(할당된) Server 객체
+ */
+static void* server_detect_finish( void *data){
+    server_t *server = ( server_t*)( data);
+
+    while( 1){
+        if( is_error == true){
+            break;
+        }
+
+        if( is_finish == true){
+            server_destroy( server);
+            is_error = true;
+            break;
+        }
+    }
+}   
+
+// -----------------------------------------------------------------------------------
+
+/**
+ * @fn server_t* server_init( char **argv, int listen_fd)
+ * @brief server 객체를 생성하고 초기화하는 함수
+ * @return 생성된 server 객체
+ * @param **argv IP와 PORT 정보
+ * @param listen_fd 실행 중인 server 에게서 넘겨 받은 TCP listener (없으면 -1 이고 새로 bind 한다)
+ */
+server_t* server_init( char **argv, int listen_fd){
+    int rv;
+    // 연결 table chunk 포인터가 모두 NULL 이어야 한다
+    server_t *server = ( server_t*)calloc( 1, sizeof( server_t));
+
+    if( server == NULL){
+        printf("	| ! Server : Failed to allocate memory\n");
+        return NULL;
+    }
+
+    server->unix_fd = -1;
+    server->transc_num = 0;
+    server->is_proxy = 0;
+    server->route = NULL;
+    server->coro = NULL;
+    server->cache = NULL;
+    server->admit = NULL;
+    server->work_us = 0;
+    server->budget = SERVER_BUDGET_DEFAULT;
+    server->capture = NULL;
+    server->conn_seq = 0;
+    server->handoff = NULL;
+    server->spin = NULL;
+    server->udp = NULL;
+    server->requests = 0;
+
+    memset( &server->addr, 0, sizeof( struct sockaddr));
+    server->addr.sin_family = AF_INET;
+    server->addr.sin_addr.s_addr = inet_addr( argv[1]);
+    // inet_aton이 inet_addr보다 명확한 에러 리턴을 갖고 있어서 리눅스 매뉴얼 페이지에서는 inet_addr 대체 함수로 권장하고 있다. 다만 inet_addr과 달리 inet_aton은 POSIX.1-2001에 포함되어있지 않다.
+    server->addr.sin_port = htons( atoi( argv[2]));
+
+    if( listen_fd >= 0){
+        // 이미 bind / listen 된 소켓이므로 같은 port 를 다시 bind 하지 않는다
+        server->fd = listen_fd;
+    }
+    else if( ( server->fd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0){
+        printf("	| ! Server : Failed to open socket\n");
+        free( server);
+        return NULL;
+    }
+
+    int reuse = 1;
+    // 소켓 세부 설정
+    // 이미 사용중인 주소나 포트에 대해서도 바인드 허용 
+    if( ( listen_fd < 0) && setsockopt( server->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof( reuse))){
+        printf("	| ! Server : Failed to set the socket's option\n");
+        free( server);
+        return NULL;
+    }
+
+    // 소켓 bind
+    if( ( listen_fd < 0) && ( bind( server->fd, ( struct sockaddr*)( &server->addr), sizeof( server->addr)) < 0)){
+        printf("	| ! Server : Failed to bind socket\n");
+        if( ( close( server->fd) < 0)){
+            printf("	| ! Server : close error\n");
+            return UNKNOWN;
+        }
+        free( server);
+        return NULL;
+    }
+
+    // 소켓 listen
+    if( ( listen_fd < 0) && ( listen( server->fd, MSG_QUEUE_NUM) < 0)){
+        printf("	| ! Server : listen error\n");
+        if( ( close( server->fd) < 0)){
+            printf("	| ! Server : close error\n");
+            return UNKNOWN;
+        }
+        free( server);
+        return NULL;
     }
 
     rv = server_set_fd_nonblock( server->fd);
@@ -500,8 +2482,11 @@ server_t* server_init( char **argv){
 
     // epll_ctl 설정. epoll 인스턴스에 관찰 대상 등록 
     struct epoll_event server_event;
+    server->listen_ev.type = SERVER_EV_LISTEN;
+    server->listen_ev.fd = server->fd;
+    server->listen_ev.transc = NULL;
     server_event.events = EPOLLIN;
-    server_event.data.fd = server->fd;
+    server_event.data.ptr = &server->listen_ev;
     if( ( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->fd, &server_event)) < 0){
         printf("	| ! Server : Failed to add epoll server event\n");
         if( ( close( server->fd) < 0)){
@@ -512,11 +2497,83 @@ server_t* server_init( char **argv){
         return NULL;
     }
 
+    if( ( server->events = ( struct epoll_event*)malloc( sizeof( struct epoll_event) * SERVER_EVENT_MAX)) == NULL){
+        printf("	| ! Server : Failed to allocate memory\n");
+        close( server->epoll_handle_fd);
+        close( server->fd);
+        free( server);
+        return NULL;
+    }
+
     printf("	| @ Server : Success to create a object\n");
     printf("	| @ Server : Welcome\n\n");
     return server;
 }	
 
+/**
+ * @fn int server_init_unix( server_t *server, const char *path, int listen_fd)
+ * @brief 같은 호스트의 client를 위한 AF_UNIX listener를 추가로 여는 함수
+ * TCP listener와 같은 epoll 인스턴스에 등록되고, 같은 kmp 메시지 형식을 사용한다
+ * @return 정상이면 NORMAL, 실패하면 열거형 참고
+ * @param server listener를 추가할 server 객체
+ * @param path unix domain socket 경로
+ * @param listen_fd 실행 중인 server 에게서 넘겨 받은 UDS listener (없으면 -1 이고 새로 bind 한다)
+ */
+int server_init_unix( server_t *server, const char *path, int listen_fd){
+    struct epoll_event server_event;
+
+    if( strlen( path) >= sizeof( server->unix_addr.sun_path)){
+        printf("	| ! Server : unix socket path is too long (%s)\n", path);
+        return BUF_ERR;
+    }
+
+    memset( &server->unix_addr, 0, sizeof( server->unix_addr));
+    server->unix_addr.sun_family = AF_UNIX;
+    strncpy( server->unix_addr.sun_path, path, sizeof( server->unix_addr.sun_path) - 1);
+
+    if( listen_fd >= 0){
+        // 경로도 이미 bind 되어 있으므로 지우지 않는다
+        server->unix_fd = listen_fd;
+    }
+    else if( ( server->unix_fd = socket( AF_UNIX, SOCK_STREAM, 0)) < 0){
+        printf("	| ! Server : Failed to open unix socket\n");
+        return SOC_ERR;
+    }
+
+    if( listen_fd < 0){
+        // 이전 실행에서 남은 소켓 파일 제거
+        unlink( path);
+    }
+    if( ( listen_fd < 0) && ( bind( server->unix_fd, ( struct sockaddr*)( &server->unix_addr), sizeof( server->unix_addr)) < 0)){
+        printf("	| ! Server : Failed to bind unix socket (%s)\n", path);
+        close( server->unix_fd);
+        server->unix_fd = -1;
+        return SOC_ERR;
+    }
+
+    if( ( ( listen_fd < 0) && ( listen( server->unix_fd, MSG_QUEUE_NUM) < 0)) || ( server_set_fd_nonblock( server->unix_fd) < NORMAL)){
+        printf("	| ! Server : unix socket listen error\n");
+        close( server->unix_fd);
+        server->unix_fd = -1;
+        return SOC_ERR;
+    }
+
+    server->unix_listen_ev.type = SERVER_EV_LISTEN;
+    server->unix_listen_ev.fd = server->unix_fd;
+    server->unix_listen_ev.transc = NULL;
+    server_event.events = EPOLLIN;
+    server_event.data.ptr = &server->unix_listen_ev;
+    if( ( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->unix_fd, &server_event)) < 0){
+        printf("	| ! Server : Failed to add epoll unix server event\n");
+        close( server->unix_fd);
+        server->unix_fd = -1;
+        return OBJECT_ERR;
+    }
+
+    printf("	| @ Server : Listen on unix socket (%s)\n", path);
+    return NORMAL;
+}
+
 /**
  * @fn void server_destroy( server_t *server)
  * @brief server 객체를 삭제하기 위한 함수
@@ -524,14 +2581,56 @@ server_t* server_init( char **argv){
  * @param server 삭제하려는 server 객체
  */
 void server_destroy( server_t* server){
+    transc_buf_t *buf;
+    int i, j;
+
     if( server_check_fd( server->fd) == FD_ERR){
-        return SOC_ERR;
+        return;
     }
-    int rv = 0;
+
+    for( i = 0; i < TRANSC_CHUNK_NUM; i++){
+        if( server->transc_table[ i] == NULL){
+            continue;
+        }
+        for( j = 0; j < TRANSC_CHUNK_LEN; j++){
+            if( server->transc_table[ i][ j].fd >= 0){
+                server_transc_remove( server, &server->transc_table[ i][ j]);
+            }
+        }
+        free( server->transc_table[ i]);
+    }
+    while( server->buf_pool != NULL){
+        buf = server->buf_pool;
+        server->buf_pool = buf->pool_next;
+        free( buf);
+    }
+    route_destroy( server->route);
+    cache_destroy( server->cache);
+    admit_destroy( server->admit);
+    spin_destroy( server->spin);
+    wal_destroy( server->wal);
+    pubsub_destroy( server->pubsub);
+    flight_destroy( server->flight);
+    blob_tab_destroy( server->blob);
+    udp_close( server->udp);
+    capture_close( server->capture);
+    coro_sched_destroy( server->coro);
+
+    if( server->unix_fd >= 0){
+        close( server->unix_fd);
+        // 넘겨 준 UDS listener 의 경로는 새 server 가 쓰고 있다
+        if( ( server->handoff == NULL) || ( server->handoff->state != HANDOFF_STATE_DONE)){
+            unlink( server->unix_addr.sun_path);
+        }
+    }
+    handoff_destroy( server->handoff);
+
     if( ( close( server->fd) < 0)){
         printf("	| ! Server : close error\n");
-        return UNKNOWN;
+        return;
     }
+    close( server->epoll_handle_fd);
+    free( server->events);
     free( server);
 
     printf("	| @ Server : Success to destroy the object\n");
@@ -541,66 +2640,157 @@ void server_destroy( server_t* server){
 /**
  * @fn int server_conn( server_t *server)
  * @brief client와 연결되었을 때 데이터를 수신하고 데이터를 처리하기 위한 함수
+ * listener(TCP, UDS), client 소켓, shared memory eventfd를 하나의 epoll loop에서 처리한다
  * @return client와 정상 연결 여부
  * @param server 데이터 처리를 위한 server 객체
  */
 int server_conn( server_t *server){
-    // 서버 file descriptor 체크 
-    if( server_check_fd( server->fd) == FD_ERR){
+    // 서버 file descriptor 체크 (acceptor 가 연결을 넘겨 주는 worker 는 listener 가 없다)
+    if( ( ( server->worker == NULL) || ( server->fd >= 0)) && ( server_check_fd( server->fd) == FD_ERR)){
         return SOC_ERR;
     }
 
     int i, rv, event_count = 0;
-    struct sockaddr_in client_addr;
-    int client_addr_len = sizeof( client_addr);
-    memset( &client_addr, 0, client_addr_len);
+    int timeout;
+    server_ev_t *ev;
+    transc_t *transc;
+    uint32_t events;
 
     while( 1){
-        event_count = epoll_wait( server->epoll_handle_fd, server->events, BUF_MAX_LEN, TIMEOUT);
+        if( ( server->handoff != NULL) && ( server->handoff->state == HANDOFF_STATE_SEND)){
+            server_handoff_conns( server);
+            if( server->handoff->state == HANDOFF_STATE_DONE){
+                return NORMAL;
+            }
+        }
+
+        // routing 모드에서는 upstream 응답 timeout을 확인하기 위해 짧게 깨어난다
+        timeout = ( server->route != NULL) ? ROUTE_TICK_MS : TIMEOUT;
+        if( server->coro != NULL){
+            // sleep_for 중인 coroutine이 깨어날 시각까지만 기다린다
+            timeout = coro_sched_next_timeout( server->coro, timeout);
+        }
+        if( ( server->handoff != NULL) && ( server->handoff->state == HANDOFF_STATE_SEND) && ( timeout > HANDOFF_TICK_MS)){
+            // 넘겨 주는 중에는 drain timeout 을 확인하기 위해 짧게 깨어난다
+            timeout = HANDOFF_TICK_MS;
+        }
+        if( server->spin != NULL){
+            event_count = spin_wait( server->spin, server->epoll_handle_fd, server->events, SERVER_EVENT_MAX, timeout);
+        }
+        else{
+            event_count = epoll_wait( server->epoll_handle_fd, server->events, SERVER_EVENT_MAX, timeout);
+        }
+        flight_tick( server->flight);
         if( event_count < 0){
+            if( errno == EINTR){
+                continue;
+            }
             printf("    | ! Server : epoll_wait error in server_conn (fd:%d)\n", server->fd);
             break;
         }
         else if ( event_count == 0){
+            if( server->coro != NULL){
+                coro_sched_run_timers( server->coro);
+            }
+            if( server->route != NULL){
+                route_check_timeouts( server->route);
+                continue;
+            }
+            if( ( server->handoff != NULL) && ( server->handoff->state == HANDOFF_STATE_SEND)){
+                continue;
+            }
             printf("    ! @ Server : epoll_wait timeout in server_conn (fd:%d)\n", server->fd);
             continue;
         }
 
+        if( server->admit != NULL){
+            admit_batch_begin( server->admit);
+        }
+
+        // data.ptr 가 처리할 객체를 직접 가리키므로 연결을 찾을 필요가 없다
         for( i = 0; i < event_count; i++){
-            if( server->events[ i].data.fd == server->fd){
-                int client_fd = accept( server->fd, ( struct sockaddr*)( &client_addr), ( socklen_t*)( &client_addr_len));
-                if( client_fd < 0){
-                    printf("	| @ Server : accept error!\n");
-                    return FD_ERR;
-                }
-                
-                printf("    | @ Server : accept success!\n");
+            ev = ( server_ev_t*)server->events[ i].data.ptr;
+            events = server->events[ i].events;
 
-                rv = server_set_fd_nonblock( client_fd);
-                if( rv < NORMAL){
-                    return FD_ERR;
+            if( ev->type == SERVER_EV_LISTEN){
+                if( ( rv = server_accept( server, ev->fd)) < NORMAL){
+                    return rv;
                 }
+                continue;
+            }
+            else if( ev->type == SERVER_EV_ROUTE){
+                route_process( server->route, ( route_conn_t*)ev, events);
+                continue;
+            }
+            else if( ev->type == SERVER_EV_CORO){
+                coro_resume( server->coro, ( coro_t*)ev, events);
+                continue;
+            }
+            else if( ev->type == SERVER_EV_HANDOFF){
+                server_handoff_process( server);
+                continue;
+            }
+            else if( ev->type == SERVER_EV_UDP){
+                server_udp_process( server);
+                continue;
+            }
+            else if( ev->type == SERVER_EV_WORKER){
+                server_worker_adopt( server);
+                continue;
+            }
+            else if( ev->type == SERVER_EV_WAL){
+                server_wal_done( server);
+                continue;
+            }
 
-                printf("    | @ Serer : set client nonblock success!\n");
+            transc = ( ev->type == SERVER_EV_CLIENT) ? ( transc_t*)ev : ev->transc;
+            // 같은 epoll_wait 결과 안에서 먼저 닫힌 연결
+            if( transc->fd < 0){
+                continue;
+            }
 
-                struct epoll_event client_event;
-                client_event.events = EPOLLIN | EPOLLOUT;
-                client_event.data.fd = client_fd;
-                if( ( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, client_fd, &client_event)) < 0){
-                    printf("	| ! Server : Failed to add epoll client event\n");
-                    return OBJECT_ERR;
+            if( transc->proxy != NULL){
+                rv = server_proxy_process( server, transc, ( ev->type == SERVER_EV_CLIENT) ? transc->fd : transc->proxy->upstream_fd, events);
+            }
+            else if( ev->type == SERVER_EV_CLIENT){
+                if( ( transc->sub != NULL) && ( transc->sub->num > 0)){
+                    // 소켓이 비었으면 남은 발행 메시지를 이번 loop 끝에서 이어 보낸다
+                    pubsub_ready_push( server->pubsub, transc->sub);
                 }
+                transc->budget = server->budget;
+                rv = server_recv_frame( server, transc);
+            }
+            else if( transc->shm != NULL){
+                rv = server_shm_process( server, transc);
+            }
+            else{
+                continue;
+            }
 
-                rv = server_process_data( server, client_fd);
-                if( rv < NORMAL){
-                    printf("	| ! Server : process end\n");
-                    return OBJECT_ERR;
-                }
-                else{
-                    continue;
-                }
+            if( rv < NORMAL){
+                server_transc_remove( server, transc);
             }
         }
+
+        server_run_drain( server);
+        // 이번 loop 에서 쓴 record 를 fdatasync 한 번으로 같이 내린다
+        if( server->wal != NULL){
+            wal_kick( server->wal);
+        }
+        // 이번 loop 에서 발행된 메시지를 구독자마다 writev 한 번으로 보낸다
+        if( server->pubsub != NULL){
+            server_pubsub_flush( server);
+        }
+
+        if( server->admit != NULL){
+            admit_batch_end( server->admit);
+        }
+        if( server->coro != NULL){
+            coro_sched_run_timers( server->coro);
+        }
+        if( server->route != NULL){
+            route_check_timeouts( server->route);
+        }
     }
 
 
@@ -615,23 +2805,467 @@ int server_conn( server_t *server){
  * @brief server 구동을 위한 main 함수
  * @return int 
  * @param argc 매개변수 개수
- * @param argv ip / 포트번호
+ * @param argv [옵션] ip / 포트번호 / (선택) unix domain socket 경로
+ * 옵션 : -P upstream_ip:port (proxy 모드)
+ *        -R backend_ip:port (app_id sharding 모드, 여러 번 지정 가능)
+ *        -C (연결마다 coroutine handler로 echo 처리)
+ *        -K code (-R 모드에서 응답을 cache 할 멱등 code, 여러 번 지정 가능)
+ *        -M MB (-K cache 메모리 한도, 기본 64MB)
+ *        -L rate[:burst] (app_id 별 초당 요청 수 제한)
+ *        -A target_us (queueing delay 목표에 맞춰 움직이는 전역 동시 처리 한도)
+ *        -W usec (부하 시험용 요청당 처리 시간)
+ *        -B frames (연결 하나가 event loop 한 번에 처리하는 최대 메시지 수, 기본 8)
+ *        -T path (받은 메시지를 capture 파일에 기록, BENCH/replay 로 재생)
+ *        -U path (무중단 재시작. path 에서 기다리는 server 가 있으면 listener 와 idle 연결을 넘겨 받고,
+ *                 없으면 새로 listen 한 뒤 path 에서 다음 server 를 기다린다)
+ *        -D port (같은 ip 의 UDP port 에서 datagram 하나에 메시지 하나씩 받는다)
+ *        -S [a:]usec (잠들기 전에 usec 동안 이벤트를 확인하며 기다린다. a: 를 붙이면 이벤트 간격에 맞춰 0 ~ usec 사이에서 조절)
+ *        -N [r:]num (event loop 를 num 개의 worker thread 로 돌린다. main thread 가 acceptor 가 되어 연결 수가 가장 적은
+ *                    worker 에 넘기고, r: 를 붙이면 worker 마다 SO_REUSEPORT listener 를 열어 kernel 이 나눈다)
+ *        -G dir[:window_us] (durable code 의 메시지를 dir 의 write-ahead log 에 쓰고 fdatasync 로 내린 뒤에 응답한다.
+ *                            window_us 는 sync 전에 더 모으는 시간, 기본 0)
+ *        -F code (-G 에서 durable 로 처리할 code, 여러 번 지정 가능. 없으면 예약 code 를 뺀 모든 code)
+ *        -Q [c:]len (구독 / 발행을 받는다. len 은 구독자마다 쌓아 두는 최대 메시지 수, 넘치면 그 구독자에게 보낼 메시지를 버리고
+ *                    c: 를 붙이면 그 구독자의 연결을 닫는다)
+ *        -Y events[:path] (event loop 마다 기억하는 flight recorder event 수, 기본 4096, 0 이면 끈다.
+ *                          SIGUSR2 나 KMP_CODE_FLIGHT 요청을 받으면 path.<pid> (기본 /tmp/kmp_flight.<pid>) 에 쓴다)
+ *        -O dir[:num] (KMP_CODE_BLOB 요청에 dir 의 파일을 sendfile 로 보낸다. num 은 event loop 마다 열어 두는 최대 파일 수, 기본 256)
  */
 int main( int argc, char **argv){
-    if ( argc != 3){
-        printf("	| ! need param : ip port\n");
+    struct sockaddr_in upstream_addr;
+    struct sockaddr_in backend_addrs[ ROUTE_BACKEND_MAX];
+    int backend_num = 0;
+    int is_proxy = 0;
+    int is_coro = 0;
+    uint32_t cache_codes[ CACHE_CODE_MAX];
+    int cache_code_num = 0;
+    size_t cache_mem = CACHE_MEM_DEFAULT;
+    double admit_rate = 0, admit_burst = 0;
+    int admit_target_us = 0;
+    int work_us = 0;
+    int budget = 0;
+    char *capture_path = NULL;
+    char *handoff_path = NULL;
+    int spin_mode = 0;
+    int udp_port = 0;
+    struct epoll_event udp_event;
+    struct epoll_event wal_event;
+    int worker_mode = 0, worker_num = 0;
+    char *wal_dir = NULL;
+    char *wal_window;
+    int wal_window_us = 0;
+    uint32_t wal_codes[ WAL_CODE_MAX];
+    int wal_code_num = 0;
+    int pubsub_queue = 0;
+    int pubsub_policy = PUBSUB_POLICY_DROP;
+    int flight_events = FLIGHT_EVENT_DEFAULT;
+    char *flight_path = NULL;
+    char *flight_sep;
+    struct sigaction flight_action;
+    char *blob_dir = NULL;
+    char *blob_sep;
+    int blob_max = BLOB_OPEN_DEFAULT;
+    worker_pool_t *pool;
+    server_t *worker_server;
+    uint32_t spin_us = 0;
+    handoff_t *handoff = NULL;
+    handoff_msg_t handoff_msg;
+    int listen_fds[ HANDOFF_FD_MAX];
+    int listen_num = 0;
+    char *burst_str;
+    int opt, i;
+
+    while( ( opt = getopt( argc, argv, "P:R:CK:M:L:A:W:B:T:U:S:D:N:G:F:Q:Y:O:")) != -1){
+        if( ( opt == 'P') && ( proxy_parse_addr( optarg, &upstream_addr) == NORMAL)){
+            is_proxy = 1;
+        }
+        else if( ( opt == 'R') && ( backend_num < ROUTE_BACKEND_MAX) && ( proxy_parse_addr( optarg, &backend_addrs[ backend_num]) == NORMAL)){
+            backend_num++;
+        }
+        else if( opt == 'C'){
+            is_coro = 1;
+        }
+        else if( ( opt == 'K') && ( cache_code_num < CACHE_CODE_MAX)){
+            cache_codes[ cache_code_num++] = strtoul( optarg, NULL, 0);
+        }
+        else if( ( opt == 'M') && ( atoi( optarg) > 0)){
+            cache_mem = ( size_t)atoi( optarg) << 20;
+        }
+        else if( ( opt == 'L') && ( ( admit_rate = atof( optarg)) > 0)){
+            if( ( burst_str = strchr( optarg, ':')) != NULL){
+                admit_burst = atof( burst_str + 1);
+            }
+        }
+        else if( ( opt == 'A') && ( atoi( optarg) > 0)){
+            admit_target_us = atoi( optarg);
+        }
+        else if( ( opt == 'W') && ( atoi( optarg) > 0)){
+            work_us = atoi( optarg);
+        }
+        else if( opt == 'B'){
+            // 연결마다 세는 값은 16 bit 다. 넘는 값은 잘려서 0 이 되고, 0 에서 줄이면 65535 가 되어 한도가 사라진다
+            if( ( ( budget = atoi( optarg)) < 1) || ( budget > SERVER_BUDGET_MAX)){
+                printf("	| ! -B frames must be 1 ~ %d\n", SERVER_BUDGET_MAX);
+                return UNKNOWN;
+            }
+        }
+        else if( opt == 'T'){
+            capture_path = optarg;
+        }
+        else if( opt == 'U'){
+            handoff_path = optarg;
+        }
+        else if( ( opt == 'D') && ( atoi( optarg) > 0)){
+            udp_port = atoi( optarg);
+        }
+        else if( ( opt == 'S') && ( strncmp( optarg, "a:", 2) == 0)){
+            spin_mode = SPIN_MODE_ADAPTIVE;
+            spin_us = atoi( optarg + 2);
+        }
+        else if( opt == 'S'){
+            spin_mode = SPIN_MODE_FIXED;
+            spin_us = atoi( optarg);
+        }
+        else if( ( opt == 'N') && ( strncmp( optarg, "r:", 2) == 0) && ( atoi( optarg + 2) > 0)){
+            worker_mode = WORKER_MODE_REUSEPORT;
+            worker_num = atoi( optarg + 2);
+        }
+        else if( ( opt == 'N') && ( atoi( optarg) > 0)){
+            worker_mode = WORKER_MODE_ACCEPTOR;
+            worker_num = atoi( optarg);
+        }
+        else if( opt == 'G'){
+            wal_dir = optarg;
+            if( ( wal_window = strrchr( optarg, ':')) != NULL){
+                *wal_window = '\0';
+                wal_window_us = atoi( wal_window + 1);
+            }
+        }
+        else if( ( opt == 'F') && ( wal_code_num < WAL_CODE_MAX)){
+            wal_codes[ wal_code_num++] = strtoul( optarg, NULL, 0);
+        }
+        else if( ( opt == 'Q') && ( strncmp( optarg, "c:", 2) == 0) && ( atoi( optarg + 2) > 0)){
+            pubsub_policy = PUBSUB_POLICY_CLOSE;
+            pubsub_queue = atoi( optarg + 2);
+        }
+        else if( ( opt == 'Q') && ( atoi( optarg) > 0)){
+            pubsub_policy = PUBSUB_POLICY_DROP;
+            pubsub_queue = atoi( optarg);
+        }
+        else if( ( opt == 'Y') && ( optarg[ 0] >= '0') && ( optarg[ 0] <= '9')){
+            flight_events = atoi( optarg);
+            if( ( flight_sep = strchr( optarg, ':')) != NULL){
+                flight_path = flight_sep + 1;
+            }
+        }
+        else if( opt == 'O'){
+            blob_dir = optarg;
+            if( ( blob_sep = strrchr( optarg, ':')) != NULL){
+                *blob_sep = '\0';
+                blob_max = atoi( blob_sep + 1);
+            }
+        }
+        else{
+            printf("	| ! wrong option : -P upstream_ip:port | -R backend_ip:port | -C | -K code | -M MB | -L rate[:burst] | -A target_us | -W usec | -B frames | -T capture_path | -U handoff_path | -S [a:]usec | -D udp_port | -N [r:]num | -G wal_dir[:window_us] | -F code | -Q [c:]queue_len | -Y events[:path] | -O blob_dir[:num]\n");
+            return UNKNOWN;
+        }
+    }
+    if( is_proxy && ( backend_num > 0)){
+        printf("	| ! -P and -R can not be used together\n");
+        return UNKNOWN;
+    }
+    if( is_coro && ( is_proxy || ( backend_num > 0))){
+        printf("	| ! -C can not be used with -P or -R\n");
+        return UNKNOWN;
+    }
+    if( ( ( admit_rate > 0) || ( admit_target_us > 0) || ( work_us > 0) || ( budget > 0)) && ( is_proxy || is_coro)){
+        // proxy / coroutine 모드는 요청을 run queue 로 처리하지 않는다
+        printf("	| ! -L, -A, -W, -B can not be used with -P or -C\n");
+        return UNKNOWN;
+    }
+    if( ( capture_path != NULL) && is_proxy){
+        // proxy 모드는 바디를 splice 로 넘기므로 메시지가 user 공간에 없다
+        printf("	| ! -T can not be used with -P\n");
+        return UNKNOWN;
+    }
+    if( ( udp_port > 0) && ( is_proxy || is_coro || ( backend_num > 0) || ( handoff_path != NULL))){
+        // datagram 은 연결 없이 바로 처리하므로 upstream 응답을 기다리거나 연결을 넘기는 모드와 같이 쓸 수 없다
+        printf("	| ! -D can not be used with -P, -R, -C or -U\n");
+        return UNKNOWN;
+    }
+    if( ( worker_num > 0) && ( is_proxy || is_coro || ( backend_num > 0) || ( admit_rate > 0) || ( admit_target_us > 0)
+            || ( capture_path != NULL) || ( handoff_path != NULL) || ( udp_port > 0))){
+        // worker 는 echo 처리만 나눠 맡는다 (upstream / cache / admission / capture 상태는 event loop 하나가 가진다고 가정한다)
+        printf("	| ! -N can not be used with -P, -R, -C, -L, -A, -T, -U or -D\n");
+        return UNKNOWN;
+    }
+    if( ( wal_dir != NULL) && ( is_proxy || is_coro || ( backend_num > 0) || ( udp_port > 0) || ( worker_num > 0))){
+        // 응답을 미루는 것은 이 server 가 처리하는 TCP / UDS 요청뿐이다
+        printf("	| ! -G can not be used with -P, -R, -C, -D or -N\n");
+        return UNKNOWN;
+    }
+    if( ( pubsub_queue > 0) && ( is_proxy || is_coro || ( backend_num > 0) || ( handoff_path != NULL) || ( worker_num > 0) || ( wal_dir != NULL))){
+        // 발행 메시지는 이 event loop 의 연결에만 보낼 수 있고, 응답을 미루거나 연결을 넘기는 동안에는 끼워 보낼 수 없다
+        printf("	| ! -Q can not be used with -P, -R, -C, -U, -N or -G\n");
+        return UNKNOWN;
+    }
+    if( ( blob_dir != NULL) && ( is_proxy || is_coro)){
+        // proxy / coroutine 모드는 요청을 run queue 로 처리하지 않는다
+        printf("	| ! -O can not be used with -P or -C\n");
+        return UNKNOWN;
+    }
+    if( ( wal_code_num > 0) && ( wal_dir == NULL)){
+        printf("	| ! -F needs -G\n");
+        return UNKNOWN;
+    }
+    if( ( cache_code_num > 0) && ( backend_num == 0)){
+        // cache 는 backend 가 처리하는 요청의 응답만 저장한다
+        printf("	| ! -K needs -R\n");
+        return UNKNOWN;
+    }
+
+    // server_init()은 argv[1], argv[2]를 ip, port로 사용한다
+    argc -= optind - 1;
+    argv += optind - 1;
+    if ( ( argc != 3) && ( argc != 4)){
+        printf("	| ! need param : [-P upstream_ip:port | -R backend_ip:port ... [-K code ...] [-M MB] | -C] [-L rate[:burst]] [-A target_us] [-W usec] [-B frames] [-T capture_path] [-U handoff_path] [-S [a:]usec] [-D udp_port] [-N [r:]num] [-G wal_dir[:window_us] [-F code ...]] [-Q [c:]queue_len] [-Y events[:path]] [-O blob_dir[:num]] ip port [unix_path]\n");
         return UNKNOWN; // 왜 unknown을 return할까?
     }
 
     int rv;
-    server_t* server = server_init( argv); // 메인에서 받은 ip와 포트주소를 이용해 서버 구조체 초기 
+    // client가 먼저 끊은 소켓에 write 해도 종료되지 않도록 한다
+    signal( SIGPIPE, SIG_IGN);
+
+    if( handoff_path != NULL){
+        if( ( handoff = handoff_init( handoff_path)) == NULL){
+            return UNKNOWN;
+        }
+        // 실행 중인 server 가 있으면 listener 를 넘겨 받는다 (없으면 처음 뜨는 server 다)
+        if( handoff_connect( handoff) == NORMAL){
+            if( ( ( listen_num = handoff_recv( handoff, &handoff_msg, listen_fds)) < 1) || ( handoff_msg.type != HANDOFF_MSG_LISTEN)){
+                printf("	| ! Server : Failed to take over listeners (%s)\n", handoff_path);
+                for( i = 0; i < listen_num; i++){
+                    close( listen_fds[ i]);
+                }
+                handoff_destroy( handoff);
+                return UNKNOWN;
+            }
+            printf("	| @ Server : took over listeners from the running server (%s)\n", handoff_path);
+        }
+    }
+
+    server_t* server = server_init( argv, ( listen_num > 0) ? listen_fds[ 0] : -1); // 메인에서 받은 ip와 포트주소를 이용해 서버 구조체 초기 
     if( server == NULL){
         printf("	| ! Serer : Failed to initialize\n");
+        handoff_destroy( handoff);
         return UNKNOWN;
     }
+    server->handoff = handoff;
+
+    if( ( argc == 4) && ( server_init_unix( server, argv[3], ( listen_num > 1) ? listen_fds[ 1] : -1) < NORMAL)){
+        printf("	| ! Serer : Failed to open unix socket\n");
+        server_destroy( server);
+        return UNKNOWN;
+    }
+    if( ( argc == 4) && ( worker_num > 0)){
+        printf("	| ! -N can not be used with unix_path\n");
+        server_destroy( server);
+        return UNKNOWN;
+    }
+    if( ( argc != 4) && ( listen_num > 1)){
+        // UDS 경로 없이 띄웠으므로 넘겨 받은 UDS listener 는 쓰지 않는다
+        close( listen_fds[ 1]);
+    }
+
+    if( is_proxy){
+        server->is_proxy = 1;
+        server->upstream_addr = upstream_addr;
+        printf("	| @ Server : proxy mode (upstream %s:%d)\n", inet_ntoa( upstream_addr.sin_addr), ntohs( upstream_addr.sin_port));
+    }
+
+    if( backend_num > 0){
+        if( ( server->route = route_init( server->epoll_handle_fd, server_route_reply, server)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        for( i = 0; i < backend_num; i++){
+            route_add_backend( server->route, &backend_addrs[ i]);
+        }
+        printf("	| @ Server : sharding mode (%d backends)\n", backend_num);
+
+        if( cache_code_num > 0){
+            if( ( server->cache = cache_init( cache_mem)) == NULL){
+                server_destroy( server);
+                return UNKNOWN;
+            }
+            for( i = 0; i < cache_code_num; i++){
+                cache_add_code( server->cache, cache_codes[ i]);
+            }
+            printf("	| @ Server : response cache (%d codes, %zu MB)\n", cache_code_num, cache_mem >> 20);
+        }
+    }
+
+    server->work_us = work_us;
+    if( budget > 0){
+        server->budget = budget;
+    }
+    if( ( admit_rate > 0) || ( admit_target_us > 0)){
+        if( ( server->admit = admit_init( admit_rate, admit_burst, admit_target_us)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : admission control (rate %.0f/s burst %.0f per app_id, target delay %d us)\n",
+                admit_rate, server->admit->burst, admit_target_us);
+    }
+
+    if( capture_path != NULL){
+        if( ( server->capture = capture_open( capture_path)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : capturing received messages to %s\n", capture_path);
+    }
+
+    if( udp_port > 0){
+        if( ( server->udp = udp_open( argv[ 1], udp_port)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        server->udp->type = SERVER_EV_UDP;
+        udp_event.events = EPOLLIN;
+        udp_event.data.ptr = server->udp;
+        if( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->udp->fd, &udp_event) < 0){
+            printf("	| ! Server : Failed to add epoll udp event\n");
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : udp datagrams on %s:%d (batch %d)\n", argv[ 1], udp_port, UDP_BATCH_MAX);
+    }
+
+    if( wal_dir != NULL){
+        if( ( server->wal = wal_init( wal_dir, wal_window_us)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        for( i = 0; i < wal_code_num; i++){
+            wal_add_code( server->wal, wal_codes[ i]);
+        }
+        wal_event.events = EPOLLIN;
+        wal_event.data.ptr = server->wal;
+        if( epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_ADD, server->wal->efd, &wal_event) < 0){
+            printf("	| ! Server : Failed to add epoll wal event\n");
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : write-ahead log in %s (segment %d MB, window %d us, %d durable codes%s)\n", wal_dir,
+                WAL_SEGMENT_LEN >> 20, wal_window_us, wal_code_num, ( wal_code_num == 0) ? " = all" : "");
+    }
+
+    if( pubsub_queue > 0){
+        if( ( server->pubsub = pubsub_init( pubsub_queue, pubsub_policy)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : publish / subscribe (queue %d msgs per subscriber, slow subscribers are %s)\n", pubsub_queue,
+                ( pubsub_policy == PUBSUB_POLICY_CLOSE) ? "closed" : "skipped");
+    }
+
+    if( flight_events > 0){
+        if( ( server->flight = flight_init( flight_events)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        if( flight_path != NULL){
+            flight_set_path( flight_path);
+        }
+        memset( &flight_action, 0, sizeof( flight_action));
+        flight_action.sa_handler = server_flight_signal;
+        sigemptyset( &flight_action.sa_mask);
+        flight_action.sa_flags = SA_RESTART;
+        sigaction( SIGUSR2, &flight_action, NULL);
+        printf("	| @ Server : flight recorder (%d events per event loop, SIGUSR2 or KMP_CODE_FLIGHT writes %s)\n",
+                server->flight->cap, flight_get_path());
+    }
+
+    if( blob_dir != NULL){
+        if( ( server->blob = blob_tab_init( blob_dir, blob_max)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : blobs from %s (up to %d open files per event loop, %d bytes per blob)\n", blob_dir, blob_max,
+                BLOB_SIZE_MAX);
+    }
+
+    if( spin_mode != 0){
+        if( ( server->spin = spin_init( spin_mode, spin_us)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : busy-poll %s (max %u us)\n", ( spin_mode == SPIN_MODE_ADAPTIVE) ? "adaptive" : "fixed", spin_us);
+    }
+
+    if( is_coro){
+        if( ( server->coro = coro_sched_init( server->epoll_handle_fd)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : coroutine handler mode\n");
+    }
+
+    if( handoff != NULL){
+        if( listen_num > 0){
+            // 이전 server 가 idle 연결을 넘겨 주고 끝나면 다음 교체를 위해 경로를 다시 연다
+            server->conn_seq = handoff_msg.conn_seq;
+        }
+        else if( handoff_listen( handoff) < NORMAL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        if( server_handoff_watch( server) < NORMAL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        printf("	| @ Server : hot restart enabled (%s)\n", handoff_path);
+    }
+
+    if( worker_num > 0){
+        if( ( pool = worker_pool_init( worker_mode, worker_num)) == NULL){
+            server_destroy( server);
+            return UNKNOWN;
+        }
+        server->pool = pool;
+        // main listener 는 acceptor 만 쓴다. SO_REUSEPORT 모드는 worker 가 같은 주소에 자기 listener 를 열도록 먼저 닫는다
+        epoll_ctl( server->epoll_handle_fd, EPOLL_CTL_DEL, server->fd, NULL);
+        if( worker_mode == WORKER_MODE_REUSEPORT){
+            close( server->fd);
+            server->fd = -1;
+        }
+        for( i = 0; i < pool->num; i++){
+            if( ( ( worker_server = server_worker_init( server, pool->workers[ i])) == NULL)
+                    || ( pthread_create( &pool->workers[ i]->thread, NULL, server_worker_main, worker_server) != 0)){
+                printf("	| ! Server : Failed to start worker %d\n", i);
+                exit( UNKNOWN);
+            }
+        }
+        printf("	| @ Server : %d workers (%s)\n", pool->num,
+                ( worker_mode == WORKER_MODE_REUSEPORT) ? "SO_REUSEPORT" : "least-loaded acceptor");
+        if( worker_mode == WORKER_MODE_ACCEPTOR){
+            // main thread 는 연결을 받아 넘기기만 한다. 통계 요청은 받은 worker 가 pool 을 통해 모두 모아 답한다
+            exit( worker_accept_loop( pool, server->fd));
+        }
+        for( i = 0; i < pool->num; i++){
+            pthread_join( pool->workers[ i]->thread, NULL);
+        }
+        return NORMAL;
+    }
 
     while(1){
         rv = server_conn( server); 
+        if( ( server->handoff != NULL) && ( server->handoff->state == HANDOFF_STATE_DONE)){
+            // listener 와 연결을 모두 새 server 에 넘겼다
+            server_destroy( server);
+            return NORMAL;
+        }
         if( rv <= FD_ERR){
             if( rv == SOC_ERR){
                 printf("	| ! Server : server fd closed\n");
@@ -9,15 +9,38 @@
 #include <stdbool.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netdb.h>
 
 #include "../COMMON/common.h"
+#include "../COMMON/kmp.h"
+#include "../COMMON/shm_ring.h"
+#include "../COMMON/capture.h"
+#include "../COMMON/udp.h"
+#include "../COMMON/stream.h"
+#include "../COMMON/crc32c.h"
+#include "../COMMON/io.h"
+#include "proxy.h"
+#include "route.h"
+#include "coro.h"
+#include "cache.h"
+#include "admit.h"
+#include "handoff.h"
+#include "spin.h"
+#include "worker.h"
+#include "wal.h"
+#include "pubsub.h"
+#include "flight.h"
+#include "blob.h"
 
 #define MSG_HEADER_LEN 20
 #define MSG_QUEUE_NUM 10
@@ -25,35 +48,150 @@
 #define SERVER_PORT 8000
 #define TIMEOUT 10000
 
-/// @struct transc_t
-/// @brief server에서 user buffer 관리를 위한 구조체
+/// server 가 한 번에 처리하는 최대 epoll 이벤트 수
+#define SERVER_EVENT_MAX 1024
+/// 연결 table chunk 하나에 들어가는 연결 수
+#define TRANSC_CHUNK_LEN 1024
+/// 연결 table chunk 수 (fd 1M 개까지)
+#define TRANSC_CHUNK_NUM 1024
+/// 돌려받은 송수신 버퍼를 해제하지 않고 다시 쓰려고 남겨 두는 최대 수
+#define TRANSC_BUF_POOL_MAX 256
+/// 연결 하나가 event loop 한 번에 처리하는 기본 최대 메시지 수 (-B)
+#define SERVER_BUDGET_DEFAULT 8
+/// -B 의 최대값 (transc_t.budget 이 uint16_t 다)
+#define SERVER_BUDGET_MAX 65535
+
+/// epoll data.ptr 가 가리키는 객체의 종류 (객체의 첫 번째 멤버)
+enum SERVER_EV{
+    SERVER_EV_LISTEN = 1,
+    SERVER_EV_CLIENT,
+    SERVER_EV_SHM,
+    SERVER_EV_UPSTREAM,
+    SERVER_EV_ROUTE = ROUTE_EV_CONN,
+    SERVER_EV_CORO = CORO_EV_TYPE,
+    SERVER_EV_CACHE = CACHE_EV_ENTRY,
+    SERVER_EV_HANDOFF = HANDOFF_EV_TYPE,
+    SERVER_EV_UDP,
+    SERVER_EV_WORKER = WORKER_EV_TYPE,
+    SERVER_EV_WAL = WAL_EV_TYPE
+};
+
+/// 수신이 끝난 메시지를 처리 순서대로 모으는 run queue (번호가 작을수록 먼저 비운다)
+enum SERVER_PRIO{
+    /// 헤더 flag 에 KMP_FLAG_PRIORITY 가 있는 제어 메시지
+    SERVER_PRIO_HIGH = 0,
+    /// 그 외 메시지
+    SERVER_PRIO_NORMAL,
+    SERVER_PRIO_NUM
+};
+
 typedef struct transc_s transc_t;
+
+/// @struct server_ev_t
+/// @brief epoll data.ptr 로 등록하는 이벤트 핸들. 이벤트가 오면 종류를 보고 바로 처리할 객체로 간다
+typedef struct server_ev_s server_ev_t;
+struct server_ev_s{
+    /// 이벤트 종류 (SERVER_EV)
+    int type;
+    /// 관찰하는 file descriptor
+    int fd;
+    /// 이벤트를 처리할 연결 (listener 면 NULL)
+    transc_t *transc;
+};
+
+/// @struct transc_buf_t
+/// @brief 연결의 메시지 송수신 버퍼. 상태 필드와 분리해서 연결 table이 캐시를 적게 차지하게 한다
+/// 메시지를 받기 시작할 때 server 의 pool 에서 빌리고, 메시지 경계에서 더 읽을 것이 없으면 돌려준다 (idle 연결은 버퍼가 없다)
+typedef struct transc_buf_s transc_buf_t;
+struct transc_buf_s{
+    /// pool 에 들어 있을 때 다음 버퍼
+    transc_buf_t *pool_next;
+    /// 전달 받은 메시지 헤더 데이터 
+    char read_hdr_buf[ MSG_HEADER_LEN];
+    /// 전달 받은 메시지 바디 데이터 
+    char read_body_buf[ BUF_MAX_LEN];
+    /// 보낸 메시지 헤더 데이터 
+    char write_hdr_buf[ MSG_HEADER_LEN];
+    /// 보낸 메시지 바디 데이터 
+    char write_body_buf[ BUF_MAX_LEN];
+};
+
+/// @struct transc_t
+/// @brief server에서 연결 하나의 송수신 상태를 관리하기 위한 구조체
+/// 연결 table에 fd 순서로 들어 있고, epoll data.ptr 가 이 구조체를 직접 가리킨다
+/// 메시지마다 접근하는 필드는 앞쪽 cache line 하나에 모여 있다
 struct transc_s{
+    /// 이벤트 종류 (SERVER_EV_CLIENT, server_ev_t 와 같은 위치)
+    int type;
+    /// 연결된 client file descriptor (빈 slot 이면 -1)
+    int fd;
+    /// 현재 epoll에 등록된 관찰 이벤트
+    uint32_t events;
+    /// AF_UNIX listener로 들어온 연결인지 여부
+    uint8_t is_unix;
     /// 메시지 헤더 수신 여부 
-    int is_recv_header;
+    uint8_t is_recv_header;
     /// 메시지 바디 수신 여부 
-    int is_recv_body;
+    uint8_t is_recv_body;
     /// 메시지 헤더 송신 여부 
-    int is_send_header;
+    uint8_t is_send_header;
     /// 메시지 바디 송신 여부 
-    int is_send_body;
+    uint8_t is_send_body;
+    /// routing 모드에서 upstream 응답을 기다리는 중인지 여부
+    uint8_t is_wait_reply;
+    /// write 버퍼에 보낼 응답이 이미 채워져 있는지 여부 (echo 복사 생략)
+    uint8_t is_reply_ready;
+    /// 받은 메시지가 run queue 에서 처리를 기다리는 중인지 여부
+    uint8_t is_queued;
+    /// 들어가 있는 run queue (SERVER_PRIO)
+    uint8_t prio;
+    /// 받은 메시지에 CRC32C trailer 가 있었는지 여부 (응답에도 붙인다)
+    uint8_t is_crc;
+    /// 응답 바디 뒤에 crc 의 trailer 를 따로 보내야 하는지 여부 (cache / blob 처럼 바디가 write 버퍼 밖에 있는 응답)
+    uint8_t is_crc_trailer;
+    /// 바디를 다 받기 전에 deadline 이 이미 지난 것을 알아서, 남은 바디는 버퍼에 담지 않고 읽어서 버리는지 여부
+    uint8_t is_discard;
+    /// 이번 event loop 에서 더 처리할 수 있는 메시지 수
+    uint16_t budget;
     /// 전달 받은 메시지 길이 
     int length;
     /// 전달 받은 메시지의 크기 
     int recv_bytes;
     /// 보낸 메시지의 크기
     int send_bytes;
-    /// 전달 받은 메시지 헤더 데이터 
-    char read_hdr_buf[ MSG_HEADER_LEN];
-    /// 전달 받은 메시지 바디 데이터 
-    char read_body_buf[ BUF_MAX_LEN];
-    /// 보낸 메시지 헤더 데이터 
-    char write_hdr_buf[ MSG_HEADER_LEN];
-    /// 보낸 메시지 바디 데이터 
-    char write_body_buf[ BUF_MAX_LEN];
+    /// routing 모드에서 upstream으로 보낸 요청의 hop_id
+    uint32_t route_hop_id;
+    /// 받는 중인 메시지의 헤더 + 바디 CRC32C (바디를 복사하면서 이어서 계산한다), 응답을 보낼 때는 따로 보낼 trailer
+    uint32_t crc;
+    /// 송수신 버퍼 (메시지를 주고받는 동안만 빌려 온다, idle 이면 NULL)
+    transc_buf_t *buf;
+    /// proxy 모드에서 upstream으로 중계하는 상태 (없으면 NULL)
+    proxy_t *proxy;
+    /// 응답 바디를 write 버퍼 대신 바로 보낼 cache 된 응답 (없으면 NULL)
+    cache_val_t *reply_val;
+    /// 같은 run queue 의 다음 연결
+    transc_t *run_next;
+    /// UDS 연결에서 협상된 shared memory 전송로 (없으면 NULL)
+    shm_chan_t *shm;
     /// 사용자 정의 data
     void *data;
-};
+    /// 처리 중인 같은 요청의 응답을 기다리는 cache 항목 (없으면 NULL)
+    cache_entry_t *cache_wait;
+    /// capture 파일에 남기는 연결 id (fd 와 달리 다시 쓰이지 않는다)
+    uint32_t conn_id;
+    /// shared memory eventfd 또는 proxy upstream 소켓의 이벤트 핸들
+    server_ev_t sub_ev;
+    /// 받는 중인 stream 목록 (첫 chunk 를 받을 때 만든다, 없으면 NULL)
+    stream_tab_t *streams;
+    /// 바이트 stream 을 읽고 쓰는 방법 (NULL 이면 fd 에 read / write, 시험에서는 COMMON/mempipe.h)
+    io_t *io;
+    /// 구독한 topic 과 보낼 발행 메시지 (첫 구독 요청을 받을 때 만든다, 없으면 NULL)
+    pubsub_sub_t *sub;
+    /// 응답 바디를 sendfile 로 보낼 blob 파일 (없으면 NULL)
+    blob_t *blob;
+    /// 받은 메시지의 deadline (KMP_FLAG_DEADLINE, kmp_now_us 기준 us, 없으면 0)
+    uint64_t deadline_us;
+} __attribute__(( aligned( 64)));
 
 /// @struct server_t
 /// @brief client의 요청에 따른 응답을 처리하기 위한 구조체 
@@ -63,13 +201,89 @@ struct server_s{
 	int fd;
 	/// server socket address
 	struct sockaddr_in addr;
+	/// server unix domain socket file descriptor (없으면 -1)
+	int unix_fd;
+	/// server unix domain socket address
+	struct sockaddr_un unix_addr;
 	/// server epoll handle file descriptor
 	int epoll_handle_fd;
-	/// server epoll event management structure
-	struct epoll_event events[ BUF_MAX_LEN];
+	/// TCP listener 이벤트 핸들
+	server_ev_t listen_ev;
+	/// UDS listener 이벤트 핸들
+	server_ev_t unix_listen_ev;
+	/// server epoll event management structure (SERVER_EVENT_MAX 개)
+	struct epoll_event *events;
+	/// fd 로 바로 찾는 연결 table (chunk 단위로 할당)
+	transc_t *transc_table[ TRANSC_CHUNK_NUM];
+	/// 연결된 client 수
+	int transc_num;
+	/// 돌려받은 송수신 버퍼 목록 / 그 수 / 연결이 빌려 간 버퍼 수
+	transc_buf_t *buf_pool;
+	int buf_pool_num;
+	int buf_used;
+	/// proxy 모드 여부 (client 메시지를 upstream으로 splice 중계)
+	int is_proxy;
+	/// proxy 모드의 upstream kmp server 주소
+	struct sockaddr_in upstream_addr;
+	/// app_id 기반 sharding 모드의 routing 계층 (없으면 NULL)
+	route_t *route;
+	/// coroutine handler 모드의 scheduler (없으면 NULL)
+	coro_sched_t *coro;
+	/// routing 모드의 멱등 code 응답 cache (없으면 NULL)
+	cache_t *cache;
+	/// app_id 별 처리율 제한 / 전역 동시 처리 한도 (없으면 NULL)
+	admit_t *admit;
+	/// 부하 시험용으로 요청마다 흉내 내는 handler 처리 시간 (us, 0이면 없음)
+	int work_us;
+	/// 우선순위별 run queue 의 처음 / 마지막 연결
+	transc_t *run_head[ SERVER_PRIO_NUM];
+	transc_t *run_tail[ SERVER_PRIO_NUM];
+	/// 연결 하나가 event loop 한 번에 처리하는 최대 메시지 수
+	int budget;
+	/// high run queue 에서 처리한 메시지 수
+	uint64_t prio_high;
+	/// budget 을 다 써서 남은 메시지를 다음 loop 로 넘긴 횟수
+	uint64_t budget_exhausted;
+	/// 받은 메시지를 기록하는 capture 파일 (없으면 NULL)
+	capture_t *capture;
+	/// 마지막으로 발급한 연결 id
+	uint32_t conn_seq;
+	/// 무중단 재시작을 위해 listener / 연결을 넘기는 handoff 끝점 (없으면 NULL)
+	handoff_t *handoff;
+	/// 잠들기 전에 이벤트를 확인하며 기다리는 busy-poll 상태 (없으면 NULL)
+	spin_t *spin;
+	/// datagram 하나에 kmp 메시지 하나를 받는 UDP 소켓 (없으면 NULL)
+	udp_t *udp;
+	/// worker 모드의 worker 목록 (없으면 NULL)
+	worker_pool_t *pool;
+	/// durable code 의 메시지를 응답 전에 내리는 write-ahead log (없으면 NULL)
+	wal_t *wal;
+	/// 발행 메시지를 구독자에게 나눠 보내는 topic 목록 (없으면 NULL)
+	pubsub_t *pubsub;
+	/// 최근 연결 event 를 남기는 flight recorder (없으면 NULL)
+	flight_t *flight;
+	/// KMP_CODE_BLOB 요청에 보내는 blob 디렉토리의 열어 둔 파일 목록 (없으면 NULL)
+	blob_tab_t *blob;
+	/// 이 event loop 를 돌리는 worker (worker 가 아니면 NULL)
+	worker_t *worker;
+	/// 처리한 요청 수
+	uint64_t requests;
+	/// 받은 stream chunk 수 / 보낸 KMP_CODE_CREDIT 수 / 다 받은 stream 수 / 창을 어기거나 stream 이 너무 많아 닫은 연결 수
+	uint64_t stream_chunks;
+	uint64_t stream_credits;
+	uint64_t stream_ends;
+	uint64_t stream_errors;
+	/// CRC32C trailer 를 검사한 메시지 수 / 맞지 않아서 닫은 연결 수
+	uint64_t crc_frames;
+	uint64_t crc_errors;
+	/// deadline 이 있던 메시지 수 / 다 받았을 때 이미 지나서 / 처리 차례가 왔을 때 지나서 처리하지 않고 KMP_CODE_EXPIRED 로 답한 요청 수
+	uint64_t deadline_frames;
+	uint64_t expired_recv;
+	uint64_t expired_run;
 };
 
-server_t* server_init();
+server_t* server_init( char **argv, int listen_fd);
+int server_init_unix( server_t* server, const char *path, int listen_fd);
 void server_destroy( server_t* server);
 int server_conn( server_t* server);
 
@@ -0,0 +1,112 @@
+#include "spin.h"
+
+/**
+ * @fn static uint64_t spin_now_ns()
+ * @brief monotonic clock 기준 현재 시각을 ns 단위로 구하는 함수 (vDSO 라 system call 이 없다)
+ * @return 현재 시각 (ns)
+ */
+static uint64_t spin_now_ns(){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts);
+    return ( uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @fn spin_t* spin_init( int mode, uint32_t max_us)
+ * @brief busy-poll 객체를 생성하는 함수
+ * @return 생성된 객체, 실패하면 NULL
+ * @param mode spin 모드 (SPIN_MODE)
+ * @param max_us 최대 spin 시간 (us, SPIN_US_MAX 이하)
+ */
+spin_t* spin_init( int mode, uint32_t max_us){
+    spin_t *spin;
+
+    if( ( max_us == 0) || ( max_us > SPIN_US_MAX)){
+        printf("    | ! Spin : spin time must be 1 ~ %d us (%u)\n", SPIN_US_MAX, max_us);
+        return NULL;
+    }
+    if( ( spin = ( spin_t*)calloc( 1, sizeof( spin_t))) == NULL){
+        printf("    | ! Spin : Failed to allocate memory\n");
+        return NULL;
+    }
+    spin->mode = mode;
+    spin->max_us = max_us;
+    // adaptive 모드는 짧은 간격의 이벤트를 본 뒤에 spin 을 시작한다
+    spin->budget_us = ( mode == SPIN_MODE_FIXED) ? max_us : 0;
+    return spin;
+}
+
+/**
+ * @fn void spin_destroy( spin_t *spin)
+ * @brief busy-poll 객체를 해제하는 함수
+ * @return void
+ * @param spin busy-poll 객체 (NULL 이면 아무 것도 하지 않는다)
+ */
+void spin_destroy( spin_t *spin){
+    free( spin);
+}
+
+/**
+ * @fn static void spin_adapt( spin_t *spin, uint64_t gap_ns, int is_hit)
+ * @brief 이벤트가 올 때까지 걸린 시간으로 다음 spin 시간을 정하는 함수
+ * spin 중에 왔으면 그대로 두고, spin 이 끝난 뒤 max_us 안에 왔으면 두 배로 늘리고 (조금 더 기다렸으면 깨우지 않아도 됐다),
+ * max_us 보다 늦게 왔으면 반으로 줄인다 (spin 해도 받지 못했을 간격이라 CPU 만 쓴다)
+ * @return void
+ */
+static void spin_adapt( spin_t *spin, uint64_t gap_ns, int is_hit){
+    uint64_t gap_us = gap_ns / 1000;
+
+    spin->gap_us += SPIN_EWMA_ALPHA * ( gap_us - spin->gap_us);
+    if( ( spin->mode != SPIN_MODE_ADAPTIVE) || is_hit){
+        return;
+    }
+    if( gap_us <= spin->max_us){
+        spin->budget_us = ( spin->budget_us < SPIN_GROW_START_US) ? SPIN_GROW_START_US : spin->budget_us * 2;
+        if( spin->budget_us > spin->max_us){
+            spin->budget_us = spin->max_us;
+        }
+    }
+    else if( ( spin->budget_us /= 2) < SPIN_GROW_START_US){
+        spin->budget_us = 0;
+    }
+}
+
+/**
+ * @fn int spin_wait( spin_t *spin, int epoll_fd, struct epoll_event *events, int max, int timeout)
+ * @brief 현재 spin 시간 동안 epoll_wait( timeout 0) 으로 이벤트를 확인하고, 없으면 timeout 까지 잠드는 함수
+ * @return epoll_wait 결과
+ * @param spin busy-poll 객체
+ * @param epoll_fd epoll 인스턴스
+ * @param events 이벤트를 저장할 배열
+ * @param max 배열 크기
+ * @param timeout 잠들 때의 epoll_wait timeout (ms, 0 이면 spin 하지 않는다)
+ */
+int spin_wait( spin_t *spin, int epoll_fd, struct epoll_event *events, int max, int timeout){
+    uint64_t start, now, deadline;
+    int n;
+
+    start = spin_now_ns();
+    if( ( spin->budget_us > 0) && ( timeout != 0)){
+        deadline = start + ( uint64_t)spin->budget_us * 1000;
+        do{
+            n = epoll_wait( epoll_fd, events, max, 0);
+            now = spin_now_ns();
+            if( n != 0){
+                spin->spin_ns += now - start;
+                if( n > 0){
+                    spin->hits++;
+                    spin_adapt( spin, now - start, 1);
+                }
+                return n;
+            }
+        } while( now < deadline);
+        spin->spin_ns += now - start;
+        spin->misses++;
+    }
+
+    if( ( n = epoll_wait( epoll_fd, events, max, timeout)) >= 0){
+        // timeout 도 spin 으로 받을 수 없는 긴 간격으로 본다
+        spin_adapt( spin, spin_now_ns() - start, 0);
+    }
+    return n;
+}
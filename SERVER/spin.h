@@ -0,0 +1,54 @@
+#pragma once
+#ifndef __SPIN_H__
+#define __SPIN_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+#include "../COMMON/common.h"
+
+/// 설정할 수 있는 최대 spin 시간 (us). route / coroutine timer 가 이만큼 늦게 확인될 수 있다
+#define SPIN_US_MAX 5000
+/// adaptive 모드에서 spin 을 다시 시작할 때의 시간 (us). 이보다 작게 줄면 spin 하지 않는다
+#define SPIN_GROW_START_US 10
+/// 지연 EWMA 의 새 표본 가중치
+#define SPIN_EWMA_ALPHA 0.1
+
+/// spin 모드
+enum SPIN_MODE{
+    /// 매번 max_us 만큼 spin 한다
+    SPIN_MODE_FIXED = 1,
+    /// 관찰한 이벤트 간격에 맞춰 spin 시간을 0 ~ max_us 사이에서 움직인다
+    SPIN_MODE_ADAPTIVE
+};
+
+/// @struct spin_t
+/// @brief epoll_wait 로 잠들기 전에 timeout 0 으로 이벤트를 확인하며 기다리는 busy-poll 상태
+/// 잠든 thread 를 깨우는 비용(수십 us)을 CPU 시간으로 바꾼다
+typedef struct spin_s spin_t;
+struct spin_s{
+    /// spin 모드 (SPIN_MODE)
+    int mode;
+    /// 최대 spin 시간 (us)
+    uint32_t max_us;
+    /// 현재 spin 시간 (us, 0 이면 바로 잠든다)
+    uint32_t budget_us;
+    /// 기다리기 시작해서 이벤트가 올 때까지 걸린 시간의 EWMA (us)
+    double gap_us;
+    /// spin 중에 이벤트를 받은 횟수 / spin 했지만 이벤트가 없어서 잠든 횟수
+    uint64_t hits;
+    uint64_t misses;
+    /// spin 에 쓴 시간 (ns)
+    uint64_t spin_ns;
+};
+
+spin_t* spin_init( int mode, uint32_t max_us);
+void spin_destroy( spin_t *spin);
+int spin_wait( spin_t *spin, int epoll_fd, struct epoll_event *events, int max, int timeout);
+
+#endif
@@ -0,0 +1,483 @@
+#include "wal.h"
+
+/**
+ * @fn static int wal_open_segment( wal_t *wal, uint32_t id)
+ * @brief id 번 segment 를 만들고 WAL_SEGMENT_LEN 만큼 미리 잡는 함수 (wal_init 과 sync thread 만 부른다)
+ * 크기를 미리 잡아 두면 record 를 써도 파일 크기가 바뀌지 않으므로 fdatasync 가 크기 metadata 를 내리지 않는다
+ * 새 파일 이름이 crash 뒤에도 남도록 directory 도 fsync 한다
+ * @return 열린 file descriptor, 실패하면 FD_ERR
+ */
+static int wal_open_segment( wal_t *wal, uint32_t id){
+    char name[ 64];
+    int fd, rv;
+
+    snprintf( name, sizeof( name), WAL_SEGMENT_FMT, id);
+    if( ( fd = openat( wal->dir_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644)) < 0){
+        printf("    | ! WAL : Failed to create segment %s/%s (errno:%d)\n", wal->dir, name, errno);
+        return FD_ERR;
+    }
+    if( ( rv = posix_fallocate( fd, 0, WAL_SEGMENT_LEN)) != 0){
+        printf("    | ! WAL : Failed to preallocate segment %s/%s (errno:%d)\n", wal->dir, name, rv);
+        close( fd);
+        return FD_ERR;
+    }
+    if( ( fdatasync( fd) < 0) || ( fsync( wal->dir_fd) < 0)){
+        printf("    | ! WAL : Failed to sync segment %s/%s (errno:%d)\n", wal->dir, name, errno);
+        close( fd);
+        return FD_ERR;
+    }
+    return fd;
+}
+
+/**
+ * @fn static uint32_t wal_segment_id( const char *name)
+ * @brief 파일 이름에서 segment 번호를 구하는 함수
+ * @return segment 번호, segment 파일이 아니면 0
+ */
+static uint32_t wal_segment_id( const char *name){
+    unsigned int id;
+    char tail;
+
+    if( sscanf( name, "wal-%8u.lo%c", &id, &tail) != 2){
+        return 0;
+    }
+    return id;
+}
+
+/**
+ * @fn static int wal_sync_fds( int fd, int *retired, int retired_num)
+ * @brief 다 쓴 segment 들과 쓰고 있는 segment 를 fdatasync 하고 다 쓴 segment 는 닫는 함수
+ * @return 정상이면 NORMAL, fdatasync 가 하나라도 실패하면 FD_ERR (다 쓴 segment 는 그래도 닫는다)
+ */
+static int wal_sync_fds( int fd, int *retired, int retired_num){
+    int rv = NORMAL;
+    int i;
+
+    // 다 쓴 segment 의 record 가 앞 번호이므로 먼저 내린다
+    for( i = 0; i < retired_num; i++){
+        if( ( rv == NORMAL) && ( fdatasync( retired[ i]) < 0)){
+            printf("    | ! WAL : fdatasync failed on retired segment (errno:%d)\n", errno);
+            rv = FD_ERR;
+        }
+        close( retired[ i]);
+    }
+    if( ( rv == NORMAL) && ( fdatasync( fd) < 0)){
+        printf("    | ! WAL : fdatasync failed (errno:%d)\n", errno);
+        rv = FD_ERR;
+    }
+    return rv;
+}
+
+/**
+ * @fn static void* wal_sync_main( void *arg)
+ * @brief sync thread. 요청이 오면 window_us 동안 더 모은 뒤, 그때까지 쓴 record 를 fdatasync 한 번으로 내린다
+ * fdatasync 동안 event loop 는 다음 batch 의 record 를 계속 쓴다
+ * 다음 segment 가 없으면 sync 보다 먼저 만들어 두어서 (segment 하나에 한 번), segment 가 찼을 때 event loop 가 파일을 만들거나 기다리지 않게 한다
+ * 다 쓴 segment 가 남아 있으면 sync 요청이 없어도 내리고 닫는다
+ * @return NULL
+ * @param arg wal 객체
+ */
+static void* wal_sync_main( void *arg){
+    wal_t *wal = ( wal_t*)arg;
+    int retired[ WAL_RETIRED_MAX];
+    struct timespec start, end;
+    uint64_t target, one = 1;
+    int fd, retired_num;
+    uint32_t id;
+
+    pthread_mutex_lock( &wal->lock);
+    while( wal->is_stop == 0){
+        if( ( wal->next_fd < 0) && ( wal->is_next_failed == 0)){
+            // seg_id 는 다음 segment 가 준비되어야 바뀌므로 만드는 동안 그대로다
+            id = wal->seg_id + 1;
+            pthread_mutex_unlock( &wal->lock);
+            fd = wal_open_segment( wal, id);
+            pthread_mutex_lock( &wal->lock);
+            wal->next_fd = fd;
+            wal->is_next_failed = ( fd < 0);
+            continue;
+        }
+        if( ( wal->sync_req == wal->synced) && ( wal->retired_num == 0)){
+            pthread_cond_wait( &wal->cond, &wal->lock);
+            continue;
+        }
+        if( wal->window_us > 0){
+            pthread_mutex_unlock( &wal->lock);
+            usleep( wal->window_us);
+            pthread_mutex_lock( &wal->lock);
+        }
+        // record 번호와 segment 를 같이 읽으므로 target 까지의 record 는 모두 retired 나 fd 에 있다
+        // fd 는 그 뒤에 event loop 가 retired 로 넘겨도 닫는 것은 이 thread 뿐이므로 sync 하는 동안 열려 있다
+        target = wal->sync_req;
+        fd = wal->seg_fd;
+        retired_num = wal->retired_num;
+        memcpy( retired, wal->retired, sizeof( int) * retired_num);
+        wal->retired_num = 0;
+        pthread_mutex_unlock( &wal->lock);
+
+        clock_gettime( CLOCK_MONOTONIC, &start);
+        if( wal_sync_fds( fd, retired, retired_num) < NORMAL){
+            pthread_mutex_lock( &wal->lock);
+            wal->is_failed = 1;
+            wal->is_stop = 1;
+            pthread_mutex_unlock( &wal->lock);
+            write( wal->efd, &one, sizeof( one));
+            return NULL;
+        }
+        clock_gettime( CLOCK_MONOTONIC, &end);
+
+        pthread_mutex_lock( &wal->lock);
+        if( target - wal->synced > wal->batch_max){
+            wal->batch_max = target - wal->synced;
+        }
+        wal->synced = target;
+        wal->syncs++;
+        wal->sync_ns += ( end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+        write( wal->efd, &one, sizeof( one));
+    }
+    pthread_mutex_unlock( &wal->lock);
+    return NULL;
+}
+
+/**
+ * @fn wal_t* wal_init( const char *dir, int window_us)
+ * @brief write-ahead log 를 열고 sync thread 를 시작하는 함수
+ * 이미 있는 segment 는 그대로 두고 가장 큰 번호 다음부터 새 segment 에 쓴다
+ * @return 생성된 객체, 실패하면 NULL
+ * @param dir segment 를 둘 directory (없으면 만든다)
+ * @param window_us 첫 sync 요청 뒤 더 모으기 위해 기다리는 시간 (us)
+ */
+wal_t* wal_init( const char *dir, int window_us){
+    struct dirent *ent;
+    DIR *dp;
+    wal_t *wal;
+    uint32_t id;
+
+    if( ( wal = ( wal_t*)calloc( 1, sizeof( wal_t))) == NULL){
+        printf("    | ! WAL : Failed to allocate memory\n");
+        return NULL;
+    }
+    wal->efd = -1;
+    wal->dir_fd = -1;
+    wal->seg_fd = -1;
+    wal->next_fd = -1;
+    wal->window_us = window_us;
+    snprintf( wal->dir, sizeof( wal->dir), "%s", dir);
+    pthread_mutex_init( &wal->lock, NULL);
+    pthread_cond_init( &wal->cond, NULL);
+
+    mkdir( dir, 0755);
+    if( ( dp = opendir( dir)) == NULL){
+        printf("    | ! WAL : Failed to open directory %s (errno:%d)\n", dir, errno);
+        wal_destroy( wal);
+        return NULL;
+    }
+    while( ( ent = readdir( dp)) != NULL){
+        if( ( id = wal_segment_id( ent->d_name)) > wal->seg_id){
+            wal->seg_id = id;
+        }
+    }
+    closedir( dp);
+
+    if( ( ( wal->dir_fd = open( dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+            || ( ( wal->efd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+            || ( ( wal->seg_fd = wal_open_segment( wal, ++wal->seg_id)) < 0)){
+        wal_destroy( wal);
+        return NULL;
+    }
+    wal->segments = 1;
+    if( pthread_create( &wal->thread, NULL, wal_sync_main, wal) != 0){
+        printf("    | ! WAL : Failed to start sync thread\n");
+        wal->thread = 0;
+        wal_destroy( wal);
+        return NULL;
+    }
+    wal->type = WAL_EV_TYPE;
+    return wal;
+}
+
+/**
+ * @fn void wal_destroy( wal_t *wal)
+ * @brief sync thread 를 멈추고 write-ahead log 를 닫는 함수 (응답을 기다리던 요청은 버린다)
+ * @return void
+ * @param wal wal 객체 (NULL 이면 아무 것도 하지 않는다)
+ */
+void wal_destroy( wal_t *wal){
+    if( wal == NULL){
+        return;
+    }
+    if( wal->thread != 0){
+        pthread_mutex_lock( &wal->lock);
+        wal->is_stop = 1;
+        pthread_cond_signal( &wal->cond);
+        pthread_mutex_unlock( &wal->lock);
+        pthread_join( wal->thread, NULL);
+    }
+    while( wal->retired_num > 0){
+        close( wal->retired[ --wal->retired_num]);
+    }
+    if( wal->next_fd >= 0){
+        close( wal->next_fd);
+    }
+    if( wal->seg_fd >= 0){
+        close( wal->seg_fd);
+    }
+    if( wal->dir_fd >= 0){
+        close( wal->dir_fd);
+    }
+    if( wal->efd >= 0){
+        close( wal->efd);
+    }
+    pthread_mutex_destroy( &wal->lock);
+    pthread_cond_destroy( &wal->cond);
+    free( wal->waits);
+    free( wal);
+}
+
+/**
+ * @fn void wal_add_code( wal_t *wal, uint32_t code)
+ * @brief durable 로 처리할 code 를 추가하는 함수 (하나도 없으면 예약 code 를 뺀 모든 code 가 durable 이다)
+ * @return void
+ * @param wal wal 객체
+ * @param code 명령 코드
+ */
+void wal_add_code( wal_t *wal, uint32_t code){
+    if( wal->code_num < WAL_CODE_MAX){
+        wal->codes[ wal->code_num++] = code;
+    }
+}
+
+/**
+ * @fn int wal_is_durable( wal_t *wal, uint32_t code)
+ * @brief 응답 전에 log 에 내려야 하는 code 인지 확인하는 함수
+ * @return durable 이면 1, 아니면 0
+ * @param wal wal 객체
+ * @param code 명령 코드
+ */
+int wal_is_durable( wal_t *wal, uint32_t code){
+    int i;
+
+    if( wal->code_num == 0){
+        return code < KMP_CODE_RESERVED;
+    }
+    for( i = 0; i < wal->code_num; i++){
+        if( wal->codes[ i] == code){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn int wal_append( wal_t *wal, const char *hdr, int hdr_len, const char *body, int body_len, void *owner)
+ * @brief 메시지 하나를 record 로 쓰고 durable 해질 때까지 owner 를 기다리게 하는 함수
+ * record 는 page cache 에만 쓰고, 실제로 내리는 것은 wal_kick 뒤의 sync thread 다
+ * segment 가 차면 sync thread 가 미리 만들어 둔 다음 segment 로 바꾸기만 하고, 다 쓴 segment 는 sync thread 가 내리고 닫는다
+ * @return 정상이면 NORMAL, 다음 segment 가 아직 없어서 쓰지 않았으면 ERRNO_EAGAIN, 쓰지 못하면 FD_ERR / OBJECT_ERR
+ * @param wal wal 객체
+ * @param hdr 메시지 헤더
+ * @param hdr_len 헤더 길이
+ * @param body 메시지 바디
+ * @param body_len 바디 길이
+ * @param owner 응답을 기다리는 쪽 (wal_pop_done 이 돌려준다)
+ */
+int wal_append( wal_t *wal, const char *hdr, int hdr_len, const char *body, int body_len, void *owner){
+    wal_rec_hdr_t rec;
+    struct iovec iov[ 3];
+    wal_wait_t *waits;
+    int rec_len = sizeof( rec) + hdr_len + body_len;
+    int fd, i, cap;
+
+    if( wal->is_failed){
+        return FD_ERR;
+    }
+    if( wal->wait_num == wal->wait_cap){
+        // ring 을 두 배로 늘리면서 순서대로 다시 편다
+        cap = ( wal->wait_cap > 0) ? wal->wait_cap * 2 : 1024;
+        if( ( waits = ( wal_wait_t*)malloc( sizeof( wal_wait_t) * cap)) == NULL){
+            printf("    | ! WAL : Failed to allocate memory\n");
+            return OBJECT_ERR;
+        }
+        for( i = 0; i < wal->wait_num; i++){
+            waits[ i] = wal->waits[ ( wal->wait_head + i) % wal->wait_cap];
+        }
+        free( wal->waits);
+        wal->waits = waits;
+        wal->wait_cap = cap;
+        wal->wait_head = 0;
+    }
+
+    if( wal->seg_off + rec_len > WAL_SEGMENT_LEN){
+        pthread_mutex_lock( &wal->lock);
+        if( ( ( fd = wal->next_fd) < 0) || ( wal->retired_num == WAL_RETIRED_MAX)){
+            // sync thread 가 다음 segment 를 아직 만들지 못했거나 다 쓴 segment 를 아직 닫지 못했다 (만들다 실패했으면 다시 시도시킨다)
+            wal->is_next_failed = 0;
+            pthread_cond_signal( &wal->cond);
+            pthread_mutex_unlock( &wal->lock);
+            wal->stalls++;
+            return ERRNO_EAGAIN;
+        }
+        wal->retired[ wal->retired_num++] = wal->seg_fd;
+        wal->seg_fd = fd;
+        wal->seg_id++;
+        wal->next_fd = -1;
+        // 비어 있으면 바로 그 다음 segment 를 만들도록 깨운다
+        pthread_cond_signal( &wal->cond);
+        pthread_mutex_unlock( &wal->lock);
+        wal->seg_off = 0;
+        wal->segments++;
+    }
+
+    rec.len = hdr_len + body_len;
+    rec.crc = crc32c_update( crc32c_update( crc32c_update( 0, &rec.len, sizeof( rec.len)), hdr, hdr_len), body, body_len);
+    iov[ 0].iov_base = &rec;
+    iov[ 0].iov_len = sizeof( rec);
+    iov[ 1].iov_base = ( void*)hdr;
+    iov[ 1].iov_len = hdr_len;
+    iov[ 2].iov_base = ( void*)body;
+    iov[ 2].iov_len = body_len;
+    // segment 는 sync thread 만 닫으므로 lock 없이 쓴다 (바꾸는 것은 이 thread 뿐이다)
+    if( pwritev( wal->seg_fd, iov, 3, wal->seg_off) != rec_len){
+        printf("    | ! WAL : Failed to write record (errno:%d)\n", errno);
+        return FD_ERR;
+    }
+    wal->seg_off += rec_len;
+    wal->seq++;
+    wal->records++;
+    wal->bytes += rec_len;
+
+    wal->waits[ ( wal->wait_head + wal->wait_num) % wal->wait_cap].owner = owner;
+    wal->waits[ ( wal->wait_head + wal->wait_num) % wal->wait_cap].seq = wal->seq;
+    wal->wait_num++;
+    return NORMAL;
+}
+
+/**
+ * @fn void wal_kick( wal_t *wal)
+ * @brief 지금까지 쓴 record 를 내리도록 sync thread 에 요청하는 함수
+ * event loop 한 번에 한 번 부르므로 그 동안 받은 요청이 fdatasync 한 번에 같이 내려간다
+ * @return void
+ * @param wal wal 객체
+ */
+void wal_kick( wal_t *wal){
+    if( wal->wait_num == 0){
+        return;
+    }
+    pthread_mutex_lock( &wal->lock);
+    if( wal->sync_req != wal->seq){
+        wal->sync_req = wal->seq;
+        pthread_cond_signal( &wal->cond);
+    }
+    pthread_mutex_unlock( &wal->lock);
+}
+
+/**
+ * @fn uint64_t wal_done( wal_t *wal, int *is_failed)
+ * @brief sync 완료 eventfd 를 비우고 내려간 마지막 record 번호를 구하는 함수
+ * @return 내려간 마지막 record 번호
+ * @param wal wal 객체
+ * @param is_failed fdatasync 가 실패했으면 1 (기다리는 요청은 응답하지 말고 닫아야 한다)
+ */
+uint64_t wal_done( wal_t *wal, int *is_failed){
+    uint64_t synced, count;
+
+    read( wal->efd, &count, sizeof( count));
+    pthread_mutex_lock( &wal->lock);
+    synced = wal->synced;
+    *is_failed = wal->is_failed;
+    pthread_mutex_unlock( &wal->lock);
+    return synced;
+}
+
+/**
+ * @fn void* wal_pop_done( wal_t *wal, uint64_t synced)
+ * @brief record 가 내려간 요청을 순서대로 하나씩 꺼내는 함수 (닫힌 연결의 요청은 건너뛴다)
+ * @return 기다리던 쪽, 더 없으면 NULL
+ * @param wal wal 객체
+ * @param synced wal_done 이 돌려준 record 번호
+ */
+void* wal_pop_done( wal_t *wal, uint64_t synced){
+    wal_wait_t *wait;
+
+    while( wal->wait_num > 0){
+        wait = &wal->waits[ wal->wait_head];
+        if( wait->seq > synced){
+            return NULL;
+        }
+        wal->wait_head = ( wal->wait_head + 1) % wal->wait_cap;
+        wal->wait_num--;
+        if( wait->owner != NULL){
+            return wait->owner;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn void wal_cancel( wal_t *wal, void *owner)
+ * @brief 닫히는 연결이 기다리던 요청을 지우는 함수 (record 는 남고 응답만 보내지 않는다)
+ * @return void
+ * @param wal wal 객체
+ * @param owner 닫히는 쪽
+ */
+void wal_cancel( wal_t *wal, void *owner){
+    int i;
+
+    for( i = 0; i < wal->wait_num; i++){
+        if( wal->waits[ ( wal->wait_head + i) % wal->wait_cap].owner == owner){
+            wal->waits[ ( wal->wait_head + i) % wal->wait_cap].owner = NULL;
+        }
+    }
+}
+
+/**
+ * @fn int wal_scan( const char *dir, wal_scan_fn fn, void *arg)
+ * @brief directory 의 segment 를 번호 순서로 읽으며 온전한 record 마다 fn 을 부르는 함수 (crash 뒤 복구 / 검증용)
+ * segment 마다 len 이 0 이거나 crc 가 맞지 않는 record 에서 멈춘다 (다 쓰기 전에 죽은 뒤쪽 record)
+ * @return 읽은 record 수, directory 를 열 수 없으면 FD_ERR
+ * @param dir segment directory
+ * @param fn record 마다 부르는 함수
+ * @param arg fn 에 넘길 인자
+ */
+int wal_scan( const char *dir, wal_scan_fn fn, void *arg){
+    char path[ PATH_MAX];
+    char frame[ 64 << 10];
+    struct dirent *ent;
+    wal_rec_hdr_t rec;
+    uint32_t id, max_id = 0;
+    int num = 0;
+    off_t off;
+    DIR *dp;
+    FILE *fp;
+
+    if( ( dp = opendir( dir)) == NULL){
+        return FD_ERR;
+    }
+    while( ( ent = readdir( dp)) != NULL){
+        if( ( id = wal_segment_id( ent->d_name)) > max_id){
+            max_id = id;
+        }
+    }
+    closedir( dp);
+
+    for( id = 1; id <= max_id; id++){
+        snprintf( path, sizeof( path), "%s/" WAL_SEGMENT_FMT, dir, id);
+        if( ( fp = fopen( path, "rb")) == NULL){
+            continue;
+        }
+        for( off = 0; off + ( off_t)sizeof( rec) <= WAL_SEGMENT_LEN; off += sizeof( rec) + rec.len){
+            if( ( fread( &rec, sizeof( rec), 1, fp) != 1) || ( rec.len == 0) || ( rec.len > sizeof( frame))
+                    || ( fread( frame, rec.len, 1, fp) != 1)
+                    || ( rec.crc != crc32c_update( crc32c_update( 0, &rec.len, sizeof( rec.len)), frame, rec.len))){
+                break;
+            }
+            num++;
+            if( fn( arg, frame, rec.len) < NORMAL){
+                fclose( fp);
+                return num;
+            }
+        }
+        fclose( fp);
+    }
+    return num;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#ifndef __WAL_H__
+#define __WAL_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
+#include "../COMMON/common.h"
+#include "../COMMON/crc32c.h"
+
+/// epoll 이벤트 종류 (wal_t 의 첫 번째 멤버, server 의 다른 이벤트 종류와 겹치지 않는다)
+#define WAL_EV_TYPE 11
+/// segment 하나의 크기 (만들 때 fallocate 로 미리 잡는다)
+#define WAL_SEGMENT_LEN ( 64 << 20)
+/// 한 server 가 durable 로 처리하는 최대 code 수
+#define WAL_CODE_MAX 16
+/// segment 파일 이름 (번호는 1 부터 늘어난다)
+#define WAL_SEGMENT_FMT "wal-%08u.log"
+/// 다 써서 sync thread 가 마지막으로 내리고 닫기를 기다리는 segment 의 최대 수
+#define WAL_RETIRED_MAX 8
+
+/// @struct wal_rec_hdr_t
+/// @brief segment 안의 record 헤더 (뒤에 len 바이트의 kmp 메시지가 온다)
+/// len 이 0 이면 아직 쓰지 않은 preallocate 영역이고, crc 가 맞지 않으면 다 쓰기 전에 죽은 record 다
+typedef struct wal_rec_hdr_s wal_rec_hdr_t;
+struct wal_rec_hdr_s{
+    /// 메시지 길이
+    uint32_t len;
+    /// len 과 메시지의 CRC32C
+    uint32_t crc;
+};
+
+/// @struct wal_wait_t
+/// @brief durable 해질 때까지 응답을 기다리는 요청 하나
+typedef struct wal_wait_s wal_wait_t;
+struct wal_wait_s{
+    /// 기다리는 쪽 (연결이 닫히면 NULL)
+    void *owner;
+    /// 기다리는 record 번호
+    uint64_t seq;
+};
+
+/// @brief wal_scan 이 record 마다 부르는 함수 (NORMAL 미만을 돌려주면 멈춘다)
+typedef int ( *wal_scan_fn)( void *arg, const char *frame, int len);
+
+/// @struct wal_t
+/// @brief durable code 의 메시지를 받는 순서대로 쌓는 segment 단위 write-ahead log
+/// event loop 가 record 를 page cache 에 쓰고, sync thread 가 그 동안 쌓인 record 를 fdatasync 한 번으로 내린 뒤
+/// eventfd 로 event loop 를 깨운다 (group commit). 응답은 자기 record 가 내려간 뒤에만 보낸다
+/// segment 를 만들고 닫는 것은 모두 sync thread 이고, event loop 는 segment 가 차면 미리 만들어 둔 다음 segment 로 바꾸기만 한다
+typedef struct wal_s wal_t;
+struct wal_s{
+    /// epoll 이벤트 종류 (WAL_EV_TYPE)
+    int type;
+    /// sync 가 끝났음을 알리는 eventfd
+    int efd;
+    /// segment 를 두는 directory
+    char dir[ PATH_MAX];
+    int dir_fd;
+    /// 첫 sync 요청 뒤 더 모으기 위해 기다리는 시간 (us, 0 이면 바로 sync)
+    int window_us;
+    /// durable 로 처리할 code (없으면 예약 code 를 뺀 모든 code)
+    uint32_t codes[ WAL_CODE_MAX];
+    int code_num;
+
+    /// 쓰고 있는 segment 번호 (바꿀 때는 lock 을 잡는다) / 다음에 쓸 위치 (event loop 만 쓴다)
+    uint32_t seg_id;
+    uint64_t seg_off;
+    /// 마지막으로 쓴 record 번호 (event loop 만 쓴다)
+    uint64_t seq;
+    /// 응답을 기다리는 요청 (record 번호 순서, event loop 만 쓴다)
+    wal_wait_t *waits;
+    int wait_head;
+    int wait_num;
+    int wait_cap;
+
+    /// 아래는 lock 으로 보호한다 (sync thread 와 같이 쓴다)
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int is_stop;
+    /// 쓰고 있는 segment (segment 번호는 seg_id)
+    int seg_fd;
+    /// sync thread 가 미리 만들어 둔 seg_id + 1 번 segment (없으면 -1) / 만들다 실패했는지 (event loop 가 다시 요청할 때까지 쉰다)
+    int next_fd;
+    int is_next_failed;
+    /// 다 써서 마지막 sync 뒤 닫을 segment (쓴 순서)
+    int retired[ WAL_RETIRED_MAX];
+    int retired_num;
+    /// sync 를 요청한 마지막 record 번호 / 내려간 마지막 record 번호
+    uint64_t sync_req;
+    uint64_t synced;
+    /// fdatasync 실패 (이후 응답하지 않는다)
+    int is_failed;
+
+    /// 통계 : 쓴 record 수 / 바이트 수, fdatasync 횟수 / 걸린 시간 합, 한 번에 내린 최대 record 수, 쓰기 시작한 segment 수,
+    /// 다음 segment 가 준비되지 않아 받지 못한 record 수
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t syncs;
+    uint64_t sync_ns;
+    uint64_t batch_max;
+    uint64_t segments;
+    uint64_t stalls;
+};
+
+wal_t* wal_init( const char *dir, int window_us);
+void wal_destroy( wal_t *wal);
+void wal_add_code( wal_t *wal, uint32_t code);
+int wal_is_durable( wal_t *wal, uint32_t code);
+int wal_append( wal_t *wal, const char *hdr, int hdr_len, const char *body, int body_len, void *owner);
+void wal_kick( wal_t *wal);
+uint64_t wal_done( wal_t *wal, int *is_failed);
+void* wal_pop_done( wal_t *wal, uint64_t synced);
+void wal_cancel( wal_t *wal, void *owner);
+int wal_scan( const char *dir, wal_scan_fn fn, void *arg);
+
+#endif
@@ -0,0 +1,186 @@
+#define _GNU_SOURCE
+#include "worker.h"
+
+/**
+ * @fn worker_pool_t* worker_pool_init( int mode, int num)
+ * @brief worker 목록과 worker 별 queue / eventfd 를 만드는 함수 (thread 와 event loop 는 server 가 만든다)
+ * @return 생성된 객체, 실패하면 NULL
+ * @param mode 분배 방법 (WORKER_MODE)
+ * @param num worker 수 (1 ~ WORKER_MAX)
+ */
+worker_pool_t* worker_pool_init( int mode, int num){
+    worker_pool_t *pool;
+    int i;
+
+    if( ( num < 1) || ( num > WORKER_MAX)){
+        printf("    | ! Worker : worker count must be 1 ~ %d (%d)\n", WORKER_MAX, num);
+        return NULL;
+    }
+    if( ( pool = ( worker_pool_t*)calloc( 1, sizeof( worker_pool_t))) == NULL){
+        printf("    | ! Worker : Failed to allocate memory\n");
+        return NULL;
+    }
+    pool->mode = mode;
+    for( i = 0; i < num; i++){
+        if( posix_memalign( ( void**)&pool->workers[ i], 64, sizeof( worker_t)) != 0){
+            printf("    | ! Worker : Failed to allocate memory\n");
+            worker_pool_destroy( pool);
+            return NULL;
+        }
+        memset( pool->workers[ i], 0, sizeof( worker_t));
+        pool->num++;
+        pool->workers[ i]->type = WORKER_EV_TYPE;
+        pool->workers[ i]->id = i;
+        if( ( pool->workers[ i]->efd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0){
+            printf("    | ! Worker : Failed to create eventfd (errno:%d)\n", errno);
+            worker_pool_destroy( pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+/**
+ * @fn void worker_pool_destroy( worker_pool_t *pool)
+ * @brief worker 목록을 해제하는 함수 (worker thread 와 event loop 는 먼저 정리되어 있어야 한다)
+ * @return void
+ * @param pool worker 목록 (NULL 이면 아무 것도 하지 않는다)
+ */
+void worker_pool_destroy( worker_pool_t *pool){
+    int i, fd;
+
+    if( pool == NULL){
+        return;
+    }
+    for( i = 0; i < pool->num; i++){
+        while( ( fd = worker_pop( pool->workers[ i])) >= 0){
+            close( fd);
+        }
+        if( pool->workers[ i]->efd >= 0){
+            close( pool->workers[ i]->efd);
+        }
+        free( pool->workers[ i]);
+    }
+    free( pool);
+}
+
+/**
+ * @fn static int worker_push( worker_t *worker, int fd)
+ * @brief acceptor 가 연결을 worker queue 에 넣는 함수 (fd 를 쓴 뒤 tail 을 release 로 올린다)
+ * @return 정상이면 NORMAL, queue 가 가득 찼으면 BUF_ERR
+ */
+static int worker_push( worker_t *worker, int fd){
+    uint32_t tail = worker->tail;
+
+    if( tail - __atomic_load_n( &worker->head, __ATOMIC_ACQUIRE) == WORKER_QUEUE_LEN){
+        return BUF_ERR;
+    }
+    worker->fds[ tail & ( WORKER_QUEUE_LEN - 1)] = fd;
+    __atomic_store_n( &worker->tail, tail + 1, __ATOMIC_RELEASE);
+    return NORMAL;
+}
+
+/**
+ * @fn int worker_pop( worker_t *worker)
+ * @brief worker 가 queue 에서 연결 하나를 꺼내는 함수
+ * @return 연결 fd, 비어 있으면 -1
+ * @param worker 연결을 꺼낼 worker (자기 자신)
+ */
+int worker_pop( worker_t *worker){
+    uint32_t head = worker->head;
+    int fd;
+
+    if( head == __atomic_load_n( &worker->tail, __ATOMIC_ACQUIRE)){
+        return -1;
+    }
+    fd = worker->fds[ head & ( WORKER_QUEUE_LEN - 1)];
+    __atomic_store_n( &worker->head, head + 1, __ATOMIC_RELEASE);
+    return fd;
+}
+
+/**
+ * @fn void worker_conn_add( worker_t *worker)
+ * @brief worker 가 맡은 연결 수를 하나 늘리는 함수 (SO_REUSEPORT 모드에서 worker 가 직접 받은 연결)
+ * @return void
+ * @param worker 연결을 받은 worker
+ */
+void worker_conn_add( worker_t *worker){
+    __atomic_add_fetch( &worker->conns, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch( &worker->dispatched, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @fn void worker_conn_done( worker_t *worker)
+ * @brief worker 가 연결을 닫았을 때 맡은 연결 수를 하나 줄이는 함수
+ * @return void
+ * @param worker 연결을 닫은 worker
+ */
+void worker_conn_done( worker_t *worker){
+    __atomic_sub_fetch( &worker->conns, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @fn static worker_t* worker_pick( worker_pool_t *pool)
+ * @brief 맡은 연결 수가 가장 적은 worker 를 고르는 함수 (같으면 지난번에 고른 다음 worker 부터 돌아가며 고른다)
+ * @return 고른 worker
+ */
+static worker_t* worker_pick( worker_pool_t *pool){
+    worker_t *best = NULL, *worker;
+    int i, conns, best_conns = 0;
+
+    for( i = 0; i < pool->num; i++){
+        worker = pool->workers[ ( pool->next + i) % pool->num];
+        conns = __atomic_load_n( &worker->conns, __ATOMIC_RELAXED);
+        if( ( best == NULL) || ( conns < best_conns)){
+            best = worker;
+            best_conns = conns;
+        }
+    }
+    pool->next = ( best->id + 1) % pool->num;
+    return best;
+}
+
+/**
+ * @fn int worker_accept_loop( worker_pool_t *pool, int listen_fd)
+ * @brief acceptor thread 의 accept loop. 받은 연결을 연결 수가 가장 적은 worker 의 queue 에 넣고 eventfd 로 깨운다
+ * 연결 수는 넘길 때 바로 늘리므로 worker 가 아직 가져가지 않은 연결도 부하로 본다
+ * @return listener 가 깨지면 SOC_ERR (정상이면 돌아오지 않는다)
+ * @param pool worker 목록
+ * @param listen_fd non-blocking TCP listener
+ */
+int worker_accept_loop( worker_pool_t *pool, int listen_fd){
+    struct pollfd pfd;
+    uint64_t one = 1;
+    worker_t *worker;
+    int fd;
+
+    pfd.fd = listen_fd;
+    pfd.events = POLLIN;
+    while( 1){
+        if( ( poll( &pfd, 1, -1) < 0) && ( errno != EINTR)){
+            printf("    | ! Worker : poll error in acceptor (errno:%d)\n", errno);
+            return SOC_ERR;
+        }
+        while( ( fd = accept4( listen_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0){
+            worker = worker_pick( pool);
+            if( worker_push( worker, fd) < NORMAL){
+                printf("    | ! Worker : queue of worker %d is full (fd:%d)\n", worker->id, fd);
+                pool->queue_full++;
+                close( fd);
+                continue;
+            }
+            worker_conn_add( worker);
+            if( write( worker->efd, &one, sizeof( one)) < 0){
+                // eventfd 값이 넘칠 일은 없고, 이미 깨울 값이 남아 있으면 worker 가 곧 queue 를 비운다
+                continue;
+            }
+        }
+        if( ( errno != EAGAIN) && ( errno != EWOULDBLOCK) && ( errno != EINTR) && ( errno != ECONNABORTED)){
+            printf("    | ! Worker : accept error in acceptor (errno:%d)\n", errno);
+            if( ( errno != EMFILE) && ( errno != ENFILE)){
+                return SOC_ERR;
+            }
+            usleep( 1000);
+        }
+    }
+}
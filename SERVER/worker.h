@@ -0,0 +1,83 @@
+#pragma once
+#ifndef __WORKER_H__
+#define __WORKER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include "../COMMON/common.h"
+
+/// epoll 이벤트 종류 (worker_t 의 첫 번째 멤버, server 의 다른 이벤트 종류와 겹치지 않는다)
+#define WORKER_EV_TYPE 10
+/// 최대 worker 수
+#define WORKER_MAX 16
+/// worker 하나가 아직 가져가지 않은 연결을 쌓아 두는 queue 길이 (2의 거듭제곱)
+#define WORKER_QUEUE_LEN 4096
+
+/// 연결을 worker 에 나누는 방법
+enum WORKER_MODE{
+    /// acceptor thread 가 받은 연결을 연결 수가 가장 적은 worker 에 넘긴다
+    WORKER_MODE_ACCEPTOR = 1,
+    /// worker 마다 SO_REUSEPORT listener 를 열고 kernel 이 4-tuple hash 로 나눈다
+    WORKER_MODE_REUSEPORT
+};
+
+/// @struct worker_t
+/// @brief event loop 를 하나씩 돌리는 worker thread 와 acceptor 가 넘기는 연결 queue
+/// queue 는 acceptor 하나가 넣고 worker 하나가 꺼내는 lock-free ring 이고, 넣은 뒤 eventfd 로 worker 를 깨운다
+/// epoll data.ptr 가 직접 가리킨다
+typedef struct worker_s worker_t;
+struct worker_s{
+    /// epoll 이벤트 종류 (WORKER_EV_TYPE)
+    int type;
+    /// queue 에 연결을 넣었음을 알리는 eventfd
+    int efd;
+    /// worker 번호
+    int id;
+    /// worker thread
+    pthread_t thread;
+    /// worker 의 event loop 객체 (server_t)
+    void *server;
+    /// 맡고 있는 연결 수 (넘겨 받기를 기다리는 연결 포함, acceptor 와 worker 가 atomic 으로 바꾼다)
+    int conns;
+    /// 넘겨 받은 연결 수
+    uint64_t dispatched;
+    /// worker 가 다음에 꺼낼 위치 (worker 만 쓴다)
+    uint32_t head __attribute__(( aligned( 64)));
+    /// acceptor 가 다음에 넣을 위치 (acceptor 만 쓴다)
+    uint32_t tail __attribute__(( aligned( 64)));
+    int fds[ WORKER_QUEUE_LEN] __attribute__(( aligned( 64)));
+};
+
+/// @struct worker_pool_t
+/// @brief worker 목록과 연결 분배 방법
+typedef struct worker_pool_s worker_pool_t;
+struct worker_pool_s{
+    /// 분배 방법 (WORKER_MODE)
+    int mode;
+    /// worker 수
+    int num;
+    worker_t *workers[ WORKER_MAX];
+    /// 연결 수가 같은 worker 가 여럿이면 여기서부터 찾는다 (acceptor 만 쓴다)
+    int next;
+    /// queue 가 가득 차서 닫은 연결 수
+    uint64_t queue_full;
+};
+
+worker_pool_t* worker_pool_init( int mode, int num);
+void worker_pool_destroy( worker_pool_t *pool);
+int worker_pop( worker_t *worker);
+void worker_conn_done( worker_t *worker);
+void worker_conn_add( worker_t *worker);
+int worker_accept_loop( worker_pool_t *pool, int listen_fd);
+
+#endif